@@ -35,6 +35,7 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/graph_constructor.h"
 #include "tensorflow/core/common_runtime/graph_optimizer.h"
 #include "tensorflow/core/common_runtime/local_session_selection.h"
+#include "tensorflow/core/common_runtime/memory_planner.h"
 #include "tensorflow/core/common_runtime/memory_types.h"
 #include "tensorflow/core/common_runtime/optimization_registry.h"
 #include "tensorflow/core/common_runtime/process_util.h"
@@ -48,8 +49,10 @@ limitations under the License.
 #include "tensorflow/core/framework/logging.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/run_handler.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/versions.pb.h"
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/graph.h"
@@ -159,6 +162,48 @@ string GetRendezvousKey(const string& tensor_name,
                          frame_iter.frame_id, ":", frame_iter.iter_id);
 }
 
+// Returns the shapes of the tensors fed by `callable_options`, indexed by
+// feed, as given by the "shape" attr of the fed placeholders in `graph_def`.
+// Other feeds have unknown shapes.
+std::vector<PartialTensorShape> FeedShapes(
+    const GraphDef& graph_def, const CallableOptions& callable_options) {
+  std::vector<PartialTensorShape> shapes(callable_options.feed_size());
+  std::unordered_map<StringPiece, int, StringPieceHasher> placeholder_feeds;
+  for (int i = 0; i < callable_options.feed_size(); ++i) {
+    TensorId id(ParseTensorName(callable_options.feed(i)));
+    if (id.second == 0) placeholder_feeds.emplace(id.first, i);
+  }
+  for (const NodeDef& node : graph_def.node()) {
+    auto it = placeholder_feeds.find(node.name());
+    if (it == placeholder_feeds.end() || node.op() != "Placeholder") continue;
+    const AttrValue* shape = AttrSlice(node).Find("shape");
+    if (shape != nullptr && shape->has_shape()) {
+      PartialTensorShape::BuildPartialTensorShape(shape->shape(),
+                                                  &shapes[it->second])
+          .IgnoreError();
+    }
+  }
+  return shapes;
+}
+
+// Sets the "_output_shapes" attr of the `_Arg` nodes of `graph` whose feed
+// has a fully defined shape in `feed_shapes`, so that shape inference can see
+// through them.
+Status AnnotateArgShapes(const std::vector<PartialTensorShape>& feed_shapes,
+                         Graph* graph) {
+  for (Node* node : graph->op_nodes()) {
+    if (!node->IsArg()) continue;
+    int index;
+    TF_RETURN_IF_ERROR(GetNodeAttr(node->attrs(), "index", &index));
+    if (static_cast<size_t>(index) < feed_shapes.size() &&
+        feed_shapes[index].IsFullyDefined()) {
+      node->AddAttr("_output_shapes",
+                    std::vector<PartialTensorShape>{feed_shapes[index]});
+    }
+  }
+  return absl::OkStatus();
+}
+
 }  // namespace
 
 class DirectSessionFactory : public SessionFactory {
@@ -1378,6 +1423,17 @@ Status DirectSession::CreateExecutors(
         return absl::OkStatus();
       }}));
 
+  // Memory is planned from the shapes of the fed placeholders, which only
+  // reach the partitions through the function calling convention.
+  const bool plan_memory =
+      callable_options.plan_memory() && !run_state_args->is_partial_run;
+  std::vector<PartialTensorShape> feed_shapes;
+  if (plan_memory) {
+    mutex_lock l(graph_state_lock_);
+    feed_shapes = FeedShapes(*execution_state_->original_graph_def(),
+                             callable_options);
+  }
+
   GraphOptimizer optimizer(optimizer_opts);
   for (auto iter = graphs.begin(); iter != graphs.end(); ++iter) {
     const string& partition_name = iter->first;
@@ -1438,6 +1494,19 @@ Status DirectSession::CreateExecutors(
                                          device->name(),
                                          partition_graph.get()));
 
+    if (plan_memory && device->device_type() == DEVICE_CPU) {
+      TF_RETURN_IF_ERROR(
+          AnnotateArgShapes(feed_shapes, partition_graph.get()));
+      auto memory_plan = std::make_shared<MemoryPlan>();
+      Status s = PlanMemory(*partition_graph, memory_plan.get());
+      if (s.ok()) {
+        params.memory_plan = std::move(memory_plan);
+      } else {
+        LOG(WARNING) << "Not planning memory of the partition on "
+                     << partition_name << ": " << s;
+      }
+    }
+
     item->executor = nullptr;
     item->device = device;
     auto executor_type = options_.config.experimental().executor_type();
@@ -46,6 +46,7 @@ limitations under the License.
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/stacktrace.h"
@@ -549,6 +550,55 @@ TEST_F(DirectSessionMinusAXTest, TestFeed_Callable) {
   EXPECT_FLOAT_EQ(39.0, mat(1, 0));
 }
 
+TEST(DirectSessionTest, PlanMemoryCallable) {
+  Graph graph(OpRegistry::Global());
+  Tensor a_tensor(DT_FLOAT, TensorShape({2, 2}));
+  test::FillValues<float>(&a_tensor, {1, 2, 3, 4});
+  Node* a = test::graph::Constant(&graph, a_tensor);
+  Node* x;
+  TF_ASSERT_OK(NodeBuilder("x", "Placeholder")
+                   .Attr("dtype", DT_FLOAT)
+                   .Attr("shape", TensorShape({2, 1}))
+                   .Finalize(&graph, &x));
+  // z = -(A * (-(A * x) + -(A * x)))
+  Node* y = test::graph::Matmul(&graph, a, x, false, false);
+  Node* y_neg = test::graph::Unary(&graph, "Neg", y);
+  Node* y_neg2 = test::graph::Unary(&graph, "Neg", y);
+  Node* s = test::graph::Binary(&graph, "Add", y_neg, y_neg2);
+  Node* t = test::graph::Matmul(&graph, a, s, false, false);
+  // Neg forwards the buffer of `t` to the fetched output, so `t` must not be
+  // planned.
+  Node* z = test::graph::Unary(&graph, "Neg", t);
+  GraphDef def;
+  graph.ToGraphDef(&def);
+
+  auto session = CreateSession();
+  ASSERT_TRUE(session != nullptr);
+  TF_ASSERT_OK(session->Create(def));
+
+  CallableOptions callable_options =
+      MakeCallableOptions({"x:0"}, {z->name() + ":0"}, {});
+  callable_options.set_plan_memory(true);
+  Session::CallableHandle handle;
+  TF_ASSERT_OK(session->MakeCallable(callable_options, &handle));
+
+  monitoring::testing::CellReader<int64_t> step_buffers(
+      "/tensorflow/core/planned_step_buffers");
+  for (int i = 0; i < 3; ++i) {
+    Tensor x_tensor(DT_FLOAT, TensorShape({2, 1}));
+    test::FillValues<float>(&x_tensor, {5.0f + i, 6});
+    std::vector<Tensor> outputs;
+    TF_ASSERT_OK(session->RunCallable(handle, {x_tensor}, &outputs, nullptr));
+    ASSERT_EQ(1, outputs.size());
+    auto mat = outputs[0].matrix<float>();
+    EXPECT_FLOAT_EQ(2 * (95.0 + 7 * i), mat(0, 0));
+    EXPECT_FLOAT_EQ(2 * (207.0 + 15 * i), mat(1, 0));
+  }
+  // The buffer of the first step is reused by the others.
+  EXPECT_EQ(step_buffers.Delta(), 1);
+  TF_ASSERT_OK(session->ReleaseCallable(handle));
+}
+
 TEST_F(DirectSessionMinusAXTest, TestConcurrency) {
   Initialize({1, 2, 3, 4});
   auto session = CreateSession();
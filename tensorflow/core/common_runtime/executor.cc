@@ -18,9 +18,11 @@ limitations under the License.
 #include <algorithm>
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_join.h"
 #include "absl/time/time.h"
@@ -31,11 +33,15 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor_factory.h"
 #include "tensorflow/core/common_runtime/graph_view.h"
 #include "tensorflow/core/common_runtime/immutable_executor_state.h"
+#include "tensorflow/core/common_runtime/memory_plan.h"
 #include "tensorflow/core/common_runtime/pending_counts.h"
+#include "tensorflow/core/common_runtime/priority_ready_queue.h"
 #include "tensorflow/core/common_runtime/propagator_state.h"
 #include "tensorflow/core/common_runtime/renamed_device.h"
 #include "tensorflow/core/common_runtime/simple_propagator_state.h"
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
 #include "tensorflow/core/common_runtime/step_stats_collector.h"
+#include "tensorflow/core/common_runtime/work_stealing_queue.h"
 #include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/collective.h"
@@ -79,6 +85,7 @@ limitations under the License.
 #include "tensorflow/core/profiler/lib/traceme_encode.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tensorflow/core/util/determinism.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/managed_stack_trace.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
 #include "tsl/platform/tracing.h"
@@ -152,6 +159,15 @@ class ExecutorImpl : public Executor {
   Status Initialize(const Graph& graph) {
     TF_RETURN_IF_ERROR(immutable_state_.Initialize(graph));
     kernel_stats_.Initialize(immutable_state_.graph_view());
+    TF_RETURN_IF_ERROR(MaybeCreateStepArenaPool());
+    MaybeCreatePlannedMemoryPool();
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar(
+        "TF_EXECUTOR_WORK_STEALING_MAX_WORKERS", /*default_val=*/0,
+        &work_stealing_max_workers_));
+    TF_RETURN_IF_ERROR(ReadBoolFromEnvVar(
+        "TF_EXECUTOR_CRITICAL_PATH_PRIORITIES", /*default_val=*/false,
+        &use_node_priorities_));
+    if (use_node_priorities_) UpdateNodePriorities();
     return absl::OkStatus();
   }
 
@@ -193,6 +209,14 @@ class ExecutorImpl : public Executor {
       return is_expensive_[node.node_id];
     }
 
+    // Returns the estimated cost of the given node in cycles. Only kernels
+    // with an expensive marker are timed, so the others are assumed to cost
+    // as much as the most expensive kernel that is still inexpensive.
+    uint64 CostEstimate(const NodeItem& node) const {
+      if (!is_expensive_[node.node_id]) return kOpIsExpensiveThresholdCycles;
+      return cost_estimates_[node.node_id].load(std::memory_order_relaxed);
+    }
+
     // Updates the dynamic cost estimate, which is used to determine whether the
     // given node is expensive. The new cost estimate is a weighted average of
     // the old cost estimate and the latest cost. We only update cost estimates
@@ -223,8 +247,79 @@ class ExecutorImpl : public Executor {
     std::unique_ptr<std::atomic_uint_fast64_t[]> cost_estimates_;
   };
 
+  // Creates `step_arena_pool_` if TF_EXECUTOR_STEP_ARENA_MAX_MB is set and the
+  // device is a CPU. Temporaries of the kernels in `NodeItem::uses_step_arena`
+  // are then allocated from a per-step arena of at most that size.
+  Status MaybeCreateStepArenaPool() {
+    int64_t max_block_mb = 0;
+    TF_RETURN_IF_ERROR(ReadInt64FromEnvVar("TF_EXECUTOR_STEP_ARENA_MAX_MB",
+                                           /*default_val=*/0, &max_block_mb));
+    Device* device = immutable_state_.params().device;
+    if (max_block_mb <= 0 || device->device_type() != DEVICE_CPU) {
+      return absl::OkStatus();
+    }
+    step_arena_pool_ = std::make_unique<StepArenaPool>(
+        device->GetAllocator(AllocatorAttributes()), max_block_mb << 20);
+    VLOG(1) << "Using step arenas of up to " << max_block_mb << " MB on "
+            << device->name();
+    return absl::OkStatus();
+  }
+
+  // Creates `planned_memory_pool_` if the executor was given a memory plan and
+  // the device is a CPU.
+  void MaybeCreatePlannedMemoryPool() {
+    const LocalExecutorParams& params = immutable_state_.params();
+    if (params.memory_plan == nullptr ||
+        params.memory_plan->allocations.empty() ||
+        params.device->device_type() != DEVICE_CPU) {
+      return;
+    }
+    planned_memory_pool_ = std::make_unique<PlannedMemoryPool>(
+        params.device->GetAllocator(AllocatorAttributes()),
+        *params.memory_plan);
+    VLOG(1) << "Using a " << params.memory_plan->total_bytes
+            << " byte memory plan on " << params.device->name();
+  }
+
+  // Returns the critical-path priorities of the nodes for a new step, or null
+  // if TF_EXECUTOR_CRITICAL_PATH_PRIORITIES is not set. The priorities are
+  // recomputed a few times during the first steps, as the cost estimates in
+  // `kernel_stats_` converge.
+  std::shared_ptr<const std::vector<int64_t>> NodePrioritiesForStep() {
+    if (!use_node_priorities_) return nullptr;
+    static constexpr int64_t kUpdateSteps[] = {10, 100, 1000, 10000};
+    const int64_t step = num_steps_.fetch_add(1, std::memory_order_relaxed);
+    if (absl::c_linear_search(kUpdateSteps, step)) UpdateNodePriorities();
+    tf_shared_lock l(node_priorities_mu_);
+    return node_priorities_;
+  }
+
+  void UpdateNodePriorities() {
+    auto node_priorities = std::make_shared<const std::vector<int64_t>>(
+        ComputeCriticalPathPriorities(
+            immutable_state_.graph_view(), [this](const NodeItem& item) {
+              return static_cast<int64_t>(kernel_stats_.CostEstimate(item));
+            }));
+    mutex_lock l(node_priorities_mu_);
+    node_priorities_ = std::move(node_priorities);
+  }
+
   ImmutableExecutorState immutable_state_;
   KernelStats kernel_stats_;
+  // Null unless step arenas are enabled.
+  std::unique_ptr<StepArenaPool> step_arena_pool_;
+  // Null unless the executor has a memory plan.
+  std::unique_ptr<PlannedMemoryPool> planned_memory_pool_;
+  // If positive, steps run their nodes on up to this many work-stealing
+  // workers. See `ExecutorState::ScheduleReady`.
+  int64_t work_stealing_max_workers_ = 0;
+  // If true, steps run the ready nodes with the longest estimated paths to a
+  // sink first. See `PriorityReadyQueue`.
+  bool use_node_priorities_ = false;
+  std::atomic<int64_t> num_steps_{0};
+  mutex node_priorities_mu_;
+  std::shared_ptr<const std::vector<int64_t>> node_priorities_
+      TF_GUARDED_BY(node_priorities_mu_);
 
   ExecutorImpl(const ExecutorImpl&) = delete;
   void operator=(const ExecutorImpl&) = delete;
@@ -284,7 +379,11 @@ class ExecutorState {
  public:
   ExecutorState(const Executor::Args& args,
                 const ImmutableExecutorState& immutable_state_,
-                ExecutorImpl::KernelStats* kernel_stats_);
+                ExecutorImpl::KernelStats* kernel_stats_,
+                StepArenaPool* step_arena_pool,
+                PlannedMemoryPool* planned_memory_pool,
+                int work_stealing_max_workers,
+                std::shared_ptr<const std::vector<int64_t>> node_priorities);
   ~ExecutorState();
 
   void RunAsync(Executor::DoneCallback done);
@@ -292,17 +391,48 @@ class ExecutorState {
  private:
   // Use `TaggedNode` types defined by `PropagatorStateType`.
   typedef typename PropagatorStateType::TaggedNode TaggedNode;
-  typedef
-      typename PropagatorStateType::TaggedNodeReadyQueue TaggedNodeReadyQueue;
+  // Dequeues the nodes with the highest critical-path priorities first if
+  // `node_priorities_` is set, and in the order of the propagator otherwise.
+  typedef PriorityReadyQueue<
+      TaggedNode, typename PropagatorStateType::TaggedNodeReadyQueue>
+      TaggedNodeReadyQueue;
   typedef typename PropagatorStateType::TaggedNodeSeq TaggedNodeSeq;
+  typedef WorkStealingQueue<TaggedNode> WorkerQueue;
+  typedef WorkStealingScheduler<TaggedNode> WorkerScheduler;
 
   struct AsyncState;
 
   // Process a ready node in current thread.
   void Process(const TaggedNode& node, int64_t scheduled_nsec);
 
+  // Processes the nodes in `inline_ready`, and the nodes they make ready. If
+  // work stealing is enabled, the calling thread is a worker until it runs
+  // out of nodes to run or steal, and `reserved_worker` tells whether it was
+  // reserved with `WorkerScheduler::TryReserveWorker`.
   void ProcessInline(TaggedNodeReadyQueue* inline_ready,
-                     int64_t scheduled_nsec);
+                     int64_t scheduled_nsec, bool reserved_worker = false);
+
+  // Moves the next node of a worker to `inline_ready`: the newest node in its
+  // queue, or else a node stolen from another worker. Returns false if there
+  // is none. Does not access the `ExecutorState`, which may have been deleted
+  // by another worker when there is no node left.
+  static bool TakeWorkerNode(WorkerScheduler* scheduler, WorkerQueue* queue,
+                             TaggedNodeReadyQueue* inline_ready);
+
+  // Returns the critical-path priorities of the nodes, indexed by node id, or
+  // null if the ready nodes are not ordered by priority.
+  const int64_t* NodePriorities() const {
+    return node_priorities_ != nullptr ? node_priorities_->data() : nullptr;
+  }
+
+  // Returns true if `a` has a lower critical-path priority than `b`. Always
+  // false if the ready nodes are not ordered by priority.
+  bool HasLowerPriority(const TaggedNode& a, const TaggedNode& b) const {
+    const int64_t* priorities = NodePriorities();
+    return priorities != nullptr &&
+           priorities[a.get_node_item().node_id] <
+               priorities[b.get_node_item().node_id];
+  }
 
   Status ProcessSync(const NodeItem& item, OpKernelContext::Params* params,
                      EntryVector* outputs, NodeExecStatsInterface* stats);
@@ -330,15 +460,26 @@ class ExecutorState {
   // This method will clear `*ready` before returning.
   bool NodeDone(const Status& s, TaggedNodeSeq* ready,
                 NodeExecStatsInterface* stats,
-                TaggedNodeReadyQueue* inline_ready);
+                TaggedNodeReadyQueue* inline_ready,
+                WorkerQueue* worker_queue = nullptr);
 
   // Schedule all the expensive nodes in '*ready', and put all the inexpensive
   // nodes in 'ready' into 'inline_ready'.
   //
+  // If the nodes have critical-path priorities, the expensive node with the
+  // highest priority is put into `inline_ready` instead when it is more
+  // critical than all the nodes already there.
+  //
+  // If `worker_queue` is not null, the calling thread is a work-stealing
+  // worker, and all the nodes in `*ready` are queued on `worker_queue`
+  // instead. Another worker is started if an expensive node is queued and
+  // there is room for one.
+  //
   // This method will clear `*ready` before returning.
   //
   // REQUIRES: `!ready->empty()`.
-  void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready);
+  void ScheduleReady(TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready,
+                     WorkerQueue* worker_queue = nullptr);
 
   // A wrapper for runner_ to keep track of the pending queue length. Op
   // execution should dispatch work using this function instead of using runner_
@@ -390,6 +531,19 @@ class ExecutorState {
   CallFrameInterface* call_frame_;
   const ImmutableExecutorState& immutable_state_;
   ExecutorImpl::KernelStats* const kernel_stats_;
+  // Arena for the temporaries of this step, if enabled. Returned to
+  // `step_arena_pool_` on destruction.
+  StepArenaPool* const step_arena_pool_;
+  StepArenaAllocator* step_arena_ = nullptr;
+  // Buffer for the planned outputs of this step, if any. Returned to
+  // `planned_memory_pool_` on destruction.
+  PlannedMemoryPool* const planned_memory_pool_;
+  PlannedStepMemory* planned_memory_ = nullptr;
+  // Null unless work stealing is enabled. Shared with the workers, which may
+  // still look for work to steal after another worker finished the step.
+  std::shared_ptr<WorkerScheduler> work_stealing_;
+  // Null unless the ready nodes are ordered by critical-path priority.
+  const std::shared_ptr<const std::vector<int64_t>> node_priorities_;
   CancellationManager* cancellation_manager_;
   tsl::CoordinationServiceAgent* coordination_service_agent_;
   absl::optional<ManagedStackTrace> stack_trace_ = absl::nullopt;
@@ -419,7 +573,9 @@ class ExecutorState {
 template <class PropagatorStateType>
 ExecutorState<PropagatorStateType>::ExecutorState(
     const Executor::Args& args, const ImmutableExecutorState& immutable_state,
-    ExecutorImpl::KernelStats* kernel_stats)
+    ExecutorImpl::KernelStats* kernel_stats, StepArenaPool* step_arena_pool,
+    PlannedMemoryPool* planned_memory_pool, int work_stealing_max_workers,
+    std::shared_ptr<const std::vector<int64_t>> node_priorities)
     : vlog_(VLOG_IS_ON(1)),
       log_memory_(LogMemory::IsEnabled()),
       step_id_(args.step_id),
@@ -442,6 +598,9 @@ ExecutorState<PropagatorStateType>::ExecutorState(
       call_frame_(args.call_frame),
       immutable_state_(immutable_state),
       kernel_stats_(kernel_stats),
+      step_arena_pool_(step_arena_pool),
+      planned_memory_pool_(planned_memory_pool),
+      node_priorities_(std::move(node_priorities)),
       cancellation_manager_(args.cancellation_manager),
       coordination_service_agent_(args.coordination_service_agent),
       stack_trace_(args.stack_trace),
@@ -455,6 +614,16 @@ ExecutorState<PropagatorStateType>::ExecutorState(
     user_device_ = RenamedDevice::NewRenamedDevice(
         device->name(), device, false, false, args.user_intra_op_threadpool);
   }
+  if (step_arena_pool_ != nullptr) {
+    step_arena_ = step_arena_pool_->BeginStep();
+  }
+  if (planned_memory_pool_ != nullptr) {
+    planned_memory_ = planned_memory_pool_->BeginStep();
+  }
+  if (work_stealing_max_workers > 0 && !run_all_kernels_inline_) {
+    work_stealing_ =
+        std::make_shared<WorkerScheduler>(work_stealing_max_workers);
+  }
 }
 
 template <class PropagatorStateType>
@@ -463,6 +632,12 @@ ExecutorState<PropagatorStateType>::~ExecutorState() {
     device_context_->Unref();
   }
   delete slice_reader_cache_;
+  if (step_arena_ != nullptr) {
+    step_arena_pool_->EndStep(step_arena_);
+  }
+  if (planned_memory_ != nullptr) {
+    planned_memory_pool_->EndStep(planned_memory_);
+  }
 }
 
 template <class PropagatorStateType>
@@ -731,15 +906,38 @@ void ExecutorState<PropagatorStateType>::Process(const TaggedNode& tagged_node,
                                                  int64_t scheduled_nsec) {
   tsl::profiler::TraceMe traceme("ExecutorState::Process Scheduled",
                                  tsl::profiler::TraceMeLevel::kVerbose);
-  TaggedNodeReadyQueue inline_ready;
+  TaggedNodeReadyQueue inline_ready(NodePriorities());
   inline_ready.push_back(tagged_node);
   return ProcessInline(&inline_ready, scheduled_nsec);
 }
 
+template <class PropagatorStateType>
+bool ExecutorState<PropagatorStateType>::TakeWorkerNode(
+    WorkerScheduler* scheduler, WorkerQueue* queue,
+    TaggedNodeReadyQueue* inline_ready) {
+  std::optional<TaggedNode> tagged_node = queue->PopBack();
+  if (!tagged_node.has_value()) {
+    tagged_node = scheduler->Steal(queue);
+    if (!tagged_node.has_value()) return false;
+  }
+  inline_ready->push_back(*tagged_node);
+  return true;
+}
+
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ProcessInline(
-    TaggedNodeReadyQueue* inline_ready, int64_t scheduled_nsec) {
+    TaggedNodeReadyQueue* inline_ready, int64_t scheduled_nsec,
+    bool reserved_worker) {
   WithContext wc(context_);
+  // Copied, so that it outlives this `ExecutorState` if another worker
+  // finishes the step while this one is still looking for work.
+  const std::shared_ptr<WorkerScheduler> scheduler = work_stealing_;
+  WorkerQueue local_queue;
+  WorkerQueue* const worker_queue =
+      scheduler != nullptr ? &local_queue : nullptr;
+  if (scheduler != nullptr) {
+    scheduler->AddWorker(worker_queue, reserved_worker);
+  }
   auto ready = std::make_unique<TaggedNodeSeq>();
 
   // Parameters passed to OpKernel::Compute.
@@ -808,7 +1006,9 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
   bool completed = false;
   int64_t last_iter_num = -1;
   std::unique_ptr<profiler::TraceMeConsumer> iteration_scope;
-  while (!inline_ready->empty()) {
+  while (!inline_ready->empty() ||
+         (scheduler != nullptr &&
+          TakeWorkerNode(scheduler.get(), worker_queue, inline_ready))) {
     TaggedNode tagged_node = inline_ready->front();
 
     int64_t current_iter_num = tagged_node.get_iter_num();
@@ -907,7 +1107,7 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
         propagator_.MaybeMarkCompleted(tagged_node);
         activity_watcher::ActivityEnd(activity_id);
         // Continue to process the nodes in 'inline_ready'.
-        completed = NodeDone(s, ready.get(), stats, inline_ready);
+        completed = NodeDone(s, ready.get(), stats, inline_ready, worker_queue);
         continue;
       }
 
@@ -920,6 +1120,12 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
       params->outputs_required_array = item.outputs_required.get();
       params->inputs = *inputs;
       params->input_alloc_attrs = input_alloc_attrs;
+      params->step_arena_allocator =
+          item.uses_step_arena ? step_arena_ : nullptr;
+      params->planned_output_allocators =
+          planned_memory_ != nullptr
+              ? planned_memory_->output_allocators(item.node_id)
+              : nullptr;
 
       if (item.kernel_is_async) {
         ProcessAsync(item, *params, tagged_node, first_input, stats,
@@ -961,10 +1167,13 @@ void ExecutorState<PropagatorStateType>::ProcessInline(
         scheduled_nsec = nodestats::NowInNsec();
       }
       // Postprocess.
-      completed = NodeDone(s, ready.get(), stats, inline_ready);
+      completed = NodeDone(s, ready.get(), stats, inline_ready, worker_queue);
     }
   }  // while !inline_ready.empty()
 
+  if (scheduler != nullptr) {
+    scheduler->RemoveWorker(worker_queue);
+  }
   // This thread of computation is done if completed = true.
   if (completed) ScheduleFinish();
 }
@@ -1187,7 +1396,7 @@ Status ExecutorState<PropagatorStateType>::ProcessOutputs(
 template <class PropagatorStateType>
 bool ExecutorState<PropagatorStateType>::NodeDone(
     const Status& s, TaggedNodeSeq* ready, NodeExecStatsInterface* stats,
-    TaggedNodeReadyQueue* inline_ready) {
+    TaggedNodeReadyQueue* inline_ready, WorkerQueue* worker_queue) {
   if (stats) {
     nodestats::SetAllEnd(stats);
     DCHECK_NE(stats_collector_, nullptr);
@@ -1206,7 +1415,7 @@ bool ExecutorState<PropagatorStateType>::NodeDone(
       }
 
       // Schedule the ready nodes in 'ready'.
-      ScheduleReady(ready, inline_ready);
+      ScheduleReady(ready, inline_ready, worker_queue);
 
       return false;
     }
@@ -1265,7 +1474,8 @@ bool ExecutorState<PropagatorStateType>::NodeDone(
 
 template <class PropagatorStateType>
 void ExecutorState<PropagatorStateType>::ScheduleReady(
-    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready) {
+    TaggedNodeSeq* ready, TaggedNodeReadyQueue* inline_ready,
+    WorkerQueue* worker_queue) {
   tsl::profiler::TraceMe activity(
       [&]() {
         return strings::StrCat(
@@ -1298,6 +1508,39 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         inline_ready->push_back(tagged_node);
       }
     }
+  } else if (worker_queue != nullptr) {
+    // Queue the nodes in reverse, so that this worker runs the first one next,
+    // and other workers steal the last ones. With priorities, that is the
+    // most critical one, and the least critical ones are stolen.
+    if (NodePriorities() != nullptr) {
+      std::stable_sort(ready->begin(), ready->end(),
+                       [this](const TaggedNode& a, const TaggedNode& b) {
+                         return HasLowerPriority(b, a);
+                       });
+    }
+    bool queued_expensive_node = false;
+    for (auto it = ready->rbegin(); it != ready->rend(); ++it) {
+      worker_queue->PushBack(*it);
+      queued_expensive_node |=
+          !it->get_is_dead() && kernel_stats_->IsExpensive(*it->node_item);
+    }
+    // Start a worker to steal from this one if it has more than its next node
+    // queued, and some of it is worth running on another thread.
+    if (queued_expensive_node && worker_queue->size() > 1 &&
+        work_stealing_->TryReserveWorker()) {
+      RunTask([this, scheduler = work_stealing_, scheduled_nsec]() {
+        std::optional<TaggedNode> tagged_node = scheduler->Steal(nullptr);
+        if (!tagged_node.has_value()) {
+          // The step may be done, so this `ExecutorState` may be deleted.
+          scheduler->CancelReservation();
+          return;
+        }
+        // The stolen node is outstanding, so the step is still running.
+        TaggedNodeReadyQueue inline_ready(NodePriorities());
+        inline_ready.push_back(*tagged_node);
+        ProcessInline(&inline_ready, scheduled_nsec, /*reserved_worker=*/true);
+      });
+    }
   } else {
     const TaggedNode* curr_expensive_node = nullptr;
     TaggedNodeSeq expensive_nodes;
@@ -1313,16 +1556,23 @@ void ExecutorState<PropagatorStateType>::ScheduleReady(
         if (tagged_node.get_is_dead() || !kernel_stats_->IsExpensive(item)) {
           // Inline this inexpensive node.
           inline_ready->push_back(tagged_node);
-        } else {
+        } else if (curr_expensive_node == nullptr ||
+                   !HasLowerPriority(tagged_node, *curr_expensive_node)) {
           if (curr_expensive_node) {
             expensive_nodes.push_back(*curr_expensive_node);
           }
           curr_expensive_node = &tagged_node;
+        } else {
+          // Keep the most critical expensive node as a candidate to inline.
+          expensive_nodes.push_back(tagged_node);
         }
       }
     }
     if (curr_expensive_node) {
-      if (inline_ready->empty()) {
+      if (inline_ready->empty() ||
+          HasLowerPriority(inline_ready->front(), *curr_expensive_node)) {
+        // Nothing more critical is queued to run inline, so this thread runs
+        // the expensive node next rather than waiting for another thread.
         inline_ready->push_back(*curr_expensive_node);
       } else {
         // There are inline nodes to run already. We dispatch this expensive
@@ -1513,15 +1763,24 @@ void ExecutorState<PropagatorStateType>::Finish() {
 
 void ExecutorImpl::RunAsyncInternal(const Args& args, DoneCallback done) {
   if (OpOrderDeterminismRequired()) {
-    (new ExecutorState<OrderedPropagatorState>(args, immutable_state_,
-                                               &kernel_stats_))
+    // Nodes must run in a deterministic order, so work stealing and priority
+    // scheduling are off.
+    (new ExecutorState<OrderedPropagatorState>(
+         args, immutable_state_, &kernel_stats_, step_arena_pool_.get(),
+         planned_memory_pool_.get(), /*work_stealing_max_workers=*/0,
+         /*node_priorities=*/nullptr))
         ->RunAsync(std::move(done));
   } else if (immutable_state_.requires_control_flow_support()) {
-    (new ExecutorState<PropagatorState>(args, immutable_state_, &kernel_stats_))
+    (new ExecutorState<PropagatorState>(
+         args, immutable_state_, &kernel_stats_, step_arena_pool_.get(),
+         planned_memory_pool_.get(), work_stealing_max_workers_,
+         NodePrioritiesForStep()))
         ->RunAsync(std::move(done));
   } else {
-    (new ExecutorState<SimplePropagatorState>(args, immutable_state_,
-                                              &kernel_stats_))
+    (new ExecutorState<SimplePropagatorState>(
+         args, immutable_state_, &kernel_stats_, step_arena_pool_.get(),
+         planned_memory_pool_.get(), work_stealing_max_workers_,
+         NodePrioritiesForStep()))
         ->RunAsync(std::move(done));
   }
 }
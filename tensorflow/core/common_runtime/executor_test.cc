@@ -16,6 +16,9 @@ limitations under the License.
 #include "tensorflow/core/common_runtime/executor.h"
 
 #include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <vector>
 
 #include "tensorflow/cc/framework/ops.h"
 #include "tensorflow/cc/ops/array_ops.h"
@@ -40,8 +43,11 @@ limitations under the License.
 #include "tensorflow/core/graph/algorithm.h"
 #include "tensorflow/core/graph/testlib.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
 #include "tensorflow/core/lib/strings/strcat.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/test.h"
@@ -265,6 +271,45 @@ TEST_F(ExecutorTest, RandomTree) {
   EXPECT_EQ(4096.0, V(out));
 }
 
+TEST_F(ExecutorTest, RandomTreeWithWorkStealing) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  setenv("TF_EXECUTOR_WORK_STEALING_MAX_WORKERS", "4", /*overwrite=*/1);
+  Create(std::move(g));
+  unsetenv("TF_EXECUTOR_WORK_STEALING_MAX_WORKERS");
+  for (int iters = 0; iters < 8; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
+TEST_F(ExecutorTest, RandomTreeWithCriticalPathPriorities) {
+  auto g = std::make_unique<Graph>(OpRegistry::Global());
+  BuildTree(4096, g.get());
+  setenv("TF_EXECUTOR_CRITICAL_PATH_PRIORITIES", "true", /*overwrite=*/1);
+  Create(std::move(g));
+  unsetenv("TF_EXECUTOR_CRITICAL_PATH_PRIORITIES");
+  // Runs enough steps for the priorities to be recomputed once.
+  for (int iters = 0; iters < 16; ++iters) {
+    Rendezvous::Args args;
+    TF_ASSERT_OK(rendez_->Send(Key(ALICE, kIncarnation, BOB, "a"), args,
+                               V(1.0), false));
+    TF_ASSERT_OK(Run(rendez_));
+    Tensor out = V(-1);
+    bool is_dead = false;
+    TF_ASSERT_OK(rendez_->Recv(Key(BOB, kIncarnation, ALICE, "b"), args, &out,
+                               &is_dead));
+    EXPECT_EQ(4096.0, V(out));
+  }
+}
+
 void BuildConcurrentAddAssign(Graph* g) {
   auto one = test::graph::Constant(g, V(1.0));
   // A variable holds one float.
@@ -493,6 +538,137 @@ BENCHMARK(BM_executor)->UseRealTime()->ArgPair(8192, 32);
 // Tall fat graph
 BENCHMARK(BM_executor)->UseRealTime()->ArgPair(1024, 1024);
 
+// Create a graph of 'width' independent chains of 'depth' 64x64 MatMuls. With
+// work stealing, each step runs on up to one worker per CPU, and the chains
+// stay on the worker that started them unless another one is idle.
+static void BM_executor_matmul_chains(::testing::benchmark::State& state) {
+  const int width = state.range(0);
+  const int depth = state.range(1);
+  const bool work_stealing = state.range(2) != 0;
+
+  Graph* g = new Graph(OpRegistry::Global());
+  Tensor m(DT_FLOAT, TensorShape({64, 64}));
+  m.flat<float>().setConstant(1.0f / 64);
+  Node* rhs = test::graph::Constant(g, m);
+  for (int i = 0; i < width; ++i) {
+    Node* n = test::graph::Constant(g, m);
+    for (int j = 0; j < depth; ++j) {
+      n = test::graph::Matmul(g, n, rhs, false, false);
+    }
+  }
+  FixupSourceAndSinkEdges(g);
+
+  const string max_workers =
+      work_stealing ? strings::StrCat(port::MaxParallelism()) : "0";
+  setenv("TF_EXECUTOR_WORK_STEALING_MAX_WORKERS", max_workers.c_str(),
+         /*overwrite=*/1);
+  test::Benchmark("cpu", g, /*old_benchmark_api=*/false).Run(state);
+  unsetenv("TF_EXECUTOR_WORK_STEALING_MAX_WORKERS");
+
+  state.SetLabel(strings::StrCat("Nodes = ", width * (depth + 1) + 1,
+                                 work_stealing ? ", work stealing" : ""));
+  state.SetItemsProcessed(width * depth *
+                          static_cast<int64_t>(state.iterations()));
+}
+
+// Wide graphs
+BENCHMARK(BM_executor_matmul_chains)
+    ->UseRealTime()
+    ->Args({256, 4, 0})
+    ->Args({256, 4, 1});
+
+// Deep graphs
+BENCHMARK(BM_executor_matmul_chains)
+    ->UseRealTime()
+    ->Args({4, 256, 0})
+    ->Args({4, 256, 1});
+
+// Wide and deep graphs
+BENCHMARK(BM_executor_matmul_chains)
+    ->UseRealTime()
+    ->Args({64, 64, 0})
+    ->Args({64, 64, 1});
+
+// Create a graph with a chain of 'depth' 64x64 MatMuls, where each MatMul in
+// the chain also feeds 'branches' MatMuls off the critical path, as logging or
+// metrics branches would. Runs one step at a time on 'threads' threads, and
+// reports the p50 and p99 step latencies with and without critical-path
+// priorities.
+static void BM_executor_critical_path_latency(
+    ::testing::benchmark::State& state) {
+  const int depth = state.range(0);
+  const int branches = state.range(1);
+  const int threads = state.range(2);
+  const bool priorities = state.range(3) != 0;
+
+  Graph g(OpRegistry::Global());
+  Tensor m(DT_FLOAT, TensorShape({64, 64}));
+  m.flat<float>().setConstant(1.0f / 64);
+  Node* rhs = test::graph::Constant(&g, m);
+  Node* n = test::graph::Constant(&g, m);
+  for (int i = 0; i < depth; ++i) {
+    Node* next = test::graph::Matmul(&g, n, rhs, false, false);
+    for (int j = 0; j < branches; ++j) {
+      test::graph::Matmul(&g, n, rhs, false, false);
+    }
+    n = next;
+  }
+  FixupSourceAndSinkEdges(&g);
+
+  std::unique_ptr<Device> device(DeviceFactory::NewDevice(
+      "CPU", {}, "/job:localhost/replica:0/task:0"));
+  const int version = g.versions().producer();
+  LocalExecutorParams params;
+  params.device = device.get();
+  params.create_kernel =
+      [&device, version](const std::shared_ptr<const NodeProperties>& props,
+                         OpKernel** kernel) {
+        return CreateNonCachedKernel(device.get(), nullptr, props, version,
+                                     kernel);
+      };
+  params.delete_kernel = [](OpKernel* kernel) {
+    DeleteNonCachedKernel(kernel);
+  };
+  setenv("TF_EXECUTOR_CRITICAL_PATH_PRIORITIES", priorities ? "true" : "false",
+         /*overwrite=*/1);
+  Executor* exec = nullptr;
+  TF_CHECK_OK(NewLocalExecutor(params, g, &exec));
+  std::unique_ptr<Executor> exec_owner(exec);
+  unsetenv("TF_EXECUTOR_CRITICAL_PATH_PRIORITIES");
+
+  thread::ThreadPool pool(Env::Default(), "critical_path", threads);
+  Executor::Args args;
+  args.runner = [&pool](std::function<void()> fn) {
+    pool.Schedule(std::move(fn));
+  };
+  // Warm up until the cost estimates, and the priorities computed from them,
+  // have settled.
+  static const int kWarmupRuns = 128;
+  for (int i = 0; i < kWarmupRuns; ++i) {
+    TF_CHECK_OK(exec->Run(args));
+  }
+
+  std::vector<uint64> latencies_ns;
+  for (auto s : state) {
+    const uint64 start_ns = Env::Default()->NowNanos();
+    TF_CHECK_OK(exec->Run(args));
+    latencies_ns.push_back(Env::Default()->NowNanos() - start_ns);
+  }
+  std::sort(latencies_ns.begin(), latencies_ns.end());
+  state.counters["p50_step_ns"] = latencies_ns[latencies_ns.size() * 50 / 100];
+  state.counters["p99_step_ns"] = latencies_ns[latencies_ns.size() * 99 / 100];
+  state.SetLabel(strings::StrCat("Nodes = ", depth * (branches + 1) + 2,
+                                 priorities ? ", critical path" : ""));
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK(BM_executor_critical_path_latency)
+    ->UseRealTime()
+    ->Args({64, 4, 2, 0})
+    ->Args({64, 4, 2, 1})
+    ->Args({64, 4, 8, 0})
+    ->Args({64, 4, 8, 1});
+
 static void BM_const_identity(::testing::benchmark::State& state) {
   const int width = state.range(0);
   const int outputs_per_const = state.range(1);
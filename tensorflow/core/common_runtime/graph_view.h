@@ -85,6 +85,9 @@ struct NodeItem {
                                     // node's input types.
   bool is_distributed_communication : 1;  // True iff the op is registered to
                                           // use distributed communication.
+  // True iff the kernel may allocate temporaries from the step arena: it is
+  // synchronous, its op is stateless, and it is not a transfer node.
+  bool uses_step_arena : 1;
 
   // The kernel for this node.
   OpKernel* kernel = nullptr;
@@ -196,6 +196,9 @@ Status ImmutableExecutorState::Initialize(const Graph& graph) {
     item->is_recv_or_switch = IsRecv(n) || IsSwitch(n);
     item->is_next_iteration = IsNextIteration(n);
     item->is_distributed_communication = IsDistributedCommunication(n);
+    item->uses_step_arena = !item->kernel_is_async &&
+                            !n->op_def().is_stateful() &&
+                            !item->is_transfer_node;
 
     // Compute the maximum values we'll store for this node in the
     // pending counts data structure, and allocate a handle in
@@ -28,6 +28,7 @@ class SessionMetadata;
 class FunctionLibraryRuntime;
 class NodeProperties;
 class OpKernel;
+struct MemoryPlan;
 
 // LocalExecutorParams provides arguments that will be shared by all invocations
 // of an executor. We expect that different contexts would provide different
@@ -50,6 +51,10 @@ struct LocalExecutorParams {
 
   // Whether control flow nodes are allowed to be executed synchronously.
   bool allow_control_flow_sync_execution = false;
+
+  // If set, the outputs of the graph's kernels are allocated as planned. See
+  // "memory_planner.h".
+  std::shared_ptr<const MemoryPlan> memory_plan;
 };
 
 }  // end namespace tensorflow
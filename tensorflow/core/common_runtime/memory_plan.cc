@@ -0,0 +1,162 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_plan.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/lib/monitoring/counter.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+auto* planned_step_buffers = monitoring::Counter<0>::New(
+    "/tensorflow/core/planned_step_buffers",
+    "The number of step buffers allocated for memory plans.");
+
+}  // namespace
+
+// Allocates one planned output from the step's buffer.
+class PlannedStepMemory::OutputAllocator : public Allocator {
+ public:
+  OutputAllocator(PlannedStepMemory* memory, int index, size_t offset,
+                  size_t bytes)
+      : memory_(memory), index_(index), offset_(offset), bytes_(bytes) {}
+
+  std::string Name() override { return "planned_output"; }
+
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    void* ptr;
+    if (alignment <= kAllocatorAlignment && num_bytes <= bytes_ &&
+        memory_->block_ != nullptr && memory_->TryAcquire(index_)) {
+      ptr = memory_->block_ + offset_;
+    } else {
+      ptr = memory_->base_->AllocateRaw(alignment, num_bytes);
+      if (ptr == nullptr) return nullptr;
+    }
+    memory_->Ref();
+    return ptr;
+  }
+
+  void DeallocateRaw(void* ptr) override {
+    if (memory_->block_ != nullptr && ptr == memory_->block_ + offset_) {
+      memory_->Release(index_);
+    } else {
+      memory_->base_->DeallocateRaw(ptr);
+    }
+    memory_->Unref();
+  }
+
+ private:
+  PlannedStepMemory* const memory_;  // Not owned.
+  const int index_;
+  const size_t offset_;
+  const size_t bytes_;
+};
+
+PlannedStepMemory::PlannedStepMemory(const PlannedMemoryPool* pool)
+    : pool_(pool),
+      base_(pool->base_),
+      allocated_(new std::atomic<bool>[pool->plan_.allocations.size()]),
+      output_allocators_(pool->num_output_slots_, nullptr) {
+  const MemoryPlan& plan = pool->plan_;
+  block_ = static_cast<char*>(
+      base_->AllocateRaw(Allocator::kAllocatorAlignment, plan.total_bytes));
+  allocators_.reserve(plan.allocations.size());
+  for (size_t i = 0; i < plan.allocations.size(); ++i) {
+    const MemoryPlan::Allocation& allocation = plan.allocations[i];
+    allocated_[i].store(false, std::memory_order_relaxed);
+    allocators_.push_back(std::make_unique<OutputAllocator>(
+        this, i, allocation.offset, allocation.bytes));
+    output_allocators_[pool->first_output_slot_[allocation.node_id] +
+                       allocation.output] = allocators_.back().get();
+  }
+}
+
+PlannedStepMemory::~PlannedStepMemory() {
+  if (block_ != nullptr) {
+    base_->DeallocateRaw(block_);
+  }
+}
+
+bool PlannedStepMemory::TryAcquire(int index) {
+  bool expected = false;
+  if (!allocated_[index].compare_exchange_strong(expected, true)) {
+    return false;
+  }
+  // Sequentially consistent, so that of two outputs with overlapping bytes
+  // acquired concurrently, at least one sees the other.
+  for (int other : pool_->overlaps_[index]) {
+    if (allocated_[other].load()) {
+      allocated_[index].store(false);
+      return false;
+    }
+  }
+  return true;
+}
+
+void PlannedStepMemory::Release(int index) { allocated_[index].store(false); }
+
+PlannedMemoryPool::PlannedMemoryPool(Allocator* base, MemoryPlan plan)
+    : base_(base),
+      plan_(std::move(plan)),
+      overlaps_(plan_.allocations.size()) {
+  // Find the overlapping allocations by sweeping them in offset order.
+  std::vector<int> by_offset(plan_.allocations.size());
+  std::iota(by_offset.begin(), by_offset.end(), 0);
+  std::sort(by_offset.begin(), by_offset.end(), [this](int a, int b) {
+    return plan_.allocations[a].offset < plan_.allocations[b].offset;
+  });
+  for (size_t i = 0; i < by_offset.size(); ++i) {
+    const MemoryPlan::Allocation& a = plan_.allocations[by_offset[i]];
+    for (size_t j = i + 1; j < by_offset.size(); ++j) {
+      const MemoryPlan::Allocation& b = plan_.allocations[by_offset[j]];
+      if (b.offset >= a.offset + a.bytes) break;
+      overlaps_[by_offset[i]].push_back(by_offset[j]);
+      overlaps_[by_offset[j]].push_back(by_offset[i]);
+    }
+  }
+
+  for (const MemoryPlan::Allocation& allocation : plan_.allocations) {
+    if (static_cast<size_t>(allocation.node_id) >= first_output_slot_.size()) {
+      first_output_slot_.resize(allocation.node_id + 1, -1);
+    }
+    int& slot = first_output_slot_[allocation.node_id];
+    if (slot < 0) {
+      slot = num_output_slots_;
+      num_output_slots_ += allocation.num_outputs;
+    }
+  }
+}
+
+PlannedStepMemory* PlannedMemoryPool::BeginStep() {
+  return memories_.BeginStep([this] {
+    planned_step_buffers->GetCell()->IncrementBy(1);
+    return new PlannedStepMemory(this);
+  });
+}
+
+void PlannedMemoryPool::EndStep(PlannedStepMemory* memory) {
+  if (!memories_.EndStep(memory)) {
+    VLOG(2) << "Planned memory of " << plan_.total_bytes
+            << " bytes outlived its step";
+  }
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,127 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLAN_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLAN_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/step_scoped_pool.h"
+#include "tensorflow/core/framework/allocator.h"
+
+namespace tensorflow {
+
+// Offsets of node outputs in one buffer, computed ahead of time for a graph
+// (see `PlanMemory` in "memory_planner.h"). Two outputs overlap in the buffer
+// only if one of them is dead before the other is allocated in every
+// schedule of the graph.
+struct MemoryPlan {
+  struct Allocation {
+    int node_id;
+    int output;
+    // Number of outputs of the node.
+    int num_outputs;
+    size_t offset;
+    size_t bytes;
+  };
+  std::vector<Allocation> allocations;
+  // Size of the buffer.
+  size_t total_bytes = 0;
+};
+
+class PlannedStepMemory;
+
+// Hands out one buffer laid out by a `MemoryPlan` per running step, and reuses
+// the buffers across steps.
+//
+// The plan is not trusted to be respected: an output may still be referenced
+// when a later output planned at the same bytes is allocated, e.g. if a kernel
+// kept it. Each planned output therefore has a flag that is set while it is
+// allocated, and an output whose bytes are in use is allocated from the base
+// allocator instead. Allocations that are larger than planned also go to the
+// base allocator.
+//
+// Thread-safe. The base allocator must outlive the pool and every tensor
+// allocated from its buffers.
+class PlannedMemoryPool {
+ public:
+  PlannedMemoryPool(Allocator* base, MemoryPlan plan);
+
+  // See `StepScopedPool`.
+  PlannedStepMemory* BeginStep();
+  void EndStep(PlannedStepMemory* memory);
+
+  const MemoryPlan& plan() const { return plan_; }
+
+ private:
+  friend class PlannedStepMemory;
+
+  Allocator* const base_;  // Not owned.
+  const MemoryPlan plan_;
+  // For each allocation in `plan_`, the other allocations whose bytes overlap
+  // with it.
+  std::vector<std::vector<int>> overlaps_;
+  // For each node id, the index of its output 0 in
+  // `PlannedStepMemory::output_allocators_`, or -1 if none of its outputs are
+  // planned.
+  std::vector<int> first_output_slot_;
+  int num_output_slots_ = 0;
+
+  StepScopedPool<PlannedStepMemory> memories_;
+};
+
+// The buffer of one step, and an allocator for each planned output.
+class PlannedStepMemory : public StepScopedMemory {
+ public:
+  ~PlannedStepMemory() override;
+
+  // Returns the allocators for the outputs of `node_id`, indexed by output,
+  // with null entries for outputs that are not planned. Returns null if no
+  // output of `node_id` is planned.
+  Allocator* const* output_allocators(int node_id) const {
+    const int slot =
+        static_cast<size_t>(node_id) < pool_->first_output_slot_.size()
+            ? pool_->first_output_slot_[node_id]
+            : -1;
+    return slot < 0 ? nullptr : output_allocators_.data() + slot;
+  }
+
+ private:
+  friend class PlannedMemoryPool;
+  class OutputAllocator;
+
+  explicit PlannedStepMemory(const PlannedMemoryPool* pool);
+
+  // Marks allocation `index` as allocated if none of the allocations it
+  // overlaps with is.
+  bool TryAcquire(int index);
+  void Release(int index);
+
+  // Only valid while the step is running.
+  const PlannedMemoryPool* pool_;
+  Allocator* const base_;  // Not owned.
+  char* block_ = nullptr;
+  std::vector<std::unique_ptr<OutputAllocator>> allocators_;
+  std::unique_ptr<std::atomic<bool>[]> allocated_;
+  std::vector<Allocator*> output_allocators_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLAN_H_
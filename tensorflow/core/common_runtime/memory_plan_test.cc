@@ -0,0 +1,155 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_plan.h"
+
+#include <atomic>
+#include <string>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations made through it.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    ++num_deallocations_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_; }
+  int num_live() const { return num_allocations_ - num_deallocations_; }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+  std::atomic<int> num_deallocations_{0};
+};
+
+// Node 1 has two outputs, and node 3 one output that reuses the bytes of
+// output 0 of node 1.
+MemoryPlan TestPlan() {
+  MemoryPlan plan;
+  plan.allocations.push_back({/*node_id=*/1, /*output=*/0, /*num_outputs=*/2,
+                              /*offset=*/0, /*bytes=*/256});
+  plan.allocations.push_back({/*node_id=*/1, /*output=*/1, /*num_outputs=*/2,
+                              /*offset=*/256, /*bytes=*/128});
+  plan.allocations.push_back({/*node_id=*/3, /*output=*/0, /*num_outputs=*/1,
+                              /*offset=*/0, /*bytes=*/256});
+  plan.total_bytes = 384;
+  return plan;
+}
+
+TEST(PlannedMemoryPoolTest, OutputsAreAllocatedAsPlanned) {
+  CountingAllocator base;
+  PlannedMemoryPool pool(&base, TestPlan());
+  PlannedStepMemory* memory = pool.BeginStep();
+  EXPECT_EQ(base.num_allocations(), 1);
+
+  Allocator* const* node1 = memory->output_allocators(1);
+  ASSERT_NE(node1, nullptr);
+  ASSERT_NE(node1[0], nullptr);
+  ASSERT_NE(node1[1], nullptr);
+  EXPECT_EQ(memory->output_allocators(0), nullptr);
+  EXPECT_EQ(memory->output_allocators(2), nullptr);
+  EXPECT_EQ(memory->output_allocators(100), nullptr);
+  {
+    Tensor a(node1[0], DT_FLOAT, TensorShape({64}));
+    Tensor b(node1[1], DT_FLOAT, TensorShape({32}));
+    EXPECT_EQ(b.tensor_data().data(), a.tensor_data().data() + 256);
+  }
+  Tensor c(memory->output_allocators(3)[0], DT_FLOAT, TensorShape({64}));
+  EXPECT_EQ(base.num_allocations(), 1);
+  c = Tensor();
+  pool.EndStep(memory);
+
+  // The buffer is reused by the next step.
+  memory = pool.BeginStep();
+  Tensor d(memory->output_allocators(1)[0], DT_FLOAT, TensorShape({64}));
+  EXPECT_EQ(base.num_allocations(), 1);
+  d = Tensor();
+  pool.EndStep(memory);
+}
+
+TEST(PlannedMemoryPoolTest, OverlappingLiveOutputFallsBack) {
+  CountingAllocator base;
+  PlannedMemoryPool pool(&base, TestPlan());
+  PlannedStepMemory* memory = pool.BeginStep();
+  Allocator* node1 = memory->output_allocators(1)[0];
+  Allocator* node3 = memory->output_allocators(3)[0];
+
+  Tensor a(node1, DT_FLOAT, TensorShape({64}));
+  {
+    // `a` is still referenced, so `b` cannot take its bytes.
+    Tensor b(node3, DT_FLOAT, TensorShape({64}));
+    EXPECT_EQ(base.num_allocations(), 2);
+    EXPECT_NE(b.tensor_data().data(), a.tensor_data().data());
+  }
+  const char* planned = a.tensor_data().data();
+  a = Tensor();
+  Tensor c(node3, DT_FLOAT, TensorShape({64}));
+  EXPECT_EQ(c.tensor_data().data(), planned);
+  EXPECT_EQ(base.num_allocations(), 2);
+  c = Tensor();
+  pool.EndStep(memory);
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+TEST(PlannedMemoryPoolTest, LargerThanPlannedOutputFallsBack) {
+  CountingAllocator base;
+  PlannedMemoryPool pool(&base, TestPlan());
+  PlannedStepMemory* memory = pool.BeginStep();
+  Allocator* node1 = memory->output_allocators(1)[1];
+  {
+    Tensor a(node1, DT_FLOAT, TensorShape({33}));
+    EXPECT_EQ(base.num_allocations(), 2);
+  }
+  {
+    Tensor a(node1, DT_FLOAT, TensorShape({32}));
+    EXPECT_EQ(base.num_allocations(), 2);
+  }
+  pool.EndStep(memory);
+}
+
+TEST(PlannedMemoryPoolTest, MemoryOutlivingStepIsNotReused) {
+  CountingAllocator base;
+  {
+    PlannedMemoryPool pool(&base, TestPlan());
+    PlannedStepMemory* memory = pool.BeginStep();
+    Tensor kept(memory->output_allocators(3)[0], DT_FLOAT, TensorShape({64}));
+    pool.EndStep(memory);
+
+    memory = pool.BeginStep();
+    EXPECT_EQ(base.num_allocations(), 2);
+    EXPECT_EQ(base.num_live(), 2);
+    pool.EndStep(memory);
+
+    // Dropping the last tensor of the first step frees its buffer.
+    kept = Tensor();
+    EXPECT_EQ(base.num_live(), 1);
+  }
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,233 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/common_runtime/shape_refiner.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/graph/algorithm.h"
+#include "tensorflow/core/grappler/op_types.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace {
+
+using shape_inference::InferenceContext;
+using shape_inference::ShapeHandle;
+
+struct Candidate {
+  const Node* node;
+  int output;
+  size_t bytes;
+  // Ids of the nodes that may read the buffer of the output.
+  std::vector<int> consumers;
+};
+
+// Returns true if the outputs of `node` may be planned.
+bool CanPlanOutputsOf(const Node* node) {
+  return node->IsOp() && !node->IsArg() && !node->IsConstant() &&
+         !node->IsFunctionCall() && !IsTransferNode(node) &&
+         !node->op_def().is_stateful();
+}
+
+// Returns true if an output consumed by `node` may be kept past the step.
+bool KeepsInput(const Node* node) {
+  return !node->IsOp() || node->IsRetval() || node->IsSend() ||
+         node->op_def().is_stateful();
+}
+
+// Returns true if an output of `node` may share the buffer of one of its
+// inputs, because the kernel forwards the input (e.g. cwise ops) or returns
+// it or a slice of it (e.g. Identity, Reshape).
+bool MayAliasInput(const Node* node) {
+  // Listed as never forwarding, but these return slices of their input along
+  // dimension 0 when it is aligned.
+  static const auto* const kSlicingOps =
+      new absl::flat_hash_set<std::string>{"Split", "SplitV", "Unpack"};
+  return !grappler::NeverForwardsInputs(node->def()) ||
+         kSlicingOps->contains(node->type_string());
+}
+
+// Adds the ids of the nodes that may read a buffer consumed by `nodes`,
+// through any chain of consumers that alias it, to `nodes`. Returns true if
+// any of them may keep the buffer past the step.
+bool AddAliasingConsumers(const Graph& graph, std::vector<int>* nodes) {
+  std::vector<bool> visited(graph.num_node_ids(), false);
+  for (int id : *nodes) visited[id] = true;
+  bool kept = false;
+  for (size_t i = 0; i < nodes->size(); ++i) {
+    const Node* node = graph.FindNodeId((*nodes)[i]);
+    if (KeepsInput(node)) kept = true;
+    if (!node->IsOp() || !MayAliasInput(node)) continue;
+    for (const Edge* e : node->out_edges()) {
+      if (e->IsControlEdge() || visited[e->dst()->id()]) continue;
+      visited[e->dst()->id()] = true;
+      nodes->push_back(e->dst()->id());
+    }
+  }
+  return kept;
+}
+
+// For each node, the set of nodes that complete before it starts.
+class Ancestors {
+ public:
+  Ancestors(const Graph& graph, const std::vector<Node*>& order)
+      : words_per_node_((graph.num_node_ids() + 63) / 64),
+        bits_(words_per_node_ * graph.num_node_ids(), 0) {
+    for (const Node* node : order) {
+      uint64_t* bits = row(node->id());
+      for (const Edge* e : node->in_edges()) {
+        const int src = e->src()->id();
+        const uint64_t* src_bits = row(src);
+        for (int w = 0; w < words_per_node_; ++w) bits[w] |= src_bits[w];
+        bits[src / 64] |= uint64_t{1} << (src % 64);
+      }
+    }
+  }
+
+  // Returns true if `a` completes before `b` starts.
+  bool IsAncestor(int a, int b) const {
+    return (row(b)[a / 64] >> (a % 64)) & 1;
+  }
+
+ private:
+  uint64_t* row(int id) { return bits_.data() + id * words_per_node_; }
+  const uint64_t* row(int id) const {
+    return bits_.data() + id * words_per_node_;
+  }
+
+  const int words_per_node_;
+  std::vector<uint64_t> bits_;
+};
+
+// Returns true if `a` is no longer used when `b` is allocated.
+bool DeadBefore(const Candidate& a, const Candidate& b,
+                const Ancestors& ancestors) {
+  const int b_id = b.node->id();
+  if (a.consumers.empty()) {
+    return ancestors.IsAncestor(a.node->id(), b_id);
+  }
+  for (int consumer : a.consumers) {
+    if (!ancestors.IsAncestor(consumer, b_id)) return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+Status PlanMemory(const Graph& graph, MemoryPlan* plan) {
+  *plan = MemoryPlan();
+  if (graph.num_node_ids() > kMaxPlannedNodes) {
+    VLOG(1) << "Not planning memory of a graph with " << graph.num_node_ids()
+            << " nodes";
+    return absl::OkStatus();
+  }
+  for (const Node* node : graph.op_nodes()) {
+    if (node->IsControlFlow()) {
+      VLOG(1) << "Not planning memory of a graph with control flow";
+      return absl::OkStatus();
+    }
+  }
+
+  std::vector<Node*> order;
+  GetReversePostOrder(graph, &order);
+
+  ShapeRefiner refiner(graph.versions(), graph.op_registry());
+  refiner.set_require_shape_inference_fns(false);
+  for (const Node* node : order) {
+    if (node->IsOp()) {
+      TF_RETURN_IF_ERROR(refiner.AddNode(node));
+    }
+  }
+
+  std::vector<Candidate> candidates;
+  for (const Node* node : order) {
+    if (!CanPlanOutputsOf(node)) continue;
+    InferenceContext* c = refiner.GetContext(node);
+    if (c == nullptr) continue;
+
+    std::vector<std::vector<int>> consumers(node->num_outputs());
+    for (const Edge* e : node->out_edges()) {
+      if (e->IsControlEdge()) continue;
+      consumers[e->src_output()].push_back(e->dst()->id());
+    }
+
+    for (int i = 0; i < node->num_outputs(); ++i) {
+      const DataType dtype = node->output_type(i);
+      if (IsRefType(dtype) || !DataTypeCanUseMemcpy(dtype) ||
+          AddAliasingConsumers(graph, &consumers[i])) {
+        continue;
+      }
+      ShapeHandle shape = c->output(i);
+      if (!c->FullyDefined(shape)) continue;
+      const int64_t num_elements = c->Value(c->NumElements(shape));
+      if (num_elements <= 0) continue;
+      const size_t bytes = num_elements * DataTypeSize(dtype);
+      candidates.push_back(
+          {node, i,
+           (bytes + Allocator::kAllocatorAlignment - 1) &
+               ~(Allocator::kAllocatorAlignment - 1),
+           std::move(consumers[i])});
+    }
+  }
+  if (candidates.empty()) return absl::OkStatus();
+
+  // Place the largest outputs first, each at the lowest offset that does not
+  // overlap with an already placed output it may be live together with.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate& a, const Candidate& b) {
+                     return a.bytes > b.bytes;
+                   });
+  const Ancestors ancestors(graph, order);
+  std::vector<size_t> offsets(candidates.size());
+  size_t unplanned_bytes = 0;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const Candidate& candidate = candidates[i];
+    std::vector<std::pair<size_t, size_t>> taken;
+    for (size_t j = 0; j < i; ++j) {
+      if (!DeadBefore(candidate, candidates[j], ancestors) &&
+          !DeadBefore(candidates[j], candidate, ancestors)) {
+        taken.emplace_back(offsets[j], offsets[j] + candidates[j].bytes);
+      }
+    }
+    std::sort(taken.begin(), taken.end());
+    size_t offset = 0;
+    for (const auto& [begin, end] : taken) {
+      if (begin >= offset + candidate.bytes) break;
+      offset = std::max(offset, end);
+    }
+    offsets[i] = offset;
+    plan->allocations.push_back({candidate.node->id(), candidate.output,
+                                 candidate.node->num_outputs(), offset,
+                                 candidate.bytes});
+    plan->total_bytes = std::max(plan->total_bytes, offset + candidate.bytes);
+    unplanned_bytes += candidate.bytes;
+  }
+  VLOG(1) << "Planned " << candidates.size() << " outputs of "
+          << unplanned_bytes << " bytes in " << plan->total_bytes << " bytes";
+  return absl::OkStatus();
+}
+
+}  // namespace tensorflow
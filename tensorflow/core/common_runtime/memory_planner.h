@@ -0,0 +1,46 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
+
+#include "tensorflow/core/common_runtime/memory_plan.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+
+inline constexpr int kMaxPlannedNodes = 1 << 13;
+
+// Plans the memory of the outputs of `graph` whose size is known statically,
+// and stores the plan in `*plan`.
+//
+// Shapes are inferred from the graph; `_Arg` nodes are only planned around,
+// but their `_output_shapes` attr, if any, lets the shapes of their consumers
+// be inferred. An output is planned if its shape is fully defined, its type
+// is memcpy-able, and it does not leave the step: its node and its consumers
+// are not stateful, and it is not fed to a `_Retval` or a send. Consumers
+// that may forward or alias their input extend the output to their own
+// consumers, transitively. Outputs share bytes only if one is consumed by
+// nodes that all run before the other is produced, in any order the executor
+// may run the graph in. Bytes are assigned greedily, largest outputs first.
+//
+// Graphs with control flow, or more than `kMaxPlannedNodes` nodes, get an
+// empty plan.
+Status PlanMemory(const Graph& graph, MemoryPlan* plan);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_MEMORY_PLANNER_H_
@@ -0,0 +1,159 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/memory_planner.h"
+
+#include <string>
+
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/standard_ops.h"
+#include "tensorflow/core/common_runtime/memory_plan.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Returns the planned allocation of output 0 of node `name`, or null.
+const MemoryPlan::Allocation* FindAllocation(const Graph& graph,
+                                             const MemoryPlan& plan,
+                                             const std::string& name) {
+  for (const MemoryPlan::Allocation& allocation : plan.allocations) {
+    if (graph.FindNodeId(allocation.node_id)->name() == name &&
+        allocation.output == 0) {
+      return &allocation;
+    }
+  }
+  return nullptr;
+}
+
+bool Overlap(const MemoryPlan::Allocation* a, const MemoryPlan::Allocation* b) {
+  return a->offset < b->offset + b->bytes && b->offset < a->offset + a->bytes;
+}
+
+TEST(MemoryPlannerTest, ChainReusesDeadOutputs) {
+  Scope root = Scope::NewRootScope();
+  auto c =
+      ops::Const(root.WithOpName("c"), Tensor(DT_FLOAT, TensorShape({16, 16})));
+  // MatMul never forwards its inputs, so each output is dead once the next
+  // MatMul has run.
+  auto a = ops::MatMul(root.WithOpName("a"), c, c);
+  auto b = ops::MatMul(root.WithOpName("b"), a, c);
+  ops::MatMul(root.WithOpName("d"), b, c);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+
+  MemoryPlan plan;
+  TF_ASSERT_OK(PlanMemory(graph, &plan));
+  ASSERT_EQ(plan.allocations.size(), 3);
+  const MemoryPlan::Allocation* alloc_a = FindAllocation(graph, plan, "a");
+  const MemoryPlan::Allocation* alloc_b = FindAllocation(graph, plan, "b");
+  const MemoryPlan::Allocation* alloc_d = FindAllocation(graph, plan, "d");
+  ASSERT_NE(alloc_a, nullptr);
+  ASSERT_NE(alloc_b, nullptr);
+  ASSERT_NE(alloc_d, nullptr);
+  EXPECT_EQ(alloc_a->bytes, 1024);
+  EXPECT_EQ(alloc_a->num_outputs, 1);
+  // `a` is dead once `b` has run, so `d` can take its bytes.
+  EXPECT_FALSE(Overlap(alloc_a, alloc_b));
+  EXPECT_FALSE(Overlap(alloc_b, alloc_d));
+  EXPECT_EQ(alloc_a->offset, alloc_d->offset);
+  EXPECT_EQ(plan.total_bytes, 2048);
+}
+
+TEST(MemoryPlannerTest, ConcurrentOutputsDoNotOverlap) {
+  Scope root = Scope::NewRootScope();
+  auto c =
+      ops::Const(root.WithOpName("c"), Tensor(DT_FLOAT, TensorShape({256})));
+  auto a = ops::Neg(root.WithOpName("a"), c);
+  auto b = ops::Neg(root.WithOpName("b"), c);
+  ops::Add(root.WithOpName("e"), a, b);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+
+  MemoryPlan plan;
+  TF_ASSERT_OK(PlanMemory(graph, &plan));
+  ASSERT_EQ(plan.allocations.size(), 3);
+  const MemoryPlan::Allocation* alloc_a = FindAllocation(graph, plan, "a");
+  const MemoryPlan::Allocation* alloc_b = FindAllocation(graph, plan, "b");
+  const MemoryPlan::Allocation* alloc_e = FindAllocation(graph, plan, "e");
+  EXPECT_FALSE(Overlap(alloc_a, alloc_b));
+  EXPECT_FALSE(Overlap(alloc_a, alloc_e));
+  EXPECT_FALSE(Overlap(alloc_b, alloc_e));
+  EXPECT_EQ(plan.total_bytes, 3072);
+}
+
+TEST(MemoryPlannerTest, UnknownShapesAndReturnedOutputsAreNotPlanned) {
+  Scope root = Scope::NewRootScope();
+  auto p = ops::Placeholder(root.WithOpName("p"), DT_FLOAT);
+  ops::Neg(root.WithOpName("unknown"), p);
+  auto c =
+      ops::Const(root.WithOpName("c"), Tensor(DT_FLOAT, TensorShape({256})));
+  auto returned = ops::Neg(root.WithOpName("returned"), c);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+  Node* retval;
+  TF_ASSERT_OK(NodeBuilder("retval", "_Retval")
+                   .Input(returned.node())
+                   .Attr("index", 0)
+                   .Finalize(&graph, &retval));
+
+  MemoryPlan plan;
+  TF_ASSERT_OK(PlanMemory(graph, &plan));
+  EXPECT_TRUE(plan.allocations.empty());
+  EXPECT_EQ(plan.total_bytes, 0);
+}
+
+TEST(MemoryPlannerTest, ForwardedOutputsLiveAsLongAsTheirAliases) {
+  Scope root = Scope::NewRootScope();
+  auto c =
+      ops::Const(root.WithOpName("c"), Tensor(DT_FLOAT, TensorShape({16, 16})));
+  auto a = ops::MatMul(root.WithOpName("a"), c, c);
+  // `b` may forward the buffer of `a`, and `r` may return it.
+  auto b = ops::Neg(root.WithOpName("b"), a);
+  auto r = ops::Reshape(root.WithOpName("r"), b, {256});
+  // `d` runs after `b`, so it could take the bytes of `a` if only `b` read
+  // them.
+  auto d = ops::MatMul(
+      root.WithOpName("d").WithControlDependencies({b.operation}), c, c);
+  ops::Add(root.WithOpName("e"), r, ops::Reshape(root, d, {256}));
+  auto f = ops::MatMul(root.WithOpName("f"), c, c);
+  auto g = ops::Neg(root.WithOpName("g"), f);
+  Graph graph(OpRegistry::Global());
+  TF_ASSERT_OK(root.ToGraph(&graph));
+  Node* retval;
+  TF_ASSERT_OK(NodeBuilder("retval", "_Retval")
+                   .Input(g.node())
+                   .Attr("index", 0)
+                   .Finalize(&graph, &retval));
+
+  MemoryPlan plan;
+  TF_ASSERT_OK(PlanMemory(graph, &plan));
+  const MemoryPlan::Allocation* alloc_a = FindAllocation(graph, plan, "a");
+  const MemoryPlan::Allocation* alloc_d = FindAllocation(graph, plan, "d");
+  ASSERT_NE(alloc_a, nullptr);
+  ASSERT_NE(alloc_d, nullptr);
+  // `a` is read through `b` and `r` until `e` has run.
+  EXPECT_FALSE(Overlap(alloc_a, alloc_d));
+  // `f` reaches the `_Retval` through `g`, which may forward it.
+  EXPECT_EQ(FindAllocation(graph, plan, "f"), nullptr);
+  EXPECT_EQ(FindAllocation(graph, plan, "g"), nullptr);
+}
+
+}  // namespace
+}  // namespace tensorflow
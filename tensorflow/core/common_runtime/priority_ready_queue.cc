@@ -0,0 +1,74 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/priority_ready_queue.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace tensorflow {
+namespace {
+
+// Calls `fn` with the id of each node that `item` has an edge to, except for
+// loop back edges.
+template <typename Fn>
+void ForEachSuccessor(const NodeItem& item, Fn fn) {
+  if (item.is_next_iteration) return;
+  for (const EdgeInfo& e : item.output_edges()) fn(e.dst_id);
+  for (const ControlEdgeInfo& e : item.output_control_edges()) fn(e.dst_id);
+}
+
+}  // namespace
+
+std::vector<int64_t> ComputeCriticalPathPriorities(
+    const GraphView& gview,
+    absl::FunctionRef<int64_t(const NodeItem&)> node_cost) {
+  const int32_t num_nodes = gview.num_nodes();
+  std::vector<int64_t> priorities(num_nodes, 0);
+  enum : uint8_t { kUnvisited, kVisiting, kDone };
+  std::vector<uint8_t> state(num_nodes, kUnvisited);
+
+  // Depth-first search, which computes the priority of a node after those of
+  // all its successors.
+  std::vector<int32_t> stack;
+  for (int32_t root = 0; root < num_nodes; ++root) {
+    if (gview.node(root) == nullptr || state[root] != kUnvisited) continue;
+    stack.push_back(root);
+    while (!stack.empty()) {
+      const int32_t id = stack.back();
+      const NodeItem& item = gview.node_ref(id);
+      if (state[id] == kUnvisited) {
+        state[id] = kVisiting;
+        ForEachSuccessor(item, [&](int32_t dst_id) {
+          if (state[dst_id] == kUnvisited) stack.push_back(dst_id);
+        });
+        continue;
+      }
+      stack.pop_back();
+      if (state[id] == kDone) continue;
+      int64_t successor_priority = 0;
+      ForEachSuccessor(item, [&](int32_t dst_id) {
+        successor_priority = std::max(successor_priority, priorities[dst_id]);
+      });
+      priorities[id] = node_cost(item) + successor_priority;
+      state[id] = kDone;
+    }
+  }
+  return priorities;
+}
+
+}  // namespace tensorflow
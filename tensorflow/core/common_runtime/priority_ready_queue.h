@@ -0,0 +1,118 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_PRIORITY_READY_QUEUE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_PRIORITY_READY_QUEUE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "absl/functional/function_ref.h"
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+// Returns the critical-path priority of each node in `gview`, indexed by node
+// id: the largest total `node_cost` of a path from the node to a sink,
+// including the node itself. Nodes on the longest paths through the graph get
+// the highest priorities. The back edges of loops, which leave `NextIteration`
+// nodes, are ignored.
+std::vector<int64_t> ComputeCriticalPathPriorities(
+    const GraphView& gview,
+    absl::FunctionRef<int64_t(const NodeItem&)> node_cost);
+
+// A drop-in replacement for the `TaggedNodeReadyQueue` of a propagator state,
+// which dequeues the ready node with the highest priority first, and nodes of
+// equal priority in the order they were queued. `priorities` is indexed by
+// node id. If it is null, nodes are dequeued in the order of `FifoQueue`.
+//
+// To keep queueing cheap when very many nodes are ready at once, at most
+// `max_prioritized_nodes` nodes are ordered by priority. The others wait in
+// FIFO order until there is room for them.
+//
+// Not thread-safe.
+template <typename TaggedNode, typename FifoQueue>
+class PriorityReadyQueue {
+ public:
+  static constexpr int kDefaultMaxPrioritizedNodes = 1024;
+
+  explicit PriorityReadyQueue(
+      const int64_t* priorities,
+      int max_prioritized_nodes = kDefaultMaxPrioritizedNodes)
+      : priorities_(priorities),
+        max_prioritized_nodes_(max_prioritized_nodes) {
+    DCHECK_GT(max_prioritized_nodes, 0);
+  }
+
+  void push_back(const TaggedNode& node) {
+    if (priorities_ == nullptr || heap_.size() >= max_prioritized_nodes_) {
+      fifo_.push_back(node);
+    } else {
+      PushHeap(node);
+    }
+  }
+
+  TaggedNode front() const {
+    return heap_.empty() ? fifo_.front() : heap_.front().node;
+  }
+
+  void pop_front() {
+    if (heap_.empty()) {
+      fifo_.pop_front();
+      return;
+    }
+    std::pop_heap(heap_.begin(), heap_.end(), &Entry::Less);
+    heap_.pop_back();
+    if (priorities_ != nullptr && !fifo_.empty()) {
+      PushHeap(fifo_.front());
+      fifo_.pop_front();
+    }
+  }
+
+  bool empty() const { return heap_.empty() && fifo_.empty(); }
+  int size() const { return heap_.size() + fifo_.size(); }
+
+ private:
+  struct Entry {
+    int64_t priority;
+    uint64_t sequence;
+    TaggedNode node;
+
+    // Orders the heap by priority, then by queueing order.
+    static bool Less(const Entry& a, const Entry& b) {
+      if (a.priority != b.priority) return a.priority < b.priority;
+      return a.sequence > b.sequence;
+    }
+  };
+
+  void PushHeap(const TaggedNode& node) {
+    heap_.push_back(
+        Entry{priorities_[node.get_node_item().node_id], next_sequence_++,
+              node});
+    std::push_heap(heap_.begin(), heap_.end(), &Entry::Less);
+  }
+
+  const int64_t* const priorities_;
+  const size_t max_prioritized_nodes_;
+  uint64_t next_sequence_ = 0;
+  std::vector<Entry> heap_;
+  FifoQueue fifo_;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_PRIORITY_READY_QUEUE_H_
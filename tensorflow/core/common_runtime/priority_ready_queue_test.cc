@@ -0,0 +1,112 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/priority_ready_queue.h"
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/graph_view.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+struct FakeNodeItem {
+  int node_id;
+};
+
+struct FakeTaggedNode {
+  const FakeNodeItem* node_item;
+  const FakeNodeItem& get_node_item() const { return *node_item; }
+};
+
+using FakeReadyQueue =
+    PriorityReadyQueue<FakeTaggedNode, std::deque<FakeTaggedNode>>;
+
+class PriorityReadyQueueTest : public ::testing::Test {
+ protected:
+  PriorityReadyQueueTest() {
+    for (int i = 0; i < 4; ++i) items_.push_back({i});
+  }
+
+  FakeTaggedNode Node(int id) const { return {&items_[id]}; }
+
+  // Dequeues all the nodes in `queue`, and returns their ids.
+  std::vector<int> Drain(FakeReadyQueue* queue) const {
+    std::vector<int> ids;
+    while (!queue->empty()) {
+      ids.push_back(queue->front().get_node_item().node_id);
+      queue->pop_front();
+    }
+    return ids;
+  }
+
+  std::vector<FakeNodeItem> items_;
+};
+
+TEST_F(PriorityReadyQueueTest, DequeuesByPriorityThenInOrder) {
+  const int64_t priorities[] = {1, 5, 5, 3};
+  FakeReadyQueue queue(priorities);
+  for (int id : {0, 2, 3, 1}) queue.push_back(Node(id));
+  EXPECT_EQ(queue.size(), 4);
+  EXPECT_EQ(Drain(&queue), std::vector<int>({2, 1, 3, 0}));
+}
+
+TEST_F(PriorityReadyQueueTest, DequeuesInOrderWithoutPriorities) {
+  FakeReadyQueue queue(/*priorities=*/nullptr);
+  for (int id : {0, 2, 3, 1}) queue.push_back(Node(id));
+  EXPECT_EQ(Drain(&queue), std::vector<int>({0, 2, 3, 1}));
+}
+
+TEST_F(PriorityReadyQueueTest, PrioritizesBoundedNumberOfNodes) {
+  const int64_t priorities[] = {1, 2, 3, 4};
+  FakeReadyQueue queue(priorities, /*max_prioritized_nodes=*/2);
+  for (int id : {0, 1, 2, 3}) queue.push_back(Node(id));
+  EXPECT_EQ(queue.size(), 4);
+  // Nodes 2 and 3 wait in order until there is room to order them by
+  // priority, so node 2 runs before node 3 does.
+  EXPECT_EQ(Drain(&queue), std::vector<int>({1, 2, 3, 0}));
+}
+
+TEST(CriticalPathPrioritiesTest, LongestPathToSink) {
+  Graph g(OpRegistry::Global());
+  Tensor t(DT_FLOAT, TensorShape({2, 2}));
+  t.flat<float>().setZero();
+  Node* c = test::graph::Constant(&g, t);
+  Node* m1 = test::graph::Matmul(&g, c, c, false, false);
+  Node* m2 = test::graph::Matmul(&g, m1, c, false, false);
+  Node* id = test::graph::Identity(&g, c);
+
+  GraphView gview;
+  TF_ASSERT_OK(gview.Initialize(&g));
+  std::vector<int64_t> priorities = ComputeCriticalPathPriorities(
+      gview, [&](const NodeItem& item) -> int64_t {
+        return item.node_id == m1->id() || item.node_id == m2->id() ? 10 : 1;
+      });
+  ASSERT_EQ(priorities.size(), static_cast<size_t>(g.num_node_ids()));
+  EXPECT_EQ(priorities[m2->id()], 10);
+  EXPECT_EQ(priorities[m1->id()], 20);
+  EXPECT_EQ(priorities[id->id()], 1);
+  EXPECT_EQ(priorities[c->id()], 21);
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,98 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <algorithm>
+
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+
+StepArenaAllocator::~StepArenaAllocator() {
+  if (block_ != nullptr) {
+    base_->DeallocateRaw(block_);
+  }
+}
+
+void* StepArenaAllocator::AllocateRaw(size_t alignment, size_t num_bytes) {
+  Ref();
+  if (alignment <= kAllocatorAlignment && num_bytes <= kMaxAllocationSize) {
+    const size_t rounded_bytes =
+        (num_bytes + kAllocatorAlignment - 1) & ~(kAllocatorAlignment - 1);
+    const size_t offset =
+        offset_.fetch_add(rounded_bytes, std::memory_order_relaxed);
+    if (offset + rounded_bytes <= capacity_) {
+      return block_ + offset;
+    }
+  }
+  void* ptr = base_->AllocateRaw(alignment, num_bytes);
+  if (ptr == nullptr) {
+    // Cannot drop to zero: the running step holds a count.
+    Unref();
+  }
+  return ptr;
+}
+
+void StepArenaAllocator::DeallocateRaw(void* ptr) {
+  if (!InBlock(ptr)) {
+    base_->DeallocateRaw(ptr);
+  }
+  Unref();
+}
+
+StepArenaPool::StepArenaPool(Allocator* base, size_t max_block_bytes)
+    : base_(base), max_block_bytes_(max_block_bytes) {}
+
+StepArenaAllocator* StepArenaPool::BeginStep() {
+  StepArenaAllocator* arena =
+      arenas_.BeginStep([this] { return new StepArenaAllocator(base_); });
+  size_t block_bytes;
+  {
+    mutex_lock l(mu_);
+    block_bytes = high_water_bytes_;
+  }
+  if (arena->capacity_ < block_bytes) {
+    if (arena->block_ != nullptr) {
+      base_->DeallocateRaw(arena->block_);
+    }
+    arena->block_ = static_cast<char*>(
+        base_->AllocateRaw(Allocator::kAllocatorAlignment, block_bytes));
+    arena->capacity_ = arena->block_ != nullptr ? block_bytes : 0;
+  }
+  arena->offset_.store(0, std::memory_order_relaxed);
+  return arena;
+}
+
+void StepArenaPool::EndStep(StepArenaAllocator* arena) {
+  const size_t requested_bytes = arena->offset_.load(std::memory_order_relaxed);
+  const size_t capacity = arena->capacity_;
+  {
+    mutex_lock l(mu_);
+    high_water_bytes_ = std::max(
+        high_water_bytes_, std::min(requested_bytes, max_block_bytes_));
+  }
+  if (!arenas_.EndStep(arena)) {
+    VLOG(2) << "Step arena with a " << capacity
+            << " byte block outlived its step";
+  }
+}
+
+size_t StepArenaPool::high_water_bytes() const {
+  mutex_lock l(mu_);
+  return high_water_bytes_;
+}
+
+}  // namespace tensorflow
@@ -0,0 +1,108 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+#include "tensorflow/core/common_runtime/step_scoped_pool.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+class StepArenaPool;
+
+// Bump allocator for the temporaries of one step. Allocations are carved out
+// of a single block by advancing an atomic offset, and deallocations only
+// decrement a count of live allocations, so neither takes a lock. The block is
+// released wholesale: the arena is reused as a `StepScopedMemory`.
+//
+// Allocations that do not fit in the block, that are larger than
+// `kMaxAllocationSize`, or that need more than `kAllocatorAlignment` are
+// forwarded to the base allocator.
+//
+// Thread-safe. Obtained from a `StepArenaPool`.
+class StepArenaAllocator : public Allocator, public StepScopedMemory {
+ public:
+  // Allocations larger than this go to the base allocator and are not counted
+  // towards the size of the next block.
+  static constexpr size_t kMaxAllocationSize = 1 << 20;
+
+  ~StepArenaAllocator() override;
+
+  std::string Name() override { return "step_arena"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override;
+  void DeallocateRaw(void* ptr) override;
+  AllocatorMemoryType GetMemoryType() const override {
+    return base_->GetMemoryType();
+  }
+
+  // Returns true if `ptr` is in this arena's block.
+  bool InBlock(const void* ptr) const {
+    return ptr >= block_ && ptr < block_ + capacity_;
+  }
+
+  size_t capacity() const { return capacity_; }
+
+ private:
+  friend class StepArenaPool;
+
+  explicit StepArenaAllocator(Allocator* base) : base_(base) {}
+
+  Allocator* const base_;  // Not owned.
+  char* block_ = nullptr;
+  size_t capacity_ = 0;
+
+  // Bytes requested from the arena in the current step, including those that
+  // did not fit in the block.
+  std::atomic<size_t> offset_{0};
+};
+
+// Hands out one `StepArenaAllocator` per running step, and reuses them across
+// steps. Each block is sized to the most bytes any previous step requested
+// from its arena, capped at `max_block_bytes`, so after the first few steps
+// the temporaries of a step usually fit in one block.
+//
+// Thread-safe. The base allocator must outlive the pool and every tensor
+// allocated from its arenas.
+class StepArenaPool {
+ public:
+  StepArenaPool(Allocator* base, size_t max_block_bytes);
+
+  // See `StepScopedPool`.
+  StepArenaAllocator* BeginStep();
+  void EndStep(StepArenaAllocator* arena);
+
+  // The size of the blocks handed out by `BeginStep`.
+  size_t high_water_bytes() const;
+
+ private:
+  Allocator* const base_;  // Not owned.
+  const size_t max_block_bytes_;
+
+  StepScopedPool<StepArenaAllocator> arenas_;
+
+  mutable mutex mu_;
+  size_t high_water_bytes_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_ARENA_ALLOCATOR_H_
@@ -0,0 +1,172 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/step_arena_allocator.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+// Counts the allocations made through it.
+class CountingAllocator : public Allocator {
+ public:
+  std::string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    ++num_allocations_;
+    return cpu_allocator()->AllocateRaw(alignment, num_bytes);
+  }
+  void DeallocateRaw(void* ptr) override {
+    ++num_deallocations_;
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+
+  int num_allocations() const { return num_allocations_; }
+  int num_live() const { return num_allocations_ - num_deallocations_; }
+
+ private:
+  std::atomic<int> num_allocations_{0};
+  std::atomic<int> num_deallocations_{0};
+};
+
+TEST(StepArenaAllocatorTest, BlockIsSizedByPreviousSteps) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 1 << 20);
+
+  // The first step has no block, so everything goes to the base allocator.
+  StepArenaAllocator* arena = pool.BeginStep();
+  EXPECT_EQ(arena->capacity(), 0);
+  for (int i = 0; i < 4; ++i) {
+    Tensor t(arena, DT_FLOAT, TensorShape({100}));
+  }
+  EXPECT_EQ(base.num_allocations(), 4);
+  pool.EndStep(arena);
+  EXPECT_EQ(pool.high_water_bytes(), 4 * 448);
+
+  // The next step gets one block that fits all of them.
+  arena = pool.BeginStep();
+  EXPECT_EQ(arena->capacity(), 4 * 448);
+  EXPECT_EQ(base.num_allocations(), 5);
+  std::vector<Tensor> tensors;
+  for (int i = 0; i < 4; ++i) {
+    tensors.emplace_back(arena, DT_FLOAT, TensorShape({100}));
+    EXPECT_TRUE(arena->InBlock(tensors.back().tensor_data().data()));
+  }
+  EXPECT_EQ(base.num_allocations(), 5);
+  tensors.clear();
+  pool.EndStep(arena);
+
+  // The block is reused.
+  StepArenaAllocator* next_arena = pool.BeginStep();
+  EXPECT_EQ(next_arena, arena);
+  EXPECT_EQ(base.num_allocations(), 5);
+  pool.EndStep(next_arena);
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+TEST(StepArenaAllocatorTest, LargeAllocationsBypassTheBlock) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 20);
+  StepArenaAllocator* arena = pool.BeginStep();
+  {
+    Tensor t(arena, DT_INT8,
+             TensorShape({static_cast<int64_t>(
+                 StepArenaAllocator::kMaxAllocationSize + 1)}));
+    EXPECT_FALSE(arena->InBlock(t.tensor_data().data()));
+  }
+  pool.EndStep(arena);
+  EXPECT_EQ(pool.high_water_bytes(), 0);
+  EXPECT_EQ(base.num_live(), 0);
+}
+
+TEST(StepArenaAllocatorTest, HighWaterIsCapped) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 1024);
+  StepArenaAllocator* arena = pool.BeginStep();
+  for (int i = 0; i < 4; ++i) {
+    Tensor t(arena, DT_INT8, TensorShape({1000}));
+  }
+  pool.EndStep(arena);
+  EXPECT_EQ(pool.high_water_bytes(), 1024);
+}
+
+TEST(StepArenaAllocatorTest, ArenaOutlivingItsStepIsNotReused) {
+  CountingAllocator base;
+  StepArenaPool pool(&base, 1 << 20);
+  StepArenaAllocator* arena = pool.BeginStep();
+  { Tensor t(arena, DT_INT8, TensorShape({1024})); }
+  pool.EndStep(arena);
+
+  arena = pool.BeginStep();
+  Tensor escaped(arena, DT_INT8, TensorShape({1024}));
+  EXPECT_TRUE(arena->InBlock(escaped.tensor_data().data()));
+  pool.EndStep(arena);
+
+  // Still in use, so the next step gets a new block.
+  StepArenaAllocator* next_arena = pool.BeginStep();
+  EXPECT_NE(next_arena, arena);
+  EXPECT_EQ(base.num_live(), 2);
+  pool.EndStep(next_arena);
+
+  // Releasing the last tensor deletes the old arena and its block.
+  escaped = Tensor();
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+TEST(StepArenaAllocatorTest, ConcurrentAllocationsDoNotOverlap) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumTensorsPerThread = 100;
+  CountingAllocator base;
+  StepArenaPool pool(&base, 64 << 20);
+  for (int step = 0; step < 3; ++step) {
+    StepArenaAllocator* arena = pool.BeginStep();
+    std::vector<std::vector<Tensor>> tensors(kNumThreads);
+    {
+      thread::ThreadPool threads(Env::Default(), "test", kNumThreads);
+      for (int t = 0; t < kNumThreads; ++t) {
+        threads.Schedule([arena, t, &tensors] {
+          for (int i = 0; i < kNumTensorsPerThread; ++i) {
+            Tensor tensor(arena, DT_INT32, TensorShape({1 + i % 7}));
+            tensor.flat<int32>().setConstant(t);
+            tensors[t].push_back(tensor);
+          }
+        });
+      }
+    }
+    for (int t = 0; t < kNumThreads; ++t) {
+      for (const Tensor& tensor : tensors[t]) {
+        for (int i = 0; i < tensor.NumElements(); ++i) {
+          ASSERT_EQ(tensor.flat<int32>()(i), t);
+        }
+      }
+    }
+    tensors.clear();
+    pool.EndStep(arena);
+  }
+  // After the first step, everything fits in the block.
+  EXPECT_EQ(base.num_live(), 1);
+}
+
+}  // namespace
+}  // namespace tensorflow
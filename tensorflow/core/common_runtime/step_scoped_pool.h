@@ -0,0 +1,114 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_STEP_SCOPED_POOL_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_STEP_SCOPED_POOL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// Memory that a `StepScopedPool` hands out to one step at a time. It counts
+// the allocations made from it that are still live, plus one while its step
+// is running. Once the step has ended, the memory deletes itself when the
+// last allocation is gone.
+class StepScopedMemory {
+ public:
+  virtual ~StepScopedMemory() = default;
+
+ protected:
+  // Counts a live allocation.
+  void Ref() { num_refs_.fetch_add(1, std::memory_order_relaxed); }
+
+  // Drops a live allocation, and deletes this if it was the last one after
+  // the step ended. May not drop the count of a running step to zero.
+  void Unref() {
+    if (num_refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      // The step has ended, and its pool has let go of this memory.
+      delete this;
+    }
+  }
+
+ private:
+  template <typename T>
+  friend class StepScopedPool;
+
+  std::atomic<int64_t> num_refs_{0};
+};
+
+// Hands out one `T` per running step, and reuses them across steps once all
+// their allocations are gone. `T` must derive from `StepScopedMemory`.
+//
+// Thread-safe.
+template <typename T>
+class StepScopedPool {
+ public:
+  StepScopedPool() = default;
+  ~StepScopedPool() {
+    for (T* memory : idle_) {
+      delete memory;
+    }
+  }
+
+  StepScopedPool(const StepScopedPool&) = delete;
+  StepScopedPool& operator=(const StepScopedPool&) = delete;
+
+  // Returns an idle memory for a new step, or one made by `create()` if there
+  // is none. The caller must pass it to `EndStep` when the step is done.
+  template <typename Create>
+  T* BeginStep(Create create) {
+    static_assert(std::is_base_of_v<StepScopedMemory, T>,
+                  "T must derive from StepScopedMemory");
+    T* memory = nullptr;
+    {
+      mutex_lock l(mu_);
+      if (!idle_.empty()) {
+        memory = idle_.back();
+        idle_.pop_back();
+      }
+    }
+    if (memory == nullptr) {
+      memory = create();
+    }
+    memory->num_refs_.store(1, std::memory_order_relaxed);
+    return memory;
+  }
+
+  // Ends the step of `memory`. If all of its allocations are gone, keeps it
+  // for a later step and returns true. Otherwise drops it from the pool and
+  // returns false; `memory` may then be deleted at any time.
+  bool EndStep(T* memory) {
+    if (memory->num_refs_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+      return false;
+    }
+    mutex_lock l(mu_);
+    idle_.push_back(memory);
+    return true;
+  }
+
+ private:
+  mutex mu_;
+  std::vector<T*> idle_ TF_GUARDED_BY(mu_);
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_STEP_SCOPED_POOL_H_
@@ -0,0 +1,171 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <vector>
+
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+
+// A deque of work items owned by one worker. The owner pushes and pops at the
+// back, so that it runs the most recently readied work next, while the inputs
+// of that work are likely still in its caches. Other workers steal from the
+// front, where the oldest work is.
+//
+// Thread-safe.
+template <typename T>
+class WorkStealingQueue {
+ public:
+  WorkStealingQueue() = default;
+
+  void PushBack(const T& item) {
+    mutex_lock l(mu_);
+    items_.push_back(item);
+    size_.store(items_.size(), std::memory_order_relaxed);
+  }
+
+  // Called by the owner.
+  std::optional<T> PopBack() {
+    if (size() == 0) return std::nullopt;
+    mutex_lock l(mu_);
+    if (items_.empty()) return std::nullopt;
+    std::optional<T> item(items_.back());
+    items_.pop_back();
+    size_.store(items_.size(), std::memory_order_relaxed);
+    return item;
+  }
+
+  // Called by other workers.
+  std::optional<T> StealFront() {
+    if (size() == 0) return std::nullopt;
+    mutex_lock l(mu_);
+    if (items_.empty()) return std::nullopt;
+    std::optional<T> item(items_.front());
+    items_.pop_front();
+    size_.store(items_.size(), std::memory_order_relaxed);
+    return item;
+  }
+
+  // Returns the number of queued items. May be stale if other threads are
+  // using the queue.
+  size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+ private:
+  mutex mu_;
+  std::deque<T> items_ TF_GUARDED_BY(mu_);
+  std::atomic<size_t> size_{0};
+
+  WorkStealingQueue(const WorkStealingQueue&) = delete;
+  void operator=(const WorkStealingQueue&) = delete;
+};
+
+// The workers of one executor step, and their queues.
+//
+// A worker registers its queue for as long as it runs, and only stops once its
+// queue is empty and it found nothing to steal, so no queued work is left
+// behind. The number of workers is not bounded, but `TryReserveWorker` only
+// allows up to `max_workers` of them, for the caller to start another worker
+// when it has more work queued than it can run.
+//
+// Thread-safe.
+template <typename T>
+class WorkStealingScheduler {
+ public:
+  explicit WorkStealingScheduler(int max_workers) : max_workers_(max_workers) {}
+
+  ~WorkStealingScheduler() { DCHECK(queues_.empty()); }
+
+  // Returns true if fewer than `max_workers` workers are running or reserved,
+  // and reserves a worker. The caller must then either start a worker that
+  // calls `AddWorker(queue, /*reserved=*/true)`, or call
+  // `CancelReservation`.
+  bool TryReserveWorker() {
+    int num_workers = num_workers_.load(std::memory_order_relaxed);
+    while (num_workers < max_workers_) {
+      if (num_workers_.compare_exchange_weak(num_workers, num_workers + 1,
+                                             std::memory_order_relaxed)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void CancelReservation() {
+    num_workers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Registers the queue of a starting worker, which may have been reserved
+  // with `TryReserveWorker`.
+  void AddWorker(WorkStealingQueue<T>* queue, bool reserved) {
+    if (!reserved) num_workers_.fetch_add(1, std::memory_order_relaxed);
+    mutex_lock l(mu_);
+    queues_.push_back(queue);
+  }
+
+  // Unregisters the queue of a stopping worker. The queue must be empty.
+  void RemoveWorker(WorkStealingQueue<T>* queue) {
+    DCHECK_EQ(queue->size(), 0);
+    {
+      mutex_lock l(mu_);
+      queues_.erase(std::find(queues_.begin(), queues_.end(), queue));
+    }
+    num_workers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  // Steals the oldest item of another worker's queue, starting from a
+  // different worker on each call. `thief` may be null.
+  std::optional<T> Steal(const WorkStealingQueue<T>* thief) {
+    mutex_lock l(mu_);
+    const size_t num_queues = queues_.size();
+    if (num_queues == 0) return std::nullopt;
+    // Multiplicative hashing spreads consecutive calls over the queues.
+    const size_t start =
+        (next_victim_++ * uint64_t{0x9E3779B97F4A7C15} >> 32) % num_queues;
+    for (size_t i = 0; i < num_queues; ++i) {
+      WorkStealingQueue<T>* victim = queues_[(start + i) % num_queues];
+      if (victim == thief) continue;
+      std::optional<T> item = victim->StealFront();
+      if (item.has_value()) return item;
+    }
+    return std::nullopt;
+  }
+
+ private:
+  const int max_workers_;
+  // Running and reserved workers.
+  std::atomic<int> num_workers_{0};
+
+  mutex mu_;
+  std::vector<WorkStealingQueue<T>*> queues_ TF_GUARDED_BY(mu_);
+  uint64_t next_victim_ TF_GUARDED_BY(mu_) = 0;
+
+  WorkStealingScheduler(const WorkStealingScheduler&) = delete;
+  void operator=(const WorkStealingScheduler&) = delete;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_WORK_STEALING_QUEUE_H_
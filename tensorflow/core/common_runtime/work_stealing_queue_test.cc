@@ -0,0 +1,110 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/work_stealing_queue.h"
+
+#include <atomic>
+#include <optional>
+#include <vector>
+
+#include "tensorflow/core/lib/core/threadpool.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+TEST(WorkStealingQueueTest, OwnerPopsNewestAndThievesStealOldest) {
+  WorkStealingQueue<int> queue;
+  for (int i = 0; i < 3; ++i) queue.PushBack(i);
+  EXPECT_EQ(queue.size(), 3);
+  EXPECT_EQ(queue.PopBack(), 2);
+  EXPECT_EQ(queue.StealFront(), 0);
+  EXPECT_EQ(queue.PopBack(), 1);
+  EXPECT_EQ(queue.PopBack(), std::nullopt);
+  EXPECT_EQ(queue.StealFront(), std::nullopt);
+}
+
+TEST(WorkStealingSchedulerTest, StealsFromOtherWorkers) {
+  WorkStealingScheduler<int> scheduler(/*max_workers=*/2);
+  WorkStealingQueue<int> a, b;
+  scheduler.AddWorker(&a, /*reserved=*/false);
+  scheduler.AddWorker(&b, /*reserved=*/false);
+  a.PushBack(1);
+  a.PushBack(2);
+
+  // A worker does not steal from itself.
+  EXPECT_EQ(scheduler.Steal(&a), std::nullopt);
+  EXPECT_EQ(scheduler.Steal(&b), 1);
+  EXPECT_EQ(scheduler.Steal(nullptr), 2);
+  EXPECT_EQ(scheduler.Steal(nullptr), std::nullopt);
+
+  scheduler.RemoveWorker(&a);
+  scheduler.RemoveWorker(&b);
+}
+
+TEST(WorkStealingSchedulerTest, ReservationsAreBounded) {
+  WorkStealingScheduler<int> scheduler(/*max_workers=*/2);
+  WorkStealingQueue<int> a, b;
+  scheduler.AddWorker(&a, /*reserved=*/false);
+  EXPECT_TRUE(scheduler.TryReserveWorker());
+  EXPECT_FALSE(scheduler.TryReserveWorker());
+  scheduler.AddWorker(&b, /*reserved=*/true);
+  EXPECT_FALSE(scheduler.TryReserveWorker());
+
+  scheduler.RemoveWorker(&a);
+  EXPECT_TRUE(scheduler.TryReserveWorker());
+  scheduler.CancelReservation();
+  scheduler.RemoveWorker(&b);
+}
+
+TEST(WorkStealingSchedulerTest, EveryItemIsTakenOnce) {
+  constexpr int kNumWorkers = 4;
+  constexpr int kNumItems = 10000;
+  WorkStealingScheduler<int> scheduler(kNumWorkers);
+  std::vector<std::atomic<int>> taken(kNumItems);
+  std::atomic<int> num_taken{0};
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumWorkers);
+    for (int w = 0; w < kNumWorkers; ++w) {
+      pool.Schedule([&, w]() {
+        WorkStealingQueue<int> queue;
+        scheduler.AddWorker(&queue, /*reserved=*/false);
+        int next_item = 0;
+        while (num_taken < kNumItems) {
+          // Worker 0 produces all the items, a few at a time, and the others
+          // steal them.
+          for (int j = 0; w == 0 && j < 4 && next_item < kNumItems; ++j) {
+            queue.PushBack(next_item++);
+          }
+          std::optional<int> item = queue.PopBack();
+          if (!item.has_value()) item = scheduler.Steal(&queue);
+          if (item.has_value()) {
+            taken[*item].fetch_add(1);
+            num_taken.fetch_add(1);
+          }
+        }
+        scheduler.RemoveWorker(&queue);
+      });
+    }
+  }
+  EXPECT_EQ(num_taken, kNumItems);
+  for (int i = 0; i < kNumItems; ++i) {
+    EXPECT_EQ(taken[i], 1) << i;
+  }
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -0,0 +1,102 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_replay.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Copies the tuned state values of all tunable parameters of `model` into the
+// parameter values, so that the model reflects the outcome of the
+// optimization.
+void SyncTunedValues(model::Model& model) {
+  for (auto& [node_name, parameter] :
+       model.output()->CollectTunableParameters()) {
+    tf_shared_lock l(*parameter->state->mu);
+    parameter->value = parameter->state->value;
+  }
+}
+
+}  // namespace
+
+absl::StatusOr<AutotuneReplayResult> ReplayAutotune(
+    const model::ModelProto& model_proto,
+    const AutotuneReplayOptions& options) {
+  std::unique_ptr<model::Model> model;
+  TF_RETURN_IF_ERROR(model::Model::FromProto(model_proto, &model));
+  if (model->output() == nullptr) {
+    return errors::InvalidArgument("The model to replay has no output node.");
+  }
+  const int64_t cpu_budget =
+      options.cpu_budget > 0 ? options.cpu_budget
+                             : model_proto.optimization_params().cpu_budget();
+  const int64_t ram_budget =
+      options.ram_budget > 0 ? options.ram_budget
+                             : model_proto.optimization_params().ram_budget();
+  if (cpu_budget <= 0) {
+    return errors::InvalidArgument(
+        "The CPU budget must be positive, but got ", cpu_budget, ".");
+  }
+
+  AutotuneReplayResult result;
+  result.output_time_before = model->OutputTime(
+      model->output(), /*model_input_time=*/0, /*gradients=*/nullptr);
+  result.maximum_buffered_bytes_before =
+      model->output()->TotalMaximumBufferedBytes();
+
+  CancellationManager cancellation_manager;
+  model::RamBudgetManager ram_budget_manager(ram_budget);
+  model->Optimize(
+      options.algorithm, [cpu_budget]() { return cpu_budget; },
+      /*ram_budget_share=*/1.0, /*fixed_ram_budget=*/ram_budget,
+      /*model_input_time=*/0, ram_budget_manager, &cancellation_manager);
+
+  SyncTunedValues(*model);
+  result.output_time_after = model->OutputTime(
+      model->output(), /*model_input_time=*/0, /*gradients=*/nullptr);
+  result.maximum_buffered_bytes_after =
+      model->output()->TotalMaximumBufferedBytes();
+  for (const auto& [node_name, parameter] :
+       model->output()->CollectTunableParameters()) {
+    result.parameter_values[absl::StrCat(node_name, ":", parameter->name)] =
+        parameter->value;
+  }
+  return result;
+}
+
+absl::StatusOr<AutotuneReplayResult> ReplayAutotuneFromFile(
+    const std::string& filename, const AutotuneReplayOptions& options) {
+  model::ModelProto model_proto;
+  TF_RETURN_IF_ERROR(
+      ReadTextOrBinaryProto(Env::Default(), filename, &model_proto));
+  return ReplayAutotune(model_proto, options);
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,69 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_AUTOTUNE_REPLAY_H_
+#define TENSORFLOW_CORE_DATA_AUTOTUNE_REPLAY_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/container/btree_map.h"
+#include "absl/status/statusor.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/model.pb.h"
+
+namespace tensorflow {
+namespace data {
+
+// Options for replaying an autotuning step on a recorded model.
+struct AutotuneReplayOptions {
+  model::AutotuneAlgorithm algorithm =
+      model::AutotuneAlgorithm::RAM_CONSTRAINED;
+  // CPU and RAM budgets for the optimization. If zero, the budgets recorded in
+  // the `optimization_params` of the model proto are used.
+  int64_t cpu_budget = 0;
+  int64_t ram_budget = 0;
+};
+
+// Result of replaying an autotuning step on a recorded model.
+struct AutotuneReplayResult {
+  // Modeled output time in nanoseconds before and after the optimization.
+  double output_time_before = 0.0;
+  double output_time_after = 0.0;
+  // Maximum bytes buffered by the autotuned nodes before and after the
+  // optimization.
+  double maximum_buffered_bytes_before = 0.0;
+  double maximum_buffered_bytes_after = 0.0;
+  // Tuned parameter values keyed by "<node long name>:<parameter name>".
+  absl::btree_map<std::string, double> parameter_values;
+};
+
+// Runs one optimization of `options.algorithm` on the model restored from
+// `model_proto` and reports how it changed the model. The replay is
+// deterministic: it only depends on the recorded model and the budgets, so it
+// can be used to compare autotuning algorithms offline on models saved by
+// `Model::Save`.
+absl::StatusOr<AutotuneReplayResult> ReplayAutotune(
+    const model::ModelProto& model_proto,
+    const AutotuneReplayOptions& options);
+
+// Like `ReplayAutotune`, but reads the model proto from `filename`. The file
+// may be in text or binary format.
+absl::StatusOr<AutotuneReplayResult> ReplayAutotuneFromFile(
+    const std::string& filename, const AutotuneReplayOptions& options);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_AUTOTUNE_REPLAY_H_
@@ -0,0 +1,176 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_replay.h"
+
+#include <string>
+
+#include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/protobuf.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+#include "tsl/platform/status_matchers.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::AllOf;
+using ::testing::Gt;
+using ::testing::Le;
+using ::tsl::testing::StatusIs;
+
+constexpr char kParallelism[] = "ParallelMapV2(id:1):parallelism";
+constexpr char kShuffleBufferSize[] = "Shuffle(id:2):shuffle_buffer_size";
+
+// A parallel map reading from an autotuned shuffle. Elements are 1000 bytes.
+model::ModelProto ShuffleThenMapModel() {
+  model::ModelProto model_proto;
+  protobuf::TextFormat::ParseFromString(
+      R"pb(
+        nodes: {
+          key: 1
+          value: {
+            id: 1
+            name: "ParallelMapV2"
+            autotune: true
+            num_elements: 100
+            processing_time: 500000
+            bytes_produced: 100000
+            node_class: ASYNC_KNOWN_RATIO
+            ratio: 1
+            inputs: 2
+            parameters: {
+              name: "parallelism"
+              value: 1
+              state_value: 1
+              min: 1
+              max: 16
+              tunable: true
+            }
+          }
+        }
+        nodes: {
+          key: 2
+          value: {
+            id: 2
+            name: "Shuffle"
+            autotune: true
+            num_elements: 100
+            buffered_elements: 1024
+            buffered_bytes: 1024000
+            processing_time: 10000
+            bytes_produced: 100000
+            node_class: KNOWN_RATIO
+            ratio: 1
+            inputs: 3
+            parameters: {
+              name: "shuffle_buffer_size"
+              value: 1024
+              state_value: 1024
+              min: 1024
+              max: 65536
+              tunable: true
+            }
+          }
+        }
+        nodes: {
+          key: 3
+          value: {
+            id: 3
+            name: "TFRecord"
+            autotune: true
+            num_elements: 100
+            processing_time: 20000
+            bytes_produced: 100000
+            node_class: KNOWN_RATIO
+          }
+        }
+        output: 1
+        id_counter: 4
+        optimization_params: { cpu_budget: 8 ram_budget: 10000000 }
+      )pb",
+      &model_proto);
+  return model_proto;
+}
+
+TEST(AutotuneReplayTest, RamConstrainedStaysWithinBudget) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutotuneReplayResult result,
+      ReplayAutotune(ShuffleThenMapModel(), AutotuneReplayOptions()));
+  EXPECT_LT(result.output_time_after, result.output_time_before);
+  EXPECT_LE(result.maximum_buffered_bytes_after, 10000000);
+  EXPECT_GT(result.parameter_values[kParallelism], 1);
+  EXPECT_THAT(result.parameter_values[kShuffleBufferSize],
+              AllOf(Gt(1024), Le(10000)));
+}
+
+TEST(AutotuneReplayTest, SmallRamBudgetKeepsInitialShuffleBuffer) {
+  AutotuneReplayOptions options;
+  options.ram_budget = 100000;
+  TF_ASSERT_OK_AND_ASSIGN(AutotuneReplayResult result,
+                          ReplayAutotune(ShuffleThenMapModel(), options));
+  // The shuffle buffer does not shrink below its initial size, which would
+  // weaken the shuffle.
+  EXPECT_EQ(result.parameter_values[kShuffleBufferSize], 1024);
+}
+
+TEST(AutotuneReplayTest, Deterministic) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutotuneReplayResult first,
+      ReplayAutotune(ShuffleThenMapModel(), AutotuneReplayOptions()));
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutotuneReplayResult second,
+      ReplayAutotune(ShuffleThenMapModel(), AutotuneReplayOptions()));
+  EXPECT_EQ(first.output_time_after, second.output_time_after);
+  EXPECT_EQ(first.maximum_buffered_bytes_after,
+            second.maximum_buffered_bytes_after);
+  EXPECT_EQ(first.parameter_values, second.parameter_values);
+}
+
+TEST(AutotuneReplayTest, HillClimbDoesNotTuneShuffleBuffer) {
+  AutotuneReplayOptions options;
+  options.algorithm = model::AutotuneAlgorithm::HILL_CLIMB;
+  TF_ASSERT_OK_AND_ASSIGN(AutotuneReplayResult result,
+                          ReplayAutotune(ShuffleThenMapModel(), options));
+  EXPECT_EQ(result.parameter_values[kShuffleBufferSize], 1024);
+}
+
+TEST(AutotuneReplayTest, ReplayFromFile) {
+  const std::string filename =
+      io::JoinPath(testing::TmpDir(), "autotune_replay_model.pbtxt");
+  TF_ASSERT_OK(WriteTextProto(Env::Default(), filename, ShuffleThenMapModel()));
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutotuneReplayResult from_file,
+      ReplayAutotuneFromFile(filename, AutotuneReplayOptions()));
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutotuneReplayResult from_proto,
+      ReplayAutotune(ShuffleThenMapModel(), AutotuneReplayOptions()));
+  EXPECT_EQ(from_file.parameter_values, from_proto.parameter_values);
+}
+
+TEST(AutotuneReplayTest, InvalidCpuBudget) {
+  model::ModelProto model_proto = ShuffleThenMapModel();
+  model_proto.mutable_optimization_params()->set_cpu_budget(0);
+  EXPECT_THAT(ReplayAutotune(model_proto, AutotuneReplayOptions()),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
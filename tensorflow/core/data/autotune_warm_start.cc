@@ -0,0 +1,174 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_warm_start.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/platform.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/strcat.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tsl/platform/statusor.h"
+
+// On mobile, input pipelines are not fingerprinted because the hashing
+// utilities are not available there.
+#if !defined(IS_MOBILE_PLATFORM)
+#include "tensorflow/core/data/hash_utils.h"
+#endif  // !IS_MOBILE_PLATFORM
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kFilePrefix[] = "autotune_";
+constexpr char kFileSuffix[] = ".pb";
+
+// Returns a fingerprint of the graph of `dataset`. External state is ignored,
+// so that pipelines reading from the same sources hash identically.
+StatusOr<uint64> InputPipelineFingerprint(const DatasetBase* dataset) {
+#if defined(IS_MOBILE_PLATFORM)
+  return errors::Unimplemented(
+      "Fingerprinting input pipelines is not supported on mobile platforms.");
+#else   // IS_MOBILE_PLATFORM
+  std::vector<std::pair<string, Tensor>> input_list;
+  SerializationContext::Params params;
+  params.input_list = &input_list;
+  params.external_state_policy = ExternalStatePolicy::POLICY_IGNORE;
+  params.is_graph_rewrite = true;
+  GraphDef graph_def;
+  TF_RETURN_IF_ERROR(
+      AsGraphDef(dataset, SerializationContext(params), &graph_def));
+  uint64 hash = 0;
+  TF_RETURN_IF_ERROR(HashGraph(graph_def, &hash));
+  return hash;
+#endif  // IS_MOBILE_PLATFORM
+}
+
+}  // namespace
+
+std::unique_ptr<AutotuneWarmStart> AutotuneWarmStart::Create(
+    const DatasetBase* dataset) {
+  std::string dir;
+  Status s = ReadStringFromEnvVar(kAutotuneWarmStartDirEnvVar, "", &dir);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to read " << kAutotuneWarmStartDirEnvVar << ": "
+                 << s;
+    return nullptr;
+  }
+  if (dir.empty()) {
+    return nullptr;
+  }
+  StatusOr<std::unique_ptr<AutotuneWarmStart>> warm_start =
+      Create(dataset, dir);
+  if (!warm_start.ok()) {
+    VLOG(1) << "Not warm starting autotuning of " << dataset->DebugString()
+            << ": " << warm_start.status();
+    return nullptr;
+  }
+  return *std::move(warm_start);
+}
+
+StatusOr<std::unique_ptr<AutotuneWarmStart>> AutotuneWarmStart::Create(
+    const DatasetBase* dataset, const std::string& dir) {
+  TF_ASSIGN_OR_RETURN(uint64 fingerprint, InputPipelineFingerprint(dataset));
+  return std::make_unique<AutotuneWarmStart>(io::JoinPath(
+      dir, strings::StrCat(kFilePrefix,
+                           strings::Hex(fingerprint, strings::kZeroPad16),
+                           kFileSuffix)));
+}
+
+StatusOr<int64_t> AutotuneWarmStart::Load(model::Model& model) const {
+  Env* env = Env::Default();
+  Status s = env->FileExists(filename_);
+  if (errors::IsNotFound(s)) {
+    return 0;
+  }
+  TF_RETURN_IF_ERROR(s);
+  model::ModelProto model_proto;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env, filename_, &model_proto));
+  return model.WarmStart(model_proto);
+}
+
+Status AutotuneWarmStart::Save(model::Model& model) const {
+  model::ModelProto state;
+  TF_RETURN_IF_ERROR(model.ToProto(&state));
+  if (!ShouldPersist(state)) {
+    return absl::OkStatus();
+  }
+  return Write(filename_, state);
+}
+
+void AutotuneWarmStart::SaveInBackground(
+    std::shared_ptr<model::Model> model) const {
+  std::shared_ptr<model::Node> output = model->output();
+  // Keeps the previously persisted state if this run produced no elements.
+  if (output == nullptr || output->num_elements() == 0) {
+    return;
+  }
+  // The nodes are snapshotted in the calling thread, because the iterators
+  // owning them remove them from the model when they are destroyed.
+  Env::Default()->SchedClosure([filename = filename_, model = std::move(model),
+                                snapshot = output->Snapshot()]() {
+    model::ModelProto state;
+    Status s = model->ToProto(snapshot, &state);
+    if (s.ok() && ShouldPersist(state)) {
+      s = Write(filename, state);
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to persist the autotuning state to " << filename
+                   << ": " << s;
+    }
+  });
+}
+
+bool AutotuneWarmStart::ShouldPersist(const model::ModelProto& state) {
+  // Keeps the previously persisted state if this run produced no elements.
+  auto output = state.nodes().find(state.output());
+  return output != state.nodes().end() && output->second.num_elements() > 0;
+}
+
+Status AutotuneWarmStart::Write(const std::string& filename,
+                                const model::ModelProto& state) {
+  Env* env = Env::Default();
+  TF_RETURN_IF_ERROR(
+      env->RecursivelyCreateDir(std::string(io::Dirname(filename))));
+  // Writes to a temporary file first, so that concurrent runs of the same
+  // input pipeline never observe a partially written state.
+  std::string tmp_filename = filename;
+  if (!env->CreateUniqueFileName(&tmp_filename, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file name for ",
+                            filename, ".");
+  }
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env, tmp_filename, state));
+  return env->RenameFile(tmp_filename, filename);
+}
+
+}  // namespace data
+}  // namespace tensorflow
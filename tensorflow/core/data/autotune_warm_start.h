@@ -0,0 +1,87 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_AUTOTUNE_WARM_START_H_
+#define TENSORFLOW_CORE_DATA_AUTOTUNE_WARM_START_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+
+// Environment variable naming the directory in which the autotuning state of
+// input pipelines is persisted. Warm starting autotuning is disabled if the
+// variable is unset or empty.
+inline constexpr char kAutotuneWarmStartDirEnvVar[] =
+    "TF_DATA_AUTOTUNE_WARM_START_DIR";
+
+// Persists the tuned parameter values and per-node processing time statistics
+// of an autotuning model across runs of the same input pipeline, so that the
+// optimizer of the next run starts from the previously tuned configuration.
+//
+// The state is keyed by a fingerprint of the dataset graph. Statistics seeded
+// from a previous run are validated against fresh measurements and discarded
+// if they drifted (see `model::Model::WarmStart`).
+class AutotuneWarmStart {
+ public:
+  // Returns the warm start for `dataset`, or nullptr if warm starting is
+  // disabled or the dataset graph cannot be fingerprinted.
+  static std::unique_ptr<AutotuneWarmStart> Create(const DatasetBase* dataset);
+
+  // Returns the warm start for `dataset` persisted in `dir`.
+  static StatusOr<std::unique_ptr<AutotuneWarmStart>> Create(
+      const DatasetBase* dataset, const std::string& dir);
+
+  explicit AutotuneWarmStart(std::string filename)
+      : filename_(std::move(filename)) {}
+
+  // Seeds `model` with the persisted state, if there is one. Returns the
+  // number of seeded nodes.
+  StatusOr<int64_t> Load(model::Model& model) const;
+
+  // Persists the state of `model`, replacing any previously persisted state.
+  Status Save(model::Model& model) const;
+
+  // Like `Save`, but only snapshots the nodes of `model` in the calling
+  // thread. The snapshot is serialized and written by a background thread, so
+  // that the caller does not block on serialization or file IO. Errors are
+  // logged.
+  void SaveInBackground(std::shared_ptr<model::Model> model) const;
+
+  const std::string& filename() const { return filename_; }
+
+ private:
+  // Returns whether `state` should replace the previously persisted state.
+  static bool ShouldPersist(const model::ModelProto& state);
+
+  // Writes `state` to `filename`.
+  static Status Write(const std::string& filename,
+                      const model::ModelProto& state);
+
+  const std::string filename_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_AUTOTUNE_WARM_START_H_
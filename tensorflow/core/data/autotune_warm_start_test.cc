@@ -0,0 +1,130 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/autotune_warm_start.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tensorflow/core/framework/model.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Builds a model consisting of a parallel map node with an autotuned
+// parallelism that produced `num_elements` elements.
+std::unique_ptr<model::Model> ParallelMapModel(
+    std::shared_ptr<model::SharedState> parallelism, int64_t num_elements) {
+  auto model = std::make_unique<model::Model>();
+  std::shared_ptr<model::Node> node = model::MakeAsyncKnownRatioNode(
+      {0, "ParallelMapV2", nullptr}, /*ratio=*/1,
+      {model::MakeParameter("parallelism", parallelism, /*min=*/1,
+                            /*max=*/16)});
+  model->AddNode([&node](model::Node::Args args) { return node; },
+                 node->name(), nullptr, &node);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    node->record_element();
+    node->add_processing_time(1000);
+  }
+  return model;
+}
+
+std::string TestFilename() {
+  return io::JoinPath(testing::TmpDir(), "autotune_warm_start_test",
+                      "autotune_0123456789abcdef.pb");
+}
+
+TEST(AutotuneWarmStartTest, SaveAndLoad) {
+  AutotuneWarmStart warm_start(TestFilename());
+  auto saved_parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  saved_parallelism->value = 8;
+  std::unique_ptr<model::Model> saved_model =
+      ParallelMapModel(saved_parallelism, /*num_elements=*/1000);
+  TF_ASSERT_OK(warm_start.Save(*saved_model));
+
+  auto parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  std::unique_ptr<model::Model> model =
+      ParallelMapModel(parallelism, /*num_elements=*/0);
+  TF_ASSERT_OK_AND_ASSIGN(int64_t num_seeded_nodes, warm_start.Load(*model));
+  EXPECT_EQ(num_seeded_nodes, 1);
+  EXPECT_EQ(parallelism->value, 8);
+  // The recorded statistics are scaled down so that fresh measurements quickly
+  // outweigh them.
+  EXPECT_EQ(model->output()->num_elements(), 100);
+  EXPECT_EQ(model->output()->processing_time(), 100 * 1000);
+}
+
+TEST(AutotuneWarmStartTest, SaveInBackground) {
+  const std::string filename = io::JoinPath(
+      testing::TmpDir(), "autotune_warm_start_background_test.pb");
+  AutotuneWarmStart warm_start(filename);
+  auto parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  parallelism->value = 8;
+  warm_start.SaveInBackground(
+      ParallelMapModel(parallelism, /*num_elements=*/1000));
+  while (!Env::Default()->FileExists(filename).ok()) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+
+  auto loaded_parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  std::unique_ptr<model::Model> model =
+      ParallelMapModel(loaded_parallelism, /*num_elements=*/0);
+  TF_ASSERT_OK_AND_ASSIGN(int64_t num_seeded_nodes, warm_start.Load(*model));
+  EXPECT_EQ(num_seeded_nodes, 1);
+  EXPECT_EQ(loaded_parallelism->value, 8);
+}
+
+TEST(AutotuneWarmStartTest, LoadMissingState) {
+  AutotuneWarmStart warm_start(
+      io::JoinPath(testing::TmpDir(), "autotune_missing.pb"));
+  auto parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  std::unique_ptr<model::Model> model =
+      ParallelMapModel(parallelism, /*num_elements=*/0);
+  TF_ASSERT_OK_AND_ASSIGN(int64_t num_seeded_nodes, warm_start.Load(*model));
+  EXPECT_EQ(num_seeded_nodes, 0);
+  EXPECT_EQ(model->output()->num_elements(), 0);
+}
+
+TEST(AutotuneWarmStartTest, EmptyRunKeepsPersistedState) {
+  const std::string filename = io::JoinPath(
+      testing::TmpDir(), "autotune_warm_start_empty_run_test.pb");
+  AutotuneWarmStart warm_start(filename);
+  auto parallelism = std::make_shared<model::SharedState>(
+      model::kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  TF_ASSERT_OK(
+      warm_start.Save(*ParallelMapModel(parallelism, /*num_elements=*/0)));
+  EXPECT_TRUE(errors::IsNotFound(Env::Default()->FileExists(filename)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,586 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/compression_codecs.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
+
+#if !defined(IS_MOBILE_PLATFORM)
+#include "dictBuilder/zdict.h"
+#include "zstd.h"
+#endif  // !IS_MOBILE_PLATFORM
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Weight of the latest measurement in the selector's moving averages.
+constexpr double kSelectorSmoothing = 0.1;
+// One in this many choices re-measures a candidate other than the best one.
+constexpr int64_t kSelectorExplorationPeriod = 32;
+// 10Gbps.
+constexpr int64_t kDefaultWireBytesPerSecond = 1250 * 1000 * 1000;
+
+struct CodecEntry {
+  CompressionCodecRegistry::Factory factory;
+  std::unique_ptr<CompressionCodec> codec;
+};
+
+struct CodecRegistryState {
+  mutex mu;
+  absl::flat_hash_map<std::string, CodecEntry> codecs TF_GUARDED_BY(mu);
+};
+
+CodecRegistryState& codec_registry() {
+  static CodecRegistryState* state = new CodecRegistryState();
+  return *state;
+}
+
+class SnappyCodec : public CompressionCodec {
+ public:
+  absl::string_view Name() const override { return kSnappyCodec; }
+
+  Status Compress(const struct iovec* iov, size_t num_pieces, size_t num_bytes,
+                  std::string* output) const override {
+    if (num_bytes > kuint32max) {
+      return errors::OutOfRange("Encountered dataset element of size ",
+                                num_bytes, ", exceeding the 4GB Snappy limit.");
+    }
+    if (!port::Snappy_CompressFromIOVec(iov, num_bytes, output)) {
+      return errors::Internal("Failed to compress using snappy.");
+    }
+    return absl::OkStatus();
+  }
+
+  absl::StatusOr<size_t> UncompressedLength(
+      absl::string_view input) const override {
+    size_t uncompressed_size;
+    if (!port::Snappy_GetUncompressedLength(input.data(), input.size(),
+                                            &uncompressed_size)) {
+      return errors::Internal(
+          "Could not get snappy uncompressed length. Compressed data size: ",
+          input.size());
+    }
+    return uncompressed_size;
+  }
+
+  Status Uncompress(absl::string_view input, const struct iovec* iov,
+                    size_t num_pieces, size_t num_bytes) const override {
+    TF_ASSIGN_OR_RETURN(size_t uncompressed_size, UncompressedLength(input));
+    if (uncompressed_size != num_bytes) {
+      return errors::Internal("Uncompressed size mismatch. Snappy expects ",
+                              uncompressed_size,
+                              " whereas the tensor metadata suggests ",
+                              num_bytes);
+    }
+    if (!port::Snappy_UncompressToIOVec(input.data(), input.size(), iov,
+                                        num_pieces)) {
+      return errors::Internal("Failed to perform snappy decompression.");
+    }
+    return absl::OkStatus();
+  }
+};
+
+#if !defined(IS_MOBILE_PLATFORM)
+constexpr int kDefaultZstdLevel = 3;
+
+// Uncompression dictionaries, keyed by the dictionary ID zstd stores in each
+// frame.
+class ZstdDictionaries {
+ public:
+  static ZstdDictionaries& Get() {
+    static ZstdDictionaries* dictionaries = new ZstdDictionaries();
+    return *dictionaries;
+  }
+
+  absl::StatusOr<uint32_t> Register(absl::string_view dictionary) {
+    const uint32_t id =
+        ZSTD_getDictID_fromDict(dictionary.data(), dictionary.size());
+    if (id == 0) {
+      return errors::InvalidArgument(
+          "Not a zstd dictionary: the input has no dictionary ID.");
+    }
+    mutex_lock l(mu_);
+    if (dictionaries_.contains(id)) {
+      return id;
+    }
+    ZSTD_DDict* ddict = ZSTD_createDDict(dictionary.data(), dictionary.size());
+    if (ddict == nullptr) {
+      return errors::InvalidArgument("Failed to load zstd dictionary ", id);
+    }
+    dictionaries_[id] = ddict;
+    return id;
+  }
+
+  // Returns nullptr if no dictionary with `id` is registered. Dictionaries
+  // are never unregistered, so the result stays valid.
+  const ZSTD_DDict* Find(uint32_t id) const {
+    tf_shared_lock l(mu_);
+    auto it = dictionaries_.find(id);
+    return it == dictionaries_.end() ? nullptr : it->second;
+  }
+
+ private:
+  mutable mutex mu_;
+  absl::flat_hash_map<uint32_t, ZSTD_DDict*> dictionaries_ TF_GUARDED_BY(mu_);
+};
+
+// A free list of zstd contexts. Creating a context allocates its working
+// memory, so contexts are reused across calls.
+template <typename Context, Context* (*Create)(), size_t (*Free)(Context*)>
+class ZstdContextPool {
+ public:
+  ZstdContextPool() = default;
+  ZstdContextPool(const ZstdContextPool&) = delete;
+  ZstdContextPool& operator=(const ZstdContextPool&) = delete;
+
+  ~ZstdContextPool() {
+    for (Context* context : free_) {
+      Free(context);
+    }
+  }
+
+  // Returns a context, and whether it is newly created.
+  std::pair<Context*, bool> Acquire() {
+    {
+      mutex_lock l(mu_);
+      if (!free_.empty()) {
+        Context* context = free_.back();
+        free_.pop_back();
+        return {context, false};
+      }
+    }
+    return {Create(), true};
+  }
+
+  void Release(Context* context) {
+    mutex_lock l(mu_);
+    free_.push_back(context);
+  }
+
+ private:
+  mutex mu_;
+  std::vector<Context*> free_ TF_GUARDED_BY(mu_);
+};
+
+class ZstdCodec : public CompressionCodec {
+ public:
+  // Takes ownership of `cdict`, which may be null.
+  ZstdCodec(int level, ZSTD_CDict* cdict) : level_(level), cdict_(cdict) {}
+
+  ~ZstdCodec() override { ZSTD_freeCDict(cdict_); }
+
+  absl::string_view Name() const override { return kZstdCodec; }
+
+  Status Compress(const struct iovec* iov, size_t num_pieces, size_t num_bytes,
+                  std::string* output) const override {
+    auto [cctx, created] = cctx_pool_.Acquire();
+    if (cctx == nullptr) {
+      return errors::ResourceExhausted("Failed to create a zstd context.");
+    }
+    Status status = CompressWithContext(cctx, created, iov, num_pieces,
+                                        num_bytes, output);
+    if (status.ok()) {
+      cctx_pool_.Release(cctx);
+    } else {
+      ZSTD_freeCCtx(cctx);
+    }
+    return status;
+  }
+
+  absl::StatusOr<size_t> UncompressedLength(
+      absl::string_view input) const override {
+    const unsigned long long size =  // NOLINT(runtime/int)
+        ZSTD_getFrameContentSize(input.data(), input.size());
+    if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN) {
+      return errors::Internal(
+          "Could not get zstd uncompressed length. Compressed data size: ",
+          input.size());
+    }
+    return static_cast<size_t>(size);
+  }
+
+  Status Uncompress(absl::string_view input, const struct iovec* iov,
+                    size_t num_pieces, size_t num_bytes) const override {
+    TF_ASSIGN_OR_RETURN(size_t uncompressed_size, UncompressedLength(input));
+    if (uncompressed_size != num_bytes) {
+      return errors::Internal("Uncompressed size mismatch. Zstd expects ",
+                              uncompressed_size,
+                              " whereas the tensor metadata suggests ",
+                              num_bytes);
+    }
+    auto [dctx, created] = dctx_pool_.Acquire();
+    if (dctx == nullptr) {
+      return errors::ResourceExhausted("Failed to create a zstd context.");
+    }
+    Status status = UncompressWithContext(dctx, input, iov, num_pieces);
+    if (status.ok()) {
+      dctx_pool_.Release(dctx);
+    } else {
+      ZSTD_freeDCtx(dctx);
+    }
+    return status;
+  }
+
+ private:
+  Status CompressWithContext(ZSTD_CCtx* cctx, bool created,
+                             const struct iovec* iov, size_t num_pieces,
+                             size_t num_bytes, std::string* output) const {
+    if (created) {
+      size_t ret =
+          cdict_ != nullptr
+              ? ZSTD_CCtx_refCDict(cctx, cdict_)
+              : ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, level_);
+      TF_RETURN_IF_ERROR(ZstdStatus(ret, "configure compression"));
+    } else {
+      ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+    }
+    // Records the size in the frame header, which `UncompressedLength` reads.
+    TF_RETURN_IF_ERROR(ZstdStatus(ZSTD_CCtx_setPledgedSrcSize(cctx, num_bytes),
+                                  "set the source size"));
+    output->resize(ZSTD_compressBound(num_bytes));
+    ZSTD_outBuffer out = {output->data(), output->size(), 0};
+    for (size_t i = 0; i < num_pieces; ++i) {
+      ZSTD_inBuffer in = {iov[i].iov_base, iov[i].iov_len, 0};
+      while (in.pos < in.size) {
+        TF_RETURN_IF_ERROR(ZstdStatus(
+            ZSTD_compressStream2(cctx, &out, &in, ZSTD_e_continue),
+            "compress"));
+      }
+    }
+    ZSTD_inBuffer end = {nullptr, 0, 0};
+    size_t remaining;
+    do {
+      remaining = ZSTD_compressStream2(cctx, &out, &end, ZSTD_e_end);
+      TF_RETURN_IF_ERROR(ZstdStatus(remaining, "compress"));
+    } while (remaining != 0);
+    output->resize(out.pos);
+    return absl::OkStatus();
+  }
+
+  Status UncompressWithContext(ZSTD_DCtx* dctx, absl::string_view input,
+                               const struct iovec* iov,
+                               size_t num_pieces) const {
+    ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+    const uint32_t dictionary_id =
+        ZSTD_getDictID_fromFrame(input.data(), input.size());
+    if (dictionary_id != 0) {
+      const ZSTD_DDict* ddict =
+          ZstdDictionaries::Get().Find(dictionary_id);
+      if (ddict == nullptr) {
+        return errors::FailedPrecondition(
+            "The compressed data uses zstd dictionary ", dictionary_id,
+            ", which is not registered in this process. Call "
+            "RegisterZstdDictionary with the dictionary used for "
+            "compression.");
+      }
+      TF_RETURN_IF_ERROR(
+          ZstdStatus(ZSTD_DCtx_refDDict(dctx, ddict), "load dictionary"));
+    }
+    ZSTD_inBuffer in = {input.data(), input.size(), 0};
+    for (size_t i = 0; i < num_pieces; ++i) {
+      ZSTD_outBuffer out = {iov[i].iov_base, iov[i].iov_len, 0};
+      while (out.pos < out.size) {
+        const size_t in_pos = in.pos;
+        const size_t out_pos = out.pos;
+        TF_RETURN_IF_ERROR(
+            ZstdStatus(ZSTD_decompressStream(dctx, &out, &in), "uncompress"));
+        if (in.pos == in_pos && out.pos == out_pos) {
+          return errors::DataLoss("Truncated zstd frame.");
+        }
+      }
+    }
+    return absl::OkStatus();
+  }
+
+  static Status ZstdStatus(size_t ret, absl::string_view action) {
+    if (ZSTD_isError(ret)) {
+      return errors::Internal("Failed to ", action, " using zstd: ",
+                              ZSTD_getErrorName(ret));
+    }
+    return absl::OkStatus();
+  }
+
+  const int level_;
+  ZSTD_CDict* const cdict_;
+  mutable ZstdContextPool<ZSTD_CCtx, ZSTD_createCCtx, ZSTD_freeCCtx>
+      cctx_pool_;
+  mutable ZstdContextPool<ZSTD_DCtx, ZSTD_createDCtx, ZSTD_freeDCtx>
+      dctx_pool_;
+};
+
+absl::StatusOr<std::unique_ptr<CompressionCodec>> CreateZstdCodec(
+    int level, absl::string_view dictionary) {
+  if (level < ZSTD_minCLevel() || level > ZSTD_maxCLevel()) {
+    return errors::InvalidArgument("zstd compression level must be in [",
+                                   ZSTD_minCLevel(), ", ", ZSTD_maxCLevel(),
+                                   "], got ", level);
+  }
+  ZSTD_CDict* cdict = nullptr;
+  if (!dictionary.empty()) {
+    TF_RETURN_IF_ERROR(RegisterZstdDictionary(dictionary).status());
+    cdict = ZSTD_createCDict(dictionary.data(), dictionary.size(), level);
+    if (cdict == nullptr) {
+      return errors::InvalidArgument("Failed to load zstd dictionary.");
+    }
+  }
+  return std::make_unique<ZstdCodec>(level, cdict);
+}
+
+REGISTER_COMPRESSION_CODEC(kZstdCodec, []() {
+  return std::make_unique<ZstdCodec>(kDefaultZstdLevel, /*cdict=*/nullptr);
+});
+#endif  // !IS_MOBILE_PLATFORM
+
+REGISTER_COMPRESSION_CODEC(kSnappyCodec,
+                           []() { return std::make_unique<SnappyCodec>(); });
+
+}  // namespace
+
+Status CompressionCodec::Compress(absl::string_view input,
+                                  std::string* output) const {
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(input.data());
+  iov.iov_len = input.size();
+  return Compress(&iov, /*num_pieces=*/1, input.size(), output);
+}
+
+Status CompressionCodec::Uncompress(absl::string_view input,
+                                    std::string* output) const {
+  TF_ASSIGN_OR_RETURN(size_t uncompressed_size, UncompressedLength(input));
+  output->resize(uncompressed_size);
+  struct iovec iov;
+  iov.iov_base = output->data();
+  iov.iov_len = output->size();
+  return Uncompress(input, &iov, /*num_pieces=*/1, uncompressed_size);
+}
+
+void CompressionCodecRegistry::Register(const std::string& name,
+                                        Factory factory) {
+  Status s = TryRegister(name, std::move(factory));
+  CHECK(s.ok()) << s;  // Crash OK
+}
+
+Status CompressionCodecRegistry::TryRegister(const std::string& name,
+                                             Factory factory) {
+  CodecRegistryState& registry = codec_registry();
+  mutex_lock l(registry.mu);
+  if (registry.codecs.contains(name)) {
+    return errors::AlreadyExists("Compression codec ", name,
+                                 " is registered twice.");
+  }
+  registry.codecs[name].factory = std::move(factory);
+  return absl::OkStatus();
+}
+
+absl::StatusOr<const CompressionCodec*> CompressionCodecRegistry::Get(
+    absl::string_view name) {
+  CodecRegistryState& registry = codec_registry();
+  mutex_lock l(registry.mu);
+  auto it = registry.codecs.find(name);
+  if (it == registry.codecs.end()) {
+    return errors::NotFound("Compression codec ", name,
+                            " is not registered.");
+  }
+  CodecEntry& entry = it->second;
+  if (entry.codec == nullptr) {
+    entry.codec = entry.factory();
+  }
+  return entry.codec.get();
+}
+
+std::vector<std::string> CompressionCodecRegistry::Names() {
+  CodecRegistryState& registry = codec_registry();
+  mutex_lock l(registry.mu);
+  std::vector<std::string> names;
+  names.reserve(registry.codecs.size());
+  for (const auto& [name, entry] : registry.codecs) {
+    names.push_back(name);
+  }
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+Status RegisterZstdCodec(const std::string& name, int level,
+                         absl::string_view dictionary) {
+#if defined(IS_MOBILE_PLATFORM)
+  return errors::Unimplemented("zstd is not supported on mobile platforms.");
+#else
+  // Validates the level and the dictionary before registering the factory.
+  TF_RETURN_IF_ERROR(CreateZstdCodec(level, dictionary).status());
+  return CompressionCodecRegistry::TryRegister(
+      name, [level, dictionary = std::string(dictionary)]() {
+        absl::StatusOr<std::unique_ptr<CompressionCodec>> codec =
+            CreateZstdCodec(level, dictionary);
+        CHECK(codec.ok()) << codec.status();  // Crash OK
+        return *std::move(codec);
+      });
+#endif  // IS_MOBILE_PLATFORM
+}
+
+absl::StatusOr<uint32_t> RegisterZstdDictionary(absl::string_view dictionary) {
+#if defined(IS_MOBILE_PLATFORM)
+  return errors::Unimplemented("zstd is not supported on mobile platforms.");
+#else
+  return ZstdDictionaries::Get().Register(dictionary);
+#endif  // IS_MOBILE_PLATFORM
+}
+
+absl::StatusOr<std::string> TrainZstdDictionary(
+    const std::vector<std::string>& samples, size_t max_dictionary_bytes) {
+#if defined(IS_MOBILE_PLATFORM)
+  return errors::Unimplemented("zstd is not supported on mobile platforms.");
+#else
+  std::string concatenated;
+  std::vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (const std::string& sample : samples) {
+    concatenated.append(sample);
+    sample_sizes.push_back(sample.size());
+  }
+  std::string dictionary(max_dictionary_bytes, '\0');
+  const size_t size = ZDICT_trainFromBuffer(
+      dictionary.data(), dictionary.size(), concatenated.data(),
+      sample_sizes.data(), static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(size)) {
+    return errors::InvalidArgument("Failed to train a zstd dictionary from ",
+                                   samples.size(),
+                                   " samples: ", ZDICT_getErrorName(size));
+  }
+  dictionary.resize(size);
+  return dictionary;
+#endif  // IS_MOBILE_PLATFORM
+}
+
+CompressionCodecSelector::CompressionCodecSelector(
+    std::vector<const CompressionCodec*> candidates,
+    double wire_bytes_per_second)
+    : candidates_(std::move(candidates)),
+      wire_ns_per_byte_(1e9 / wire_bytes_per_second),
+      estimates_(candidates_.size()) {
+  DCHECK(!candidates_.empty());
+}
+
+CompressionCodecSelector& CompressionCodecSelector::Global() {
+  static CompressionCodecSelector* selector = []() {
+    int64_t wire_bytes_per_second;
+    Status s = ReadInt64FromEnvVar("TF_DATA_COMPRESSION_WIRE_BYTES_PER_SECOND",
+                                   kDefaultWireBytesPerSecond,
+                                   &wire_bytes_per_second);
+    if (!s.ok() || wire_bytes_per_second <= 0) {
+      LOG(WARNING) << "Ignoring invalid "
+                   << "TF_DATA_COMPRESSION_WIRE_BYTES_PER_SECOND: " << s;
+      wire_bytes_per_second = kDefaultWireBytesPerSecond;
+    }
+    std::vector<const CompressionCodec*> candidates;
+    for (const char* name : {kSnappyCodec, kZstdCodec}) {
+      // zstd is not available on mobile platforms.
+      absl::StatusOr<const CompressionCodec*> codec =
+          CompressionCodecRegistry::Get(name);
+      if (codec.ok()) {
+        candidates.push_back(*codec);
+      }
+    }
+    return new CompressionCodecSelector(std::move(candidates),
+                                        wire_bytes_per_second);
+  }();
+  return *selector;
+}
+
+const CompressionCodec* CompressionCodecSelector::Choose() {
+  mutex_lock l(mu_);
+  ++num_choices_;
+  size_t best = 0;
+  for (size_t i = 0; i < candidates_.size(); ++i) {
+    if (estimates_[i].num_samples == 0) {
+      return candidates_[i];
+    }
+    if (Cost(estimates_[i]) < Cost(estimates_[best])) {
+      best = i;
+    }
+  }
+  if (candidates_.size() > 1 &&
+      num_choices_ % kSelectorExplorationPeriod == 0) {
+    // Cycles through the other candidates so that each is re-measured.
+    size_t other = (num_choices_ / kSelectorExplorationPeriod) %
+                   (candidates_.size() - 1);
+    return candidates_[other >= best ? other + 1 : other];
+  }
+  return candidates_[best];
+}
+
+void CompressionCodecSelector::Record(const CompressionCodec* codec,
+                                      size_t uncompressed_bytes,
+                                      size_t compressed_bytes,
+                                      int64_t duration_ns) {
+  if (uncompressed_bytes == 0) {
+    return;
+  }
+  auto it = std::find(candidates_.begin(), candidates_.end(), codec);
+  if (it == candidates_.end()) {
+    return;
+  }
+  const double ns_per_byte =
+      static_cast<double>(std::max<int64_t>(duration_ns, 0)) /
+      uncompressed_bytes;
+  const double ratio =
+      static_cast<double>(compressed_bytes) / uncompressed_bytes;
+  mutex_lock l(mu_);
+  Estimate& estimate = estimates_[it - candidates_.begin()];
+  const double weight =
+      estimate.num_samples == 0 ? 1.0 : kSelectorSmoothing;
+  estimate.ns_per_byte += weight * (ns_per_byte - estimate.ns_per_byte);
+  estimate.compression_ratio +=
+      weight * (ratio - estimate.compression_ratio);
+  ++estimate.num_samples;
+}
+
+std::optional<double> CompressionCodecSelector::EstimatedCost(
+    const CompressionCodec* codec) const {
+  auto it = std::find(candidates_.begin(), candidates_.end(), codec);
+  if (it == candidates_.end()) {
+    return std::nullopt;
+  }
+  tf_shared_lock l(mu_);
+  const Estimate& estimate = estimates_[it - candidates_.begin()];
+  if (estimate.num_samples == 0) {
+    return std::nullopt;
+  }
+  return Cost(estimate);
+}
+
+double CompressionCodecSelector::Cost(const Estimate& estimate) const {
+  return estimate.ns_per_byte + estimate.compression_ratio * wire_ns_per_byte_;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,184 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_COMPRESSION_CODECS_H_
+#define TENSORFLOW_CORE_DATA_COMPRESSION_CODECS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/snappy.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Names of the built-in codecs.
+inline constexpr char kSnappyCodec[] = "SNAPPY";
+inline constexpr char kZstdCodec[] = "ZSTD";
+
+// A compression algorithm usable by `CompressElement` and snapshot writers.
+//
+// Codecs operate on scatter/gather lists so that tensor buffers can be
+// compressed from, and uncompressed into, without intermediate copies.
+// Implementations must be thread-safe.
+class CompressionCodec {
+ public:
+  virtual ~CompressionCodec() = default;
+
+  // The name the codec is registered under. It is recorded next to the
+  // compressed bytes so that readers can pick the matching codec.
+  virtual absl::string_view Name() const = 0;
+
+  // Compresses the `num_bytes` bytes spread across `iov[0, num_pieces)` into
+  // `output`, replacing its contents.
+  virtual Status Compress(const struct iovec* iov, size_t num_pieces,
+                          size_t num_bytes, std::string* output) const = 0;
+
+  // Returns the uncompressed size of `input`.
+  virtual absl::StatusOr<size_t> UncompressedLength(
+      absl::string_view input) const = 0;
+
+  // Uncompresses `input` into `iov[0, num_pieces)`, which must hold exactly
+  // `num_bytes` bytes in total.
+  virtual Status Uncompress(absl::string_view input, const struct iovec* iov,
+                            size_t num_pieces, size_t num_bytes) const = 0;
+
+  // Convenience wrappers for contiguous buffers.
+  Status Compress(absl::string_view input, std::string* output) const;
+  Status Uncompress(absl::string_view input, std::string* output) const;
+};
+
+// Registry of the codecs available in this process, keyed by name.
+class CompressionCodecRegistry {
+ public:
+  using Factory = std::function<std::unique_ptr<CompressionCodec>()>;
+
+  // Registers a codec. The codec is created on first use. Crashes if a codec
+  // is already registered as `name`.
+  static void Register(const std::string& name, Factory factory);
+
+  // Like `Register`, but returns AlreadyExists instead of crashing.
+  static Status TryRegister(const std::string& name, Factory factory);
+
+  // Returns the codec registered as `name`, or NotFound. The codec is owned
+  // by the registry and lives for the lifetime of the process.
+  static absl::StatusOr<const CompressionCodec*> Get(absl::string_view name);
+
+  // Returns the names of all registered codecs, in sorted order.
+  static std::vector<std::string> Names();
+};
+
+// Helper class to register a codec.
+class CompressionCodecRegistrar {
+ public:
+  CompressionCodecRegistrar(const std::string& name,
+                            CompressionCodecRegistry::Factory factory) {
+    CompressionCodecRegistry::Register(name, std::move(factory));
+  }
+};
+
+// Macro that can be used to register a compression codec.
+#define REGISTER_COMPRESSION_CODEC(name, factory) \
+  REGISTER_COMPRESSION_CODEC_UNIQ_HELPER(__COUNTER__, name, factory)
+
+#define REGISTER_COMPRESSION_CODEC_UNIQ_HELPER(ctr, name, factory) \
+  REGISTER_COMPRESSION_CODEC_UNIQ(ctr, name, factory)
+
+#define REGISTER_COMPRESSION_CODEC_UNIQ(ctr, name, factory) \
+  static ::tensorflow::data::CompressionCodecRegistrar      \
+      compression_codec_registrar__body__##ctr##__object(name, factory)
+
+// Registers as `name` a zstd codec that compresses at `level`, e.g. to use it
+// as the compression of snapshots. If `dictionary` is not empty, it is used
+// for compression and registered with `RegisterZstdDictionary` so that this
+// process can read back what it wrote. Other processes reading the output
+// must register the same dictionary.
+//
+// The codec reports its name as "ZSTD", so its output can be uncompressed by
+// the registered "ZSTD" codec. zstd is not available on mobile platforms,
+// where the zstd functions return Unimplemented.
+Status RegisterZstdCodec(const std::string& name, int level,
+                         absl::string_view dictionary = "");
+
+// Makes `dictionary` available for uncompressing zstd frames that reference
+// it. Returns the dictionary ID embedded in the frames. Registering the same
+// dictionary twice is a no-op.
+absl::StatusOr<uint32_t> RegisterZstdDictionary(absl::string_view dictionary);
+
+// Trains a zstd dictionary of at most `max_dictionary_bytes` from `samples`,
+// e.g. a few thousand serialized elements of a dataset.
+absl::StatusOr<std::string> TrainZstdDictionary(
+    const std::vector<std::string>& samples, size_t max_dictionary_bytes);
+
+// Chooses among `candidates` the codec that minimizes the time spent
+// compressing plus the time the compressed bytes take on the wire, using
+// moving averages of recent measurements. A fraction of the choices is spent
+// re-measuring the other candidates so that the choice follows changes in the
+// data. Thread-safe.
+class CompressionCodecSelector {
+ public:
+  // `wire_bytes_per_second` is the expected throughput of the link that
+  // carries the compressed bytes.
+  CompressionCodecSelector(std::vector<const CompressionCodec*> candidates,
+                           double wire_bytes_per_second);
+
+  // Returns the selector used by `CompressElement` for data service
+  // transfers. Its candidates are "SNAPPY" and "ZSTD", and the wire throughput
+  // is read from the TF_DATA_COMPRESSION_WIRE_BYTES_PER_SECOND environment
+  // variable (defaults to 10Gbps).
+  static CompressionCodecSelector& Global();
+
+  // Returns the codec to use for the next compression.
+  const CompressionCodec* Choose();
+
+  // Records that `codec` compressed `uncompressed_bytes` bytes into
+  // `compressed_bytes` bytes in `duration_ns` nanoseconds.
+  void Record(const CompressionCodec* codec, size_t uncompressed_bytes,
+              size_t compressed_bytes, int64_t duration_ns);
+
+  // Returns the estimated cost of `codec` in nanoseconds per uncompressed
+  // byte, or nullopt if it has not been measured yet.
+  std::optional<double> EstimatedCost(const CompressionCodec* codec) const;
+
+ private:
+  struct Estimate {
+    int64_t num_samples = 0;
+    double ns_per_byte = 0.0;
+    double compression_ratio = 1.0;
+  };
+
+  double Cost(const Estimate& estimate) const;
+
+  const std::vector<const CompressionCodec*> candidates_;
+  const double wire_ns_per_byte_;
+
+  mutable mutex mu_;
+  std::vector<Estimate> estimates_ TF_GUARDED_BY(mu_);
+  int64_t num_choices_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_COMPRESSION_CODECS_H_
@@ -0,0 +1,245 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/compression_codecs.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+#include "tsl/platform/status_matchers.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::DoubleNear;
+using ::testing::IsSupersetOf;
+using ::testing::Optional;
+using ::tsl::testing::StatusIs;
+
+std::string TestData() {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    absl::StrAppend(&data, "element ", i % 17, ";");
+  }
+  return data;
+}
+
+class CompressionCodecTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(CompressionCodecTest, RoundTrip) {
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* codec,
+                          CompressionCodecRegistry::Get(GetParam()));
+  EXPECT_EQ(codec->Name(), GetParam());
+  const std::string data = TestData();
+  std::string compressed;
+  TF_ASSERT_OK(codec->Compress(data, &compressed));
+  EXPECT_LT(compressed.size(), data.size());
+  TF_ASSERT_OK_AND_ASSIGN(size_t uncompressed_size,
+                          codec->UncompressedLength(compressed));
+  EXPECT_EQ(uncompressed_size, data.size());
+  std::string uncompressed;
+  TF_ASSERT_OK(codec->Uncompress(compressed, &uncompressed));
+  EXPECT_EQ(uncompressed, data);
+}
+
+TEST_P(CompressionCodecTest, ScatterGather) {
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* codec,
+                          CompressionCodecRegistry::Get(GetParam()));
+  std::string pieces[] = {"abc", "", std::string(5000, 'x'), "defg"};
+  std::vector<struct iovec> iov;
+  size_t num_bytes = 0;
+  for (std::string& piece : pieces) {
+    iov.push_back({piece.data(), piece.size()});
+    num_bytes += piece.size();
+  }
+  std::string compressed;
+  TF_ASSERT_OK(codec->Compress(iov.data(), iov.size(), num_bytes, &compressed));
+
+  std::string out[] = {std::string(3, '\0'), "", std::string(5000, '\0'),
+                       std::string(4, '\0')};
+  std::vector<struct iovec> out_iov;
+  for (std::string& piece : out) {
+    out_iov.push_back({piece.data(), piece.size()});
+  }
+  TF_ASSERT_OK(
+      codec->Uncompress(compressed, out_iov.data(), out_iov.size(), num_bytes));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(out[i], pieces[i]);
+  }
+}
+
+TEST_P(CompressionCodecTest, SizeMismatch) {
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* codec,
+                          CompressionCodecRegistry::Get(GetParam()));
+  std::string compressed;
+  TF_ASSERT_OK(codec->Compress("abcdef", &compressed));
+  std::string out(3, '\0');
+  struct iovec iov = {out.data(), out.size()};
+  EXPECT_THAT(codec->Uncompress(compressed, &iov, 1, out.size()),
+              StatusIs(error::INTERNAL));
+}
+
+INSTANTIATE_TEST_SUITE_P(Codecs, CompressionCodecTest,
+                         ::testing::Values(kSnappyCodec, kZstdCodec));
+
+TEST(CompressionCodecRegistryTest, Names) {
+  // Other tests register more codecs.
+  EXPECT_THAT(CompressionCodecRegistry::Names(),
+              IsSupersetOf({kSnappyCodec, kZstdCodec}));
+}
+
+TEST(CompressionCodecRegistryTest, NotFound) {
+  EXPECT_THAT(CompressionCodecRegistry::Get("LZMA"),
+              StatusIs(error::NOT_FOUND));
+}
+
+TEST(ZstdCodecTest, Levels) {
+  const std::string data = TestData();
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* zstd,
+                          CompressionCodecRegistry::Get(kZstdCodec));
+  for (int level : {1, 19}) {
+    const std::string name = absl::StrCat("ZSTD_LEVEL_", level);
+    TF_ASSERT_OK(RegisterZstdCodec(name, level));
+    TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* codec,
+                            CompressionCodecRegistry::Get(name));
+    EXPECT_EQ(codec->Name(), kZstdCodec);
+    std::string compressed;
+    TF_ASSERT_OK(codec->Compress(data, &compressed));
+    std::string uncompressed;
+    TF_ASSERT_OK(zstd->Uncompress(compressed, &uncompressed));
+    EXPECT_EQ(uncompressed, data);
+  }
+  EXPECT_THAT(RegisterZstdCodec("ZSTD_LEVEL_1000", 1000),
+              StatusIs(error::INVALID_ARGUMENT));
+  EXPECT_THAT(CompressionCodecRegistry::Get("ZSTD_LEVEL_1000"),
+              StatusIs(error::NOT_FOUND));
+  EXPECT_THAT(RegisterZstdCodec("ZSTD_LEVEL_1", 1),
+              StatusIs(error::ALREADY_EXISTS));
+}
+
+TEST(ZstdCodecTest, Dictionary) {
+  std::vector<std::string> samples;
+  for (int i = 0; i < 2000; ++i) {
+    samples.push_back(absl::StrCat("{\"user\": ", i,
+                                   ", \"country\": \"CH\", \"label\": ",
+                                   i % 3, "}"));
+  }
+  TF_ASSERT_OK_AND_ASSIGN(std::string dictionary,
+                          TrainZstdDictionary(samples, 1024));
+  TF_ASSERT_OK(RegisterZstdCodec("ZSTD_DICTIONARY", 3, dictionary));
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* with_dictionary,
+                          CompressionCodecRegistry::Get("ZSTD_DICTIONARY"));
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* zstd,
+                          CompressionCodecRegistry::Get(kZstdCodec));
+
+  const std::string& sample = samples[42];
+  std::string with_dictionary_compressed, without_dictionary_compressed;
+  TF_ASSERT_OK(with_dictionary->Compress(sample, &with_dictionary_compressed));
+  TF_ASSERT_OK(zstd->Compress(sample, &without_dictionary_compressed));
+  EXPECT_LT(with_dictionary_compressed.size(),
+            without_dictionary_compressed.size());
+
+  // The dictionary is registered, so the default codec can read the output.
+  std::string uncompressed;
+  TF_ASSERT_OK(zstd->Uncompress(with_dictionary_compressed, &uncompressed));
+  EXPECT_EQ(uncompressed, sample);
+}
+
+TEST(ZstdCodecTest, NotADictionary) {
+  EXPECT_THAT(RegisterZstdDictionary("not a dictionary"),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+// Pretends to compress, so that the selector test controls the measurements.
+class FakeCodec : public CompressionCodec {
+ public:
+  explicit FakeCodec(absl::string_view name) : name_(name) {}
+  absl::string_view Name() const override { return name_; }
+  Status Compress(const struct iovec* iov, size_t num_pieces, size_t num_bytes,
+                  std::string* output) const override {
+    return absl::OkStatus();
+  }
+  absl::StatusOr<size_t> UncompressedLength(
+      absl::string_view input) const override {
+    return 0;
+  }
+  Status Uncompress(absl::string_view input, const struct iovec* iov,
+                    size_t num_pieces, size_t num_bytes) const override {
+    return absl::OkStatus();
+  }
+
+ private:
+  const std::string name_;
+};
+
+TEST(CompressionCodecSelectorTest, MeasuresEachCandidateFirst) {
+  FakeCodec fast("fast"), small("small");
+  CompressionCodecSelector selector({&fast, &small},
+                                    /*wire_bytes_per_second=*/1e9);
+  EXPECT_EQ(selector.Choose(), &fast);
+  selector.Record(&fast, 1000, 1000, 100);
+  EXPECT_EQ(selector.Choose(), &small);
+  EXPECT_EQ(selector.EstimatedCost(&small), std::nullopt);
+}
+
+TEST(CompressionCodecSelectorTest, TradesCpuForBytes) {
+  FakeCodec fast("fast"), small("small");
+  // 1 byte per nanosecond on the wire.
+  CompressionCodecSelector selector({&fast, &small},
+                                    /*wire_bytes_per_second=*/1e9);
+  // `fast` costs 0.1 + 1.0 ns per byte, `small` costs 0.5 + 0.2 ns per byte.
+  selector.Record(&fast, 1000, 1000, 100);
+  selector.Record(&small, 1000, 200, 500);
+  EXPECT_THAT(selector.EstimatedCost(&fast), Optional(DoubleNear(1.1, 1e-9)));
+  EXPECT_THAT(selector.EstimatedCost(&small), Optional(DoubleNear(0.7, 1e-9)));
+  int num_small = 0;
+  for (int i = 0; i < 100; ++i) {
+    num_small += selector.Choose() == &small;
+  }
+  // Some choices go to re-measuring `fast`.
+  EXPECT_GT(num_small, 90);
+  EXPECT_LT(num_small, 100);
+
+  // On a 100 times faster wire, the bytes matter less than the CPU time.
+  CompressionCodecSelector fast_wire({&fast, &small},
+                                     /*wire_bytes_per_second=*/1e11);
+  fast_wire.Record(&fast, 1000, 1000, 100);
+  fast_wire.Record(&small, 1000, 200, 500);
+  EXPECT_EQ(fast_wire.Choose(), &fast);
+}
+
+TEST(CompressionCodecSelectorTest, FollowsMeasurements) {
+  FakeCodec fast("fast"), small("small");
+  CompressionCodecSelector selector({&fast, &small},
+                                    /*wire_bytes_per_second=*/1e9);
+  selector.Record(&fast, 1000, 1000, 100);
+  selector.Record(&small, 1000, 200, 500);
+  // The data stops compressing well, so `small` no longer pays off.
+  for (int i = 0; i < 100; ++i) {
+    selector.Record(&small, 1000, 1000, 500);
+  }
+  EXPECT_EQ(selector.Choose(), &fast);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -18,12 +18,15 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant_op_registry.h"
 #include "tensorflow/core/platform/errors.h"
-#include "tensorflow/core/platform/snappy.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/types.h"
 
@@ -34,7 +37,10 @@ namespace {
 // Increment this when making changes to the `CompressedElement` proto. The
 // `UncompressElement` function will determine what to read according to the
 // version.
-constexpr int kCompressedElementVersion = 0;
+constexpr int kCompressedElementVersion = 1;
+// Snappy-compressed elements keep the version that predates the `codec` field
+// so that older readers can still uncompress them.
+constexpr int kSnappyCompressedElementVersion = 0;
 
 }  // namespace
 
@@ -63,6 +69,13 @@ class Iov {
 
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out) {
+  TF_ASSIGN_OR_RETURN(const CompressionCodec* snappy,
+                      CompressionCodecRegistry::Get(kSnappyCodec));
+  return CompressElement(element, *snappy, out);
+}
+
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionCodec& codec, CompressedElement* out) {
   // First pass: preprocess the non`memcpy`able tensors.
   size_t num_string_tensors = 0;
   size_t num_string_tensor_strings = 0;
@@ -120,16 +133,14 @@ Status CompressElement(const std::vector<Tensor>& element,
     }
   }
 
-  if (iov.NumBytes() > kuint32max) {
-    return errors::OutOfRange("Encountered dataset element of size ",
-                              iov.NumBytes(),
-                              ", exceeding the 4GB Snappy limit.");
+  TF_RETURN_IF_ERROR(codec.Compress(iov.Data(), iov.NumPieces(),
+                                    iov.NumBytes(), out->mutable_data()));
+  if (codec.Name() == kSnappyCodec) {
+    out->set_version(kSnappyCompressedElementVersion);
+  } else {
+    out->set_version(kCompressedElementVersion);
+    out->set_codec(std::string(codec.Name()));
   }
-  if (!port::Snappy_CompressFromIOVec(iov.Data(), iov.NumBytes(),
-                                      out->mutable_data())) {
-    return errors::Internal("Failed to compress using snappy.");
-  }
-  out->set_version(kCompressedElementVersion);
   VLOG(3) << "Compressed element from " << iov.NumBytes() << " bytes to "
           << out->data().size() << " bytes";
   return absl::OkStatus();
@@ -137,10 +148,21 @@ Status CompressElement(const std::vector<Tensor>& element,
 
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out) {
-  if (compressed.version() != kCompressedElementVersion) {
+  absl::string_view codec_name;
+  if (compressed.version() == kSnappyCompressedElementVersion) {
+    codec_name = kSnappyCodec;
+  } else if (compressed.version() == kCompressedElementVersion) {
+    codec_name = compressed.codec();
+  } else {
     return errors::Internal("Unsupported compressed element version: ",
                             compressed.version());
   }
+  absl::StatusOr<const CompressionCodec*> codec =
+      CompressionCodecRegistry::Get(codec_name);
+  if (!codec.ok()) {
+    return errors::Internal("Unsupported compression codec \"", codec_name,
+                            "\": ", codec.status().message());
+  }
   int num_components = compressed.component_metadata_size();
   out->clear();
   out->reserve(num_components);
@@ -190,24 +212,8 @@ Status UncompressElement(const CompressedElement& compressed,
   }
 
   // Step 2: Uncompress into the iovec.
-  const std::string& compressed_data = compressed.data();
-  size_t uncompressed_size;
-  if (!port::Snappy_GetUncompressedLength(
-          compressed_data.data(), compressed_data.size(), &uncompressed_size)) {
-    return errors::Internal(
-        "Could not get snappy uncompressed length. Compressed data size: ",
-        compressed_data.size());
-  }
-  if (uncompressed_size != static_cast<size_t>(iov.NumBytes())) {
-    return errors::Internal(
-        "Uncompressed size mismatch. Snappy expects ", uncompressed_size,
-        " whereas the tensor metadata suggests ", iov.NumBytes());
-  }
-  if (!port::Snappy_UncompressToIOVec(compressed_data.data(),
-                                      compressed_data.size(), iov.Data(),
-                                      iov.NumPieces())) {
-    return errors::Internal("Failed to perform snappy decompression.");
-  }
+  TF_RETURN_IF_ERROR((*codec)->Uncompress(compressed.data(), iov.Data(),
+                                          iov.NumPieces(), iov.NumBytes()));
 
   // Third pass: deserialize nonstring, non`memcpy`able tensors.
   nonmemcpyable_pos = nonmemcpyable.mdata();
@@ -231,6 +237,15 @@ Status UncompressElement(const CompressedElement& compressed,
   return absl::OkStatus();
 }
 
+const CompressedElement* GetCompressedElement(
+    const std::vector<Tensor>& element) {
+  if (element.size() != 1 || element[0].dtype() != DT_VARIANT ||
+      !TensorShapeUtils::IsScalar(element[0].shape())) {
+    return nullptr;
+  }
+  return element[0].scalar<Variant>()().get<CompressedElement>();
+}
+
 REGISTER_UNARY_VARIANT_DECODE_FUNCTION(CompressedElement,
                                        "tensorflow.data.CompressedElement");
 
@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <vector>
 
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/framework/dataset.pb.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/platform/status.h"
@@ -33,10 +34,21 @@ namespace data {
 Status CompressElement(const std::vector<Tensor>& element,
                        CompressedElement* out);
 
+// Like above, but compresses with `codec` instead of snappy. The codec name is
+// recorded in `out` so that `UncompressElement` can find it in the
+// `CompressionCodecRegistry`.
+Status CompressElement(const std::vector<Tensor>& element,
+                       const CompressionCodec& codec, CompressedElement* out);
+
 // Uncompresses a `CompressedElement` into a vector of tensor components.
 Status UncompressElement(const CompressedElement& compressed,
                          std::vector<Tensor>* out);
 
+// Returns the `CompressedElement` held by `element`, or nullptr if `element`
+// is not a single scalar `CompressedElement` tensor.
+const CompressedElement* GetCompressedElement(
+    const std::vector<Tensor>& element);
+
 }  // namespace data
 }  // namespace tensorflow
 
@@ -17,11 +17,13 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/data/dataset_test_base.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 #include "tsl/platform/status_matchers.h"
+#include "tsl/platform/statusor.h"
 
 namespace tensorflow {
 namespace data {
@@ -104,6 +106,33 @@ TEST_P(ParameterizedCompressionUtilsTest, VersionMismatch) {
               StatusIs(error::INTERNAL));
 }
 
+TEST_P(ParameterizedCompressionUtilsTest, ZstdRoundTrip) {
+  std::vector<Tensor> element = GetParam();
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* zstd,
+                          CompressionCodecRegistry::Get(kZstdCodec));
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, *zstd, &compressed));
+  EXPECT_EQ(compressed.version(), 1);
+  EXPECT_EQ(compressed.codec(), kZstdCodec);
+  std::vector<Tensor> round_trip_element;
+  TF_ASSERT_OK(UncompressElement(compressed, &round_trip_element));
+  TF_EXPECT_OK(
+      ExpectEqual(element, round_trip_element, /*compare_order=*/true));
+}
+
+TEST_P(ParameterizedCompressionUtilsTest, UnknownCodec) {
+  std::vector<Tensor> element = GetParam();
+  TF_ASSERT_OK_AND_ASSIGN(const CompressionCodec* zstd,
+                          CompressionCodecRegistry::Get(kZstdCodec));
+  CompressedElement compressed;
+  TF_ASSERT_OK(CompressElement(element, *zstd, &compressed));
+
+  compressed.set_codec("LZMA");
+  std::vector<Tensor> round_trip_element;
+  EXPECT_THAT(UncompressElement(compressed, &round_trip_element),
+              StatusIs(error::INTERNAL, HasSubstr("LZMA")));
+}
+
 INSTANTIATE_TEST_SUITE_P(Instantiation, ParameterizedCompressionUtilsTest,
                          ::testing::ValuesIn(TestCases()));
 
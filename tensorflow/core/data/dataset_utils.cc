@@ -19,6 +19,7 @@ limitations under the License.
 #include <array>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <queue>
@@ -32,6 +33,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/strings/str_join.h"
 #include "tensorflow/core/common_runtime/function.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/function.h"
@@ -50,6 +52,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/platform/host_info.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/regexp.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/tstring.h"
@@ -787,6 +790,77 @@ Status ProcessBatch(int64_t batch_size, int64_t num_elements,
   return absl::OkStatus();
 }
 
+namespace {
+
+// Components whose elements have at most this many bytes are gathered into the
+// batch column by column instead of with one `CopyElementToSlice` call per
+// element.
+constexpr int64_t kMaxColumnarElementBytes = 64;
+
+// Returns whether component `component_index` of the batch can be gathered by
+// copying the raw bytes of each element.
+bool CanGatherColumn(const std::vector<std::vector<Tensor>>& batch_elements,
+                     size_t component_index) {
+  const Tensor& first_element = batch_elements[0][component_index];
+  return DataTypeCanUseMemcpy(first_element.dtype()) &&
+         first_element.TotalBytes() <= kMaxColumnarElementBytes;
+}
+
+template <size_t kElementBytes>
+void GatherFixedSize(const std::vector<std::vector<Tensor>>& batch_elements,
+                     size_t component_index, Tensor* batch_component) {
+  char* dst = reinterpret_cast<char*>(batch_component->data());
+  for (size_t i = 0; i < batch_elements.size(); ++i) {
+    std::memcpy(dst + i * kElementBytes,
+                batch_elements[i][component_index].data(), kElementBytes);
+  }
+}
+
+// Copies component `component_index` of all batch elements into the
+// contiguous `batch_component` buffer. Scalars of width 1, 2, 4, or 8 bytes are
+// copied with fixed-size copies, which compile to single loads and stores.
+Status GatherColumn(const std::vector<std::vector<Tensor>>& batch_elements,
+                    size_t component_index, Tensor* batch_component) {
+  const TensorShape& first_element_shape =
+      batch_elements[0][component_index].shape();
+  for (size_t i = 1; i < batch_elements.size(); ++i) {
+    if (batch_elements[i][component_index].shape() != first_element_shape) {
+      return errors::InvalidArgument(
+          "Cannot batch tensors with different shapes in component ",
+          component_index, ". First element had shape ",
+          first_element_shape.DebugString(), " and element ", i, " had shape ",
+          batch_elements[i][component_index].shape().DebugString(), ".");
+    }
+  }
+  const size_t element_bytes = batch_elements[0][component_index].TotalBytes();
+  switch (element_bytes) {
+    case 0:
+      return absl::OkStatus();
+    case 1:
+      GatherFixedSize<1>(batch_elements, component_index, batch_component);
+      return absl::OkStatus();
+    case 2:
+      GatherFixedSize<2>(batch_elements, component_index, batch_component);
+      return absl::OkStatus();
+    case 4:
+      GatherFixedSize<4>(batch_elements, component_index, batch_component);
+      return absl::OkStatus();
+    case 8:
+      GatherFixedSize<8>(batch_elements, component_index, batch_component);
+      return absl::OkStatus();
+    default: {
+      char* dst = reinterpret_cast<char*>(batch_component->data());
+      for (size_t i = 0; i < batch_elements.size(); ++i) {
+        std::memcpy(dst + i * element_bytes,
+                    batch_elements[i][component_index].data(), element_bytes);
+      }
+      return absl::OkStatus();
+    }
+  }
+}
+
+}  // namespace
+
 Status CopyBatch(AnyContext ctx,
                  std::vector<std::vector<Tensor>>&& batch_elements,
                  bool parallel_copy, std::vector<Tensor>* out_tensors) {
@@ -810,6 +884,11 @@ Status CopyBatch(AnyContext ctx,
   for (size_t component_index = 0; component_index < num_tuple_components;
        ++component_index) {
     Tensor& batch_component = out_tensors->at(component_index);
+    if (CanGatherColumn(batch_elements, component_index)) {
+      TF_RETURN_IF_ERROR(
+          GatherColumn(batch_elements, component_index, &batch_component));
+      continue;
+    }
     const Tensor& first_element = batch_elements.at(0)[component_index];
     TensorShape first_element_shape(first_element.shape());
     // Build the output tuple component by copying one slice from each input
@@ -922,6 +1001,46 @@ bool ShouldUsePrivateThreadPool(const Options& options) {
          ThreadingOptions::kPrivateThreadpoolSize;
 }
 
+bool ShouldUseNumaAwareness(const Options& options) {
+  return options.threading_options().optional_numa_aware_case() ==
+             ThreadingOptions::kNumaAware &&
+         options.threading_options().numa_aware() && port::NUMANumNodes() > 1;
+}
+
+bool NumaAllocationEnabled() {
+  // `ProcessState` maps every node to the node 0 allocator unless NUMA was
+  // enabled before the first allocation, so distinct allocators for two nodes
+  // are the only signal that the allocators are per node.
+  static const bool numa_allocation_enabled =
+      port::NUMANumNodes() > 1 && cpu_allocator(0) != cpu_allocator(1);
+  return numa_allocation_enabled;
+}
+
+int ConsumerNumaNode(const DeviceBase& device) {
+  const int numa_node = device.NumaNode();
+  return numa_node >= 0 ? numa_node : port::NUMAGetThreadNodeAffinity();
+}
+
+int64_t CrossNumaNodeBytes(const std::vector<Tensor>& element, int numa_node) {
+  if (numa_node == port::kNUMANoAffinity) {
+    return 0;
+  }
+  int64_t cross_numa_node_bytes = 0;
+  for (const Tensor& tensor : element) {
+    if (!tensor.IsInitialized() || tensor.TotalBytes() == 0 ||
+        !DataTypeCanUseMemcpy(tensor.dtype())) {
+      continue;
+    }
+    const int tensor_numa_node =
+        port::NUMAGetMemAffinity(tensor.tensor_data().data());
+    if (tensor_numa_node != port::kNUMANoAffinity &&
+        tensor_numa_node != numa_node) {
+      cross_numa_node_bytes += tensor.TotalBytes();
+    }
+  }
+  return cross_numa_node_bytes;
+}
+
 bool ShouldUseAutotuning(const Options& options) {
   return options.autotune_options().optional_enabled_case() !=
              AutotuneOptions::kEnabled ||
@@ -1024,6 +1143,16 @@ REGISTER_DATASET_EXPERIMENT("inject_io_prefetch", RandomJobSamplePercentage<0>,
                             AllTasks);
 REGISTER_DATASET_EXPERIMENT("map_fusion", RandomJobSamplePercentage<50>,
                             IndependentHostTasks);
+REGISTER_DATASET_EXPERIMENT("tf_record_memmap", RandomJobSamplePercentage<0>,
+                            AllTasks);
+REGISTER_DATASET_EXPERIMENT("tf_record_memmap_skip_data_checksum",
+                            RandomJobSamplePercentage<0>, AllTasks);
+REGISTER_DATASET_EXPERIMENT("shuffle_spill_to_disk",
+                            RandomJobSamplePercentage<0>, AllTasks);
+REGISTER_DATASET_EXPERIMENT("compression_codec_autotune",
+                            RandomJobSamplePercentage<0>, AllTasks);
+REGISTER_DATASET_EXPERIMENT("prefetch_element_ring",
+                            RandomJobSamplePercentage<0>, AllTasks);
 }  // namespace
 }  // namespace data
 }  // namespace tensorflow
@@ -25,6 +25,7 @@ limitations under the License.
 #include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/common_runtime/function.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/resource_handle.h"
 #include "tensorflow/core/framework/resource_mgr.h"
@@ -323,6 +324,26 @@ bool ShouldConfigureMaxIntraOpParallelism(const Options& options);
 // Determines whether private threadpool should be used.
 bool ShouldUsePrivateThreadPool(const Options& options);
 
+// Determines whether tf.data threads and allocations should be NUMA-aware.
+// Returns false on hosts with a single NUMA node.
+bool ShouldUseNumaAwareness(const Options& options);
+
+// Returns true if the process hands out a distinct CPU allocator per NUMA
+// node, i.e. `cpu_allocator(numa_node)` places memory on `numa_node`. NUMA
+// allocators are off by default, in which case every node maps to node 0.
+bool NumaAllocationEnabled();
+
+// Returns the NUMA node that elements consumed on `device` are expected on:
+// the node of the device, or the node of the calling thread if the device is
+// not on one. Callers of `GetNext` are usually not pinned, so their node is
+// only a fallback.
+int ConsumerNumaNode(const DeviceBase& device);
+
+// Returns the number of bytes of `element` that reside on a NUMA node other
+// than `numa_node`. Tensors whose NUMA node cannot be determined are not
+// counted.
+int64_t CrossNumaNodeBytes(const std::vector<Tensor>& element, int numa_node);
+
 // Determines whether autotuning should be used.
 bool ShouldUseAutotuning(const Options& options);
 
@@ -21,6 +21,7 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_cat.h"
 #include "xla/tsl/util/determinism_test_util.h"
 #include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/dataset_test_base.h"
@@ -28,13 +29,18 @@ limitations under the License.
 #include "tensorflow/core/data/test_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/device_base.h"
 #include "tensorflow/core/framework/function.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.pb.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/str_util.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
@@ -169,6 +175,69 @@ TEST(DatasetUtilsTest, RunnerWithMaxParallelism) {
   runner(fn);
 }
 
+TEST(DatasetUtilsTest, ShouldUseNumaAwareness) {
+  Options options;
+  EXPECT_FALSE(ShouldUseNumaAwareness(options));
+  options.mutable_threading_options()->set_numa_aware(false);
+  EXPECT_FALSE(ShouldUseNumaAwareness(options));
+  options.mutable_threading_options()->set_numa_aware(true);
+  EXPECT_EQ(ShouldUseNumaAwareness(options), port::NUMANumNodes() > 1);
+}
+
+TEST(DatasetUtilsTest, NumaAllocationEnabled) {
+  if (port::NUMANumNodes() <= 1) {
+    EXPECT_FALSE(NumaAllocationEnabled());
+  }
+}
+
+TEST(DatasetUtilsTest, CrossNumaNodeBytes) {
+  std::vector<Tensor> element = {test::AsTensor<int64_t>({1, 2, 3}),
+                                 test::AsTensor<tstring>({"a", "b"})};
+  EXPECT_EQ(CrossNumaNodeBytes(element, port::kNUMANoAffinity), 0);
+  const int numa_node =
+      port::NUMAGetMemAffinity(element[0].tensor_data().data());
+  if (numa_node != port::kNUMANoAffinity) {
+    EXPECT_EQ(CrossNumaNodeBytes(element, numa_node), 0);
+  }
+}
+
+// A device placed on `numa_node`.
+class NumaNodeDevice : public DeviceBase {
+ public:
+  explicit NumaNodeDevice(int numa_node) : DeviceBase(Env::Default()) {
+    attributes_.mutable_locality()->set_numa_node(numa_node);
+  }
+
+  const DeviceAttributes& attributes() const override { return attributes_; }
+
+ private:
+  DeviceAttributes attributes_;
+};
+
+TEST(DatasetUtilsTest, ConsumerNumaNode) {
+  // The test thread is not pinned, so its node does not decide the consumer
+  // node of a device that is on one.
+  EXPECT_EQ(ConsumerNumaNode(NumaNodeDevice(0)), 0);
+  EXPECT_EQ(ConsumerNumaNode(NumaNodeDevice(1)), 1);
+  EXPECT_EQ(ConsumerNumaNode(NumaNodeDevice(-1)),
+            port::NUMAGetThreadNodeAffinity());
+}
+
+TEST(DatasetUtilsTest, CrossNumaNodeBytesOfUnpinnedCaller) {
+  std::vector<Tensor> element = {test::AsTensor<int64_t>({1, 2, 3})};
+  const int numa_node =
+      port::NUMAGetMemAffinity(element[0].tensor_data().data());
+  if (numa_node == port::kNUMANoAffinity) {
+    GTEST_SKIP() << "The NUMA node of the element is unknown.";
+  }
+  EXPECT_EQ(
+      CrossNumaNodeBytes(element, ConsumerNumaNode(NumaNodeDevice(numa_node))),
+      0);
+  EXPECT_EQ(CrossNumaNodeBytes(
+                element, ConsumerNumaNode(NumaNodeDevice(numa_node + 1))),
+            element[0].TotalBytes());
+}
+
 TEST(DatasetUtilsTest, ParseDeterminismPolicy) {
   DeterminismPolicy determinism;
   TF_ASSERT_OK(DeterminismPolicy::FromString("true", &determinism));
@@ -749,6 +818,52 @@ TEST(DatasetUtilsTest, CountBytes) {
   EXPECT_EQ(GetTotalBytes(compressed), compressed_element.ByteSizeLong());
 }
 
+TEST(DatasetUtilsTest, CopyBatch) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> test_ctx,
+                          TestContext::Create());
+  IteratorContext iter_ctx(test_ctx->op_ctx());
+  // Covers scalar, small fixed-size, string, and larger components.
+  std::vector<std::vector<Tensor>> batch_elements;
+  for (int64_t i = 0; i < 3; ++i) {
+    batch_elements.push_back(
+        {CreateTensor<int64_t>(TensorShape({}), {i}),
+         CreateTensor<float>(TensorShape({3}), {1.0f * i, 2.0f * i, 3.0f * i}),
+         CreateTensor<tstring>(TensorShape({}), {absl::StrCat("s", i)}),
+         CreateTensor<int32>(TensorShape({20}), std::vector<int32>(20, i))});
+  }
+  std::vector<Tensor> batch;
+  TF_ASSERT_OK(CopyBatch(AnyContext(&iter_ctx), std::move(batch_elements),
+                         /*parallel_copy=*/false, &batch));
+  ASSERT_EQ(batch.size(), 4);
+  test::ExpectEqual(batch[0],
+                    CreateTensor<int64_t>(TensorShape({3}), {0, 1, 2}));
+  test::ExpectEqual(batch[1],
+                    CreateTensor<float>(TensorShape({3, 3}),
+                                        {0, 0, 0, 1, 2, 3, 2, 4, 6}));
+  test::ExpectEqual(
+      batch[2], CreateTensor<tstring>(TensorShape({3}), {"s0", "s1", "s2"}));
+  std::vector<int32> expected;
+  for (int32 i = 0; i < 3; ++i) {
+    expected.insert(expected.end(), 20, i);
+  }
+  test::ExpectEqual(batch[3],
+                    CreateTensor<int32>(TensorShape({3, 20}), expected));
+}
+
+TEST(DatasetUtilsTest, CopyBatchDifferentShapes) {
+  TF_ASSERT_OK_AND_ASSIGN(std::unique_ptr<TestContext> test_ctx,
+                          TestContext::Create());
+  IteratorContext iter_ctx(test_ctx->op_ctx());
+  std::vector<std::vector<Tensor>> batch_elements = {
+      {CreateTensor<int64_t>(TensorShape({2}), {0, 1})},
+      {CreateTensor<int64_t>(TensorShape({1}), {2})}};
+  std::vector<Tensor> batch;
+  EXPECT_THAT(CopyBatch(AnyContext(&iter_ctx), std::move(batch_elements),
+                        /*parallel_copy=*/false, &batch),
+              StatusIs(tsl::error::INVALID_ARGUMENT,
+                       HasSubstr("Cannot batch tensors with different")));
+}
+
 TEST_F(DatasetOpsTestBase, TestVariantEqualityChecking) {
   Tensor scalar_0{DT_VARIANT, TensorShape({})};
   scalar_0.scalar<Variant>()() = TestVariant({CreateTensor<int64_t>({}, {0})});
@@ -0,0 +1,217 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_ELEMENT_RING_H_
+#define TENSORFLOW_CORE_DATA_ELEMENT_RING_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+namespace tensorflow {
+namespace data {
+
+// A bounded lock-free ring buffer for handing elements between tf.data
+// threads, e.g. from a prefetch thread to `GetNext` callers.
+//
+// The ring is safe for any number of concurrent producers and consumers, so it
+// serves both single-producer (prefetch) and multi-producer (parallel map,
+// interleave) handoffs. Each slot carries a sequence number that tells
+// producers and consumers whether the slot is free or holds an element, so
+// neither side ever blocks the other.
+template <typename T>
+class ElementRing {
+ public:
+  // Creates a ring that holds up to `capacity` elements, rounded up to the next
+  // power of two. The ring holds at least two elements: with a single slot the
+  // sequence number of a full slot equals the next push position, so a second
+  // push would overwrite the element.
+  explicit ElementRing(size_t capacity)
+      : mask_(RoundUpToPowerOfTwo(std::max<size_t>(capacity, 2)) - 1),
+        slots_(new Slot[mask_ + 1]) {
+    for (size_t i = 0; i <= mask_; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ElementRing(const ElementRing&) = delete;
+  ElementRing& operator=(const ElementRing&) = delete;
+
+  ~ElementRing() {
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    for (size_t position = head_.load(std::memory_order_acquire);
+         position < tail; ++position) {
+      slots_[position & mask_].element()->~T();
+    }
+  }
+
+  // Appends `value` to the ring. Returns false, leaving `value` untouched, if
+  // the ring is full.
+  bool TryPush(T&& value) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[position & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (tail_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    new (slot->storage) T(std::move(value));
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Moves the oldest element of the ring into `value`. Returns false if the
+  // ring is empty.
+  bool TryPop(T* value) {
+    size_t position = head_.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+      slot = &slots_[position & mask_];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t difference =
+          static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (difference == 0) {
+        if (head_.compare_exchange_weak(position, position + 1,
+                                        std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = head_.load(std::memory_order_relaxed);
+      }
+    }
+    T* element = slot->element();
+    *value = std::move(*element);
+    element->~T();
+    slot->sequence.store(position + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns the number of buffered elements. Under concurrent pushes and pops
+  // the result is a snapshot that may already be stale.
+  size_t Size() const {
+    const size_t head = head_.load(std::memory_order_acquire);
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    return tail > head ? std::min(tail - head, capacity()) : 0;
+  }
+
+  bool Empty() const { return Size() == 0; }
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Calls `fn` on each buffered element, from the oldest to the newest. The
+  // caller must ensure that no thread pushes or pops concurrently.
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    const size_t tail = tail_.load(std::memory_order_acquire);
+    for (size_t position = head_.load(std::memory_order_acquire);
+         position < tail; ++position) {
+      fn(*slots_[position & mask_].element());
+    }
+  }
+
+ private:
+  // Avoids false sharing between the producer and consumer indices.
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Slot {
+    T* element() { return std::launder(reinterpret_cast<T*>(storage)); }
+
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  static size_t RoundUpToPowerOfTwo(size_t n) {
+    size_t power = 1;
+    while (power < n) {
+      power <<= 1;
+    }
+    return power;
+  }
+
+  const size_t mask_;
+  const std::unique_ptr<Slot[]> slots_;
+  alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+  alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+};
+
+// Adaptive spin-waiting for threads waiting on an `ElementRing`.
+//
+// Parking a thread on a condition variable costs a futex wait and wake per
+// element, which dominates when elements are small and arrive at a high rate.
+// `Spin` busy-waits for up to a spin budget before the caller parks. The budget
+// doubles whenever spinning succeeds and halves whenever it fails, so threads
+// keep spinning while the other side keeps up and quickly fall back to parking
+// when it does not.
+class AdaptiveSpinner {
+ public:
+  // Waits until `ready()` returns true or the spin budget is exhausted. Returns
+  // the last value of `ready()`.
+  template <typename Predicate>
+  bool Spin(Predicate ready) {
+    const int budget = budget_.load(std::memory_order_relaxed);
+    for (int i = 0; i < budget; ++i) {
+      if (ready()) {
+        budget_.store(std::min(budget * 2, kMaxSpins),
+                      std::memory_order_relaxed);
+        return true;
+      }
+      if (i < kPauseSpins) {
+        CpuRelax();
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    budget_.store(std::max(budget / 2, kMinSpins), std::memory_order_relaxed);
+    return ready();
+  }
+
+ private:
+  static constexpr int kMinSpins = 16;
+  static constexpr int kMaxSpins = 4096;
+  // Spins beyond this many iterations yield the processor between checks.
+  static constexpr int kPauseSpins = 128;
+
+  static void CpuRelax() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_ia32_pause();
+#elif defined(__GNUC__) && defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+  }
+
+  std::atomic<int> budget_ = kMinSpins;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_ELEMENT_RING_H_
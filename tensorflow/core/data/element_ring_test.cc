@@ -0,0 +1,179 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/element_ring.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+TEST(ElementRingTest, RoundsUpCapacity) {
+  EXPECT_EQ(ElementRing<int>(0).capacity(), 2);
+  EXPECT_EQ(ElementRing<int>(1).capacity(), 2);
+  EXPECT_EQ(ElementRing<int>(3).capacity(), 4);
+  EXPECT_EQ(ElementRing<int>(64).capacity(), 64);
+}
+
+TEST(ElementRingTest, PushAndPop) {
+  ElementRing<std::unique_ptr<int>> ring(4);
+  EXPECT_TRUE(ring.Empty());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ring.TryPush(std::make_unique<int>(i)));
+  }
+  EXPECT_EQ(ring.Size(), 4);
+
+  // A rejected push leaves the value untouched.
+  auto rejected = std::make_unique<int>(4);
+  EXPECT_FALSE(ring.TryPush(std::move(rejected)));
+  ASSERT_NE(rejected, nullptr);
+  EXPECT_EQ(*rejected, 4);
+
+  for (int i = 0; i < 4; ++i) {
+    std::unique_ptr<int> value;
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(*value, i);
+  }
+  std::unique_ptr<int> value;
+  EXPECT_FALSE(ring.TryPop(&value));
+  EXPECT_TRUE(ring.Empty());
+}
+
+TEST(ElementRingTest, WrapsAround) {
+  ElementRing<int> ring(2);
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(ring.TryPush(std::move(i)));
+    int value = -1;
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(value, i);
+  }
+}
+
+TEST(ElementRingTest, CapacityOne) {
+  ElementRing<int> ring(1);
+  ASSERT_TRUE(ring.TryPush(0));
+  ASSERT_TRUE(ring.TryPush(1));
+  EXPECT_FALSE(ring.TryPush(2));
+  for (int i = 0; i < 2; ++i) {
+    int value = -1;
+    ASSERT_TRUE(ring.TryPop(&value));
+    EXPECT_EQ(value, i);
+  }
+  int value = -1;
+  EXPECT_FALSE(ring.TryPop(&value));
+}
+
+TEST(ElementRingTest, PushDuringPop) {
+  // A consumer advances the head before it releases the slot, so a producer
+  // that sees a free slot by `Size()` may still fail to push and must retry.
+  constexpr int kNumElements = 100000;
+  ElementRing<std::unique_ptr<int>> ring(1);
+  std::unique_ptr<Thread> producer =
+      absl::WrapUnique(Env::Default()->StartThread(
+          ThreadOptions(), "producer", [&ring]() {
+            for (int i = 0; i < kNumElements; ++i) {
+              auto element = std::make_unique<int>(i);
+              while (!ring.TryPush(std::move(element))) {
+                ASSERT_NE(element, nullptr);
+                std::this_thread::yield();
+              }
+            }
+          }));
+  for (int i = 0; i < kNumElements; ++i) {
+    std::unique_ptr<int> value;
+    while (!ring.TryPop(&value)) {
+      std::this_thread::yield();
+    }
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(*value, i);
+  }
+  producer.reset();
+  EXPECT_TRUE(ring.Empty());
+}
+
+TEST(ElementRingTest, ForEach) {
+  ElementRing<std::string> ring(8);
+  for (const char* value : {"a", "b", "c"}) {
+    ASSERT_TRUE(ring.TryPush(value));
+  }
+  std::string popped;
+  ASSERT_TRUE(ring.TryPop(&popped));
+  std::vector<std::string> values;
+  ring.ForEach(
+      [&values](const std::string& value) { values.push_back(value); });
+  EXPECT_EQ(values, std::vector<std::string>({"b", "c"}));
+}
+
+TEST(ElementRingTest, DestroysBufferedElements) {
+  auto element = std::make_shared<int>(0);
+  {
+    ElementRing<std::shared_ptr<int>> ring(4);
+    ASSERT_TRUE(ring.TryPush(std::shared_ptr<int>(element)));
+    ASSERT_TRUE(ring.TryPush(std::shared_ptr<int>(element)));
+    EXPECT_EQ(element.use_count(), 3);
+  }
+  EXPECT_EQ(element.use_count(), 1);
+}
+
+TEST(ElementRingTest, MultipleProducers) {
+  constexpr int kNumProducers = 4;
+  constexpr int kNumElementsPerProducer = 10000;
+  ElementRing<std::pair<int, int>> ring(16);
+  std::vector<std::unique_ptr<Thread>> producers;
+  for (int producer = 0; producer < kNumProducers; ++producer) {
+    producers.push_back(absl::WrapUnique(Env::Default()->StartThread(
+        ThreadOptions(), "producer", [&ring, producer]() {
+          AdaptiveSpinner spinner;
+          for (int i = 0; i < kNumElementsPerProducer; ++i) {
+            while (!ring.TryPush(std::make_pair(producer, i))) {
+              spinner.Spin([&ring]() { return ring.Size() < ring.capacity(); });
+            }
+          }
+        })));
+  }
+
+  // Elements of each producer are popped in the order they were pushed.
+  std::vector<int> next(kNumProducers, 0);
+  AdaptiveSpinner spinner;
+  for (int i = 0; i < kNumProducers * kNumElementsPerProducer; ++i) {
+    std::pair<int, int> value;
+    while (!ring.TryPop(&value)) {
+      spinner.Spin([&ring]() { return !ring.Empty(); });
+    }
+    EXPECT_EQ(value.second, next[value.first]++);
+  }
+  producers.clear();
+  EXPECT_TRUE(ring.Empty());
+}
+
+TEST(AdaptiveSpinnerTest, ReturnsReadiness) {
+  AdaptiveSpinner spinner;
+  EXPECT_TRUE(spinner.Spin([]() { return true; }));
+  EXPECT_FALSE(spinner.Spin([]() { return false; }));
+  int checks = 0;
+  EXPECT_TRUE(spinner.Spin([&checks]() { return ++checks == 3; }));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
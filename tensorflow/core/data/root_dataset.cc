@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/data/root_dataset.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <functional>
 #include <memory>
@@ -23,19 +24,26 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/data/autotune_warm_start.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/rewrite_utils.h"
+#include "tensorflow/core/data/unbounded_thread_pool.h"
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
+#include "tensorflow/core/framework/device.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/model.pb.h"
+#include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/host_info.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/stringprintf.h"
 #include "tsl/platform/host_info.h"
 
@@ -52,6 +60,7 @@ constexpr char kReadRoundtripLatency[] = "read_latency_usec";
 constexpr char kReadResponseBytes[] = "read_bytes";
 constexpr char kIntraOpParallelism[] = "intra_op_parallelism";
 constexpr char kMemBandwidth[] = "mem_bw_used_megabytes_per_sec";
+constexpr char kNumaAware[] = "numa_aware";
 constexpr char kPrivateThreadpoolSize[] = "threadpool_size";
 constexpr char kRamBudget[] = "ram_budget_megabytes";
 constexpr char kRamUsage[] = "ram_usage_megabytes";
@@ -72,6 +81,7 @@ void SetRootDatasetParams(const Options& options, RootDataset::Params* params) {
     params->private_threadpool_size =
         options.threading_options().private_threadpool_size();
   }
+  params->numa_aware = ShouldUseNumaAwareness(options);
   params->autotune = ShouldUseAutotuning(options);
   params->autotune_algorithm = model::AutotuneAlgorithm::DEFAULT;
   auto experiments = GetExperiments();
@@ -135,6 +145,10 @@ void AddTraceMetadata(const RootDataset::Params& params, const Options& options,
                                     params.private_threadpool_size, 0,
                                     port::MaxParallelism())))));
   }
+  if (params.numa_aware) {
+    trace_metadata->push_back(std::make_pair(
+        kNumaAware, strings::Printf("%d", port::NUMANumNodes())));
+  }
   auto experiments = GetExperiments();
   if (!experiments.empty()) {
     trace_metadata->push_back(
@@ -183,14 +197,37 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       threadpool_size_ =
           value_or_default(dataset()->params_.private_threadpool_size, 0,
                            port::MaxParallelism());
-      thread_pool_ = std::make_unique<thread::ThreadPool>(
-          Env::Default(), ThreadOptions{}, "data_private_threadpool",
-          threadpool_size_);
+      if (dataset()->params_.numa_aware) {
+        // Splits the private threadpool evenly across the NUMA nodes.
+        const int num_numa_nodes = port::NUMANumNodes();
+        for (int numa_node = 0; numa_node < num_numa_nodes; ++numa_node) {
+          ThreadOptions thread_options;
+          thread_options.numa_node = numa_node;
+          numa_thread_pools_.push_back(std::make_unique<thread::ThreadPool>(
+              Env::Default(), thread_options,
+              strings::StrCat("data_private_threadpool_numa", numa_node),
+              std::max<int64_t>(1, threadpool_size_ / num_numa_nodes)));
+        }
+      } else {
+        thread_pool_ = std::make_unique<thread::ThreadPool>(
+            Env::Default(), ThreadOptions{}, "data_private_threadpool",
+            threadpool_size_);
+      }
+    }
+    if (dataset()->params_.numa_aware) {
+      numa_unbounded_thread_pool_ = std::make_unique<UnboundedThreadPool>(
+          Env::Default(), "tf_data_numa", ThreadOptions{},
+          /*numa_aware=*/true);
     }
     cancellation_manager_ = std::make_unique<CancellationManager>();
   }
 
-  ~Iterator() override { cancellation_manager_->StartCancel(); }
+  ~Iterator() override {
+    if (warm_start_ != nullptr) {
+      warm_start_->SaveInBackground(model_);
+    }
+    cancellation_manager_->StartCancel();
+  }
 
   bool SymbolicCheckpointCompatible() const override { return true; }
 
@@ -207,6 +244,7 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
       } else {
         model_ = std::make_shared<model::Model>();
         ctx->SetModel(model_);
+        warm_start_ = AutotuneWarmStart::Create(dataset()->input_);
       }
 
       absl::flat_hash_set<string> experiments = GetExperiments();
@@ -227,6 +265,17 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(&iter_ctx, this,
                                                        prefix(), &input_impl_));
     ctx->MergeCheckpoint(iter_ctx.checkpoint());
+    if (warm_start_ != nullptr) {
+      StatusOr<int64_t> num_seeded_nodes = warm_start_->Load(*model_);
+      if (!num_seeded_nodes.ok()) {
+        LOG(WARNING) << "Failed to load the autotuning state from "
+                     << warm_start_->filename() << ": "
+                     << num_seeded_nodes.status();
+      } else if (*num_seeded_nodes > 0) {
+        VLOG(1) << "Warm started autotuning of " << *num_seeded_nodes
+                << " nodes from " << warm_start_->filename();
+      }
+    }
     return absl::OkStatus();
   }
 
@@ -245,9 +294,19 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     TF_RETURN_IF_ERROR(
         input_impl_->GetNext(&iter_ctx, out_tensors, end_of_sequence));
     ctx->MergeCheckpoint(iter_ctx.checkpoint());
+    bool save_warm_start = false;
     {
       mutex_lock l(mu_);
       end_time_usec_ = std::max(ctx->env()->NowMicros(), end_time_usec_);
+      if (*end_of_sequence && warm_start_ != nullptr && !warm_start_saved_) {
+        warm_start_saved_ = true;
+        save_warm_start = true;
+      }
+    }
+    if (save_warm_start) {
+      // Persists the state of a complete epoch, in case the iterator is not
+      // destroyed before the process exits.
+      warm_start_->SaveInBackground(model_);
     }
     return absl::OkStatus();
   }
@@ -327,11 +386,41 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     // should simply set `params.model` to `model_` here.
     params.model = model_;
     if (dataset()->params_.private_threadpool_size >= 0) {
-      params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
-        pool->Schedule(std::move(c));
-      };
+      if (numa_thread_pools_.empty()) {
+        params.runner = [pool = thread_pool_.get()](std::function<void()> c) {
+          pool->Schedule(std::move(c));
+        };
+      } else {
+        params.runner = [this](std::function<void()> c) {
+          NumaThreadPool()->Schedule(std::move(c));
+        };
+      }
       params.runner_threadpool_size = threadpool_size_;
     }
+    if (numa_unbounded_thread_pool_ != nullptr) {
+      params.thread_factory = numa_unbounded_thread_pool_->get_thread_factory();
+      params.thread_pool = numa_unbounded_thread_pool_.get();
+      if (NumaAllocationEnabled() && params.flr != nullptr &&
+          params.flr->device() != nullptr &&
+          params.flr->device()->device_type() == DEVICE_CPU) {
+        // Allocates host memory on the NUMA node of the producing thread. Only
+        // replaces the device's allocator if it is the default CPU allocator,
+        // so that tracking or custom device allocators are kept.
+        params.allocator_getter = [allocator_getter = params.allocator_getter](
+                                      AllocatorAttributes attrs) {
+          Allocator* allocator = allocator_getter(attrs);
+          if (attrs.gpu_compatible() ||
+              allocator != cpu_allocator(port::kNUMANoAffinity)) {
+            return allocator;
+          }
+          const int numa_node = port::NUMAGetThreadNodeAffinity();
+          if (numa_node == port::kNUMANoAffinity) {
+            return allocator;
+          }
+          return cpu_allocator(numa_node);
+        };
+      }
+    }
     if (dataset()->params_.max_intra_op_parallelism >= 0) {
       params.runner =
           RunnerWithMaxParallelism(params.runner, max_intra_op_parallelism_);
@@ -366,7 +455,24 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
     return absl::OkStatus();
   }
 
+  // Returns the private threadpool of the NUMA node of the calling thread, or
+  // the next one in round-robin order if the thread is not pinned.
+  thread::ThreadPool* NumaThreadPool() {
+    const int numa_node = port::NUMAGetThreadNodeAffinity();
+    if (numa_node >= 0 &&
+        static_cast<size_t>(numa_node) < numa_thread_pools_.size()) {
+      return numa_thread_pools_[numa_node].get();
+    }
+    return numa_thread_pools_[next_numa_thread_pool_.fetch_add(
+                                  1, std::memory_order_relaxed) %
+                              numa_thread_pools_.size()]
+        .get();
+  }
+
   std::shared_ptr<model::Model> model_ = nullptr;
+  // Persists the autotuning state of `model_` across runs. Only set if
+  // `model_` is owned by this iterator.
+  std::unique_ptr<AutotuneWarmStart> warm_start_ = nullptr;
   // `ram_budget_manager_` coordinates the memory budget and allocation
   // between prefetch legacy autotune and `tensorflow::data::model::Model`
   std::shared_ptr<model::RamBudgetManager> ram_budget_manager_ = nullptr;
@@ -378,9 +484,18 @@ class RootDataset::Iterator : public DatasetIterator<RootDataset> {
   int64_t max_intra_op_parallelism_;
   int64_t threadpool_size_;
   std::unique_ptr<thread::ThreadPool> thread_pool_;
+  // Private threadpools pinned to each NUMA node, used instead of
+  // `thread_pool_` if the dataset is NUMA-aware.
+  std::vector<std::unique_ptr<thread::ThreadPool>> numa_thread_pools_;
+  std::atomic<uint64_t> next_numa_thread_pool_ = 0;
+  // Hosts the logical threads of the input pipeline if the dataset is
+  // NUMA-aware.
+  std::unique_ptr<UnboundedThreadPool> numa_unbounded_thread_pool_;
 
   // The end time of the previous `GetNextInternal` call.
   uint64_t end_time_usec_ TF_GUARDED_BY(mu_) = 0;
+  // Whether the autotuning state was persisted at the end of the input.
+  bool warm_start_saved_ TF_GUARDED_BY(mu_) = false;
 
   // Must be ordered last as its execution may depend on other members.
   std::unique_ptr<IteratorBase> input_impl_;
@@ -25,7 +25,10 @@ limitations under the License.
 #include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/log/check.h"
 #include "absl/log/log.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
 #include "absl/time/time.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -187,6 +190,96 @@ absl::Status AutoScaler::RemoveConsumer(int64_t consumer_id)
   return absl::OkStatus();
 }
 
+AutoScalerForecaster::AutoScalerForecaster(
+    const AutoScalerForecastOptions& options)
+    : options_(options) {
+  DCHECK_GT(options_.level_smoothing, 0.0);
+  DCHECK_LE(options_.level_smoothing, 1.0);
+  DCHECK_GE(options_.trend_smoothing, 0.0);
+  DCHECK_LE(options_.trend_smoothing, 1.0);
+  DCHECK_GE(options_.quantile, 0.0);
+  DCHECK_LE(options_.quantile, 1.0);
+}
+
+int64_t AutoScalerForecaster::Update(absl::Time time, int64_t estimate) {
+  if (!last_update_time_.has_value()) {
+    level_ = estimate;
+    trend_ = 0.0;
+  } else {
+    double elapsed_seconds = absl::ToDoubleSeconds(time - *last_update_time_);
+    double predicted_level = level_ + trend_ * elapsed_seconds;
+    double new_level = options_.level_smoothing * estimate +
+                       (1.0 - options_.level_smoothing) * predicted_level;
+    if (elapsed_seconds > 0.0) {
+      trend_ = options_.trend_smoothing * (new_level - level_) /
+                   elapsed_seconds +
+               (1.0 - options_.trend_smoothing) * trend_;
+    }
+    level_ = new_level;
+  }
+  last_update_time_ = time;
+
+  double forecast =
+      level_ + trend_ * absl::ToDoubleSeconds(options_.worker_warm_up_time);
+  forecasts_.emplace_back(time, std::max(1.0, forecast));
+  while (forecasts_.size() > 1 &&
+         forecasts_.front().first < time - options_.window) {
+    forecasts_.pop_front();
+  }
+
+  int64_t demand =
+      std::max(int64_t{1}, static_cast<int64_t>(std::ceil(GetDemand())));
+  if (!recommendation_.has_value()) {
+    recommendation_ = demand;
+    last_scale_up_time_ = time;
+    return *recommendation_;
+  }
+
+  double recommendation = static_cast<double>(*recommendation_);
+  if (demand > recommendation * (1.0 + options_.scale_up_threshold)) {
+    recommendation_ = demand;
+    last_scale_up_time_ = time;
+    scale_down_since_.reset();
+  } else if (demand < recommendation * (1.0 - options_.scale_down_threshold) &&
+             time - last_scale_up_time_ >= options_.worker_warm_up_time) {
+    if (!scale_down_since_.has_value()) {
+      scale_down_since_ = time;
+    }
+    if (time - *scale_down_since_ >= options_.scale_down_patience) {
+      recommendation_ = demand;
+      scale_down_since_.reset();
+    }
+  } else {
+    scale_down_since_.reset();
+  }
+  return *recommendation_;
+}
+
+double AutoScalerForecaster::GetDemand() const {
+  std::vector<double> sorted_forecasts;
+  sorted_forecasts.reserve(forecasts_.size());
+  for (const auto& [time, forecast] : forecasts_) {
+    sorted_forecasts.push_back(forecast);
+  }
+  std::sort(sorted_forecasts.begin(), sorted_forecasts.end());
+
+  // Linearly interpolates between the closest ranks.
+  double rank = options_.quantile * (sorted_forecasts.size() - 1);
+  size_t lower = static_cast<size_t>(rank);
+  size_t upper = std::min(lower + 1, sorted_forecasts.size() - 1);
+  double fraction = rank - lower;
+  return sorted_forecasts[lower] +
+         fraction * (sorted_forecasts[upper] - sorted_forecasts[lower]);
+}
+
+MultipleIterationsAutoScaler::MultipleIterationsAutoScaler(
+    std::optional<AutoScalerForecastOptions> forecast_options) {
+  if (forecast_options.has_value()) {
+    tsl::mutex_lock l(forecaster_mu_);
+    forecaster_ = std::make_unique<AutoScalerForecaster>(*forecast_options);
+  }
+}
+
 void MultipleIterationsAutoScaler::EnsureIterationIsRegistered(
     int64_t iteration_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   if (!auto_scalers_.contains(iteration_id)) {
@@ -205,7 +298,29 @@ absl::Status MultipleIterationsAutoScaler::UnregisterIteration(
 }
 
 absl::Status MultipleIterationsAutoScaler::UpdateOptimalNumberOfWorkersMetric(
-    int64_t current_number_of_workers) TF_LOCKS_EXCLUDED(mu_) {
+    int64_t current_number_of_workers) TF_LOCKS_EXCLUDED(mu_, forecaster_mu_) {
+  return UpdateOptimalNumberOfWorkersMetric(current_number_of_workers,
+                                            absl::Now());
+}
+
+absl::Status MultipleIterationsAutoScaler::UpdateOptimalNumberOfWorkersMetric(
+    int64_t current_number_of_workers, absl::Time now)
+    TF_LOCKS_EXCLUDED(mu_, forecaster_mu_) {
+  absl::StatusOr<int64_t> recommended_number_of_workers =
+      GetRecommendedNumberOfWorkers(current_number_of_workers, now);
+  if (!recommended_number_of_workers.ok()) {
+    return recommended_number_of_workers.status();
+  }
+  metrics::RecordTFDataServiceOptimalNumberOfWorkers(
+      *recommended_number_of_workers);
+
+  return absl::OkStatus();
+}
+
+absl::StatusOr<int64_t>
+MultipleIterationsAutoScaler::GetRecommendedNumberOfWorkers(
+    int64_t current_number_of_workers, absl::Time now)
+    TF_LOCKS_EXCLUDED(mu_, forecaster_mu_) {
   if (current_number_of_workers <= 0)
     return absl::InvalidArgumentError(
         "The current number of workers must be positive");
@@ -221,6 +336,16 @@ absl::Status MultipleIterationsAutoScaler::UpdateOptimalNumberOfWorkersMetric(
   VLOG(3) << "Estimated optimal number of workers: "
           << optimal_number_of_workers.value();
 
+  {
+    tsl::mutex_lock l(forecaster_mu_);
+    if (forecaster_) {
+      optimal_number_of_workers =
+          forecaster_->Update(now, optimal_number_of_workers.value());
+      VLOG(3) << "Forecast optimal number of workers: "
+              << optimal_number_of_workers.value();
+    }
+  }
+
   // Limit the estimate to wait for target processing times to converge to a
   // feasible value. First, start increasing exponentially by 4x. Once
   // increases are greater than 500, scale linearly.
@@ -236,10 +361,7 @@ absl::Status MultipleIterationsAutoScaler::UpdateOptimalNumberOfWorkersMetric(
   VLOG(3) << "Bound optimal number of workers: "
           << bound_optimal_number_of_workers;
 
-  metrics::RecordTFDataServiceOptimalNumberOfWorkers(
-      bound_optimal_number_of_workers);
-
-  return absl::OkStatus();
+  return bound_optimal_number_of_workers;
 }
 
 std::optional<int64_t> MultipleIterationsAutoScaler::GetOptimalNumberOfWorkers()
@@ -17,11 +17,15 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/time/time.h"
 #include "tsl/platform/mutex.h"
 #include "tsl/platform/status.h"
@@ -104,6 +108,75 @@ class AutoScaler {
   absl::flat_hash_map<int64_t, double> consumption_rates_ TF_GUARDED_BY(mu_);
 };
 
+// Options for `AutoScalerForecaster`. The defaults favor stable
+// recommendations over fast reactions to short workload changes.
+struct AutoScalerForecastOptions {
+  // Weight of the newest estimate in the exponentially weighted moving average
+  // (EWMA) of the estimated number of workers. Must be in (0, 1].
+  double level_smoothing = 0.3;
+  // Weight of the newest change in the EWMA of the estimate's trend. Must be in
+  // [0, 1]. A value of 0 disables trend extrapolation.
+  double trend_smoothing = 0.05;
+  // Length of the sliding window of forecasts the recommendation is based on.
+  absl::Duration window = absl::Minutes(5);
+  // Quantile of the forecasts in `window` that is taken as the demand. Must be
+  // in [0, 1]. Higher values make under-provisioning less likely.
+  double quantile = 0.9;
+  // The recommendation is increased when the demand exceeds it by more than
+  // this fraction.
+  double scale_up_threshold = 0.05;
+  // The recommendation is decreased when the demand stays lower than it by
+  // more than this fraction for `scale_down_patience`.
+  double scale_down_threshold = 0.1;
+  absl::Duration scale_down_patience = absl::Minutes(5);
+  // Time it takes a newly added worker to start producing elements. Forecasts
+  // look this far ahead, since workers requested now are only useful after
+  // warming up, and the recommendation is not decreased within this time after
+  // an increase, since the new workers have not been observed yet.
+  absl::Duration worker_warm_up_time = absl::Minutes(1);
+};
+
+// Turns the point estimates of `AutoScaler` into a stable recommendation for
+// the number of workers.
+//
+// 1. It smooths the estimates with a level and trend EWMA (Holt's linear
+// method) and extrapolates the trend `worker_warm_up_time` ahead.
+// 2. It takes a quantile of the forecasts made within a sliding window as the
+// demand, so that a single noisy estimate does not move the recommendation.
+// 3. It applies hysteresis: the recommendation increases as soon as the demand
+// exceeds it by `scale_up_threshold`, but only decreases after the demand has
+// stayed below it by `scale_down_threshold` for `scale_down_patience`.
+//
+// AutoScalerForecaster is not thread-safe.
+class AutoScalerForecaster {
+ public:
+  explicit AutoScalerForecaster(const AutoScalerForecastOptions& options);
+
+  // Records the point `estimate` observed at `time` and returns the
+  // recommended number of workers. `time` must not decrease between calls.
+  int64_t Update(absl::Time time, int64_t estimate);
+  // Returns the latest recommendation, or nullopt if no estimate has been
+  // recorded yet.
+  std::optional<int64_t> recommendation() const { return recommendation_; }
+
+ private:
+  // Returns the `options_.quantile` quantile of `forecasts_`.
+  double GetDemand() const;
+
+  const AutoScalerForecastOptions options_;
+  std::optional<absl::Time> last_update_time_;
+  // Smoothed estimate, in workers.
+  double level_ = 0.0;
+  // Smoothed trend, in workers per second.
+  double trend_ = 0.0;
+  // Forecasts made within `options_.window`, ordered by time.
+  std::deque<std::pair<absl::Time, double>> forecasts_;
+  std::optional<int64_t> recommendation_;
+  absl::Time last_scale_up_time_ = absl::InfinitePast();
+  // Time since which the demand has been low enough to scale down.
+  std::optional<absl::Time> scale_down_since_;
+};
+
 // Exports a metric (/tensorflow/data/service/optimal_number_of_workers) with
 // the estimated optimal number of tf.data service workers, according to
 // the observed cluster workload.
@@ -115,6 +188,10 @@ class AutoScaler {
 class MultipleIterationsAutoScaler {
  public:
   MultipleIterationsAutoScaler() = default;
+  // Smooths the exported estimates with an `AutoScalerForecaster` configured
+  // with `forecast_options`, unless it is nullopt.
+  explicit MultipleIterationsAutoScaler(
+      std::optional<AutoScalerForecastOptions> forecast_options);
   // Unregisters iteration with `iteration_id`, removing its reported
   // times from consideration of the current workload estimation.
   // Returns an error if the specified iteration does not exist.
@@ -125,7 +202,17 @@ class MultipleIterationsAutoScaler {
   // previously reported processing and target processing times for at least one
   // iteration, or `current_number_of_workers` is not positive.
   absl::Status UpdateOptimalNumberOfWorkersMetric(
-      int64_t current_number_of_workers) TF_LOCKS_EXCLUDED(mu_);
+      int64_t current_number_of_workers)
+      TF_LOCKS_EXCLUDED(mu_, forecaster_mu_);
+  // Like above, but with the forecast (if enabled) observed at `now`.
+  absl::Status UpdateOptimalNumberOfWorkersMetric(
+      int64_t current_number_of_workers, absl::Time now)
+      TF_LOCKS_EXCLUDED(mu_, forecaster_mu_);
+  // Returns the value `UpdateOptimalNumberOfWorkersMetric` would export at
+  // `now`, without exporting it. Returns the same errors.
+  absl::StatusOr<int64_t> GetRecommendedNumberOfWorkers(
+      int64_t current_number_of_workers, absl::Time now)
+      TF_LOCKS_EXCLUDED(mu_, forecaster_mu_);
   // Returns the estimated optimal number of workers according to the current
   // observed workload. If there are no previously reported processing and
   // target processing times for at least one iteration, returns nullopt.
@@ -171,6 +258,11 @@ class MultipleIterationsAutoScaler {
   // Map from iteration id to AutoScaler.
   absl::flat_hash_map<int64_t, std::unique_ptr<AutoScaler>> auto_scalers_
       TF_GUARDED_BY(mu_);
+  // Never acquired while holding `mu_`.
+  tsl::mutex forecaster_mu_;
+  // Null if forecasting is disabled.
+  std::unique_ptr<AutoScalerForecaster> forecaster_
+      TF_GUARDED_BY(forecaster_mu_);
 };
 
 }  // namespace data
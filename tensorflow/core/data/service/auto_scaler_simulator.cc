@@ -0,0 +1,285 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/data/service/auto_scaler_simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/data/service/auto_scaler.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr int kNumReportFields = 5;
+
+absl::StatusOr<AutoScalerReport::Type> ParseReportType(
+    absl::string_view type) {
+  if (type == "processing_time") {
+    return AutoScalerReport::Type::kProcessingTime;
+  }
+  if (type == "target_processing_time") {
+    return AutoScalerReport::Type::kTargetProcessingTime;
+  }
+  if (type == "remove_worker") {
+    return AutoScalerReport::Type::kRemoveWorker;
+  }
+  if (type == "remove_consumer") {
+    return AutoScalerReport::Type::kRemoveConsumer;
+  }
+  if (type == "unregister_iteration") {
+    return AutoScalerReport::Type::kUnregisterIteration;
+  }
+  return absl::InvalidArgumentError(
+      absl::StrCat("Unknown AutoScaler report type: ", type));
+}
+
+absl::StatusOr<AutoScalerReport> ParseReport(absl::string_view line) {
+  std::vector<absl::string_view> fields = absl::StrSplit(line, ',');
+  if (fields.size() != kNumReportFields) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Expected ", kNumReportFields,
+                     " comma-separated fields in AutoScaler report, got: ",
+                     line));
+  }
+  for (absl::string_view& field : fields) {
+    field = absl::StripAsciiWhitespace(field);
+  }
+
+  AutoScalerReport report;
+  int64_t time_us = 0;
+  if (!absl::SimpleAtoi(fields[0], &time_us)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid time in AutoScaler report: ", line));
+  }
+  report.time = absl::FromUnixMicros(time_us);
+  absl::StatusOr<AutoScalerReport::Type> type = ParseReportType(fields[1]);
+  if (!type.ok()) {
+    return type.status();
+  }
+  report.type = *type;
+  if (!absl::SimpleAtoi(fields[2], &report.iteration_id)) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Invalid iteration id in AutoScaler report: ", line));
+  }
+
+  switch (report.type) {
+    case AutoScalerReport::Type::kProcessingTime:
+    case AutoScalerReport::Type::kRemoveWorker:
+      report.worker_address = std::string(fields[3]);
+      break;
+    case AutoScalerReport::Type::kTargetProcessingTime:
+    case AutoScalerReport::Type::kRemoveConsumer:
+      if (!absl::SimpleAtoi(fields[3], &report.consumer_id)) {
+        return absl::InvalidArgumentError(
+            absl::StrCat("Invalid consumer id in AutoScaler report: ", line));
+      }
+      break;
+    case AutoScalerReport::Type::kUnregisterIteration:
+      break;
+  }
+
+  if (report.type == AutoScalerReport::Type::kProcessingTime ||
+      report.type == AutoScalerReport::Type::kTargetProcessingTime) {
+    int64_t duration_us = 0;
+    if (!absl::SimpleAtoi(fields[4], &duration_us)) {
+      return absl::InvalidArgumentError(
+          absl::StrCat("Invalid duration in AutoScaler report: ", line));
+    }
+    report.duration = absl::Microseconds(duration_us);
+  }
+  return report;
+}
+
+absl::Status ApplyReport(const AutoScalerReport& report,
+                         MultipleIterationsAutoScaler& auto_scaler) {
+  switch (report.type) {
+    case AutoScalerReport::Type::kProcessingTime:
+      return auto_scaler.ReportProcessingTime(
+          report.iteration_id, report.worker_address, report.duration);
+    case AutoScalerReport::Type::kTargetProcessingTime:
+      return auto_scaler.ReportTargetProcessingTime(
+          report.iteration_id, report.consumer_id, report.duration);
+    case AutoScalerReport::Type::kRemoveWorker:
+      return auto_scaler.RemoveWorker(report.iteration_id,
+                                      report.worker_address);
+    case AutoScalerReport::Type::kRemoveConsumer:
+      return auto_scaler.RemoveConsumer(report.iteration_id,
+                                        report.consumer_id);
+    case AutoScalerReport::Type::kUnregisterIteration:
+      return auto_scaler.UnregisterIteration(report.iteration_id);
+  }
+  return absl::InvalidArgumentError("Unknown AutoScaler report type");
+}
+
+// A simulated cluster whose workers become ready `worker_warm_up_time` after
+// being added.
+class SimulatedCluster {
+ public:
+  SimulatedCluster(int64_t initial_number_of_workers,
+                   absl::Duration worker_warm_up_time)
+      : worker_warm_up_time_(worker_warm_up_time),
+        ready_times_(initial_number_of_workers, absl::InfinitePast()) {}
+
+  int64_t size() const { return ready_times_.size(); }
+
+  // Adds or removes workers at `time` so that the cluster has
+  // `number_of_workers` workers. The most recently added workers are removed
+  // first.
+  void Resize(absl::Time time, int64_t number_of_workers) {
+    if (number_of_workers < size()) {
+      ready_times_.resize(number_of_workers);
+      return;
+    }
+    ready_times_.resize(number_of_workers, time + worker_warm_up_time_);
+  }
+
+  // Accumulates the over- and under-provisioned worker-seconds between `start`
+  // and `end`, assuming the cluster is not resized in between.
+  void Account(absl::Time start, absl::Time end, int64_t demand,
+               AutoScalerSimulationResult& result) const {
+    result.over_provisioned_worker_seconds +=
+        std::max<int64_t>(0, size() - demand) *
+        absl::ToDoubleSeconds(end - start);
+
+    // `ready_times_` is sorted, since workers are added in time order. Workers
+    // becoming ready split [start, end) into pieces with a constant number of
+    // ready workers.
+    absl::Time piece_start = start;
+    while (piece_start < end) {
+      auto first_not_ready = std::upper_bound(ready_times_.begin(),
+                                              ready_times_.end(), piece_start);
+      int64_t num_ready = first_not_ready - ready_times_.begin();
+      absl::Time piece_end =
+          first_not_ready == ready_times_.end()
+              ? end
+              : std::min(end, *first_not_ready);
+      result.under_provisioned_worker_seconds +=
+          std::max<int64_t>(0, demand - num_ready) *
+          absl::ToDoubleSeconds(piece_end - piece_start);
+      piece_start = piece_end;
+    }
+  }
+
+ private:
+  const absl::Duration worker_warm_up_time_;
+  // Time at which each worker is ready, in the order they were added.
+  std::vector<absl::Time> ready_times_;
+};
+
+}  // namespace
+
+absl::StatusOr<std::vector<AutoScalerReport>> ParseAutoScalerReports(
+    absl::string_view text) {
+  std::vector<AutoScalerReport> reports;
+  for (absl::string_view line : absl::StrSplit(text, '\n')) {
+    line = absl::StripAsciiWhitespace(line);
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+    absl::StatusOr<AutoScalerReport> report = ParseReport(line);
+    if (!report.ok()) {
+      return report.status();
+    }
+    reports.push_back(*std::move(report));
+  }
+  return reports;
+}
+
+absl::StatusOr<AutoScalerSimulationResult> SimulateAutoScaler(
+    absl::Span<const AutoScalerReport> reports,
+    const AutoScalerSimulationOptions& options) {
+  if (options.update_interval <= absl::ZeroDuration()) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("update_interval must be positive, got ",
+                     absl::FormatDuration(options.update_interval)));
+  }
+  if (options.initial_number_of_workers <= 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("initial_number_of_workers must be positive, got ",
+                     options.initial_number_of_workers));
+  }
+  for (size_t i = 1; i < reports.size(); ++i) {
+    if (reports[i].time < reports[i - 1].time) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "AutoScaler reports must be ordered by time, but report ", i,
+          " is older than report ", i - 1));
+    }
+  }
+
+  AutoScalerSimulationResult result;
+  if (reports.empty()) {
+    return result;
+  }
+
+  MultipleIterationsAutoScaler auto_scaler(options.forecast_options);
+  SimulatedCluster cluster(options.initial_number_of_workers,
+                           options.worker_warm_up_time);
+  std::optional<absl::Time> last_step_time;
+
+  auto update = [&](absl::Time now) {
+    std::optional<int64_t> estimate = auto_scaler.GetOptimalNumberOfWorkers();
+    if (!estimate.has_value()) {
+      return;
+    }
+    absl::StatusOr<int64_t> recommendation =
+        auto_scaler.GetRecommendedNumberOfWorkers(cluster.size(), now);
+    if (!recommendation.ok()) {
+      return;
+    }
+    if (last_step_time.has_value()) {
+      cluster.Account(*last_step_time, now, *estimate, result);
+    }
+    last_step_time = now;
+
+    if (*recommendation > cluster.size()) {
+      ++result.num_scale_ups;
+    } else if (*recommendation < cluster.size()) {
+      ++result.num_scale_downs;
+    }
+    cluster.Resize(now, *recommendation);
+    result.steps.push_back({now, *estimate, *recommendation});
+  };
+
+  absl::Time next_update_time = reports.front().time + options.update_interval;
+  for (const AutoScalerReport& report : reports) {
+    while (report.time >= next_update_time) {
+      update(next_update_time);
+      next_update_time += options.update_interval;
+    }
+    if (!ApplyReport(report, auto_scaler).ok()) {
+      ++result.num_rejected_reports;
+    }
+  }
+  update(next_update_time);
+  return result;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,116 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_SIMULATOR_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_SIMULATOR_H_
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tensorflow/core/data/service/auto_scaler.h"
+
+namespace tensorflow {
+namespace data {
+
+// A report received by the tf.data service AutoScaler, e.g. recorded from a
+// dispatcher running in production.
+struct AutoScalerReport {
+  enum class Type {
+    kProcessingTime,
+    kTargetProcessingTime,
+    kRemoveWorker,
+    kRemoveConsumer,
+    kUnregisterIteration,
+  };
+
+  absl::Time time;
+  Type type = Type::kProcessingTime;
+  int64_t iteration_id = 0;
+  // Set for worker reports.
+  std::string worker_address;
+  // Set for consumer reports.
+  int64_t consumer_id = 0;
+  // Set for processing time and target processing time reports.
+  absl::Duration duration;
+};
+
+// Parses reports with one report per line, formatted as
+//
+//   <time_us>,<type>,<iteration_id>,<source>,<duration_us>
+//
+// where <type> is one of `processing_time`, `target_processing_time`,
+// `remove_worker`, `remove_consumer` and `unregister_iteration`, and <source>
+// is the worker address or consumer id. Unused fields may be left empty. Empty lines and lines starting with '#' are skipped.
+absl::StatusOr<std::vector<AutoScalerReport>> ParseAutoScalerReports(
+    absl::string_view text);
+
+struct AutoScalerSimulationOptions {
+  // How often the recommendation is updated. Corresponds to the dispatcher's
+  // `job_gc_check_interval_ms`.
+  absl::Duration update_interval = absl::Minutes(1);
+  // Number of workers in the simulated cluster before the first update.
+  int64_t initial_number_of_workers = 1;
+  // Time it takes a worker added to the simulated cluster to become ready.
+  absl::Duration worker_warm_up_time = absl::Minutes(1);
+  // If set, recommendations are smoothed by an `AutoScalerForecaster`.
+  std::optional<AutoScalerForecastOptions> forecast_options;
+};
+
+struct AutoScalerSimulationResult {
+  struct Step {
+    absl::Time time;
+    // Point estimate of `AutoScaler`.
+    int64_t estimated_number_of_workers = 0;
+    // Recommendation the simulated cluster is resized to.
+    int64_t recommended_number_of_workers = 0;
+  };
+
+  std::vector<Step> steps;
+  int64_t num_scale_ups = 0;
+  int64_t num_scale_downs = 0;
+  // Reports that the AutoScaler rejected, e.g. removals of unknown workers.
+  int64_t num_rejected_reports = 0;
+  // Worker-seconds during which the simulated cluster had more workers than
+  // estimated.
+  double over_provisioned_worker_seconds = 0.0;
+  // Worker-seconds during which the simulated cluster had fewer ready workers
+  // than estimated.
+  double under_provisioned_worker_seconds = 0.0;
+};
+
+// Replays `reports` through a `MultipleIterationsAutoScaler` and resizes a
+// simulated cluster to each recommendation, so that scaling policies can be
+// evaluated offline.
+//
+// Recommendations are updated every `update_interval`, starting one interval
+// after the first report, and once more after the last report. The point
+// estimate at the end of each interval is taken as the demand throughout the
+// interval. Reported times are replayed as recorded, i.e. the simulated
+// cluster size does not affect them. Returns an error if `reports` are not
+// ordered by time or `options` are invalid.
+absl::StatusOr<AutoScalerSimulationResult> SimulateAutoScaler(
+    absl::Span<const AutoScalerReport> reports,
+    const AutoScalerSimulationOptions& options);
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_AUTO_SCALER_SIMULATOR_H_
@@ -0,0 +1,177 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/data/service/auto_scaler_simulator.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "tensorflow/core/data/service/auto_scaler.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/platform/status_matchers.h"
+#include "tsl/platform/statusor.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::DoubleEq;
+using ::testing::SizeIs;
+using ::tsl::testing::StatusIs;
+
+TEST(AutoScalerSimulatorTest, ParseReports) {
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<AutoScalerReport> reports,
+                          ParseAutoScalerReports(R"(
+      # time_us,type,iteration_id,source,duration_us
+      1000000,processing_time,0,/worker/task/0:20000,200000
+      2000000,target_processing_time,0,7,25000
+
+      3000000,remove_worker,0,/worker/task/0:20000,
+      4000000,remove_consumer,0,7,
+      5000000,unregister_iteration,0,,
+  )"));
+  ASSERT_THAT(reports, SizeIs(5));
+  EXPECT_EQ(reports[0].time, absl::FromUnixSeconds(1));
+  EXPECT_EQ(reports[0].type, AutoScalerReport::Type::kProcessingTime);
+  EXPECT_EQ(reports[0].worker_address, "/worker/task/0:20000");
+  EXPECT_EQ(reports[0].duration, absl::Milliseconds(200));
+  EXPECT_EQ(reports[1].type, AutoScalerReport::Type::kTargetProcessingTime);
+  EXPECT_EQ(reports[1].consumer_id, 7);
+  EXPECT_EQ(reports[1].duration, absl::Milliseconds(25));
+  EXPECT_EQ(reports[2].type, AutoScalerReport::Type::kRemoveWorker);
+  EXPECT_EQ(reports[3].type, AutoScalerReport::Type::kRemoveConsumer);
+  EXPECT_EQ(reports[4].type, AutoScalerReport::Type::kUnregisterIteration);
+  EXPECT_EQ(reports[4].time, absl::FromUnixSeconds(5));
+}
+
+TEST(AutoScalerSimulatorTest, ParseInvalidReports) {
+  EXPECT_THAT(ParseAutoScalerReports("1000000,processing_time,0"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ParseAutoScalerReports("1000000,unknown,0,,"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ParseAutoScalerReports("1000000,remove_consumer,0,worker,"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  EXPECT_THAT(ParseAutoScalerReports("1000000,processing_time,0,worker,"),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AutoScalerSimulatorTest, NoReports) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutoScalerSimulationResult result,
+      SimulateAutoScaler({}, AutoScalerSimulationOptions()));
+  EXPECT_THAT(result.steps, SizeIs(0));
+}
+
+TEST(AutoScalerSimulatorTest, UnorderedReports) {
+  std::vector<AutoScalerReport> reports(2);
+  reports[0].time = absl::FromUnixSeconds(2);
+  reports[1].time = absl::FromUnixSeconds(1);
+  EXPECT_THAT(SimulateAutoScaler(reports, AutoScalerSimulationOptions()),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+TEST(AutoScalerSimulatorTest, InvalidOptions) {
+  AutoScalerSimulationOptions options;
+  options.update_interval = absl::ZeroDuration();
+  EXPECT_THAT(SimulateAutoScaler({}, options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+  options = AutoScalerSimulationOptions();
+  options.initial_number_of_workers = 0;
+  EXPECT_THAT(SimulateAutoScaler({}, options),
+              StatusIs(absl::StatusCode::kInvalidArgument));
+}
+
+// Estimated workers = 8 throughout. The cluster grows from 4 to 8 workers at
+// 60s, and the new workers are ready at 90s, so 4 workers are missing for 30s.
+TEST(AutoScalerSimulatorTest, AccountForWarmUp) {
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<AutoScalerReport> reports,
+                          ParseAutoScalerReports(R"(
+      0,processing_time,0,/worker/task/0:20000,200000
+      0,target_processing_time,0,0,25000
+      150000000,target_processing_time,0,0,25000
+  )"));
+  AutoScalerSimulationOptions options;
+  options.update_interval = absl::Seconds(60);
+  options.initial_number_of_workers = 4;
+  options.worker_warm_up_time = absl::Seconds(30);
+  TF_ASSERT_OK_AND_ASSIGN(AutoScalerSimulationResult result,
+                          SimulateAutoScaler(reports, options));
+
+  ASSERT_THAT(result.steps, SizeIs(3));
+  for (const AutoScalerSimulationResult::Step& step : result.steps) {
+    EXPECT_EQ(step.estimated_number_of_workers, 8);
+    EXPECT_EQ(step.recommended_number_of_workers, 8);
+  }
+  EXPECT_EQ(result.steps[0].time, absl::FromUnixSeconds(60));
+  EXPECT_EQ(result.steps[2].time, absl::FromUnixSeconds(180));
+  EXPECT_EQ(result.num_scale_ups, 1);
+  EXPECT_EQ(result.num_scale_downs, 0);
+  EXPECT_EQ(result.num_rejected_reports, 0);
+  EXPECT_THAT(result.over_provisioned_worker_seconds, DoubleEq(0.0));
+  EXPECT_THAT(result.under_provisioned_worker_seconds, DoubleEq(4 * 30.0));
+}
+
+TEST(AutoScalerSimulatorTest, CountRejectedReports) {
+  TF_ASSERT_OK_AND_ASSIGN(std::vector<AutoScalerReport> reports,
+                          ParseAutoScalerReports(R"(
+      0,processing_time,0,/worker/task/0:20000,0
+      0,remove_worker,1,/worker/task/0:20000,
+  )"));
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutoScalerSimulationResult result,
+      SimulateAutoScaler(reports, AutoScalerSimulationOptions()));
+  EXPECT_EQ(result.num_rejected_reports, 2);
+  EXPECT_THAT(result.steps, SizeIs(0));
+}
+
+// The consumption rate alternates between 40 and 25 elements/s every minute,
+// so the estimate alternates between 8 and 5 workers.
+std::vector<AutoScalerReport> OscillatingReports() {
+  std::string text = "0,processing_time,0,/worker/task/0:20000,200000\n";
+  for (int64_t minute = 0; minute < 60; ++minute) {
+    absl::StrAppend(&text, minute * 60 * 1000000,
+                    ",target_processing_time,0,0,",
+                    minute % 2 == 0 ? 25000 : 40000, "\n");
+  }
+  return *ParseAutoScalerReports(text);
+}
+
+TEST(AutoScalerSimulatorTest, ForecastReducesScaling) {
+  AutoScalerSimulationOptions options;
+  options.initial_number_of_workers = 8;
+  TF_ASSERT_OK_AND_ASSIGN(
+      AutoScalerSimulationResult point_estimate_result,
+      SimulateAutoScaler(OscillatingReports(), options));
+  options.forecast_options = AutoScalerForecastOptions();
+  TF_ASSERT_OK_AND_ASSIGN(AutoScalerSimulationResult forecast_result,
+                          SimulateAutoScaler(OscillatingReports(), options));
+
+  ASSERT_THAT(point_estimate_result.steps, SizeIs(60));
+  ASSERT_THAT(forecast_result.steps, SizeIs(60));
+  EXPECT_GT(point_estimate_result.num_scale_ups, 20);
+  EXPECT_GT(point_estimate_result.num_scale_downs, 20);
+  EXPECT_LE(forecast_result.num_scale_ups + forecast_result.num_scale_downs,
+            2);
+  EXPECT_LT(forecast_result.under_provisioned_worker_seconds,
+            point_estimate_result.under_provisioned_worker_seconds);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
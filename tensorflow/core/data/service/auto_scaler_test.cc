@@ -27,6 +27,7 @@ namespace tensorflow {
 namespace data {
 namespace {
 
+using ::tsl::testing::IsOkAndHolds;
 using ::tsl::testing::StatusIs;
 
 TEST(AutoScalerTest, GetOptimalNumberOfWorkersInitialState) {
@@ -308,6 +309,114 @@ TEST(AutoScalerTest, RemoveConsumerAfterNewTPTReported) {
   TF_ASSERT_OK(auto_scaler.RemoveConsumer(0));
 }
 
+int64_t UpdateAtSecond(AutoScalerForecaster& forecaster, int64_t second,
+                       int64_t estimate) {
+  return forecaster.Update(absl::UnixEpoch() + absl::Seconds(second),
+                           estimate);
+}
+
+TEST(AutoScalerForecasterTest, InitialState) {
+  AutoScalerForecaster forecaster{AutoScalerForecastOptions()};
+  EXPECT_EQ(forecaster.recommendation(), std::nullopt);
+}
+
+TEST(AutoScalerForecasterTest, ConstantEstimate) {
+  AutoScalerForecaster forecaster{AutoScalerForecastOptions()};
+  for (int64_t second = 0; second < 600; second += 10) {
+    EXPECT_EQ(UpdateAtSecond(forecaster, second, 8), 8);
+  }
+  EXPECT_EQ(forecaster.recommendation(), 8);
+}
+
+TEST(AutoScalerForecasterTest, OscillatingEstimate) {
+  AutoScalerForecaster forecaster{AutoScalerForecastOptions()};
+  int64_t num_changes = 0;
+  int64_t recommendation = UpdateAtSecond(forecaster, 0, 10);
+  for (int64_t i = 1; i < 40; ++i) {
+    int64_t new_recommendation =
+        UpdateAtSecond(forecaster, i * 10, i % 2 == 0 ? 10 : 14);
+    if (new_recommendation != recommendation) {
+      ++num_changes;
+    }
+    recommendation = new_recommendation;
+  }
+  // The point estimate changes 39 times. The recommendation settles on the
+  // upper end of the range after a few increases.
+  EXPECT_LE(num_changes, 3);
+  EXPECT_EQ(recommendation, 14);
+}
+
+TEST(AutoScalerForecasterTest, ScaleUpWithoutPatience) {
+  AutoScalerForecaster forecaster{AutoScalerForecastOptions()};
+  for (int64_t second = 0; second < 100; second += 10) {
+    EXPECT_EQ(UpdateAtSecond(forecaster, second, 10), 10);
+  }
+  // The first high estimate is below the 0.9 quantile of the window.
+  EXPECT_EQ(UpdateAtSecond(forecaster, 100, 20), 10);
+  EXPECT_GT(UpdateAtSecond(forecaster, 110, 20), 10);
+}
+
+TEST(AutoScalerForecasterTest, ScaleDownAfterPatience) {
+  AutoScalerForecastOptions options;
+  AutoScalerForecaster forecaster(options);
+  for (int64_t second = 0; second < 100; second += 10) {
+    EXPECT_EQ(UpdateAtSecond(forecaster, second, 20), 20);
+  }
+  int64_t patience_seconds =
+      absl::ToInt64Seconds(options.scale_down_patience);
+  for (int64_t second = 100; second < 100 + patience_seconds; second += 10) {
+    EXPECT_EQ(UpdateAtSecond(forecaster, second, 10), 20);
+  }
+  for (int64_t second = 100 + patience_seconds; second < 1000; second += 10) {
+    UpdateAtSecond(forecaster, second, 10);
+  }
+  EXPECT_EQ(forecaster.recommendation(), 10);
+}
+
+TEST(AutoScalerForecasterTest, IgnoreSpike) {
+  AutoScalerForecaster forecaster{AutoScalerForecastOptions()};
+  for (int64_t second = 0; second < 50; second += 10) {
+    UpdateAtSecond(forecaster, second, 10);
+  }
+  // A single high estimate only partially moves the recommendation, and the
+  // recommendation recovers once the spike leaves the window.
+  int64_t recommendation = UpdateAtSecond(forecaster, 50, 40);
+  EXPECT_GT(recommendation, 10);
+  EXPECT_LT(recommendation, 40);
+  for (int64_t second = 60; second < 1000; second += 10) {
+    UpdateAtSecond(forecaster, second, 10);
+  }
+  EXPECT_EQ(forecaster.recommendation(), 10);
+}
+
+TEST(AutoScalerForecasterTest, NoScaleDownDuringWarmUp) {
+  AutoScalerForecastOptions options;
+  options.level_smoothing = 1.0;
+  options.trend_smoothing = 0.0;
+  options.window = absl::ZeroDuration();
+  options.scale_down_patience = absl::ZeroDuration();
+  options.worker_warm_up_time = absl::Seconds(60);
+  AutoScalerForecaster forecaster(options);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 0, 10), 10);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 10, 20), 20);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 20, 10), 20);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 60, 10), 20);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 70, 10), 10);
+}
+
+TEST(AutoScalerForecasterTest, ForecastWarmUpTimeAhead) {
+  AutoScalerForecastOptions options;
+  options.level_smoothing = 1.0;
+  options.trend_smoothing = 1.0;
+  options.window = absl::ZeroDuration();
+  options.worker_warm_up_time = absl::Seconds(60);
+  AutoScalerForecaster forecaster(options);
+  EXPECT_EQ(UpdateAtSecond(forecaster, 0, 10), 10);
+  // Trend = (20 - 10) / 10 [workers/s].
+  // Forecast = 20 + 1 * 60 = 80.
+  EXPECT_EQ(UpdateAtSecond(forecaster, 10, 20), 80);
+}
+
 TEST(MultipleIterationsAutoScalerTest, UnregisterExistingIteration) {
   MultipleIterationsAutoScaler auto_scaler;
   TF_ASSERT_OK(
@@ -743,6 +852,81 @@ TEST(MultipleIterationsAutoScalerTest, RemoveConsumerAfterNewTPTReported) {
   TF_ASSERT_OK(auto_scaler.RemoveConsumer(0, 0));
 }
 
+TEST(MultipleIterationsAutoScalerTest,
+     GetRecommendedNumberOfWorkersWithoutForecast) {
+  MultipleIterationsAutoScaler auto_scaler;
+  absl::Time now = absl::UnixEpoch();
+
+  TF_ASSERT_OK(auto_scaler.ReportProcessingTime(0, "/worker/task/0:20000",
+                                                absl::Milliseconds(200)));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(25)));
+  EXPECT_THAT(auto_scaler.GetRecommendedNumberOfWorkers(8, now),
+              IsOkAndHolds(8));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(50)));
+  EXPECT_THAT(
+      auto_scaler.GetRecommendedNumberOfWorkers(8, now + absl::Seconds(10)),
+      IsOkAndHolds(4));
+}
+
+TEST(MultipleIterationsAutoScalerTest,
+     GetRecommendedNumberOfWorkersWithForecast) {
+  MultipleIterationsAutoScaler auto_scaler{AutoScalerForecastOptions()};
+  absl::Time now = absl::UnixEpoch();
+
+  TF_ASSERT_OK(auto_scaler.ReportProcessingTime(0, "/worker/task/0:20000",
+                                                absl::Milliseconds(200)));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(25)));
+  EXPECT_THAT(auto_scaler.GetRecommendedNumberOfWorkers(8, now),
+              IsOkAndHolds(8));
+  // The point estimate drops to 4, but the recommendation is only lowered
+  // after `scale_down_patience`.
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(50)));
+  EXPECT_THAT(
+      auto_scaler.GetRecommendedNumberOfWorkers(8, now + absl::Seconds(10)),
+      IsOkAndHolds(8));
+}
+
+TEST(MultipleIterationsAutoScalerTest,
+     GetRecommendedNumberOfWorkersForecastIsBound) {
+  AutoScalerForecastOptions options;
+  options.level_smoothing = 1.0;
+  options.window = absl::ZeroDuration();
+  MultipleIterationsAutoScaler auto_scaler(options);
+
+  TF_ASSERT_OK(auto_scaler.ReportProcessingTime(0, "/worker/task/0:20000",
+                                                absl::Microseconds(500)));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Microseconds(10)));
+  // Estimated workers = 50. Current workers = 10.
+  // 50 > 10 * 4 = 40, so the recommendation is bound to 40.
+  EXPECT_THAT(auto_scaler.GetRecommendedNumberOfWorkers(10, absl::Now()),
+              IsOkAndHolds(40));
+}
+
+TEST(MultipleIterationsAutoScalerTest,
+     UpdateOptimalNumberOfWorkersMetricWithForecast) {
+  MultipleIterationsAutoScaler auto_scaler{AutoScalerForecastOptions()};
+  absl::Time now = absl::UnixEpoch();
+
+  TF_ASSERT_OK(auto_scaler.ReportProcessingTime(0, "/worker/task/0:20000",
+                                                absl::Milliseconds(200)));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(25)));
+  TF_ASSERT_OK(auto_scaler.UpdateOptimalNumberOfWorkersMetric(8, now));
+  TF_ASSERT_OK(
+      auto_scaler.ReportTargetProcessingTime(0, 0, absl::Milliseconds(50)));
+  TF_ASSERT_OK(auto_scaler.UpdateOptimalNumberOfWorkersMetric(
+      8, now + absl::Seconds(10)));
+  monitoring::testing::CellReader<int64_t> cell_reader(
+      "/tensorflow/data/service/optimal_number_of_workers");
+  EXPECT_EQ(cell_reader.Read(), 8);
+  metrics::RecordTFDataServiceOptimalNumberOfWorkers(0);
+}
+
 }  // namespace
 
 }  // namespace data
@@ -42,6 +42,11 @@ struct DataServiceParams final {
   TargetWorkers target_workers = TargetWorkers::TARGET_WORKERS_UNSPECIFIED;
   DataServiceMetadata metadata;
   std::optional<CrossTrainerCacheOptions> cross_trainer_cache_options;
+  // Whether the client uncompresses compressed elements itself instead of
+  // returning them for the pipeline to uncompress. Set for the "shm" data
+  // transfer protocol, whose server sends uncompressed elements while tasks
+  // that fall back to gRPC still receive compressed ones.
+  bool uncompress_in_client = false;
 };
 
 }  // namespace data
@@ -31,6 +31,7 @@ limitations under the License.
 #include "absl/strings/ascii.h"
 #include "absl/strings/substitute.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/compression_utils.h"
 #include "tensorflow/core/data/service/client/common.h"
 #include "tensorflow/core/data/service/client/validate_utils.h"
 #include "tensorflow/core/data/service/common.h"
@@ -920,6 +921,14 @@ Status DataServiceClient::GetElement(Task* task, int64_t deadline_micros,
       return absl::OkStatus();
     }
   }
+  if (params_.uncompress_in_client) {
+    if (const CompressedElement* compressed =
+            GetCompressedElement(get_element_result.components)) {
+      std::vector<Tensor> components;
+      TF_RETURN_IF_ERROR(UncompressElement(*compressed, &components));
+      get_element_result.components = std::move(components);
+    }
+  }
   ProcessGetElementResponse(enqueue_result, get_element_result, result, *task);
   return absl::OkStatus();
 }
@@ -20,11 +20,16 @@ limitations under the License.
 #include <functional>
 #include <limits>
 #include <memory>
+#include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/data/service/byte_size.h"
+#include "tensorflow/core/data/service/cross_trainer_cache_disk_tier.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -46,6 +51,12 @@ namespace data {
 // collected when the cache becomes full. Consequently, trainers read from a
 // sliding window through the dataset and may not read the full dataset.
 //
+// If a `CrossTrainerCacheDiskTier` is provided, elements are serialized and
+// spilled to disk before they are evicted from memory. Trainers that fall
+// behind the in-memory window then read from disk, which extends the window by
+// the disk budget. This requires the `CachableSequence` to implement
+// `SerializeElement` and `DeserializeElement`.
+//
 // The `CrossTrainerCache` class is thread-safe.
 //
 // Example usage:
@@ -78,7 +89,8 @@ namespace data {
 // To use the cache, the user needs to define a `CachableSequence` to generate
 // an infinite sequence of data. It should implement a `GetNext` method to
 // produce elements, and a `GetElementSizeBytes` method to estimate the element
-// size in bytes.
+// size in bytes. To spill elements to disk, it should also implement
+// `SerializeElement` and `DeserializeElement`.
 template <class ElementType>
 class CachableSequence {
  public:
@@ -89,6 +101,20 @@ class CachableSequence {
 
   // Returns the estimated size of the element in bytes.
   virtual size_t GetElementSizeBytes(const ElementType&) const = 0;
+
+  // Serializes the element to be spilled to disk. It may be called
+  // concurrently with `DeserializeElement`.
+  virtual StatusOr<std::string> SerializeElement(const ElementType&) const {
+    return errors::Unimplemented(
+        "This CachableSequence does not support spilling to disk.");
+  }
+
+  // Deserializes an element spilled to disk. It may be called concurrently
+  // from multiple threads.
+  virtual StatusOr<ElementType> DeserializeElement(absl::string_view) const {
+    return errors::Unimplemented(
+        "This CachableSequence does not support spilling to disk.");
+  }
 };
 
 // Sliding-window cache shared across concurrent trainers.
@@ -98,9 +124,12 @@ class CrossTrainerCache {
   // Creates a `CrossTrainerCache` with `max_cache_size_bytes` of memory budget.
   // The cache should be able to hold at least one element, i.e.:
   // REQUIRES: `max_cache_size_bytes >= max(GetElementSizeBytes(*))`
+  //
+  // If `disk_tier` is not null, evicted elements are spilled to it.
   explicit CrossTrainerCache(
       size_t max_cache_size_bytes,
-      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence);
+      std::unique_ptr<CachableSequence<ElementType>> cachable_sequence,
+      std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier = nullptr);
   virtual ~CrossTrainerCache() = default;
   CrossTrainerCache(const CrossTrainerCache&) = delete;
   CrossTrainerCache& operator=(const CrossTrainerCache&) = delete;
@@ -134,10 +163,22 @@ class CrossTrainerCache {
   // data is not ready, one of the trainers need to extend the cache.
   bool IsElementReady(const std::string& trainer_id);
 
+  // Returns true if the next element for `trainer_id` has been evicted from
+  // memory but can be read from the disk tier.
+  bool IsElementSpilled(const std::string& trainer_id);
+
   // Returns the absolute element index relative to the dataset (not relative to
-  // the cached elements).
+  // the cached elements). New trainers start at the oldest element in memory.
   size_t GetElementIndex(const std::string& trainer_id);
 
+  // Returns the absolute index of the oldest element available, in memory or
+  // on disk.
+  size_t OldestElementIndex();
+
+  // Reads the element at absolute index `element_index` from the disk tier.
+  StatusOr<std::shared_ptr<const ElementType>> ReadSpilledElement(
+      size_t element_index);
+
   // Returns the next element for `trainer_id`.
   StatusOr<std::shared_ptr<const ElementType>> GetElement(
       const std::string& trainer_id);
@@ -145,6 +186,11 @@ class CrossTrainerCache {
   // Reads a new element and writes it into the cache.
   Status ExtendCache();
 
+  // Writes the elements that `FreeSpace` is going to free to the disk tier.
+  // Only the thread extending the cache frees elements, so the same elements
+  // are freed after this returns.
+  void SpillElements(size_t new_element_size_bytes);
+
   // Frees old elements to keep the cache size below `max_cache_size_bytes_`.
   // `new_element_size_bytes` is the size of the new element being inserted.
   void FreeSpace(size_t new_element_size_bytes);
@@ -158,6 +204,10 @@ class CrossTrainerCache {
   // The element sequence over which the sliding window cache operates.
   std::unique_ptr<CachableSequence<ElementType>> cachable_sequence_;
 
+  // Holds the elements evicted from `cache_`, if spilling is enabled. It is
+  // internally synchronized.
+  const std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier_;
+
   mutable mutex mu_;
   mutable condition_variable cv_;
 
@@ -183,9 +233,11 @@ class CrossTrainerCache {
 template <class ElementType>
 CrossTrainerCache<ElementType>::CrossTrainerCache(
     size_t max_cache_size_bytes,
-    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence)
+    std::unique_ptr<CachableSequence<ElementType>> cachable_sequence,
+    std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier)
     : max_cache_size_bytes_(max_cache_size_bytes),
-      cachable_sequence_(std::move(cachable_sequence)) {
+      cachable_sequence_(std::move(cachable_sequence)),
+      disk_tier_(std::move(disk_tier)) {
   DCHECK_GT(max_cache_size_bytes, 0)
       << "CrossTrainerCache size must be greater than 0.";
   VLOG(2) << "Initialized tf.data service cross-trainer cache with "
@@ -212,6 +264,7 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
     const std::string& trainer_id) {
   bool should_extend_cache = false;
   while (true) {
+    std::optional<size_t> spilled_element_index;
     {
       mutex_lock l(mu_);
       TF_RETURN_IF_ERROR(status_);
@@ -224,8 +277,11 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
 
       // Extends the cache or waits for another thread to extend the cache. When
       // concurrent trainers wait for the next element, only one of them should
-      // extend the cache.
-      if (extending_cache_) {
+      // extend the cache. Trainers behind the in-memory window read from disk.
+      if (IsElementSpilled(trainer_id)) {
+        should_extend_cache = false;
+        spilled_element_index = GetElementIndex(trainer_id);
+      } else if (extending_cache_) {
         should_extend_cache = false;
         cv_.wait(l);
       } else {
@@ -234,6 +290,28 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
       }
     }
 
+    if (spilled_element_index.has_value()) {
+      // Reads from disk without holding the lock, so trainers reading from
+      // memory are not blocked.
+      StatusOr<std::shared_ptr<const ElementType>> element =
+          ReadSpilledElement(*spilled_element_index);
+      mutex_lock l(mu_);
+      if (element.ok()) {
+        trainer_to_element_index_map_[trainer_id] = *spilled_element_index + 1;
+        return CacheQueryResult{*std::move(element), /*is_cache_hit=*/true};
+      }
+      // If the element has been evicted from disk in the meantime, retries
+      // from the oldest available element. Otherwise, skips to the elements in
+      // memory, as if the disk tier were disabled.
+      if (!absl::IsNotFound(element.status())) {
+        LOG_EVERY_N_SEC(WARNING, 60)
+            << "Failed to read tf.data service cross-trainer cache element "
+            << *spilled_element_index << " from disk: " << element.status();
+        trainer_to_element_index_map_[trainer_id] = cache_start_index_;
+      }
+      continue;
+    }
+
     if (should_extend_cache) {
       Status s = ExtendCache();
       mutex_lock l(mu_);
@@ -247,7 +325,21 @@ CrossTrainerCache<ElementType>::GetCacheQueryResult(
 template <class ElementType>
 bool CrossTrainerCache<ElementType>::IsElementReady(
     const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  return GetElementIndex(trainer_id) < cache_start_index_ + cache_.size();
+  size_t element_index = GetElementIndex(trainer_id);
+  return element_index >= cache_start_index_ &&
+         element_index < cache_start_index_ + cache_.size();
+}
+
+template <class ElementType>
+bool CrossTrainerCache<ElementType>::IsElementSpilled(
+    const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (disk_tier_ == nullptr) {
+    return false;
+  }
+  // `GetElementIndex` only returns an index before the in-memory elements if
+  // the disk tier holds it. If it is evicted before the read, the read fails
+  // with NotFound and the trainer retries.
+  return GetElementIndex(trainer_id) < cache_start_index_;
 }
 
 template <class ElementType>
@@ -270,13 +362,51 @@ CrossTrainerCache<ElementType>::GetElement(const std::string& trainer_id)
 template <class ElementType>
 size_t CrossTrainerCache<ElementType>::GetElementIndex(
     const std::string& trainer_id) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-  size_t element_index = trainer_to_element_index_map_[trainer_id];
-  if (element_index < cache_start_index_) {
-    element_index = cache_start_index_;
+  auto [it, inserted] =
+      trainer_to_element_index_map_.try_emplace(trainer_id, cache_start_index_);
+  if (inserted) {
+    // New trainers start at the oldest element in memory. Only trainers that
+    // fall behind the in-memory window read from the disk tier.
+    return cache_start_index_;
+  }
+  size_t element_index = it->second;
+  size_t oldest_element_index = OldestElementIndex();
+  if (element_index < oldest_element_index) {
+    element_index = oldest_element_index;
   }
   return element_index;
 }
 
+template <class ElementType>
+size_t CrossTrainerCache<ElementType>::OldestElementIndex()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (disk_tier_ == nullptr) {
+    return cache_start_index_;
+  }
+  // The disk tier only extends the window if it holds the elements right
+  // before the in-memory ones. While elements are being spilled, they are
+  // both on disk and in memory.
+  size_t disk_start_index = disk_tier_->start_index();
+  size_t disk_end_index = disk_tier_->end_index();
+  if (disk_start_index >= cache_start_index_ ||
+      disk_end_index < cache_start_index_) {
+    return cache_start_index_;
+  }
+  return disk_start_index;
+}
+
+template <class ElementType>
+StatusOr<std::shared_ptr<const ElementType>>
+CrossTrainerCache<ElementType>::ReadSpilledElement(size_t element_index)
+    TF_LOCKS_EXCLUDED(mu_) {
+  TF_ASSIGN_OR_RETURN(std::string serialized_element,
+                      disk_tier_->Read(element_index));
+  TF_ASSIGN_OR_RETURN(
+      ElementType element,
+      cachable_sequence_->DeserializeElement(serialized_element));
+  return std::make_shared<const ElementType>(std::move(element));
+}
+
 template <class ElementType>
 Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
   TF_ASSIGN_OR_RETURN(ElementType element, cachable_sequence_->GetNext());
@@ -289,6 +419,9 @@ Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
         " and cache size: ", max_cache_size_bytes_);
   }
 
+  if (disk_tier_ != nullptr) {
+    SpillElements(new_element_size_bytes);
+  }
   mutex_lock l(mu_);
   TF_RETURN_IF_ERROR(status_);
   FreeSpace(new_element_size_bytes);
@@ -297,6 +430,42 @@ Status CrossTrainerCache<ElementType>::ExtendCache() TF_LOCKS_EXCLUDED(mu_) {
   return absl::OkStatus();
 }
 
+template <class ElementType>
+void CrossTrainerCache<ElementType>::SpillElements(
+    size_t new_element_size_bytes) TF_LOCKS_EXCLUDED(mu_) {
+  std::vector<std::shared_ptr<const ElementType>> elements_to_spill;
+  size_t first_element_index = 0;
+  {
+    mutex_lock l(mu_);
+    first_element_index = cache_start_index_;
+    size_t cache_size_bytes = cache_size_bytes_;
+    for (const std::shared_ptr<const ElementType>& element : cache_) {
+      if (cache_size_bytes + new_element_size_bytes <= max_cache_size_bytes_) {
+        break;
+      }
+      cache_size_bytes -= cachable_sequence_->GetElementSizeBytes(*element);
+      elements_to_spill.push_back(element);
+    }
+  }
+
+  // Serializes and writes the elements without holding the lock, so trainers
+  // can keep reading from memory.
+  for (size_t i = 0; i < elements_to_spill.size(); ++i) {
+    const size_t element_index = first_element_index + i;
+    StatusOr<std::string> serialized_element =
+        cachable_sequence_->SerializeElement(*elements_to_spill[i]);
+    Status s = serialized_element.status();
+    if (s.ok()) {
+      s = disk_tier_->Append(element_index, *serialized_element);
+    }
+    if (!s.ok()) {
+      LOG_EVERY_N_SEC(WARNING, 60)
+          << "Failed to spill tf.data service cross-trainer cache element "
+          << element_index << " to disk: " << s;
+    }
+  }
+}
+
 template <class ElementType>
 void CrossTrainerCache<ElementType>::FreeSpace(size_t new_element_size_bytes)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -0,0 +1,354 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/cross_trainer_cache_disk_tier.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/service/byte_size.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/statusor.h"
+#include "tensorflow/core/platform/tstring.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr char kSegmentFilePrefix[] = "segment_";
+// The disk budget is split into at least this many segments, so that evicting
+// the oldest segment frees a small fraction of the cached data.
+constexpr size_t kMinNumSegments = 4;
+// The readahead buffer holds up to this many times `readahead_elements`, to
+// serve several lagging trainers reading at different positions.
+constexpr size_t kReadaheadBufferFactor = 4;
+
+size_t RecordSizeBytes(size_t data_size_bytes) {
+  return io::RecordWriter::kHeaderSize + data_size_bytes +
+         io::RecordWriter::kFooterSize;
+}
+
+}  // namespace
+
+CrossTrainerCacheDiskTier::Segment::Segment(Env* env, std::string filename,
+                                            size_t first_index)
+    : env(env), filename(std::move(filename)), first_index(first_index) {}
+
+CrossTrainerCacheDiskTier::Segment::~Segment() {
+  file.reset();
+  Status s = env->DeleteFile(filename);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete tf.data service cross-trainer cache "
+                 << "segment " << filename << ": " << s;
+  }
+}
+
+absl::StatusOr<std::unique_ptr<CrossTrainerCacheDiskTier>>
+CrossTrainerCacheDiskTier::Create(Env* env, const Options& options) {
+  if (options.directory.empty()) {
+    return errors::InvalidArgument(
+        "tf.data service cross-trainer cache disk tier requires a directory.");
+  }
+  if (options.max_size_bytes == 0) {
+    return errors::InvalidArgument(
+        "tf.data service cross-trainer cache disk tier size must be greater "
+        "than 0.");
+  }
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(options.directory));
+  auto disk_tier =
+      absl::WrapUnique(new CrossTrainerCacheDiskTier(env, options));
+  if (disk_tier->readahead_elements_ > 0) {
+    disk_tier->readahead_thread_ = absl::WrapUnique(env->StartThread(
+        ThreadOptions(), "tf_data_cross_trainer_cache_readahead",
+        [tier = disk_tier.get()]() { tier->ReadaheadThread(); }));
+  }
+  VLOG(2) << "Initialized tf.data service cross-trainer cache disk tier in "
+          << options.directory << " with "
+          << ByteSize::Bytes(options.max_size_bytes) << " of disk.";
+  return disk_tier;
+}
+
+CrossTrainerCacheDiskTier::CrossTrainerCacheDiskTier(Env* env,
+                                                     const Options& options)
+    : env_(env),
+      directory_(options.directory),
+      max_size_bytes_(options.max_size_bytes),
+      segment_size_bytes_(std::max<size_t>(
+          1, std::min(options.segment_size_bytes,
+                      options.max_size_bytes / kMinNumSegments))),
+      readahead_elements_(options.readahead_elements),
+      max_readahead_buffer_elements_(options.readahead_elements *
+                                     kReadaheadBufferFactor) {}
+
+CrossTrainerCacheDiskTier::~CrossTrainerCacheDiskTier() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    readahead_cv_.notify_all();
+  }
+  // Joins the readahead thread.
+  readahead_thread_.reset();
+  CloseWriter().IgnoreError();
+  {
+    mutex_lock l(mu_);
+    ResetLocked(end_index_);
+  }
+  writable_segment_.reset();
+  // Removes the directory if it is empty. Other processes may share it.
+  env_->DeleteDir(directory_).IgnoreError();
+}
+
+absl::Status CrossTrainerCacheDiskTier::Append(
+    size_t index, absl::string_view serialized_element) {
+  bool start_segment = writer_ == nullptr ||
+                       writable_segment_->size_bytes >= segment_size_bytes_;
+  {
+    mutex_lock l(mu_);
+    if (index != end_index_) {
+      ResetLocked(index);
+      start_segment = true;
+    }
+  }
+  if (start_segment) {
+    absl::Status s = StartSegment(index);
+    if (!s.ok()) {
+      mutex_lock l(mu_);
+      ResetLocked(index + 1);
+      return s;
+    }
+  }
+
+  const uint64_t offset = writer_offset_;
+  absl::Status s = writer_->WriteRecord(serialized_element);
+  if (s.ok()) {
+    // Flushes the record so the readers' positional reads can see it.
+    s = writer_->Flush();
+  }
+  if (!s.ok()) {
+    CloseWriter().IgnoreError();
+    mutex_lock l(mu_);
+    ResetLocked(index + 1);
+    return s;
+  }
+  const size_t record_size_bytes = RecordSizeBytes(serialized_element.size());
+  writer_offset_ += record_size_bytes;
+
+  // Evicted segments are destroyed, and their files deleted, outside of the
+  // lock. A segment still in use by a reader is destroyed after the read.
+  std::vector<std::shared_ptr<Segment>> evicted_segments;
+  {
+    mutex_lock l(mu_);
+    writable_segment_->offsets.push_back(offset);
+    writable_segment_->size_bytes += record_size_bytes;
+    size_bytes_ += record_size_bytes;
+    ++end_index_;
+    while (size_bytes_ > max_size_bytes_ && segments_.size() > 1) {
+      std::shared_ptr<Segment> oldest = std::move(segments_.front());
+      segments_.pop_front();
+      size_bytes_ -= oldest->size_bytes;
+      start_index_ = segments_.front()->first_index;
+      evicted_segments.push_back(std::move(oldest));
+    }
+    readahead_buffer_.erase(readahead_buffer_.begin(),
+                            readahead_buffer_.lower_bound(start_index_));
+  }
+  if (!evicted_segments.empty()) {
+    VLOG(3) << "Evicted " << evicted_segments.size() << " segment(s) from "
+            << "tf.data service cross-trainer cache disk tier.";
+  }
+  return absl::OkStatus();
+}
+
+absl::Status CrossTrainerCacheDiskTier::StartSegment(size_t first_index) {
+  TF_RETURN_IF_ERROR(CloseWriter());
+  std::string filename = io::JoinPath(
+      directory_, absl::StrCat(kSegmentFilePrefix, next_segment_id_++));
+  TF_RETURN_IF_ERROR(env_->NewWritableFile(filename, &writable_file_));
+  auto segment =
+      std::make_shared<Segment>(env_, std::move(filename), first_index);
+  TF_RETURN_IF_ERROR(
+      env_->NewRandomAccessFile(segment->filename, &segment->file));
+  writer_ = std::make_unique<io::RecordWriter>(writable_file_.get());
+  writer_offset_ = 0;
+  writable_segment_ = segment;
+  mutex_lock l(mu_);
+  segments_.push_back(std::move(segment));
+  return absl::OkStatus();
+}
+
+absl::Status CrossTrainerCacheDiskTier::CloseWriter() {
+  absl::Status s = absl::OkStatus();
+  if (writer_ != nullptr) {
+    s.Update(writer_->Close());
+    writer_.reset();
+  }
+  if (writable_file_ != nullptr) {
+    s.Update(writable_file_->Close());
+    writable_file_.reset();
+  }
+  return s;
+}
+
+void CrossTrainerCacheDiskTier::ResetLocked(size_t next_index) {
+  segments_.clear();
+  readahead_buffer_.clear();
+  readahead_request_.reset();
+  start_index_ = next_index;
+  end_index_ = next_index;
+  size_bytes_ = 0;
+}
+
+absl::StatusOr<std::string> CrossTrainerCacheDiskTier::Read(size_t index) {
+  std::shared_ptr<Segment> segment;
+  uint64_t offset = 0;
+  {
+    mutex_lock l(mu_);
+    if (index < start_index_ || index >= end_index_) {
+      return errors::NotFound(
+          "tf.data service cross-trainer cache element ", index,
+          " is not on disk. Elements on disk: [", start_index_, ", ",
+          end_index_, ").");
+    }
+    ScheduleReadahead(index + 1);
+    auto it = readahead_buffer_.find(index);
+    if (it != readahead_buffer_.end()) {
+      std::string element = std::move(it->second);
+      readahead_buffer_.erase(it);
+      return element;
+    }
+    segment = FindSegment(index, offset);
+  }
+  return ReadRecord(*segment, offset);
+}
+
+bool CrossTrainerCacheDiskTier::Contains(size_t index) const {
+  mutex_lock l(mu_);
+  return index >= start_index_ && index < end_index_;
+}
+
+size_t CrossTrainerCacheDiskTier::start_index() const {
+  mutex_lock l(mu_);
+  return start_index_;
+}
+
+size_t CrossTrainerCacheDiskTier::end_index() const {
+  mutex_lock l(mu_);
+  return end_index_;
+}
+
+size_t CrossTrainerCacheDiskTier::size_bytes() const {
+  mutex_lock l(mu_);
+  return size_bytes_;
+}
+
+std::shared_ptr<CrossTrainerCacheDiskTier::Segment>
+CrossTrainerCacheDiskTier::FindSegment(size_t index, uint64_t& offset) const {
+  // Finds the last segment whose first index is not greater than `index`.
+  auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), index,
+      [](size_t i, const std::shared_ptr<Segment>& segment) {
+        return i < segment->first_index;
+      });
+  DCHECK(it != segments_.begin());
+  const std::shared_ptr<Segment>& segment = *std::prev(it);
+  offset = segment->offsets[index - segment->first_index];
+  return segment;
+}
+
+absl::StatusOr<std::string> CrossTrainerCacheDiskTier::ReadRecord(
+    const Segment& segment, uint64_t offset) {
+  io::RecordReader reader(segment.file.get());
+  tstring record;
+  TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &record));
+  return std::string(record);
+}
+
+void CrossTrainerCacheDiskTier::ScheduleReadahead(size_t index) {
+  if (readahead_thread_ == nullptr) {
+    return;
+  }
+  readahead_request_ = index;
+  readahead_cv_.notify_one();
+}
+
+void CrossTrainerCacheDiskTier::ReadaheadThread() {
+  while (true) {
+    size_t start = 0;
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && !readahead_request_.has_value()) {
+        readahead_cv_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+      start = *readahead_request_;
+      readahead_request_.reset();
+    }
+
+    for (size_t index = start; index < start + readahead_elements_; ++index) {
+      std::shared_ptr<Segment> segment;
+      uint64_t offset = 0;
+      {
+        mutex_lock l(mu_);
+        // Stops early if a newer request arrives, so readahead follows the
+        // most recent reader.
+        if (cancelled_ || readahead_request_.has_value() ||
+            index < start_index_ || index >= end_index_) {
+          break;
+        }
+        if (readahead_buffer_.count(index) > 0) {
+          continue;
+        }
+        segment = FindSegment(index, offset);
+      }
+
+      absl::StatusOr<std::string> element = ReadRecord(*segment, offset);
+      if (!element.ok()) {
+        VLOG(2) << "Failed to read ahead tf.data service cross-trainer cache "
+                << "element " << index << ": " << element.status();
+        break;
+      }
+
+      mutex_lock l(mu_);
+      if (index < start_index_ || index >= end_index_) {
+        break;
+      }
+      while (readahead_buffer_.size() >= max_readahead_buffer_elements_) {
+        readahead_buffer_.erase(readahead_buffer_.begin());
+      }
+      readahead_buffer_.emplace(index, *std::move(element));
+    }
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
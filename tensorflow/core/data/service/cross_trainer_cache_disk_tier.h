@@ -0,0 +1,180 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_DISK_TIER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_DISK_TIER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/file_system.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Disk tier of the `CrossTrainerCache`. Elements evicted from the in-memory
+// sliding window are appended here, so trainers that fall behind the window
+// can still read them instead of skipping ahead.
+//
+// Elements are stored as TFRecords in a sequence of segment files under
+// `Options::directory`. Elements are identified by their absolute index in the
+// dataset and must be appended in increasing, contiguous order. When the tier
+// exceeds `Options::max_size_bytes`, the oldest segment is deleted. A segment
+// file is removed once it is evicted and no reader is using it.
+//
+// Reads are served by positional reads into the segment files. After a read, a
+// background thread reads the following `Options::readahead_elements` elements
+// into a bounded buffer, so a lagging trainer that reads sequentially does not
+// block on disk for every element.
+//
+// `Append` may only be called by one thread at a time. Other methods are
+// thread-safe.
+class CrossTrainerCacheDiskTier {
+ public:
+  struct Options {
+    // Directory to write the segment files to. It is created if it does not
+    // exist, and removed when the tier is destroyed.
+    std::string directory;
+    // Maximum disk usage in bytes.
+    size_t max_size_bytes = 0;
+    // Target size of each segment file. It is capped so that the tier holds
+    // several segments and eviction frees a small fraction of the data.
+    size_t segment_size_bytes = 64 * (size_t{1} << 20);  // 64MB
+    // Number of elements to read ahead of the last read.
+    size_t readahead_elements = 16;
+  };
+
+  // Creates a disk tier writing to `options.directory`.
+  static absl::StatusOr<std::unique_ptr<CrossTrainerCacheDiskTier>> Create(
+      Env* env, const Options& options);
+  virtual ~CrossTrainerCacheDiskTier();
+  CrossTrainerCacheDiskTier(const CrossTrainerCacheDiskTier&) = delete;
+  CrossTrainerCacheDiskTier& operator=(const CrossTrainerCacheDiskTier&) =
+      delete;
+
+  // Appends the serialized element at absolute index `index`. If `index` is
+  // not `end_index()`, the existing elements are discarded and the tier starts
+  // over from `index`. If the write fails, the existing elements are also
+  // discarded, and the tier continues from `index + 1`.
+  absl::Status Append(size_t index, absl::string_view serialized_element)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the serialized element at absolute index `index`. Returns a
+  // NotFound error if the element is not on disk, e.g. if it has been evicted.
+  absl::StatusOr<std::string> Read(size_t index) TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns true if the element at absolute index `index` is on disk.
+  bool Contains(size_t index) const TF_LOCKS_EXCLUDED(mu_);
+
+  // The elements in [start_index(), end_index()) are on disk.
+  size_t start_index() const TF_LOCKS_EXCLUDED(mu_);
+  size_t end_index() const TF_LOCKS_EXCLUDED(mu_);
+
+  // Returns the number of bytes written to the segment files on disk.
+  size_t size_bytes() const TF_LOCKS_EXCLUDED(mu_);
+
+ private:
+  // A segment file holding the elements starting from `first_index`.
+  struct Segment {
+    Segment(Env* env, std::string filename, size_t first_index);
+    // Deletes the segment file.
+    ~Segment();
+
+    Env* const env;
+    const std::string filename;
+    const size_t first_index;
+    // Used by readers for positional reads. `RandomAccessFile` is
+    // thread-safe.
+    std::unique_ptr<RandomAccessFile> file;
+    // The file offsets of the elements, guarded by the tier's `mu_`.
+    std::vector<uint64_t> offsets;
+    size_t size_bytes = 0;
+  };
+
+  CrossTrainerCacheDiskTier(Env* env, const Options& options);
+
+  // Closes the current segment, if any, and starts a new one whose first
+  // element is `first_index`.
+  absl::Status StartSegment(size_t first_index) TF_LOCKS_EXCLUDED(mu_);
+
+  // Closes the segment being written to.
+  absl::Status CloseWriter();
+
+  // Discards all elements. The next element to append is `next_index`.
+  void ResetLocked(size_t next_index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the segment containing `index` and the element's offset in it.
+  // REQUIRES: start_index_ <= index < end_index_
+  std::shared_ptr<Segment> FindSegment(size_t index, uint64_t& offset) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Reads the record at `offset` from `segment`.
+  static absl::StatusOr<std::string> ReadRecord(const Segment& segment,
+                                                uint64_t offset);
+
+  // Asks the readahead thread to read elements starting from `index`.
+  void ScheduleReadahead(size_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Runs the readahead thread.
+  void ReadaheadThread();
+
+  Env* const env_;
+  const std::string directory_;
+  const size_t max_size_bytes_;
+  const size_t segment_size_bytes_;
+  const size_t readahead_elements_;
+  const size_t max_readahead_buffer_elements_;
+
+  // Writer state. These are only used by `Append`, which is not called
+  // concurrently, so they are not guarded by `mu_`.
+  std::unique_ptr<WritableFile> writable_file_;
+  std::unique_ptr<io::RecordWriter> writer_;
+  std::shared_ptr<Segment> writable_segment_;
+  uint64_t writer_offset_ = 0;
+  int64_t next_segment_id_ = 0;
+
+  mutable mutex mu_;
+  condition_variable readahead_cv_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+
+  std::deque<std::shared_ptr<Segment>> segments_ TF_GUARDED_BY(mu_);
+  size_t start_index_ TF_GUARDED_BY(mu_) = 0;
+  size_t end_index_ TF_GUARDED_BY(mu_) = 0;
+  size_t size_bytes_ TF_GUARDED_BY(mu_) = 0;
+
+  // Elements read ahead of the readers, keyed by absolute index. A buffered
+  // element is removed when it is read.
+  std::map<size_t, std::string> readahead_buffer_ TF_GUARDED_BY(mu_);
+  // The index to start the next readahead from, if any.
+  std::optional<size_t> readahead_request_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<Thread> readahead_thread_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_CROSS_TRAINER_CACHE_DISK_TIER_H_
@@ -0,0 +1,165 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/cross_trainer_cache_disk_tier.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status_matchers.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/error_codes.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::tensorflow::testing::IsOkAndHolds;
+using ::tensorflow::testing::StatusIs;
+using ::testing::SizeIs;
+
+std::string Element(size_t index) { return absl::StrCat("Element ", index); }
+
+std::unique_ptr<CrossTrainerCacheDiskTier> CreateDiskTier(
+    size_t max_size_bytes, size_t readahead_elements = 16) {
+  CrossTrainerCacheDiskTier::Options options;
+  options.directory = io::JoinPath(testing::TmpDir(),
+                                   absl::StrCat("disk_tier_", random::New64()));
+  options.max_size_bytes = max_size_bytes;
+  options.readahead_elements = readahead_elements;
+  auto disk_tier = CrossTrainerCacheDiskTier::Create(Env::Default(), options);
+  TF_CHECK_OK(disk_tier.status());
+  return *std::move(disk_tier);
+}
+
+TEST(CrossTrainerCacheDiskTierTest, AppendAndRead) {
+  std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier =
+      CreateDiskTier(/*max_size_bytes=*/1 << 20);
+  for (size_t i = 0; i < 100; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+  }
+  EXPECT_EQ(disk_tier->start_index(), 0);
+  EXPECT_EQ(disk_tier->end_index(), 100);
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_TRUE(disk_tier->Contains(i));
+    EXPECT_THAT(disk_tier->Read(i), IsOkAndHolds(Element(i)));
+  }
+  EXPECT_FALSE(disk_tier->Contains(100));
+  EXPECT_THAT(disk_tier->Read(100), StatusIs(error::NOT_FOUND));
+}
+
+TEST(CrossTrainerCacheDiskTierTest, ReadWithoutReadahead) {
+  std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier =
+      CreateDiskTier(/*max_size_bytes=*/1 << 20, /*readahead_elements=*/0);
+  for (size_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+  }
+  for (size_t i = 0; i < 10; ++i) {
+    EXPECT_THAT(disk_tier->Read(i), IsOkAndHolds(Element(i)));
+  }
+}
+
+TEST(CrossTrainerCacheDiskTierTest, EvictOldestSegments) {
+  const size_t max_size_bytes = 1000;
+  std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier =
+      CreateDiskTier(max_size_bytes);
+  for (size_t i = 0; i < 1000; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+    EXPECT_LE(disk_tier->size_bytes(), max_size_bytes);
+  }
+
+  const size_t start_index = disk_tier->start_index();
+  EXPECT_GT(start_index, 0);
+  EXPECT_EQ(disk_tier->end_index(), 1000);
+  EXPECT_THAT(disk_tier->Read(start_index - 1), StatusIs(error::NOT_FOUND));
+  for (size_t i = start_index; i < 1000; ++i) {
+    EXPECT_THAT(disk_tier->Read(i), IsOkAndHolds(Element(i)));
+  }
+}
+
+TEST(CrossTrainerCacheDiskTierTest, NonContiguousAppendStartsOver) {
+  std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier =
+      CreateDiskTier(/*max_size_bytes=*/1 << 20);
+  for (size_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+  }
+  TF_ASSERT_OK(disk_tier->Append(20, Element(20)));
+  EXPECT_EQ(disk_tier->start_index(), 20);
+  EXPECT_EQ(disk_tier->end_index(), 21);
+  EXPECT_FALSE(disk_tier->Contains(9));
+  EXPECT_THAT(disk_tier->Read(20), IsOkAndHolds(Element(20)));
+}
+
+TEST(CrossTrainerCacheDiskTierTest, ConcurrentReaders) {
+  std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier =
+      CreateDiskTier(/*max_size_bytes=*/1 << 20);
+  for (size_t i = 0; i < 200; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+  }
+
+  std::vector<std::unique_ptr<Thread>> reader_threads;
+  for (size_t i = 0; i < 10; ++i) {
+    reader_threads.push_back(absl::WrapUnique(Env::Default()->StartThread(
+        /*thread_options=*/{}, /*name=*/absl::StrCat("Reader_", i),
+        [&disk_tier, i]() {
+          for (size_t j = i * 10; j < 200; ++j) {
+            EXPECT_THAT(disk_tier->Read(j), IsOkAndHolds(Element(j)));
+          }
+        })));
+  }
+}
+
+TEST(CrossTrainerCacheDiskTierTest, DeleteFilesOnDestruction) {
+  CrossTrainerCacheDiskTier::Options options;
+  options.directory = io::JoinPath(testing::TmpDir(),
+                                   absl::StrCat("disk_tier_", random::New64()));
+  options.max_size_bytes = 1 << 20;
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier,
+      CrossTrainerCacheDiskTier::Create(Env::Default(), options));
+  for (size_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK(disk_tier->Append(i, Element(i)));
+  }
+  std::vector<std::string> files;
+  TF_ASSERT_OK(Env::Default()->GetChildren(options.directory, &files));
+  EXPECT_THAT(files, SizeIs(1));
+
+  disk_tier.reset();
+  EXPECT_THAT(Env::Default()->FileExists(options.directory),
+              StatusIs(error::NOT_FOUND));
+}
+
+TEST(CrossTrainerCacheDiskTierTest, InvalidOptions) {
+  CrossTrainerCacheDiskTier::Options options;
+  options.max_size_bytes = 1 << 20;
+  EXPECT_THAT(CrossTrainerCacheDiskTier::Create(Env::Default(), options),
+              StatusIs(error::INVALID_ARGUMENT));
+
+  options.directory = testing::TmpDir();
+  options.max_size_bytes = 0;
+  EXPECT_THAT(CrossTrainerCacheDiskTier::Create(Env::Default(), options),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
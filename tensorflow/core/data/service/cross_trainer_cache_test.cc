@@ -22,14 +22,18 @@ limitations under the License.
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "absl/time/time.h"
+#include "tensorflow/core/data/service/cross_trainer_cache_disk_tier.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/lib/monitoring/cell_reader.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/status_matchers.h"
@@ -61,6 +65,23 @@ class InfiniteRange : public CachableSequence<int64_t> {
   int64_t next_ = 0;
 };
 
+// Like `InfiniteRange`, but supports spilling elements to disk.
+class SerializableInfiniteRange : public InfiniteRange {
+ public:
+  absl::StatusOr<std::string> SerializeElement(
+      const int64_t& element) const override {
+    return absl::StrCat(element);
+  }
+  absl::StatusOr<int64_t> DeserializeElement(
+      absl::string_view serialized_element) const override {
+    int64_t element = 0;
+    if (!absl::SimpleAtoi(serialized_element, &element)) {
+      return errors::DataLoss("Failed to parse element ", serialized_element);
+    }
+    return element;
+  }
+};
+
 class TensorDataset : public CachableSequence<Tensor> {
  public:
   absl::StatusOr<Tensor> GetNext() override { return Tensor("Test Tensor"); }
@@ -129,6 +150,17 @@ std::vector<int64_t> GetRange(const size_t range) {
   return result;
 }
 
+std::unique_ptr<CrossTrainerCacheDiskTier> CreateDiskTier(
+    size_t max_size_bytes) {
+  CrossTrainerCacheDiskTier::Options options;
+  options.directory = io::JoinPath(
+      testing::TmpDir(), absl::StrCat("cross_trainer_cache_", random::New64()));
+  options.max_size_bytes = max_size_bytes;
+  auto disk_tier = CrossTrainerCacheDiskTier::Create(Env::Default(), options);
+  TF_CHECK_OK(disk_tier.status());
+  return *std::move(disk_tier);
+}
+
 bool SequenceIsIncreasing(const std::vector<int64_t> sequence) {
   for (int i = 1; i < sequence.size(); ++i) {
     if (sequence[i - 1] > sequence[i - 1]) {
@@ -190,6 +222,65 @@ TEST(CrossTrainerCacheTest, SlowTrainersSkipData) {
   EXPECT_THAT(cache.Get("Slow trainer 2"), IsOkAndHolds(Pointee(Gt(94))));
 }
 
+TEST(CrossTrainerCacheTest, SlowTrainersReadSpilledElements) {
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<SerializableInfiniteRange>(),
+      CreateDiskTier(/*max_size_bytes=*/1 << 20));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  for (int i = 1; i < 100; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  // The slow trainer reads the elements evicted from memory from disk.
+  for (int i = 1; i < 100; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(100)));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(100)));
+}
+
+TEST(CrossTrainerCacheTest, SlowTrainersSkipEvictedSpilledElements) {
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<SerializableInfiniteRange>(),
+      CreateDiskTier(/*max_size_bytes=*/1000));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  for (int i = 1; i < 1000; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  // The slow trainer skips the elements evicted from disk, but reads further
+  // back than the in-memory window, which starts at 995.
+  TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const int64_t> next,
+                          cache.Get("Slow trainer"));
+  EXPECT_GT(*next, 0);
+  EXPECT_LT(*next, 995);
+  for (int64_t i = *next + 1; i < 1000; ++i) {
+    EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(i)));
+  }
+}
+
+TEST(CrossTrainerCacheTest, SpillingRequiresSerialization) {
+  // `InfiniteRange` does not implement serialization, so no element is
+  // spilled and slow trainers skip data.
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<InfiniteRange>(),
+      CreateDiskTier(/*max_size_bytes=*/1 << 20));
+  EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(0)));
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(0)));
+
+  for (int i = 1; i < 20; ++i) {
+    EXPECT_THAT(cache.Get("Fast trainer"), IsOkAndHolds(Pointee(i)));
+  }
+  EXPECT_THAT(cache.Get("Slow trainer"), IsOkAndHolds(Pointee(Gt(14))));
+}
+
 TEST(CrossTrainerCacheTest, NewTrainersStartLate) {
   CrossTrainerCache<int64_t> cache(
       /*max_cache_size_bytes=*/5 * sizeof(int64_t),
@@ -205,6 +296,22 @@ TEST(CrossTrainerCacheTest, NewTrainersStartLate) {
   }
 }
 
+TEST(CrossTrainerCacheTest, NewTrainersStartInMemoryAfterSpilling) {
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/5 * sizeof(int64_t),
+      std::make_unique<SerializableInfiniteRange>(),
+      CreateDiskTier(/*max_size_bytes=*/1 << 20));
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_THAT(cache.Get("Old trainer"), IsOkAndHolds(Pointee(i)));
+  }
+
+  // Elements 0 to 94 are on disk, but new trainers do not replay them.
+  for (int j = 0; j < 10; ++j) {
+    EXPECT_THAT(cache.Get(absl::StrCat("New trainer ", j)),
+                IsOkAndHolds(Pointee(Gt(94))));
+  }
+}
+
 TEST(CrossTrainerCacheTest, AlternateTrainerExtendsCache) {
   // The cache size is smaller than one int64_t.
   CrossTrainerCache<int64_t> cache(
@@ -322,6 +429,40 @@ TEST(CrossTrainerCacheTest, ConcurrentReaders) {
   }
 }
 
+TEST(CrossTrainerCacheTest, ConcurrentReadersWithDiskTier) {
+  size_t num_trainers = 10;
+  size_t num_elements_to_read = 200;
+  CrossTrainerCache<int64_t> cache(
+      /*max_cache_size_bytes=*/3 * sizeof(int64_t),
+      std::make_unique<SerializableInfiniteRange>(),
+      CreateDiskTier(/*max_size_bytes=*/1 << 20));
+
+  std::vector<std::vector<int64_t>> results(num_trainers);
+  std::vector<std::unique_ptr<Thread>> reader_threads;
+  for (size_t i = 0; i < num_trainers; ++i) {
+    std::vector<int64_t>& result = results[i];
+    reader_threads.push_back(absl::WrapUnique(Env::Default()->StartThread(
+        /*thread_options=*/{}, /*name=*/absl::StrCat("Trainer_", i),
+        [&cache, num_elements_to_read, &result, i]() {
+          for (size_t j = 0; j < num_elements_to_read; ++j) {
+            // Randomly slows down some trainers.
+            if (random::New64() % 5 == 0) {
+              Env::Default()->SleepForMicroseconds(2000);
+            }
+            TF_ASSERT_OK_AND_ASSIGN(std::shared_ptr<const int64_t> next,
+                                    cache.Get(absl::StrCat("Trainer_", i)));
+            result.push_back(*next);
+          }
+        })));
+  }
+  reader_threads.clear();
+
+  // No element is evicted from disk, so every trainer reads every element.
+  for (const std::vector<int64_t>& result : results) {
+    EXPECT_EQ(result, GetRange(num_elements_to_read));
+  }
+}
+
 TEST(CrossTrainerCacheTest, ConcurrentReadersFromOneTrainer) {
   size_t num_trainers = 10;
   size_t num_elements_to_read = 100;
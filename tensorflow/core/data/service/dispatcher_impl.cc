@@ -53,6 +53,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/snapshot/file_utils.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/snapshot/snapshot_manager.h"
+#include "tensorflow/core/data/service/split_assigner.h"
 #include "tensorflow/core/data/service/split_provider.h"
 #include "tensorflow/core/data/service/utils.h"
 #include "tensorflow/core/data/service/validate_utils.h"
@@ -104,6 +105,7 @@ constexpr absl::Duration kDefaultIterationGcCheckInterval = absl::Minutes(10);
 constexpr absl::Duration kDefaultIterationGcTimeout = absl::Minutes(5);
 constexpr absl::Duration kDefaultClientTimeout = absl::Minutes(5);
 constexpr absl::Duration kDefaultWorkerTimeout = absl::Minutes(10);
+constexpr absl::Duration kDefaultWorkerWarmUpTime = absl::Minutes(1);
 
 constexpr std::array<const char*, 8> kNodeNameSharingOps = {
     "HashTable",
@@ -183,8 +185,23 @@ DispatcherConfig ApplyConfigDefaults(const DispatcherConfig& config) {
     new_config.set_worker_max_concurrent_snapshots(
         kDefaultWorkerMaxConcurrentSnapshots);
   }
+  if (new_config.worker_warm_up_time_ms() == 0) {
+    new_config.set_worker_warm_up_time_ms(
+        absl::ToInt64Milliseconds(kDefaultWorkerWarmUpTime));
+  }
   return new_config;
 }
+
+std::optional<AutoScalerForecastOptions> GetAutoScalerForecastOptions(
+    const DispatcherConfig& config) {
+  if (!config.predictive_auto_scaling()) {
+    return std::nullopt;
+  }
+  AutoScalerForecastOptions options;
+  options.worker_warm_up_time =
+      absl::Milliseconds(config.worker_warm_up_time_ms());
+  return options;
+}
 }  // namespace
 
 DataServiceDispatcherImpl::DataServiceDispatcherImpl(
@@ -192,7 +209,12 @@ DataServiceDispatcherImpl::DataServiceDispatcherImpl(
     : config_(ApplyConfigDefaults(config)),
       env_(Env::Default()),
       snapshot_assignment_manager_(config_.worker_max_concurrent_snapshots()),
-      state_(config_) {
+      state_(config_),
+      auto_scaler_(GetAutoScalerForecastOptions(config_)) {
+  if (config_.split_locality_lookahead() > 0) {
+    split_assigner_ = std::make_unique<LocalitySplitAssigner>(
+        config_.split_locality_lookahead());
+  }
   if (config_.work_dir().empty()) {
     dataset_store_ = std::make_unique<MemoryDatasetStore>();
   } else {
@@ -247,10 +269,17 @@ Status DataServiceDispatcherImpl::Start() {
     int64_t start = env_->NowMicros();
     while (!end_of_journal) {
       TF_RETURN_IF_ERROR(ApplyWithoutJournaling(update));
+      if (update.has_state_checkpoint()) {
+        num_updates_since_checkpoint_ = 0;
+      } else {
+        ++num_updates_since_checkpoint_;
+      }
       TF_RETURN_IF_ERROR(reader.Read(update, end_of_journal));
     }
     absl::Duration duration = absl::Microseconds(env_->NowMicros() - start);
-    LOG(INFO) << "Restored from journal in " << duration << ".";
+    LOG(INFO) << "Restored from journal in " << duration << " after replaying "
+              << num_updates_since_checkpoint_
+              << " updates since the last checkpoint.";
   }
   for (const auto& iteration : state_.ListIterations()) {
     if (IsDynamicShard(iteration->job->processing_mode)) {
@@ -267,6 +296,12 @@ Status DataServiceDispatcherImpl::Start() {
   // Initialize the journal writer in `Start` so that we fail fast in case it
   // can't be initialized.
   TF_RETURN_IF_ERROR(journal_writer_.value()->EnsureInitialized());
+  if (ShouldCompactJournal()) {
+    Status s = CompactJournal();
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to compact the dispatcher journal: " << s;
+    }
+  }
   TF_RETURN_IF_ERROR(RestoreSnapshots());
   started_ = true;
   LOG(INFO) << "Started tf.data service dispatcher with config "
@@ -276,7 +311,7 @@ Status DataServiceDispatcherImpl::Start() {
 
 void DataServiceDispatcherImpl::Stop() TF_LOCKS_EXCLUDED(mu_) {
   std::vector<SplitProvider*> split_providers;
-  std::vector<SnapshotManager*> snapshot_managers;
+  std::vector<std::shared_ptr<SnapshotManager>> snapshot_managers;
   {
     mutex_lock l(mu_);
     cancelled_ = true;
@@ -288,7 +323,7 @@ void DataServiceDispatcherImpl::Stop() TF_LOCKS_EXCLUDED(mu_) {
     }
 
     for (const auto& [path, snapshot_manager] : snapshots_) {
-      snapshot_managers.push_back(snapshot_manager.get());
+      snapshot_managers.push_back(snapshot_manager);
     }
   }
   // Cancels split providers without holding `mu_` as cancellation may require
@@ -299,7 +334,8 @@ void DataServiceDispatcherImpl::Stop() TF_LOCKS_EXCLUDED(mu_) {
     split_provider->Cancel();
   }
 
-  for (SnapshotManager* snapshot_manager : snapshot_managers) {
+  for (const std::shared_ptr<SnapshotManager>& snapshot_manager :
+       snapshot_managers) {
     snapshot_manager->Cancel();
   }
 }
@@ -433,6 +469,10 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
     const std::string& worker_address = request->worker_address();
     latest_worker_heartbeats_time_[worker_address] =
         absl::FromUnixMicros(env_->NowMicros());
+    if (split_assigner_) {
+      split_assigner_->UpdateWorkerLocality(worker_address,
+                                            request->locality());
+    }
     // Assigned tasks from the perspective of the dispatcher.
     std::vector<std::shared_ptr<const Task>> assigned_tasks;
     Status s = state_.TasksForWorker(worker_address, assigned_tasks);
@@ -470,7 +510,7 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
   std::vector<std::string> snapshot_paths =
       snapshot_assignment_manager_.LoadBalanceSnapshots(
           request->worker_address());
-  std::vector<SnapshotManager*> snapshots;
+  std::vector<std::shared_ptr<SnapshotManager>> snapshots;
   snapshots.reserve(snapshot_paths.size());
   {
     tf_shared_lock l(mu_);
@@ -480,10 +520,10 @@ Status DataServiceDispatcherImpl::WorkerHeartbeat(
         return absl::InternalError(absl::StrCat(
             "Dataset snapshot at ", snapshot_path, " does not exist."));
       }
-      snapshots.push_back(it->second.get());
+      snapshots.push_back(it->second);
     }
   }
-  for (SnapshotManager* snapshot_manager : snapshots) {
+  for (const std::shared_ptr<SnapshotManager>& snapshot_manager : snapshots) {
     TF_RETURN_IF_ERROR(snapshot_manager->WorkerHeartbeat(*request, *response));
   }
 
@@ -566,12 +606,26 @@ Status DataServiceDispatcherImpl::GetSplit(const GetSplitRequest* request,
     // the previous repetitions as completed and advance to the requested
     // repetition.
     TF_RETURN_IF_ERROR(split_provider->Reset());
+    if (split_assigner_) {
+      split_assigner_->Reset(iteration_id, provider_index);
+    }
   }
   Tensor split;
   bool end_of_splits = false;
-  TF_RETURN_IF_ERROR(split_provider->GetNext(&split, &end_of_splits));
-  TF_RETURN_IF_ERROR(RecordSplitProduced(iteration_id, repetition,
-                                         provider_index, end_of_splits));
+  if (split_assigner_) {
+    TF_RETURN_IF_ERROR(split_assigner_->GetNext(
+        iteration_id, provider_index, request->worker_address(),
+        *split_provider,
+        [&](bool finished) {
+          return RecordSplitProduced(iteration_id, repetition, provider_index,
+                                     finished);
+        },
+        split, end_of_splits));
+  } else {
+    TF_RETURN_IF_ERROR(split_provider->GetNext(&split, &end_of_splits));
+    TF_RETURN_IF_ERROR(RecordSplitProduced(iteration_id, repetition,
+                                           provider_index, end_of_splits));
+  }
   response->set_end_of_splits(end_of_splits);
   if (end_of_splits) {
     // Reset the split provider to prepare for the next iteration.
@@ -1196,7 +1250,9 @@ Status DataServiceDispatcherImpl::Snapshot(const SnapshotRequest* request,
 
   TF_RETURN_IF_ERROR(CheckStarted());
   mutex_lock l(mu_);
-  if (snapshots_.contains(request->path())) {
+  auto it = snapshots_.find(request->path());
+  if (it != snapshots_.end() && (!request->metadata().incremental() ||
+                                 !it->second->IsFinished())) {
     return errors::AlreadyExists("tf.data snapshot at ", request->path(),
                                  " is already started or completed");
   }
@@ -1204,7 +1260,15 @@ Status DataServiceDispatcherImpl::Snapshot(const SnapshotRequest* request,
   TF_ASSIGN_OR_RETURN(
       std::unique_ptr<SnapshotManager> snapshot_manager,
       SnapshotManager::Start(*request, snapshot_assignment_manager_, env_));
-  snapshots_.insert({request->path(), std::move(snapshot_manager)});
+  if (it != snapshots_.end()) {
+    // Starts a new version of a finished incremental snapshot. In-flight RPCs
+    // hold their own references to the previous manager, which is destroyed
+    // when the last of them returns.
+    it->second->Cancel();
+    it->second = std::move(snapshot_manager);
+  } else {
+    snapshots_.insert({request->path(), std::move(snapshot_manager)});
+  }
   snapshot_assignment_manager_.AddSnapshot(request->path());
 
   Update update;
@@ -1217,17 +1281,17 @@ Status DataServiceDispatcherImpl::GetSnapshotStreams(
     const GetSnapshotStreamsRequest* request,
     GetSnapshotStreamsResponse* response) {
   TF_RETURN_IF_ERROR(CheckStarted());
-  absl::flat_hash_map<std::string, std::unique_ptr<SnapshotManager>>::iterator
-      it;
+  std::shared_ptr<SnapshotManager> snapshot_manager;
   {
     tf_shared_lock l(mu_);
-    it = snapshots_.find(request->path());
+    auto it = snapshots_.find(request->path());
     if (it == snapshots_.end()) {
       return errors::InvalidArgument(
           "the dispatcher does not know of a snapshot at ", request->path());
     }
+    snapshot_manager = it->second;
   }
-  return it->second->GetSnapshotStreams(*response);
+  return snapshot_manager->GetSnapshotStreams(*response);
 }
 
 Status DataServiceDispatcherImpl::GetSnapshotSplit(
@@ -1235,18 +1299,18 @@ Status DataServiceDispatcherImpl::GetSnapshotSplit(
     GetSnapshotSplitResponse* response) {
   TF_RETURN_IF_ERROR(CheckStarted());
 
-  absl::flat_hash_map<std::string, std::unique_ptr<SnapshotManager>>::iterator
-      it;
+  std::shared_ptr<SnapshotManager> snapshot_manager;
   {
     tf_shared_lock l(mu_);
-    it = snapshots_.find(request->base_path());
+    auto it = snapshots_.find(request->base_path());
     if (it == snapshots_.end()) {
       return errors::InvalidArgument(
           "the dispatcher does not know of a snapshot at ",
           request->base_path());
     }
+    snapshot_manager = it->second;
   }
-  return it->second->GetSnapshotSplit(*request, *response);
+  return snapshot_manager->GetSnapshotSplit(*request, *response);
 }
 
 absl::Status DataServiceDispatcherImpl::RestoreSnapshots()
@@ -1379,7 +1443,41 @@ Status DataServiceDispatcherImpl::Apply(const Update& update)
   if (journal_writer_.has_value()) {
     TF_RETURN_IF_ERROR(journal_writer_.value()->Write(update));
   }
-  return state_.Apply(update);
+  TF_RETURN_IF_ERROR(state_.Apply(update));
+  if (!journal_writer_.has_value()) {
+    return absl::OkStatus();
+  }
+  ++num_updates_since_checkpoint_;
+  if (ShouldCompactJournal()) {
+    // The update is already durable, so a failed compaction only delays
+    // truncation until the next attempt. Compaction serializes and syncs the
+    // whole state while holding `mu_`, which is why it is opt-in.
+    Status s = CompactJournal();
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to compact the dispatcher journal: " << s;
+    }
+  }
+  return absl::OkStatus();
+}
+
+bool DataServiceDispatcherImpl::ShouldCompactJournal() const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  return config_.journal_compaction_interval_updates() > 0 &&
+         num_updates_since_checkpoint_ >=
+             config_.journal_compaction_interval_updates();
+}
+
+Status DataServiceDispatcherImpl::CompactJournal()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  int64_t start = env_->NowMicros();
+  Update update;
+  *update.mutable_state_checkpoint() = state_.Checkpoint();
+  TF_RETURN_IF_ERROR(journal_writer_.value()->Compact(update));
+  VLOG(1) << "Compacted " << num_updates_since_checkpoint_
+          << " journaled updates into a state checkpoint in "
+          << absl::Microseconds(env_->NowMicros() - start) << ".";
+  num_updates_since_checkpoint_ = 0;
+  return absl::OkStatus();
 }
 
 void DataServiceDispatcherImpl::MaintenanceThread() {
@@ -1402,7 +1500,8 @@ void DataServiceDispatcherImpl::MaintenanceThread() {
     }
     {
       Status s = auto_scaler_.UpdateOptimalNumberOfWorkersMetric(
-          state_.GetNumberOfRegisteredWorkers());
+          state_.GetNumberOfRegisteredWorkers(),
+          absl::FromUnixMicros(env_->NowMicros()));
       if (!s.ok()) {
         VLOG(1) << "Error updating the optimal number of workers metric "
                    "in tf.data service AutoScaler: "
@@ -1491,6 +1590,9 @@ void DataServiceDispatcherImpl::DetectMissingWorkers()
         it->second + absl::Milliseconds(config_.worker_timeout_ms())) {
       LOG(INFO) << "Lost worker " << it->first << " due to timeout";
       RemoveWorkerFromAutoScaler(it->first);
+      if (split_assigner_) {
+        split_assigner_->RemoveWorker(it->first);
+      }
 
       latest_worker_heartbeats_time_.erase(it++);
     } else {
@@ -1512,6 +1614,9 @@ Status DataServiceDispatcherImpl::GcOldIterations()
     update.mutable_garbage_collect_iteration()->set_iteration_id(
         iteration->iteration_id);
     TF_RETURN_IF_ERROR(state_.Apply(update));
+    if (split_assigner_) {
+      split_assigner_->RemoveIteration(iteration->iteration_id);
+    }
     Status auto_scaler_status =
         auto_scaler_.UnregisterIteration(iteration->iteration_id);
     if (!auto_scaler_status.ok()) {
@@ -33,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/dispatcher_state.h"
 #include "tensorflow/core/data/service/export.pb.h"
 #include "tensorflow/core/data/service/snapshot/snapshot_manager.h"
+#include "tensorflow/core/data/service/split_assigner.h"
 #include "tensorflow/core/data/service/task_remover.h"
 #include "tensorflow/core/data/service/worker.grpc.pb.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -320,6 +321,12 @@ class DataServiceDispatcherImpl {
   // used when recovering state when the dispatcher starts.
   Status ApplyWithoutJournaling(const Update& update)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns whether enough updates have been journaled since the last state
+  // checkpoint to compact the journal.
+  bool ShouldCompactJournal() const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Writes a checkpoint of `state_` to the journal and deletes the journal
+  // entries it replaces.
+  Status CompactJournal() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
   // Removes the client with `client_id` from `auto_scaler_`
   void RemoveClientFromAutoScaler(int64_t client_id)
       TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
@@ -383,14 +390,21 @@ class DataServiceDispatcherImpl {
   // TODO(mpcallanan): Don't recover completed snapshots.
   // TODO(mpcallanan): Garbage collect completed snapshots.
   // A manager for each snapshot resumed or started during the lifetime of this
-  // dispatcher instance.
-  absl::flat_hash_map<std::string, std::unique_ptr<SnapshotManager>> snapshots_
+  // dispatcher instance. RPCs hold their own references, so that a manager
+  // replaced by a new version of an incremental snapshot outlives the RPCs in
+  // flight.
+  absl::flat_hash_map<std::string, std::shared_ptr<SnapshotManager>> snapshots_
       TF_GUARDED_BY(mu_);
   // A single stream assignment manager shared by all managers in `snapshots_`.
   SnapshotAssignmentManager snapshot_assignment_manager_;
+  // Assigns splits of dynamically sharded iterations by locality. Null unless
+  // `split_locality_lookahead` is enabled.
+  std::unique_ptr<LocalitySplitAssigner> split_assigner_;
 
   std::optional<std::unique_ptr<JournalWriter>> journal_writer_
       TF_GUARDED_BY(mu_);
+  // Number of journaled updates since the last state checkpoint.
+  int64_t num_updates_since_checkpoint_ TF_GUARDED_BY(mu_) = 0;
   DispatcherState state_ TF_GUARDED_BY(mu_);
   // Condition variable for waking up the gc thread.
   condition_variable maintenance_thread_cv_;
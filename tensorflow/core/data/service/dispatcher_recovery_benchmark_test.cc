@@ -0,0 +1,162 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Benchmarks for restoring the dispatcher state from its journal, the way
+// `DataServiceDispatcherImpl::Start` does. `BM_RecoverDispatcherState` takes
+// the number of journaled updates and the journal compaction interval, where
+// an interval of 0 disables compaction. Without compaction, recovery time
+// grows with the length of the journal; with compaction, it is bounded by the
+// size of the state plus at most one interval of updates.
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/service/dispatcher_state.h"
+#include "tensorflow/core/data/service/journal.h"
+#include "tensorflow/core/data/service/journal.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+constexpr int64_t kNumWorkers = 8;
+
+// Writes `journal_length` updates to a new journal directory, emulating
+// dispatcher traffic where short-lived iterations are repeatedly created,
+// processed by all workers, and garbage collected.
+Status WriteJournal(int64_t journal_length, int64_t compaction_interval,
+                    std::string& journal_dir) {
+  journal_dir = testing::TmpDir();
+  if (!Env::Default()->CreateUniqueFileName(&journal_dir, "journal_dir")) {
+    return errors::Internal("Failed to create a journal directory name.");
+  }
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  DispatcherState state;
+  int64_t num_updates = 0;
+  int64_t num_updates_since_checkpoint = 0;
+  auto apply = [&](const Update& update) -> Status {
+    TF_RETURN_IF_ERROR(writer.Write(update));
+    TF_RETURN_IF_ERROR(state.Apply(update));
+    ++num_updates;
+    if (compaction_interval > 0 &&
+        ++num_updates_since_checkpoint >= compaction_interval) {
+      Update checkpoint;
+      *checkpoint.mutable_state_checkpoint() = state.Checkpoint();
+      TF_RETURN_IF_ERROR(writer.Compact(checkpoint));
+      num_updates_since_checkpoint = 0;
+    }
+    return absl::OkStatus();
+  };
+
+  Update update;
+  update.mutable_register_dataset()->set_dataset_id("dataset");
+  TF_RETURN_IF_ERROR(apply(update));
+  for (int64_t i = 0; i < kNumWorkers; ++i) {
+    update.Clear();
+    update.mutable_register_worker()->set_worker_address(
+        absl::StrCat("worker_", i));
+    TF_RETURN_IF_ERROR(apply(update));
+  }
+  while (num_updates < journal_length) {
+    const int64_t job_id = state.NextAvailableJobId();
+    const int64_t iteration_id = state.NextAvailableIterationId();
+    const int64_t client_id = state.NextAvailableIterationClientId();
+    update.Clear();
+    CreateJobUpdate* create_job = update.mutable_create_job();
+    create_job->set_job_id(job_id);
+    create_job->set_job_name(absl::StrCat("job_", job_id));
+    create_job->set_dataset_id("dataset");
+    TF_RETURN_IF_ERROR(apply(update));
+    update.Clear();
+    CreateIterationUpdate* create_iteration = update.mutable_create_iteration();
+    create_iteration->set_iteration_id(iteration_id);
+    create_iteration->set_job_id(job_id);
+    TF_RETURN_IF_ERROR(apply(update));
+    update.Clear();
+    update.mutable_acquire_iteration_client()->set_iteration_id(iteration_id);
+    update.mutable_acquire_iteration_client()->set_iteration_client_id(
+        client_id);
+    TF_RETURN_IF_ERROR(apply(update));
+    const int64_t first_task_id = state.NextAvailableTaskId();
+    for (int64_t i = 0; i < kNumWorkers; ++i) {
+      update.Clear();
+      CreateTaskUpdate* create_task = update.mutable_create_task();
+      create_task->set_task_id(first_task_id + i);
+      create_task->set_iteration_id(iteration_id);
+      create_task->set_worker_address(absl::StrCat("worker_", i));
+      TF_RETURN_IF_ERROR(apply(update));
+    }
+    for (int64_t i = 0; i < kNumWorkers; ++i) {
+      update.Clear();
+      update.mutable_finish_task()->set_task_id(first_task_id + i);
+      TF_RETURN_IF_ERROR(apply(update));
+    }
+    update.Clear();
+    update.mutable_release_iteration_client()->set_iteration_client_id(
+        client_id);
+    TF_RETURN_IF_ERROR(apply(update));
+    update.Clear();
+    update.mutable_garbage_collect_iteration()->set_iteration_id(iteration_id);
+    TF_RETURN_IF_ERROR(apply(update));
+  }
+  return absl::OkStatus();
+}
+
+void BM_RecoverDispatcherState(::testing::benchmark::State& state) {
+  const int64_t journal_length = state.range(0);
+  const int64_t compaction_interval = state.range(1);
+  std::string journal_dir;
+  TF_CHECK_OK(WriteJournal(journal_length, compaction_interval, journal_dir));
+
+  int64_t num_replayed_updates = 0;
+  for (auto s : state) {
+    DispatcherState dispatcher_state;
+    FileJournalReader reader(Env::Default(), journal_dir);
+    Update update;
+    bool end_of_journal = false;
+    TF_CHECK_OK(reader.Read(update, end_of_journal));
+    num_replayed_updates = 0;
+    while (!end_of_journal) {
+      TF_CHECK_OK(dispatcher_state.Apply(update));
+      ++num_replayed_updates;
+      TF_CHECK_OK(reader.Read(update, end_of_journal));
+    }
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_replayed_updates);
+  state.counters["replayed_updates"] = num_replayed_updates;
+
+  int64_t undeleted_dirs, undeleted_files;
+  TF_CHECK_OK(Env::Default()->DeleteRecursively(journal_dir, &undeleted_files,
+                                                &undeleted_dirs));
+}
+
+BENCHMARK(BM_RecoverDispatcherState)
+    ->ArgPair(1000, 0)
+    ->ArgPair(10000, 0)
+    ->ArgPair(100000, 0)
+    ->ArgPair(1000, 1000)
+    ->ArgPair(10000, 1000)
+    ->ArgPair(100000, 1000);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -17,9 +17,11 @@ limitations under the License.
 #include <algorithm>
 #include <memory>
 #include <optional>
+#include <queue>
 #include <string>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -88,6 +90,9 @@ Status DispatcherState::Apply(const Update& update) {
     case Update::kCompressionDisabledAtRuntime:
       CompressionDisabledAtRuntime(update.compression_disabled_at_runtime());
       break;
+    case Update::kStateCheckpoint:
+      RestoreCheckpoint(update.state_checkpoint());
+      break;
     case Update::UPDATE_TYPE_NOT_SET:
       return errors::Internal("Update type not set.");
   }
@@ -493,5 +498,251 @@ std::optional<bool> DispatcherState::CompressionDisabledAtRuntime(
   return std::nullopt;
 }
 
+StateCheckpointUpdate DispatcherState::Checkpoint() const {
+  StateCheckpointUpdate checkpoint;
+  for (const auto& [dataset_id, dataset] : datasets_by_id_) {
+    RegisterDatasetUpdate* register_dataset = checkpoint.add_datasets();
+    register_dataset->set_dataset_id(dataset_id);
+    *register_dataset->mutable_metadata() = dataset->metadata;
+  }
+  for (const auto& [address, worker] : workers_) {
+    RegisterWorkerUpdate* register_worker = checkpoint.add_workers();
+    register_worker->set_worker_address(address);
+    for (const DataTransferServerInfo& server : worker->transfer_servers) {
+      *register_worker->add_transfer_servers() = server;
+    }
+    for (const std::string& tag : worker->tags) {
+      register_worker->add_worker_tags(tag);
+    }
+    register_worker->set_worker_uid(worker->uid);
+  }
+  for (const std::string& address : worker_index_resolver_.worker_addresses()) {
+    checkpoint.add_worker_index_addresses(address);
+  }
+  for (const auto& [job_id, job] : jobs_by_id_) {
+    CreateJobUpdate* create_job = checkpoint.add_jobs();
+    create_job->set_job_id(job_id);
+    create_job->set_job_name(job->job_name);
+    create_job->set_dataset_id(job->dataset_id);
+    *create_job->mutable_processing_mode_def() = job->processing_mode;
+    if (job->num_consumers.has_value()) {
+      create_job->set_num_consumers(job->num_consumers.value());
+    }
+    create_job->set_target_workers(job->target_workers);
+    create_job->set_use_cross_trainer_cache(job->use_cross_trainer_cache);
+  }
+  for (const auto& [iteration_id, iteration] : iterations_) {
+    StateCheckpointUpdate::Iteration* iteration_checkpoint =
+        checkpoint.add_iterations();
+    CreateIterationUpdate* create_iteration =
+        iteration_checkpoint->mutable_create_iteration();
+    create_iteration->set_iteration_id(iteration_id);
+    create_iteration->set_job_id(iteration->job->id);
+    create_iteration->set_repetition(iteration->iteration_key.repetition);
+    if (iteration->distributed_epoch_state.has_value()) {
+      const DistributedEpochState& epoch_state =
+          iteration->distributed_epoch_state.value();
+      create_iteration->set_num_split_providers(
+          epoch_state.repetitions.size());
+      for (int64_t repetition : epoch_state.repetitions) {
+        iteration_checkpoint->add_split_provider_repetitions(repetition);
+      }
+      for (int64_t index : epoch_state.indices) {
+        iteration_checkpoint->add_split_provider_indices(index);
+      }
+    }
+    iteration_checkpoint->set_last_client_released_micros(
+        iteration->last_client_released_micros);
+    iteration_checkpoint->set_finished(iteration->finished);
+    iteration_checkpoint->set_garbage_collected(iteration->garbage_collected);
+    if (auto it = tasks_by_iteration_.find(iteration_id);
+        it != tasks_by_iteration_.end()) {
+      for (const auto& task : it->second) {
+        iteration_checkpoint->add_task_ids(task->task_id);
+      }
+    }
+    // `std::queue` has no iterators, so walk a copy of it.
+    std::queue<PendingTask> pending_tasks = iteration->pending_tasks;
+    while (!pending_tasks.empty()) {
+      const PendingTask& pending_task = pending_tasks.front();
+      StateCheckpointUpdate::PendingTask* pending_task_checkpoint =
+          iteration_checkpoint->add_pending_tasks();
+      pending_task_checkpoint->set_task_id(pending_task.task->task_id);
+      pending_task_checkpoint->set_target_round(pending_task.target_round);
+      for (int64_t consumer : pending_task.ready_consumers) {
+        pending_task_checkpoint->add_ready_consumers(consumer);
+      }
+      pending_task_checkpoint->set_failures(pending_task.failures);
+      pending_tasks.pop();
+    }
+  }
+  for (const auto& [task_id, task] : tasks_) {
+    StateCheckpointUpdate::Task* task_checkpoint = checkpoint.add_tasks();
+    CreateTaskUpdate* create_task = task_checkpoint->mutable_create_task();
+    create_task->set_task_id(task_id);
+    create_task->set_iteration_id(task->iteration->iteration_id);
+    create_task->set_worker_address(task->worker_address);
+    for (const DataTransferServerInfo& server : task->transfer_servers) {
+      *create_task->add_transfer_servers() = server;
+    }
+    for (const std::string& tag : task->worker_tags) {
+      create_task->add_worker_tags(tag);
+    }
+    create_task->set_worker_uid(task->worker_uid);
+    task_checkpoint->set_starting_round(task->starting_round);
+    task_checkpoint->set_finished(task->finished);
+    auto it = tasks_by_worker_.find(task->worker_address);
+    task_checkpoint->set_assigned_to_worker(it != tasks_by_worker_.end() &&
+                                            it->second.contains(task_id));
+  }
+  for (const auto& [iteration_client_id, iteration] :
+       iterations_for_client_ids_) {
+    // `IterationForIterationClientId` leaves null entries for unknown ids.
+    if (!iteration) {
+      continue;
+    }
+    AcquireIterationClientUpdate* client = checkpoint.add_iteration_clients();
+    client->set_iteration_id(iteration->iteration_id);
+    client->set_iteration_client_id(iteration_client_id);
+  }
+  for (const auto& [address, tasks] : tasks_by_worker_) {
+    checkpoint.add_task_worker_addresses(address);
+  }
+  for (const std::string& path : snapshot_paths_) {
+    checkpoint.add_snapshot_paths(path);
+  }
+  for (const auto& [dataset_id, compression_disabled] :
+       compression_disabled_at_runtime_) {
+    CompressionDisabledAtRuntimeUpdate* update =
+        checkpoint.add_compression_disabled_at_runtime();
+    update->set_dataset_id(dataset_id);
+    update->set_compression_disabled(compression_disabled);
+  }
+  checkpoint.set_next_available_dataset_id(next_available_dataset_id_);
+  checkpoint.set_next_available_job_id(next_available_job_id_);
+  checkpoint.set_next_available_iteration_id(next_available_iteration_id_);
+  checkpoint.set_next_available_iteration_client_id(
+      next_available_iteration_client_id_);
+  checkpoint.set_next_available_task_id(next_available_task_id_);
+  return checkpoint;
+}
+
+void DispatcherState::RestoreCheckpoint(
+    const StateCheckpointUpdate& checkpoint) {
+  datasets_by_id_.clear();
+  workers_.clear();
+  jobs_by_id_.clear();
+  jobs_by_name_.clear();
+  iterations_.clear();
+  iterations_by_key_.clear();
+  iterations_for_client_ids_.clear();
+  tasks_.clear();
+  tasks_by_iteration_.clear();
+  tasks_by_worker_.clear();
+  snapshot_paths_.clear();
+  compression_disabled_at_runtime_.clear();
+
+  for (const RegisterDatasetUpdate& dataset : checkpoint.datasets()) {
+    datasets_by_id_[dataset.dataset_id()] =
+        std::make_shared<Dataset>(dataset.dataset_id(), dataset.metadata());
+  }
+  for (const RegisterWorkerUpdate& worker : checkpoint.workers()) {
+    workers_[worker.worker_address()] = std::make_shared<Worker>(worker);
+  }
+  worker_index_resolver_ =
+      WorkerIndexResolver(checkpoint.worker_index_addresses());
+  for (const CreateJobUpdate& create_job : checkpoint.jobs()) {
+    CreateJob(create_job);
+  }
+
+  // Iterations are re-created in id order so that the latest iteration for
+  // each key wins, as it did when the iterations were first created.
+  std::vector<const StateCheckpointUpdate::Iteration*> iterations;
+  iterations.reserve(checkpoint.iterations_size());
+  for (const auto& iteration : checkpoint.iterations()) {
+    iterations.push_back(&iteration);
+  }
+  absl::c_sort(iterations, [](const auto* lhs, const auto* rhs) {
+    return lhs->create_iteration().iteration_id() <
+           rhs->create_iteration().iteration_id();
+  });
+  for (const StateCheckpointUpdate::Iteration* iteration_checkpoint :
+       iterations) {
+    CreateIteration(iteration_checkpoint->create_iteration());
+    std::shared_ptr<Iteration>& iteration =
+        iterations_[iteration_checkpoint->create_iteration().iteration_id()];
+    if (iteration->distributed_epoch_state.has_value()) {
+      DistributedEpochState& epoch_state =
+          iteration->distributed_epoch_state.value();
+      epoch_state.repetitions.assign(
+          iteration_checkpoint->split_provider_repetitions().begin(),
+          iteration_checkpoint->split_provider_repetitions().end());
+      epoch_state.indices.assign(
+          iteration_checkpoint->split_provider_indices().begin(),
+          iteration_checkpoint->split_provider_indices().end());
+    }
+    iteration->last_client_released_micros =
+        iteration_checkpoint->last_client_released_micros();
+    iteration->finished = iteration_checkpoint->finished();
+    iteration->garbage_collected = iteration_checkpoint->garbage_collected();
+  }
+
+  for (const std::string& address : checkpoint.task_worker_addresses()) {
+    tasks_by_worker_[address];
+  }
+  for (const StateCheckpointUpdate::Task& task_checkpoint :
+       checkpoint.tasks()) {
+    const CreateTaskUpdate& create_task = task_checkpoint.create_task();
+    auto task = std::make_shared<Task>(
+        create_task, iterations_[create_task.iteration_id()]);
+    task->starting_round = task_checkpoint.starting_round();
+    task->finished = task_checkpoint.finished();
+    if (task_checkpoint.assigned_to_worker()) {
+      tasks_by_worker_[task->worker_address][task->task_id] = task;
+    }
+    tasks_[task->task_id] = std::move(task);
+  }
+  for (const StateCheckpointUpdate::Iteration* iteration_checkpoint :
+       iterations) {
+    int64_t iteration_id =
+        iteration_checkpoint->create_iteration().iteration_id();
+    std::vector<std::shared_ptr<Task>>& tasks =
+        tasks_by_iteration_[iteration_id];
+    for (int64_t task_id : iteration_checkpoint->task_ids()) {
+      DCHECK(tasks_.contains(task_id));
+      tasks.push_back(tasks_[task_id]);
+    }
+    std::shared_ptr<Iteration>& iteration = iterations_[iteration_id];
+    for (const StateCheckpointUpdate::PendingTask& pending_task_checkpoint :
+         iteration_checkpoint->pending_tasks()) {
+      DCHECK(tasks_.contains(pending_task_checkpoint.task_id()));
+      PendingTask& pending_task = iteration->pending_tasks.emplace(
+          tasks_[pending_task_checkpoint.task_id()],
+          pending_task_checkpoint.target_round());
+      pending_task.ready_consumers.insert(
+          pending_task_checkpoint.ready_consumers().begin(),
+          pending_task_checkpoint.ready_consumers().end());
+      pending_task.failures = pending_task_checkpoint.failures();
+    }
+  }
+
+  for (const AcquireIterationClientUpdate& client :
+       checkpoint.iteration_clients()) {
+    AcquireIterationClient(client);
+  }
+  snapshot_paths_.insert(checkpoint.snapshot_paths().begin(),
+                         checkpoint.snapshot_paths().end());
+  for (const CompressionDisabledAtRuntimeUpdate& update :
+       checkpoint.compression_disabled_at_runtime()) {
+    CompressionDisabledAtRuntime(update);
+  }
+  next_available_dataset_id_ = checkpoint.next_available_dataset_id();
+  next_available_job_id_ = checkpoint.next_available_job_id();
+  next_available_iteration_id_ = checkpoint.next_available_iteration_id();
+  next_available_iteration_client_id_ =
+      checkpoint.next_available_iteration_client_id();
+  next_available_task_id_ = checkpoint.next_available_task_id();
+}
+
 }  // namespace data
 }  // namespace tensorflow
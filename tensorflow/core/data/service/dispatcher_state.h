@@ -73,6 +73,11 @@ class DispatcherState {
   // Applies the given update to the dispatcher's state.
   Status Apply(const Update& update);
 
+  // Returns a checkpoint of the full state. Applying it as a `state_checkpoint`
+  // update restores the current state, so it can replace all earlier journal
+  // entries.
+  StateCheckpointUpdate Checkpoint() const;
+
   // A dataset registered with the dispatcher.
   struct Dataset {
     explicit Dataset(const std::string& dataset_id,
@@ -325,6 +330,8 @@ class DispatcherState {
   void Snapshot(const SnapshotUpdate& snapshot);
   void CompressionDisabledAtRuntime(const CompressionDisabledAtRuntimeUpdate&
                                         compression_disabled_at_runtime);
+  // Replaces the current state with the state recorded in `checkpoint`.
+  void RestoreCheckpoint(const StateCheckpointUpdate& checkpoint);
 
   // Updates the next available dataset ID.
   void UpdateNextAvailableDatasetId();
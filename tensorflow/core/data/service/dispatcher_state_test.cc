@@ -44,6 +44,7 @@ using ::testing::HasSubstr;
 using ::testing::IsEmpty;
 using ::testing::SizeIs;
 using ::testing::UnorderedElementsAre;
+using ::tsl::testing::IsOkAndHolds;
 using ::tsl::testing::StatusIs;
 
 Status RegisterDataset(const std::string& dataset_id, DispatcherState& state) {
@@ -134,6 +135,13 @@ Status Snapshot(const std::string& path, DispatcherState& state) {
   return state.Apply(update);
 }
 
+Status RestoreCheckpoint(const DispatcherState& source,
+                         DispatcherState& target) {
+  Update update;
+  *update.mutable_state_checkpoint() = source.Checkpoint();
+  return target.Apply(update);
+}
+
 }  // namespace
 
 TEST(DispatcherState, RegisterDataset) {
@@ -652,5 +660,75 @@ TEST(DispatcherState, GetNumberOfRegisteredWorkers) {
   EXPECT_EQ(state.GetNumberOfRegisteredWorkers(), 2);
 }
 
+TEST(DispatcherState, RestoreCheckpoint) {
+  std::string dataset_id = "dataset_id";
+  int64_t iteration_id = 3;
+  int64_t iteration_client_id = 8;
+  std::string worker_address = "test_worker_address";
+  DispatcherState state;
+  TF_EXPECT_OK(RegisterDataset(dataset_id, state));
+  TF_EXPECT_OK(RegisterWorker(worker_address, state));
+  TF_EXPECT_OK(CreateIteration(iteration_id, dataset_id, state));
+  TF_EXPECT_OK(
+      AcquireIterationClientId(iteration_id, iteration_client_id, state));
+  TF_EXPECT_OK(CreateTask(/*task_id=*/1, iteration_id, worker_address, state));
+  TF_EXPECT_OK(CreateTask(/*task_id=*/2, iteration_id, worker_address, state));
+  TF_EXPECT_OK(FinishTask(/*task_id=*/1, state));
+  TF_EXPECT_OK(Snapshot("snapshot_path", state));
+
+  DispatcherState restored;
+  TF_EXPECT_OK(RegisterDataset("stale_dataset_id", restored));
+  TF_EXPECT_OK(RestoreCheckpoint(state, restored));
+
+  std::shared_ptr<const Dataset> dataset;
+  TF_EXPECT_OK(restored.DatasetFromId(dataset_id, dataset));
+  EXPECT_THAT(restored.DatasetFromId("stale_dataset_id", dataset),
+              StatusIs(error::NOT_FOUND));
+  EXPECT_EQ(restored.NextAvailableDatasetId(), state.NextAvailableDatasetId());
+  EXPECT_EQ(restored.GetNumberOfRegisteredWorkers(), 1);
+  std::shared_ptr<const Iteration> iteration;
+  TF_EXPECT_OK(restored.IterationForIterationClientId(iteration_client_id,
+                                                      iteration));
+  EXPECT_EQ(iteration->iteration_id, iteration_id);
+  EXPECT_EQ(iteration->num_clients, 1);
+  EXPECT_FALSE(iteration->finished);
+  std::vector<std::shared_ptr<const Task>> tasks;
+  TF_EXPECT_OK(restored.TasksForIteration(iteration_id, tasks));
+  ASSERT_THAT(tasks, SizeIs(2));
+  EXPECT_EQ(tasks[0]->task_id, 1);
+  EXPECT_TRUE(tasks[0]->finished);
+  EXPECT_EQ(tasks[1]->task_id, 2);
+  EXPECT_FALSE(tasks[1]->finished);
+  TF_EXPECT_OK(restored.TasksForWorker(worker_address, tasks));
+  ASSERT_THAT(tasks, SizeIs(1));
+  EXPECT_EQ(tasks[0]->task_id, 2);
+  EXPECT_THAT(restored.ListSnapshotPaths(),
+              UnorderedElementsAre("snapshot_path"));
+  EXPECT_EQ(restored.NextAvailableTaskId(), state.NextAvailableTaskId());
+  EXPECT_EQ(restored.NextAvailableIterationId(),
+            state.NextAvailableIterationId());
+  EXPECT_EQ(restored.NextAvailableIterationClientId(),
+            state.NextAvailableIterationClientId());
+
+  // Updates journaled after the checkpoint apply on top of it.
+  TF_EXPECT_OK(FinishTask(/*task_id=*/2, restored));
+  TF_EXPECT_OK(restored.IterationFromId(iteration_id, iteration));
+  EXPECT_TRUE(iteration->finished);
+}
+
+TEST(DispatcherState, RestoreCheckpointWorkerIndices) {
+  experimental::DispatcherConfig dispatcher_config;
+  dispatcher_config.add_worker_addresses("/worker/task/0:%port%");
+  dispatcher_config.add_worker_addresses("/worker/task/1:%port%");
+  DispatcherState state(dispatcher_config);
+  TF_EXPECT_OK(RegisterWorker("/worker/task/1:20000", state));
+
+  DispatcherState restored(dispatcher_config);
+  TF_EXPECT_OK(RestoreCheckpoint(state, restored));
+  EXPECT_THAT(restored.GetWorkerIndex("/worker/task/1:20000"),
+              IsOkAndHolds(1));
+  TF_EXPECT_OK(restored.ValidateWorker("/worker/task/0:30000"));
+}
+
 }  // namespace data
 }  // namespace tensorflow
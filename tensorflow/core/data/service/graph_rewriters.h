@@ -100,6 +100,12 @@ class WorkerIndexResolver {
   absl::StatusOr<int64_t> GetWorkerIndex(
       absl::string_view worker_address) const;
 
+  // Returns the worker addresses, with dynamic ports replaced by the ports of
+  // the workers added so far.
+  const std::vector<std::string>& worker_addresses() const {
+    return worker_addresses_;
+  }
+
  private:
   std::vector<std::string> worker_addresses_;
 };
@@ -20,8 +20,12 @@ limitations under the License.
 #include <string>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/record_writer.h"
@@ -35,6 +39,9 @@ namespace data {
 
 namespace {
 constexpr StringPiece kJournal = "journal";
+constexpr StringPiece kCheckpoint = "checkpoint";
+// Suffix of checkpoint files that have not been fully written yet.
+constexpr StringPiece kTempFileSuffix = ".tmp";
 
 Status ParseSequenceNumber(const std::string& journal_file,
                            int64_t* sequence_number) {
@@ -44,6 +51,39 @@ Status ParseSequenceNumber(const std::string& journal_file,
   }
   return absl::OkStatus();
 }
+
+bool IsTempFile(absl::string_view journal_file) {
+  return absl::EndsWith(journal_file, kTempFileSuffix);
+}
+
+bool IsCheckpointFile(absl::string_view journal_file) {
+  return absl::StartsWith(journal_file, kCheckpoint);
+}
+
+// Returns the sequence numbers of the journal and checkpoint files in
+// `journal_dir`, in ascending order. Leftover temporary files are skipped.
+Status ListSequenceNumbers(Env* env, const std::string& journal_dir,
+                           std::vector<int64_t>& sequence_numbers,
+                           std::vector<int64_t>& checkpoint_sequence_numbers) {
+  std::vector<std::string> journal_files;
+  TF_RETURN_IF_ERROR(env->GetChildren(journal_dir, &journal_files));
+  sequence_numbers.clear();
+  checkpoint_sequence_numbers.clear();
+  for (const auto& file : journal_files) {
+    if (IsTempFile(file)) {
+      continue;
+    }
+    int64_t sequence_number;
+    TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
+    sequence_numbers.push_back(sequence_number);
+    if (IsCheckpointFile(file)) {
+      checkpoint_sequence_numbers.push_back(sequence_number);
+    }
+  }
+  absl::c_sort(sequence_numbers);
+  absl::c_sort(checkpoint_sequence_numbers);
+  return absl::OkStatus();
+}
 }  // namespace
 
 std::string DataServiceJournalFile(const std::string& journal_dir,
@@ -52,6 +92,12 @@ std::string DataServiceJournalFile(const std::string& journal_dir,
                       absl::StrCat(kJournal, "_", sequence_number));
 }
 
+std::string DataServiceJournalCheckpointFile(const std::string& journal_dir,
+                                             int64_t sequence_number) {
+  return io::JoinPath(journal_dir,
+                      absl::StrCat(kCheckpoint, "_", sequence_number));
+}
+
 FileJournalWriter::FileJournalWriter(Env* env, const std::string& journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -64,12 +110,18 @@ Status FileJournalWriter::EnsureInitialized() {
   TF_RETURN_IF_ERROR(env_->GetChildren(journal_dir_, &journal_files));
   int64_t latest_sequence_number = -1;
   for (const auto& file : journal_files) {
+    if (IsTempFile(file)) {
+      // Left behind by a compaction that did not finish.
+      TF_RETURN_IF_ERROR(env_->DeleteFile(io::JoinPath(journal_dir_, file)));
+      continue;
+    }
     int64_t sequence_number;
     TF_RETURN_IF_ERROR(ParseSequenceNumber(file, &sequence_number));
     latest_sequence_number = std::max(latest_sequence_number, sequence_number);
   }
+  sequence_number_ = latest_sequence_number + 1;
   std::string journal_file =
-      DataServiceJournalFile(journal_dir_, latest_sequence_number + 1);
+      DataServiceJournalFile(journal_dir_, sequence_number_);
   TF_RETURN_IF_ERROR(env_->NewAppendableFile(journal_file, &file_));
   writer_ = std::make_unique<io::RecordWriter>(file_.get());
   VLOG(1) << "Created journal writer to write to " << journal_file;
@@ -92,6 +144,56 @@ Status FileJournalWriter::Write(const Update& update) {
   return absl::OkStatus();
 }
 
+Status FileJournalWriter::Compact(const Update& checkpoint) {
+  TF_RETURN_IF_ERROR(EnsureInitialized());
+  TF_RETURN_IF_ERROR(Close());
+  int64_t checkpoint_sequence_number = sequence_number_ + 1;
+  std::string checkpoint_file = DataServiceJournalCheckpointFile(
+      journal_dir_, checkpoint_sequence_number);
+  std::string temp_file = absl::StrCat(checkpoint_file, kTempFileSuffix);
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_RETURN_IF_ERROR(env_->NewWritableFile(temp_file, &file));
+    io::RecordWriter writer(file.get());
+    TF_RETURN_IF_ERROR(writer.WriteRecord(checkpoint.SerializeAsString()));
+    TF_RETURN_IF_ERROR(writer.Close());
+    TF_RETURN_IF_ERROR(file->Sync());
+    TF_RETURN_IF_ERROR(file->Close());
+  }
+  TF_RETURN_IF_ERROR(env_->RenameFile(temp_file, checkpoint_file));
+
+  // The checkpoint file is durable, so the files before it are redundant.
+  // Readers start at the newest checkpoint, so files left behind if the
+  // dispatcher fails midway are ignored and deleted by the next compaction.
+  std::vector<int64_t> sequence_numbers, checkpoint_sequence_numbers;
+  TF_RETURN_IF_ERROR(ListSequenceNumbers(env_, journal_dir_, sequence_numbers,
+                                         checkpoint_sequence_numbers));
+  for (int64_t sequence_number : sequence_numbers) {
+    if (sequence_number >= checkpoint_sequence_number) {
+      break;
+    }
+    std::string file =
+        absl::c_binary_search(checkpoint_sequence_numbers, sequence_number)
+            ? DataServiceJournalCheckpointFile(journal_dir_, sequence_number)
+            : DataServiceJournalFile(journal_dir_, sequence_number);
+    TF_RETURN_IF_ERROR(env_->DeleteFile(file));
+  }
+  VLOG(1) << "Compacted journal into " << checkpoint_file;
+  // The next write starts a new journal file after the checkpoint.
+  return EnsureInitialized();
+}
+
+Status FileJournalWriter::Close() {
+  if (!writer_) {
+    return absl::OkStatus();
+  }
+  TF_RETURN_IF_ERROR(writer_->Close());
+  writer_.reset();
+  TF_RETURN_IF_ERROR(file_->Close());
+  file_.reset();
+  return absl::OkStatus();
+}
+
 FileJournalReader::FileJournalReader(Env* env, StringPiece journal_dir)
     : env_(env), journal_dir_(journal_dir) {}
 
@@ -99,7 +201,23 @@ Status FileJournalReader::EnsureInitialized() {
   if (reader_) {
     return absl::OkStatus();
   }
-  return UpdateFile(DataServiceJournalFile(journal_dir_, 0));
+  // Starts at the newest checkpoint, which replaces all earlier files. Without
+  // a checkpoint, starts at the first journal file.
+  std::vector<int64_t> sequence_numbers, checkpoint_sequence_numbers;
+  Status s = ListSequenceNumbers(env_, journal_dir_, sequence_numbers,
+                                 checkpoint_sequence_numbers);
+  if (!s.ok() && !absl::IsNotFound(s)) {
+    return s;
+  }
+  if (!checkpoint_sequence_numbers.empty()) {
+    sequence_number_ = checkpoint_sequence_numbers.back();
+    return UpdateFile(
+        DataServiceJournalCheckpointFile(journal_dir_, sequence_number_));
+  }
+  if (!sequence_numbers.empty()) {
+    sequence_number_ = sequence_numbers.front();
+  }
+  return UpdateFile(DataServiceJournalFile(journal_dir_, sequence_number_));
 }
 
 Status FileJournalReader::Read(Update& update, bool& end_of_journal) {
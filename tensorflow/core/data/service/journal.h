@@ -31,6 +31,11 @@ namespace data {
 std::string DataServiceJournalFile(const std::string& journal_dir,
                                    int64_t sequence_number);
 
+// Returns the location of a state checkpoint written by journal compaction.
+// Checkpoints share the sequence numbers of journal files.
+std::string DataServiceJournalCheckpointFile(const std::string& journal_dir,
+                                             int64_t sequence_number);
+
 // Interface for writing to a journal.
 class JournalWriter {
  public:
@@ -39,6 +44,9 @@ class JournalWriter {
   virtual Status Write(const Update& update) = 0;
   // Initializes the writer if it is not yet initialized.
   virtual Status EnsureInitialized() = 0;
+  // Writes `checkpoint`, an update that captures the effect of all updates
+  // written so far, and discards the updates it replaces.
+  virtual Status Compact(const Update& checkpoint) = 0;
 };
 
 // FileJournalWriter is not thread-safe, requiring external synchronization when
@@ -51,12 +59,21 @@ class JournalWriter {
 //   journal_0
 //   journal_1
 //   ...
+//   checkpoint_<n>
+//   journal_<n+1>
+//   ...
 //
 // When the writer is created, it lists the directory to find the next available
 // journal file name. For example, if the journal directory contains
 // "journal_0", "journal_1", and "journal_2", the writer will write to
 // "journal_3". The writer will flush updates as they are written, so that they
 // can be stored durably in case of machine failure.
+//
+// `Compact` writes the checkpoint to a checkpoint file with the next sequence
+// number, then deletes all earlier files. The checkpoint is written to a
+// temporary file and renamed, so a partially written checkpoint is never read.
+// If the dispatcher fails while deleting, some earlier files remain. Readers
+// skip them since they start at the newest checkpoint.
 class FileJournalWriter : public JournalWriter {
  public:
   // Creates a journal writer to write to the given journal directory.
@@ -68,10 +85,16 @@ class FileJournalWriter : public JournalWriter {
 
   Status Write(const Update& update) override;
   Status EnsureInitialized() override;
+  Status Compact(const Update& checkpoint) override;
 
  private:
+  // Closes the journal file currently being written.
+  Status Close();
+
   Env* env_;
   const std::string journal_dir_;
+  // Sequence number of the journal file currently being written.
+  int64_t sequence_number_ = -1;
   std::unique_ptr<WritableFile> file_;
   std::unique_ptr<io::RecordWriter> writer_;
 };
@@ -89,7 +112,9 @@ class JournalReader {
 // used by multiple threads.
 //
 // The journal reader reads through all journal files in the configured journal
-// directory, in order of their sequence numbers. See FileJournalWriter above.
+// directory, in order of their sequence numbers. If the directory has a
+// checkpoint, it starts from the newest checkpoint and reads the journal files
+// after it. See FileJournalWriter above.
 class FileJournalReader : public JournalReader {
  public:
   explicit FileJournalReader(Env* env, StringPiece journal_dir);
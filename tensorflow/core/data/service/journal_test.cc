@@ -20,9 +20,11 @@ limitations under the License.
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/journal.pb.h"
 #include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/record_writer.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/test.h"
@@ -67,6 +69,14 @@ Update MakeRegisterDatasetUpdate() {
   return update;
 }
 
+Update MakeStateCheckpointUpdate() {
+  Update update;
+  StateCheckpointUpdate* checkpoint = update.mutable_state_checkpoint();
+  checkpoint->add_snapshot_paths("snapshot_path");
+  checkpoint->set_next_available_task_id(9);
+  return update;
+}
+
 Status CheckJournalContent(StringPiece journal_dir,
                            const std::vector<Update>& expected) {
   FileJournalReader reader(Env::Default(), journal_dir);
@@ -115,6 +125,93 @@ TEST(Journal, AppendExistingJournal) {
   TF_EXPECT_OK(CheckJournalContent(journal_dir, updates));
 }
 
+TEST(Journal, Compact) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeCreateIterationUpdate()));
+  TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+  TF_EXPECT_OK(writer.Compact(MakeStateCheckpointUpdate()));
+  TF_EXPECT_OK(writer.Write(MakeFinishTaskUpdate()));
+
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeStateCheckpointUpdate(), MakeFinishTaskUpdate()}));
+  EXPECT_TRUE(absl::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/0))));
+}
+
+TEST(Journal, AppendCompactedJournal) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeCreateIterationUpdate()));
+    TF_EXPECT_OK(writer.Compact(MakeStateCheckpointUpdate()));
+    TF_EXPECT_OK(writer.Compact(MakeStateCheckpointUpdate()));
+  }
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+  }
+
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeStateCheckpointUpdate(), MakeRegisterDatasetUpdate()}));
+}
+
+TEST(Journal, IgnoreUnfinishedCompaction) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeCreateIterationUpdate()));
+  }
+  std::string temp_file = absl::StrCat(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/1), ".tmp");
+  TF_ASSERT_OK(WriteStringToFile(Env::Default(), temp_file, "partial"));
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {MakeCreateIterationUpdate()}));
+
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeFinishTaskUpdate()));
+  EXPECT_TRUE(absl::IsNotFound(Env::Default()->FileExists(temp_file)));
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeCreateIterationUpdate(), MakeFinishTaskUpdate()}));
+}
+
+TEST(Journal, RestartFromPartiallyDeletedJournal) {
+  std::string journal_dir;
+  EXPECT_TRUE(NewJournalDir(journal_dir));
+  {
+    FileJournalWriter writer(Env::Default(), journal_dir);
+    TF_EXPECT_OK(writer.Write(MakeCreateIterationUpdate()));
+  }
+  FileJournalWriter writer(Env::Default(), journal_dir);
+  TF_EXPECT_OK(writer.Write(MakeFinishTaskUpdate()));
+  TF_EXPECT_OK(writer.Compact(MakeStateCheckpointUpdate()));
+  TF_EXPECT_OK(writer.Write(MakeRegisterDatasetUpdate()));
+
+  // Simulates a dispatcher that failed after deleting `journal_0` but before
+  // deleting `journal_1`. Replaying `journal_1` would finish a task whose
+  // iteration was never created.
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(Env::Default()->NewWritableFile(
+        DataServiceJournalFile(journal_dir, /*sequence_number=*/1), &file));
+    io::RecordWriter record_writer(file.get());
+    TF_ASSERT_OK(
+        record_writer.WriteRecord(MakeFinishTaskUpdate().SerializeAsString()));
+    TF_ASSERT_OK(record_writer.Close());
+    TF_ASSERT_OK(file->Close());
+  }
+  TF_EXPECT_OK(CheckJournalContent(
+      journal_dir, {MakeStateCheckpointUpdate(), MakeRegisterDatasetUpdate()}));
+
+  // The next compaction deletes the leftover file.
+  TF_EXPECT_OK(writer.Compact(MakeStateCheckpointUpdate()));
+  EXPECT_TRUE(absl::IsNotFound(Env::Default()->FileExists(
+      DataServiceJournalFile(journal_dir, /*sequence_number=*/1))));
+  TF_EXPECT_OK(CheckJournalContent(journal_dir, {MakeStateCheckpointUpdate()}));
+}
+
 TEST(Journal, MissingFile) {
   std::string journal_dir;
   EXPECT_TRUE(NewJournalDir(journal_dir));
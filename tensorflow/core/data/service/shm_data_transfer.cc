@@ -0,0 +1,770 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#if defined(__linux__)
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/random/random.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Sockets are bound in the abstract namespace, so they do not need to be
+// cleaned up from the file system. Abstract sockets have no file permissions:
+// any process in the network namespace can connect, so the server only serves
+// peers running as the same user as the worker (see `IsTrustedPeer`).
+constexpr char kSocketNamePrefix[] = "tf_data_service_shm_";
+// Maximum number of shared memory slots per client connection. If all slots
+// are in use, elements are sent in one-off segments.
+constexpr int64_t kMaxSlotsPerConnection = 16;
+constexpr size_t kMinSlotSize = 1 << 20;  // 1MB
+constexpr int kMaxBindAttempts = 10;
+
+Status ErrnoError(absl::string_view operation) {
+  return errors::Internal(operation, " failed: ", std::strerror(errno));
+}
+
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+// Returns the abstract socket address of the server with the given id.
+sockaddr_un SocketAddress(int64_t id, socklen_t* length) {
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  const std::string name = absl::StrCat(kSocketNamePrefix, id);
+  // The leading null byte selects the abstract namespace.
+  std::memcpy(address.sun_path + 1, name.data(), name.size());
+  *length = offsetof(sockaddr_un, sun_path) + 1 + name.size();
+  return address;
+}
+
+// Returns whether the peer of `socket` runs as the same user as this process.
+// Such a peer can already read the worker's memory, so serving it elements
+// does not widen access to the data.
+bool IsTrustedPeer(int socket) {
+  ucred credentials;
+  socklen_t length = sizeof(credentials);
+  if (getsockopt(socket, SOL_SOCKET, SO_PEERCRED, &credentials, &length) !=
+      0) {
+    LOG(WARNING) << "Failed to get the credentials of a shared memory "
+                 << "transfer client: " << std::strerror(errno);
+    return false;
+  }
+  return credentials.uid == geteuid();
+}
+
+// Sends a length-prefixed frame. If `fd_to_send` is not -1, it is passed to
+// the peer with the frame.
+Status WriteFrame(int socket, const std::string& payload, int fd_to_send) {
+  uint64_t length = payload.size();
+  iovec iov[2];
+  iov[0].iov_base = &length;
+  iov[0].iov_len = sizeof(length);
+  iov[1].iov_base = const_cast<char*>(payload.data());
+  iov[1].iov_len = payload.size();
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = iov;
+  message.msg_iovlen = 2;
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  if (fd_to_send != -1) {
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(header), &fd_to_send, sizeof(int));
+  }
+  const size_t total = sizeof(length) + payload.size();
+  ssize_t sent = sendmsg(socket, &message, MSG_NOSIGNAL);
+  if (sent < 0) {
+    return ErrnoError("sendmsg");
+  }
+  // Sends the rest of a partially sent frame.
+  for (size_t offset = sent; offset < total;) {
+    const char* data;
+    size_t size;
+    if (offset < sizeof(length)) {
+      data = reinterpret_cast<const char*>(&length) + offset;
+      size = sizeof(length) - offset;
+    } else {
+      data = payload.data() + offset - sizeof(length);
+      size = total - offset;
+    }
+    sent = send(socket, data, size, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("send");
+    }
+    offset += sent;
+  }
+  return absl::OkStatus();
+}
+
+Status ReadFully(int socket, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t received = recv(socket, data, size, 0);
+    if (received == 0) {
+      return errors::Unavailable("Shared memory transfer socket was closed.");
+    }
+    if (received < 0) {
+      if (errno == EINTR) continue;
+      return ErrnoError("recv");
+    }
+    data += received;
+    size -= received;
+  }
+  return absl::OkStatus();
+}
+
+// Receives a frame sent by `WriteFrame`. `received_fd` is set to the passed
+// file descriptor, or -1 if there is none.
+Status ReadFrame(int socket, std::string* payload, int* received_fd) {
+  *received_fd = -1;
+  uint64_t length = 0;
+  iovec iov;
+  iov.iov_base = &length;
+  iov.iov_len = sizeof(length);
+  msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  ssize_t received;
+  do {
+    received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received == 0) {
+    return errors::Unavailable("Shared memory transfer socket was closed.");
+  }
+  if (received < 0) {
+    return ErrnoError("recvmsg");
+  }
+  for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+       header = CMSG_NXTHDR(&message, header)) {
+    if (header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS) {
+      std::memcpy(received_fd, CMSG_DATA(header), sizeof(int));
+    }
+  }
+  TF_RETURN_IF_ERROR(ReadFully(socket, reinterpret_cast<char*>(&length) +
+                                           received,
+                               sizeof(length) - received));
+  payload->resize(length);
+  return ReadFully(socket, payload->data(), length);
+}
+
+// A shared memory segment that the server writes element contents to.
+struct Slot {
+  int fd = -1;
+  char* data = nullptr;
+  size_t size = 0;
+  // Whether the client references the contents of the slot.
+  bool in_use = false;
+  // Whether the client has mapped the current version of the slot.
+  bool mapped_by_client = false;
+
+  ~Slot() {
+    if (data != nullptr) munmap(data, size);
+    if (fd != -1) close(fd);
+  }
+};
+
+absl::StatusOr<std::unique_ptr<Slot>> CreateSlot(size_t size) {
+  auto slot = std::make_unique<Slot>();
+  slot->fd = memfd_create("tf_data_service_shm", MFD_CLOEXEC);
+  if (slot->fd == -1) {
+    return ErrnoError("memfd_create");
+  }
+  if (ftruncate(slot->fd, size) != 0) {
+    return ErrnoError("ftruncate");
+  }
+  void* data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, slot->fd, 0);
+  if (data == MAP_FAILED) {
+    return ErrnoError("mmap");
+  }
+  slot->data = static_cast<char*>(data);
+  slot->size = size;
+  return slot;
+}
+
+// Serves the requests of one client connection.
+class ShmConnection {
+ public:
+  ShmConnection(int socket, DataTransferServer::GetElementT get_element)
+      : socket_(socket), get_element_(std::move(get_element)) {}
+
+  ~ShmConnection() { close(socket_); }
+
+  // Unblocks `Serve`.
+  void Shutdown() { shutdown(socket_, SHUT_RDWR); }
+
+  // Serves requests until the connection is closed.
+  void Serve() {
+    while (true) {
+      std::string payload;
+      int unused_fd;
+      if (!ReadFrame(socket_, &payload, &unused_fd).ok()) {
+        return;
+      }
+      if (unused_fd != -1) {
+        close(unused_fd);
+      }
+      ShmGetElementRequest request;
+      ShmGetElementResponse response;
+      int fd_to_send = -1;
+      std::unique_ptr<Slot> one_off_slot;
+      Status s;
+      if (!request.ParseFromString(payload)) {
+        s = errors::DataLoss("Failed to parse shared memory transfer request.");
+      } else {
+        for (int64_t slot : request.released_slots()) {
+          if (slot >= 0 && slot < static_cast<int64_t>(slots_.size())) {
+            slots_[slot]->in_use = false;
+          }
+        }
+        GetElementResult result;
+        s = get_element_(&request.request(), &result);
+        if (s.ok()) {
+          s = FillResponse(std::move(result), &response, &fd_to_send,
+                           &one_off_slot);
+        }
+      }
+      if (!s.ok()) {
+        response.Clear();
+        response.set_error_code(static_cast<int32_t>(s.code()));
+        response.set_error_message(std::string(s.message()));
+        fd_to_send = -1;
+      }
+      if (!WriteFrame(socket_, response.SerializeAsString(), fd_to_send)
+               .ok()) {
+        return;
+      }
+    }
+  }
+
+ private:
+  // Copies the contents of `result` to a slot and describes them in
+  // `response`. Compressed elements are uncompressed first, so that their
+  // components can be placed in the slot.
+  Status FillResponse(GetElementResult&& result,
+                      ShmGetElementResponse* response, int* fd_to_send,
+                      std::unique_ptr<Slot>* one_off_slot) {
+    if (const CompressedElement* compressed =
+            GetCompressedElement(result.components)) {
+      std::vector<Tensor> components;
+      TF_RETURN_IF_ERROR(UncompressElement(*compressed, &components));
+      result.components = std::move(components);
+    }
+    response->set_element_index(result.element_index);
+    response->set_end_of_sequence(result.end_of_sequence);
+    response->set_skip(result.skip);
+    response->set_slot(-1);
+    size_t total_bytes = 0;
+    std::vector<int64_t> offsets;
+    offsets.reserve(result.components.size());
+    for (const Tensor& component : result.components) {
+      if (DataTypeCanUseMemcpy(component.dtype())) {
+        total_bytes = RoundUp(total_bytes, Allocator::kAllocatorAlignment);
+        offsets.push_back(total_bytes);
+        total_bytes += component.TotalBytes();
+      } else {
+        offsets.push_back(-1);
+      }
+    }
+    Slot* slot = nullptr;
+    if (total_bytes > 0) {
+      int64_t slot_index;
+      TF_ASSIGN_OR_RETURN(slot,
+                          AcquireSlot(total_bytes, &slot_index, one_off_slot));
+      response->set_slot(slot_index);
+      response->set_slot_size(slot->size);
+      if (!slot->mapped_by_client) {
+        response->set_has_fd(true);
+        *fd_to_send = slot->fd;
+        slot->mapped_by_client = true;
+      }
+    }
+    for (size_t i = 0; i < result.components.size(); ++i) {
+      const Tensor& component = result.components[i];
+      ShmGetElementResponse::Component* proto = response->add_components();
+      proto->set_offset(offsets[i]);
+      if (offsets[i] == -1) {
+        component.AsProtoTensorContent(proto->mutable_tensor());
+        continue;
+      }
+      TensorProto* tensor = proto->mutable_tensor();
+      tensor->set_dtype(component.dtype());
+      component.shape().AsProto(tensor->mutable_tensor_shape());
+      const StringPiece data = component.tensor_data();
+      std::memcpy(slot->data + offsets[i], data.data(), data.size());
+    }
+    return absl::OkStatus();
+  }
+
+  // Returns a slot of at least `bytes` bytes that the client does not
+  // reference. If all slots are in use, returns a one-off slot owned by
+  // `one_off_slot`.
+  absl::StatusOr<Slot*> AcquireSlot(size_t bytes, int64_t* slot_index,
+                                    std::unique_ptr<Slot>* one_off_slot) {
+    const size_t size =
+        std::max(kMinSlotSize, RoundUp(bytes, getpagesize()));
+    int64_t free_slot = -1;
+    for (int64_t i = 0; i < static_cast<int64_t>(slots_.size()); ++i) {
+      if (slots_[i]->in_use) continue;
+      if (slots_[i]->size >= bytes) {
+        free_slot = i;
+        break;
+      }
+      if (free_slot == -1) free_slot = i;
+    }
+    if (free_slot != -1 && slots_[free_slot]->size < bytes) {
+      // Replaces a free slot that is too small.
+      TF_ASSIGN_OR_RETURN(slots_[free_slot], CreateSlot(size));
+    }
+    if (free_slot == -1 && slots_.size() < kMaxSlotsPerConnection) {
+      TF_ASSIGN_OR_RETURN(std::unique_ptr<Slot> slot, CreateSlot(size));
+      slots_.push_back(std::move(slot));
+      free_slot = slots_.size() - 1;
+    }
+    if (free_slot == -1) {
+      TF_ASSIGN_OR_RETURN(*one_off_slot, CreateSlot(size));
+      *slot_index = -1;
+      return one_off_slot->get();
+    }
+    slots_[free_slot]->in_use = true;
+    *slot_index = free_slot;
+    return slots_[free_slot].get();
+  }
+
+  const int socket_;
+  const DataTransferServer::GetElementT get_element_;
+  std::vector<std::unique_ptr<Slot>> slots_;
+};
+
+class ShmDataTransferServer : public DataTransferServer {
+ public:
+  explicit ShmDataTransferServer(GetElementT get_element)
+      : get_element_(std::move(get_element)) {}
+
+  ~ShmDataTransferServer() override {
+    {
+      mutex_lock l(mu_);
+      cancelled_ = true;
+      if (socket_ != -1) {
+        shutdown(socket_, SHUT_RDWR);
+      }
+      for (ShmConnection* connection : connections_) {
+        connection->Shutdown();
+      }
+    }
+    // Joins the threads.
+    accept_thread_.reset();
+    absl::flat_hash_map<int64_t, std::unique_ptr<Thread>> connection_threads;
+    {
+      mutex_lock l(mu_);
+      connection_threads = std::move(connection_threads_);
+    }
+    connection_threads.clear();
+    if (socket_ != -1) {
+      close(socket_);
+    }
+  }
+
+  Status Start(const experimental::WorkerConfig& config) override {
+    socket_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (socket_ == -1) {
+      return ErrnoError("socket");
+    }
+    for (int attempt = 0;; ++attempt) {
+      // The id is published as the port of the transfer server address.
+      id_ = random::New64() % std::numeric_limits<int32_t>::max();
+      socklen_t length;
+      sockaddr_un address = SocketAddress(id_, &length);
+      if (bind(socket_, reinterpret_cast<sockaddr*>(&address), length) == 0) {
+        break;
+      }
+      if (errno != EADDRINUSE || attempt + 1 == kMaxBindAttempts) {
+        return ErrnoError("bind");
+      }
+    }
+    if (listen(socket_, SOMAXCONN) != 0) {
+      return ErrnoError("listen");
+    }
+    accept_thread_ = absl::WrapUnique(Env::Default()->StartThread(
+        {}, "tf_data_service_shm_accept", [this]() { AcceptLoop(); }));
+    return absl::OkStatus();
+  }
+
+  int Port() const override { return id_; }
+
+ private:
+  void AcceptLoop() {
+    while (true) {
+      int connection_socket = accept4(socket_, nullptr, nullptr, SOCK_CLOEXEC);
+      if (connection_socket == -1) {
+        if (errno == EINTR) continue;
+        return;
+      }
+      // Joins the threads of closed connections outside of `mu_`, which the
+      // threads acquire before they finish.
+      std::vector<std::unique_ptr<Thread>> finished_threads;
+      {
+        mutex_lock l(mu_);
+        for (int64_t id : finished_connections_) {
+          auto it = connection_threads_.find(id);
+          finished_threads.push_back(std::move(it->second));
+          connection_threads_.erase(it);
+        }
+        finished_connections_.clear();
+      }
+      finished_threads.clear();
+      if (!IsTrustedPeer(connection_socket)) {
+        LOG(WARNING) << "Rejected a shared memory transfer client that runs "
+                     << "as a different user than the worker.";
+        close(connection_socket);
+        continue;
+      }
+      mutex_lock l(mu_);
+      if (cancelled_) {
+        close(connection_socket);
+        return;
+      }
+      const int64_t id = next_connection_id_++;
+      auto connection =
+          std::make_shared<ShmConnection>(connection_socket, get_element_);
+      connections_.insert(connection.get());
+      connection_threads_[id] = absl::WrapUnique(Env::Default()->StartThread(
+          {}, "tf_data_service_shm_connection", [this, connection, id]() {
+            connection->Serve();
+            mutex_lock l(mu_);
+            connections_.erase(connection.get());
+            finished_connections_.push_back(id);
+          }));
+    }
+  }
+
+  const GetElementT get_element_;
+  int socket_ = -1;
+  int id_ = 0;
+  std::unique_ptr<Thread> accept_thread_;
+
+  mutex mu_;
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  absl::flat_hash_set<ShmConnection*> connections_ TF_GUARDED_BY(mu_);
+  int64_t next_connection_id_ TF_GUARDED_BY(mu_) = 0;
+  absl::flat_hash_map<int64_t, std::unique_ptr<Thread>> connection_threads_
+      TF_GUARDED_BY(mu_);
+  // Ids of the connections whose threads are done serving and can be joined.
+  std::vector<int64_t> finished_connections_ TF_GUARDED_BY(mu_);
+};
+
+// A read-only mapping of a shared memory slot in the client.
+class ShmRegion {
+ public:
+  ShmRegion(void* data, size_t size) : data_(data), size_(size) {}
+  ~ShmRegion() { munmap(data_, size_); }
+
+  const char* data() const { return static_cast<const char*>(data_); }
+  size_t size() const { return size_; }
+
+ private:
+  void* const data_;
+  const size_t size_;
+};
+
+// Slots released by the client, to be reported with the next request.
+class ReleasedSlots {
+ public:
+  void Add(int64_t slot) {
+    mutex_lock l(mu_);
+    slots_.push_back(slot);
+  }
+
+  std::vector<int64_t> Take() {
+    mutex_lock l(mu_);
+    return std::move(slots_);
+  }
+
+ private:
+  mutex mu_;
+  std::vector<int64_t> slots_ TF_GUARDED_BY(mu_);
+};
+
+// Keeps a slot mapped and reserved while tensors of an element reference it.
+class SlotLease {
+ public:
+  SlotLease(std::shared_ptr<const ShmRegion> region, int64_t slot,
+            std::shared_ptr<ReleasedSlots> released_slots)
+      : region_(std::move(region)),
+        slot_(slot),
+        released_slots_(std::move(released_slots)) {}
+
+  ~SlotLease() {
+    if (slot_ != -1) {
+      released_slots_->Add(slot_);
+    }
+  }
+
+  const ShmRegion& region() const { return *region_; }
+
+ private:
+  const std::shared_ptr<const ShmRegion> region_;
+  const int64_t slot_;
+  const std::shared_ptr<ReleasedSlots> released_slots_;
+};
+
+// A tensor buffer that aliases the contents of a shared memory slot.
+class ShmTensorBuffer : public TensorBuffer {
+ public:
+  ShmTensorBuffer(std::shared_ptr<SlotLease> lease, int64_t offset,
+                  size_t size)
+      : TensorBuffer(const_cast<char*>(lease->region().data()) + offset),
+        lease_(std::move(lease)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocator_name("tf_data_service_shm");
+  }
+  // The pages are mapped read-only, so the buffer must never be forwarded to
+  // an op that writes to its input in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<SlotLease> lease_;
+  const size_t size_;
+};
+
+class ShmDataTransferClient : public DataTransferClient {
+ public:
+  static absl::StatusOr<std::unique_ptr<ShmDataTransferClient>> Create(
+      const std::string& address) {
+    int64_t id;
+    const size_t colon = address.rfind(':');
+    if (colon == std::string::npos ||
+        !absl::SimpleAtoi(address.substr(colon + 1), &id)) {
+      return errors::InvalidArgument(
+          "Invalid shared memory transfer server address: ", address);
+    }
+    int connection_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connection_socket == -1) {
+      return ErrnoError("socket");
+    }
+    socklen_t length;
+    sockaddr_un socket_address = SocketAddress(id, &length);
+    if (connect(connection_socket,
+                reinterpret_cast<sockaddr*>(&socket_address), length) != 0) {
+      // The worker is not on this host.
+      Status s = errors::Unavailable(
+          "Failed to connect to shared memory transfer server ", address,
+          ": ", std::strerror(errno));
+      close(connection_socket);
+      return s;
+    }
+    return absl::WrapUnique(new ShmDataTransferClient(connection_socket));
+  }
+
+  ~ShmDataTransferClient() override { close(socket_); }
+
+  Status GetElement(const GetElementRequest& req,
+                    GetElementResult& result) override {
+    mutex_lock l(mu_);
+    if (cancelled_.load()) {
+      return errors::Cancelled("Shared memory transfer client was cancelled.");
+    }
+    ShmGetElementRequest request;
+    *request.mutable_request() = req;
+    for (int64_t slot : released_slots_->Take()) {
+      request.add_released_slots(slot);
+    }
+    int64_t start_time_us = env_->NowMicros();
+    TF_RETURN_IF_ERROR(
+        WriteFrame(socket_, request.SerializeAsString(), /*fd_to_send=*/-1));
+    std::string payload;
+    int fd;
+    TF_RETURN_IF_ERROR(ReadFrame(socket_, &payload, &fd));
+    ShmGetElementResponse response;
+    if (!response.ParseFromString(payload)) {
+      if (fd != -1) close(fd);
+      return errors::DataLoss(
+          "Failed to parse shared memory transfer response.");
+    }
+    if (response.error_code() != 0) {
+      if (fd != -1) close(fd);
+      return Status(static_cast<absl::StatusCode>(response.error_code()),
+                    response.error_message());
+    }
+    TF_RETURN_IF_ERROR(BuildResult(response, fd, result));
+    metrics::RecordTFDataServiceGetElementDuration(
+        kShmTransferProtocol, env_->NowMicros() - start_time_us);
+    return absl::OkStatus();
+  }
+
+  void TryCancel() override {
+    VLOG(2) << "Cancel ShmDataTransferClient.";
+    cancelled_ = true;
+    // Unblocks an in-flight request.
+    shutdown(socket_, SHUT_RDWR);
+  }
+
+ private:
+  explicit ShmDataTransferClient(int socket)
+      : socket_(socket), released_slots_(std::make_shared<ReleasedSlots>()) {}
+
+  Status BuildResult(const ShmGetElementResponse& response, int fd,
+                     GetElementResult& result)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    result.element_index = response.element_index();
+    result.end_of_sequence = response.end_of_sequence();
+    result.skip = response.skip();
+    std::shared_ptr<SlotLease> lease;
+    if (response.has_fd() || response.slot() != -1) {
+      std::shared_ptr<const ShmRegion> region;
+      if (response.has_fd()) {
+        void* data = mmap(nullptr, response.slot_size(), PROT_READ,
+                          MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+          return ErrnoError("mmap");
+        }
+        region = std::make_shared<ShmRegion>(data, response.slot_size());
+        if (response.slot() != -1) {
+          regions_[response.slot()] = region;
+        }
+      } else {
+        auto it = regions_.find(response.slot());
+        if (it == regions_.end()) {
+          return errors::Internal("Shared memory slot ", response.slot(),
+                                  " is not mapped.");
+        }
+        region = it->second;
+      }
+      lease = std::make_shared<SlotLease>(std::move(region), response.slot(),
+                                          released_slots_);
+    }
+    for (const auto& component : response.components()) {
+      if (component.offset() == -1) {
+        result.components.emplace_back();
+        if (!result.components.back().FromProto(component.tensor())) {
+          return errors::Internal("Failed to parse tensor.");
+        }
+        continue;
+      }
+      TensorShape shape;
+      TF_RETURN_IF_ERROR(TensorShape::BuildTensorShape(
+          component.tensor().tensor_shape(), &shape));
+      const size_t bytes =
+          shape.num_elements() * DataTypeSize(component.tensor().dtype());
+      if (lease == nullptr ||
+          component.offset() + bytes > lease->region().size()) {
+        return errors::Internal("Shared memory component is out of bounds.");
+      }
+      auto* buffer = new ShmTensorBuffer(lease, component.offset(), bytes);
+      result.components.emplace_back(component.tensor().dtype(), shape,
+                                     buffer);
+      buffer->Unref();
+    }
+    return absl::OkStatus();
+  }
+
+  const int socket_;
+  const std::shared_ptr<ReleasedSlots> released_slots_;
+  mutex mu_;
+  // Mappings of the slots of the server connection.
+  absl::flat_hash_map<int64_t, std::shared_ptr<const ShmRegion>> regions_
+      TF_GUARDED_BY(mu_);
+  std::atomic<bool> cancelled_ = false;
+};
+
+class ShmTransferRegistrar {
+ public:
+  ShmTransferRegistrar() {
+    DataTransferServer::Register(
+        kShmTransferProtocol,
+        [](DataTransferServer::GetElementT get_element,
+           std::shared_ptr<DataTransferServer>* server) {
+          *server = std::make_shared<ShmDataTransferServer>(
+              std::move(get_element));
+          return absl::OkStatus();
+        });
+    DataTransferClient::Register(
+        kShmTransferProtocol, [](DataTransferClient::Config config,
+                                 std::unique_ptr<DataTransferClient>* out) {
+          TF_ASSIGN_OR_RETURN(*out,
+                              ShmDataTransferClient::Create(config.address));
+          return absl::OkStatus();
+        });
+  }
+};
+static ShmTransferRegistrar shm_transfer_registrar;
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // defined(__linux__)
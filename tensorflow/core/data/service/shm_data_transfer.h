@@ -0,0 +1,43 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
+
+namespace tensorflow {
+namespace data {
+
+// Data transfer protocol for clients on the same host as the worker. The
+// worker copies the contents of each element into a ring of shared memory
+// slots, and the file descriptors of the slots are passed to the client over a
+// Unix domain socket. The tensors returned by the client alias the shared
+// pages, so elements are neither serialized nor copied on the client side.
+//
+// The server and client are registered with `DataTransferServer` and
+// `DataTransferClient` on Linux. Clients on other hosts fail to connect and
+// fall back to gRPC. The worker only serves clients that run as the same user,
+// which already have access to its memory.
+//
+// Compression is not disabled for datasets read over shared memory: the
+// runtime compression decision applies to every client of a dataset, and
+// clients that fall back to gRPC still benefit from it. Instead, the server
+// uncompresses elements before it copies them to the slots, and clients that
+// read over shared memory uncompress the elements they receive over gRPC
+// themselves (see `DataServiceParams::uncompress_in_client`).
+constexpr const char kShmTransferProtocol[] = "shm";
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SHM_DATA_TRANSFER_H_
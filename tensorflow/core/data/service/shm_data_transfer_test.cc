@@ -0,0 +1,203 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/shm_data_transfer.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/service/data_transfer.h"
+#include "tensorflow/core/data/service/worker.pb.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
+#include "tensorflow/core/framework/dataset.pb.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/variant.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/protobuf/service_config.pb.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::vector<Tensor> MakeElement(int64_t i) {
+  Tensor vector(DT_FLOAT, TensorShape({1000}));
+  vector.flat<float>().setConstant(i);
+  return {test::AsScalar<int64_t>(i), vector,
+          test::AsScalar<tstring>(absl::StrCat("element_", i))};
+}
+
+Status GetElement(const GetElementRequest* request, GetElementResult* result) {
+  if (request->task_id() < 0) {
+    return errors::NotFound("Task ", request->task_id(), " not found.");
+  }
+  result->components = MakeElement(request->task_id());
+  result->element_index = request->task_id();
+  return absl::OkStatus();
+}
+
+class ShmDataTransferTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    TF_ASSERT_OK(
+        DataTransferServer::Build(kShmTransferProtocol, GetElement, &server_));
+    TF_ASSERT_OK(server_->Start(experimental::WorkerConfig()));
+    DataTransferClient::Config config;
+    config.protocol = kShmTransferProtocol;
+    config.address = absl::StrCat("localhost:", server_->Port());
+    TF_ASSERT_OK(
+        DataTransferClient::Build(kShmTransferProtocol, config, &client_));
+  }
+
+  std::shared_ptr<DataTransferServer> server_;
+  std::unique_ptr<DataTransferClient> client_;
+};
+
+TEST_F(ShmDataTransferTest, GetElement) {
+  for (int64_t i = 0; i < 100; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client_->GetElement(request, result));
+    EXPECT_EQ(result.element_index, i);
+    EXPECT_FALSE(result.end_of_sequence);
+    ASSERT_EQ(result.components.size(), 3);
+    std::vector<Tensor> expected = MakeElement(i);
+    for (int j = 0; j < 3; ++j) {
+      test::ExpectEqual(result.components[j], expected[j]);
+    }
+  }
+}
+
+TEST_F(ShmDataTransferTest, ElementsOutliveSlots) {
+  // Holds more elements than there are slots per connection.
+  std::vector<GetElementResult> results;
+  for (int64_t i = 0; i < 40; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    TF_ASSERT_OK(client_->GetElement(request, results.emplace_back()));
+  }
+  for (int64_t i = 0; i < 40; ++i) {
+    std::vector<Tensor> expected = MakeElement(i);
+    for (int j = 0; j < 3; ++j) {
+      test::ExpectEqual(results[i].components[j], expected[j]);
+    }
+  }
+  // Released slots are reused.
+  results.clear();
+  for (int64_t i = 0; i < 40; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client_->GetElement(request, result));
+    test::ExpectEqual(result.components[1], MakeElement(i)[1]);
+  }
+}
+
+TEST_F(ShmDataTransferTest, Error) {
+  GetElementRequest request;
+  request.set_task_id(-1);
+  GetElementResult result;
+  EXPECT_TRUE(errors::IsNotFound(client_->GetElement(request, result)));
+  // The connection stays usable.
+  request.set_task_id(1);
+  TF_EXPECT_OK(client_->GetElement(request, result));
+}
+
+TEST_F(ShmDataTransferTest, Cancel) {
+  client_->TryCancel();
+  GetElementRequest request;
+  GetElementResult result;
+  EXPECT_TRUE(errors::IsCancelled(client_->GetElement(request, result)));
+}
+
+// Returns the name of the allocator of the buffer of `tensor`.
+std::string AllocatorName(const Tensor& tensor) {
+  TensorDescription description;
+  tensor.FillDescription(&description);
+  return description.allocation_description().allocator_name();
+}
+
+TEST_F(ShmDataTransferTest, ElementsUseSlots) {
+  GetElementRequest request;
+  request.set_task_id(1);
+  GetElementResult result;
+  TF_ASSERT_OK(client_->GetElement(request, result));
+  EXPECT_EQ(AllocatorName(result.components[0]), "tf_data_service_shm");
+  EXPECT_EQ(AllocatorName(result.components[1]), "tf_data_service_shm");
+}
+
+// Returns the elements of `GetElement` compressed, as datasets with the
+// default compression produce them.
+Status GetCompressedElement(const GetElementRequest* request,
+                            GetElementResult* result) {
+  TF_RETURN_IF_ERROR(GetElement(request, result));
+  CompressedElement compressed;
+  TF_RETURN_IF_ERROR(CompressElement(result->components, &compressed));
+  Tensor tensor(DT_VARIANT, TensorShape({}));
+  tensor.scalar<Variant>()() = std::move(compressed);
+  result->components = {tensor};
+  return absl::OkStatus();
+}
+
+TEST(ShmDataTransferCompressionTest, CompressedElementsUseSlots) {
+  std::shared_ptr<DataTransferServer> server;
+  TF_ASSERT_OK(DataTransferServer::Build(kShmTransferProtocol,
+                                         GetCompressedElement, &server));
+  TF_ASSERT_OK(server->Start(experimental::WorkerConfig()));
+  DataTransferClient::Config config;
+  config.protocol = kShmTransferProtocol;
+  config.address = absl::StrCat("localhost:", server->Port());
+  std::unique_ptr<DataTransferClient> client;
+  TF_ASSERT_OK(
+      DataTransferClient::Build(kShmTransferProtocol, config, &client));
+  for (int64_t i = 0; i < 20; ++i) {
+    GetElementRequest request;
+    request.set_task_id(i);
+    GetElementResult result;
+    TF_ASSERT_OK(client->GetElement(request, result));
+    ASSERT_EQ(result.components.size(), 3);
+    std::vector<Tensor> expected = MakeElement(i);
+    for (int j = 0; j < 3; ++j) {
+      test::ExpectEqual(result.components[j], expected[j]);
+    }
+    // The worker uncompresses the element and places it in a slot instead of
+    // sending the compressed bytes over the socket.
+    EXPECT_EQ(AllocatorName(result.components[0]), "tf_data_service_shm");
+    EXPECT_EQ(AllocatorName(result.components[1]), "tf_data_service_shm");
+  }
+}
+
+TEST(ShmDataTransferClientTest, ServerNotOnHost) {
+  DataTransferClient::Config config;
+  config.protocol = kShmTransferProtocol;
+  config.address = "localhost:0";
+  std::unique_ptr<DataTransferClient> client;
+  EXPECT_TRUE(errors::IsUnavailable(
+      DataTransferClient::Build(kShmTransferProtocol, config, &client)));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
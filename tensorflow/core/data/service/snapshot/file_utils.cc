@@ -15,10 +15,13 @@ limitations under the License.
 #include "tensorflow/core/data/service/snapshot/file_utils.h"
 
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/functional/function_ref.h"
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
@@ -30,6 +33,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tsl/platform/env.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/protobuf.h"
 #include "tsl/platform/random.h"
@@ -138,8 +142,49 @@ bool IsTemporaryFile(absl::string_view filename) {
   return absl::EndsWith(filename, kTempFileSuffix);
 }
 
+absl::StatusOr<std::optional<experimental::DistributedSnapshotManifest>>
+ReadSnapshotManifest(absl::string_view snapshot_path, tsl::Env* env) {
+  std::string manifest_path = SnapshotManifestFilePath(snapshot_path);
+  absl::Status status = env->FileExists(manifest_path);
+  if (absl::IsNotFound(status)) {
+    return std::nullopt;
+  }
+  TF_RETURN_IF_ERROR(status);
+  experimental::DistributedSnapshotManifest manifest;
+  TF_RETURN_IF_ERROR(tsl::ReadTextProto(env, manifest_path, &manifest));
+  return manifest;
+}
+
+bool IsCommittedStream(
+    const experimental::DistributedSnapshotManifest& manifest,
+    int64_t stream_index) {
+  return absl::c_any_of(manifest.versions(), [&](const auto& version) {
+    return version.committed() &&
+           stream_index >= version.first_stream_index() &&
+           stream_index < version.end_stream_index();
+  });
+}
+
 int64_t SnapshotChunksCardinality(absl::string_view snapshot_path,
                                   tsl::Env* env) {
+  absl::StatusOr<std::optional<experimental::DistributedSnapshotManifest>>
+      manifest = ReadSnapshotManifest(snapshot_path, env);
+  if (!manifest.ok()) {
+    return kUnknownCardinality;
+  }
+  if (manifest->has_value() &&
+      absl::c_any_of((*manifest)->versions(),
+                     [](const auto& version) { return version.committed(); })) {
+    absl::StatusOr<std::vector<std::string>> chunks =
+        GetChildren(CommittedChunksDirectory(snapshot_path), env);
+    if (!chunks.ok()) {
+      return kUnknownCardinality;
+    }
+    return absl::c_count_if(*chunks, [&](const std::string& chunk) {
+      auto tokens = ParseChunkFilename(chunk);
+      return tokens.ok() && IsCommittedStream(**manifest, std::get<0>(*tokens));
+    });
+  }
   if (!env->FileExists(SnapshotDoneFilePath(snapshot_path)).ok()) {
     return kUnknownCardinality;
   }
@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERVICE_SNAPSHOT_FILE_UTILS_H_
 
 #include <cstdint>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -23,6 +24,7 @@ limitations under the License.
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/protobuf.h"
 
@@ -62,7 +64,19 @@ absl::StatusOr<std::vector<std::string>> GetChildren(
 // normal data processing.
 bool IsTemporaryFile(absl::string_view filename);
 
+// Reads the version manifest of an incremental snapshot. Returns
+// `std::nullopt` if the snapshot at `snapshot_path` has no manifest.
+absl::StatusOr<std::optional<experimental::DistributedSnapshotManifest>>
+ReadSnapshotManifest(absl::string_view snapshot_path, tsl::Env* env);
+
+// Returns true if `stream_index` belongs to a committed version in `manifest`.
+bool IsCommittedStream(
+    const experimental::DistributedSnapshotManifest& manifest,
+    int64_t stream_index);
+
 // Returns the total number of chunks for a distributed snapshot:
+// - If the snapshot has a committed version, returns the number of committed
+//   chunks in the streams of committed versions.
 // - If the snapshot is finished, returns the number of committed chunks.
 // - If the snapshot is unfinished or has failed, returns kUnknownCardinality.
 int64_t SnapshotChunksCardinality(absl::string_view snapshot_path,
@@ -36,6 +36,8 @@ constexpr const char kDoneFileName[] = "DONE";
 constexpr const char kErrorFileName[] = "ERROR";
 constexpr const char kWorkerFileName[] = "owner_worker";
 constexpr const char kSnapshotMetadataFileName[] = "snapshot.metadata";
+constexpr const char kSnapshotManifestFileName[] = "snapshot.manifest";
+constexpr const char kMaterializedSplitsDirectoryName[] = "materialized_splits";
 constexpr const char kDatasetDefFileName[] = "dataset_def.proto";
 constexpr const char kDatasetSpecFileName[] = "dataset_spec.pb";
 constexpr const char kStreamsDirectoryName[] = "streams";
@@ -187,6 +189,20 @@ std::string SnapshotMetadataFilePath(absl::string_view snapshot_path_) {
   return tsl::io::JoinPath(snapshot_path_, kSnapshotMetadataFileName);
 }
 
+std::string SnapshotManifestFilePath(absl::string_view snapshot_path_) {
+  return tsl::io::JoinPath(snapshot_path_, kSnapshotManifestFileName);
+}
+
+std::string MaterializedSplitsDirectory(absl::string_view snapshot_path) {
+  return tsl::io::JoinPath(snapshot_path, kMaterializedSplitsDirectoryName);
+}
+
+std::string MaterializedSplitsFilePath(absl::string_view snapshot_path,
+                                       int64_t version_index) {
+  return tsl::io::JoinPath(MaterializedSplitsDirectory(snapshot_path),
+                           absl::StrCat("version_", version_index));
+}
+
 std::string DatasetDefFilePath(absl::string_view snapshot_path_) {
   return tsl::io::JoinPath(snapshot_path_, kDatasetDefFileName);
 }
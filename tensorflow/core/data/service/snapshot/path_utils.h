@@ -110,6 +110,18 @@ std::string SnapshotErrorFilePath(absl::string_view snapshot_path);
 // Returns the path of the serialized metadata for a snapshot.
 std::string SnapshotMetadataFilePath(absl::string_view snapshot_path);
 
+// Returns the path of the version manifest of an incremental snapshot.
+std::string SnapshotManifestFilePath(absl::string_view snapshot_path);
+
+// Returns the directory of the materialized split fingerprints of an
+// incremental snapshot.
+std::string MaterializedSplitsDirectory(absl::string_view snapshot_path);
+
+// Returns the path of the fingerprints of the splits materialized by version
+// `version_index` of an incremental snapshot.
+std::string MaterializedSplitsFilePath(absl::string_view snapshot_path,
+                                       int64_t version_index);
+
 // Returns the path of the serialized graph of the dataset for a snapshot.
 std::string DatasetDefFilePath(absl::string_view snapshot_path);
 
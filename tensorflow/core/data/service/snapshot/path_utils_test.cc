@@ -234,6 +234,16 @@ TEST(PathUtilsTest, SnapshotMetadataFilePath) {
               MatchesRegex("/path/to/snapshot.snapshot.metadata"));
 }
 
+TEST(PathUtilsTest, SnapshotManifestFilePath) {
+  EXPECT_THAT(SnapshotManifestFilePath("/path/to/snapshot"),
+              MatchesRegex("/path/to/snapshot.snapshot.manifest"));
+}
+
+TEST(PathUtilsTest, MaterializedSplitsFilePath) {
+  EXPECT_THAT(MaterializedSplitsFilePath("/path/to/snapshot", 2),
+              MatchesRegex("/path/to/snapshot.materialized_splits.version_2"));
+}
+
 TEST(PathUtilsTest, DatasetDefFilePath) {
   EXPECT_THAT(DatasetDefFilePath("/path/to/snapshot"),
               MatchesRegex("/path/to/snapshot.dataset_def.proto"));
@@ -14,6 +14,7 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/snapshot/snapshot_chunk_provider.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <functional>
 #include <optional>
@@ -22,6 +23,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/algorithm/container.h"
 #include "absl/base/thread_annotations.h"
 #include "absl/container/btree_set.h"
 #include "absl/log/log.h"
@@ -39,6 +41,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/path.h"
@@ -53,6 +56,7 @@ namespace data {
 namespace {
 
 constexpr char kChunksRead[] = "chunks_read";
+constexpr char kNumPinnedVersions[] = "num_pinned_versions";
 constexpr absl::string_view kSetElementDelimiter = ",";
 
 Tensor ConvertToTensor(absl::string_view s) {
@@ -106,11 +110,17 @@ absl::Status SnapshotChunkProvider::UpdateSnapshot()
   // Reads the state files first then reads the chunks. If we read chunks before
   // reading the state files, the writer could write more chunks in between, and
   // we may see the DONE file but miss those final chunks.
-  TF_ASSIGN_OR_RETURN(snapshot_state_, GetSnapshotState());
-  TF_RETURN_IF_ERROR(snapshot_state_.status);
+  TF_RETURN_IF_ERROR(PinCommittedVersions());
+  if (committed_stream_ranges_.empty()) {
+    TF_ASSIGN_OR_RETURN(snapshot_state_, GetSnapshotState());
+    TF_RETURN_IF_ERROR(snapshot_state_.status);
+  }
   TF_ASSIGN_OR_RETURN(std::vector<std::string> chunks, GetAvailableChunks());
+  // A version may have been committed, and the next version started, after the
+  // state files were read. Pins it so the next version's chunks are skipped.
+  TF_RETURN_IF_ERROR(PinCommittedVersions());
   for (const std::string& chunk : chunks) {
-    if (!chunks_read_.contains(chunk)) {
+    if (!chunks_read_.contains(chunk) && IsVisible(chunk)) {
       chunks_unread_.insert(std::string(chunk));
     }
   }
@@ -147,10 +157,60 @@ SnapshotChunkProvider::GetAvailableChunks() {
   return status_or_chunks.status();
 }
 
+absl::Status SnapshotChunkProvider::PinCommittedVersions(
+    std::optional<int64_t> num_versions) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (!committed_stream_ranges_.empty()) {
+    return absl::OkStatus();
+  }
+  TF_ASSIGN_OR_RETURN(
+      std::optional<experimental::DistributedSnapshotManifest> manifest,
+      ReadSnapshotManifest(snapshot_path_, env_));
+  if (!manifest.has_value()) {
+    return absl::OkStatus();
+  }
+  int64_t num_pinned_versions =
+      std::min<int64_t>(num_versions.value_or(manifest->versions_size()),
+                        manifest->versions_size());
+  std::vector<std::pair<int64_t, int64_t>> committed_stream_ranges;
+  for (int64_t i = 0; i < num_pinned_versions; ++i) {
+    const auto& version = manifest->versions(i);
+    if (version.committed()) {
+      committed_stream_ranges.emplace_back(version.first_stream_index(),
+                                           version.end_stream_index());
+    }
+  }
+  if (committed_stream_ranges.empty()) {
+    return absl::OkStatus();
+  }
+  // Later versions and their errors are not visible to this reader.
+  num_pinned_versions_ = num_pinned_versions;
+  committed_stream_ranges_ = std::move(committed_stream_ranges);
+  snapshot_state_ = SnapshotState(/*snapshot_is_done=*/true);
+  return absl::OkStatus();
+}
+
+bool SnapshotChunkProvider::IsVisible(absl::string_view chunk) const
+    ABSL_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (committed_stream_ranges_.empty()) {
+    return true;
+  }
+  absl::StatusOr<std::tuple<int64_t, int64_t, int64_t>> tokens =
+      ParseChunkFilename(chunk);
+  if (!tokens.ok()) {
+    return false;
+  }
+  const int64_t stream_index = std::get<0>(*tokens);
+  return absl::c_any_of(committed_stream_ranges_, [&](const auto& range) {
+    return stream_index >= range.first && stream_index < range.second;
+  });
+}
+
 absl::Status SnapshotChunkProvider::Reset() {
   absl::MutexLock l(&mu_);
   chunks_read_.clear();
   chunks_unread_.clear();
+  num_pinned_versions_ = 0;
+  committed_stream_ranges_.clear();
   return UpdateSnapshot();
 }
 
@@ -160,6 +220,10 @@ absl::Status SnapshotChunkProvider::Save(
   absl::MutexLock l(&mu_);
   TF_RETURN_IF_ERROR(
       writer->WriteScalar(full_name(kChunksRead), SetToString(chunks_read_)));
+  if (num_pinned_versions_ > 0) {
+    TF_RETURN_IF_ERROR(writer->WriteScalar(full_name(kNumPinnedVersions),
+                                           num_pinned_versions_));
+  }
   return absl::OkStatus();
 }
 
@@ -170,6 +234,14 @@ absl::Status SnapshotChunkProvider::Restore(
   tsl::tstring chunks_read;
   TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kChunksRead), &chunks_read));
   chunks_read_ = SetFromString(chunks_read);
+  num_pinned_versions_ = 0;
+  committed_stream_ranges_.clear();
+  if (reader->Contains(full_name(kNumPinnedVersions))) {
+    int64_t num_pinned_versions = 0;
+    TF_RETURN_IF_ERROR(reader->ReadScalar(full_name(kNumPinnedVersions),
+                                          &num_pinned_versions));
+    TF_RETURN_IF_ERROR(PinCommittedVersions(num_pinned_versions));
+  }
   return UpdateSnapshot();
 }
 
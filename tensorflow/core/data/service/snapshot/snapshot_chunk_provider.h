@@ -37,6 +37,10 @@ namespace data {
 
 // Provides the next chunk to read. Blocks until the next chunk is unavailable,
 // or all the chunks have been read. This class is thread-safe.
+//
+// If the snapshot is incremental and has a committed version, the provider
+// pins the committed versions when it first observes them, and only provides
+// chunks of their streams. Versions written later are visible after `Reset`.
 class SnapshotChunkProvider : public SplitProvider {
  public:
   SnapshotChunkProvider(absl::string_view snapshot_path, tsl::Env* env);
@@ -57,8 +61,9 @@ class SnapshotChunkProvider : public SplitProvider {
   absl::Status Restore(std::function<std::string(std::string)> full_name,
                        IteratorStateReader* reader) override;
 
-  // If the snapshot is finished, returns the number of committed chunks.
-  // If the snapshot is unfinished or has failed, returns kUnknownCardinality.
+  // If the snapshot has a committed version or is finished, returns the number
+  // of committed chunks. If the snapshot is unfinished or has failed, returns
+  // kUnknownCardinality.
   int64_t Cardinality() const override;
 
   // Cancels the provider. After cancelling, if the snapshot is unfinished,
@@ -102,6 +107,16 @@ class SnapshotChunkProvider : public SplitProvider {
   // names.
   absl::StatusOr<std::vector<std::string>> GetAvailableChunks();
 
+  // Pins the committed versions of an incremental snapshot if it has any and
+  // none have been pinned yet. If `num_versions` is set, only considers the
+  // first `num_versions` versions in the manifest.
+  absl::Status PinCommittedVersions(
+      std::optional<int64_t> num_versions = std::nullopt);
+
+  // Returns true if `chunk` belongs to a pinned version, or if no version is
+  // pinned.
+  bool IsVisible(absl::string_view chunk) const;
+
   const std::string snapshot_path_;
   tsl::Env* const env_;
 
@@ -116,6 +131,12 @@ class SnapshotChunkProvider : public SplitProvider {
 
   // State of the snapshot.
   SnapshotState snapshot_state_ ABSL_GUARDED_BY(mu_);
+
+  // The number of versions in the manifest when the committed versions were
+  // pinned, and the [first, end) stream ranges of the committed versions.
+  int64_t num_pinned_versions_ ABSL_GUARDED_BY(mu_) = 0;
+  std::vector<std::pair<int64_t, int64_t>> committed_stream_ranges_
+      ABSL_GUARDED_BY(mu_);
 };
 
 }  // namespace data
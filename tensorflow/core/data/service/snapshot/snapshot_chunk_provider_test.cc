@@ -32,6 +32,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/variant_tensor_data.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
@@ -84,6 +85,26 @@ absl::Status SetStatus(absl::string_view snapshot_path,
                                   tsl::Env::Default());
 }
 
+absl::Status WriteManifest(
+    absl::string_view snapshot_path,
+    const std::vector<std::pair<int64_t, int64_t>>& committed_versions,
+    std::optional<int64_t> uncommitted_first_stream_index = std::nullopt) {
+  experimental::DistributedSnapshotManifest manifest;
+  for (const auto& [first_stream_index, end_stream_index] :
+       committed_versions) {
+    auto* version = manifest.add_versions();
+    version->set_first_stream_index(first_stream_index);
+    version->set_end_stream_index(end_stream_index);
+    version->set_committed(true);
+  }
+  if (uncommitted_first_stream_index.has_value()) {
+    manifest.add_versions()->set_first_stream_index(
+        *uncommitted_first_stream_index);
+  }
+  return AtomicallyWriteTextProto(SnapshotManifestFilePath(snapshot_path),
+                                  manifest, tsl::Env::Default());
+}
+
 absl::StatusOr<std::string> GetChunk(
     SnapshotChunkProvider& snapshot_chunk_provider) {
   Tensor split;
@@ -317,6 +338,47 @@ TEST(SnapshotChunkProviderTest, SnapshotError) {
   reader_thread.reset();
 }
 
+TEST(SnapshotChunkProviderTest, IncrementalSnapshot) {
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  TF_ASSERT_OK(WriteChunk(snapshot_path, "chunk_0_0_1"));
+  TF_ASSERT_OK(WriteChunk(snapshot_path, "chunk_1_0_1"));
+  TF_ASSERT_OK(WriteManifest(snapshot_path, /*committed_versions=*/{{0, 2}},
+                             /*uncommitted_first_stream_index=*/2));
+  // The version in progress writes chunks and fails. Readers of the committed
+  // version do not see either.
+  TF_ASSERT_OK(WriteChunk(snapshot_path, "chunk_2_0_1"));
+  TF_ASSERT_OK(
+      SetStatus(snapshot_path, absl::FailedPreconditionError("Test error.")));
+
+  SnapshotChunkProvider snapshot_chunk_provider(snapshot_path,
+                                                tsl::Env::Default());
+  EXPECT_THAT(GetAllChunks(snapshot_chunk_provider),
+              IsOkAndHolds(ElementsAreArray(
+                  JoinPaths(snapshot_path, {"chunk_0_0_1", "chunk_1_0_1"}))));
+  EXPECT_EQ(snapshot_chunk_provider.Cardinality(), 2);
+}
+
+TEST(SnapshotChunkProviderTest, IncrementalSnapshotPinsVersions) {
+  TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
+  TF_ASSERT_OK(WriteChunk(snapshot_path, "chunk_0_0_1"));
+  TF_ASSERT_OK(WriteManifest(snapshot_path, /*committed_versions=*/{{0, 1}}));
+  SnapshotChunkProvider snapshot_chunk_provider(snapshot_path,
+                                                tsl::Env::Default());
+  EXPECT_THAT(GetChunk(snapshot_chunk_provider),
+              IsOkAndHolds(tsl::io::JoinPath(
+                  CommittedChunksDirectory(snapshot_path), "chunk_0_0_1")));
+
+  // A new version is committed while reading. It is visible after `Reset`.
+  TF_ASSERT_OK(WriteChunk(snapshot_path, "chunk_1_0_1"));
+  TF_ASSERT_OK(
+      WriteManifest(snapshot_path, /*committed_versions=*/{{0, 1}, {1, 2}}));
+  EXPECT_THAT(GetAllChunks(snapshot_chunk_provider), IsOkAndHolds(IsEmpty()));
+  TF_ASSERT_OK(snapshot_chunk_provider.Reset());
+  EXPECT_THAT(GetAllChunks(snapshot_chunk_provider),
+              IsOkAndHolds(ElementsAreArray(
+                  JoinPaths(snapshot_path, {"chunk_0_0_1", "chunk_1_0_1"}))));
+}
+
 TEST(SnapshotChunkProviderTest, Cancel) {
   TF_ASSERT_OK_AND_ASSIGN(std::string snapshot_path, CreateSnapshotDirectory());
   SnapshotChunkProvider snapshot_chunk_provider(snapshot_path,
@@ -18,6 +18,7 @@ limitations under the License.
 #include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
 #include <optional>
 #include <string>
@@ -40,9 +41,14 @@ limitations under the License.
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/snapshot/prefetched_split_provider.h"
 #include "tensorflow/core/data/service/split_provider.h"
+#include "tensorflow/core/data/snapshot_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/fingerprint.h"
 #include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/lib/io/compression.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/errors.h"
@@ -60,21 +66,6 @@ namespace {
 
 const absl::Duration kProgressLoggingInterval = absl::Minutes(1);
 
-absl::StatusOr<int64_t> CountSplits(SplitProvider& split_provider) {
-  if (split_provider.Cardinality() != kUnknownCardinality) {
-    return split_provider.Cardinality();
-  }
-
-  int64_t num_splits = 0;
-  Tensor tensor;
-  for (bool end_of_splits = false; !end_of_splits; ++num_splits) {
-    TF_RETURN_IF_ERROR(split_provider.GetNext(&tensor, &end_of_splits));
-  }
-  --num_splits;
-  TF_RETURN_IF_ERROR(split_provider.Reset());
-  return num_splits;
-}
-
 absl::Status SkipSplit(SplitProvider& split_provider,
                        int64_t& repetition_index) {
   Tensor tensor;
@@ -94,6 +85,102 @@ std::string PrefetchedSplitDir(const std::string& snapshot_path,
                            absl::StrCat("source_", source_index));
 }
 
+// Identifies a split across versions of an incremental snapshot. The same
+// split in different repetitions has different fingerprints.
+uint64_t SplitFingerprint(int64_t source_index, int64_t repetition_index,
+                          const Tensor& split) {
+  TensorProto split_proto;
+  split.AsProtoTensorContent(&split_proto);
+  std::string serialized_split;
+  SerializeToStringDeterministic(split_proto, &serialized_split);
+  return FingerprintCat64(FingerprintCat64(source_index, repetition_index),
+                          Fingerprint64(serialized_split));
+}
+
+// Counts the splits of source `source_index` in one repetition, excluding the
+// splits in `materialized_splits`.
+absl::StatusOr<int64_t> CountSplits(
+    SplitProvider& split_provider, int64_t source_index,
+    const absl::flat_hash_set<uint64_t>& materialized_splits) {
+  if (materialized_splits.empty() &&
+      split_provider.Cardinality() != kUnknownCardinality) {
+    return split_provider.Cardinality();
+  }
+
+  int64_t num_splits = 0;
+  Tensor tensor;
+  bool end_of_splits = false;
+  TF_RETURN_IF_ERROR(split_provider.GetNext(&tensor, &end_of_splits));
+  while (!end_of_splits) {
+    if (!materialized_splits.contains(SplitFingerprint(
+            source_index, /*repetition_index=*/0, tensor))) {
+      ++num_splits;
+    }
+    TF_RETURN_IF_ERROR(split_provider.GetNext(&tensor, &end_of_splits));
+  }
+  TF_RETURN_IF_ERROR(split_provider.Reset());
+  return num_splits;
+}
+
+// Skips the splits materialized by the committed versions of an incremental
+// snapshot, so that a new version only processes new splits.
+class SkipMaterializedSplitProvider : public SplitProvider {
+ public:
+  SkipMaterializedSplitProvider(
+      std::unique_ptr<SplitProvider> split_provider, int64_t source_index,
+      std::shared_ptr<const absl::flat_hash_set<uint64_t>> materialized_splits)
+      : split_provider_(std::move(split_provider)),
+        source_index_(source_index),
+        materialized_splits_(std::move(materialized_splits)) {}
+
+  absl::Status GetNext(Tensor* split, bool* end_of_splits) override {
+    do {
+      TF_RETURN_IF_ERROR(split_provider_->GetNext(split, end_of_splits));
+    } while (!*end_of_splits &&
+             materialized_splits_->contains(
+                 SplitFingerprint(source_index_, repetition_index_, *split)));
+    return absl::OkStatus();
+  }
+
+  absl::Status Reset() override {
+    ++repetition_index_;
+    return split_provider_->Reset();
+  }
+
+  absl::Status Save(std::function<std::string(std::string)> full_name,
+                    IteratorStateWriter* writer) override {
+    return split_provider_->Save(std::move(full_name), writer);
+  }
+
+  absl::Status Restore(std::function<std::string(std::string)> full_name,
+                       IteratorStateReader* reader) override {
+    return split_provider_->Restore(std::move(full_name), reader);
+  }
+
+  void Cancel() override { split_provider_->Cancel(); }
+
+ private:
+  const std::unique_ptr<SplitProvider> split_provider_;
+  const int64_t source_index_;
+  const std::shared_ptr<const absl::flat_hash_set<uint64_t>>
+      materialized_splits_;
+  int64_t repetition_index_ = 0;
+};
+
+// Returns the first stream index after all stream directories of the snapshot.
+absl::StatusOr<int64_t> NextStreamIndex(const std::string& snapshot_path,
+                                        tsl::Env* env) {
+  TF_ASSIGN_OR_RETURN(std::vector<std::string> stream_directories,
+                      GetChildren(StreamsDirectory(snapshot_path), env));
+  int64_t next_stream_index = 0;
+  for (const std::string& stream_directory : stream_directories) {
+    TF_ASSIGN_OR_RETURN(int64_t stream_index,
+                        ParseStreamDirectoryName(stream_directory));
+    next_stream_index = std::max(next_stream_index, stream_index + 1);
+  }
+  return next_stream_index;
+}
+
 }  // namespace
 
 absl::StatusOr<bool> SnapshotAssignmentManager::TryAddAssignment(
@@ -179,13 +266,23 @@ absl::StatusOr<std::unique_ptr<SnapshotManager>> SnapshotManager::Start(
 absl::Status SnapshotManager::Start(const SnapshotRequest& request)
     TF_LOCKS_EXCLUDED(mu_) {
   LOG(INFO) << "Starting to write tf.data snapshot at " << request.path();
+  tsl::mutex_lock l(mu_);
   if (env_->FileExists(request.path()).ok()) {
-    return errors::AlreadyExists("tf.data snapshot at ", request.path(),
-                                 " already exists.");
+    if (!request.metadata().incremental()) {
+      return errors::AlreadyExists("tf.data snapshot at ", request.path(),
+                                   " already exists.");
+    }
+    TF_RETURN_IF_ERROR(StartNextVersion(request));
+  } else {
+    TF_RETURN_IF_ERROR(WriteOnDiskSkeleton());
+    TF_RETURN_IF_ERROR(WriteOnDiskMetadata(request));
+    if (request.metadata().incremental()) {
+      manifest_.emplace();
+      manifest_->add_versions()->set_first_stream_index(0);
+      TF_RETURN_IF_ERROR(AtomicallyWriteTextProto(
+          SnapshotManifestFilePath(path_), *manifest_, env_));
+    }
   }
-  tsl::mutex_lock l(mu_);
-  TF_RETURN_IF_ERROR(WriteOnDiskSkeleton());
-  TF_RETURN_IF_ERROR(WriteOnDiskMetadata(request));
   TF_ASSIGN_OR_RETURN(sources_, CreateSources(request.dataset()));
   TF_ASSIGN_OR_RETURN(num_total_splits_, GetSplitsCardinality());
   metadata_ = request.metadata();
@@ -193,6 +290,199 @@ absl::Status SnapshotManager::Start(const SnapshotRequest& request)
   return absl::OkStatus();
 }
 
+absl::Status SnapshotManager::StartNextVersion(const SnapshotRequest& request)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  TF_ASSIGN_OR_RETURN(manifest_, ReadSnapshotManifest(path_, env_));
+  const bool is_done = env_->FileExists(SnapshotDoneFilePath(path_)).ok();
+  const bool is_committed =
+      manifest_.has_value() && !manifest_->versions().empty() &&
+      manifest_->versions().rbegin()->committed();
+  const bool has_error = env_->FileExists(SnapshotErrorFilePath(path_)).ok();
+  if (!is_done && !is_committed && !has_error) {
+    return absl::FailedPreconditionError(absl::StrCat(
+        "Failed to extend tf.data snapshot at ", path_,
+        ": the snapshot is still being written. Wait for it to finish."));
+  }
+
+  experimental::DistributedSnapshotMetadata metadata;
+  TF_RETURN_IF_ERROR(
+      ReadTextProto(env_, SnapshotMetadataFilePath(path_), &metadata));
+  if (metadata.element_spec() != request.metadata().element_spec() ||
+      metadata.compression() != request.metadata().compression()) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Failed to extend tf.data snapshot at ", path_,
+        ": the element spec and compression must match the existing "
+        "snapshot."));
+  }
+
+  TF_ASSIGN_OR_RETURN(first_stream_index_, NextStreamIndex(path_, env_));
+  if (!manifest_.has_value()) {
+    if (!is_done) {
+      return absl::FailedPreconditionError(
+          absl::StrCat("Failed to extend tf.data snapshot at ", path_,
+                       ": the snapshot failed before it was committed."));
+    }
+    // A finished non-incremental snapshot becomes the first version.
+    manifest_.emplace();
+    experimental::DistributedSnapshotManifest::Version* version =
+        manifest_->add_versions();
+    version->set_first_stream_index(0);
+    version->set_end_stream_index(first_stream_index_);
+    version->set_committed(true);
+    TF_ASSIGN_OR_RETURN(std::vector<uint64_t> fingerprints,
+                        ReadMaterializedSplits(0, first_stream_index_));
+    TF_RETURN_IF_ERROR(WriteMaterializedSplits(/*version_index=*/0,
+                                               fingerprints));
+  }
+  for (const auto& version : manifest_->versions()) {
+    first_stream_index_ =
+        std::max(first_stream_index_, version.end_stream_index());
+  }
+
+  // Versions are appended and never rewritten. An uncommitted version which
+  // is not the last one has failed, and its streams are ignored. The DONE and
+  // ERROR files of the previous version are removed after the manifest is
+  // written; `Resume` removes them if the dispatcher fails in between.
+  TF_RETURN_IF_ERROR(LoadMaterializedSplits());
+  manifest_->add_versions()->set_first_stream_index(first_stream_index_);
+  TF_RETURN_IF_ERROR(WriteOnDiskMetadata(request));
+  TF_RETURN_IF_ERROR(AtomicallyWriteTextProto(SnapshotManifestFilePath(path_),
+                                              *manifest_, env_));
+  for (const std::string& file :
+       {SnapshotDoneFilePath(path_), SnapshotErrorFilePath(path_)}) {
+    if (env_->FileExists(file).ok()) {
+      TF_RETURN_IF_ERROR(env_->DeleteFile(file));
+    }
+  }
+  LOG(INFO) << "Starting version " << manifest_->versions_size() - 1
+            << " of tf.data snapshot at " << path_ << " from stream "
+            << first_stream_index_;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<std::vector<uint64_t>> SnapshotManager::ReadMaterializedSplits(
+    int64_t first_stream_index, int64_t end_stream_index) const {
+  std::vector<uint64_t> fingerprints;
+  for (int64_t stream_index = first_stream_index;
+       stream_index < end_stream_index; ++stream_index) {
+    std::string splits_path = SplitsDirectory(path_, stream_index);
+    if (!env_->FileExists(splits_path).ok()) {
+      continue;
+    }
+    TF_ASSIGN_OR_RETURN(std::vector<std::string> source_directories,
+                        GetChildren(splits_path, env_));
+    for (const std::string& source_directory : source_directories) {
+      TF_ASSIGN_OR_RETURN(int64_t source_index,
+                          ParseSourceDirectoryName(source_directory));
+      std::string source_path =
+          tsl::io::JoinPath(splits_path, source_directory);
+      TF_ASSIGN_OR_RETURN(std::vector<std::string> repetition_directories,
+                          GetChildren(source_path, env_));
+      for (const std::string& repetition_directory : repetition_directories) {
+        TF_ASSIGN_OR_RETURN(int64_t repetition_index,
+                            ParseRepetitionDirectoryName(repetition_directory));
+        std::string repetition_path =
+            tsl::io::JoinPath(source_path, repetition_directory);
+        TF_ASSIGN_OR_RETURN(std::vector<std::string> split_files,
+                            GetChildren(repetition_path, env_));
+        for (const std::string& split_file : split_files) {
+          snapshot_util::TFRecordReaderImpl reader(
+              tsl::io::JoinPath(repetition_path, split_file),
+              tsl::io::compression::kNone);
+          TF_RETURN_IF_ERROR(reader.Initialize(env_));
+          TF_ASSIGN_OR_RETURN(std::vector<Tensor> tensors, reader.GetTensors());
+          if (tensors.size() != 1) {
+            return absl::InternalError(absl::StrCat(
+                "A snapshot split file is expected to contain 1 tensor. Got ",
+                tensors.size(), " tensors from ", split_file, "."));
+          }
+          fingerprints.push_back(
+              SplitFingerprint(source_index, repetition_index, tensors[0]));
+        }
+      }
+    }
+  }
+  return fingerprints;
+}
+
+absl::Status SnapshotManager::WriteMaterializedSplits(
+    int64_t version_index, const std::vector<uint64_t>& fingerprints) const {
+  TF_RETURN_IF_ERROR(
+      env_->RecursivelyCreateDir(MaterializedSplitsDirectory(path_)));
+  experimental::DistributedSnapshotSplitFingerprints proto;
+  proto.mutable_fingerprints()->Assign(fingerprints.begin(),
+                                       fingerprints.end());
+  return AtomicallyWriteBinaryProto(
+      MaterializedSplitsFilePath(path_, version_index), proto, env_);
+}
+
+absl::Status SnapshotManager::LoadMaterializedSplits()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  auto materialized_splits = std::make_shared<absl::flat_hash_set<uint64_t>>();
+  const int64_t num_versions =
+      manifest_.has_value() ? manifest_->versions_size() : 0;
+  for (int64_t i = 0; i < num_versions; ++i) {
+    if (!manifest_->versions(i).committed()) {
+      continue;
+    }
+    experimental::DistributedSnapshotSplitFingerprints proto;
+    TF_RETURN_IF_ERROR(tsl::ReadBinaryProto(
+        env_, MaterializedSplitsFilePath(path_, i), &proto));
+    materialized_splits->insert(proto.fingerprints().begin(),
+                                proto.fingerprints().end());
+  }
+  materialized_splits_ = std::move(materialized_splits);
+  return absl::OkStatus();
+}
+
+void SnapshotManager::SkipMaterializedSplits(
+    std::vector<std::unique_ptr<SplitProvider>>& split_providers) const
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (materialized_splits_->empty()) {
+    return;
+  }
+  for (size_t i = 0; i < split_providers.size(); ++i) {
+    split_providers[i] = std::make_unique<SkipMaterializedSplitProvider>(
+        std::move(split_providers[i]), i, materialized_splits_);
+  }
+}
+
+absl::Status SnapshotManager::CommitVersion() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  if (!manifest_.has_value()) {
+    return absl::OkStatus();
+  }
+  int64_t end_stream_index =
+      streams_.empty() ? first_stream_index_ : streams_.rbegin()->first + 1;
+  // The fingerprints are written before the version is committed. A version
+  // only reads the fingerprints of committed versions, so a file left by a
+  // failed commit is ignored and overwritten when the commit is retried.
+  const int64_t version_index = manifest_->versions_size() - 1;
+  TF_RETURN_IF_ERROR(
+      WriteMaterializedSplits(version_index, version_fingerprints_));
+  experimental::DistributedSnapshotManifest manifest = *manifest_;
+  experimental::DistributedSnapshotManifest::Version* version =
+      manifest.mutable_versions(version_index);
+  version->set_end_stream_index(end_stream_index);
+  version->set_committed(true);
+  TF_RETURN_IF_ERROR(AtomicallyWriteTextProto(SnapshotManifestFilePath(path_),
+                                              manifest, env_));
+  *manifest_ = std::move(manifest);
+  LOG(INFO) << "Committed version " << version_index
+            << " of tf.data snapshot at " << path_ << " with "
+            << version_fingerprints_.size() << " new splits.";
+  return absl::OkStatus();
+}
+
+absl::Status SnapshotManager::FinishSnapshot()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  mode_ = Mode::kDone;
+  TF_RETURN_IF_ERROR(CommitVersion());
+  TF_RETURN_IF_ERROR(AtomicallyWriteStringToFile(SnapshotDoneFilePath(path_),
+                                                 std::string(), env_));
+  LOG(INFO) << "Finished writing tf.data distributed snapshot at " << path_;
+  return absl::OkStatus();
+}
+
 absl::StatusOr<std::vector<SnapshotManager::Source>>
 SnapshotManager::CreateSources(const DatasetDef& dataset_def) const
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -200,12 +490,21 @@ SnapshotManager::CreateSources(const DatasetDef& dataset_def) const
   TF_RETURN_IF_ERROR(CreateSplitProviders(dataset_def, split_providers));
   std::vector<SnapshotManager::Source> sources;
   sources.reserve(split_providers.size());
+  std::vector<int64_t> cardinalities;
+  for (size_t i = 0; i < split_providers.size(); ++i) {
+    // Counts the splits before wrapping the split providers, so that `Reset`
+    // calls track the repetitions of the split providers.
+    TF_ASSIGN_OR_RETURN(
+        int64_t cardinality,
+        CountSplits(*split_providers[i], i, *materialized_splits_));
+    cardinalities.push_back(cardinality);
+  }
+  SkipMaterializedSplits(split_providers);
   for (size_t i = 0; i < split_providers.size(); ++i) {
-    TF_ASSIGN_OR_RETURN(size_t cardinality, CountSplits(*split_providers[i]));
     sources.emplace_back(
         std::make_unique<PrefetchedSplitProvider>(
             std::move(split_providers[i]), PrefetchedSplitDir(path_, i), env_),
-        /*repetition_index=*/0, cardinality);
+        /*repetition_index=*/0, cardinalities[i]);
   }
   return sources;
 }
@@ -253,6 +552,7 @@ absl::Status SnapshotManager::Resume() TF_LOCKS_EXCLUDED(mu_) {
         absl::StrCat("Failed to recover tf.data snapshot at ", path_,
                      ": the snapshot path doesn't exist."));
   }
+  TF_RETURN_IF_ERROR(ReadOnDiskManifest());
   if (env_->FileExists(SnapshotDoneFilePath(path_)).ok()) {
     mode_ = Mode::kDone;
     LOG(INFO) << "Recovered finished tf.data snapshot at " << path_;
@@ -290,6 +590,43 @@ absl::Status SnapshotManager::ReadOnDiskMetadata()
   return absl::OkStatus();
 }
 
+absl::Status SnapshotManager::ReadOnDiskManifest()
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  TF_ASSIGN_OR_RETURN(manifest_, ReadSnapshotManifest(path_, env_));
+  if (!manifest_.has_value() || manifest_->versions().empty()) {
+    return absl::OkStatus();
+  }
+  const experimental::DistributedSnapshotManifest::Version& version =
+      *manifest_->versions().rbegin();
+  if (version.committed()) {
+    // The dispatcher may have failed after committing the version but before
+    // writing the DONE file.
+    if (!env_->FileExists(SnapshotDoneFilePath(path_)).ok()) {
+      TF_RETURN_IF_ERROR(AtomicallyWriteStringToFile(
+          SnapshotDoneFilePath(path_), std::string(), env_));
+    }
+    return absl::OkStatus();
+  }
+
+  // The dispatcher may have failed after starting this version but before
+  // removing the DONE and ERROR files of the previous version. A DONE file is
+  // always stale since it is written after the version is committed. An ERROR
+  // file is stale if no stream of this version has been created.
+  first_stream_index_ = version.first_stream_index();
+  TF_RETURN_IF_ERROR(LoadMaterializedSplits());
+  if (env_->FileExists(SnapshotDoneFilePath(path_)).ok()) {
+    TF_RETURN_IF_ERROR(env_->DeleteFile(SnapshotDoneFilePath(path_)));
+  }
+  if (env_->FileExists(SnapshotErrorFilePath(path_)).ok()) {
+    TF_ASSIGN_OR_RETURN(int64_t next_stream_index,
+                        NextStreamIndex(path_, env_));
+    if (next_stream_index <= first_stream_index_) {
+      TF_RETURN_IF_ERROR(env_->DeleteFile(SnapshotErrorFilePath(path_)));
+    }
+  }
+  return absl::OkStatus();
+}
+
 // TODO(yangchen): Refactor this method.
 absl::Status SnapshotManager::ReadOnDiskStreams()
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -305,9 +642,12 @@ absl::Status SnapshotManager::ReadOnDiskStreams()
   std::vector<int64_t> repetition_indices(split_providers.size(), 0);
   std::vector<int64_t> cardinalities;
   for (size_t i = 0; i < split_providers.size(); ++i) {
-    TF_ASSIGN_OR_RETURN(int64_t cardinality, CountSplits(*split_providers[i]));
+    TF_ASSIGN_OR_RETURN(
+        int64_t cardinality,
+        CountSplits(*split_providers[i], i, *materialized_splits_));
     cardinalities.push_back(cardinality);
   }
+  SkipMaterializedSplits(split_providers);
 
   tsl::mutex mu;  // Protects `resume_status` and `global_split_indices`.
   absl::Status resume_status;
@@ -327,6 +667,10 @@ absl::Status SnapshotManager::ReadOnDiskStreams()
           "Can't parse tf.data snapshot stream directory ", stream_path,
           ": filename must have the format stream_<stream_index>."));
     }
+    if (stream_index < first_stream_index_) {
+      // The stream belongs to an earlier version of an incremental snapshot.
+      continue;
+    }
 
     thread_pool->Schedule([this, &stream_directories, stream_index,
                            &split_providers, &repetition_indices,
@@ -362,14 +706,20 @@ absl::Status SnapshotManager::ReadOnDiskStreams()
     }
   }
   num_assigned_splits_ = global_split_indices.size();
+  if (manifest_.has_value()) {
+    // Splits assigned before the dispatcher restarted are only recorded on
+    // disk. Reading them here keeps `CommitVersion` from reading split files.
+    int64_t end_stream_index =
+        streams_.empty() ? first_stream_index_ : streams_.rbegin()->first + 1;
+    TF_ASSIGN_OR_RETURN(
+        version_fingerprints_,
+        ReadMaterializedSplits(first_stream_index_, end_stream_index));
+  }
 
   if (!streams_.empty() && absl::c_all_of(streams_, [](const auto& stream) {
         return stream.second.state == Stream::State::kDone;
       })) {
-    mode_ = Mode::kDone;
-    TF_RETURN_IF_ERROR(AtomicallyWriteStringToFile(SnapshotDoneFilePath(path_),
-                                                   std::string(), env_));
-    LOG(INFO) << "Finished writing tf.data distributed snapshot at " << path_;
+    TF_RETURN_IF_ERROR(FinishSnapshot());
   }
   return absl::OkStatus();
 }
@@ -537,10 +887,7 @@ absl::Status SnapshotManager::HandleStreamCompletion(
   if (absl::c_all_of(streams_, [](const auto& stream) {
         return stream.second.state == Stream::State::kDone;
       })) {
-    mode_ = Mode::kDone;
-    TF_RETURN_IF_ERROR(AtomicallyWriteStringToFile(SnapshotDoneFilePath(path_),
-                                                   std::string(), env_));
-    LOG(INFO) << "Finished writing tf.data distributed snapshot at " << path_;
+    TF_RETURN_IF_ERROR(FinishSnapshot());
   }
   return absl::OkStatus();
 }
@@ -568,7 +915,7 @@ absl::StatusOr<std::optional<int64_t>>
 SnapshotManager::MaybeCreateAndAssignNewStream(absl::string_view worker_address)
     TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
   int64_t new_stream_index =
-      streams_.empty() ? 0 : streams_.rbegin()->first + 1;
+      streams_.empty() ? first_stream_index_ : streams_.rbegin()->first + 1;
   TF_ASSIGN_OR_RETURN(bool assignment_added,
                       assignment_manager_.TryAddAssignment(
                           path_, worker_address, new_stream_index));
@@ -713,6 +1060,7 @@ absl::Status SnapshotManager::GetSnapshotSplit(
   int64_t local_split_index = 0;
   int64_t global_split_index = 0;
   PrefetchedSplitProvider* split_provider = nullptr;
+  bool is_incremental = false;
   tsl::mutex_lock get_split_lock(get_split_mu_);
   {
     tsl::mutex_lock l(mu_);
@@ -748,6 +1096,7 @@ absl::Status SnapshotManager::GetSnapshotSplit(
       TF_RETURN_IF_ERROR(ResetSource(source, request.source_index()));
     }
     split_provider = source.split_provider.get();
+    is_incremental = manifest_.has_value();
   }
 
   std::string split_path = SplitPath(
@@ -760,8 +1109,16 @@ absl::Status SnapshotManager::GetSnapshotSplit(
     return absl::OkStatus();
   }
   split->AsProtoTensorContent(response.mutable_split());
+  std::optional<uint64_t> fingerprint;
+  if (is_incremental) {
+    fingerprint = SplitFingerprint(request.source_index(),
+                                   request.repetition_index(), *split);
+  }
 
   tsl::mutex_lock l(mu_);
+  if (fingerprint.has_value()) {
+    version_fingerprints_.push_back(*fingerprint);
+  }
   ++GetStream(request.stream_index())
         .num_assigned_splits_per_source[request.source_index()];
   ++num_assigned_splits_;
@@ -794,6 +1151,11 @@ absl::Status SnapshotManager::GetSnapshotStreams(
   return absl::OkStatus();
 }
 
+bool SnapshotManager::IsFinished() const TF_LOCKS_EXCLUDED(mu_) {
+  tsl::tf_shared_lock l(mu_);
+  return mode_ == Mode::kDone || mode_ == Mode::kError;
+}
+
 void SnapshotManager::Cancel() {
   std::vector<PrefetchedSplitProvider*> split_providers_to_cancel;
   {
@@ -125,6 +125,7 @@ class SnapshotAssignmentManager {
 //   - DONE
 //   - ERROR
 //   - snapshot.metadata
+//   - snapshot.manifest (incremental snapshots only)
 //   - dataset_def.proto
 //   - dataset_spec.pb
 //   - chunks
@@ -141,11 +142,18 @@ class SnapshotAssignmentManager {
 //       - checkpoints
 //         - checkpoint_<chunk_index>_<num_elements>
 //
+// An incremental snapshot (`DistributedSnapshotMetadata.incremental`) may be
+// extended after it finishes. Each extension is a new version recorded in
+// `snapshot.manifest`, which owns a contiguous range of streams and only
+// processes splits not materialized by earlier committed versions. A version
+// is committed before the DONE file is written, so readers of a committed
+// version never observe chunks of a version in progress.
 class SnapshotManager {
  public:
   // Initiates a new snapshot process, creating a fresh in-memory state and
   // writing an on-disk state to `path`. Returns an error if `path` already
-  // exists in the filesystem.
+  // exists in the filesystem, unless the request is incremental and the
+  // existing snapshot is finished, in which case a new version is started.
   static absl::StatusOr<std::unique_ptr<SnapshotManager>> Start(
       const SnapshotRequest& request,
       SnapshotAssignmentManager& assignment_manager, Env* env);
@@ -167,6 +175,9 @@ class SnapshotManager {
                                 GetSnapshotSplitResponse& response);
   absl::Status GetSnapshotStreams(GetSnapshotStreamsResponse& response);
 
+  // Returns true if the snapshot is done or has failed.
+  bool IsFinished() const;
+
   // Cancels the SnapshotManager and finishes in-progress threads.
   void Cancel();
 
@@ -182,11 +193,33 @@ class SnapshotManager {
   absl::Status Start(const SnapshotRequest& request);
   absl::Status WriteOnDiskSkeleton();
   absl::Status WriteOnDiskMetadata(const SnapshotRequest& request);
+  absl::Status StartNextVersion(const SnapshotRequest& request);
 
   // Helpers for `Resume` above. These update the in-memory state.
   absl::Status Resume();
   absl::Status ReadOnDiskMetadata();
   absl::Status ReadOnDiskStreams();
+  absl::Status ReadOnDiskManifest();
+
+  // Helpers for incremental snapshots.
+  // Reads the split files of streams in `[first_stream_index,
+  // end_stream_index)` and returns their fingerprints.
+  absl::StatusOr<std::vector<uint64_t>> ReadMaterializedSplits(
+      int64_t first_stream_index, int64_t end_stream_index) const;
+  // Writes the fingerprints of the splits materialized by `version_index`.
+  absl::Status WriteMaterializedSplits(
+      int64_t version_index, const std::vector<uint64_t>& fingerprints) const;
+  // Reads the fingerprints of the splits materialized by committed versions
+  // into `materialized_splits_`.
+  absl::Status LoadMaterializedSplits();
+  // Wraps `split_providers` to skip splits materialized by committed versions.
+  void SkipMaterializedSplits(
+      std::vector<std::unique_ptr<SplitProvider>>& split_providers) const;
+  // Commits the current version, writing `version_fingerprints_`. Must be
+  // called before writing the DONE file.
+  absl::Status CommitVersion();
+  // Writes the DONE file after committing the current version.
+  absl::Status FinishSnapshot();
 
   // Helpers for `WorkerHeartbeat` above. These may update the in-memory and
   // on-disk states.
@@ -369,6 +402,21 @@ class SnapshotManager {
 
   // If `mode_` is in an error state, `status_` will contain the error status.
   absl::Status status_ TF_GUARDED_BY(mu_);
+
+  // The version manifest. Only set for incremental snapshots.
+  std::optional<experimental::DistributedSnapshotManifest> manifest_
+      TF_GUARDED_BY(mu_);
+  // Fingerprints of the splits materialized by committed versions. Only loaded
+  // when a new version is started or resumed.
+  std::shared_ptr<const absl::flat_hash_set<uint64_t>> materialized_splits_
+      TF_GUARDED_BY(mu_) =
+          std::make_shared<const absl::flat_hash_set<uint64_t>>();
+  // The first stream index of the current version. Streams below it belong to
+  // earlier versions and are not restored or assigned.
+  int64_t first_stream_index_ TF_GUARDED_BY(mu_) = 0;
+  // Fingerprints of the splits assigned to streams of the current version.
+  // Recorded as splits are assigned, and written when the version commits.
+  std::vector<uint64_t> version_fingerprints_ TF_GUARDED_BY(mu_);
 };
 
 }  // namespace data
@@ -14,15 +14,21 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/data/service/snapshot/snapshot_manager.h"
 
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/dispatcher.pb.h"
 #include "tensorflow/core/data/service/snapshot/path_utils.h"
 #include "tensorflow/core/data/service/test_util.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/protobuf/snapshot.pb.h"
 #include "tsl/lib/core/status_test_util.h"
 #include "tsl/platform/env.h"
 #include "tsl/platform/status.h"
@@ -51,6 +57,54 @@ T GetValue(const Tensor& tensor) {
   return tensor.unaligned_flat<T>().data()[0];
 }
 
+// Assigns a stream to `worker_address`, reads all its splits, and reports the
+// stream as completed. Returns the stream index and the split values.
+absl::StatusOr<std::pair<int64_t, std::vector<int64_t>>> WriteStream(
+    SnapshotManager& snapshot_manager, const std::string& worker_address) {
+  WorkerHeartbeatRequest heartbeat_request;
+  WorkerHeartbeatResponse heartbeat_response;
+  heartbeat_request.set_worker_address(worker_address);
+  TF_RETURN_IF_ERROR(
+      snapshot_manager.WorkerHeartbeat(heartbeat_request, heartbeat_response));
+  if (heartbeat_response.snapshot_tasks().size() != 1) {
+    return absl::InternalError("Expected one snapshot task.");
+  }
+  const SnapshotTaskDef snapshot_task = heartbeat_response.snapshot_tasks(0);
+
+  GetSnapshotSplitRequest get_split_request;
+  get_split_request.set_worker_address(worker_address);
+  get_split_request.set_base_path(snapshot_task.base_path());
+  get_split_request.set_stream_index(snapshot_task.stream_index());
+  get_split_request.set_source_index(0);
+  std::vector<int64_t> splits;
+  while (true) {
+    GetSnapshotSplitResponse get_split_response;
+    TF_RETURN_IF_ERROR(snapshot_manager.GetSnapshotSplit(get_split_request,
+                                                         get_split_response));
+    if (get_split_response.end_of_splits()) {
+      break;
+    }
+    Tensor tensor;
+    if (!tensor.FromProto(get_split_response.split())) {
+      return absl::InternalError("Failed to parse split.");
+    }
+    splits.push_back(GetValue<int64_t>(tensor));
+  }
+
+  heartbeat_request.Clear();
+  heartbeat_response.Clear();
+  heartbeat_request.set_worker_address(worker_address);
+  SnapshotTaskProgress progress;
+  *progress.mutable_snapshot_task() = snapshot_task;
+  progress.set_completed(true);
+  (*heartbeat_request.mutable_snapshot_task_progress())[snapshot_task
+                                                            .base_path()] =
+      progress;
+  TF_RETURN_IF_ERROR(
+      snapshot_manager.WorkerHeartbeat(heartbeat_request, heartbeat_response));
+  return std::make_pair(snapshot_task.stream_index(), splits);
+}
+
 TEST(SnapshotManagerTest, CreateStreamAssignment) {
   std::string snapshot_path = testing::LocalTempFilename();
   SnapshotRequest request;
@@ -293,6 +347,88 @@ TEST(SnapshotManagerTest, ResumeFromError) {
   EXPECT_THAT(heartbeat_response.snapshot_tasks(), IsEmpty());
 }
 
+TEST(SnapshotManagerTest, IncrementalSnapshot) {
+  std::string snapshot_path = testing::LocalTempFilename();
+  SnapshotRequest request;
+  *request.mutable_dataset() = testing::RangeDataset(5);
+  request.set_path(snapshot_path);
+  *request.mutable_metadata() =
+      testing::CreateDummyDistributedSnapshotMetadata();
+  request.mutable_metadata()->set_incremental(true);
+
+  SnapshotAssignmentManager snapshot_assignment_manager(
+      /*worker_max_concurrent_snapshots=*/2);
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SnapshotManager> snapshot_manager,
+      SnapshotManager::Start(request, snapshot_assignment_manager,
+                             Env::Default()));
+  EXPECT_THAT(WriteStream(*snapshot_manager, "localhost"),
+              IsOkAndHolds(std::make_pair(
+                  int64_t{0}, std::vector<int64_t>{0, 1, 2, 3, 4})));
+  EXPECT_TRUE(snapshot_manager->IsFinished());
+  TF_EXPECT_OK(Env::Default()->FileExists(SnapshotDoneFilePath(snapshot_path)));
+  snapshot_manager->Cancel();
+
+  // The next version only processes the new splits.
+  *request.mutable_dataset() = testing::RangeDataset(8);
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SnapshotManager> next_version,
+      SnapshotManager::Start(request, snapshot_assignment_manager,
+                             Env::Default()));
+  EXPECT_FALSE(next_version->IsFinished());
+  EXPECT_THAT(
+      Env::Default()->FileExists(SnapshotDoneFilePath(snapshot_path)),
+      StatusIs(error::NOT_FOUND));
+  EXPECT_THAT(WriteStream(*next_version, "localhost"),
+              IsOkAndHolds(std::make_pair(int64_t{1},
+                                          std::vector<int64_t>{5, 6, 7})));
+  EXPECT_TRUE(next_version->IsFinished());
+
+  // Each version writes only the fingerprints of its own splits.
+  experimental::DistributedSnapshotSplitFingerprints fingerprints;
+  TF_ASSERT_OK(tsl::ReadBinaryProto(
+      Env::Default(), MaterializedSplitsFilePath(snapshot_path, 0),
+      &fingerprints));
+  EXPECT_EQ(fingerprints.fingerprints_size(), 5);
+  TF_ASSERT_OK(tsl::ReadBinaryProto(
+      Env::Default(), MaterializedSplitsFilePath(snapshot_path, 1),
+      &fingerprints));
+  EXPECT_EQ(fingerprints.fingerprints_size(), 3);
+
+  // A resumed manager sees the committed version.
+  SnapshotAssignmentManager resumed_assignment_manager(
+      /*worker_max_concurrent_snapshots=*/2);
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SnapshotManager> resumed_manager,
+      SnapshotManager::Resume(snapshot_path, resumed_assignment_manager,
+                              Env::Default()));
+  EXPECT_TRUE(resumed_manager->IsFinished());
+}
+
+TEST(SnapshotManagerTest, ExtendUnfinishedSnapshot) {
+  std::string snapshot_path = testing::LocalTempFilename();
+  SnapshotRequest request;
+  *request.mutable_dataset() = testing::RangeDataset(10);
+  request.set_path(snapshot_path);
+  *request.mutable_metadata() =
+      testing::CreateDummyDistributedSnapshotMetadata();
+
+  SnapshotAssignmentManager snapshot_assignment_manager(
+      /*worker_max_concurrent_snapshots=*/2);
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<SnapshotManager> snapshot_manager,
+      SnapshotManager::Start(request, snapshot_assignment_manager,
+                             Env::Default()));
+  EXPECT_THAT(SnapshotManager::Start(request, snapshot_assignment_manager,
+                                     Env::Default()),
+              StatusIs(error::ALREADY_EXISTS));
+
+  request.mutable_metadata()->set_incremental(true);
+  EXPECT_THAT(SnapshotManager::Start(request, snapshot_assignment_manager,
+                                     Env::Default()),
+              StatusIs(error::FAILED_PRECONDITION));
+}
+
 TEST(SnapshotAssignmentManagerTest, LoadBalanceSnapshots) {
   SnapshotAssignmentManager snapshot_assignment_manager(
       /*worker_max_concurrent_snapshots=*/2);
@@ -0,0 +1,187 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/split_assigner.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/algorithm/container.h"
+#include "absl/status/status.h"
+#include "absl/strings/match.h"
+#include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+LocalitySplitAssigner::LocalitySplitAssigner(int64_t lookahead)
+    : lookahead_(lookahead) {}
+
+void LocalitySplitAssigner::UpdateWorkerLocality(
+    const std::string& worker_address, const WorkerLocality& locality) {
+  mutex_lock l(mu_);
+  WorkerAffinity& affinity = workers_[worker_address];
+  affinity.local_path_prefixes.assign(locality.local_path_prefixes().begin(),
+                                      locality.local_path_prefixes().end());
+  affinity.recent_splits.clear();
+  affinity.recent_splits.insert(locality.recent_splits().begin(),
+                                locality.recent_splits().end());
+}
+
+void LocalitySplitAssigner::RemoveWorker(const std::string& worker_address) {
+  mutex_lock l(mu_);
+  workers_.erase(worker_address);
+}
+
+Status LocalitySplitAssigner::GetNext(
+    int64_t iteration_id, int64_t split_provider_index,
+    const std::string& worker_address, SplitProvider& split_provider,
+    const std::function<Status(bool finished)>& record_split_produced,
+    Tensor& split, bool& end_of_splits) {
+  const SplitProviderKey key(iteration_id, split_provider_index);
+  end_of_splits = false;
+  while (true) {
+    {
+      mutex_lock l(mu_);
+      SplitBuffer& buffer = buffers_[key];
+      if (TakeBufferedSplit(buffer, worker_address, split)) {
+        return absl::OkStatus();
+      }
+      const bool can_pull =
+          !buffer.exhausted &&
+          static_cast<int64_t>(buffer.splits.size()) < lookahead_;
+      if (!can_pull && !buffer.splits.empty()) {
+        // Steals the oldest split buffered for another worker.
+        split = std::move(buffer.splits.front().split);
+        buffer.splits.pop_front();
+        return absl::OkStatus();
+      }
+      if (!can_pull) {
+        buffers_.erase(key);
+        end_of_splits = true;
+      }
+    }
+    // `record_split_produced` and the split provider may block or acquire
+    // other locks, so they are called without holding `mu_`.
+    if (end_of_splits) {
+      return record_split_produced(/*finished=*/true);
+    }
+
+    Tensor next_split;
+    bool provider_end_of_splits = false;
+    TF_RETURN_IF_ERROR(
+        split_provider.GetNext(&next_split, &provider_end_of_splits));
+    if (!provider_end_of_splits) {
+      TF_RETURN_IF_ERROR(record_split_produced(/*finished=*/false));
+    }
+
+    mutex_lock l(mu_);
+    SplitBuffer& buffer = buffers_[key];
+    if (provider_end_of_splits) {
+      buffer.exhausted = true;
+      continue;
+    }
+    std::vector<std::string> preferred_workers = PreferredWorkers(next_split);
+    if (preferred_workers.empty() ||
+        absl::c_linear_search(preferred_workers, worker_address)) {
+      split = std::move(next_split);
+      return absl::OkStatus();
+    }
+    buffer.splits.push_back(
+        BufferedSplit{std::move(next_split), std::move(preferred_workers)});
+  }
+}
+
+void LocalitySplitAssigner::Reset(int64_t iteration_id,
+                                  int64_t split_provider_index) {
+  mutex_lock l(mu_);
+  buffers_.erase(SplitProviderKey(iteration_id, split_provider_index));
+}
+
+void LocalitySplitAssigner::RemoveIteration(int64_t iteration_id) {
+  mutex_lock l(mu_);
+  absl::erase_if(buffers_, [iteration_id](const auto& buffer) {
+    return buffer.first.first == iteration_id;
+  });
+}
+
+int64_t LocalitySplitAssigner::NumBufferedSplits(
+    int64_t iteration_id, int64_t split_provider_index) const {
+  mutex_lock l(mu_);
+  auto it = buffers_.find(SplitProviderKey(iteration_id, split_provider_index));
+  if (it == buffers_.end()) {
+    return 0;
+  }
+  return it->second.splits.size();
+}
+
+bool LocalitySplitAssigner::HasAffinity(const WorkerAffinity& affinity,
+                                        const Tensor& split) {
+  if (split.dtype() != DT_STRING || split.NumElements() != 1) {
+    return false;
+  }
+  const tstring& path = split.flat<tstring>()(0);
+  if (affinity.recent_splits.contains(path)) {
+    return true;
+  }
+  return absl::c_any_of(affinity.local_path_prefixes,
+                        [&path](const std::string& prefix) {
+                          return absl::StartsWith(path, prefix);
+                        });
+}
+
+std::vector<std::string> LocalitySplitAssigner::PreferredWorkers(
+    const Tensor& split) const TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  std::vector<std::string> preferred_workers;
+  for (const auto& [worker_address, affinity] : workers_) {
+    if (HasAffinity(affinity, split)) {
+      preferred_workers.push_back(worker_address);
+    }
+  }
+  return preferred_workers;
+}
+
+bool LocalitySplitAssigner::TakeBufferedSplit(
+    SplitBuffer& buffer, const std::string& worker_address, Tensor& split)
+    TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+  for (auto it = buffer.splits.begin(); it != buffer.splits.end(); ++it) {
+    bool available = true;
+    for (const std::string& preferred_worker : it->preferred_workers) {
+      if (preferred_worker == worker_address) {
+        available = true;
+        break;
+      }
+      if (workers_.contains(preferred_worker)) {
+        available = false;
+      }
+    }
+    if (available) {
+      split = std::move(it->split);
+      buffer.splits.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,142 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_DATA_SERVICE_SPLIT_ASSIGNER_H_
+#define TENSORFLOW_CORE_DATA_SERVICE_SPLIT_ASSIGNER_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Assigns the splits of dynamically sharded iterations to the workers that
+// are likely to read them fastest.
+//
+// Workers report a `WorkerLocality` in their heartbeats: path prefixes they
+// can read from local storage, and splits they read recently and likely still
+// have in their page cache. A string split has affinity to a worker if it
+// starts with one of the worker's local prefixes or is one of its recent
+// splits. Other splits never have affinity.
+//
+// When a worker asks for a split, the assigner first looks for a buffered
+// split with affinity to it. Otherwise, it pulls splits from the split
+// provider, handing out the first split that has affinity to the worker or to
+// no worker at all, and buffering splits that have affinity to other workers.
+// At most `lookahead` splits are buffered per split provider. When the buffer
+// is full or the split provider is exhausted, the worker steals the oldest
+// buffered split, so that load stays balanced even if locality is skewed.
+//
+// Buffered splits are already counted as produced by the split provider, so a
+// dispatcher restart drops them rather than producing them twice. This keeps
+// the at-most-once visitation guarantee of dynamic sharding.
+//
+// This class is thread-safe. `GetNext` calls for the same split provider must
+// be serialized by the caller, since they share the split provider.
+class LocalitySplitAssigner {
+ public:
+  explicit LocalitySplitAssigner(int64_t lookahead);
+  LocalitySplitAssigner(const LocalitySplitAssigner&) = delete;
+  LocalitySplitAssigner& operator=(const LocalitySplitAssigner&) = delete;
+
+  // Records the locality reported by the worker at `worker_address`,
+  // replacing any locality it reported earlier.
+  void UpdateWorkerLocality(const std::string& worker_address,
+                            const WorkerLocality& locality);
+  // Forgets the locality of a worker that is no longer available. Splits
+  // buffered for it become available to any worker.
+  void RemoveWorker(const std::string& worker_address);
+
+  // Gets the next split of the split provider at `split_provider_index` in
+  // the iteration `iteration_id` for the worker at `worker_address`.
+  // `record_split_produced` is called with `finished=false` for each split
+  // pulled from `split_provider`, and with `finished=true` when the split
+  // provider is exhausted and no split is left in the buffer. In the latter
+  // case, `end_of_splits` is set to true.
+  Status GetNext(int64_t iteration_id, int64_t split_provider_index,
+                 const std::string& worker_address,
+                 SplitProvider& split_provider,
+                 const std::function<Status(bool finished)>&
+                     record_split_produced,
+                 Tensor& split, bool& end_of_splits);
+
+  // Drops the splits buffered for the given split provider, e.g. when it is
+  // reset to a new repetition.
+  void Reset(int64_t iteration_id, int64_t split_provider_index);
+  // Drops the splits buffered for all split providers of `iteration_id`.
+  void RemoveIteration(int64_t iteration_id);
+
+  // Returns the number of splits buffered for the given split provider.
+  int64_t NumBufferedSplits(int64_t iteration_id,
+                            int64_t split_provider_index) const;
+
+ private:
+  struct WorkerAffinity {
+    std::vector<std::string> local_path_prefixes;
+    absl::flat_hash_set<std::string> recent_splits;
+  };
+
+  struct BufferedSplit {
+    Tensor split;
+    // Workers which had affinity to the split when it was buffered.
+    std::vector<std::string> preferred_workers;
+  };
+
+  struct SplitBuffer {
+    std::deque<BufferedSplit> splits;
+    // Whether the split provider has no more splits for this repetition.
+    bool exhausted = false;
+  };
+
+  using SplitProviderKey = std::pair<int64_t, int64_t>;
+
+  // Returns whether `split` has affinity to the worker with `affinity`.
+  static bool HasAffinity(const WorkerAffinity& affinity,
+                          const Tensor& split);
+  // Returns the workers that have affinity to `split`.
+  std::vector<std::string> PreferredWorkers(const Tensor& split) const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Removes and returns a buffered split that can go to `worker_address`:
+  // either one it prefers, or one whose preferred workers are all gone.
+  // Returns false if there is no such split.
+  bool TakeBufferedSplit(SplitBuffer& buffer,
+                         const std::string& worker_address, Tensor& split)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  const int64_t lookahead_;
+
+  mutable mutex mu_;
+  absl::flat_hash_map<std::string, WorkerAffinity> workers_
+      TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<SplitProviderKey, SplitBuffer> buffers_
+      TF_GUARDED_BY(mu_);
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_DATA_SERVICE_SPLIT_ASSIGNER_H_
@@ -0,0 +1,214 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/data/service/split_assigner.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/data/split_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/test.h"
+#include "tsl/lib/core/status_test_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr int64_t kIterationId = 1;
+constexpr int64_t kSplitProviderIndex = 0;
+
+// Produces the given file names as scalar string splits.
+class FileSplitProvider : public SplitProvider {
+ public:
+  explicit FileSplitProvider(std::vector<std::string> files)
+      : files_(std::move(files)) {}
+
+  Status GetNext(Tensor* split, bool* end_of_splits) override {
+    if (index_ >= files_.size()) {
+      *end_of_splits = true;
+      return absl::OkStatus();
+    }
+    *split = Tensor(tstring(files_[index_++]));
+    *end_of_splits = false;
+    return absl::OkStatus();
+  }
+  Status Reset() override {
+    index_ = 0;
+    return absl::OkStatus();
+  }
+  Status Save(std::function<std::string(std::string)> full_name,
+              IteratorStateWriter* writer) override {
+    return errors::Unimplemented("Save is not implemented");
+  }
+  Status Restore(std::function<std::string(std::string)> full_name,
+                 IteratorStateReader* reader) override {
+    return errors::Unimplemented("Restore is not implemented");
+  }
+
+ private:
+  const std::vector<std::string> files_;
+  size_t index_ = 0;
+};
+
+WorkerLocality LocalPrefixes(const std::vector<std::string>& prefixes) {
+  WorkerLocality locality;
+  for (const std::string& prefix : prefixes) {
+    locality.add_local_path_prefixes(prefix);
+  }
+  return locality;
+}
+
+class SplitAssignerTest : public ::testing::Test {
+ protected:
+  // Gets the next split for `worker_address`. Returns an empty string at the
+  // end of splits.
+  std::string GetNext(LocalitySplitAssigner& assigner,
+                      SplitProvider& split_provider,
+                      const std::string& worker_address) {
+    Tensor split;
+    bool end_of_splits = false;
+    TF_EXPECT_OK(assigner.GetNext(
+        kIterationId, kSplitProviderIndex, worker_address, split_provider,
+        [this](bool finished) {
+          if (finished) {
+            ++num_finished_;
+          } else {
+            ++num_produced_;
+          }
+          return absl::OkStatus();
+        },
+        split, end_of_splits));
+    if (end_of_splits) {
+      return "";
+    }
+    return std::string(split.scalar<tstring>()());
+  }
+
+  int64_t num_produced_ = 0;
+  int64_t num_finished_ = 0;
+};
+
+TEST_F(SplitAssignerTest, AssignsSplitsByLocalPrefix) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({"/disk_a/"}));
+  assigner.UpdateWorkerLocality("worker_b", LocalPrefixes({"/disk_b/"}));
+  FileSplitProvider split_provider(
+      {"/disk_a/0", "/disk_a/1", "/disk_b/0", "/disk_b/1"});
+
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/disk_b/0");
+  EXPECT_EQ(assigner.NumBufferedSplits(kIterationId, kSplitProviderIndex), 2);
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_a"), "/disk_a/0");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_a"), "/disk_a/1");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/disk_b/1");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_a"), "");
+  EXPECT_EQ(num_produced_, 4);
+  EXPECT_EQ(num_finished_, 1);
+}
+
+TEST_F(SplitAssignerTest, AssignsRecentSplitsToTheSameWorker) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  WorkerLocality locality;
+  locality.add_recent_splits("/data/1");
+  assigner.UpdateWorkerLocality("worker_a", locality);
+  assigner.UpdateWorkerLocality("worker_b", WorkerLocality());
+  FileSplitProvider split_provider({"/data/0", "/data/1", "/data/2"});
+
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/data/0");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/data/2");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_a"), "/data/1");
+}
+
+TEST_F(SplitAssignerTest, StealsWhenBufferIsFull) {
+  LocalitySplitAssigner assigner(/*lookahead=*/2);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({"/disk_a/"}));
+  FileSplitProvider split_provider(
+      {"/disk_a/0", "/disk_a/1", "/disk_a/2", "/other/0"});
+
+  // The buffer fills up before "worker_b" finds a split, so it steals the
+  // oldest buffered split.
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/disk_a/0");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/disk_a/1");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_a"), "/disk_a/2");
+}
+
+TEST_F(SplitAssignerTest, StealsAtEndOfSplits) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({"/disk_a/"}));
+  FileSplitProvider split_provider({"/disk_a/0", "/disk_a/1"});
+
+  std::vector<std::string> splits;
+  for (std::string split = GetNext(assigner, split_provider, "worker_b");
+       !split.empty(); split = GetNext(assigner, split_provider, "worker_b")) {
+    splits.push_back(split);
+  }
+  EXPECT_THAT(splits, ElementsAre("/disk_a/0", "/disk_a/1"));
+  EXPECT_EQ(num_finished_, 1);
+}
+
+TEST_F(SplitAssignerTest, RemovedWorkerReleasesSplits) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({"/disk_a/"}));
+  FileSplitProvider split_provider({"/disk_a/0", "/other/0", "/other/1"});
+
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/other/0");
+  assigner.RemoveWorker("worker_a");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/disk_a/0");
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/other/1");
+}
+
+TEST_F(SplitAssignerTest, ResetDropsBufferedSplits) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({"/disk_a/"}));
+  FileSplitProvider split_provider({"/disk_a/0", "/other/0"});
+
+  EXPECT_EQ(GetNext(assigner, split_provider, "worker_b"), "/other/0");
+  EXPECT_EQ(assigner.NumBufferedSplits(kIterationId, kSplitProviderIndex), 1);
+  assigner.Reset(kIterationId, kSplitProviderIndex);
+  EXPECT_EQ(assigner.NumBufferedSplits(kIterationId, kSplitProviderIndex), 0);
+}
+
+TEST_F(SplitAssignerTest, NonStringSplits) {
+  LocalitySplitAssigner assigner(/*lookahead=*/8);
+  assigner.UpdateWorkerLocality("worker_a", LocalPrefixes({""}));
+  IndexSplitProvider split_provider(/*n=*/3);
+
+  std::vector<int64_t> splits;
+  while (true) {
+    Tensor split;
+    bool end_of_splits = false;
+    TF_ASSERT_OK(assigner.GetNext(
+        kIterationId, kSplitProviderIndex, "worker_b", split_provider,
+        [](bool finished) { return absl::OkStatus(); }, split,
+        end_of_splits));
+    if (end_of_splits) {
+      break;
+    }
+    splits.push_back(split.scalar<int64_t>()());
+  }
+  EXPECT_THAT(splits, ElementsAre(0, 1, 2));
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -44,8 +44,8 @@ Status DataServiceSplitProvider::GetNext(Tensor* split, bool* end_of_splits)
   TF_RETURN_IF_ERROR(grpc_util::Retry(
       [this, split, end_of_splits]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
         return dispatcher_->GetSplit(iteration_id_, repetition_,
-                                     split_provider_index_, *split,
-                                     *end_of_splits);
+                                     split_provider_index_, worker_address_,
+                                     *split, *end_of_splits);
       },
       "get next split",
       /*deadline_micros=*/Env::Default()->NowMicros() +
@@ -57,6 +57,9 @@ Status DataServiceSplitProvider::GetNext(Tensor* split, bool* end_of_splits)
     VLOG(1) << "Requested split: " << split->DebugString()
             << "; with iteration_id=" << iteration_id_
             << ", repetition=" << repetition_;
+    if (split_callback_) {
+      split_callback_(*split);
+    }
   }
   return absl::OkStatus();
 }
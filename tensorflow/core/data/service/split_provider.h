@@ -19,6 +19,7 @@ limitations under the License.
 #include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/data/service/common.pb.h"
@@ -35,14 +36,21 @@ namespace data {
 // SplitProvider which reads splits from a tf.data service dispatcher over RPC.
 class DataServiceSplitProvider : public SplitProvider {
  public:
-  DataServiceSplitProvider(const std::string& address,
-                           const std::string& protocol, int64_t iteration_id,
-                           int64_t split_provider_index, int64_t timeout_ms)
+  // `worker_address` identifies the worker to the dispatcher for
+  // locality-aware split assignment. If set, `split_callback` is called with
+  // every split received from the dispatcher.
+  DataServiceSplitProvider(
+      const std::string& address, const std::string& protocol,
+      int64_t iteration_id, int64_t split_provider_index, int64_t timeout_ms,
+      const std::string& worker_address = "",
+      std::function<void(const Tensor& split)> split_callback = nullptr)
       : address_(address),
         protocol_(protocol),
         iteration_id_(iteration_id),
         split_provider_index_(split_provider_index),
-        timeout_ms_(timeout_ms) {}
+        timeout_ms_(timeout_ms),
+        worker_address_(worker_address),
+        split_callback_(std::move(split_callback)) {}
 
   Status GetNext(Tensor* split, bool* end_of_splits) override;
   Status Reset() override;
@@ -57,6 +65,8 @@ class DataServiceSplitProvider : public SplitProvider {
   const int64_t iteration_id_;
   const int64_t split_provider_index_;
   const int64_t timeout_ms_;
+  const std::string worker_address_;
+  const std::function<void(const Tensor& split)> split_callback_;
 
   mutex mu_;
   int64_t repetition_ TF_GUARDED_BY(mu_) = 0;
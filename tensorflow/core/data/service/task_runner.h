@@ -17,10 +17,13 @@ limitations under the License.
 
 #include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/cross_trainer_cache.h"
+#include "tensorflow/core/data/service/cross_trainer_cache_disk_tier.h"
 #include "tensorflow/core/data/service/data_transfer.h"
 #include "tensorflow/core/data/service/thread_safe_buffer.h"
 #include "tensorflow/core/data/service/worker.pb.h"
@@ -150,11 +153,14 @@ class FirstComeFirstServedTaskRunner : public TaskRunner {
 // and caches elements in a sliding-window `CrossTrainerCache`. The cache has a
 // bounded size and progresses when a trainer that has consumed all elements in
 // the cache. Trainers read from a sliding window of the dataset and may not
-// read the full dataset.
+// read the full dataset. If `disk_tier` is not null, elements evicted from
+// memory are spilled to disk, so trainers lagging behind the in-memory window
+// keep reading the shared elements.
 class CachingTaskRunner : public TaskRunner {
  public:
-  explicit CachingTaskRunner(std::unique_ptr<TaskIterator> iterator,
-                             size_t max_cache_size_bytes);
+  explicit CachingTaskRunner(
+      std::unique_ptr<TaskIterator> iterator, size_t max_cache_size_bytes,
+      std::unique_ptr<CrossTrainerCacheDiskTier> disk_tier = nullptr);
   ~CachingTaskRunner() override;
 
   // Gets the next element from the cross-trainer cache, blocking if the data is
@@ -181,6 +187,13 @@ class CachingTaskRunner : public TaskRunner {
     absl::StatusOr<GetElementResult> GetNext() override;
     size_t GetElementSizeBytes(const GetElementResult& element) const override;
 
+    // Elements are spilled to disk as `GetElementResponse` protos holding the
+    // `CompressedElement` of the components.
+    absl::StatusOr<std::string> SerializeElement(
+        const GetElementResult& element) const override;
+    absl::StatusOr<GetElementResult> DeserializeElement(
+        absl::string_view serialized_element) const override;
+
    private:
     FirstComeFirstServedTaskRunner& fcfs_task_runner_;
   };
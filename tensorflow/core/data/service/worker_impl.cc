@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/worker_impl.h"
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <optional>
 #include <string>
@@ -76,6 +77,9 @@ namespace {
 constexpr absl::Duration kRetryInterval = absl::Seconds(5);
 constexpr absl::Duration kDefaultHeartBeatInterval = absl::Seconds(30);
 constexpr absl::Duration kDefaultDispatcherTimeout = absl::Hours(1);
+// The number of recently received splits the worker reports to the dispatcher
+// as locality hints.
+constexpr size_t kMaxRecentSplits = 64;
 
 using WorkerConfig = experimental::WorkerConfig;
 
@@ -451,7 +455,9 @@ DataServiceWorkerImpl::MakeDatasetIterator(standalone::Dataset& dataset,
     for (int i = 0; i < task_def.num_split_providers(); ++i) {
       split_providers.push_back(std::make_unique<DataServiceSplitProvider>(
           config_.dispatcher_address(), config_.protocol(),
-          task_def.iteration_id(), i, config_.dispatcher_timeout_ms()));
+          task_def.iteration_id(), i, config_.dispatcher_timeout_ms(),
+          worker_address_,
+          [this](const Tensor& split) { RecordRecentSplit(split); }));
     }
     TF_RETURN_IF_ERROR(
         dataset.MakeIterator(std::move(split_providers), &iterator));
@@ -462,6 +468,29 @@ DataServiceWorkerImpl::MakeDatasetIterator(standalone::Dataset& dataset,
                                  task_def.processing_mode_def().DebugString());
 }
 
+void DataServiceWorkerImpl::RecordRecentSplit(const Tensor& split) const
+    TF_LOCKS_EXCLUDED(recent_splits_mu_) {
+  if (split.dtype() != DT_STRING || split.NumElements() != 1) {
+    return;
+  }
+  mutex_lock l(recent_splits_mu_);
+  recent_splits_.push_back(split.flat<tstring>()(0));
+  if (recent_splits_.size() > kMaxRecentSplits) {
+    recent_splits_.pop_front();
+  }
+}
+
+WorkerLocality DataServiceWorkerImpl::GetLocality() const
+    TF_LOCKS_EXCLUDED(recent_splits_mu_) {
+  WorkerLocality locality;
+  *locality.mutable_local_path_prefixes() = config_.local_data_prefixes();
+  mutex_lock l(recent_splits_mu_);
+  for (const std::string& split : recent_splits_) {
+    locality.add_recent_splits(split);
+  }
+  return locality;
+}
+
 void DataServiceWorkerImpl::StopTask(Task& task) TF_LOCKS_EXCLUDED(mu_) {
   {
     mutex_lock l(task.mu);
@@ -666,6 +695,7 @@ WorkerHeartbeatRequest DataServiceWorkerImpl::BuildWorkerHeartbeatRequest()
          snapshot_task_progress});
   }
   *request.mutable_active_tasks() = {active_tasks.begin(), active_tasks.end()};
+  *request.mutable_locality() = GetLocality();
   return request;
 }
 
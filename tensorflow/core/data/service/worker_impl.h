@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_CORE_DATA_SERVICE_WORKER_IMPL_H_
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <string>
 #include <utility>
@@ -171,6 +172,12 @@ class DataServiceWorkerImpl {
   // Creates an iterator for `dataset`.
   absl::StatusOr<std::unique_ptr<standalone::Iterator>> MakeDatasetIterator(
       standalone::Dataset& dataset, const TaskDef& task_def) const;
+  // Records a split received from the dispatcher, so that the dispatcher can
+  // assign the same split to this worker again while it is likely cached.
+  void RecordRecentSplit(const Tensor& split) const
+      TF_LOCKS_EXCLUDED(recent_splits_mu_);
+  // Returns the locality signals to report to the dispatcher.
+  WorkerLocality GetLocality() const TF_LOCKS_EXCLUDED(recent_splits_mu_);
 
   const experimental::WorkerConfig config_;
   // Worker Borg job UID for telemetry. -1 if not supported.
@@ -205,6 +212,11 @@ class DataServiceWorkerImpl {
                       absl::Hash<SnapshotTask>>
       snapshot_writers_ TF_GUARDED_BY(mu_);
 
+  mutable mutex recent_splits_mu_;
+  // Most recently received string splits, oldest first.
+  mutable std::deque<std::string> recent_splits_
+      TF_GUARDED_BY(recent_splits_mu_);
+
   // A thread for notifying the dispatcher when tasks complete.
   std::unique_ptr<Thread> task_completion_thread_;
   // A thread for performing regular heartbeats to the dispatcher.
@@ -26,8 +26,11 @@ limitations under the License.
 
 #include "absl/memory/memory.h"
 #include "absl/status/status.h"
+#include "absl/status/statusor.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/graph.pb.h"
@@ -66,6 +69,28 @@ constexpr const char* const kCurrentCheckpointID = "current_checkpoint_id";
 constexpr const char* const kIndex = "index";
 constexpr const char* const kStartIndex = "start_index";
 
+// Returns the codec that compresses individual records for `compression`, or
+// nullptr if `compression` is handled by `io::RecordWriter` and
+// `io::RecordReader` themselves. Returns InvalidArgument if no codec is
+// registered as `compression`.
+absl::StatusOr<const CompressionCodec*> RecordCodec(
+    const std::string& compression) {
+  if (compression == io::compression::kNone ||
+      compression == io::compression::kGzip ||
+      compression == io::compression::kSnappy ||
+      compression == io::compression::kZlib) {
+    return nullptr;
+  }
+  absl::StatusOr<const CompressionCodec*> codec =
+      CompressionCodecRegistry::Get(compression);
+  if (!codec.ok()) {
+    return errors::InvalidArgument(
+        "Unsupported compression type \"", compression,
+        "\": ", codec.status().message());
+  }
+  return *codec;
+}
+
 std::string ProtoSerializationErrorMessage(const TensorProto& proto,
                                            const std::string& output_file) {
   const auto proto_byte_size = proto.ByteSizeLong();
@@ -141,11 +166,15 @@ TFRecordWriter::TFRecordWriter(const std::string& filename,
     : filename_(filename), compression_type_(compression_type) {}
 
 Status TFRecordWriter::Initialize(tensorflow::Env* env) {
+  TF_ASSIGN_OR_RETURN(record_codec_, RecordCodec(compression_type_));
   TF_RETURN_IF_ERROR(env->NewAppendableFile(filename_, &dest_));
 
   record_writer_ = std::make_unique<io::RecordWriter>(
-      dest_.get(), io::RecordWriterOptions::CreateRecordWriterOptions(
-                       /*compression_type=*/compression_type_));
+      dest_.get(),
+      io::RecordWriterOptions::CreateRecordWriterOptions(
+          /*compression_type=*/record_codec_ != nullptr
+              ? io::compression::kNone
+              : compression_type_));
   return absl::OkStatus();
 }
 
@@ -153,6 +182,18 @@ Status TFRecordWriter::WriteTensors(const std::vector<Tensor>& tensors) {
   for (const auto& tensor : tensors) {
     TensorProto proto;
     tensor.AsProtoTensorContent(&proto);
+    if (record_codec_ != nullptr) {
+      std::string proto_serialized;
+      if (!proto.SerializeToString(&proto_serialized)) {
+        return errors::DataLoss(
+            ProtoSerializationErrorMessage(proto, filename_));
+      }
+      std::string compressed;
+      TF_RETURN_IF_ERROR(
+          record_codec_->Compress(proto_serialized, &compressed));
+      TF_RETURN_IF_ERROR(record_writer_->WriteRecord(compressed));
+      continue;
+    }
 #if defined(TF_CORD_SUPPORT)
     // Creating raw pointer here because std::move() in a releases in OSS TF
     // will result in a smart pointer being moved upon function creation, which
@@ -747,9 +788,11 @@ TFRecordReaderImpl::TFRecordReaderImpl(
       output_buffer_size_(output_buffer_size) {}
 
 Status TFRecordReaderImpl::Initialize(Env* env) {
+  TF_ASSIGN_OR_RETURN(record_codec_, RecordCodec(compression_));
   TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename_, &file_));
   auto options = io::RecordReaderOptions::CreateRecordReaderOptions(
-      /*compression_type=*/compression_);
+      /*compression_type=*/record_codec_ != nullptr ? io::compression::kNone
+                                                    : compression_);
 #if !defined(IS_SLIM_BUILD)
   if (output_buffer_size_.has_value()) {
     options.snappy_options.output_buffer_size = *output_buffer_size_;
@@ -783,7 +826,16 @@ absl::StatusOr<std::vector<Tensor>> TFRecordReaderImpl::GetTensors() {
 
 absl::StatusOr<Tensor> TFRecordReaderImpl::Parse(const tstring& record) {
   TensorProto proto;
-  if (!proto.ParseFromArray(record.data(), record.size())) {
+  if (record_codec_ != nullptr) {
+    std::string uncompressed;
+    TF_RETURN_IF_ERROR(record_codec_->Uncompress(
+        absl::string_view(record.data(), record.size()), &uncompressed));
+    if (!proto.ParseFromString(uncompressed)) {
+      return errors::DataLoss(
+          "Unable to parse tensor from stored proto in file: ", filename_,
+          ", record ", offset_, ". Codec: ", record_codec_->Name());
+    }
+  } else if (!proto.ParseFromArray(record.data(), record.size())) {
     return errors::DataLoss(
         "Unable to parse tensor from stored proto in file: ", filename_,
         ", record ", offset_, ". Serialized proto: ", record);
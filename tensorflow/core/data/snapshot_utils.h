@@ -25,6 +25,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/tensor.h"
@@ -106,6 +107,10 @@ class Writer {
 };
 
 // Writes snapshots with the standard TFRecord file format.
+//
+// Compression types other than those of `io::RecordWriter` (e.g. "ZSTD") are
+// looked up in the `CompressionCodecRegistry`, and each record is compressed
+// individually with the registered codec.
 class TFRecordWriter : public Writer {
  public:
   TFRecordWriter(const std::string& filename,
@@ -124,6 +129,9 @@ class TFRecordWriter : public Writer {
  private:
   const std::string filename_;
   const std::string compression_type_;
+  // Compresses each record if `compression_type_` is not supported by
+  // `io::RecordWriter`.
+  const CompressionCodec* record_codec_ = nullptr;
 
   std::unique_ptr<WritableFile> dest_;
   std::unique_ptr<io::RecordWriter> record_writer_;
@@ -251,7 +259,8 @@ class TFRecordReaderImpl {
   // Constructs a `TFRecordReaderImpl`.
   // `filename` is the file to read from.
   // `compression_type` is the compression method, as defined in
-  // tensorflow/tsl/lib/io/compression.h.
+  // tensorflow/tsl/lib/io/compression.h, or the name of a registered
+  // `CompressionCodec`.
   // `output_buffer_size` specifies the buffer size required by Snappy/Zlib
   // compression algorithms. Ignored if compression is not enabled.
   TFRecordReaderImpl(const std::string& filename, const string& compression,
@@ -282,6 +291,9 @@ class TFRecordReaderImpl {
 
   const string compression_;
   const std::optional<int64_t> output_buffer_size_;
+  // Uncompresses each record if `compression_` is not supported by
+  // `io::RecordReader`.
+  const CompressionCodec* record_codec_ = nullptr;
 };
 
 // Reads snapshots previously written with `TFRecordWriter`.
@@ -15,6 +15,7 @@ limitations under the License.
 #include "tensorflow/core/data/tfdataz_metrics.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -107,6 +108,16 @@ void TfDatazMetricsCollector::RecordGetNextLatency(
   }
 }
 
+void TfDatazMetricsCollector::RecordCrossNumaNodeBytes(int64_t num_bytes) {
+  if (num_bytes > 0) {
+    cross_numa_node_bytes_.fetch_add(num_bytes, std::memory_order_relaxed);
+  }
+}
+
+int64_t TfDatazMetricsCollector::GetCrossNumaNodeBytes() const {
+  return cross_numa_node_bytes_.load(std::memory_order_relaxed);
+}
+
 absl::Duration TfDatazMetricsCollector::GetAverageLatencyForLastOneMinute() {
   return latency_estimator_.GetAverageLatency(
       ApproximateLatencyEstimator::Duration::kMinute);
@@ -15,6 +15,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_TFDATAZ_METRICS_H_
 #define TENSORFLOW_CORE_DATA_TFDATAZ_METRICS_H_
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <optional>
@@ -101,6 +102,14 @@ class TfDatazMetricsCollector {
   // Records `GetNext` call latency.
   void RecordGetNextLatency(int64_t get_next_latency_usec);
 
+  // Records the number of bytes returned by a `GetNext` call that reside on a
+  // different NUMA node than the consumer.
+  void RecordCrossNumaNodeBytes(int64_t num_bytes);
+
+  // Returns the total number of bytes returned by the iterator that resided on
+  // a different NUMA node than the consumer.
+  int64_t GetCrossNumaNodeBytes() const;
+
   // Returns the average `GetNext` latency for past 1 minute.
   absl::Duration GetAverageLatencyForLastOneMinute();
 
@@ -124,6 +133,7 @@ class TfDatazMetricsCollector {
   DatasetBaseIterator* iterator_;  // not owned
   std::shared_ptr<model::Model> model_;
   ApproximateLatencyEstimator latency_estimator_;
+  std::atomic<int64_t> cross_numa_node_bytes_ = 0;
 };
 
 // Thread-safe global registry for the /tfdataz metrics. All callers to
@@ -65,6 +65,14 @@ TEST_F(TfDatazMetricsTest, RecordGetNextLatency) {
                   2.0);
 }
 
+TEST_F(TfDatazMetricsTest, RecordCrossNumaNodeBytes) {
+  EXPECT_EQ(tfdataz_metrics_->GetCrossNumaNodeBytes(), 0);
+  tfdataz_metrics_->RecordCrossNumaNodeBytes(100);
+  tfdataz_metrics_->RecordCrossNumaNodeBytes(0);
+  tfdataz_metrics_->RecordCrossNumaNodeBytes(28);
+  EXPECT_EQ(tfdataz_metrics_->GetCrossNumaNodeBytes(), 128);
+}
+
 TEST_F(TfDatazMetricsTest, GetAverageLatencyForLastOneMinute) {
   tfdataz_metrics_->RecordGetNextLatency(1);
   env_->AdvanceByMicroseconds(k2MinutesInMicros);
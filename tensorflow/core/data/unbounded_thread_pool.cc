@@ -18,12 +18,15 @@ limitations under the License.
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/numa.h"
 #include "tensorflow/core/platform/resource.h"
+#include "tensorflow/core/platform/strcat.h"
 #include "tensorflow/core/platform/unbounded_work_queue.h"
 
 namespace tensorflow {
@@ -61,7 +64,8 @@ class UnboundedThreadPool::LogicalThreadFactory : public ThreadFactory {
   std::unique_ptr<Thread> StartThread(const string& name,
                                       std::function<void()> fn) override {
     auto done = std::make_shared<Notification>();
-    pool_->ScheduleOnWorkQueue(std::move(fn), done);
+    pool_->ScheduleOnWorkQueue(std::move(fn), done,
+                               /*prefer_local_numa_node=*/false);
     return std::make_unique<LogicalThreadWrapper>(std::move(done));
   }
 
@@ -69,6 +73,24 @@ class UnboundedThreadPool::LogicalThreadFactory : public ThreadFactory {
   UnboundedThreadPool* const pool_;  // Not owned.
 };
 
+UnboundedThreadPool::UnboundedThreadPool(Env* env, const string& thread_name,
+                                         const ThreadOptions& thread_options,
+                                         bool numa_aware) {
+  const int num_numa_nodes = numa_aware ? port::NUMANumNodes() : 1;
+  if (num_numa_nodes <= 1) {
+    work_queues_.push_back(
+        std::make_unique<UnboundedWorkQueue>(env, thread_name, thread_options));
+    return;
+  }
+  for (int numa_node = 0; numa_node < num_numa_nodes; ++numa_node) {
+    ThreadOptions numa_thread_options = thread_options;
+    numa_thread_options.numa_node = numa_node;
+    work_queues_.push_back(std::make_unique<UnboundedWorkQueue>(
+        env, strings::StrCat(thread_name, "_numa", numa_node),
+        numa_thread_options));
+  }
+}
+
 std::shared_ptr<ThreadFactory> UnboundedThreadPool::get_thread_factory() {
   return std::make_shared<LogicalThreadFactory>(this);
 }
@@ -78,7 +100,8 @@ void UnboundedThreadPool::Schedule(std::function<void()> fn) {
     tensorflow::ResourceTagger tag(kTFDataResourceTag, "ThreadPool");
     fn();
   };
-  ScheduleOnWorkQueue(std::move(tagged_fn), /*done=*/nullptr);
+  ScheduleOnWorkQueue(std::move(tagged_fn), /*done=*/nullptr,
+                      /*prefer_local_numa_node=*/true);
 }
 
 int UnboundedThreadPool::NumThreads() const { return -1; }
@@ -96,8 +119,22 @@ void WorkQueueFunc(const std::function<void()>& fn,
 }  // namespace
 
 void UnboundedThreadPool::ScheduleOnWorkQueue(
-    std::function<void()> fn, std::shared_ptr<Notification> done) {
-  unbounded_work_queue_.Schedule(
+    std::function<void()> fn, std::shared_ptr<Notification> done,
+    bool prefer_local_numa_node) {
+  size_t index = 0;
+  if (work_queues_.size() > 1) {
+    const int numa_node = prefer_local_numa_node
+                              ? port::NUMAGetThreadNodeAffinity()
+                              : port::kNUMANoAffinity;
+    if (numa_node >= 0 &&
+        static_cast<size_t>(numa_node) < work_queues_.size()) {
+      index = numa_node;
+    } else {
+      index = next_work_queue_.fetch_add(1, std::memory_order_relaxed) %
+              work_queues_.size();
+    }
+  }
+  work_queues_[index]->Schedule(
       std::bind(&WorkQueueFunc, std::move(fn), std::move(done)));
 }
 
@@ -15,6 +15,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 #define TENSORFLOW_CORE_DATA_UNBOUNDED_THREAD_POOL_H_
 
+#include <atomic>
+#include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
@@ -33,13 +35,19 @@ namespace data {
 // potentially large number of "logical" threads onto a smaller number of
 // "physical" threads. The multiplexing is achieved by using an
 // `UnboundedWorkQueue`.
+//
+// If `numa_aware` is true and the host has multiple NUMA nodes, the pool keeps
+// one work queue per NUMA node whose physical threads are pinned to that node.
+// Logical threads are spread round-robin across the nodes. Work passed to
+// `Schedule` runs on the node of the calling thread if that thread is pinned,
+// so that it shares the caller's memory, and round-robin otherwise.
 class UnboundedThreadPool : public thread::ThreadPoolInterface {
  public:
   UnboundedThreadPool(Env* env, const string& thread_name)
-      : unbounded_work_queue_(env, thread_name) {}
+      : UnboundedThreadPool(env, thread_name, ThreadOptions{}) {}
   UnboundedThreadPool(Env* env, const string& thread_name,
-                      const ThreadOptions& thread_options)
-      : unbounded_work_queue_(env, thread_name, thread_options) {}
+                      const ThreadOptions& thread_options,
+                      bool numa_aware = false);
   ~UnboundedThreadPool() override = default;
 
   // Returns an implementation of `ThreadFactory` that can be used to create
@@ -50,14 +58,22 @@ class UnboundedThreadPool : public thread::ThreadPoolInterface {
   int NumThreads() const override;
   int CurrentThreadId() const override;
 
+  // Returns the number of NUMA nodes the physical threads are spread across,
+  // or 1 if the pool is not NUMA-aware.
+  int NumNumaNodes() const { return static_cast<int>(work_queues_.size()); }
+
  private:
   class LogicalThreadFactory;
   class LogicalThreadWrapper;
 
   void ScheduleOnWorkQueue(std::function<void()> fn,
-                           std::shared_ptr<Notification> done);
+                           std::shared_ptr<Notification> done,
+                           bool prefer_local_numa_node);
 
-  UnboundedWorkQueue unbounded_work_queue_;
+  // One work queue per NUMA node, indexed by node, or a single queue if the
+  // pool is not NUMA-aware.
+  std::vector<std::unique_ptr<UnboundedWorkQueue>> work_queues_;
+  std::atomic<uint64_t> next_work_queue_ = 0;
 };
 
 }  // namespace data
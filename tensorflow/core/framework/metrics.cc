@@ -104,6 +104,12 @@ auto* tf_data_bytes_fetched_counter = tsl::monitoring::Counter<0>::New(
     "/tensorflow/data/bytes_fetched",
     "The number of bytes fetched from tf.data Dataset iterator.");
 
+auto* tf_data_cross_numa_node_bytes_fetched_counter =
+    tsl::monitoring::Counter<0>::New(
+        "/tensorflow/data/cross_numa_node_bytes_fetched",
+        "The estimated number of bytes fetched from tf.data Dataset iterator "
+        "that reside on a different NUMA node than the consumer.");
+
 auto* tf_data_elements_counter = tsl::monitoring::Counter<1>::New(
     "/tensorflow/data/elements", "tf.data elements", "name");
 
@@ -530,6 +536,11 @@ void RecordTFDataBytesFetched(int64_t num_bytes) {
   tf_data_bytes_fetched_counter->GetCell()->IncrementBy(num_bytes);
 }
 
+void RecordTFDataCrossNumaNodeBytesFetched(int64_t num_bytes) {
+  tf_data_cross_numa_node_bytes_fetched_counter->GetCell()->IncrementBy(
+      num_bytes);
+}
+
 void RecordTFDataExperiment(const string& name) {
   tf_data_experiment_counter->GetCell(name)->IncrementBy(1);
 }
@@ -81,6 +81,10 @@ monitoring::GaugeCell<std::function<std::string()>>* GetTFDataModelGauge(
 // Records the number of bytes fetched from tf.data.Dataset iterator.
 void RecordTFDataBytesFetched(int64_t num_bytes);
 
+// Records the number of bytes fetched from tf.data.Dataset iterator that
+// reside on a different NUMA node than the consumer.
+void RecordTFDataCrossNumaNodeBytesFetched(int64_t num_bytes);
+
 // Records the number of times a tf.data experiment was applied.
 void RecordTFDataExperiment(const string& name);
 
@@ -22,6 +22,9 @@ limitations under the License.
 #include <memory>
 #include <optional>
 #include <queue>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/time/clock.h"
 #include "tensorflow/core/framework/cancellation.h"
@@ -64,6 +67,16 @@ constexpr double kBufferDownsizeMultipliter = 0.9;
 // Threshold of low buffer watermark before a buffer is a candidate for
 // upsizing.
 constexpr int64_t kBufferLowWatermarkThreshold = 2;
+// The statistics seeded by `Model::WarmStart` count as this many elements of
+// the output node.
+constexpr double kWarmStartNumElements = 100;
+// Seeded statistics of a node are validated once this many elements have been
+// measured. They are discarded if the measured processing time per element
+// differs from the seeded one by more than `kWarmStartMaxDriftRatio` times and
+// by more than `kWarmStartMinDriftNsec`.
+constexpr int64_t kWarmStartValidationElements = 100;
+constexpr double kWarmStartMaxDriftRatio = 2.0;
+constexpr double kWarmStartMinDriftNsec = 1000.0;
 
 constexpr char kDataService[] = "DataService";
 constexpr char kFlatMap[] = "FlatMap";
@@ -229,6 +242,13 @@ std::string RemoveArrayIndices(absl::string_view s) {
   return res;
 }
 
+// Returns true if the parameter only trades memory for the quality of the
+// output (for example the randomness of a shuffle) without affecting the
+// output time of the model.
+inline bool IsRamOnlyParameter(const Parameter& parameter) {
+  return parameter.name == kShuffleBufferSize;
+}
+
 // Returns true if all parameters have reached their max values.
 bool AreAllParametersMax(const Model::ModelParameters& parameters) {
   for (const auto& pair : parameters) {
@@ -786,6 +806,14 @@ class KnownRatio : public Node {
  public:
   KnownRatio(Node::Args args, double ratio) : Node(args), ratio_(ratio) {}
 
+  KnownRatio(Node::Args args, double ratio,
+             std::vector<std::shared_ptr<Parameter>> parameters)
+      : Node(args), ratio_(ratio) {
+    for (auto& parameter : parameters) {
+      parameters_[parameter->name] = std::move(parameter);
+    }
+  }
+
   ~KnownRatio() override {}
 
   double Ratio() const override { return ratio_; }
@@ -793,8 +821,12 @@ class KnownRatio : public Node {
  protected:
   std::shared_ptr<Node> Clone(std::shared_ptr<Node> output) const override
       TF_SHARED_LOCKS_REQUIRED(mu_) {
+    std::vector<std::shared_ptr<Parameter>> parameters;
+    for (auto& pair : parameters_) {
+      parameters.push_back(pair.second);
+    }
     return std::make_shared<KnownRatio>(Args{id_, name_, std::move(output)},
-                                        ratio_);
+                                        ratio_, parameters);
   }
 
   // The input time is the sum of inherited input time and self processing time,
@@ -867,6 +899,15 @@ class KnownRatio : public Node {
         self_processing_time + inputs_processing_time;
   }
 
+  // A synchronous node only buffers elements if it has a shuffle buffer.
+  double MaximumBufferedBytes() const override TF_SHARED_LOCKS_REQUIRED(mu_) {
+    auto* parameter = gtl::FindOrNull(parameters_, kShuffleBufferSize);
+    if (parameter == nullptr) {
+      return 0.0;
+    }
+    return (*parameter)->value * AverageBufferedElementSizeLocked();
+  }
+
   Status ToProto(ModelProto::Node* node_proto) const override {
     TF_RETURN_IF_ERROR(Node::ToProto(node_proto));
     node_proto->set_node_class(NodeClass::KNOWN_RATIO);
@@ -1394,6 +1435,67 @@ class AsyncUnknownRatio : public AsyncRatio {
   }
 };
 
+// Returns the key that identifies an input named `name` of the node with key
+// `parent_key` by its position in the pipeline: the names of the nodes on the
+// path from the output, each with its index among the inputs of its parent
+// that have the same name. Unlike node ids, which are assigned in the order in
+// which iterators are created, the keys are the same across runs of the same
+// pipeline.
+std::string PipelineKey(const std::string& parent_key, const std::string& name,
+                        absl::flat_hash_map<std::string, int64_t>& counts) {
+  return strings::StrCat(parent_key, "/", name, "[", counts[name]++, "]");
+}
+
+// Returns the nodes of `model_proto` by their pipeline key.
+absl::flat_hash_map<std::string, const ModelProto::Node*> ProtoNodesByKey(
+    const ModelProto& model_proto) {
+  absl::flat_hash_map<std::string, const ModelProto::Node*> nodes;
+  auto it = model_proto.nodes().find(model_proto.output());
+  if (it == model_proto.nodes().end()) {
+    return nodes;
+  }
+  absl::flat_hash_map<std::string, int64_t> root_counts;
+  std::deque<std::pair<const ModelProto::Node*, std::string>> queue = {
+      {&it->second, PipelineKey("", it->second.name(), root_counts)}};
+  absl::flat_hash_set<int64_t> visited = {it->first};
+  while (!queue.empty()) {
+    auto [node, key] = std::move(queue.front());
+    queue.pop_front();
+    absl::flat_hash_map<std::string, int64_t> counts;
+    for (int64_t input_id : node->inputs()) {
+      auto input = model_proto.nodes().find(input_id);
+      if (input == model_proto.nodes().end() ||
+          !visited.insert(input_id).second) {
+        continue;
+      }
+      queue.emplace_back(&input->second,
+                         PipelineKey(key, input->second.name(), counts));
+    }
+    nodes[std::move(key)] = node;
+  }
+  return nodes;
+}
+
+// Returns the nodes of the pipeline with output `output` by their pipeline
+// key.
+absl::flat_hash_map<std::string, std::shared_ptr<Node>> NodesByKey(
+    std::shared_ptr<Node> output) {
+  absl::flat_hash_map<std::string, std::shared_ptr<Node>> nodes;
+  absl::flat_hash_map<std::string, int64_t> root_counts;
+  std::deque<std::pair<std::shared_ptr<Node>, std::string>> queue = {
+      {output, PipelineKey("", output->name(), root_counts)}};
+  while (!queue.empty()) {
+    auto [node, key] = std::move(queue.front());
+    queue.pop_front();
+    absl::flat_hash_map<std::string, int64_t> counts;
+    for (const std::shared_ptr<Node>& input : node->inputs()) {
+      queue.emplace_back(input, PipelineKey(key, input->name(), counts));
+    }
+    nodes[std::move(key)] = std::move(node);
+  }
+  return nodes;
+}
+
 }  // namespace
 
 thread_local int64_t Node::work_start_;
@@ -1443,6 +1545,13 @@ std::shared_ptr<Node> MakeKnownRatioNode(Node::Args args, double ratio) {
   return std::make_shared<KnownRatio>(std::move(args), ratio);
 }
 
+std::shared_ptr<Node> MakeKnownRatioNode(
+    Node::Args args, double ratio,
+    std::vector<std::shared_ptr<Parameter>> parameters) {
+  return std::make_shared<KnownRatio>(std::move(args), ratio,
+                                      std::move(parameters));
+}
+
 std::shared_ptr<Node> MakeAsyncKnownRatioNode(
     Node::Args args, double ratio, double memory_ratio,
     std::vector<std::shared_ptr<Parameter>> parameters,
@@ -2221,6 +2330,71 @@ Status Node::FromProtoHelper(ModelProto::Node node_proto,
   return OkStatus();
 }
 
+void Node::WarmStart(const ModelProto::Node& node_proto, double scale) {
+  // Parameter state mutexes must not be acquired while holding `mu_`.
+  std::vector<std::pair<Parameter*, double>> state_values;
+  {
+    mutex_lock l(mu_);
+    for (const auto& parameter_proto : node_proto.parameters()) {
+      auto* parameter = gtl::FindOrNull(parameters_, parameter_proto.name());
+      if (parameter == nullptr || (*parameter)->state == nullptr ||
+          !(*parameter)->state->tunable) {
+        continue;
+      }
+      const double value =
+          std::clamp(std::round(parameter_proto.state_value()),
+                     (*parameter)->min, (*parameter)->max);
+      (*parameter)->value = value;
+      state_values.push_back(std::make_pair(parameter->get(), value));
+    }
+    const int64_t num_elements =
+        std::llround(static_cast<double>(node_proto.num_elements()) * scale);
+    if (num_elements > 0 && num_elements_ == 0) {
+      warm_start_num_elements_ = num_elements;
+      warm_start_processing_time_ = std::llround(
+          static_cast<double>(node_proto.processing_time()) * scale);
+      num_elements_ += warm_start_num_elements_;
+      processing_time_ += warm_start_processing_time_;
+      previous_processing_time_ = 0;
+      UpdateProcessingTimeEma();
+    }
+  }
+  for (auto& [parameter, value] : state_values) {
+    mutex_lock l(*parameter->state->mu);
+    parameter->state->value = value;
+    parameter->state->cond_var->notify_all();
+  }
+}
+
+bool Node::MaybeDiscardWarmStart() {
+  mutex_lock l(mu_);
+  if (warm_start_num_elements_ == 0) {
+    return false;
+  }
+  const int64_t measured_elements = num_elements_ - warm_start_num_elements_;
+  if (measured_elements < kWarmStartValidationElements) {
+    return false;
+  }
+  const double measured =
+      static_cast<double>(processing_time_ - warm_start_processing_time_) /
+      static_cast<double>(measured_elements);
+  const double seeded = static_cast<double>(warm_start_processing_time_) /
+                        static_cast<double>(warm_start_num_elements_);
+  const bool drifted =
+      std::abs(measured - seeded) > kWarmStartMinDriftNsec &&
+      std::max(measured, seeded) >
+          kWarmStartMaxDriftRatio * std::min(measured, seeded);
+  if (drifted) {
+    num_elements_ -= warm_start_num_elements_;
+    processing_time_ -= warm_start_processing_time_;
+    previous_processing_time_ = 0;
+    UpdateProcessingTimeEma();
+  }
+  warm_start_num_elements_ = 0;
+  warm_start_processing_time_ = 0;
+  return drifted;
+}
+
 Status Node::FromProto(ModelProto::Node node_proto,
                        std::shared_ptr<Node> output,
                        std::shared_ptr<Node>* node) {
@@ -2403,6 +2577,10 @@ void Model::Optimize(AutotuneAlgorithm algorithm,
       OptimizeStageBased(snapshot, optimization_params, cancellation_manager,
                          ram_budget_manager);
       break;
+    case AutotuneAlgorithm::RAM_CONSTRAINED:
+      OptimizeRamConstrained(snapshot, optimization_params,
+                             cancellation_manager, ram_budget_manager);
+      break;
     default:
       VLOG(2) << "Autotuning algorithm was not recognized. Aborting "
                  "optimization.";
@@ -2467,7 +2645,15 @@ void Model::RemoveNode(std::shared_ptr<Node> node) {
 
 Model::ModelParameters Model::CollectTunableParameters(
     std::shared_ptr<Node> node) {
-  return node->CollectTunableParameters();
+  // Only `OptimizeRamConstrained` accounts for the memory cost of RAM-only
+  // parameters, so they are hidden from the other algorithms.
+  Model::ModelParameters parameters = node->CollectTunableParameters();
+  parameters.erase(std::remove_if(parameters.begin(), parameters.end(),
+                                  [](const auto& pair) {
+                                    return IsRamOnlyParameter(*pair.second);
+                                  }),
+                   parameters.end());
+  return parameters;
 }
 
 void Model::MaybeSyncStateValuesToValues(std::shared_ptr<Node> snapshot) {
@@ -2580,6 +2766,7 @@ Status Model::OptimizeLoop(AutotuneAlgorithm algorithm,
     if (algorithm == AutotuneAlgorithm::STAGE_BASED) {
       model_input_time = ComputeTargetTimeNsec();
     }
+    DiscardDriftedWarmStart();
     Optimize(algorithm, cpu_budget_func, ram_budget_share, fixed_ram_budget,
              model_input_time, ram_budget_manager, cancellation_manager);
     int64_t end_ms = EnvTime::NowMicros() / EnvTime::kMillisToMicros;
@@ -3130,6 +3317,129 @@ void Model::OptimizeHillClimb(std::shared_ptr<Node> snapshot,
                           should_stop);
 }
 
+void Model::OptimizeRamConstrained(
+    std::shared_ptr<Node> snapshot,
+    const OptimizationParams& optimization_params,
+    CancellationManager* cancellation_manager,
+    RamBudgetManager& ram_budget_manager) {
+  VLOG(2) << "Starting optimization of tunable parameters with RAM-constrained "
+             "optimization.";
+  const double processing_time = TotalProcessingTime(snapshot);
+  const double ram_budget = optimization_params.ram_budget();
+  Model::ModelParameters parameters = snapshot->CollectTunableParameters();
+  if (parameters.empty()) {
+    VLOG(2) << "There are no tunable parameters.";
+    return;
+  }
+  Model::ModelParameters throughput_parameters, ram_only_parameters;
+  for (auto& pair : parameters) {
+    // Initialize the parameter values to minimal before tuning.
+    pair.second->value = pair.second->min;
+    if (IsRamOnlyParameter(*pair.second)) {
+      ram_only_parameters.push_back(pair);
+    } else {
+      throughput_parameters.push_back(pair);
+    }
+  }
+
+  // A parameter will only be incremented if the output latency improvement is
+  // greater than this constant.
+  constexpr double kMinDelta = 1.0L;
+
+  // First, spend the RAM budget on throughput. Each step increments the
+  // parameter that saves the most output time per additional buffered byte,
+  // so that cheap improvements (such as parallelism of nodes with small
+  // elements) are taken before expensive ones.
+  while (!cancellation_manager->IsCancelled()) {
+    const double output_time =
+        OutputTime(snapshot, optimization_params.model_input_time(),
+                   /*gradients=*/nullptr);
+    if (output_time <= processing_time / optimization_params.cpu_budget()) {
+      metrics::RecordTFDataAutotuneStoppingCriteria("output_time");
+      break;
+    }
+    const double buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+    double best_score = 0.0;
+    Parameter* best_parameter = nullptr;
+    bool ram_budget_exceeded = false;
+    for (auto& pair : throughput_parameters) {
+      Parameter* parameter = pair.second.get();
+      if (parameter->value >= parameter->max) {
+        continue;
+      }
+      parameter->value++;
+      const double delta =
+          output_time - OutputTime(snapshot,
+                                   optimization_params.model_input_time(),
+                                   /*gradients=*/nullptr);
+      const double new_buffered_bytes = TotalMaximumBufferedBytes(snapshot);
+      parameter->value--;
+      if (delta <= kMinDelta) {
+        continue;
+      }
+      if (new_buffered_bytes > ram_budget) {
+        ram_budget_exceeded = true;
+        continue;
+      }
+      const double score =
+          delta / (1.0 + std::max(0.0, new_buffered_bytes - buffered_bytes));
+      if (score > best_score) {
+        best_score = score;
+        best_parameter = parameter;
+      }
+    }
+    if (!best_parameter) {
+      if (AreAllParametersMax(throughput_parameters)) {
+        metrics::RecordTFDataAutotuneStoppingCriteria("all_max");
+      } else if (ram_budget_exceeded) {
+        metrics::RecordTFDataAutotuneStoppingCriteria("max_buffered_bytes");
+      } else {
+        metrics::RecordTFDataAutotuneStoppingCriteria("local_maximum_reached");
+      }
+      break;
+    }
+    best_parameter->value++;
+  }
+
+  // Then, grow the RAM-only parameters into equal shares of the RAM budget that
+  // is left. The share a parameter does not use is passed on to the next one.
+  for (size_t i = 0; i < ram_only_parameters.size(); ++i) {
+    if (cancellation_manager->IsCancelled()) {
+      break;
+    }
+    Parameter* parameter = ram_only_parameters[i].second.get();
+    const double base_bytes = TotalMaximumBufferedBytes(snapshot);
+    parameter->value = parameter->max;
+    if (TotalMaximumBufferedBytes(snapshot) <= base_bytes) {
+      // The element size is not known yet, so the memory cost of the
+      // parameter cannot be estimated. Keep its current value.
+      tf_shared_lock l(*parameter->state->mu);
+      parameter->value = parameter->state->value;
+      continue;
+    }
+    const double share = (ram_budget - base_bytes) /
+                         static_cast<double>(ram_only_parameters.size() - i);
+    // Binary search for the largest value whose memory fits into the share.
+    int64_t low = parameter->min;
+    int64_t high = parameter->max;
+    while (low < high) {
+      const int64_t mid = low + (high - low + 1) / 2;
+      parameter->value = mid;
+      if (TotalMaximumBufferedBytes(snapshot) - base_bytes <= share) {
+        low = mid;
+      } else {
+        high = mid - 1;
+      }
+    }
+    parameter->value = low;
+  }
+
+  if (ram_budget_manager.RequestModelAllocation(
+          TotalMaximumBufferedBytes(snapshot))) {
+    UpdateStateValues(&parameters);
+  }
+}
+
 void Model::OptimizeMaxParallelism(
     std::shared_ptr<Node> snapshot,
     const OptimizationParams& optimization_params,
@@ -3197,6 +3507,21 @@ Status Model::ToProto(ModelProto* model_proto) {
   return OkStatus();
 }
 
+Status Model::ToProto(std::shared_ptr<Node> snapshot,
+                      ModelProto* model_proto) {
+  TF_RETURN_IF_ERROR(ModelToProtoHelper(snapshot, model_proto));
+  tf_shared_lock l(mu_);
+  model_proto->set_id_counter(id_counter_);
+  *model_proto->mutable_optimization_params() = optimization_params_;
+  if (dataset_name_.has_value()) {
+    model_proto->set_dataset_name(dataset_name_.value());
+  }
+  tf_shared_lock gap_lock(gap_mu_);
+  *model_proto->mutable_gap_times() = {gap_times_usec_.begin(),
+                                       gap_times_usec_.end()};
+  return OkStatus();
+}
+
 Status Model::FromProto(ModelProto model_proto, std::unique_ptr<Model>* model) {
   std::unique_ptr<Model> restored_model = std::make_unique<Model>();
   mutex_lock l(restored_model->mu_);
@@ -3207,6 +3532,60 @@ Status Model::FromProto(ModelProto model_proto, std::unique_ptr<Model>* model) {
   return OkStatus();
 }
 
+int64_t Model::WarmStart(const ModelProto& model_proto) {
+  std::shared_ptr<Node> output;
+  {
+    tf_shared_lock l(mu_);
+    output = output_;
+  }
+  if (output == nullptr) {
+    return 0;
+  }
+  const absl::flat_hash_map<std::string, const ModelProto::Node*>
+      node_protos = ProtoNodesByKey(model_proto);
+  // Scales the recorded statistics so that the output node counts as
+  // `kWarmStartNumElements` elements. This preserves the ratios between the
+  // number of elements produced by different nodes.
+  double scale = 1.0;
+  auto it = model_proto.nodes().find(model_proto.output());
+  if (it != model_proto.nodes().end() && it->second.num_elements() > 0) {
+    scale = std::min(
+        1.0, kWarmStartNumElements /
+                 static_cast<double>(it->second.num_elements()));
+  }
+  int64_t num_seeded_nodes = 0;
+  for (const auto& [key, node] : NodesByKey(output)) {
+    const ModelProto::Node* const* node_proto =
+        gtl::FindOrNull(node_protos, key);
+    if (node_proto == nullptr) {
+      continue;
+    }
+    node->WarmStart(**node_proto, scale);
+    ++num_seeded_nodes;
+  }
+  return num_seeded_nodes;
+}
+
+void Model::DiscardDriftedWarmStart() {
+  std::shared_ptr<Node> output;
+  {
+    tf_shared_lock l(mu_);
+    output = output_;
+  }
+  if (output == nullptr) {
+    return;
+  }
+  Node::NodeVector nodes = output->CollectNodes(TraversalOrder::BFS, IsAnyNode);
+  nodes.push_back(output);
+  for (const auto& node : nodes) {
+    if (node->MaybeDiscardWarmStart()) {
+      VLOG(1) << "Discarding the warm start statistics of "
+              << node->long_name()
+              << " because they drifted from the measured processing time.";
+    }
+  }
+}
+
 Status Model::Save(const string& fname, std::shared_ptr<Node> snapshot,
                    const OptimizationParams& optimization_params) {
   ModelProto model_proto;
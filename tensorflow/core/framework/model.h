@@ -60,6 +60,7 @@ constexpr int64_t kAutotune = -1;
 constexpr char kParallelism[] = "parallelism";
 constexpr char kBufferSize[] = "buffer_size";
 constexpr char kCycleLength[] = "cycle_length";
+constexpr char kShuffleBufferSize[] = "shuffle_buffer_size";
 constexpr char kDeterministic[] = "deterministic";
 constexpr char kMaxBufferedElements[] = "max_buffered_elements";
 
@@ -641,6 +642,18 @@ class Node {
     estimated_element_size_ = estimated_element_size;
   }
 
+  // Seeds the tunable parameter values and the processing time statistics of
+  // this node from `node_proto`, which was recorded by a previous run of the
+  // same input pipeline. The recorded statistics are scaled by `scale`, so
+  // that measurements of this run quickly outweigh them.
+  void WarmStart(const ModelProto::Node& node_proto, double scale)
+      TF_LOCKS_EXCLUDED(mu_);
+
+  // Once enough elements have been measured since `WarmStart`, compares their
+  // processing time with the seeded statistics. If the two differ too much, the
+  // seeded statistics are removed and this method returns true.
+  bool MaybeDiscardWarmStart() TF_LOCKS_EXCLUDED(mu_);
+
  protected:
   // Used for (incrementally) recording metrics. The class is thread-safe.
   class Metrics {
@@ -856,6 +869,11 @@ class Node {
   int64_t previous_processing_time_ TF_GUARDED_BY(mu_) = 0;
   double processing_time_ema_ TF_GUARDED_BY(mu_) = 0.0;
 
+  // Statistics seeded by `WarmStart` that have not been validated against the
+  // measurements of this run yet.
+  int64_t warm_start_num_elements_ TF_GUARDED_BY(mu_) = 0;
+  int64_t warm_start_processing_time_ TF_GUARDED_BY(mu_) = 0;
+
   // Inputs of this node. These can represent an iterator created from the input
   // dataset but also other input iterators (e.g. created by the user-defined
   // functions of `flat_map` or `interleave`).
@@ -883,6 +901,13 @@ std::shared_ptr<Node> MakeAsyncInterleaveManyNode(
 // input element per output element.
 std::shared_ptr<Node> MakeKnownRatioNode(Node::Args args, double ratio);
 
+// Makes a KnownRatio node with parameters. The only parameter that affects the
+// model is `kShuffleBufferSize`, which determines the maximum buffered bytes of
+// the node but not its output time.
+std::shared_ptr<Node> MakeKnownRatioNode(
+    Node::Args args, double ratio,
+    std::vector<std::shared_ptr<Parameter>> parameters);
+
 // AsyncKnownRatio nodes are the asynchronous version of KnownRate nodes.
 std::shared_ptr<Node> MakeAsyncKnownRatioNode(
     Node::Args args, double ratio, double memory_ratio,
@@ -1008,10 +1033,24 @@ class Model {
   // Produces a proto for this model.
   Status ToProto(ModelProto* model_proto);
 
+  // Like `ToProto`, but serializes the node tree rooted in `snapshot`, a
+  // `Node::Snapshot()` of the output node, instead of the live node tree.
+  // Remains valid after the nodes are removed from the model.
+  Status ToProto(std::shared_ptr<Node> snapshot, ModelProto* model_proto);
+
   // Restores a model from the proto.
   static Status FromProto(ModelProto model_proto,
                           std::unique_ptr<Model>* model);
 
+  // Seeds the tunable parameter values and processing time statistics of the
+  // nodes of this model from `model_proto`, which was recorded by a previous
+  // run of the same input pipeline. Nodes are matched by their name and their
+  // position in the pipeline, not by their ids, which depend on the order in
+  // which iterators are created.
+  // Seeded statistics that drift from the measurements of this run are
+  // discarded by `OptimizeLoop`. Returns the number of seeded nodes.
+  int64_t WarmStart(const ModelProto& model_proto) TF_LOCKS_EXCLUDED(mu_);
+
   // Saves this model with a given snapshot and its optimization parameters to a
   // file. Note that the file directory must already exist.
   Status Save(const string& fname, std::shared_ptr<Node> snapshot,
@@ -1061,6 +1100,10 @@ class Model {
   // increase mutex contention with `GetNext()`.
   void MaybeSyncStateValuesToValues(std::shared_ptr<Node> snapshot);
 
+  // Discards the statistics seeded by `WarmStart` that drifted from the
+  // measurements of this run.
+  void DiscardDriftedWarmStart() TF_LOCKS_EXCLUDED(mu_);
+
   // Downsizes buffers that are too large for all nodes rooted at `snapshot`.
   // Returns true if any buffer is downsized.
   bool DownsizeBuffers(std::shared_ptr<Node> snapshot);
@@ -1131,6 +1174,19 @@ class Model {
                           CancellationManager* cancellation_manager,
                           RamBudgetManager& ram_budget_manager);
 
+  // This optimization jointly tunes all tunable parameters under the RAM
+  // budget. It starts by setting all parameters to their minimum values. It
+  // then repeatedly takes the step that saves the most output time per byte
+  // of additional buffered memory until the projected output time is less
+  // than or equal to the processing time needed to produce an element divided
+  // by CPU budget, or no step fits into the RAM budget. Finally, parameters
+  // that only trade memory for quality (such as shuffle buffer sizes) grow
+  // into an equal share of the remaining RAM budget.
+  void OptimizeRamConstrained(std::shared_ptr<Node> snapshot,
+                              const OptimizationParams& optimization_params,
+                              CancellationManager* cancellation_manager,
+                              RamBudgetManager& ram_budget_manager);
+
   // This is the first part of the stage-based optimization that optimizes
   // tunable parallelism parameters for async interleave many nodes only. We
   // separately optimize async interleave many nodes more aggressively because
@@ -582,6 +582,34 @@ TEST(UnknownTest, Model) {
   EXPECT_EQ(unknown->OutputTime(&input_times, nullptr), 100);
 }
 
+TEST(BufferedBytesTest, KnownRatioShuffleBuffer) {
+  std::shared_ptr<Node> plain_node =
+      model::MakeKnownRatioNode({-1, "Map", nullptr}, /*ratio=*/1);
+  plain_node->record_buffer_event(20, 1);
+  EXPECT_EQ(plain_node->TotalMaximumBufferedBytes(), 0);
+
+  std::shared_ptr<Node> shuffle_node = model::MakeKnownRatioNode(
+      {-1, "Shuffle", nullptr}, /*ratio=*/1,
+      {model::MakeParameter(kShuffleBufferSize,
+                            std::make_shared<SharedState>(
+                                kAutotune, std::make_shared<mutex>(),
+                                std::make_shared<condition_variable>()),
+                            /*min=*/1, /*max=*/100, /*value=*/5)});
+  shuffle_node->record_buffer_event(20, 1);
+  EXPECT_EQ(shuffle_node->TotalMaximumBufferedBytes(), 100);
+  shuffle_node->record_element();
+  shuffle_node->record_bytes_produced(20);
+
+  // The shuffle buffer size does not affect the output time.
+  std::shared_ptr<Node> snapshot = shuffle_node->Snapshot();
+  Model::NodeValues input_times;
+  input_times[kModelInputTimeKey] = 0;
+  const double output_time = snapshot->OutputTime(&input_times, nullptr);
+  snapshot->CollectTunableParameters()[0].second->value = 50;
+  EXPECT_EQ(snapshot->OutputTime(&input_times, nullptr), output_time);
+  EXPECT_EQ(snapshot->TotalMaximumBufferedBytes(), 1000);
+}
+
 TEST(BufferedBytesTest, Node) {
   std::shared_ptr<Node> node = model::MakeAsyncInterleaveManyNode(
       {-1, "TestNode", nullptr},
@@ -3695,6 +3723,123 @@ TEST(NodeTest, TotalMaximumBufferedBytesNoValueWhenElementSizeNotProvided) {
   EXPECT_EQ(root->TotalMaximumBufferedBytes(), 0.);
 }
 
+// Returns the proto of a node named "parallel_map" that produced 1000 elements
+// in `processing_time` nanoseconds with a tuned parallelism of 8.
+ModelProto::Node WarmStartNodeProto(int64_t processing_time) {
+  ModelProto::Node node_proto;
+  node_proto.set_id(1);
+  node_proto.set_name("parallel_map");
+  node_proto.set_num_elements(1000);
+  node_proto.set_processing_time(processing_time);
+  auto* parameter_proto = node_proto.add_parameters();
+  parameter_proto->set_name("parallelism");
+  parameter_proto->set_value(8);
+  parameter_proto->set_state_value(8);
+  parameter_proto->set_tunable(true);
+  return node_proto;
+}
+
+class WarmStartTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    parallelism_ = std::make_shared<SharedState>(
+        kAutotune, std::make_shared<mutex>(),
+        std::make_shared<condition_variable>());
+    node_ = MakeAsyncKnownRatioNode(
+        {1, "parallel_map", nullptr}, /*ratio=*/1,
+        {MakeParameter("parallelism", parallelism_, /*min=*/1, /*max=*/4)});
+  }
+
+  void RecordElements(int64_t num_elements, int64_t processing_time) {
+    for (int64_t i = 0; i < num_elements; ++i) {
+      node_->add_processing_time(processing_time);
+      node_->record_element();
+    }
+  }
+
+  std::shared_ptr<SharedState> parallelism_;
+  std::shared_ptr<Node> node_;
+};
+
+TEST_F(WarmStartTest, SeedsParametersAndStatistics) {
+  node_->WarmStart(WarmStartNodeProto(/*processing_time=*/1000 * 5000),
+                   /*scale=*/0.1);
+  // The tuned value is clamped to the range of the parameter.
+  EXPECT_EQ(parallelism_->value, 4);
+  EXPECT_EQ(node_->num_elements(), 100);
+  EXPECT_EQ(node_->processing_time(), 100 * 5000);
+}
+
+TEST_F(WarmStartTest, KeepsConsistentStatistics) {
+  node_->WarmStart(WarmStartNodeProto(/*processing_time=*/1000 * 5000),
+                   /*scale=*/0.1);
+  RecordElements(/*num_elements=*/50, /*processing_time=*/6000);
+  // Not enough elements have been measured to validate the statistics.
+  EXPECT_FALSE(node_->MaybeDiscardWarmStart());
+  RecordElements(/*num_elements=*/50, /*processing_time=*/6000);
+  EXPECT_FALSE(node_->MaybeDiscardWarmStart());
+  EXPECT_EQ(node_->num_elements(), 200);
+  EXPECT_EQ(node_->processing_time(), 100 * 5000 + 100 * 6000);
+}
+
+TEST_F(WarmStartTest, DiscardsDriftedStatistics) {
+  node_->WarmStart(WarmStartNodeProto(/*processing_time=*/1000 * 5000),
+                   /*scale=*/0.1);
+  RecordElements(/*num_elements=*/100, /*processing_time=*/50000);
+  EXPECT_TRUE(node_->MaybeDiscardWarmStart());
+  EXPECT_EQ(node_->num_elements(), 100);
+  EXPECT_EQ(node_->processing_time(), 100 * 50000);
+  // The seeded statistics are only validated once.
+  EXPECT_FALSE(node_->MaybeDiscardWarmStart());
+}
+
+TEST_F(WarmStartTest, DoesNotSeedStatisticsOfActiveNode) {
+  RecordElements(/*num_elements=*/10, /*processing_time=*/6000);
+  node_->WarmStart(WarmStartNodeProto(/*processing_time=*/1000 * 5000),
+                   /*scale=*/0.1);
+  EXPECT_EQ(parallelism_->value, 4);
+  EXPECT_EQ(node_->num_elements(), 10);
+  EXPECT_FALSE(node_->MaybeDiscardWarmStart());
+}
+
+TEST(ModelWarmStartTest, MatchesNodesByPosition) {
+  Model model;
+  std::shared_ptr<Node> root = MakeUnknownNode({0, "unknown0", nullptr});
+  model.AddNode([&root](Node::Args args) { return root; }, root->name(),
+                nullptr, &root);
+  auto parallelism = std::make_shared<SharedState>(
+      kAutotune, std::make_shared<mutex>(),
+      std::make_shared<condition_variable>());
+  std::shared_ptr<Node> parallel_map = MakeAsyncKnownRatioNode(
+      {1, "parallel_map", root}, /*ratio=*/1,
+      {MakeParameter("parallelism", parallelism, /*min=*/1, /*max=*/16)});
+  model.AddNode([&parallel_map](Node::Args args) { return parallel_map; },
+                parallel_map->name(), root, &parallel_map);
+
+  // The previous run created its iterators in a different order, so the ids
+  // of the nodes differ.
+  ModelProto model_proto;
+  model_proto.set_output(10);
+  ModelProto::Node& root_proto = (*model_proto.mutable_nodes())[10];
+  root_proto.set_id(10);
+  root_proto.set_name("unknown0");
+  root_proto.set_num_elements(1000);
+  root_proto.set_processing_time(1000 * 100);
+  root_proto.add_inputs(12);
+  ModelProto::Node& parallel_map_proto = (*model_proto.mutable_nodes())[12];
+  parallel_map_proto = WarmStartNodeProto(/*processing_time=*/1000 * 5000);
+  parallel_map_proto.set_id(12);
+  // Not part of the pipeline.
+  ModelProto::Node& unknown_proto = (*model_proto.mutable_nodes())[1];
+  unknown_proto.set_id(1);
+  unknown_proto.set_name("parallel_map");
+
+  EXPECT_EQ(model.WarmStart(model_proto), 2);
+  EXPECT_EQ(parallelism->value, 8);
+  EXPECT_EQ(root->num_elements(), 100);
+  EXPECT_EQ(parallel_map->num_elements(), 100);
+}
+
 }  // namespace
 }  // namespace model
 }  // namespace data
@@ -761,7 +761,13 @@ Status OpKernelContext::allocate_output(StringPiece name,
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
-  Allocator* a = get_allocator(attr);
+  return allocate_tensor(get_allocator(attr), type, shape, out_tensor,
+                         allocation_attr);
+}
+
+Status OpKernelContext::allocate_tensor(
+    Allocator* a, DataType type, const TensorShape& shape, Tensor* out_tensor,
+    const AllocationAttributes& allocation_attr) {
   Tensor new_tensor(
       a, type, shape,
       AllocationAttributes(
@@ -819,8 +825,16 @@ Status OpKernelContext::allocate_output(int index, const TensorShape& shape,
   profiler::ScopedMemoryDebugAnnotation op_annotation(
       op_kernel().name_view().data(), step_id(), "output", type,
       [&shape]() { return shape.DebugString(); });
+  Allocator* planned = nullptr;
+  if (params_->planned_output_allocators != nullptr && attr.value == 0 &&
+      attr.scope_id == 0 && !track_allocations()) {
+    planned = params_->planned_output_allocators[index];
+  }
   auto output_tensor = std::make_unique<Tensor>();
-  Status s = allocate_tensor(type, shape, output_tensor.get(), attr);
+  Status s = planned != nullptr
+                 ? allocate_tensor(planned, type, shape, output_tensor.get(),
+                                   AllocationAttributes())
+                 : allocate_tensor(type, shape, output_tensor.get(), attr);
   if (s.ok()) {
     outputs_[index] = TensorValue(output_tensor.release());
     *output = outputs_[index].tensor;
@@ -850,8 +864,21 @@ Status OpKernelContext::allocate_temp(
   profiler::ScopedMemoryDebugAnnotation op_annotation(
       op_kernel().name_view().data(), step_id(), "temp", type,
       [&shape]() { return shape.DebugString(); });
+  Allocator* step_arena = params_->step_arena_allocator;
+  if (step_arena != nullptr &&
+      (allocator_attr.value != 0 || allocation_attr.freed_by_func != nullptr ||
+       track_allocations() || !DataTypeCanUseMemcpy(type))) {
+    step_arena = nullptr;
+  }
   Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+      step_arena != nullptr
+          ? allocate_tensor(step_arena, type, shape, out_temp, allocation_attr)
+          : allocate_tensor(type, shape, out_temp, allocator_attr,
+                            allocation_attr);
+  if (step_arena != nullptr && s.ok() && out_temp->TotalBytes() > 0) {
+    step_arena_temps_.emplace_back(out_temp->tensor_data().data(),
+                                   out_temp->TotalBytes());
+  }
   if (track_allocations() && s.ok() && out_temp->TotalBytes() > 0) {
     Allocator* a = get_allocator(allocator_attr);
     if (a->TracksAllocationSizes()) {
@@ -952,6 +979,17 @@ bool OpKernelContext::maybe_set_output_by_allocate_and_copy(
             << " params_->forward_from_array[index] "
             << params_->forward_from_array[index] << " alloc_attr.scope_id "
             << output_alloc_attr(index).scope_id;
+  } else if (TF_PREDICT_FALSE(!step_arena_temps_.empty()) &&
+             is_step_arena_temp(tensor)) {
+    // The step arena is reset at the end of the step, but outputs may be kept
+    // for longer.
+    VLOG(2) << "OpKernelContext set_output index " << index
+            << " copying a step arena temporary of "
+            << params_->op_kernel->name();
+    allocate_and_copy = true;
+  }
+
+  if (TF_PREDICT_FALSE(allocate_and_copy)) {
     profiler::ScopedMemoryDebugAnnotation op_annotation(
         op_kernel().name_view().data(), step_id(), "output", tensor.dtype(),
         [&tensor]() { return tensor.shape().DebugString(); });
@@ -966,6 +1004,19 @@ bool OpKernelContext::maybe_set_output_by_allocate_and_copy(
   return allocate_and_copy;
 }
 
+bool OpKernelContext::is_step_arena_temp(const Tensor& tensor) const {
+  if (tensor.TotalBytes() == 0) {
+    return false;
+  }
+  const char* data = tensor.tensor_data().data();
+  for (const auto& [temp_data, temp_bytes] : step_arena_temps_) {
+    if (data >= temp_data && data < temp_data + temp_bytes) {
+      return true;
+    }
+  }
+  return false;
+}
+
 void OpKernelContext::maybe_track_allocations_for_set_output(
     const Tensor& tensor) {
   if (TF_PREDICT_FALSE(track_allocations()) && tensor.TotalBytes() > 0) {
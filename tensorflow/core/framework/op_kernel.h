@@ -621,6 +621,17 @@ class OpKernelContext {
     bool track_allocations = false;
     bool log_memory = false;
 
+    // If not null, `allocate_temp` allocates small temporaries with default
+    // attributes from this allocator, which is reset at the end of the step.
+    // A tensor allocated this way and passed to `set_output` is copied into a
+    // regular allocation, so that only the kernel itself can hold on to it.
+    Allocator* step_arena_allocator = nullptr;
+
+    // If not null, array indexed by output number of allocators to use for
+    // the outputs of this node that are allocated with default attributes.
+    // Null entries use the regular allocator.
+    Allocator* const* planned_output_allocators = nullptr;
+
     // Array indexed by output number for this node
     const AllocatorAttributes* output_attr_array = nullptr;
 
@@ -1282,11 +1293,19 @@ class OpKernelContext {
                          Tensor* out_tensor, AllocatorAttributes allocator_attr,
                          const AllocationAttributes& allocation_attr);
 
+  Status allocate_tensor(Allocator* a, DataType type, const TensorShape& shape,
+                         Tensor* out_tensor,
+                         const AllocationAttributes& allocation_attr);
+
   // Helpers for `set_output()`.
 
   // Returns `true` if the tensor was copied into an allocated output.
   bool maybe_set_output_by_allocate_and_copy(int index, const Tensor& tensor);
 
+  // Returns true if `tensor` shares a buffer allocated by `allocate_temp` from
+  // `params_->step_arena_allocator`.
+  bool is_step_arena_temp(const Tensor& tensor) const;
+
   void maybe_track_allocations_for_set_output(const Tensor& tensor);
 
   Status get_input_index(StringPiece name, int* out_index) const;
@@ -1305,6 +1324,9 @@ class OpKernelContext {
   // TODO(ayushd): change to absl::flat_hash_set.
   std::unique_ptr<std::unordered_set<int32>> allocated_scope_ids_;
 
+  // Buffers of the temporaries allocated from the step arena, as (data, size).
+  std::vector<std::pair<const char*, size_t>> step_arena_temps_;
+
   // The following data members are only used when allocation tracking is
   // enabled, memory consumption is being recorded, or tensor access is being
   // recorded.
@@ -14,9 +14,11 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_dataset_ops.h"
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <utility>
@@ -68,8 +70,15 @@ constexpr char kMemoryDatasetPrefix[] = "Memory";
 constexpr char kMemoryCache[] = "MemoryCache";
 constexpr char kCacheCompleted[] = "cache_completed";
 constexpr char kIndex[] = "index";
+constexpr char kFollowing[] = "following";
+constexpr char kPassThrough[] = "pass_through";
+constexpr char kRecomputing[] = "recomputing";
 constexpr char kImpl[] = "Impl";
 constexpr char kCacheDataset[] = "CacheDataset";
+// How long a reader following the writer of a memory cache waits for an
+// element before computing the element itself. The writer may be consumed by
+// the same thread as the reader, in which case it never publishes the element.
+constexpr int64_t kFollowerTimeoutUs = 100 * 1000;
 constexpr char kIncompleteCacheErrorMessage[] =
     "The calling iterator did not fully read the dataset being cached. In "
     "order to avoid unexpected truncation of the dataset, the partially cached "
@@ -851,7 +860,7 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
 
     Status Initialize(IteratorContext* ctx) override {
       mutex_lock l(mu_);
-      return InitializeIterator(ctx);
+      return InitializeIterator(ctx, /*restoring_writer=*/false);
     }
 
     Status GetNextInternal(IteratorContext* ctx,
@@ -875,10 +884,13 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     Status SaveInternal(SerializationContext* ctx,
                         IteratorStateWriter* writer) override {
       mutex_lock l(mu_);
-      if (cache_->IsCompleted()) {
+      std::shared_ptr<const MemoryCache::Storage> storage = cache_->storage();
+      if (storage->completed()) {
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kCacheCompleted, ""));
         TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, prefix(), cache_->data()));
+            WriteElementsToCheckpoint(writer, prefix(), storage->elements()));
+      } else if (reading_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kFollowing, ""));
       }
       return SaveInput(ctx, writer, iterator_);
     }
@@ -897,21 +909,35 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
             ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
         cache_->Complete(std::move(temp_cache));
       }
-      TF_RETURN_IF_ERROR(InitializeIterator(ctx));
+      if (reader->Contains(prefix(), kFollowing)) {
+        TF_RETURN_IF_ERROR(InitializeReader(ctx));
+      } else {
+        TF_RETURN_IF_ERROR(InitializeIterator(ctx, /*restoring_writer=*/true));
+      }
       return RestoreInput(ctx, reader, iterator_);
     }
 
    private:
+    // Passes through the input elements and appends them to the cache. If the
+    // writer cannot fill the cache, e.g. because another iterator is filling
+    // it or the cache does not fit into the memory budget, it only passes
+    // through the input elements.
     class MemoryWriterIterator : public DatasetIterator<MemoryDatasetBase> {
      public:
-      explicit MemoryWriterIterator(const Params& params, MemoryCache* cache)
-          : DatasetIterator<MemoryDatasetBase>(params), cache_(cache) {}
+      explicit MemoryWriterIterator(
+          const Params& params, MemoryCache* cache,
+          std::shared_ptr<MemoryCache::Storage> storage)
+          : DatasetIterator<MemoryDatasetBase>(params),
+            cache_(cache),
+            storage_(std::move(storage)) {}
 
       ~MemoryWriterIterator() override {
         mutex_lock l(mu_);
-        if (!temp_cache_.empty() && !cache_->IsCompleted()) {
-          LOG(WARNING) << kIncompleteCacheErrorMessage;
-          cache_->Reset();
+        if (storage_ && !storage_->completed()) {
+          if (storage_->size() > 0) {
+            LOG(WARNING) << kIncompleteCacheErrorMessage;
+          }
+          cache_->Abandon(storage_.get());
         }
       }
 
@@ -926,19 +952,24 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(
             input_impl_->GetNext(ctx, out_tensors, end_of_sequence));
+        if (!storage_ || storage_->completed()) {
+          return absl::OkStatus();
+        }
         if (*end_of_sequence) {
-          if (!cache_->IsCompleted()) {
-            VLOG(2) << "Finalizing the cache because EOF has been reached.";
-            cache_->Complete(std::move(temp_cache_));
-          }
+          VLOG(2) << "Finalizing the cache because EOF has been reached.";
+          cache_->Complete(storage_.get());
           return absl::OkStatus();
         }
         RecordBufferEnqueue(ctx, *out_tensors);
-        temp_cache_.emplace_back(*out_tensors);
-        if (temp_cache_.size() == dataset()->input_->Cardinality()) {
+        if (!cache_->Append(storage_.get(),
+                            std::vector<Tensor>(*out_tensors))) {
+          storage_.reset();
+          return absl::OkStatus();
+        }
+        if (storage_->size() == dataset()->input_->Cardinality()) {
           VLOG(2) << "Finalizing the cache because its size matches the "
                      "expected input cardinality.";
-          cache_->Complete(std::move(temp_cache_));
+          cache_->Complete(storage_.get());
         }
         return absl::OkStatus();
       }
@@ -953,9 +984,11 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       Status SaveInternal(SerializationContext* ctx,
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
-        if (!cache_->IsCompleted()) {
-          TF_RETURN_IF_ERROR(
-              WriteElementsToCheckpoint(writer, prefix(), temp_cache_));
+        if (!storage_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kPassThrough, ""));
+        } else if (!storage_->completed()) {
+          TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(writer, prefix(),
+                                                       storage_->elements()));
         }
         return SaveInput(ctx, writer, input_impl_);
       }
@@ -963,9 +996,23 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
       Status RestoreInternal(IteratorContext* ctx,
                              IteratorStateReader* reader) override {
         mutex_lock l(mu_);
-        if (!reader->Contains(prefix(), kCacheCompleted)) {
+        if (reader->Contains(prefix(), kPassThrough)) {
+          if (storage_) {
+            cache_->Abandon(storage_.get());
+            storage_.reset();
+          }
+        } else if (!reader->Contains(prefix(), kCacheCompleted)) {
+          std::vector<std::vector<Tensor>> temp_cache;
           TF_RETURN_IF_ERROR(
-              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache_));
+              ReadElementsFromCheckpoint(ctx, reader, prefix(), &temp_cache));
+          if (storage_) {
+            for (auto& element : temp_cache) {
+              if (!cache_->Append(storage_.get(), std::move(element))) {
+                storage_.reset();
+                break;
+              }
+            }
+          }
         }
         return RestoreInput(ctx, reader, input_impl_);
       }
@@ -973,15 +1020,23 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
      private:
       mutex mu_;
       std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
-      MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
-      std::vector<std::vector<Tensor>> temp_cache_ TF_GUARDED_BY(mu_);
+      MemoryCache* const cache_;  // not owned.
+      // The storage filled by this iterator, or nullptr if the iterator only
+      // passes through the input elements.
+      std::shared_ptr<MemoryCache::Storage> storage_ TF_GUARDED_BY(mu_);
     };  // MemoryWriterIterator
 
+    // Reads elements from the cache. If the cache is being filled by a
+    // concurrent `MemoryWriterIterator`, the reader follows the writer and
+    // waits for elements to be published. If the writer stops filling the
+    // cache or does not publish an element in time, the reader recomputes the
+    // remaining elements from the input.
     class MemoryReaderIterator : public DatasetIterator<MemoryDatasetBase> {
      public:
       explicit MemoryReaderIterator(const Params& params, MemoryCache* cache)
           : DatasetIterator<MemoryDatasetBase>(params),
             cache_(cache),
+            storage_(cache->storage()),
             index_(0) {}
 
       Status Initialize(IteratorContext* ctx) override {
@@ -991,8 +1046,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         // is that this is incorrect if there are concurrent instances of this
         // iterator.
         tf_shared_lock l(mu_);
-        for (size_t i = 0; i < cache_->size(); ++i) {
-          RecordBufferEnqueue(ctx, cache_->at(i));
+        for (int64_t i = 0; i < storage_->size(); ++i) {
+          RecordBufferEnqueue(ctx, storage_->at(i));
         }
         return absl::OkStatus();
       }
@@ -1001,17 +1056,45 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                              std::vector<Tensor>* out_tensors,
                              bool* end_of_sequence) override {
         mutex_lock l(mu_);
-        if (index_ < cache_->size()) {
-          const std::vector<Tensor>& cache_tensors = cache_->at(index_);
-          out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
-                              cache_tensors.end());
-          index_++;
-          *end_of_sequence = false;
-          return absl::OkStatus();
-        } else {
-          *end_of_sequence = true;
-          return absl::OkStatus();
+        if (input_impl_) {
+          return input_impl_->GetNext(ctx, out_tensors, end_of_sequence);
+        }
+        switch (cache_->WaitForElement(storage_.get(), index_,
+                                       kFollowerTimeoutUs,
+                                       ctx->cancellation_manager())) {
+          case MemoryCache::WaitResult::kAvailable: {
+            const std::vector<Tensor>& cache_tensors = storage_->at(index_);
+            out_tensors->insert(out_tensors->begin(), cache_tensors.begin(),
+                                cache_tensors.end());
+            index_++;
+            *end_of_sequence = false;
+            return absl::OkStatus();
+          }
+          case MemoryCache::WaitResult::kEndOfSequence:
+            *end_of_sequence = true;
+            return absl::OkStatus();
+          case MemoryCache::WaitResult::kCancelled:
+            return errors::Cancelled("Iterator was cancelled");
+          case MemoryCache::WaitResult::kAbandoned:
+          case MemoryCache::WaitResult::kTimedOut:
+            break;
         }
+        VLOG(2) << "Recomputing the input because the cache is not filled.";
+        TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+            ctx, this, strings::StrCat(prefix(), kImpl), &input_impl_));
+        for (int64_t skipped = 0; skipped < index_;) {
+          int num_skipped;
+          TF_RETURN_IF_ERROR(input_impl_->Skip(
+              ctx,
+              static_cast<int>(std::min<int64_t>(
+                  index_ - skipped, std::numeric_limits<int>::max())),
+              end_of_sequence, &num_skipped));
+          if (*end_of_sequence) {
+            return absl::OkStatus();
+          }
+          skipped += num_skipped;
+        }
+        return input_impl_->GetNext(ctx, out_tensors, end_of_sequence);
       }
 
      protected:
@@ -1025,6 +1108,10 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
                           IteratorStateWriter* writer) override {
         mutex_lock l(mu_);
         TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kIndex, index_));
+        if (input_impl_) {
+          TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kRecomputing, ""));
+          TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+        }
         return absl::OkStatus();
       }
 
@@ -1034,34 +1121,57 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
         {
           // kIndex will not be set if we are restoring from a checkpoint
           // written by a MemoryWriterIterator that has completed its cache.
-          int64_t temp = cache_->size();
+          int64_t temp = storage_->size();
           if (reader->Contains(prefix(), kIndex)) {
             TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kIndex, &temp));
           }
-          index_ = static_cast<size_t>(temp);
+          index_ = temp;
+        }
+        if (reader->Contains(prefix(), kRecomputing)) {
+          TF_RETURN_IF_ERROR(dataset()->input_->MakeIterator(
+              ctx, this, strings::StrCat(prefix(), kImpl), &input_impl_));
+          TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
         }
         return absl::OkStatus();
       }
 
      private:
       mutex mu_;
-      MemoryCache* const cache_ TF_GUARDED_BY(mu_);  // not owned.
-      size_t index_ TF_GUARDED_BY(mu_);
+      MemoryCache* const cache_;  // not owned.
+      // Elements are read from a snapshot of the cache storage, which stays
+      // valid if the cache is reset or evicted.
+      const std::shared_ptr<const MemoryCache::Storage> storage_;
+      int64_t index_ TF_GUARDED_BY(mu_);
+      // Set when the elements are recomputed from the input.
+      std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
     };  // MemoryReaderIterator
 
-    Status InitializeIterator(IteratorContext* ctx)
+    Status InitializeIterator(IteratorContext* ctx, bool restoring_writer)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       if (cache_->IsCompleted()) {
-        iterator_ = std::make_unique<MemoryReaderIterator>(
-            MemoryReaderIterator::Params{dataset(),
-                                         strings::StrCat(prefix(), kImpl)},
-            cache_);
-      } else {
-        iterator_ = std::make_unique<MemoryWriterIterator>(
-            MemoryWriterIterator::Params{dataset(),
-                                         strings::StrCat(prefix(), kImpl)},
-            cache_);
+        return InitializeReader(ctx);
+      }
+      std::shared_ptr<MemoryCache::Storage> storage = cache_->AcquireWriter();
+      if (!storage && !restoring_writer) {
+        // Another iterator is filling the cache.
+        return InitializeReader(ctx);
       }
+      reading_ = false;
+      iterator_ = std::make_unique<MemoryWriterIterator>(
+          MemoryWriterIterator::Params{dataset(),
+                                       strings::StrCat(prefix(), kImpl)},
+          cache_, std::move(storage));
+      TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
+      return iterator_->Initialize(ctx);
+    }
+
+    Status InitializeReader(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      reading_ = true;
+      iterator_ = std::make_unique<MemoryReaderIterator>(
+          MemoryReaderIterator::Params{dataset(),
+                                       strings::StrCat(prefix(), kImpl)},
+          cache_);
       TF_RETURN_IF_ERROR(iterator_->InitializeBase(ctx, this));
       return iterator_->Initialize(ctx);
     }
@@ -1069,6 +1179,8 @@ class CacheDatasetOp::MemoryDatasetBase : public DatasetBase {
     mutex mu_;
     MemoryCache* cache_ TF_GUARDED_BY(mu_);  // not owned.
     std::unique_ptr<IteratorBase> iterator_ TF_GUARDED_BY(mu_);
+    // Whether `iterator_` is a `MemoryReaderIterator`.
+    bool reading_ TF_GUARDED_BY(mu_) = false;
     GlobalShuffleIterator global_shuffle_iterator_;
   };  // MemoryIterator
 
@@ -14,6 +14,14 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/cache_ops.h"
 
+#include <algorithm>
+#include <chrono>  // NOLINT(build/c++11)
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
@@ -22,50 +30,334 @@ limitations under the License.
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
 
 namespace tensorflow {
 namespace data {
 namespace {
 
 constexpr char kMemoryCache[] = "MemoryCache";
+constexpr char kMemoryCacheBudgetEnvVar[] = "TF_DATA_MEMORY_CACHE_BUDGET_BYTES";
 
 }  // namespace
 
 string MemoryCacheManager::DebugString() const { return kMemoryCache; }
 
+MemoryCacheBudget::MemoryCacheBudget(int64_t byte_budget)
+    : byte_budget_(byte_budget) {}
+
+MemoryCacheBudget* MemoryCacheBudget::Global() {
+  static MemoryCacheBudget* budget = [] {
+    int64_t byte_budget = 0;
+    Status s = ReadInt64FromEnvVar(kMemoryCacheBudgetEnvVar,
+                                   /*default_val=*/0, &byte_budget);
+    if (!s.ok()) {
+      LOG(WARNING) << "Ignoring " << kMemoryCacheBudgetEnvVar << ": " << s;
+    }
+    return new MemoryCacheBudget(byte_budget);
+  }();
+  return budget;
+}
+
+void MemoryCacheBudget::Register(MemoryCache* cache) {
+  mutex_lock l(mu_);
+  caches_.insert(cache);
+}
+
+void MemoryCacheBudget::Unregister(MemoryCache* cache) {
+  mutex_lock l(mu_);
+  caches_.erase(cache);
+}
+
+bool MemoryCacheBudget::Reserve(MemoryCache* cache, int64_t bytes,
+                                bool force) {
+  if (byte_budget_ <= 0) {
+    return true;
+  }
+  if (used_bytes_.fetch_add(bytes) + bytes <= byte_budget_ || force) {
+    return true;
+  }
+  mutex_lock l(mu_);
+  // Collects the completed caches whose memory is released when they are
+  // evicted. Caches with active readers keep their memory until the readers
+  // finish, so evicting them does not help the reservation.
+  std::vector<std::pair<int64_t, MemoryCache*>> candidates;
+  int64_t evictable_bytes = 0;
+  for (MemoryCache* candidate : caches_) {
+    if (candidate == cache) {
+      continue;
+    }
+    const int64_t candidate_bytes = candidate->EvictableBytes();
+    if (candidate_bytes > 0) {
+      candidates.emplace_back(candidate->last_use_.load(), candidate);
+      evictable_bytes += candidate_bytes;
+    }
+  }
+  if (used_bytes_.load() - evictable_bytes > byte_budget_) {
+    used_bytes_.fetch_sub(bytes);
+    return false;
+  }
+  // Evicts the least recently used caches until the reservation fits.
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto& [last_use, lru] : candidates) {
+    if (used_bytes_.load() <= byte_budget_) {
+      break;
+    }
+    if (lru->Evict()) {
+      VLOG(2) << "Evicted a memory cache to stay within the budget of "
+              << byte_budget_ << " bytes.";
+    }
+  }
+  if (used_bytes_.load() <= byte_budget_) {
+    return true;
+  }
+  used_bytes_.fetch_sub(bytes);
+  return false;
+}
+
+void MemoryCacheBudget::Release(int64_t bytes) {
+  if (byte_budget_ > 0) {
+    used_bytes_.fetch_sub(bytes);
+  }
+}
+
+namespace {
+
+// Returns the segment and the offset within the segment of an element.
+std::pair<int, int64_t> Locate(int64_t index, int64_t first_segment_size) {
+  const int segment =
+      absl::bit_width(static_cast<uint64_t>(index / first_segment_size + 1)) -
+      1;
+  return {segment,
+          index - first_segment_size * ((int64_t{1} << segment) - 1)};
+}
+
+}  // namespace
+
+MemoryCache::Storage::~Storage() {
+  for (auto& segment : segments_) {
+    delete[] segment.load(std::memory_order_relaxed);
+  }
+  budget_->Release(bytes());
+}
+
+const std::vector<Tensor>& MemoryCache::Storage::at(int64_t index) const {
+  DCHECK_LT(index, size());
+  auto [segment, offset] = Locate(index, kFirstSegmentSize);
+  return segments_[segment].load(std::memory_order_acquire)[offset];
+}
+
+std::vector<std::vector<Tensor>> MemoryCache::Storage::elements() const {
+  const int64_t num_elements = size();
+  std::vector<std::vector<Tensor>> elements;
+  elements.reserve(num_elements);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    elements.push_back(at(i));
+  }
+  return elements;
+}
+
+void MemoryCache::Storage::Append(std::vector<Tensor>&& element,
+                                  int64_t bytes) {
+  const int64_t index = size_.load(std::memory_order_relaxed);
+  auto [segment, offset] = Locate(index, kFirstSegmentSize);
+  CHECK_LT(segment, kNumSegments);
+  std::vector<Tensor>* elements =
+      segments_[segment].load(std::memory_order_relaxed);
+  if (elements == nullptr) {
+    elements = new std::vector<Tensor>[kFirstSegmentSize << segment];
+    segments_[segment].store(elements, std::memory_order_release);
+  }
+  elements[offset] = std::move(element);
+  bytes_.fetch_add(bytes, std::memory_order_relaxed);
+  // Sequentially consistent so that `MemoryCache::Append` either observes a
+  // blocked reader or the reader observes the new element.
+  size_.store(index + 1);
+}
+
+MemoryCache::MemoryCache(MemoryCacheBudget* budget)
+    : budget_(budget), storage_(std::make_shared<Storage>(budget)) {
+  budget_->Register(this);
+}
+
+MemoryCache::~MemoryCache() { budget_->Unregister(this); }
+
 void MemoryCache::Complete(std::vector<std::vector<Tensor>>&& cache) {
   mutex_lock l(mu_);
-  if (!completed_) {
-    cache_ = std::move(cache);
-    completed_ = true;
+  if (!storage_->completed()) {
+    auto storage = std::make_shared<Storage>(budget_);
+    for (auto& element : cache) {
+      const int64_t bytes = GetTotalBytes(element);
+      // Restored caches are kept even if they exceed the budget.
+      budget_->Reserve(this, bytes, /*force=*/true);
+      storage->Append(std::move(element), bytes);
+    }
+    storage->completed_ = true;
+    storage_->detached_ = true;
+    storage_ = std::move(storage);
+    writer_active_ = false;
+    cond_var_.notify_all();
   }
 }
 
 bool MemoryCache::IsCompleted() {
   tf_shared_lock l(mu_);
-  return completed_;
+  return storage_->completed();
 }
 
 void MemoryCache::Reset() {
   mutex_lock l(mu_);
-  completed_ = false;
-  cache_.clear();
+  ResetLocked();
+  cond_var_.notify_all();
 }
 
-const std::vector<Tensor>& MemoryCache::at(int64_t index) {
+size_t MemoryCache::size() {
   tf_shared_lock l(mu_);
-  DCHECK(index < cache_.size());
-  return cache_[index];
+  return storage_->size();
 }
 
-size_t MemoryCache::size() {
+std::shared_ptr<const MemoryCache::Storage> MemoryCache::storage() {
+  last_use_ = budget_->NextTimestamp();
   tf_shared_lock l(mu_);
-  return cache_.size();
+  return storage_;
+}
+
+std::shared_ptr<MemoryCache::Storage> MemoryCache::AcquireWriter() {
+  mutex_lock l(mu_);
+  if (storage_->completed() || writer_active_) {
+    return nullptr;
+  }
+  writer_active_ = true;
+  last_use_ = budget_->NextTimestamp();
+  return storage_;
+}
+
+bool MemoryCache::Append(Storage* storage, std::vector<Tensor>&& element) {
+  if (storage->detached_) {
+    return false;
+  }
+  const int64_t bytes = GetTotalBytes(element);
+  if (!budget_->Reserve(this, bytes)) {
+    LOG(WARNING) << "The dataset does not fit into the memory cache budget of "
+                 << budget_->byte_budget()
+                 << " bytes. The input is recomputed in each epoch.";
+    Abandon(storage);
+    return false;
+  }
+  storage->Append(std::move(element), bytes);
+  if (num_waiters_.load() > 0) {
+    mutex_lock l(mu_);
+    cond_var_.notify_all();
+  }
+  return true;
+}
+
+void MemoryCache::Complete(Storage* storage) {
+  mutex_lock l(mu_);
+  storage->completed_ = true;
+  if (storage_.get() == storage) {
+    writer_active_ = false;
+    last_use_ = budget_->NextTimestamp();
+  }
+  cond_var_.notify_all();
 }
 
-const std::vector<std::vector<Tensor>>& MemoryCache::data() {
+void MemoryCache::Abandon(Storage* storage) {
+  mutex_lock l(mu_);
+  if (storage_.get() == storage) {
+    ResetLocked();
+  }
+  cond_var_.notify_all();
+}
+
+MemoryCache::WaitResult MemoryCache::WaitForElement(
+    const Storage* storage, int64_t index, int64_t timeout_us,
+    CancellationManager* cancellation_manager) {
+  if (index < storage->size()) {
+    return WaitResult::kAvailable;
+  }
+  if (storage->completed()) {
+    return WaitResult::kEndOfSequence;
+  }
+  CancellationToken token = CancellationManager::kInvalidToken;
+  if (cancellation_manager != nullptr) {
+    token = cancellation_manager->get_cancellation_token();
+    if (!cancellation_manager->RegisterCallback(token, [this]() {
+          mutex_lock l(mu_);
+          cond_var_.notify_all();
+        })) {
+      return WaitResult::kCancelled;
+    }
+  }
+  const uint64_t deadline_us =
+      timeout_us < 0 ? 0 : EnvTime::NowMicros() + timeout_us;
+  WaitResult result;
+  {
+    mutex_lock l(mu_);
+    num_waiters_.fetch_add(1);
+    while (true) {
+      if (index < storage->size_.load()) {
+        result = WaitResult::kAvailable;
+        break;
+      }
+      if (storage->completed()) {
+        result = WaitResult::kEndOfSequence;
+        break;
+      }
+      if (storage_.get() != storage || !writer_active_) {
+        result = WaitResult::kAbandoned;
+        break;
+      }
+      if (cancellation_manager != nullptr &&
+          cancellation_manager->IsCancelled()) {
+        result = WaitResult::kCancelled;
+        break;
+      }
+      if (deadline_us == 0) {
+        cond_var_.wait(l);
+        continue;
+      }
+      const uint64_t now_us = EnvTime::NowMicros();
+      if (now_us >= deadline_us) {
+        result = WaitResult::kTimedOut;
+        break;
+      }
+      cond_var_.wait_for(l, std::chrono::microseconds(deadline_us - now_us));
+    }
+    num_waiters_.fetch_sub(1);
+  }
+  // Deregisters without holding `mu_`, which the callback acquires.
+  if (cancellation_manager != nullptr) {
+    cancellation_manager->DeregisterCallback(token);
+  }
+  return result;
+}
+
+int64_t MemoryCache::EvictableBytes() {
   tf_shared_lock l(mu_);
-  return cache_;
+  // The cache holds one reference to its storage; any other reference belongs
+  // to a reader that keeps the memory alive after an eviction.
+  if (!storage_->completed() || storage_.use_count() > 1) {
+    return 0;
+  }
+  return storage_->bytes();
+}
+
+bool MemoryCache::Evict() {
+  mutex_lock l(mu_);
+  if (!storage_->completed()) {
+    return false;
+  }
+  ResetLocked();
+  return true;
+}
+
+void MemoryCache::ResetLocked() {
+  storage_->detached_ = true;
+  storage_ = std::make_shared<Storage>(budget_);
+  writer_active_ = false;
 }
 
 AnonymousMemoryCacheHandleOp::AnonymousMemoryCacheHandleOp(
@@ -16,20 +16,146 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_CACHE_OPS_H_
 
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 
 namespace tensorflow {
 namespace data {
 
+class MemoryCache;
+
+// Tracks the memory used by a set of `MemoryCache`s. When the byte budget is
+// exceeded, the least recently used completed caches are evicted; their
+// datasets recompute the input on the next epoch.
+class MemoryCacheBudget {
+ public:
+  // A non-positive `byte_budget` disables the budget.
+  explicit MemoryCacheBudget(int64_t byte_budget);
+
+  // Returns the process-wide budget. It is read from the
+  // `TF_DATA_MEMORY_CACHE_BUDGET_BYTES` environment variable and unlimited by
+  // default.
+  static MemoryCacheBudget* Global();
+
+  int64_t byte_budget() const { return byte_budget_; }
+
+  // Returns the number of bytes reserved by the caches.
+  int64_t used_bytes() const {
+    return used_bytes_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  friend class MemoryCache;
+
+  void Register(MemoryCache* cache);
+  void Unregister(MemoryCache* cache);
+
+  // Reserves `bytes` for `cache`, evicting other completed caches if needed.
+  // Caches are only evicted if enough memory can be reclaimed for the
+  // reservation to succeed. Returns false if the bytes cannot be reserved,
+  // unless `force` is true.
+  bool Reserve(MemoryCache* cache, int64_t bytes, bool force = false);
+  void Release(int64_t bytes);
+
+  // Returns a logical timestamp for least-recently-used bookkeeping.
+  int64_t NextTimestamp() {
+    return clock_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const int64_t byte_budget_;
+  std::atomic<int64_t> used_bytes_ = 0;
+  std::atomic<int64_t> clock_ = 0;
+  mutex mu_;
+  absl::flat_hash_set<MemoryCache*> caches_ TF_GUARDED_BY(mu_);
+};
+
 // A thread-safe data structure for caching dataset elements.
 //
-// The expected use is that a single `MemoryWriterIterator` populates the
-// cache with dataset elements. Once all elements are cached, the cache can
-// be used by one or more `MemoryReaderIterator`s.
+// A single writer at a time appends elements to the cache. Appended elements
+// are published to readers, which access them without acquiring a lock, so
+// iterators that start while the cache is being filled can follow the writer
+// instead of recomputing the input. Once all elements are cached, the cache
+// can be used by one or more readers.
 class MemoryCache {
  public:
-  MemoryCache() = default;
+  // Append-only storage for cached elements. Segment `k` holds
+  // `kFirstSegmentSize << k` elements, so segments never move once allocated
+  // and published elements can be read without synchronization.
+  class Storage {
+   public:
+    // The bytes of published elements are released from `budget` when the
+    // storage is destroyed.
+    explicit Storage(MemoryCacheBudget* budget) : budget_(budget) {}
+    ~Storage();
+
+    Storage(const Storage&) = delete;
+    Storage& operator=(const Storage&) = delete;
+
+    // Returns the number of published elements.
+    int64_t size() const { return size_.load(std::memory_order_acquire); }
+
+    // Returns whether all elements of the dataset have been published.
+    bool completed() const {
+      return completed_.load(std::memory_order_acquire);
+    }
+
+    // Returns the published element at the given index.
+    const std::vector<Tensor>& at(int64_t index) const;
+
+    // Returns the total size of the published elements in bytes.
+    int64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+    // Returns a copy of the published elements.
+    std::vector<std::vector<Tensor>> elements() const;
+
+   private:
+    friend class MemoryCache;
+
+    static constexpr int64_t kFirstSegmentSize = 64;
+    static constexpr int kNumSegments = 48;
+
+    // Appends and publishes an element. Must not be called concurrently.
+    void Append(std::vector<Tensor>&& element, int64_t bytes);
+
+    MemoryCacheBudget* const budget_;  // not owned.
+    std::array<std::atomic<std::vector<Tensor>*>, kNumSegments> segments_{};
+    std::atomic<int64_t> size_ = 0;
+    std::atomic<int64_t> bytes_ = 0;
+    std::atomic<bool> completed_ = false;
+    // Set when the storage is no longer the storage of the cache.
+    std::atomic<bool> detached_ = false;
+  };
+
+  // The result of waiting for an element.
+  enum class WaitResult {
+    // The element is published.
+    kAvailable,
+    // The cache is completed and has fewer elements.
+    kEndOfSequence,
+    // The writer stopped filling the storage; the element has to be
+    // recomputed.
+    kAbandoned,
+    // The element was not published before the timeout; the element has to
+    // be recomputed.
+    kTimedOut,
+    // The wait was cancelled.
+    kCancelled,
+  };
+
+  MemoryCache() : MemoryCache(MemoryCacheBudget::Global()) {}
+  explicit MemoryCache(MemoryCacheBudget* budget);
+  ~MemoryCache();
 
   // Marks the cache as completed.
   void Complete(std::vector<std::vector<Tensor>>&& cache);
@@ -40,21 +166,56 @@ class MemoryCache {
   // Resets the cache.
   void Reset();
 
-  // Returns the element at the given index.
-  const std::vector<Tensor>& at(int64_t index);
-
   // Returns the size of the cache.
   size_t size();
 
-  // Returns a reference to the cache's data. The returned reference will be
-  // invalidated by any call to Reset().
-  const std::vector<std::vector<Tensor>>& data();
+  // Returns the current storage of the cache and marks the cache as used. The
+  // returned storage stays valid after the cache is reset or evicted.
+  std::shared_ptr<const Storage> storage();
+
+  // Makes the caller the writer of the cache. Returns nullptr if the cache is
+  // completed or another writer is filling it.
+  std::shared_ptr<Storage> AcquireWriter();
+
+  // Appends an element to `storage`, which must have been returned by
+  // `AcquireWriter`. Returns false if the element does not fit into the byte
+  // budget, in which case the writer is released and the cache is reset.
+  bool Append(Storage* storage, std::vector<Tensor>&& element);
+
+  // Marks `storage` as completed and releases the writer.
+  void Complete(Storage* storage);
+
+  // Releases the writer without completing `storage`, resetting the cache.
+  void Abandon(Storage* storage);
+
+  // Blocks until the element at `index` of `storage` is published, it is
+  // known that the element will not be published, `timeout_us` microseconds
+  // elapse or `cancellation_manager` (if not null) is cancelled. The lock of
+  // the cache is not held while blocked.
+  WaitResult WaitForElement(
+      const Storage* storage, int64_t index, int64_t timeout_us = -1,
+      CancellationManager* cancellation_manager = nullptr);
 
  private:
+  friend class MemoryCacheBudget;
+
+  // Returns the number of bytes that evicting the cache would release right
+  // away, i.e. the bytes of a completed storage without readers.
+  int64_t EvictableBytes();
+
+  // Resets the cache if it is completed. Returns whether the cache was reset.
+  bool Evict();
+  void ResetLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  MemoryCacheBudget* const budget_;  // not owned.
+  std::atomic<int64_t> last_use_ = 0;
+  // Number of readers blocked in `WaitForElement`.
+  std::atomic<int64_t> num_waiters_ = 0;
   mutex mu_;
-  // Determines whether all elements of the dataset have been cached.
-  bool completed_ TF_GUARDED_BY(mu_) = false;
-  std::vector<std::vector<Tensor>> cache_ TF_GUARDED_BY(mu_);
+  condition_variable cond_var_;
+  std::shared_ptr<Storage> storage_ TF_GUARDED_BY(mu_);
+  // Whether a writer is filling `storage_`.
+  bool writer_active_ TF_GUARDED_BY(mu_) = false;
 };
 
 // A resource wrapping a shared instance of a memory cache.
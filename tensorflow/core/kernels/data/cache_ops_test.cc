@@ -0,0 +1,195 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/cache_ops.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/framework/cancellation.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+// Each element holds 100 int64 values, i.e. 800 bytes.
+constexpr int64_t kElementBytes = 800;
+
+std::vector<Tensor> MakeElement(int64_t i) {
+  Tensor tensor(DT_INT64, TensorShape({100}));
+  tensor.flat<int64_t>().setConstant(i);
+  return {tensor};
+}
+
+void FillCache(MemoryCache& cache, int64_t num_elements) {
+  std::shared_ptr<MemoryCache::Storage> storage = cache.AcquireWriter();
+  ASSERT_NE(storage, nullptr);
+  for (int64_t i = 0; i < num_elements; ++i) {
+    ASSERT_TRUE(cache.Append(storage.get(), MakeElement(i)));
+  }
+  cache.Complete(storage.get());
+}
+
+TEST(MemoryCacheTest, AppendAndRead) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  // Spans several segments.
+  FillCache(cache, 1000);
+  EXPECT_TRUE(cache.IsCompleted());
+  EXPECT_EQ(cache.size(), 1000);
+  std::shared_ptr<const MemoryCache::Storage> storage = cache.storage();
+  for (int64_t i = 0; i < 1000; ++i) {
+    test::ExpectEqual(storage->at(i)[0], MakeElement(i)[0]);
+  }
+  EXPECT_EQ(storage->bytes(), 1000 * kElementBytes);
+}
+
+TEST(MemoryCacheTest, SingleWriter) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> storage = cache.AcquireWriter();
+  ASSERT_NE(storage, nullptr);
+  EXPECT_EQ(cache.AcquireWriter(), nullptr);
+  cache.Complete(storage.get());
+  EXPECT_EQ(cache.AcquireWriter(), nullptr);
+  cache.Reset();
+  EXPECT_NE(cache.AcquireWriter(), nullptr);
+}
+
+TEST(MemoryCacheTest, ReaderFollowsWriter) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> writer_storage = cache.AcquireWriter();
+  std::shared_ptr<const MemoryCache::Storage> storage = cache.storage();
+  std::unique_ptr<Thread> writer(Env::Default()->StartThread(
+      {}, "writer", [&cache, storage = writer_storage.get()]() {
+        for (int64_t i = 0; i < 100; ++i) {
+          Env::Default()->SleepForMicroseconds(100);
+          CHECK(cache.Append(storage, MakeElement(i)));
+        }
+        cache.Complete(storage);
+      }));
+  for (int64_t i = 0; i < 100; ++i) {
+    ASSERT_EQ(cache.WaitForElement(storage.get(), i),
+              MemoryCache::WaitResult::kAvailable);
+    test::ExpectEqual(storage->at(i)[0], MakeElement(i)[0]);
+  }
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 100),
+            MemoryCache::WaitResult::kEndOfSequence);
+}
+
+TEST(MemoryCacheTest, AbandonedWriter) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> writer_storage = cache.AcquireWriter();
+  ASSERT_TRUE(cache.Append(writer_storage.get(), MakeElement(0)));
+  std::shared_ptr<const MemoryCache::Storage> storage = cache.storage();
+  cache.Abandon(writer_storage.get());
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 0),
+            MemoryCache::WaitResult::kAvailable);
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 1),
+            MemoryCache::WaitResult::kAbandoned);
+  EXPECT_FALSE(cache.IsCompleted());
+  EXPECT_EQ(cache.size(), 0);
+}
+
+TEST(MemoryCacheTest, WaitTimesOut) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> writer_storage = cache.AcquireWriter();
+  std::shared_ptr<const MemoryCache::Storage> storage = cache.storage();
+  // The writer is not advanced while the reader waits, e.g. because both are
+  // consumed by the same thread.
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 0, /*timeout_us=*/1000),
+            MemoryCache::WaitResult::kTimedOut);
+  ASSERT_TRUE(cache.Append(writer_storage.get(), MakeElement(0)));
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 0, /*timeout_us=*/1000),
+            MemoryCache::WaitResult::kAvailable);
+}
+
+TEST(MemoryCacheTest, WaitIsCancelled) {
+  MemoryCacheBudget budget(/*byte_budget=*/0);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> writer_storage = cache.AcquireWriter();
+  std::shared_ptr<const MemoryCache::Storage> storage = cache.storage();
+  CancellationManager cancellation_manager;
+  std::unique_ptr<Thread> canceller(Env::Default()->StartThread(
+      {}, "canceller", [&cancellation_manager]() {
+        Env::Default()->SleepForMicroseconds(1000);
+        cancellation_manager.StartCancel();
+      }));
+  EXPECT_EQ(cache.WaitForElement(storage.get(), 0, /*timeout_us=*/-1,
+                                 &cancellation_manager),
+            MemoryCache::WaitResult::kCancelled);
+}
+
+TEST(MemoryCacheTest, EvictsLeastRecentlyUsedCache) {
+  MemoryCacheBudget budget(/*byte_budget=*/25 * kElementBytes);
+  MemoryCache cache_a(&budget);
+  MemoryCache cache_b(&budget);
+  MemoryCache cache_c(&budget);
+  FillCache(cache_a, 10);
+  FillCache(cache_b, 10);
+  EXPECT_EQ(budget.used_bytes(), 20 * kElementBytes);
+  // Uses `cache_a` so that `cache_b` is the least recently used cache.
+  cache_a.storage();
+  FillCache(cache_c, 10);
+  EXPECT_TRUE(cache_a.IsCompleted());
+  EXPECT_FALSE(cache_b.IsCompleted());
+  EXPECT_TRUE(cache_c.IsCompleted());
+  EXPECT_EQ(budget.used_bytes(), 20 * kElementBytes);
+}
+
+TEST(MemoryCacheTest, ExceedsBudget) {
+  MemoryCacheBudget budget(/*byte_budget=*/5 * kElementBytes);
+  MemoryCache cache(&budget);
+  std::shared_ptr<MemoryCache::Storage> storage = cache.AcquireWriter();
+  for (int64_t i = 0; i < 5; ++i) {
+    ASSERT_TRUE(cache.Append(storage.get(), MakeElement(i)));
+  }
+  EXPECT_FALSE(cache.Append(storage.get(), MakeElement(5)));
+  EXPECT_FALSE(cache.IsCompleted());
+  storage.reset();
+  EXPECT_EQ(budget.used_bytes(), 0);
+  // The cache can be filled again, e.g. by the next epoch.
+  EXPECT_NE(cache.AcquireWriter(), nullptr);
+}
+
+TEST(MemoryCacheTest, DoesNotEvictIfReservationCannotSucceed) {
+  MemoryCacheBudget budget(/*byte_budget=*/25 * kElementBytes);
+  MemoryCache cache_a(&budget);
+  MemoryCache cache_b(&budget);
+  MemoryCache cache_c(&budget);
+  FillCache(cache_a, 10);
+  FillCache(cache_b, 10);
+  // Readers keep the memory of `cache_a` alive, so evicting it would not make
+  // room for `cache_c`.
+  std::shared_ptr<const MemoryCache::Storage> reader = cache_a.storage();
+  std::shared_ptr<MemoryCache::Storage> storage = cache_c.AcquireWriter();
+  for (int64_t i = 0; i < 15; ++i) {
+    ASSERT_TRUE(cache_c.Append(storage.get(), MakeElement(i)));
+  }
+  EXPECT_FALSE(cache_b.IsCompleted());
+  EXPECT_FALSE(cache_c.Append(storage.get(), MakeElement(15)));
+  EXPECT_TRUE(cache_a.IsCompleted());
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,665 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_sequence_length_dataset_op.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/data/name_utils.h"
+#include "tensorflow/core/data/serialization_utils.h"
+#include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/partial_tensor_shape.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_util.h"
+#include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/util/batch_util.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kDatasetType;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kInputDataset;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kBucketBoundaries;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kBatchSize;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kMaxTokensPerBatch;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kPaddingValues;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kLengthComponent;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kNumAdaptiveBuckets;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kOutputTypes;
+/* static */ constexpr const char* const
+    BucketBySequenceLengthDatasetOp::kOutputShapes;
+
+namespace {
+
+constexpr char kInputImplEmpty[] = "input_impl_empty";
+constexpr char kBoundaries[] = "boundaries";
+constexpr char kHistogramLengths[] = "histogram_lengths";
+constexpr char kHistogramCounts[] = "histogram_counts";
+constexpr char kNumElementsSeen[] = "num_elements_seen";
+constexpr char kNextBoundaryUpdate[] = "next_boundary_update";
+constexpr char kNumBuckets[] = "num_buckets";
+constexpr char kBucket[] = "bucket_";
+constexpr char kNumReadyBatches[] = "num_ready_batches";
+constexpr char kReadyBatch[] = "ready_batch_";
+
+// Number of observed elements after which adaptive bucket boundaries are
+// first computed. They are recomputed each time this number doubles.
+constexpr int64_t kFirstBoundaryUpdate = 256;
+
+Tensor VectorToTensor(const std::vector<int64_t>& values) {
+  Tensor tensor(DT_INT64, TensorShape({static_cast<int64_t>(values.size())}));
+  std::copy(values.begin(), values.end(), tensor.vec<int64_t>().data());
+  return tensor;
+}
+
+std::vector<int64_t> TensorToVector(const Tensor& tensor) {
+  auto values = tensor.vec<int64_t>();
+  return std::vector<int64_t>(values.data(), values.data() + values.size());
+}
+
+}  // namespace
+
+std::vector<int64_t> ComputeBucketBoundaries(
+    const std::map<int64_t, int64_t>& length_counts, int64_t num_buckets) {
+  std::vector<int64_t> boundaries;
+  if (length_counts.empty() || num_buckets <= 1) {
+    return boundaries;
+  }
+  int64_t total_count = 0;
+  for (const auto& [length, count] : length_counts) {
+    total_count += count;
+  }
+  // Closes bucket `k` at the first length at which the cumulative count
+  // reaches the k-th of `num_buckets` quantiles.
+  int64_t cumulative_count = 0;
+  int64_t k = 1;
+  for (const auto& [length, count] : length_counts) {
+    cumulative_count += count;
+    while (k < num_buckets &&
+           cumulative_count * num_buckets >= k * total_count) {
+      if (boundaries.empty() || boundaries.back() <= length) {
+        boundaries.push_back(length + 1);
+      }
+      ++k;
+    }
+  }
+  // A boundary above the longest length would only add an empty bucket.
+  const int64_t max_length = length_counts.rbegin()->first;
+  while (!boundaries.empty() && boundaries.back() > max_length) {
+    boundaries.pop_back();
+  }
+  return boundaries;
+}
+
+class BucketBySequenceLengthDatasetOp::Dataset : public DatasetBase {
+ public:
+  Dataset(OpKernelContext* ctx, const DatasetBase* input,
+          std::vector<int64_t> bucket_boundaries, int64_t batch_size,
+          int64_t max_tokens_per_batch, std::vector<Tensor> padding_values,
+          int64_t length_component, int64_t num_adaptive_buckets)
+      : DatasetBase(DatasetContext(ctx)),
+        input_(input),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        batch_size_(batch_size),
+        max_tokens_per_batch_(max_tokens_per_batch),
+        padding_values_(std::move(padding_values)),
+        length_component_(length_component),
+        num_adaptive_buckets_(num_adaptive_buckets) {
+    input_->Ref();
+    const auto& input_shapes = input_->output_shapes();
+    output_shapes_.reserve(input_shapes.size());
+    for (const auto& input_shape : input_shapes) {
+      output_shapes_.push_back(
+          PartialTensorShape({-1}).Concatenate(input_shape));
+    }
+  }
+
+  ~Dataset() override { input_->Unref(); }
+
+  std::unique_ptr<IteratorBase> MakeIteratorInternal(
+      const string& prefix) const override {
+    return std::make_unique<Iterator>(Iterator::Params{
+        this, name_utils::IteratorPrefix(kDatasetType, prefix)});
+  }
+
+  const DataTypeVector& output_dtypes() const override {
+    return input_->output_dtypes();
+  }
+
+  const std::vector<PartialTensorShape>& output_shapes() const override {
+    return output_shapes_;
+  }
+
+  string DebugString() const override {
+    return name_utils::DatasetDebugString(kDatasetType);
+  }
+
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    int64_t n = input_->Cardinality(options);
+    if (n == kInfiniteCardinality) {
+      return n;
+    }
+    return kUnknownCardinality;
+  }
+
+  Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
+    inputs->push_back(input_);
+    return absl::OkStatus();
+  }
+
+  Status CheckExternalState() const override {
+    return input_->CheckExternalState();
+  }
+
+ protected:
+  Status AsGraphDefInternal(SerializationContext* ctx,
+                            DatasetGraphDefBuilder* b,
+                            Node** output) const override {
+    Node* input_graph_node = nullptr;
+    TF_RETURN_IF_ERROR(b->AddInputDataset(ctx, input_, &input_graph_node));
+    Node* bucket_boundaries = nullptr;
+    TF_RETURN_IF_ERROR(
+        b->AddTensor(VectorToTensor(bucket_boundaries_), &bucket_boundaries));
+    Node* batch_size = nullptr;
+    TF_RETURN_IF_ERROR(b->AddScalar(batch_size_, &batch_size));
+    Node* max_tokens_per_batch = nullptr;
+    TF_RETURN_IF_ERROR(
+        b->AddScalar(max_tokens_per_batch_, &max_tokens_per_batch));
+
+    std::vector<Node*> padding_values;
+    padding_values.reserve(padding_values_.size());
+    for (const Tensor& t : padding_values_) {
+      Node* node;
+      TF_RETURN_IF_ERROR(b->AddTensor(t, &node));
+      padding_values.emplace_back(node);
+    }
+
+    AttrValue length_component;
+    b->BuildAttrValue(length_component_, &length_component);
+    AttrValue num_adaptive_buckets;
+    b->BuildAttrValue(num_adaptive_buckets_, &num_adaptive_buckets);
+    AttrValue output_types;
+    b->BuildAttrValue(output_dtypes(), &output_types);
+
+    TF_RETURN_IF_ERROR(b->AddDataset(
+        this,
+        {{0, input_graph_node},
+         {1, bucket_boundaries},
+         {2, batch_size},
+         {3, max_tokens_per_batch}},
+        {{4, padding_values}},
+        {{kLengthComponent, length_component},
+         {kNumAdaptiveBuckets, num_adaptive_buckets},
+         {kOutputTypes, output_types}},
+        output));
+    return absl::OkStatus();
+  }
+
+ private:
+  class Iterator : public DatasetIterator<Dataset> {
+   public:
+    explicit Iterator(const Params& params)
+        : DatasetIterator<Dataset>(params) {}
+
+    Status Initialize(IteratorContext* ctx) override {
+      mutex_lock l(mu_);
+      ResetBuckets(dataset()->bucket_boundaries_);
+      return dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_);
+    }
+
+    Status GetNextInternal(IteratorContext* ctx,
+                           std::vector<Tensor>* out_tensors,
+                           bool* end_of_sequence) override {
+      std::vector<std::vector<Tensor>> batch_elements;
+      {
+        mutex_lock l(mu_);
+        while (ready_batches_.empty() && input_impl_) {
+          std::vector<Tensor> element;
+          bool end_of_input = false;
+          TF_RETURN_IF_ERROR(
+              input_impl_->GetNext(ctx, &element, &end_of_input));
+          if (end_of_input) {
+            input_impl_.reset();
+            for (Bucket& bucket : buckets_) {
+              FlushBucket(bucket);
+            }
+            break;
+          }
+          int64_t length;
+          TF_RETURN_IF_ERROR(GetLength(element, &length));
+          ObserveLength(length);
+          AddElement(std::move(element), length);
+        }
+        if (ready_batches_.empty()) {
+          *end_of_sequence = true;
+          return absl::OkStatus();
+        }
+        batch_elements = std::move(ready_batches_.front());
+        ready_batches_.pop_front();
+      }
+
+      TF_RETURN_IF_ERROR(CopyBatch(ctx, batch_elements, out_tensors));
+      *end_of_sequence = false;
+      return absl::OkStatus();
+    }
+
+   protected:
+    std::shared_ptr<model::Node> CreateNode(
+        IteratorContext* ctx, model::Node::Args args) const override {
+      return model::MakeUnknownRatioNode(std::move(args));
+    }
+
+    Status SaveInternal(SerializationContext* ctx,
+                        IteratorStateWriter* writer) override {
+      mutex_lock l(mu_);
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), kInputImplEmpty, static_cast<int64_t>(!input_impl_)));
+      if (input_impl_) {
+        TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      }
+      TF_RETURN_IF_ERROR(writer->WriteTensor(prefix(), kBoundaries,
+                                             VectorToTensor(boundaries_)));
+
+      std::vector<int64_t> lengths;
+      std::vector<int64_t> counts;
+      lengths.reserve(length_counts_.size());
+      counts.reserve(length_counts_.size());
+      for (const auto& [length, count] : length_counts_) {
+        lengths.push_back(length);
+        counts.push_back(count);
+      }
+      TF_RETURN_IF_ERROR(writer->WriteTensor(prefix(), kHistogramLengths,
+                                             VectorToTensor(lengths)));
+      TF_RETURN_IF_ERROR(writer->WriteTensor(prefix(), kHistogramCounts,
+                                             VectorToTensor(counts)));
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kNumElementsSeen, num_elements_seen_));
+      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kNextBoundaryUpdate,
+                                             next_boundary_update_));
+
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), kNumBuckets, static_cast<int64_t>(buckets_.size())));
+      for (size_t i = 0; i < buckets_.size(); ++i) {
+        TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+            writer, absl::StrCat(prefix(), kColon, kBucket, i),
+            buckets_[i].elements));
+      }
+      TF_RETURN_IF_ERROR(
+          writer->WriteScalar(prefix(), kNumReadyBatches,
+                              static_cast<int64_t>(ready_batches_.size())));
+      for (size_t i = 0; i < ready_batches_.size(); ++i) {
+        TF_RETURN_IF_ERROR(WriteElementsToCheckpoint(
+            writer, absl::StrCat(prefix(), kColon, kReadyBatch, i),
+            ready_batches_[i]));
+      }
+      return absl::OkStatus();
+    }
+
+    Status RestoreInternal(IteratorContext* ctx,
+                           IteratorStateReader* reader) override {
+      mutex_lock l(mu_);
+      int64_t input_empty;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kInputImplEmpty, &input_empty));
+      if (static_cast<bool>(input_empty)) {
+        input_impl_.reset();
+      } else {
+        TF_RETURN_IF_ERROR(
+            dataset()->input_->MakeIterator(ctx, this, prefix(), &input_impl_));
+        TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
+      }
+
+      Tensor boundaries;
+      TF_RETURN_IF_ERROR(
+          reader->ReadTensor(prefix(), kBoundaries, &boundaries));
+      Tensor lengths;
+      TF_RETURN_IF_ERROR(
+          reader->ReadTensor(prefix(), kHistogramLengths, &lengths));
+      Tensor counts;
+      TF_RETURN_IF_ERROR(
+          reader->ReadTensor(prefix(), kHistogramCounts, &counts));
+      if (lengths.NumElements() != counts.NumElements()) {
+        return errors::DataLoss("Bucket length histogram has ",
+                                lengths.NumElements(), " lengths but ",
+                                counts.NumElements(), " counts.");
+      }
+      length_counts_.clear();
+      for (int64_t i = 0; i < lengths.NumElements(); ++i) {
+        length_counts_[lengths.vec<int64_t>()(i)] = counts.vec<int64_t>()(i);
+      }
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kNumElementsSeen, &num_elements_seen_));
+      TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kNextBoundaryUpdate,
+                                            &next_boundary_update_));
+
+      ResetBuckets(TensorToVector(boundaries));
+      int64_t num_buckets;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kNumBuckets, &num_buckets));
+      if (num_buckets != static_cast<int64_t>(buckets_.size())) {
+        return errors::DataLoss("Expected ", buckets_.size(),
+                                " buckets for the bucket boundaries but got ",
+                                num_buckets, ".");
+      }
+      for (int64_t i = 0; i < num_buckets; ++i) {
+        Bucket& bucket = buckets_[i];
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, absl::StrCat(prefix(), kColon, kBucket, i),
+            &bucket.elements));
+        for (const std::vector<Tensor>& element : bucket.elements) {
+          int64_t length;
+          TF_RETURN_IF_ERROR(GetLength(element, &length));
+          bucket.max_length = std::max(bucket.max_length, length);
+        }
+      }
+      int64_t num_ready_batches;
+      TF_RETURN_IF_ERROR(
+          reader->ReadScalar(prefix(), kNumReadyBatches, &num_ready_batches));
+      ready_batches_.clear();
+      for (int64_t i = 0; i < num_ready_batches; ++i) {
+        ready_batches_.emplace_back();
+        TF_RETURN_IF_ERROR(ReadElementsFromCheckpoint(
+            ctx, reader, absl::StrCat(prefix(), kColon, kReadyBatch, i),
+            &ready_batches_.back()));
+      }
+      return absl::OkStatus();
+    }
+
+   private:
+    // Elements of one bucket that have not been batched yet.
+    struct Bucket {
+      std::vector<std::vector<Tensor>> elements;
+      // Longest length of `elements`.
+      int64_t max_length = 0;
+    };
+
+    Status GetLength(const std::vector<Tensor>& element, int64_t* length) {
+      const Tensor& component = element[dataset()->length_component_];
+      if (component.dims() < 1) {
+        return errors::InvalidArgument(
+            "Component ", dataset()->length_component_,
+            " of the input elements must have a rank of at least 1 to "
+            "determine their length, but got an element of shape ",
+            component.shape().DebugString(), ".");
+      }
+      *length = component.dim_size(0);
+      return absl::OkStatus();
+    }
+
+    void ResetBuckets(std::vector<int64_t> boundaries)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      boundaries_ = std::move(boundaries);
+      buckets_.clear();
+      buckets_.resize(boundaries_.size() + 1);
+    }
+
+    // Moves the elements of `bucket` to a batch ready to be returned.
+    void FlushBucket(Bucket& bucket) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (bucket.elements.empty()) {
+        return;
+      }
+      ready_batches_.push_back(std::move(bucket.elements));
+      bucket.elements.clear();
+      bucket.max_length = 0;
+    }
+
+    // Adds `element` of length `length` to its bucket. The bucket is flushed
+    // first if the element would take its batch over the token budget, and
+    // afterwards if the batch holds `batch_size` elements or has no room left
+    // for another element as long as its longest one.
+    void AddElement(std::vector<Tensor> element, int64_t length)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      const size_t bucket_index =
+          std::upper_bound(boundaries_.begin(), boundaries_.end(), length) -
+          boundaries_.begin();
+      Bucket& bucket = buckets_[bucket_index];
+      const int64_t max_tokens = dataset()->max_tokens_per_batch_;
+      int64_t num_elements = bucket.elements.size();
+      if (max_tokens > 0 && num_elements > 0 &&
+          (num_elements + 1) * std::max(bucket.max_length, length) >
+              max_tokens) {
+        FlushBucket(bucket);
+      }
+      bucket.elements.push_back(std::move(element));
+      bucket.max_length = std::max(bucket.max_length, length);
+      num_elements = bucket.elements.size();
+      if (num_elements >= dataset()->batch_size_ ||
+          (max_tokens > 0 &&
+           (num_elements + 1) * bucket.max_length > max_tokens)) {
+        FlushBucket(bucket);
+      }
+    }
+
+    // Records `length` in the length histogram and recomputes the bucket
+    // boundaries when it is time to.
+    void ObserveLength(int64_t length) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (dataset()->num_adaptive_buckets_ <= 0) {
+        return;
+      }
+      ++length_counts_[length];
+      if (++num_elements_seen_ < next_boundary_update_) {
+        return;
+      }
+      next_boundary_update_ *= 2;
+      std::vector<int64_t> boundaries = ComputeBucketBoundaries(
+          length_counts_, dataset()->num_adaptive_buckets_);
+      if (boundaries == boundaries_) {
+        return;
+      }
+      // Moves the buffered elements to the buckets of the new boundaries.
+      std::vector<Bucket> old_buckets = std::move(buckets_);
+      ResetBuckets(std::move(boundaries));
+      for (Bucket& bucket : old_buckets) {
+        for (std::vector<Tensor>& element : bucket.elements) {
+          const int64_t element_length =
+              element[dataset()->length_component_].dim_size(0);
+          AddElement(std::move(element), element_length);
+        }
+      }
+    }
+
+    // Copies `batch_elements` into one output tensor per tuple component,
+    // padding every dimension to the largest size in the batch.
+    Status CopyBatch(IteratorContext* ctx,
+                     const std::vector<std::vector<Tensor>>& batch_elements,
+                     std::vector<Tensor>* out_tensors) {
+      const size_t num_tuple_components = batch_elements[0].size();
+      const int64_t num_batch_elements = batch_elements.size();
+      for (size_t component_index = 0; component_index < num_tuple_components;
+           ++component_index) {
+        const TensorShape& first_shape =
+            batch_elements[0][component_index].shape();
+        TensorShape component_shape = first_shape;
+        for (int64_t i = 1; i < num_batch_elements; ++i) {
+          const TensorShape& element_shape =
+              batch_elements[i][component_index].shape();
+          if (element_shape.dims() != first_shape.dims()) {
+            return errors::InvalidArgument(
+                "All elements in a batch must have the same rank for "
+                "component ",
+                component_index, ": expected rank ", first_shape.dims(),
+                " but got element with rank ", element_shape.dims());
+          }
+          for (int dim = 0; dim < element_shape.dims(); ++dim) {
+            if (element_shape.dim_size(dim) > component_shape.dim_size(dim)) {
+              component_shape.set_dim(dim, element_shape.dim_size(dim));
+            }
+          }
+        }
+
+        TensorShape batch_component_shape({num_batch_elements});
+        batch_component_shape.AppendShape(component_shape);
+        out_tensors->emplace_back(ctx->allocator({}),
+                                  output_dtypes()[component_index],
+                                  batch_component_shape);
+        Tensor& batch_component = out_tensors->back();
+        TF_RETURN_IF_ERROR(batch_util::SetElementZero(
+            &batch_component, dataset()->padding_values_[component_index]));
+        for (int64_t i = 0; i < num_batch_elements; ++i) {
+          const Tensor& element = batch_elements[i][component_index];
+          // Take the fast path if possible.
+          if (element.shape() == component_shape) {
+            TF_RETURN_IF_ERROR(
+                batch_util::CopyElementToSlice(element, &batch_component, i));
+          } else {
+            TF_RETURN_IF_ERROR(batch_util::CopyElementToLargerSlice(
+                element, &batch_component, i));
+          }
+        }
+      }
+      return absl::OkStatus();
+    }
+
+    mutex mu_;
+    std::unique_ptr<IteratorBase> input_impl_ TF_GUARDED_BY(mu_);
+    std::vector<int64_t> boundaries_ TF_GUARDED_BY(mu_);
+    std::vector<Bucket> buckets_ TF_GUARDED_BY(mu_);
+    // Batches that are complete but have not been returned yet.
+    std::deque<std::vector<std::vector<Tensor>>> ready_batches_
+        TF_GUARDED_BY(mu_);
+    // Number of observed elements of each length, if the bucket boundaries
+    // are adaptive.
+    std::map<int64_t, int64_t> length_counts_ TF_GUARDED_BY(mu_);
+    int64_t num_elements_seen_ TF_GUARDED_BY(mu_) = 0;
+    int64_t next_boundary_update_ TF_GUARDED_BY(mu_) = kFirstBoundaryUpdate;
+  };
+
+  const DatasetBase* const input_;
+  const std::vector<int64_t> bucket_boundaries_;
+  const int64_t batch_size_;
+  const int64_t max_tokens_per_batch_;
+  const std::vector<Tensor> padding_values_;
+  const int64_t length_component_;
+  const int64_t num_adaptive_buckets_;
+  std::vector<PartialTensorShape> output_shapes_;
+};
+
+BucketBySequenceLengthDatasetOp::BucketBySequenceLengthDatasetOp(
+    OpKernelConstruction* ctx)
+    : UnaryDatasetOpKernel(ctx) {
+  OP_REQUIRES_OK(ctx, ctx->GetAttr(kLengthComponent, &length_component_));
+  OP_REQUIRES_OK(ctx,
+                 ctx->GetAttr(kNumAdaptiveBuckets, &num_adaptive_buckets_));
+}
+
+void BucketBySequenceLengthDatasetOp::MakeDataset(OpKernelContext* ctx,
+                                                  DatasetBase* input,
+                                                  DatasetBase** output) {
+  const Tensor* bucket_boundaries_t;
+  OP_REQUIRES_OK(ctx, ctx->input(kBucketBoundaries, &bucket_boundaries_t));
+  OP_REQUIRES(
+      ctx, TensorShapeUtils::IsVector(bucket_boundaries_t->shape()),
+      errors::InvalidArgument("`", kBucketBoundaries,
+                              "` must be a vector but got shape ",
+                              bucket_boundaries_t->shape().DebugString(), "."));
+  std::vector<int64_t> bucket_boundaries = TensorToVector(*bucket_boundaries_t);
+  for (size_t i = 0; i < bucket_boundaries.size(); ++i) {
+    OP_REQUIRES(ctx,
+                bucket_boundaries[i] > 0 &&
+                    (i == 0 || bucket_boundaries[i - 1] < bucket_boundaries[i]),
+                errors::InvalidArgument(
+                    "`", kBucketBoundaries,
+                    "` must be positive and strictly increasing."));
+  }
+
+  int64_t batch_size;
+  OP_REQUIRES_OK(ctx,
+                 ParseScalarArgument<int64_t>(ctx, kBatchSize, &batch_size));
+  OP_REQUIRES(ctx, batch_size > 0,
+              errors::InvalidArgument("Batch size must be greater than zero."));
+  int64_t max_tokens_per_batch;
+  OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kMaxTokensPerBatch,
+                                                   &max_tokens_per_batch));
+
+  const std::vector<PartialTensorShape>& input_shapes = input->output_shapes();
+  OP_REQUIRES(
+      ctx,
+      length_component_ >= 0 &&
+          length_component_ < static_cast<int64_t>(input_shapes.size()),
+      errors::InvalidArgument("`", kLengthComponent, "` must be in [0, ",
+                              input_shapes.size(), ") but got ",
+                              length_component_, "."));
+  OP_REQUIRES(ctx,
+              input_shapes[length_component_].unknown_rank() ||
+                  input_shapes[length_component_].dims() >= 1,
+              errors::InvalidArgument(
+                  "Component ", length_component_,
+                  " of the input elements must have a rank of at least 1 to "
+                  "determine their length, but has shape ",
+                  input_shapes[length_component_].DebugString(), "."));
+  for (size_t i = 0; i < input_shapes.size(); ++i) {
+    OP_REQUIRES(ctx, !input_shapes[i].unknown_rank(),
+                errors::InvalidArgument(
+                    "Component ", i,
+                    " of the input elements must have a known rank to be "
+                    "padded."));
+  }
+
+  OpInputList padding_values_list;
+  OP_REQUIRES_OK(ctx, ctx->input_list(kPaddingValues, &padding_values_list));
+  OP_REQUIRES(ctx, padding_values_list.size() == input_shapes.size(),
+              errors::InvalidArgument(
+                  "Number of padding values (", padding_values_list.size(),
+                  ") must match the number of components in the input "
+                  "dataset's elements (",
+                  input_shapes.size(), ")"));
+  std::vector<Tensor> padding_values;
+  padding_values.reserve(padding_values_list.size());
+  for (int i = 0; i < padding_values_list.size(); ++i) {
+    const Tensor& padding_value_t = padding_values_list[i];
+    OP_REQUIRES(ctx, TensorShapeUtils::IsScalar(padding_value_t.shape()),
+                errors::InvalidArgument("All padding values must be scalars"));
+    OP_REQUIRES(ctx, padding_value_t.dtype() == input->output_dtypes()[i],
+                errors::InvalidArgument(
+                    "Mismatched type between padding value ", i,
+                    " and input dataset's component ", i, ": ",
+                    DataTypeString(padding_value_t.dtype()), " vs. ",
+                    DataTypeString(input->output_dtypes()[i])));
+    padding_values.push_back(tensor::DeepCopy(padding_value_t));
+  }
+
+  *output = new Dataset(ctx, input, std::move(bucket_boundaries), batch_size,
+                        max_tokens_per_batch, std::move(padding_values),
+                        length_component_, num_adaptive_buckets_);
+}
+
+namespace {
+REGISTER_KERNEL_BUILDER(
+    Name("BucketBySequenceLengthDataset").Device(DEVICE_CPU),
+    BucketBySequenceLengthDatasetOp);
+}  // namespace
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
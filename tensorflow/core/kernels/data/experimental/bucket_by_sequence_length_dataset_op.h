@@ -0,0 +1,75 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_BUCKET_BY_SEQUENCE_LENGTH_DATASET_OP_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_BUCKET_BY_SEQUENCE_LENGTH_DATASET_OP_H_
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "tensorflow/core/framework/dataset.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Groups the elements of the input dataset into buckets by the size of the
+// first dimension of their `length_component`, and emits padded batches from
+// each bucket. A bucket's batch is emitted once it holds `batch_size` elements
+// or once its padded size, in elements times the longest length in the batch,
+// would exceed `max_tokens_per_batch`.
+//
+// If `num_adaptive_buckets` is positive, the bucket boundaries are recomputed
+// from the histogram of the observed lengths each time the number of observed
+// elements doubles, so that the buckets hold equal numbers of elements.
+class BucketBySequenceLengthDatasetOp : public UnaryDatasetOpKernel {
+ public:
+  static constexpr const char* const kDatasetType = "BucketBySequenceLength";
+  static constexpr const char* const kInputDataset = "input_dataset";
+  static constexpr const char* const kBucketBoundaries = "bucket_boundaries";
+  static constexpr const char* const kBatchSize = "batch_size";
+  static constexpr const char* const kMaxTokensPerBatch =
+      "max_tokens_per_batch";
+  static constexpr const char* const kPaddingValues = "padding_values";
+  static constexpr const char* const kLengthComponent = "length_component";
+  static constexpr const char* const kNumAdaptiveBuckets =
+      "num_adaptive_buckets";
+  static constexpr const char* const kOutputTypes = "Toutput_types";
+  static constexpr const char* const kOutputShapes = "output_shapes";
+
+  explicit BucketBySequenceLengthDatasetOp(OpKernelConstruction* ctx);
+
+ protected:
+  void MakeDataset(OpKernelContext* ctx, DatasetBase* input,
+                   DatasetBase** output) override;
+
+ private:
+  class Dataset;
+  int64_t length_component_ = 0;
+  int64_t num_adaptive_buckets_ = 0;
+};
+
+// Returns strictly increasing bucket boundaries that split the lengths counted
+// in `length_counts` (length -> number of elements) into at most `num_buckets`
+// buckets holding about the same number of elements. Bucket `i` holds the
+// lengths in [boundaries[i - 1], boundaries[i]).
+std::vector<int64_t> ComputeBucketBoundaries(
+    const std::map<int64_t, int64_t>& length_counts, int64_t num_buckets);
+
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_BUCKET_BY_SEQUENCE_LENGTH_DATASET_OP_H_
@@ -0,0 +1,400 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/bucket_by_sequence_length_dataset_op.h"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/core/data/dataset_test_base.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+constexpr char kNodeName[] = "bucket_by_sequence_length_dataset";
+
+class BucketBySequenceLengthDatasetParams : public DatasetParams {
+ public:
+  template <typename T>
+  BucketBySequenceLengthDatasetParams(
+      T input_dataset_params, std::vector<int64_t> bucket_boundaries,
+      int64_t batch_size, int64_t max_tokens_per_batch,
+      std::vector<Tensor> padding_values, int64_t length_component,
+      int64_t num_adaptive_buckets, DataTypeVector output_dtypes,
+      std::vector<PartialTensorShape> output_shapes, string node_name)
+      : DatasetParams(std::move(output_dtypes), std::move(output_shapes),
+                      std::move(node_name)),
+        bucket_boundaries_(std::move(bucket_boundaries)),
+        batch_size_(batch_size),
+        max_tokens_per_batch_(max_tokens_per_batch),
+        padding_values_(std::move(padding_values)),
+        length_component_(length_component),
+        num_adaptive_buckets_(num_adaptive_buckets) {
+    input_dataset_params_.push_back(std::make_unique<T>(input_dataset_params));
+    iterator_prefix_ =
+        name_utils::IteratorPrefix(input_dataset_params.dataset_type(),
+                                   input_dataset_params.iterator_prefix());
+  }
+
+  std::vector<Tensor> GetInputTensors() const override {
+    std::vector<Tensor> input_tensors = {
+        CreateTensor<int64_t>(
+            TensorShape({static_cast<int64_t>(bucket_boundaries_.size())}),
+            bucket_boundaries_),
+        CreateTensor<int64_t>(TensorShape({}), {batch_size_}),
+        CreateTensor<int64_t>(TensorShape({}), {max_tokens_per_batch_})};
+    for (const Tensor& padding_value : padding_values_) {
+      input_tensors.push_back(padding_value);
+    }
+    return input_tensors;
+  }
+
+  Status GetInputNames(std::vector<string>* input_names) const override {
+    *input_names = {BucketBySequenceLengthDatasetOp::kInputDataset,
+                    BucketBySequenceLengthDatasetOp::kBucketBoundaries,
+                    BucketBySequenceLengthDatasetOp::kBatchSize,
+                    BucketBySequenceLengthDatasetOp::kMaxTokensPerBatch};
+    for (int i = 0; i < padding_values_.size(); ++i) {
+      input_names->push_back(strings::StrCat(
+          BucketBySequenceLengthDatasetOp::kPaddingValues, "_", i));
+    }
+    return absl::OkStatus();
+  }
+
+  Status GetAttributes(AttributeVector* attr_vector) const override {
+    *attr_vector = {{"length_component", length_component_},
+                    {"num_adaptive_buckets", num_adaptive_buckets_},
+                    {"Toutput_types", output_dtypes_},
+                    {"output_shapes", output_shapes_},
+                    {"metadata", ""}};
+    return absl::OkStatus();
+  }
+
+  string dataset_type() const override {
+    return BucketBySequenceLengthDatasetOp::kDatasetType;
+  }
+
+ private:
+  std::vector<int64_t> bucket_boundaries_;
+  int64_t batch_size_;
+  int64_t max_tokens_per_batch_;
+  std::vector<Tensor> padding_values_;
+  int64_t length_component_;
+  int64_t num_adaptive_buckets_;
+};
+
+class BucketBySequenceLengthDatasetOpTest : public DatasetOpsTestBase {};
+
+// Three sequences of length 1 followed by three sequences of length 3:
+// [1], [2], [3], [4, 5, 6], [7, 8, 9], [10, 11, 12].
+ConcatenateDatasetParams SequencesParams() {
+  auto short_sequences = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(TensorShape{3, 1}, {{1, 2, 3}}),
+      /*node_name=*/"tensor_slice_0");
+  auto long_sequences = TensorSliceDatasetParams(
+      /*components=*/CreateTensors<int64_t>(
+          TensorShape{3, 3}, {{4, 5, 6, 7, 8, 9, 10, 11, 12}}),
+      /*node_name=*/"tensor_slice_1");
+  return ConcatenateDatasetParams(std::move(short_sequences),
+                                  std::move(long_sequences),
+                                  /*output_dtypes=*/{DT_INT64},
+                                  /*output_shapes=*/{PartialTensorShape({-1})},
+                                  /*node_name=*/"concatenate");
+}
+
+std::vector<int64_t> Iota(int64_t start, int64_t size) {
+  std::vector<int64_t> values(size);
+  for (int64_t i = 0; i < size; ++i) {
+    values[i] = start + i;
+  }
+  return values;
+}
+
+// 200 sequences of length 1, then 28 of length 3, 100 of length 1 and 4 of
+// length 3. The bucket boundaries are first adapted at the 256th sequence,
+// while the last 55 sequences are buffered.
+ConcatenateDatasetParams AdaptiveSequencesParams() {
+  auto leading_sequences = ConcatenateDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64_t>(TensorShape{200, 1},
+                                                Iota(0, 200))},
+          /*node_name=*/"tensor_slice_0"),
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64_t>(TensorShape{28, 3},
+                                                Iota(1000, 84))},
+          /*node_name=*/"tensor_slice_1"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1})},
+      /*node_name=*/"concatenate_0");
+  auto trailing_sequences = ConcatenateDatasetParams(
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64_t>(TensorShape{100, 1},
+                                                Iota(2000, 100))},
+          /*node_name=*/"tensor_slice_2"),
+      TensorSliceDatasetParams(
+          /*components=*/{CreateTensor<int64_t>(TensorShape{4, 3},
+                                                Iota(3000, 12))},
+          /*node_name=*/"tensor_slice_3"),
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1})},
+      /*node_name=*/"concatenate_1");
+  return ConcatenateDatasetParams(std::move(leading_sequences),
+                                  std::move(trailing_sequences),
+                                  /*output_dtypes=*/{DT_INT64},
+                                  /*output_shapes=*/{PartialTensorShape({-1})},
+                                  /*node_name=*/"concatenate");
+}
+
+BucketBySequenceLengthDatasetParams MakeParams(
+    std::vector<int64_t> bucket_boundaries, int64_t batch_size,
+    int64_t max_tokens_per_batch) {
+  return BucketBySequenceLengthDatasetParams(
+      SequencesParams(), std::move(bucket_boundaries), batch_size,
+      max_tokens_per_batch,
+      /*padding_values=*/{CreateTensor<int64_t>(TensorShape{}, {-1})},
+      /*length_component=*/0,
+      /*num_adaptive_buckets=*/0,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})},
+      /*node_name=*/kNodeName);
+}
+
+// Buckets [0, 2) and [2, inf) with batches of two elements.
+BucketBySequenceLengthDatasetParams FixedBoundariesParams() {
+  return MakeParams(/*bucket_boundaries=*/{2}, /*batch_size=*/2,
+                    /*max_tokens_per_batch=*/-1);
+}
+
+// A single bucket whose batches hold at most 12 tokens, padding included.
+BucketBySequenceLengthDatasetParams TokenBudgetParams() {
+  return MakeParams(/*bucket_boundaries=*/{}, /*batch_size=*/10,
+                    /*max_tokens_per_batch=*/12);
+}
+
+// Elements longer than the token budget form batches on their own.
+BucketBySequenceLengthDatasetParams SmallTokenBudgetParams() {
+  return MakeParams(/*bucket_boundaries=*/{}, /*batch_size=*/10,
+                    /*max_tokens_per_batch=*/2);
+}
+
+// Starts with a single bucket, which is split in two once 256 sequences have
+// been seen.
+BucketBySequenceLengthDatasetParams AdaptiveBoundariesParams() {
+  return BucketBySequenceLengthDatasetParams(
+      AdaptiveSequencesParams(), /*bucket_boundaries=*/{}, /*batch_size=*/100,
+      /*max_tokens_per_batch=*/-1,
+      /*padding_values=*/{CreateTensor<int64_t>(TensorShape{}, {-1})},
+      /*length_component=*/0,
+      /*num_adaptive_buckets=*/2,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})},
+      /*node_name=*/kNodeName);
+}
+
+// Once the boundaries are adapted, the buffered and following sequences of
+// length 1 and 3 are batched apart.
+std::vector<Tensor> AdaptiveBoundariesOutputs() {
+  std::vector<int64_t> long_sequences = Iota(1000, 84);
+  std::vector<int64_t> last_sequences = Iota(3000, 12);
+  long_sequences.insert(long_sequences.end(), last_sequences.begin(),
+                        last_sequences.end());
+  return {CreateTensor<int64_t>(TensorShape{100, 1}, Iota(0, 100)),
+          CreateTensor<int64_t>(TensorShape{100, 1}, Iota(100, 100)),
+          CreateTensor<int64_t>(TensorShape{100, 1}, Iota(2000, 100)),
+          CreateTensor<int64_t>(TensorShape{32, 3}, long_sequences)};
+}
+
+BucketBySequenceLengthDatasetParams InvalidBatchSizeParams() {
+  return MakeParams(/*bucket_boundaries=*/{2}, /*batch_size=*/0,
+                    /*max_tokens_per_batch=*/-1);
+}
+
+BucketBySequenceLengthDatasetParams DecreasingBoundariesParams() {
+  return MakeParams(/*bucket_boundaries=*/{3, 2}, /*batch_size=*/2,
+                    /*max_tokens_per_batch=*/-1);
+}
+
+BucketBySequenceLengthDatasetParams InvalidLengthComponentParams() {
+  return BucketBySequenceLengthDatasetParams(
+      SequencesParams(), /*bucket_boundaries=*/{2}, /*batch_size=*/2,
+      /*max_tokens_per_batch=*/-1,
+      /*padding_values=*/{CreateTensor<int64_t>(TensorShape{}, {-1})},
+      /*length_component=*/1,
+      /*num_adaptive_buckets=*/0,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})},
+      /*node_name=*/kNodeName);
+}
+
+BucketBySequenceLengthDatasetParams InvalidPaddingValueDTypeParams() {
+  return BucketBySequenceLengthDatasetParams(
+      SequencesParams(), /*bucket_boundaries=*/{2}, /*batch_size=*/2,
+      /*max_tokens_per_batch=*/-1,
+      /*padding_values=*/{CreateTensor<int32>(TensorShape{}, {-1})},
+      /*length_component=*/0,
+      /*num_adaptive_buckets=*/0,
+      /*output_dtypes=*/{DT_INT64},
+      /*output_shapes=*/{PartialTensorShape({-1, -1})},
+      /*node_name=*/kNodeName);
+}
+
+std::vector<GetNextTestCase<BucketBySequenceLengthDatasetParams>>
+GetNextTestCases() {
+  return {
+      {/*dataset_params=*/FixedBoundariesParams(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {1, 2}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {4, 5, 6, 7, 8, 9}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {10, 11, 12})}},
+      {/*dataset_params=*/TokenBudgetParams(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{4, 3},
+                              {1, -1, -1, 2, -1, -1, 3, -1, -1, 4, 5, 6}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {7, 8, 9, 10, 11, 12})}},
+      {/*dataset_params=*/SmallTokenBudgetParams(),
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {1, 2}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {4, 5, 6}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {7, 8, 9}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {10, 11, 12})}},
+      {/*dataset_params=*/AdaptiveBoundariesParams(),
+       /*expected_outputs=*/AdaptiveBoundariesOutputs()}};
+}
+
+ITERATOR_GET_NEXT_TEST_P(BucketBySequenceLengthDatasetOpTest,
+                         BucketBySequenceLengthDatasetParams,
+                         GetNextTestCases())
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetNodeName) {
+  auto dataset_params = FixedBoundariesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetNodeName(dataset_params.node_name()));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetTypeString) {
+  auto dataset_params = FixedBoundariesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetTypeString(
+      name_utils::OpName(BucketBySequenceLengthDatasetOp::kDatasetType)));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, DatasetOutputShapes) {
+  auto dataset_params = FixedBoundariesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetOutputShapes({PartialTensorShape({-1, -1})}));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, Cardinality) {
+  auto dataset_params = TokenBudgetParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckDatasetCardinality(kUnknownCardinality));
+}
+
+TEST_F(BucketBySequenceLengthDatasetOpTest, IteratorPrefix) {
+  auto dataset_params = FixedBoundariesParams();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  TF_ASSERT_OK(CheckIteratorPrefix(
+      name_utils::IteratorPrefix(BucketBySequenceLengthDatasetOp::kDatasetType,
+                                 dataset_params.iterator_prefix())));
+}
+
+std::vector<IteratorSaveAndRestoreTestCase<BucketBySequenceLengthDatasetParams>>
+IteratorSaveAndRestoreTestCases() {
+  return {
+      {/*dataset_params=*/FixedBoundariesParams(),
+       /*breakpoints=*/{0, 1, 3, 5},
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{2, 1}, {1, 2}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {4, 5, 6, 7, 8, 9}),
+        CreateTensor<int64_t>(TensorShape{1, 1}, {3}),
+        CreateTensor<int64_t>(TensorShape{1, 3}, {10, 11, 12})}},
+      {/*dataset_params=*/TokenBudgetParams(),
+       /*breakpoints=*/{0, 1, 3},
+       /*expected_outputs=*/
+       {CreateTensor<int64_t>(TensorShape{4, 3},
+                              {1, -1, -1, 2, -1, -1, 3, -1, -1, 4, 5, 6}),
+        CreateTensor<int64_t>(TensorShape{2, 3}, {7, 8, 9, 10, 11, 12})}},
+      // Breakpoint 2 saves the length histogram before the boundaries are
+      // adapted, and breakpoint 3 the adapted boundaries and buckets.
+      {/*dataset_params=*/AdaptiveBoundariesParams(),
+       /*breakpoints=*/{0, 2, 3, 5},
+       /*expected_outputs=*/AdaptiveBoundariesOutputs()}};
+}
+
+ITERATOR_SAVE_AND_RESTORE_TEST_P(BucketBySequenceLengthDatasetOpTest,
+                                 BucketBySequenceLengthDatasetParams,
+                                 IteratorSaveAndRestoreTestCases())
+
+class ParameterizedInvalidArgumentTest
+    : public BucketBySequenceLengthDatasetOpTest,
+      public ::testing::WithParamInterface<
+          BucketBySequenceLengthDatasetParams> {};
+
+TEST_P(ParameterizedInvalidArgumentTest, InvalidArguments) {
+  auto dataset_params = GetParam();
+  EXPECT_EQ(Initialize(dataset_params).code(),
+            absl::StatusCode::kInvalidArgument);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BucketBySequenceLengthDatasetOpTest, ParameterizedInvalidArgumentTest,
+    ::testing::ValuesIn({InvalidBatchSizeParams(), DecreasingBoundariesParams(),
+                         InvalidLengthComponentParams(),
+                         InvalidPaddingValueDTypeParams()}));
+
+TEST(ComputeBucketBoundariesTest, EqualFrequencyBuckets) {
+  std::map<int64_t, int64_t> length_counts;
+  for (int64_t length = 1; length <= 8; ++length) {
+    length_counts[length] = 1;
+  }
+  EXPECT_THAT(ComputeBucketBoundaries(length_counts, /*num_buckets=*/4),
+              ElementsAre(3, 5, 7));
+  EXPECT_THAT(ComputeBucketBoundaries(length_counts, /*num_buckets=*/2),
+              ElementsAre(5));
+}
+
+TEST(ComputeBucketBoundariesTest, SkewedLengths) {
+  // Most sequences are short, so the short lengths get their own buckets.
+  std::map<int64_t, int64_t> length_counts = {
+      {10, 40}, {11, 30}, {12, 10}, {100, 10}, {500, 10}};
+  EXPECT_THAT(ComputeBucketBoundaries(length_counts, /*num_buckets=*/4),
+              ElementsAre(11, 12, 13));
+}
+
+TEST(ComputeBucketBoundariesTest, FewerLengthsThanBuckets) {
+  std::map<int64_t, int64_t> length_counts = {{5, 100}, {7, 1}};
+  EXPECT_THAT(ComputeBucketBoundaries(length_counts, /*num_buckets=*/8),
+              ElementsAre(6));
+}
+
+TEST(ComputeBucketBoundariesTest, SingleBucket) {
+  std::map<int64_t, int64_t> length_counts = {{5, 100}, {7, 1}};
+  EXPECT_THAT(ComputeBucketBoundaries(length_counts, /*num_buckets=*/1),
+              IsEmpty());
+  EXPECT_THAT(ComputeBucketBoundaries({}, /*num_buckets=*/4), IsEmpty());
+}
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -15,7 +15,12 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/data/experimental/compression_ops.h"
 
+#include <cstdint>
+#include <vector>
+
+#include "tensorflow/core/data/compression_codecs.h"
 #include "tensorflow/core/data/compression_utils.h"
+#include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/variant.h"
 #include "tensorflow/core/platform/errors.h"
@@ -24,8 +29,26 @@ namespace tensorflow {
 namespace data {
 namespace experimental {
 
+namespace {
+
+int64_t UncompressedBytes(const CompressedElement& compressed) {
+  int64_t num_bytes = 0;
+  for (const auto& metadata : compressed.component_metadata()) {
+    for (int64_t component_bytes : metadata.uncompressed_bytes()) {
+      num_bytes += component_bytes;
+    }
+  }
+  return num_bytes;
+}
+
+}  // namespace
+
 CompressElementOp::CompressElementOp(OpKernelConstruction* ctx)
-    : OpKernel(ctx) {}
+    : OpKernel(ctx) {
+  if (GetExperiments().contains("compression_codec_autotune")) {
+    codec_selector_ = &CompressionCodecSelector::Global();
+  }
+}
 
 void CompressElementOp::Compute(OpKernelContext* ctx) {
   std::vector<Tensor> components;
@@ -33,7 +56,16 @@ void CompressElementOp::Compute(OpKernelContext* ctx) {
     components.push_back(ctx->input(i));
   }
   CompressedElement compressed;
-  OP_REQUIRES_OK(ctx, CompressElement(components, &compressed));
+  if (codec_selector_ == nullptr) {
+    OP_REQUIRES_OK(ctx, CompressElement(components, &compressed));
+  } else {
+    const CompressionCodec* codec = codec_selector_->Choose();
+    const uint64_t start_ns = ctx->env()->NowNanos();
+    OP_REQUIRES_OK(ctx, CompressElement(components, *codec, &compressed));
+    codec_selector_->Record(codec, UncompressedBytes(compressed),
+                            compressed.data().size(),
+                            ctx->env()->NowNanos() - start_ns);
+  }
 
   Tensor* output;
   OP_REQUIRES_OK(ctx, ctx->allocate_output(0, TensorShape({}), &output));
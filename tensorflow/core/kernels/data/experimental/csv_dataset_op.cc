@@ -16,6 +16,7 @@ limitations under the License.
 #include "tensorflow/core/framework/dataset.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/shape_inference.h"
+#include "tensorflow/core/kernels/data/experimental/csv_scanner.h"
 #include "tensorflow/core/lib/io/inputstream_interface.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
@@ -276,7 +277,9 @@ class CSVDatasetOp : public DatasetOpKernel {
     class Iterator : public DatasetIterator<Dataset> {
      public:
       explicit Iterator(const Params& params)
-          : DatasetIterator<Dataset>(params) {}
+          : DatasetIterator<Dataset>(params),
+            scanner_(params.dataset->delim_,
+                     params.dataset->use_quote_delim_) {}
 
       Status GetNextInternal(IteratorContext* ctx,
                              std::vector<Tensor>* out_tensors,
@@ -508,7 +511,7 @@ class CSVDatasetOp : public DatasetOpKernel {
         pos_++;  // Starting quotation mark
 
         Status parse_result;
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        while (true) {  // Each iter finds a quote, filling buffer if necessary
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             if (errors::IsOutOfRange(s)) {
@@ -520,8 +523,10 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
           }
 
-          char ch = buffer_[pos_];
-          if (ch == '"') {
+          // Only a quote can end a quoted field, so skip straight to the next
+          // one.
+          pos_ = scanner_.FindQuote(pos_);
+          if (pos_ < buffer_.size()) {
             // When we encounter a quote, we look ahead to the next character to
             // decide what to do
             pos_++;
@@ -560,9 +565,6 @@ class CSVDatasetOp : public DatasetOpKernel {
               parse_result.Update(errors::InvalidArgument(
                   "Quote inside a string has to be escaped by another quote"));
             }
-
-          } else {
-            pos_++;
           }
         }
       }
@@ -641,7 +643,7 @@ class CSVDatasetOp : public DatasetOpKernel {
         size_t start = pos_;
         Status parse_result;
 
-        while (true) {  // Each iter reads 1 char, filling buffer if necessary
+        while (true) {  // Each iter finds a special char, filling buffer if needed
           if (pos_ >= buffer_.size()) {
             Status s = SaveAndFillBuffer(&earlier_pieces, &start, include);
             // Handle errors
@@ -657,6 +659,13 @@ class CSVDatasetOp : public DatasetOpKernel {
             }
           }
 
+          // Skip straight to the next character that ends the field or makes
+          // it invalid.
+          pos_ = scanner_.FindUnquotedFieldEnd(pos_);
+          if (pos_ >= buffer_.size()) {
+            continue;
+          }
+
           char ch = buffer_[pos_];
 
           if (ch == dataset()->delim_) {
@@ -682,7 +691,7 @@ class CSVDatasetOp : public DatasetOpKernel {
             parse_result.Update(errors::InvalidArgument(
                 "Unquoted fields cannot have quotes inside"));
           }
-          // Otherwise, go to next character
+          // Otherwise, go past the quote
           pos_++;
         }
       }
@@ -692,6 +701,7 @@ class CSVDatasetOp : public DatasetOpKernel {
         ++num_buffer_reads_;
         Status s = input_stream_->ReadNBytes(
             dataset()->options_.input_buffer_size, result);
+        scanner_.Reset(*result);
 
         if (errors::IsOutOfRange(s) && !result->empty()) {
           // Ignore OutOfRange error when ReadNBytes read < N bytes.
@@ -894,6 +904,8 @@ class CSVDatasetOp : public DatasetOpKernel {
 
       mutex mu_;
       tstring buffer_ TF_GUARDED_BY(mu_);  // Maintain our own buffer
+      // Finds field boundaries in `buffer_`; reset whenever it is refilled.
+      CsvScanner scanner_ TF_GUARDED_BY(mu_);
       size_t pos_ TF_GUARDED_BY(
           mu_);  // Index into the buffer must be maintained between iters
       size_t num_buffer_reads_ TF_GUARDED_BY(mu_);
@@ -0,0 +1,161 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/csv_scanner.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/numeric/bits.h"
+#include "absl/strings/string_view.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+bool IsSpecial(char ch, char delim, char quote) {
+  return ch == delim || ch == '\n' || ch == '\r' || ch == quote;
+}
+
+// Returns the mask of special characters in the 64 bytes at `p`. A `quote` of
+// `delim` disables matching quotes without branching per block.
+uint64_t ClassifyFullBlock(const char* p, char delim, char quote) {
+#if defined(__AVX2__)
+  const __m256i vdelim = _mm256_set1_epi8(delim);
+  const __m256i vnewline = _mm256_set1_epi8('\n');
+  const __m256i vreturn = _mm256_set1_epi8('\r');
+  const __m256i vquote = _mm256_set1_epi8(quote);
+  uint64_t mask = 0;
+  for (int i = 0; i < 2; ++i) {
+    const __m256i block =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * i));
+    const __m256i matches = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, vdelim),
+                        _mm256_cmpeq_epi8(block, vnewline)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, vreturn),
+                        _mm256_cmpeq_epi8(block, vquote)));
+    mask |= static_cast<uint64_t>(
+                static_cast<uint32_t>(_mm256_movemask_epi8(matches)))
+            << (32 * i);
+  }
+  return mask;
+#elif defined(__SSE2__)
+  const __m128i vdelim = _mm_set1_epi8(delim);
+  const __m128i vnewline = _mm_set1_epi8('\n');
+  const __m128i vreturn = _mm_set1_epi8('\r');
+  const __m128i vquote = _mm_set1_epi8(quote);
+  uint64_t mask = 0;
+  for (int i = 0; i < 4; ++i) {
+    const __m128i block =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+    const __m128i matches = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, vdelim),
+                     _mm_cmpeq_epi8(block, vnewline)),
+        _mm_or_si128(_mm_cmpeq_epi8(block, vreturn),
+                     _mm_cmpeq_epi8(block, vquote)));
+    mask |= static_cast<uint64_t>(_mm_movemask_epi8(matches)) << (16 * i);
+  }
+  return mask;
+#else
+  uint64_t mask = 0;
+  for (int i = 0; i < 64; ++i) {
+    mask |= static_cast<uint64_t>(IsSpecial(p[i], delim, quote)) << i;
+  }
+  return mask;
+#endif
+}
+
+}  // namespace
+
+void CsvScanner::Reset(absl::string_view data) {
+  data_ = data;
+  block_start_ = kNoBlock;
+  block_mask_ = 0;
+}
+
+uint64_t CsvScanner::ClassifyBlock(size_t block_start) const {
+  const char quote = use_quote_delim_ ? '"' : delim_;
+  if (block_start + kBlockSize <= data_.size()) {
+    return ClassifyFullBlock(data_.data() + block_start, delim_, quote);
+  }
+  uint64_t mask = 0;
+  for (size_t i = block_start; i < data_.size(); ++i) {
+    mask |= static_cast<uint64_t>(IsSpecial(data_[i], delim_, quote))
+            << (i - block_start);
+  }
+  return mask;
+}
+
+size_t CsvScanner::FindUnquotedFieldEnd(size_t pos) {
+#if !defined(__AVX2__) && !defined(__SSE2__)
+  // Without SIMD, building masks a byte at a time is slower than scanning.
+  return internal::FindUnquotedFieldEndScalar(data_, pos, delim_,
+                                              use_quote_delim_);
+#endif
+  if (pos >= data_.size()) {
+    return data_.size();
+  }
+  size_t block_start = pos - pos % kBlockSize;
+  if (block_start != block_start_) {
+    block_start_ = block_start;
+    block_mask_ = ClassifyBlock(block_start);
+  }
+  uint64_t mask = block_mask_ & (~uint64_t{0} << (pos - block_start));
+  while (mask == 0) {
+    block_start += kBlockSize;
+    if (block_start >= data_.size()) {
+      return data_.size();
+    }
+    block_start_ = block_start;
+    block_mask_ = ClassifyBlock(block_start);
+    mask = block_mask_;
+  }
+  return block_start + absl::countr_zero(mask);
+}
+
+size_t CsvScanner::FindQuote(size_t pos) const {
+  if (pos >= data_.size()) {
+    return data_.size();
+  }
+  const void* quote =
+      std::memchr(data_.data() + pos, '"', data_.size() - pos);
+  if (quote == nullptr) {
+    return data_.size();
+  }
+  return static_cast<const char*>(quote) - data_.data();
+}
+
+namespace internal {
+
+size_t FindUnquotedFieldEndScalar(absl::string_view data, size_t pos,
+                                  char delim, bool use_quote_delim) {
+  const char quote = use_quote_delim ? '"' : delim;
+  for (; pos < data.size(); ++pos) {
+    if (IsSpecial(data[pos], delim, quote)) {
+      return pos;
+    }
+  }
+  return data.size();
+}
+
+}  // namespace internal
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -0,0 +1,85 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_CSV_SCANNER_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_CSV_SCANNER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/strings/string_view.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+
+// Finds CSV field boundaries in a buffer many bytes at a time.
+//
+// The scanner classifies the buffer in 64-byte blocks. Each block is compared
+// against the delimiter, '\n', '\r' and (if quoting is enabled) '"' with SIMD
+// instructions (AVX2 when the binary is built with it, SSE2 otherwise on x86)
+// to produce a 64-bit mask of the positions that can end an unquoted field.
+// The mask of the current block is cached, so consecutive short fields are
+// found with a count-trailing-zeros instead of another pass over their bytes.
+// Other platforms fall back to a scalar loop.
+//
+// Not thread-safe.
+class CsvScanner {
+ public:
+  CsvScanner(char delim, bool use_quote_delim)
+      : delim_(delim), use_quote_delim_(use_quote_delim) {}
+
+  // Starts scanning `data`, which must stay alive and unmodified until the
+  // next call to `Reset`.
+  void Reset(absl::string_view data);
+
+  // Returns the position of the first character at or after `pos` that ends
+  // or invalidates an unquoted field: the delimiter, '\n', '\r', or (if
+  // quoting is enabled) '"'. Returns the size of the data if there is none.
+  size_t FindUnquotedFieldEnd(size_t pos);
+
+  // Returns the position of the first '"' at or after `pos`, or the size of
+  // the data if there is none. Inside a quoted field, only a quote can end the
+  // field.
+  size_t FindQuote(size_t pos) const;
+
+ private:
+  static constexpr size_t kBlockSize = 64;
+  static constexpr size_t kNoBlock = ~size_t{0};
+
+  // Returns the mask of special characters in the block starting at
+  // `block_start`.
+  uint64_t ClassifyBlock(size_t block_start) const;
+
+  const char delim_;
+  const bool use_quote_delim_;
+  absl::string_view data_;
+  // Start of the block whose mask is cached in `block_mask_`.
+  size_t block_start_ = kNoBlock;
+  uint64_t block_mask_ = 0;
+};
+
+namespace internal {
+
+// Scalar reference implementation of `CsvScanner::FindUnquotedFieldEnd`,
+// exposed for testing and benchmarking.
+size_t FindUnquotedFieldEndScalar(absl::string_view data, size_t pos,
+                                  char delim, bool use_quote_delim);
+
+}  // namespace internal
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_EXPERIMENTAL_CSV_SCANNER_H_
@@ -0,0 +1,188 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/experimental/csv_scanner.h"
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/lib/random/philox_random.h"
+#include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace experimental {
+namespace {
+
+// Returns the end of the unquoted field starting at `pos` in `data`.
+size_t FieldEnd(absl::string_view data, size_t pos, char delim = ',',
+                bool use_quote_delim = true) {
+  CsvScanner scanner(delim, use_quote_delim);
+  scanner.Reset(data);
+  return scanner.FindUnquotedFieldEnd(pos);
+}
+
+TEST(CsvScannerTest, FindUnquotedFieldEnd) {
+  EXPECT_EQ(FieldEnd("", 0), 0);
+  EXPECT_EQ(FieldEnd("abc", 0), 3);
+  EXPECT_EQ(FieldEnd("abc,def", 0), 3);
+  EXPECT_EQ(FieldEnd("abc,def", 4), 7);
+  EXPECT_EQ(FieldEnd("abc\ndef", 0), 3);
+  EXPECT_EQ(FieldEnd("abc\r\ndef", 0), 3);
+  EXPECT_EQ(FieldEnd("abc\r\ndef", 4), 4);
+  EXPECT_EQ(FieldEnd("ab\"c,def", 0), 2);
+  EXPECT_EQ(FieldEnd("ab\"c,def", 0, ',', /*use_quote_delim=*/false), 4);
+  EXPECT_EQ(FieldEnd("abc,def|ghi", 0, '|'), 7);
+  EXPECT_EQ(FieldEnd("abc", 5), 3);
+}
+
+TEST(CsvScannerTest, FindUnquotedFieldEndAcrossBlocks) {
+  const std::string field(200, 'x');
+  EXPECT_EQ(FieldEnd(field, 0), field.size());
+  for (size_t i = 0; i < field.size(); ++i) {
+    std::string data = field;
+    data[i] = ',';
+    EXPECT_EQ(FieldEnd(data, 0), i);
+    EXPECT_EQ(FieldEnd(data, i), i);
+    EXPECT_EQ(FieldEnd(data, i + 1), data.size());
+  }
+}
+
+TEST(CsvScannerTest, ResetDiscardsCachedBlock) {
+  CsvScanner scanner(',', /*use_quote_delim=*/true);
+  std::string data = "abc,def";
+  scanner.Reset(data);
+  EXPECT_EQ(scanner.FindUnquotedFieldEnd(0), 3);
+  data = "abcdef,";
+  scanner.Reset(data);
+  EXPECT_EQ(scanner.FindUnquotedFieldEnd(0), 6);
+}
+
+TEST(CsvScannerTest, MatchesScalarImplementation) {
+  random::PhiloxRandom philox(42);
+  random::SimplePhilox rng(&philox);
+  constexpr absl::string_view kAlphabet = "ab1.,;|\"\n\r";
+  for (int trial = 0; trial < 200; ++trial) {
+    std::string data(rng.Uniform(300), 'x');
+    for (char& ch : data) {
+      // Keep special characters sparse so that matches land in later blocks.
+      if (rng.Uniform(16) == 0) {
+        ch = kAlphabet[rng.Uniform(kAlphabet.size())];
+      }
+    }
+    for (char delim : {',', ';', '|'}) {
+      for (bool use_quote_delim : {false, true}) {
+        CsvScanner scanner(delim, use_quote_delim);
+        scanner.Reset(data);
+        // Walk forward the way the CSV reader does, so that the cached block
+        // is reused across calls.
+        for (size_t pos = 0; pos <= data.size(); ++pos) {
+          ASSERT_EQ(scanner.FindUnquotedFieldEnd(pos),
+                    internal::FindUnquotedFieldEndScalar(data, pos, delim,
+                                                         use_quote_delim))
+              << absl::StrCat("data: ", data, " pos: ", pos,
+                              " delim: ", std::string(1, delim));
+        }
+      }
+    }
+  }
+}
+
+TEST(CsvScannerTest, FindQuote) {
+  CsvScanner scanner(',', /*use_quote_delim=*/true);
+  scanner.Reset("abc\"\"def\"");
+  EXPECT_EQ(scanner.FindQuote(0), 3);
+  EXPECT_EQ(scanner.FindQuote(4), 4);
+  EXPECT_EQ(scanner.FindQuote(5), 8);
+  EXPECT_EQ(scanner.FindQuote(9), 9);
+  scanner.Reset("abc,def\n");
+  EXPECT_EQ(scanner.FindQuote(0), 8);
+}
+
+// Returns a synthetic CSV file with `num_columns` numeric columns per row.
+std::string WideCsv(int num_columns, bool quoted, size_t size) {
+  std::string row;
+  for (int i = 0; i < num_columns; ++i) {
+    if (i > 0) {
+      absl::StrAppend(&row, ",");
+    }
+    absl::StrAppend(&row, quoted ? "\"" : "", i * 0.25, quoted ? "\"" : "");
+  }
+  absl::StrAppend(&row, "\n");
+  std::string file;
+  while (file.size() < size) {
+    absl::StrAppend(&file, row);
+  }
+  return file;
+}
+
+// Walks every field of `file` the way `CSVDatasetOp` does, using either the
+// scanner or the scalar reference for unquoted fields.
+template <bool kScalar>
+size_t ScanFields(absl::string_view file) {
+  CsvScanner scanner(',', /*use_quote_delim=*/true);
+  scanner.Reset(file);
+  size_t num_fields = 0;
+  size_t pos = 0;
+  while (pos < file.size()) {
+    if (file[pos] == '"') {
+      // Skip the quoted field, including its closing quote.
+      pos = scanner.FindQuote(pos + 1) + 1;
+    } else {
+      pos = kScalar ? internal::FindUnquotedFieldEndScalar(file, pos, ',', true)
+                    : scanner.FindUnquotedFieldEnd(pos);
+    }
+    ++pos;  // The delimiter or newline.
+    ++num_fields;
+  }
+  return num_fields;
+}
+
+template <bool kScalar>
+void BM_ScanWideCsv(::testing::benchmark::State& state) {
+  const std::string file =
+      WideCsv(/*num_columns=*/state.range(0), /*quoted=*/state.range(1),
+              /*size=*/16 << 20);
+  for (auto s : state) {
+    ::testing::DoNotOptimize(ScanFields<kScalar>(file));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          file.size());
+}
+
+void BM_ScanWideCsvSimd(::testing::benchmark::State& state) {
+  BM_ScanWideCsv</*kScalar=*/false>(state);
+}
+
+void BM_ScanWideCsvScalar(::testing::benchmark::State& state) {
+  BM_ScanWideCsv</*kScalar=*/true>(state);
+}
+
+BENCHMARK(BM_ScanWideCsvSimd)
+    ->ArgPair(100, false)
+    ->ArgPair(1000, false)
+    ->ArgPair(1000, true);
+BENCHMARK(BM_ScanWideCsvScalar)
+    ->ArgPair(100, false)
+    ->ArgPair(1000, false)
+    ->ArgPair(1000, true);
+
+}  // namespace
+}  // namespace experimental
+}  // namespace data
+}  // namespace tensorflow
@@ -40,6 +40,7 @@ limitations under the License.
 #include "tensorflow/core/data/service/common.h"
 #include "tensorflow/core/data/service/common.pb.h"
 #include "tensorflow/core/data/service/dispatcher.pb.h"
+#include "tensorflow/core/data/service/shm_data_transfer.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -122,7 +123,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
       std::unique_ptr<CapturedFunction> captured_uncompress_func,
       const std::optional<CrossTrainerCacheOptions>&
           cross_trainer_cache_options,
-      const DataTypeVector& output_types,
+      bool uncompress_in_client, const DataTypeVector& output_types,
       const std::vector<PartialTensorShape>& output_shapes)
       : DatasetBase(DatasetContext(ctx)),
         op_version_(op_version),
@@ -145,6 +146,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
         resource_mgr_(ctx->resource_manager()),
         captured_uncompress_func_(std::move(captured_uncompress_func)),
         cross_trainer_cache_options_(cross_trainer_cache_options),
+        uncompress_in_client_(uncompress_in_client),
         output_types_(output_types),
         output_shapes_(output_shapes) {}
 
@@ -171,7 +173,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
                           num_consumers_, consumer_index_,
                           max_outstanding_requests_, task_refresh_interval_,
                           target_workers_, metadata_,
-                          cross_trainer_cache_options_});
+                          cross_trainer_cache_options_, uncompress_in_client_});
   }
 
   const DataTypeVector& output_dtypes() const override { return output_types_; }
@@ -515,6 +517,7 @@ class DataServiceDatasetOp::Dataset : public DatasetBase {
   ResourceMgr* const resource_mgr_;  // Not owned
   const std::unique_ptr<CapturedFunction> captured_uncompress_func_;
   const std::optional<CrossTrainerCacheOptions> cross_trainer_cache_options_;
+  const bool uncompress_in_client_;
   const DataTypeVector output_types_;
   const std::vector<PartialTensorShape> output_shapes_;
 };
@@ -712,6 +715,11 @@ void DataServiceDatasetOp::MakeDataset(OpKernelContext* ctx,
         *compression_disabled_at_runtime);
     should_uncompress = should_uncompress && !*compression_disabled_at_runtime;
   }
+  // The "shm" transfer server uncompresses elements on the worker, so the
+  // client only uncompresses the elements of tasks that fall back to gRPC.
+  const bool uncompress_in_client =
+      should_uncompress && data_transfer_protocol_ == kShmTransferProtocol;
+  should_uncompress = should_uncompress && !uncompress_in_client;
 
   DataTypeVector data_service_output_types = output_types_;
   std::vector<PartialTensorShape> data_service_output_shapes = output_shapes_;
@@ -740,7 +748,8 @@ void DataServiceDatasetOp::MakeDataset(OpKernelContext* ctx,
       max_outstanding_requests, task_refresh_interval_hint_, target_workers_,
       *metadata, iteration_counter, owns_resource, iteration_counter_handle,
       std::move(captured_uncompress_func), cross_trainer_cache_options,
-      data_service_output_types, data_service_output_shapes);
+      uncompress_in_client, data_service_output_types,
+      data_service_output_shapes);
   if (should_uncompress) {
     VLOG(2) << "Inserting a ParallelMap dataset to uncompress tf.data service "
             << "dataset " << dataset_id << ".";
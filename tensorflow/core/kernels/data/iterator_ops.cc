@@ -36,6 +36,7 @@ limitations under the License.
 #include "tensorflow/core/framework/cancellation.h"
 #include "tensorflow/core/framework/dataset_options.pb.h"
 #include "tensorflow/core/framework/function.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/model.pb.h"
 #include "tensorflow/core/framework/op_kernel.h"
@@ -72,6 +73,11 @@ const char kIteratorVariantTypeName[] = "tensorflow::Iterator";
 const char kOutputShapes[] = "output_shapes";
 const char kOutputTypes[] = "output_types";
 
+// One in this many elements of a NUMA-aware iterator is checked for bytes
+// residing on a NUMA node other than the consumer's. The sampled count is
+// scaled by the interval.
+constexpr int64_t kCrossNumaNodeSamplingInterval = 100;
+
 bool SymbolicCheckpointEnabled(const Options& options) {
   return options.optional_symbolic_checkpoint_case() ==
              Options::kSymbolicCheckpoint &&
@@ -147,6 +153,18 @@ Status IteratorResource::GetNext(OpKernelContext* ctx,
   const int64_t get_next_latency_micros =
       env_.NowMicros() - absl::ToUnixMicros(start_time);
   tf_dataz_metrics_collector_->RecordGetNextLatency(get_next_latency_micros);
+  if (status.ok() && !*end_of_sequence &&
+      ShouldUseNumaAwareness(dataset->options()) && NumaAllocationEnabled() &&
+      num_numa_aware_elements_.fetch_add(1, std::memory_order_relaxed) %
+              kCrossNumaNodeSamplingInterval ==
+          0) {
+    const int64_t cross_numa_node_bytes =
+        CrossNumaNodeBytes(*out_tensors, ConsumerNumaNode(*ctx->device())) *
+        kCrossNumaNodeSamplingInterval;
+    tf_dataz_metrics_collector_->RecordCrossNumaNodeBytes(
+        cross_numa_node_bytes);
+    metrics::RecordTFDataCrossNumaNodeBytesFetched(cross_numa_node_bytes);
+  }
   captured_state->MergeCheckpoint(iter_ctx.checkpoint());
   return status;
 }
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_DATA_ITERATOR_OPS_H_
 #define TENSORFLOW_CORE_KERNELS_DATA_ITERATOR_OPS_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -154,6 +156,10 @@ class IteratorResource : public ResourceBase {
   IteratorMetricsCollector metrics_collector_;
   std::shared_ptr<TfDatazMetricsCollector> tf_dataz_metrics_collector_;
   UnboundedThreadPool unbounded_thread_pool_;
+  // Number of elements returned by a NUMA-aware iterator. Querying the NUMA
+  // node of a buffer is a system call, so only every
+  // `kCrossNumaNodeSamplingInterval`-th element is checked.
+  std::atomic<int64_t> num_numa_aware_elements_ = 0;
 
   mutex mu_;
   const Env& env_;
@@ -15,12 +15,16 @@ limitations under the License.
 #include "tensorflow/core/kernels/data/prefetch_dataset_op.h"
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/element_ring.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/stats_utils.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -64,19 +68,24 @@ constexpr char kStatus[] = "status";
 constexpr char kSizeSuffix[] = ".size";
 constexpr char kCodeSuffix[] = ".code";
 constexpr char kErrorMessageSuffix[] = ".error_message";
+// Maximum number of elements buffered in an element ring. Autotuned buffers
+// that use an element ring do not grow beyond this limit.
+constexpr int64_t kMaxElementRingCapacity = 1024;
 
 }  // namespace
 
 class PrefetchDatasetOp::Dataset : public DatasetBase {
  public:
   Dataset(OpKernelContext* ctx, const DatasetBase* input, int64_t buffer_size,
-          int64_t slack_period, bool legacy_autotune, int64_t buffer_size_min)
+          int64_t slack_period, bool legacy_autotune, int64_t buffer_size_min,
+          bool use_element_ring)
       : DatasetBase(DatasetContext(ctx)),
         input_(input),
         buffer_size_(buffer_size),
         slack_period_(slack_period),
         legacy_autotune_(legacy_autotune),
-        buffer_size_min_(buffer_size_min) {
+        buffer_size_min_(buffer_size_min),
+        use_element_ring_(use_element_ring) {
     input_->Ref();
     random_indexing_compatible_ = absl::OkStatus();
     if (input_ != nullptr) {
@@ -166,6 +175,16 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
               legacy_autotune_ ? 0 : params.dataset->buffer_size_, mu_,
               cond_var_)) {
       slack_us_ = 0;
+      const int64_t buffer_size = params.dataset->buffer_size_;
+      if (params.dataset->use_element_ring_) {
+        if (buffer_size == model::kAutotune) {
+          ring_ = std::make_unique<ElementRing<std::unique_ptr<BufferElement>>>(
+              kMaxElementRingCapacity);
+        } else if (buffer_size > 0 && buffer_size <= kMaxElementRingCapacity) {
+          ring_ = std::make_unique<ElementRing<std::unique_ptr<BufferElement>>>(
+              buffer_size);
+        }
+      }
     }
 
     ~Iterator() override {
@@ -208,21 +227,29 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       {
         mutex_lock l(*mu_);
         TF_RETURN_IF_ERROR(EnsureThreadsStarted(ctx));
-        // Wait until the next element in the buffer has been
-        // produced, or we are shutting down.
-        while (buffer_.empty() && !prefetch_thread_finished_ &&
-               buffer_limit() != 0) {
-          if (legacy_autotune_) {
-            auto_tuner_->RecordEmpty();
-            buffer_size_->value = auto_tuner_->buffer_limit();
+        if (ring_) {
+          std::unique_ptr<BufferElement> element;
+          if (WaitForRingElement(ctx, l, &element)) {
+            return ConsumeRingElement(ctx, *element, out_tensors,
+                                      end_of_sequence);
+          }
+        } else {
+          // Wait until the next element in the buffer has been
+          // produced, or we are shutting down.
+          while (buffer_.empty() && !prefetch_thread_finished_ &&
+                 buffer_limit() != 0) {
+            if (legacy_autotune_) {
+              auto_tuner_->RecordEmpty();
+              buffer_size_->value = auto_tuner_->buffer_limit();
+            }
+            RecordStop(ctx);
+            cond_var_->wait(l);
+            RecordStart(ctx);
           }
-          RecordStop(ctx);
-          cond_var_->wait(l);
-          RecordStart(ctx);
-        }
 
-        if (!buffer_.empty()) {
-          return Consume(ctx, out_tensors, end_of_sequence);
+          if (!buffer_.empty()) {
+            return Consume(ctx, out_tensors, end_of_sequence);
+          }
         }
 
         if (prefetch_thread_finished_) {
@@ -239,7 +266,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         if (stats_aggregator) {
           stats_aggregator->AddScalar(
               stats_utils::BufferSizeScalarName(dataset()->node_name()),
-              static_cast<float>(buffer_.size()), num_elements());
+              static_cast<float>(BufferSize()), num_elements());
           stats_aggregator->AddScalar(
               stats_utils::BufferCapacityScalarName(dataset()->node_name()),
               static_cast<float>(buffer_limit()), num_elements());
@@ -257,6 +284,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       if (buffer_size_->value != model::kAutotune && buffer_size_->value != 0) {
         buffer_size_min = buffer_size_->value;
         buffer_size_max = buffer_size_->value;
+      } else if (ring_) {
+        buffer_size_max = ring_->capacity();
+        buffer_size_min = std::min(buffer_size_min, buffer_size_max);
       }
       return model::MakeAsyncKnownRatioNode(
           std::move(args),
@@ -276,10 +306,21 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       mutex_lock input_l(input_mu_);
       mutex_lock l(*mu_);
       TF_RETURN_IF_ERROR(SaveInput(ctx, writer, input_impl_));
+      std::vector<const BufferElement*> buffer_elements;
+      if (ring_) {
+        // Holding both locks keeps the ring quiescent while we iterate it.
+        ring_->ForEach([&](const std::unique_ptr<BufferElement>& element) {
+          buffer_elements.push_back(element.get());
+        });
+      } else {
+        for (const auto& buffer_element : buffer_) {
+          buffer_elements.push_back(&buffer_element);
+        }
+      }
       TF_RETURN_IF_ERROR(
-          writer->WriteScalar(prefix(), kBufferSize, buffer_.size()));
-      for (size_t i = 0; i < buffer_.size(); i++) {
-        auto& buffer_element = buffer_[i];
+          writer->WriteScalar(prefix(), kBufferSize, buffer_elements.size()));
+      for (size_t i = 0; i < buffer_elements.size(); i++) {
+        const auto& buffer_element = *buffer_elements[i];
         TF_RETURN_IF_ERROR(WriteStatus(writer, i, buffer_element.status));
         if (buffer_element.status.ok()) {
           TF_RETURN_IF_ERROR(writer->WriteScalar(
@@ -306,11 +347,25 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       mutex_lock l(*mu_);
       DCHECK(!prefetch_thread_);
       DCHECK(buffer_.empty());
+      DCHECK(!ring_ || ring_->Empty());
       TF_RETURN_IF_ERROR(RestoreInput(ctx, reader, input_impl_));
 
       if (!ctx->symbolic_checkpoint()) {
         TF_RETURN_IF_ERROR(RestoreBuffer(ctx, reader));
       }
+      if (ring_) {
+        if (buffer_.size() <= ring_->capacity()) {
+          while (!buffer_.empty()) {
+            ring_->TryPush(
+                std::make_unique<BufferElement>(std::move(buffer_.front())));
+            buffer_.pop_front();
+          }
+        } else {
+          // The checkpoint holds more elements than the ring can, so this
+          // iterator falls back to the mutex-protected buffer.
+          ring_.reset();
+        }
+      }
 
       if (ctx->warm_start()) {
         TF_RETURN_IF_ERROR(EnsureThreadsStarted(ctx));
@@ -326,8 +381,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       // right away to avoid introducing tracing overhead.
       if (mu_->try_lock()) {
         limit = buffer_limit();
-        size = buffer_.size();
-        if (!buffer_.empty()) {
+        size = BufferSize();
+        if (!ring_ && !buffer_.empty()) {
           std::vector<std::string> shapes(buffer_.front().value.size());
           for (const auto& component : buffer_.front().value) {
             shapes.push_back(component.shape().DebugString());
@@ -418,8 +473,27 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       return buffer_size_->value;
     }
 
+    size_t BufferSize() const TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      return ring_ ? ring_->Size() : buffer_.size();
+    }
+
+    // Returns the number of elements the prefetch thread may keep in `ring_`.
+    size_t RingLimit() const TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      return std::clamp<int64_t>(buffer_limit(), 0, ring_->capacity());
+    }
+
+    // Publishes the current ring limit to the prefetch thread and wakes it up
+    // if it is parked waiting for a free slot.
+    void WakeRingProducer() TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      ring_limit_.store(RingLimit(), std::memory_order_release);
+      if (producer_waiting_) {
+        cond_var_->notify_all();
+      }
+    }
+
     void CancelThreads() TF_LOCKS_EXCLUDED(mu_) {
       cancellation_manager_->StartCancel();
+      ring_cancelled_.store(true, std::memory_order_release);
       mutex_lock l(*mu_);
       cancelled_ = true;
       cond_var_->notify_all();
@@ -427,26 +501,165 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
 
     Status Consume(IteratorContext* ctx, std::vector<Tensor>* out_tensors,
                    bool* end_of_sequence) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      Status s = ConsumeElement(ctx, buffer_.size(), buffer_.front(),
+                                out_tensors, end_of_sequence);
+      buffer_.pop_front();
+
+      // Wake the prefetch thread, in case it has been waiting for space
+      // in the buffer. Also wake up threads from other calls to GetNext.
+      //
+      // TODO(mrry): Consider using different condition variables for
+      // GetNext and Prefetch.
+      cond_var_->notify_all();
+      return s;
+    }
+
+    Status ConsumeRingElement(IteratorContext* ctx,
+                              BufferElement& buffer_element,
+                              std::vector<Tensor>* out_tensors,
+                              bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      // Count the element being consumed, which has already left the ring.
+      Status s = ConsumeElement(ctx, ring_->Size() + 1, buffer_element,
+                                out_tensors, end_of_sequence);
+      WakeRingProducer();
+      return s;
+    }
+
+    // Pops the next element from `ring_` into `element`, waiting until one
+    // has been produced. Returns false if the prefetch thread has finished or
+    // the buffer limit is zero and no element is available.
+    //
+    // Waiting spins first and parks on `cond_var_` only if no element arrives
+    // within the spin budget. A parked consumer advertises itself in
+    // `num_waiting_consumers_` so that the prefetch thread only acquires `mu_`
+    // to notify when somebody is actually waiting.
+    bool WaitForRingElement(IteratorContext* ctx, mutex_lock& l,
+                            std::unique_ptr<BufferElement>* element)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
+      while (true) {
+        // Read the flag before popping: the prefetch thread pushes its last
+        // element before it sets the flag.
+        const bool finished = prefetch_thread_finished_;
+        if (ring_->TryPop(element)) {
+          return true;
+        }
+        if (finished || buffer_limit() == 0) {
+          return false;
+        }
+        if (legacy_autotune_) {
+          auto_tuner_->RecordEmpty();
+          buffer_size_->value = auto_tuner_->buffer_limit();
+          WakeRingProducer();
+        }
+        if (consumer_spinner_.Spin([this] { return !ring_->Empty(); })) {
+          continue;
+        }
+        RecordStop(ctx);
+        num_waiting_consumers_.fetch_add(1);
+        // Pairs with the fence in `PrefetchThread` after pushing: either the
+        // prefetch thread observes this consumer or we observe its element.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ring_->Empty() && !prefetch_thread_finished_) {
+          cond_var_->wait(l);
+        }
+        num_waiting_consumers_.fetch_sub(1);
+        RecordStart(ctx);
+      }
+    }
+
+    // Waits for a free slot in `ring_`. Returns false if the iterator has been
+    // cancelled.
+    bool WaitForRingSlot(IteratorContext* ctx) TF_LOCKS_EXCLUDED(*mu_) {
+      auto slot_available = [this] {
+        return ring_->Size() < ring_limit_.load(std::memory_order_acquire) ||
+               ring_cancelled_.load(std::memory_order_acquire);
+      };
+      if (producer_spinner_.Spin(slot_available) &&
+          !ring_cancelled_.load(std::memory_order_acquire)) {
+        return true;
+      }
+      mutex_lock l(*mu_);
+      producer_waiting_ = true;
+      while (!cancelled_ && ring_->Size() >= RingLimit()) {
+        RecordStop(ctx);
+        cond_var_->wait(l);
+        RecordStart(ctx);
+      }
+      producer_waiting_ = false;
+      ring_limit_.store(RingLimit(), std::memory_order_release);
+      if (cancelled_) {
+        prefetch_thread_finished_ = true;
+        cond_var_->notify_all();
+        return false;
+      }
+      return true;
+    }
+
+    // Pushes `element` into `ring_`. `WaitForRingSlot` only checks the ring
+    // size, which a consumer updates before it releases the slot, so the push
+    // may still find the slot occupied; it then retries until the slot is
+    // released. Returns false if the iterator has been cancelled.
+    bool PushToRing(IteratorContext* ctx,
+                    std::unique_ptr<BufferElement> element)
+        TF_LOCKS_EXCLUDED(*mu_) {
+      if (ring_->TryPush(std::move(element))) {
+        return true;
+      }
+      bool pushed = false;
+      auto try_push = [&] {
+        pushed = pushed || ring_->TryPush(std::move(element));
+        return pushed || ring_cancelled_.load(std::memory_order_acquire);
+      };
+      if (producer_spinner_.Spin(try_push) && pushed) {
+        return true;
+      }
+      // Consumers pop and notify while holding `mu_`, so a slot released after
+      // the last attempt below wakes this thread.
+      mutex_lock l(*mu_);
+      producer_waiting_ = true;
+      while (!cancelled_ && !pushed) {
+        pushed = ring_->TryPush(std::move(element));
+        if (!pushed) {
+          RecordStop(ctx);
+          cond_var_->wait(l);
+          RecordStart(ctx);
+        }
+      }
+      producer_waiting_ = false;
+      if (pushed) {
+        return true;
+      }
+      prefetch_thread_finished_ = true;
+      cond_var_->notify_all();
+      return false;
+    }
+
+    // Hands `buffer_element` to a consumer, forwarding the status from
+    // computing it and (if successful) its values.
+    Status ConsumeElement(IteratorContext* ctx, size_t buffer_size,
+                          BufferElement& buffer_element,
+                          std::vector<Tensor>* out_tensors,
+                          bool* end_of_sequence)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(*mu_) {
       const auto& stats_aggregator = ctx->stats_aggregator();
       if (stats_aggregator) {
         double buffer_limit_ = buffer_limit();
         stats_aggregator->AddToHistogram(
             stats_utils::BufferUtilizationHistogramName(dataset()->node_name()),
-            {static_cast<float>(buffer_.size()) /
+            {static_cast<float>(buffer_size) /
              static_cast<float>(buffer_limit_)},
             num_elements());
         stats_aggregator->AddScalar(
             stats_utils::BufferSizeScalarName(dataset()->node_name()),
-            static_cast<float>(buffer_.size()), num_elements());
+            static_cast<float>(buffer_size), num_elements());
         stats_aggregator->AddScalar(
             stats_utils::BufferCapacityScalarName(dataset()->node_name()),
             static_cast<float>(buffer_limit_), num_elements());
       }
-      // A new element is available. Forward the status from computing it, and
-      // (if we successfully got an element) the output values.
-      Status s = buffer_.front().status;
+      Status s = buffer_element.status;
       if (s.ok()) {
-        int64_t buffer_element_id = buffer_.front().uid;
+        int64_t buffer_element_id = buffer_element.uid;
         tsl::profiler::TraceMe traceme(
             [&] {
               return tsl::profiler::TraceMeEncode(
@@ -457,7 +670,7 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
             (num_elements() + 1) % dataset()->slack_period_ == 0) {
           // TODO(rachelim): Consider doing something more sophisticated
           // to decide how long to sleep for; e.g. using a kalman filter.
-          int64_t slack_us = EnvTime::NowMicros() - buffer_.front().created_us;
+          int64_t slack_us = EnvTime::NowMicros() - buffer_element.created_us;
           // Every slack_period_-th element, update the most recent slack time,
           // measured by the duration between when the element is prefetched
           // and when it is consumed. We add kSleepFactor * slack_us_ to the
@@ -466,8 +679,8 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
           slack_us_ = kSleepFactor * slack_us_ + slack_us;
           VLOG(2) << "Setting slack_us_: " << slack_us_;
         }
-        *out_tensors = std::move(buffer_.front().value);
-        ctx->MergeCheckpoint(&buffer_.front().checkpoint);
+        *out_tensors = std::move(buffer_element.value);
+        ctx->MergeCheckpoint(&buffer_element.checkpoint);
         RecordBufferDequeue(ctx, *out_tensors);
         // Tells the legacy prefetch autotuner the size of an element to enable
         // memory budget prediction.
@@ -481,21 +694,13 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         // If status not ok, we still record the dequeue event to make sure each
         // enqueue event is paired with a dequeue event even in the presence of
         // errors.
-        RecordBufferDequeue(ctx, buffer_.front().value);
+        RecordBufferDequeue(ctx, buffer_element.value);
       }
       if (legacy_autotune_) {
-        auto_tuner_->RecordConsumption(buffer_.size());
+        auto_tuner_->RecordConsumption(buffer_size);
         buffer_size_->value = auto_tuner_->buffer_limit();
       }
-      buffer_.pop_front();
       *end_of_sequence = false;
-
-      // Wake the prefetch thread, in case it has been waiting for space
-      // in the buffer. Also wake up threads from other calls to GetNext.
-      //
-      // TODO(mrry): Consider using different condition variables for
-      // GetNext and Prefetch.
-      cond_var_->notify_all();
       return s;
     }
 
@@ -520,7 +725,11 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
       int num_produced = 0;
       while (true) {
         // 1. Wait for a slot in the buffer.
-        {
+        if (ring_) {
+          if (!WaitForRingSlot(ctx.get())) {
+            return;
+          }
+        } else {
           mutex_lock l(*mu_);
           while (!cancelled_ && buffer_.size() >= buffer_limit()) {
             RecordStop(ctx.get());
@@ -570,7 +779,19 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
         }
 
         // 3. Signal that the element has been produced.
-        {
+        if (ring_) {
+          RecordBufferEnqueue(ctx.get(), buffer_element.value);
+          buffer_element.created_us = EnvTime::NowMicros();
+          if (!PushToRing(ctx.get(), std::make_unique<BufferElement>(
+                                         std::move(buffer_element)))) {
+            return;
+          }
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (num_waiting_consumers_.load(std::memory_order_relaxed) > 0) {
+            mutex_lock l(*mu_);
+            cond_var_->notify_all();
+          }
+        } else {
           mutex_lock l(*mu_);
           RecordBufferEnqueue(ctx.get(), buffer_element.value);
           buffer_element.created_us = EnvTime::NowMicros();
@@ -653,6 +874,24 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
     // tree. We record the interleave depth so that it can be included in the
     // trace metadata.
     int64 interleave_depth_ = -1;
+
+    // If set, elements are handed from the prefetch thread to `GetNext`
+    // through this lock-free ring instead of `buffer_`, so the prefetch thread
+    // does not need to acquire `mu_` for every element. Only replaced while
+    // the prefetch thread is not running.
+    std::unique_ptr<ElementRing<std::unique_ptr<BufferElement>>> ring_;
+    // The most recent `RingLimit()`, read by the prefetch thread without
+    // acquiring `mu_`.
+    std::atomic<size_t> ring_limit_ = 0;
+    // Mirrors `cancelled_` for the prefetch thread's lock-free fast path.
+    std::atomic<bool> ring_cancelled_ = false;
+    // Number of `GetNext` callers parked on `cond_var_` waiting for `ring_`.
+    std::atomic<int> num_waiting_consumers_ = 0;
+    // Whether the prefetch thread is parked waiting for a free slot in `ring_`.
+    bool producer_waiting_ TF_GUARDED_BY(*mu_) = false;
+    AdaptiveSpinner consumer_spinner_;
+    AdaptiveSpinner producer_spinner_;
+
     std::unique_ptr<Thread> prefetch_thread_ TF_GUARDED_BY(*mu_);
   };
 
@@ -670,6 +909,9 @@ class PrefetchDatasetOp::Dataset : public DatasetBase {
   // parameter.
   const int64_t buffer_size_min_ = 0;
 
+  // Determines whether the iterator hands elements through an `ElementRing`.
+  const bool use_element_ring_ = false;
+
   absl::Status random_indexing_compatible_;
   TraceMeMetadata traceme_metadata_;
 };
@@ -689,6 +931,9 @@ PrefetchDatasetOp::PrefetchDatasetOp(OpKernelConstruction* ctx)
     legacy_autotune_ = false;
     buffer_size_min_ = std::max(static_cast<int64_t>(1), buffer_size_min_);
   }
+  if (GetExperiments().contains("prefetch_element_ring")) {
+    use_element_ring_ = true;
+  }
 }
 
 void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
@@ -706,7 +951,7 @@ void PrefetchDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   }
 
   *output = new Dataset(ctx, input, buffer_size, slack_period_,
-                        legacy_autotune_, buffer_size_min_);
+                        legacy_autotune_, buffer_size_min_, use_element_ring_);
 }
 
 namespace {
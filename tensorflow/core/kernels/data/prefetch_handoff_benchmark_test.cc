@@ -0,0 +1,190 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// Benchmarks for handing elements from a prefetch thread to a `GetNext`
+// caller. `BM_MutexDequeHandoff` mirrors the protocol `PrefetchDatasetOp` uses
+// by default, while `BM_ElementRingHandoff` mirrors the protocol it uses when
+// the "prefetch_element_ring" experiment is enabled. Both report the number of
+// elements per second and the 99th percentile `GetNext` latency.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "tensorflow/core/data/element_ring.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/env_time.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+using Element = std::vector<Tensor>;
+
+Element MakeElement(int64_t value) { return {Tensor(value)}; }
+
+void ReportLatency(::testing::benchmark::State& state,
+                   std::vector<uint64_t>& latencies_ns) {
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+  if (latencies_ns.empty()) {
+    return;
+  }
+  const size_t p99 = latencies_ns.size() * 99 / 100;
+  std::nth_element(latencies_ns.begin(), latencies_ns.begin() + p99,
+                   latencies_ns.end());
+  state.counters["p99_get_next_ns"] = latencies_ns[p99];
+}
+
+void BM_MutexDequeHandoff(::testing::benchmark::State& state) {
+  const size_t buffer_size = state.range(0);
+  mutex mu;
+  condition_variable cond_var;
+  std::deque<Element> buffer;
+  bool cancelled = false;
+
+  std::unique_ptr<Thread> producer(Env::Default()->StartThread(
+      ThreadOptions(), "producer", [&]() {
+        for (int64_t i = 0;; ++i) {
+          Element element = MakeElement(i);
+          mutex_lock l(mu);
+          while (!cancelled && buffer.size() >= buffer_size) {
+            cond_var.wait(l);
+          }
+          if (cancelled) {
+            return;
+          }
+          buffer.push_back(std::move(element));
+          cond_var.notify_all();
+        }
+      }));
+
+  std::vector<uint64_t> latencies_ns;
+  latencies_ns.reserve(state.max_iterations);
+  for (auto s : state) {
+    const uint64_t start_ns = EnvTime::NowNanos();
+    Element element;
+    {
+      mutex_lock l(mu);
+      while (buffer.empty()) {
+        cond_var.wait(l);
+      }
+      element = std::move(buffer.front());
+      buffer.pop_front();
+      cond_var.notify_all();
+    }
+    latencies_ns.push_back(EnvTime::NowNanos() - start_ns);
+    ::testing::DoNotOptimize(element);
+  }
+
+  {
+    mutex_lock l(mu);
+    cancelled = true;
+    cond_var.notify_all();
+  }
+  producer.reset();
+  ReportLatency(state, latencies_ns);
+}
+
+BENCHMARK(BM_MutexDequeHandoff)->Arg(1)->Arg(16)->Arg(256);
+
+void BM_ElementRingHandoff(::testing::benchmark::State& state) {
+  const size_t buffer_size = state.range(0);
+  ElementRing<std::unique_ptr<Element>> ring(buffer_size);
+  mutex mu;
+  condition_variable cond_var;
+  std::atomic<bool> cancelled = false;
+  std::atomic<int> num_waiting_consumers = 0;
+  std::atomic<bool> producer_waiting = false;
+
+  std::unique_ptr<Thread> producer(Env::Default()->StartThread(
+      ThreadOptions(), "producer", [&]() {
+        AdaptiveSpinner spinner;
+        auto slot_available = [&] {
+          return ring.Size() < buffer_size || cancelled.load();
+        };
+        for (int64_t i = 0;; ++i) {
+          auto element = std::make_unique<Element>(MakeElement(i));
+          if (!spinner.Spin(slot_available)) {
+            mutex_lock l(mu);
+            producer_waiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            while (!cancelled && ring.Size() >= buffer_size) {
+              cond_var.wait(l);
+            }
+            producer_waiting = false;
+          }
+          if (cancelled) {
+            return;
+          }
+          // The slot may still be being released by the consumer.
+          while (!ring.TryPush(std::move(element))) {
+            std::this_thread::yield();
+          }
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          if (num_waiting_consumers.load(std::memory_order_relaxed) > 0) {
+            mutex_lock l(mu);
+            cond_var.notify_all();
+          }
+        }
+      }));
+
+  AdaptiveSpinner spinner;
+  std::vector<uint64_t> latencies_ns;
+  latencies_ns.reserve(state.max_iterations);
+  for (auto s : state) {
+    const uint64_t start_ns = EnvTime::NowNanos();
+    std::unique_ptr<Element> element;
+    while (!ring.TryPop(&element)) {
+      if (spinner.Spin([&] { return !ring.Empty(); })) {
+        continue;
+      }
+      mutex_lock l(mu);
+      num_waiting_consumers.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ring.Empty()) {
+        cond_var.wait(l);
+      }
+      num_waiting_consumers.fetch_sub(1);
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (producer_waiting.load(std::memory_order_relaxed)) {
+      mutex_lock l(mu);
+      cond_var.notify_all();
+    }
+    latencies_ns.push_back(EnvTime::NowNanos() - start_ns);
+    ::testing::DoNotOptimize(element);
+  }
+
+  {
+    mutex_lock l(mu);
+    cancelled = true;
+    cond_var.notify_all();
+  }
+  producer.reset();
+  ReportLatency(state, latencies_ns);
+}
+
+BENCHMARK(BM_ElementRingHandoff)->Arg(1)->Arg(16)->Arg(256);
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
@@ -14,30 +14,36 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/shuffle_dataset_op.h"
 
+#include <algorithm>
 #include <cstdint>
 #include <deque>
 #include <memory>
 #include <numeric>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/container/flat_hash_set.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/data/dataset_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/serialization_utils.h"
 #include "tensorflow/core/framework/dataset.h"
+#include "tensorflow/core/framework/model.h"
 #include "tensorflow/core/framework/partial_tensor_shape.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/kernels/data/random_seed_ops.h"
+#include "tensorflow/core/kernels/data/shuffle_spill_store.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/random.h"
 #include "tensorflow/core/lib/random/random_distributions.h"
 #include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mem.h"
 #include "tensorflow/core/platform/stringprintf.h"
 
 namespace tensorflow {
@@ -63,6 +69,15 @@ namespace data {
 
 const int64_t kLogIntervalMicros = 10 * 1000000;  // 10 seconds.
 const int64_t kMaxEpochsInBuffer = 3;
+// When the "shuffle_spill_to_disk" experiment is enabled, buffered elements
+// beyond this fraction of the available RAM are spilled to local disk.
+constexpr double kMaxResidentRamFraction = 0.25;
+constexpr int64_t kSpillSegmentBytes = 64 << 20;  // 64MB
+
+// When `buffer_size` is `AUTOTUNE`, the shuffle buffer has this many slots and
+// the autotuner decides how many of them are filled.
+constexpr int64_t kAutotuneMaxBufferSize = 1 << 16;
+constexpr int64_t kAutotuneInitialBufferSize = 1024;
 
 constexpr char kNumRandomSamples[] = "num_random_samples";
 constexpr char kDataProduced[] = "data_produced";
@@ -96,6 +111,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         buffer_size_(buffer_size),
         seed_generator_(std::move(seed_generator)),
         count_(count),
+        spill_to_disk_(GetExperiments().contains("shuffle_spill_to_disk")),
         traceme_metadata_(
             {{"buffer_size",
               strings::Printf("%lld", static_cast<long long>(buffer_size))}}) {
@@ -195,7 +211,13 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>();
       } else {
         buffer_ = std::make_unique<std::vector<std::vector<Tensor>>>(
-            params.dataset->buffer_size_);
+            BufferCapacity());
+      }
+      if (params.dataset->buffer_size_ == model::kAutotune) {
+        autotune_buffer_size_ = std::make_shared<model::SharedState>(
+            model::kAutotune, std::make_shared<mutex>(),
+            std::make_shared<condition_variable>());
+        autotune_buffer_size_->value = kAutotuneInitialBufferSize;
       }
     }
 
@@ -205,6 +227,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       mutex_lock l(mu_);
       seed_generator_->GenerateSeeds(&seed_, &seed2_);
       ResetRngs();
+      TF_RETURN_IF_ERROR(MaybeCreateSpillStore(ctx));
       // Initialize checkpoint_indices_ to the entire buffer.
       if (ctx->symbolic_checkpoint()) {
         for (int64_t i = 0; i < buffer_->size(); ++i) {
@@ -231,24 +254,35 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       // Choose an element to produce uniformly at random from the first
       // slice, and then remove the element from the slice.
       int64_t offset =
-          Random() % (slices_.front()->end - slices_.front()->start);
+          NextRandomSample() % (slices_.front()->end - slices_.front()->start);
       int64_t index = (slices_.front()->start + offset) % buffer_->size();
-      *out_tensors = std::move(buffer_->at(index));
+      TF_RETURN_IF_ERROR(TakeElement(index, out_tensors));
       this->RecordBufferDequeue(ctx, *out_tensors);
-      std::swap(buffer_->at(index),
-                buffer_->at(slices_.front()->start % buffer_->size()));
+      SwapSlots(index, slices_.front()->start % buffer_->size());
       checkpoint_indices_.insert(index);
       checkpoint_indices_.insert(slices_.front()->start % buffer_->size());
       slices_.front()->start++;
       num_elements_--;
+      MaybePrefetchNextElement();
       return absl::OkStatus();
     }
 
    protected:
     std::shared_ptr<model::Node> CreateNode(
         IteratorContext* ctx, model::Node::Args args) const override {
-      return model::MakeKnownRatioNode(std::move(args),
-                                       /*ratio=*/1);
+      if (!autotune_buffer_size_) {
+        return model::MakeKnownRatioNode(std::move(args),
+                                         /*ratio=*/1);
+      }
+      // The initial buffer size is the floor, so that tuning under memory
+      // pressure cannot shrink the buffer to the point of not shuffling.
+      return model::MakeKnownRatioNode(
+          std::move(args),
+          /*ratio=*/1,
+          {model::MakeParameter(model::kShuffleBufferSize,
+                                autotune_buffer_size_,
+                                /*min=*/kAutotuneInitialBufferSize,
+                                /*max=*/kAutotuneMaxBufferSize)});
     }
 
     void ResetRngs() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -266,8 +300,11 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kEpochNumRandomSamples,
                               seed_generator_->num_random_samples()));
-      TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kNumRandomSamples,
-                                             num_random_samples_));
+      // A sample drawn ahead of time for prefetching is drawn again after
+      // restoring.
+      TF_RETURN_IF_ERROR(writer->WriteScalar(
+          prefix(), kNumRandomSamples,
+          num_random_samples_ - (lookahead_sample_.has_value() ? 1 : 0)));
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed, seed_));
       TF_RETURN_IF_ERROR(writer->WriteScalar(prefix(), kSeed2, seed2_));
 
@@ -284,17 +321,32 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       TF_RETURN_IF_ERROR(
           writer->WriteScalar(prefix(), kNumElements, num_elements_));
       const std::string key_prefix = absl::StrCat(prefix(), kColon, "buffer");
+      // Spilled elements are read back from disk into a shallow copy of the
+      // buffer, so that the checkpoint format does not depend on spilling.
+      std::optional<std::vector<std::vector<Tensor>>> materialized_buffer;
+      if (!spilled_.empty()) {
+        materialized_buffer.emplace(*buffer_);
+        for (const auto& [index, location] : spilled_) {
+          if (!ctx->symbolic_checkpoint() ||
+              checkpoint_indices_.contains(index)) {
+            TF_RETURN_IF_ERROR(spill_store_->Peek(
+                location, &materialized_buffer->at(index)));
+          }
+        }
+      }
+      const std::vector<std::vector<Tensor>>& buffer =
+          materialized_buffer.has_value() ? *materialized_buffer : *buffer_;
       if (ctx->symbolic_checkpoint()) {
         // When symbolic checkpointing is turned on, `writer`
         // already contains checkpoint of the shuffle buffer created by the
         // previous invocation of this instance and the indices that need to be
         // updated are stored in `checkpoint_indices`.
         TF_RETURN_IF_ERROR(UpdateCheckpointElements(
-            writer, key_prefix, *buffer_, checkpoint_indices_));
+            writer, key_prefix, buffer, checkpoint_indices_));
         checkpoint_indices_.clear();
       } else {
         TF_RETURN_IF_ERROR(
-            WriteElementsToCheckpoint(writer, key_prefix, *buffer_));
+            WriteElementsToCheckpoint(writer, key_prefix, buffer));
       }
 
       TF_RETURN_IF_ERROR(
@@ -332,6 +384,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                                             &num_random_samples_));
       TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed, &seed_));
       TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kSeed2, &seed2_));
+      lookahead_sample_.reset();
       ResetRngs();
 
       // Restore the input iterator if it wasn't already exhausted.
@@ -370,8 +423,16 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       for (const auto& element : *buffer_) {
         RecordBufferEnqueue(ctx, element);
       }
+      // Spills the restored elements that do not fit into memory.
+      spilled_.clear();
+      spill_store_.reset();
+      resident_bytes_ = 0;
+      TF_RETURN_IF_ERROR(MaybeCreateSpillStore(ctx));
+      for (int64_t i = 0; i < buffer_->size(); ++i) {
+        TF_RETURN_IF_ERROR(MaybeSpill(i));
+      }
       if (!IsShuffleAll()) {
-        buffer_->resize(dataset()->buffer_size_);
+        buffer_->resize(BufferCapacity());
       }
       slices_.clear();
       for (size_t i = 0; i < slices_size; ++i) {
@@ -424,6 +485,115 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return out;
     }
 
+    // Returns the next random sample, which may have been drawn ahead of time
+    // by `MaybePrefetchNextElement`. Drawing ahead does not change the
+    // sequence of samples, so the output order does not depend on spilling.
+    random::SingleSampleAdapter<random::PhiloxRandom>::ResultType
+    NextRandomSample() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (lookahead_sample_.has_value()) {
+        auto out = *lookahead_sample_;
+        lookahead_sample_.reset();
+        return out;
+      }
+      return Random();
+    }
+
+    Status MaybeCreateSpillStore(IteratorContext* ctx)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!dataset()->spill_to_disk_ || spill_store_) {
+        return absl::OkStatus();
+      }
+      std::vector<string> directories;
+      ctx->env()->GetLocalTempDirectories(&directories);
+      if (directories.empty()) {
+        LOG(WARNING) << "No local temporary directory for spilling the shuffle "
+                        "buffer to disk. The shuffle buffer stays in memory.";
+        return absl::OkStatus();
+      }
+      TF_ASSIGN_OR_RETURN(
+          spill_store_,
+          ShuffleSpillStore::Create(ctx->env(), directories.front(),
+                                    dataset()->output_dtypes(),
+                                    kSpillSegmentBytes));
+      max_resident_bytes_ =
+          static_cast<int64_t>(port::AvailableRam() * kMaxResidentRamFraction);
+      return absl::OkStatus();
+    }
+
+    // Spills the element in slot `index` to disk if it does not fit into the
+    // in-memory budget.
+    Status MaybeSpill(int64_t index) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      std::vector<Tensor>& element = buffer_->at(index);
+      const int64_t bytes = GetTotalBytes(element);
+      if (!spill_store_ || resident_bytes_ + bytes <= max_resident_bytes_) {
+        resident_bytes_ += bytes;
+        return absl::OkStatus();
+      }
+      TF_ASSIGN_OR_RETURN(spilled_[index], spill_store_->Write(element));
+      element.clear();
+      return absl::OkStatus();
+    }
+
+    // Moves the element in slot `index` to `element`, reading it back from
+    // disk if it was spilled.
+    Status TakeElement(int64_t index, std::vector<Tensor>* element)
+        TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      auto it = spilled_.find(index);
+      if (it == spilled_.end()) {
+        *element = std::move(buffer_->at(index));
+        resident_bytes_ -= GetTotalBytes(*element);
+        return absl::OkStatus();
+      }
+      ShuffleSpillStore::Location location = it->second;
+      spilled_.erase(it);
+      return spill_store_->Read(location, element);
+    }
+
+    // Swaps the contents of two slots of `buffer_`, spilled or not.
+    void SwapSlots(int64_t a, int64_t b) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (a == b) {
+        return;
+      }
+      std::swap(buffer_->at(a), buffer_->at(b));
+      if (spilled_.empty()) {
+        return;
+      }
+      auto it_a = spilled_.find(a);
+      auto it_b = spilled_.find(b);
+      std::optional<ShuffleSpillStore::Location> location_a, location_b;
+      if (it_a != spilled_.end()) location_a = it_a->second;
+      if (it_b != spilled_.end()) location_b = it_b->second;
+      spilled_.erase(a);
+      spilled_.erase(b);
+      if (location_a.has_value()) spilled_[b] = *location_a;
+      if (location_b.has_value()) spilled_[a] = *location_b;
+    }
+
+    // When elements are spilled, draws the random sample for the next
+    // `GetNext` call and starts reading the element it most likely selects.
+    // The prediction is exact while the buffer is full, which is the steady
+    // state of a large shuffle.
+    void MaybePrefetchNextElement() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (spilled_.empty() ||
+          slices_.front()->start == slices_.front()->end) {
+        return;
+      }
+      lookahead_sample_ = Random();
+      int64_t size = slices_.front()->end - slices_.front()->start;
+      if (slices_.size() == 1 && input_impl_ && !IsShuffleAll() &&
+          num_elements_ < TargetBufferSize()) {
+        // The next `FillBuffer` call adds an element to the serving slice.
+        ++size;
+      }
+      int64_t index =
+          (slices_.front()->start + *lookahead_sample_ % size) %
+          buffer_->size();
+      auto it = spilled_.find(index);
+      if (it != spilled_.end()) {
+        spill_store_->Prefetch(it->second);
+      }
+    }
+
     // Returns if the data-generating slice is complete, i.e, the iterator for
     // the slice that will serve the next GetNext() request has been exhausted.
     bool IsServingSliceComplete() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -439,6 +609,27 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return dataset()->buffer_size_ == kUnknownCardinality;
     }
 
+    // Returns the number of slots in `buffer_`.
+    int64_t BufferCapacity() const {
+      if (dataset()->buffer_size_ == model::kAutotune) {
+        return kAutotuneMaxBufferSize;
+      }
+      return dataset()->buffer_size_;
+    }
+
+    // Returns the number of elements `FillBuffer` buffers up to. This is the
+    // capacity of `buffer_` unless the buffer size is autotuned. When the
+    // autotuner shrinks the buffer, the excess elements drain through
+    // `GetNext` before the buffer is refilled.
+    int64_t TargetBufferSize() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (!autotune_buffer_size_) {
+        return buffer_->size();
+      }
+      tf_shared_lock l(*autotune_buffer_size_->mu);
+      return std::min(static_cast<int64_t>(autotune_buffer_size_->value),
+                      static_cast<int64_t>(buffer_->size()));
+    }
+
     // Fills the shuffle buffer, preparing the buffer for sampling.
     Status FillBuffer(IteratorContext* ctx) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       int64_t start_micros = EnvTime::NowMicros();
@@ -463,7 +654,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
           slices_.back()->reached_end_of_sequence = true;
         }
         if (!end_of_input_sequence) {
-          AddToShuffleBuffer(ctx, std::move(input_element));
+          TF_RETURN_IF_ERROR(AddToShuffleBuffer(ctx, std::move(input_element)));
           continue;
         }
         input_impl_.reset();
@@ -500,7 +691,7 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         // we need to add to the buffer.
         return true;
       }
-      return num_elements_ < buffer_->size();
+      return num_elements_ < TargetBufferSize();
     }
 
     Status PrepareNextEpoch(IteratorContext* ctx)
@@ -520,7 +711,8 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       return absl::OkStatus();
     }
 
-    void AddToShuffleBuffer(IteratorContext* ctx, std::vector<Tensor>&& element)
+    Status AddToShuffleBuffer(IteratorContext* ctx,
+                              std::vector<Tensor>&& element)
         TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       data_produced_ = true;
       if (num_elements_ == 0) {
@@ -528,17 +720,20 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
                 << BufferSizeString();
       }
       this->RecordBufferEnqueue(ctx, element);
+      size_t index;
       if (num_elements_ == buffer_->size()) {
         DCHECK(IsShuffleAll());
-        checkpoint_indices_.insert(buffer_->size());
+        index = buffer_->size();
         buffer_->push_back(element);
       } else {
-        size_t index = slices_.back()->end % buffer_->size();
-        checkpoint_indices_.insert(index);
+        index = slices_.back()->end % buffer_->size();
         buffer_->at(index) = std::move(element);
       }
+      checkpoint_indices_.insert(index);
+      TF_RETURN_IF_ERROR(MaybeSpill(index));
       num_elements_++;
       slices_.back()->end++;
+      return absl::OkStatus();
     }
 
     void ClearEmptySlices() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
@@ -552,7 +747,10 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
       }
     }
 
-    std::string BufferSizeString() {
+    std::string BufferSizeString() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+      if (autotune_buffer_size_) {
+        return absl::StrCat(TargetBufferSize(), " (autotuned)");
+      }
       return absl::StrCat(dataset()->buffer_size_);
     }
 
@@ -579,6 +777,23 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
         TF_GUARDED_BY(mu_);
     int64_t num_random_samples_ TF_GUARDED_BY(mu_) = 0;
     bool data_produced_ TF_GUARDED_BY(mu_) = false;
+
+    // Set when the "shuffle_spill_to_disk" experiment is enabled. Elements
+    // that do not fit into `max_resident_bytes_` are spilled to
+    // `spill_store_`, leaving their slot in `buffer_` empty.
+    std::unique_ptr<ShuffleSpillStore> spill_store_ TF_GUARDED_BY(mu_);
+    // Maps slots of `buffer_` to the location of their spilled element.
+    absl::flat_hash_map<int64_t, ShuffleSpillStore::Location> spilled_
+        TF_GUARDED_BY(mu_);
+    int64_t resident_bytes_ TF_GUARDED_BY(mu_) = 0;
+    int64_t max_resident_bytes_ TF_GUARDED_BY(mu_) = 0;
+    // A random sample drawn ahead of time to prefetch spilled elements.
+    std::optional<random::SingleSampleAdapter<random::PhiloxRandom>::ResultType>
+        lookahead_sample_ TF_GUARDED_BY(mu_);
+
+    // Set when `buffer_size` is `AUTOTUNE`. Holds the number of elements to
+    // buffer, which the autotuner adjusts within the RAM budget.
+    std::shared_ptr<model::SharedState> autotune_buffer_size_;
   };
 
   const DatasetBase* const input_;
@@ -588,6 +803,9 @@ class ShuffleDatasetOpBase::ShuffleDatasetBase : public DatasetBase {
   // fuse shuffle and repeat together, and make the shuffle dataset op
   // responsible for repeating as well.
   const int64_t count_;
+  // Whether buffered elements that exceed the memory budget are spilled to
+  // local disk.
+  const bool spill_to_disk_;
   const TraceMeMetadata traceme_metadata_;
   mutable mutex mu_;
   mutable std::vector<std::int64_t> shuffled_indices_ TF_GUARDED_BY(mu_);
@@ -793,9 +1011,11 @@ void ShuffleDatasetOp::MakeDataset(OpKernelContext* ctx, DatasetBase* input,
   OP_REQUIRES_OK(ctx,
                  ParseScalarArgument<int64_t>(ctx, kBufferSize, &buffer_size));
   OP_REQUIRES(
-      ctx, buffer_size > 0 || buffer_size == kUnknownCardinality,
-      errors::InvalidArgument(
-          "buffer_size must be greater than zero or UNKNOWN_CARDINALITY"));
+      ctx,
+      buffer_size > 0 || buffer_size == kUnknownCardinality ||
+          buffer_size == model::kAutotune,
+      errors::InvalidArgument("buffer_size must be greater than zero, "
+                              "UNKNOWN_CARDINALITY or AUTOTUNE"));
 
   int64_t count = 1;
   static std::atomic<int64_t> resource_id_counter(0);
@@ -1044,9 +1264,11 @@ void ShuffleAndRepeatDatasetOp::MakeDataset(OpKernelContext* ctx,
   OP_REQUIRES_OK(ctx,
                  ParseScalarArgument<int64_t>(ctx, kBufferSize, &buffer_size));
   OP_REQUIRES(
-      ctx, buffer_size > 0 || buffer_size == kUnknownCardinality,
-      errors::InvalidArgument(
-          "buffer_size must be greater than zero or UNKNOWN_CARDINALITY"));
+      ctx,
+      buffer_size > 0 || buffer_size == kUnknownCardinality ||
+          buffer_size == model::kAutotune,
+      errors::InvalidArgument("buffer_size must be greater than zero, "
+                              "UNKNOWN_CARDINALITY or AUTOTUNE"));
 
   int64_t seed;
   OP_REQUIRES_OK(ctx, ParseScalarArgument<int64_t>(ctx, kSeed, &seed));
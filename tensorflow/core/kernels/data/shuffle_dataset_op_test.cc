@@ -221,9 +221,22 @@ ShuffleDatasetParams ShuffleDatasetParamsWithUnknownCardinality() {
                               /*node_name=*/kShuffleNodeName);
 }
 
+// Test case 5: a buffer size of AUTOTUNE.
+ShuffleDatasetParams ShuffleDatasetParamsWithAutotuneBufferSize() {
+  return ShuffleDatasetParams(RangeDatasetParams(0, 10, 1),
+                              /*buffer_size=*/-1,
+                              /*seed=*/1,
+                              /*seed2=*/2,
+                              /*count=*/1,
+                              /*reshuffle_each_iteration=*/true,
+                              /*output_dtypes=*/{DT_INT64},
+                              /*output_shapes=*/{PartialTensorShape({})},
+                              /*node_name=*/kShuffleNodeName);
+}
+
 ShuffleDatasetParams ShuffleDatasetParamsWithInvalidBufferSize() {
   return ShuffleDatasetParams(RangeDatasetParams(0, 0, 1),
-                              /*buffer_size=*/-1,
+                              /*buffer_size=*/-3,
                               /*seed=*/1,
                               /*seed2=*/2,
                               /*count=*/1,
@@ -235,7 +248,7 @@ ShuffleDatasetParams ShuffleDatasetParamsWithInvalidBufferSize() {
 
 ShuffleDatasetParams ShuffleAndRepeatDatasetParamsWithInvalidBufferSize() {
   return ShuffleDatasetParams(RangeDatasetParams(0, 0, 1),
-                              /*buffer_size=*/-1,
+                              /*buffer_size=*/-3,
                               /*seed=*/1,
                               /*seed2=*/2,
                               /*count=*/2,
@@ -583,6 +596,24 @@ INSTANTIATE_TEST_CASE_P(ShuffleDatasetOpTest,
                         ParameterizedIteratorSaveAndRestoreTest,
                         ::testing::ValuesIn(IteratorSaveAndRestoreTestCases()));
 
+TEST_F(ShuffleDatasetOpTest, AutotuneBufferSize) {
+  auto dataset_params = ShuffleDatasetParamsWithAutotuneBufferSize();
+  TF_ASSERT_OK(Initialize(dataset_params));
+  bool end_of_sequence = false;
+  std::vector<Tensor> out_tensors;
+  while (!end_of_sequence) {
+    std::vector<Tensor> next;
+    TF_EXPECT_OK(
+        iterator_->GetNext(iterator_ctx_.get(), &next, &end_of_sequence));
+    out_tensors.insert(out_tensors.end(), next.begin(), next.end());
+  }
+  TF_EXPECT_OK(ExpectEqual(
+      out_tensors,
+      CreateTensors<int64_t>(TensorShape({}), {{0}, {1}, {2}, {3}, {4}, {5},
+                                               {6}, {7}, {8}, {9}}),
+      /*compare_order=*/false));
+}
+
 TEST_F(ShuffleDatasetOpTest, InvalidArguments) {
   std::vector<ShuffleDatasetParams> dataset_params_vec(
       {ShuffleDatasetParamsWithInvalidBufferSize(),
@@ -0,0 +1,284 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/shuffle_spill_store.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/random.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace data {
+
+absl::StatusOr<std::unique_ptr<ShuffleSpillStore>> ShuffleSpillStore::Create(
+    Env* env, const std::string& directory, const DataTypeVector& dtypes,
+    int64_t max_segment_bytes) {
+  std::string spill_directory = io::JoinPath(
+      directory, absl::StrCat("tf_data_shuffle_spill_", random::New64()));
+  TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(spill_directory));
+  return absl::WrapUnique(new ShuffleSpillStore(
+      env, std::move(spill_directory), dtypes, max_segment_bytes));
+}
+
+ShuffleSpillStore::ShuffleSpillStore(Env* env, std::string directory,
+                                     DataTypeVector dtypes,
+                                     int64_t max_segment_bytes)
+    : env_(env),
+      directory_(std::move(directory)),
+      dtypes_(std::move(dtypes)),
+      max_segment_bytes_(max_segment_bytes) {
+  prefetch_thread_ = absl::WrapUnique(
+      env_->StartThread({}, "tf_data_shuffle_spill_prefetch",
+                        [this]() { PrefetchThread(); }));
+}
+
+ShuffleSpillStore::~ShuffleSpillStore() {
+  {
+    mutex_lock l(mu_);
+    cancelled_ = true;
+    cond_var_.notify_all();
+  }
+  // Joins the prefetch thread.
+  prefetch_thread_.reset();
+
+  mutex_lock l(mu_);
+  current_writer_.reset();
+  current_file_.reset();
+  segments_.clear();
+  int64_t undeleted_files, undeleted_dirs;
+  Status s =
+      env_->DeleteRecursively(directory_, &undeleted_files, &undeleted_dirs);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to delete shuffle spill directory " << directory_
+                 << ": " << s;
+  }
+}
+
+absl::StatusOr<ShuffleSpillStore::Location> ShuffleSpillStore::Write(
+    const std::vector<Tensor>& element) {
+  mutex_lock l(mu_);
+  if (!current_writer_ || current_offset_ >= max_segment_bytes_) {
+    TF_RETURN_IF_ERROR(StartSegment());
+  }
+  Location location{current_segment_, current_offset_};
+  for (const Tensor& tensor : element) {
+    TensorProto proto;
+    tensor.AsProtoTensorContent(&proto);
+    std::string serialized;
+    if (!proto.SerializeToString(&serialized)) {
+      return errors::DataLoss("Failed to serialize tensor of type ",
+                              DataTypeString(tensor.dtype()),
+                              " to shuffle spill file.");
+    }
+    TF_RETURN_IF_ERROR(current_writer_->WriteRecord(serialized));
+    current_offset_ += io::RecordWriter::kHeaderSize + serialized.size() +
+                       io::RecordWriter::kFooterSize;
+  }
+  current_flushed_ = false;
+  ++segments_[current_segment_].num_live_elements;
+  ++num_elements_;
+  return location;
+}
+
+absl::Status ShuffleSpillStore::Read(const Location& location,
+                                     std::vector<Tensor>* element) {
+  std::shared_ptr<PrefetchedElement> prefetched;
+  RandomAccessFile* file = nullptr;
+  {
+    mutex_lock l(mu_);
+    auto it = prefetched_.find({location.segment, location.offset});
+    if (it != prefetched_.end()) {
+      prefetched = it->second;
+      while (!prefetched->done && !cancelled_) {
+        cond_var_.wait(l);
+      }
+      prefetched_.erase({location.segment, location.offset});
+      if (prefetched->done) {
+        Release(location);
+        TF_RETURN_IF_ERROR(prefetched->status);
+        *element = std::move(prefetched->element);
+        return absl::OkStatus();
+      }
+    }
+    TF_ASSIGN_OR_RETURN(file, GetFile(location));
+  }
+  // The segment is not deleted until the element is released, so `file` stays
+  // valid while it is read without holding the lock.
+  absl::Status s = ReadElement(file, location.offset, element);
+  mutex_lock l(mu_);
+  Release(location);
+  return s;
+}
+
+absl::Status ShuffleSpillStore::Peek(const Location& location,
+                                     std::vector<Tensor>* element) {
+  RandomAccessFile* file = nullptr;
+  {
+    mutex_lock l(mu_);
+    TF_ASSIGN_OR_RETURN(file, GetFile(location));
+  }
+  return ReadElement(file, location.offset, element);
+}
+
+void ShuffleSpillStore::Prefetch(const Location& location) {
+  mutex_lock l(mu_);
+  if (prefetched_.contains({location.segment, location.offset})) {
+    return;
+  }
+  prefetched_[{location.segment, location.offset}] =
+      std::make_shared<PrefetchedElement>();
+  prefetch_queue_.push_back(location);
+  cond_var_.notify_all();
+}
+
+int64_t ShuffleSpillStore::num_elements() const {
+  mutex_lock l(mu_);
+  return num_elements_;
+}
+
+absl::Status ShuffleSpillStore::StartSegment() {
+  if (current_writer_) {
+    TF_RETURN_IF_ERROR(current_writer_->Close());
+    TF_RETURN_IF_ERROR(current_file_->Close());
+    current_writer_.reset();
+    current_file_.reset();
+    auto it = segments_.find(current_segment_);
+    if (it != segments_.end() && it->second.num_live_elements == 0) {
+      env_->DeleteFile(it->second.filename).IgnoreError();
+      segments_.erase(it);
+    }
+  }
+  ++current_segment_;
+  Segment& segment = segments_[current_segment_];
+  segment.filename =
+      io::JoinPath(directory_, absl::StrCat("segment_", current_segment_));
+  TF_RETURN_IF_ERROR(env_->NewWritableFile(segment.filename, &current_file_));
+  current_writer_ = std::make_unique<io::RecordWriter>(current_file_.get());
+  current_offset_ = 0;
+  current_flushed_ = true;
+  return absl::OkStatus();
+}
+
+absl::StatusOr<RandomAccessFile*> ShuffleSpillStore::GetFile(
+    const Location& location) {
+  auto it = segments_.find(location.segment);
+  if (it == segments_.end()) {
+    return errors::Internal("Shuffle spill segment ", location.segment,
+                            " does not exist.");
+  }
+  if (location.segment == current_segment_ && !current_flushed_) {
+    TF_RETURN_IF_ERROR(current_writer_->Flush());
+    TF_RETURN_IF_ERROR(current_file_->Flush());
+    current_flushed_ = true;
+  }
+  Segment& segment = it->second;
+  if (!segment.file) {
+    TF_RETURN_IF_ERROR(
+        env_->NewRandomAccessFile(segment.filename, &segment.file));
+  }
+  return segment.file.get();
+}
+
+absl::Status ShuffleSpillStore::ReadElement(
+    RandomAccessFile* file, uint64 offset,
+    std::vector<Tensor>* element) const {
+  io::RecordReader reader(file);
+  element->clear();
+  element->reserve(dtypes_.size());
+  for (int i = 0; i < dtypes_.size(); ++i) {
+    tstring record;
+    TF_RETURN_IF_ERROR(reader.ReadRecord(&offset, &record));
+    TensorProto proto;
+    if (!proto.ParseFromArray(record.data(), record.size())) {
+      return errors::DataLoss("Unable to parse tensor from shuffle spill file "
+                              "at offset ",
+                              offset);
+    }
+    Tensor tensor;
+    if (!tensor.FromProto(proto)) {
+      return errors::DataLoss("Invalid tensor in shuffle spill file.");
+    }
+    element->push_back(std::move(tensor));
+  }
+  return absl::OkStatus();
+}
+
+void ShuffleSpillStore::Release(const Location& location) {
+  --num_elements_;
+  auto it = segments_.find(location.segment);
+  if (it == segments_.end()) {
+    return;
+  }
+  if (--it->second.num_live_elements == 0 &&
+      location.segment != current_segment_) {
+    it->second.file.reset();
+    env_->DeleteFile(it->second.filename).IgnoreError();
+    segments_.erase(it);
+  }
+}
+
+void ShuffleSpillStore::PrefetchThread() {
+  while (true) {
+    Location location;
+    std::shared_ptr<PrefetchedElement> prefetched;
+    absl::StatusOr<RandomAccessFile*> file;
+    {
+      mutex_lock l(mu_);
+      while (!cancelled_ && prefetch_queue_.empty()) {
+        cond_var_.wait(l);
+      }
+      if (cancelled_) {
+        return;
+      }
+      location = prefetch_queue_.front();
+      prefetch_queue_.pop_front();
+      auto it = prefetched_.find({location.segment, location.offset});
+      if (it == prefetched_.end()) {
+        continue;
+      }
+      prefetched = it->second;
+      file = GetFile(location);
+    }
+    std::vector<Tensor> element;
+    absl::Status s = file.status();
+    if (s.ok()) {
+      s = ReadElement(*file, location.offset, &element);
+    }
+    mutex_lock l(mu_);
+    prefetched->status = s;
+    prefetched->element = std::move(element);
+    prefetched->done = true;
+    cond_var_.notify_all();
+  }
+}
+
+}  // namespace data
+}  // namespace tensorflow
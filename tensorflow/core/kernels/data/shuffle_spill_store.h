@@ -0,0 +1,149 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_SPILL_STORE_H_
+#define TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_SPILL_STORE_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+
+namespace tensorflow {
+namespace data {
+
+// Stores shuffle buffer elements that do not fit in memory in local spill
+// files.
+//
+// Elements are written in the snapshot TFRecord chunk format (one serialized
+// `TensorProto` record per component, uncompressed so that records can be
+// addressed by offset). Spill files are split into segments, and a segment is
+// deleted as soon as every element it holds has been read back.
+//
+// Elements can be read back in any order. `Prefetch` schedules an
+// asynchronous read on a background thread, so that a later `Read` of the
+// same element does not block on disk.
+//
+// This class is thread-safe.
+class ShuffleSpillStore {
+ public:
+  // Identifies a spilled element.
+  struct Location {
+    int64_t segment = 0;
+    uint64 offset = 0;
+  };
+
+  // Creates a store that writes segments of at most (roughly)
+  // `max_segment_bytes` bytes to a new directory under `directory`.
+  static absl::StatusOr<std::unique_ptr<ShuffleSpillStore>> Create(
+      Env* env, const std::string& directory, const DataTypeVector& dtypes,
+      int64_t max_segment_bytes);
+
+  // Deletes all spill files.
+  ~ShuffleSpillStore();
+
+  ShuffleSpillStore(const ShuffleSpillStore&) = delete;
+  ShuffleSpillStore& operator=(const ShuffleSpillStore&) = delete;
+
+  // Spills `element` and returns where it was written.
+  absl::StatusOr<Location> Write(const std::vector<Tensor>& element);
+
+  // Reads back the element at `location` and releases its storage. Each
+  // location may be read at most once.
+  absl::Status Read(const Location& location, std::vector<Tensor>* element);
+
+  // Reads the element at `location` without releasing its storage, e.g. to
+  // write it to a checkpoint.
+  absl::Status Peek(const Location& location, std::vector<Tensor>* element);
+
+  // Schedules an asynchronous read of the element at `location`. The result
+  // is handed out by the next `Read` of that location.
+  void Prefetch(const Location& location);
+
+  // Returns the number of elements that are currently spilled.
+  int64_t num_elements() const;
+
+ private:
+  struct Segment {
+    std::string filename;
+    // Opened lazily on the first read from the segment.
+    std::unique_ptr<RandomAccessFile> file;
+    // Number of spilled elements in the segment that have not been read back.
+    int64_t num_live_elements = 0;
+  };
+
+  // The result of a prefetch. `done` is false while the read is in flight.
+  struct PrefetchedElement {
+    bool done = false;
+    absl::Status status;
+    std::vector<Tensor> element;
+  };
+
+  ShuffleSpillStore(Env* env, std::string directory, DataTypeVector dtypes,
+                    int64_t max_segment_bytes);
+
+  // Starts a new segment to write to.
+  absl::Status StartSegment() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Returns the file of `location`'s segment, making sure that everything
+  // written to it so far is readable.
+  absl::StatusOr<RandomAccessFile*> GetFile(const Location& location)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  // Reads the element at `offset` of `file`.
+  absl::Status ReadElement(RandomAccessFile* file, uint64 offset,
+                           std::vector<Tensor>* element) const;
+  // Releases the storage of the element at `location`.
+  void Release(const Location& location) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+  void PrefetchThread();
+
+  Env* const env_;
+  const std::string directory_;
+  const DataTypeVector dtypes_;
+  const int64_t max_segment_bytes_;
+
+  mutable mutex mu_;
+  condition_variable cond_var_;
+  absl::flat_hash_map<int64_t, Segment> segments_ TF_GUARDED_BY(mu_);
+  int64_t current_segment_ TF_GUARDED_BY(mu_) = -1;
+  std::unique_ptr<WritableFile> current_file_ TF_GUARDED_BY(mu_);
+  std::unique_ptr<io::RecordWriter> current_writer_ TF_GUARDED_BY(mu_);
+  uint64 current_offset_ TF_GUARDED_BY(mu_) = 0;
+  // Whether `current_file_` has been flushed since the last write.
+  bool current_flushed_ TF_GUARDED_BY(mu_) = true;
+  int64_t num_elements_ TF_GUARDED_BY(mu_) = 0;
+
+  // Prefetch requests, keyed by segment and offset.
+  std::deque<Location> prefetch_queue_ TF_GUARDED_BY(mu_);
+  absl::flat_hash_map<std::pair<int64_t, uint64>,
+                      std::shared_ptr<PrefetchedElement>>
+      prefetched_ TF_GUARDED_BY(mu_);
+  bool cancelled_ TF_GUARDED_BY(mu_) = false;
+  std::unique_ptr<Thread> prefetch_thread_;
+};
+
+}  // namespace data
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_DATA_SHUFFLE_SPILL_STORE_H_
@@ -0,0 +1,150 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/data/shuffle_spill_store.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace data {
+namespace {
+
+std::vector<Tensor> MakeElement(int64_t i) {
+  return {test::AsScalar<int64_t>(i),
+          test::AsTensor<tstring>({absl::StrCat("element_", i)})};
+}
+
+void ExpectElement(const std::vector<Tensor>& element, int64_t i) {
+  ASSERT_EQ(element.size(), 2);
+  test::ExpectEqual(element[0], test::AsScalar<int64_t>(i));
+  test::ExpectEqual(element[1],
+                    test::AsTensor<tstring>({absl::StrCat("element_", i)}));
+}
+
+class ShuffleSpillStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    directory_ = io::JoinPath(testing::TmpDir(), "shuffle_spill_store_test");
+    TF_ASSERT_OK(Env::Default()->RecursivelyCreateDir(directory_));
+  }
+
+  // Returns the number of files in the spill directory of the store.
+  int64_t NumSpillFiles() {
+    std::vector<std::string> files;
+    TF_CHECK_OK(Env::Default()->GetMatchingPaths(
+        io::JoinPath(directory_, "tf_data_shuffle_spill_*", "*"), &files));
+    return files.size();
+  }
+
+  std::string directory_;
+};
+
+TEST_F(ShuffleSpillStoreTest, ReadInAnyOrder) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ShuffleSpillStore> store,
+      ShuffleSpillStore::Create(Env::Default(), directory_,
+                                {DT_INT64, DT_STRING},
+                                /*max_segment_bytes=*/64));
+  std::vector<ShuffleSpillStore::Location> locations;
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(locations.emplace_back(),
+                            store->Write(MakeElement(i)));
+  }
+  EXPECT_EQ(store->num_elements(), 10);
+  for (int64_t i : {7, 2, 9, 0, 4, 5, 1, 8, 3, 6}) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(store->Read(locations[i], &element));
+    ExpectElement(element, i);
+  }
+  EXPECT_EQ(store->num_elements(), 0);
+}
+
+TEST_F(ShuffleSpillStoreTest, Prefetch) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ShuffleSpillStore> store,
+      ShuffleSpillStore::Create(Env::Default(), directory_,
+                                {DT_INT64, DT_STRING},
+                                /*max_segment_bytes=*/1 << 20));
+  std::vector<ShuffleSpillStore::Location> locations;
+  for (int64_t i = 0; i < 10; ++i) {
+    TF_ASSERT_OK_AND_ASSIGN(locations.emplace_back(),
+                            store->Write(MakeElement(i)));
+  }
+  for (int64_t i = 0; i < 10; ++i) {
+    store->Prefetch(locations[i]);
+  }
+  for (int64_t i = 9; i >= 0; --i) {
+    std::vector<Tensor> element;
+    TF_ASSERT_OK(store->Read(locations[i], &element));
+    ExpectElement(element, i);
+  }
+}
+
+TEST_F(ShuffleSpillStoreTest, PeekDoesNotRelease) {
+  TF_ASSERT_OK_AND_ASSIGN(
+      std::unique_ptr<ShuffleSpillStore> store,
+      ShuffleSpillStore::Create(Env::Default(), directory_,
+                                {DT_INT64, DT_STRING},
+                                /*max_segment_bytes=*/1 << 20));
+  TF_ASSERT_OK_AND_ASSIGN(ShuffleSpillStore::Location location,
+                          store->Write(MakeElement(42)));
+  std::vector<Tensor> element;
+  TF_ASSERT_OK(store->Peek(location, &element));
+  ExpectElement(element, 42);
+  EXPECT_EQ(store->num_elements(), 1);
+  element.clear();
+  TF_ASSERT_OK(store->Read(location, &element));
+  ExpectElement(element, 42);
+  EXPECT_EQ(store->num_elements(), 0);
+}
+
+TEST_F(ShuffleSpillStoreTest, DeletesSegments) {
+  {
+    TF_ASSERT_OK_AND_ASSIGN(
+        std::unique_ptr<ShuffleSpillStore> store,
+        ShuffleSpillStore::Create(Env::Default(), directory_,
+                                  {DT_INT64, DT_STRING},
+                                  /*max_segment_bytes=*/1));
+    // With a tiny segment size, each element goes into its own segment.
+    std::vector<ShuffleSpillStore::Location> locations;
+    for (int64_t i = 0; i < 5; ++i) {
+      TF_ASSERT_OK_AND_ASSIGN(locations.emplace_back(),
+                              store->Write(MakeElement(i)));
+    }
+    EXPECT_GE(NumSpillFiles(), 4);
+    for (int64_t i = 0; i < 4; ++i) {
+      std::vector<Tensor> element;
+      TF_ASSERT_OK(store->Read(locations[i], &element));
+    }
+    // Only the segment that is still being written remains.
+    EXPECT_EQ(NumSpillFiles(), 1);
+  }
+  EXPECT_EQ(NumSpillFiles(), 0);
+}
+
+}  // namespace
+}  // namespace data
+}  // namespace tensorflow
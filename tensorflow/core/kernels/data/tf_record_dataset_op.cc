@@ -14,6 +14,12 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/kernels/data/tf_record_dataset_op.h"
 
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+#include "tensorflow/core/data/dataset_utils.h"
+#include "tensorflow/core/data/global_shuffle_utils.h"
 #include "tensorflow/core/data/name_utils.h"
 #include "tensorflow/core/data/utils.h"
 #include "tensorflow/core/framework/metrics.h"
@@ -22,9 +28,11 @@ limitations under the License.
 #include "tensorflow/core/lib/io/buffered_inputstream.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
 #include "tensorflow/core/lib/io/random_inputstream.h"
+#include "tensorflow/core/lib/io/record_index.h"
 #include "tensorflow/core/lib/io/record_reader.h"
 #include "tensorflow/core/lib/io/zlib_compression_options.h"
 #include "tensorflow/core/lib/io/zlib_inputstream.h"
+#include "tensorflow/core/platform/file_system.h"
 
 namespace tensorflow {
 namespace data {
@@ -45,6 +53,9 @@ constexpr char kGcsFsPrefix[] = "gs://";
 constexpr char kS3FsPrefix[] = "s3://";
 constexpr int64_t kCloudTpuBlockSize = 127LL << 20;  // 127MB.
 constexpr int64_t kS3BlockSize = kCloudTpuBlockSize;
+constexpr char kMemmapExperiment[] = "tf_record_memmap";
+constexpr char kMemmapSkipDataChecksumExperiment[] =
+    "tf_record_memmap_skip_data_checksum";
 
 bool is_cloud_tpu_gcs_fs() {
 #if (defined(PLATFORM_CLOUD_TPU) && defined(TPU_GCS_FS)) || \
@@ -58,17 +69,36 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
  public:
   explicit Dataset(OpKernelContext* ctx, std::vector<string> filenames,
                    const string& compression_type, int64_t buffer_size,
-                   std::vector<int64_t> byte_offsets, int op_version)
+                   std::vector<int64_t> byte_offsets, int op_version,
+                   bool use_memmap, bool verify_data_checksum)
       : DatasetBase(DatasetContext(ctx)),
+        env_(ctx->env()),
         filenames_(std::move(filenames)),
         compression_type_(compression_type),
         options_(io::RecordReaderOptions::CreateRecordReaderOptions(
             compression_type)),
         byte_offsets_(std::move(byte_offsets)),
-        op_version_(op_version) {
+        op_version_(op_version),
+        use_memmap_(use_memmap &&
+                    options_.compression_type == io::RecordReaderOptions::NONE),
+        verify_data_checksum_(verify_data_checksum) {
     if (buffer_size > 0) {
       options_.buffer_size = buffer_size;
     }
+    if (options_.compression_type != io::RecordReaderOptions::NONE) {
+      random_indexing_compatible_ = absl::FailedPreconditionError(absl::StrCat(
+          type_string(), " with compression type \"", compression_type_,
+          "\" does not support random access: compressed records cannot be "
+          "addressed by offset."));
+    } else if (!byte_offsets_.empty()) {
+      random_indexing_compatible_ = absl::FailedPreconditionError(
+          absl::StrCat(type_string(),
+                       " with `byte_offsets` does not support random access."));
+    }
+  }
+
+  absl::Status RandomIndexingCompatible() const override {
+    return random_indexing_compatible_;
   }
 
   std::unique_ptr<IteratorBase> MakeIteratorInternal(
@@ -96,12 +126,73 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     return name_utils::DatasetDebugString(kDatasetType, params);
   }
 
+  int64_t CardinalityInternal(CardinalityOptions options) const override {
+    // Computing the cardinality requires the record index of every file,
+    // which may need to be built by scanning the files.
+    if (options.compute_level() <
+            CardinalityOptions::CARDINALITY_COMPUTE_MODERATE ||
+        !random_indexing_compatible_.ok()) {
+      return kUnknownCardinality;
+    }
+    mutex_lock l(index_mu_);
+    Status s = LoadRecordIndicesLocked();
+    if (!s.ok()) {
+      LOG(ERROR) << "Unable to compute cardinality for dataset "
+                 << DebugString() << " due to error: " << s;
+      return kUnknownCardinality;
+    }
+    return cumulative_record_counts_.empty() ? 0
+                                             : cumulative_record_counts_.back();
+  }
+
   Status InputDatasets(std::vector<const DatasetBase*>* inputs) const override {
     return absl::OkStatus();
   }
 
   Status CheckExternalState() const override { return absl::OkStatus(); }
 
+  Status Get(OpKernelContext* ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    return Get(AnyContext(ctx), index, out_tensors);
+  }
+
+  Status Get(AnyContext ctx, int64 index,
+             std::vector<Tensor>* out_tensors) const override {
+    TF_RETURN_IF_ERROR(CheckRandomAccessCompatible(index));
+    RandomAccessFile* file;
+    uint64 offset;
+    {
+      mutex_lock l(index_mu_);
+      TF_RETURN_IF_ERROR(LoadRecordIndicesLocked());
+      // Finds the first file whose cumulative record count exceeds `index`.
+      const size_t file_index =
+          std::upper_bound(cumulative_record_counts_.begin(),
+                           cumulative_record_counts_.end(), index) -
+          cumulative_record_counts_.begin();
+      const int64_t record_index =
+          file_index == 0 ? index
+                          : index - cumulative_record_counts_[file_index - 1];
+      if (!files_[file_index]) {
+        TF_RETURN_IF_ERROR(env_->NewRandomAccessFile(
+            TranslateFileName(filenames_[file_index]), &files_[file_index]));
+      }
+      file = files_[file_index].get();
+      offset = record_indices_[file_index].entries[record_index].offset;
+    }
+
+    // `RandomAccessFile` is thread-safe, so the record is read without
+    // holding the lock.
+    io::RecordReader reader(file);
+    out_tensors->emplace_back(ctx.allocator, DT_STRING, TensorShape({}));
+    Status s =
+        reader.ReadRecord(&offset, &out_tensors->back().scalar<tstring>()());
+    if (!s.ok()) {
+      out_tensors->pop_back();
+      return s;
+    }
+    return absl::OkStatus();
+  }
+
  protected:
   Status AsGraphDefInternal(SerializationContext* ctx,
                             DatasetGraphDefBuilder* b,
@@ -123,16 +214,46 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
   class Iterator : public DatasetIterator<Dataset> {
    public:
     explicit Iterator(const Params& params)
-        : DatasetIterator<Dataset>(params) {}
+        : DatasetIterator<Dataset>(params),
+          global_shuffle_iterator_(dataset()) {}
 
     bool SymbolicCheckpointCompatible() const override { return true; }
 
     Status GetNextInternal(IteratorContext* ctx,
                            std::vector<Tensor>* out_tensors,
                            bool* end_of_sequence) override {
+      if (ctx->index_mapper() != nullptr) {
+        return global_shuffle_iterator_.GetNext(ctx, out_tensors,
+                                                end_of_sequence);
+      }
       out_tensors->reserve(1);
       mutex_lock l(mu_);
       do {
+        // We are currently processing a memory-mapped file, so copy the
+        // next record straight out of the mapping. The record is not handed
+        // out as a view: copies of a `tstring` view (e.g. made by batching)
+        // alias the mapping too, and would dangle once the file is unmapped.
+        if (memmap_reader_) {
+          StringPiece record;
+          Status s = memmap_reader_->ReadRecord(&memmap_offset_, &record);
+          if (s.ok()) {
+            out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
+                                      TensorShape({}));
+            out_tensors->back().scalar<tstring>()().assign(record.data(),
+                                                           record.size());
+            static monitoring::CounterCell* bytes_counter =
+                metrics::GetTFDataBytesReadCounter(kDatasetType);
+            bytes_counter->IncrementBy(record.size());
+            *end_of_sequence = false;
+            return absl::OkStatus();
+          }
+          ResetStreamsLocked();
+          ++current_file_index_;
+          if (!errors::IsOutOfRange(s)) {
+            return s;
+          }
+        }
+
         // We are currently processing a file, so try to read the next record.
         if (reader_) {
           out_tensors->emplace_back(ctx->allocator({}), DT_STRING,
@@ -178,6 +299,22 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       *num_skipped = 0;
       mutex_lock l(mu_);
       do {
+        if (memmap_reader_) {
+          int last_num_skipped;
+          Status s = memmap_reader_->SkipRecords(
+              &memmap_offset_, num_to_skip - *num_skipped, &last_num_skipped);
+          *num_skipped += last_num_skipped;
+          if (s.ok()) {
+            *end_of_sequence = false;
+            return absl::OkStatus();
+          }
+          ResetStreamsLocked();
+          ++current_file_index_;
+          if (!errors::IsOutOfRange(s)) {
+            return s;
+          }
+        }
+
         // We are currently processing a file, so try to skip reading
         // the next (num_to_skip - *num_skipped) record.
         if (reader_) {
@@ -229,12 +366,18 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       if (reader_) {
         TF_RETURN_IF_ERROR(
             writer->WriteScalar(prefix(), kOffset, reader_->TellOffset()));
+      } else if (memmap_reader_) {
+        TF_RETURN_IF_ERROR(writer->WriteScalar(
+            prefix(), kOffset, static_cast<int64_t>(memmap_offset_)));
       }
       return absl::OkStatus();
     }
 
     Status RestoreInternal(IteratorContext* ctx,
                            IteratorStateReader* reader) override {
+      if (ctx->restored_element_count().has_value()) {
+        return global_shuffle_iterator_.Restore(ctx);
+      }
       mutex_lock l(mu_);
       ResetStreamsLocked();
       int64_t current_file_index;
@@ -245,7 +388,16 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
         int64_t offset;
         TF_RETURN_IF_ERROR(reader->ReadScalar(prefix(), kOffset, &offset));
         TF_RETURN_IF_ERROR(SetupStreamsLocked(ctx->env()));
-        TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        if (memmap_reader_) {
+          if (static_cast<uint64>(offset) < memmap_offset_) {
+            return errors::InvalidArgument(
+                "Trying to seek offset: ", offset,
+                " which is less than the current offset: ", memmap_offset_);
+          }
+          memmap_offset_ = offset;
+        } else {
+          TF_RETURN_IF_ERROR(reader_->SeekOffset(offset));
+        }
       }
       return absl::OkStatus();
     }
@@ -260,9 +412,25 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
       }
 
       // Actually move on to next file.
-      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(
-          TranslateFileName(dataset()->filenames_[current_file_index_]),
-          &file_));
+      const string filename =
+          TranslateFileName(dataset()->filenames_[current_file_index_]);
+      if (dataset()->use_memmap_) {
+        std::unique_ptr<ReadOnlyMemoryRegion> region;
+        Status s = env->NewReadOnlyMemoryRegionFromFile(filename, &region);
+        if (s.ok()) {
+          memmap_reader_ = std::make_unique<io::MemmappedRecordReader>(
+              std::move(region), dataset()->verify_data_checksum_);
+          memmap_offset_ = dataset()->byte_offsets_.empty()
+                               ? 0
+                               : dataset()->byte_offsets_[current_file_index_];
+          return absl::OkStatus();
+        }
+        // File systems that cannot map files (e.g. remote ones) fall back to
+        // the buffered reader below.
+        VLOG(2) << "Could not memory-map " << filename
+                << ", falling back to buffered reads: " << s;
+      }
+      TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file_));
       reader_ = std::make_unique<io::SequentialRecordReader>(
           file_.get(), dataset()->options_);
       if (!dataset()->byte_offsets_.empty()) {
@@ -276,6 +444,8 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     void ResetStreamsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
       reader_.reset();
       file_.reset();
+      memmap_reader_.reset();
+      memmap_offset_ = 0;
     }
 
     mutex mu_;
@@ -285,13 +455,60 @@ class TFRecordDatasetOp::Dataset : public DatasetBase {
     // we must destroy `reader_` before `file_`.
     std::unique_ptr<RandomAccessFile> file_ TF_GUARDED_BY(mu_);
     std::unique_ptr<io::SequentialRecordReader> reader_ TF_GUARDED_BY(mu_);
+
+    // Set instead of `file_` and `reader_` when the current file is read
+    // through a memory mapping.
+    std::unique_ptr<io::MemmappedRecordReader> memmap_reader_
+        TF_GUARDED_BY(mu_);
+    uint64 memmap_offset_ TF_GUARDED_BY(mu_) = 0;
+
+    GlobalShuffleIterator global_shuffle_iterator_;
   };
 
+  // Loads the record index of every file. Indices are read from the sidecar
+  // next to each file, or built by scanning the file and cached there.
+  Status LoadRecordIndicesLocked() const
+      TF_EXCLUSIVE_LOCKS_REQUIRED(index_mu_) {
+    if (!record_indices_.empty() || filenames_.empty()) {
+      return absl::OkStatus();
+    }
+    std::vector<io::RecordIndex> record_indices(filenames_.size());
+    std::vector<int64_t> cumulative_record_counts(filenames_.size());
+    int64_t num_records = 0;
+    for (size_t i = 0; i < filenames_.size(); ++i) {
+      TF_RETURN_IF_ERROR(io::LoadOrBuildRecordIndex(
+          env_, TranslateFileName(filenames_[i]), &record_indices[i]));
+      num_records += record_indices[i].entries.size();
+      cumulative_record_counts[i] = num_records;
+    }
+    record_indices_ = std::move(record_indices);
+    cumulative_record_counts_ = std::move(cumulative_record_counts);
+    files_.resize(filenames_.size());
+    return absl::OkStatus();
+  }
+
+  Env* const env_;
   const std::vector<string> filenames_;
   const tstring compression_type_;
   io::RecordReaderOptions options_;
   const std::vector<int64_t> byte_offsets_;
   const int op_version_;
+  // Whether uncompressed files are read through a memory mapping instead of
+  // buffered reads.
+  const bool use_memmap_;
+  // Whether the memory-mapped reader verifies the data checksum of each
+  // record. Length checksums are always verified.
+  const bool verify_data_checksum_;
+  absl::Status random_indexing_compatible_ = absl::OkStatus();
+
+  // Lazily loaded state used for random access.
+  mutable mutex index_mu_;
+  mutable std::vector<io::RecordIndex> record_indices_ TF_GUARDED_BY(index_mu_);
+  // Number of records in files [0, i] for the i-th file.
+  mutable std::vector<int64_t> cumulative_record_counts_
+      TF_GUARDED_BY(index_mu_);
+  mutable std::vector<std::unique_ptr<RandomAccessFile>> files_
+      TF_GUARDED_BY(index_mu_);
 };
 
 TFRecordDatasetOp::TFRecordDatasetOp(OpKernelConstruction* ctx)
@@ -362,8 +579,13 @@ void TFRecordDatasetOp::MakeDataset(OpKernelContext* ctx,
     buffer_size = kS3BlockSize;
   }
 
-  *output = new Dataset(ctx, std::move(filenames), compression_type,
-                        buffer_size, std::move(byte_offsets), op_version_);
+  absl::flat_hash_set<string> experiments = GetExperiments();
+  *output = new Dataset(
+      ctx, std::move(filenames), compression_type, buffer_size,
+      std::move(byte_offsets), op_version_,
+      /*use_memmap=*/experiments.contains(kMemmapExperiment),
+      /*verify_data_checksum=*/
+      !experiments.contains(kMemmapSkipDataChecksumExperiment));
 }
 
 namespace {
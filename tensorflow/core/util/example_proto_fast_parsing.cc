@@ -15,13 +15,21 @@ limitations under the License.
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <functional>
 #include <optional>
 #include <utility>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include "absl/base/casts.h"
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/numeric/bits.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
 #include "tensorflow/core/framework/allocator.h"
@@ -37,7 +45,6 @@ limitations under the License.
 #include "tensorflow/core/platform/byte_order.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/protobuf.h"
-#include "tensorflow/core/util/presized_cuckoo_map.h"
 #include "tensorflow/core/util/sparse/sparse_tensor.h"
 
 namespace tensorflow {
@@ -117,6 +124,79 @@ constexpr uint8 kVarintTag(uint32 tag) { return (tag << 3) | 0; }
 constexpr uint8 kDelimitedTag(uint32 tag) { return (tag << 3) | 2; }
 constexpr uint8 kFixed32Tag(uint32 tag) { return (tag << 3) | 5; }
 
+// Reads a varint32 from [*p, end) and advances *p past it.
+inline bool ReadVarint32(const uint8** p, const uint8* end, uint32* value) {
+  uint32 result = 0;
+  for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+    const uint8 byte = *(*p)++;
+    result |= static_cast<uint32>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns a mask with bit i set iff byte i of the 16 bytes at `p` has its
+// varint continuation bit set.
+inline uint32 ContinuationMask16(const uint8* p) {
+#if defined(__SSE2__)
+  return static_cast<uint32>(
+      _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+#else
+  uint32 mask = 0;
+  for (int i = 0; i < 16; ++i) {
+    mask |= static_cast<uint32>(p[i] >> 7) << i;
+  }
+  return mask;
+#endif
+}
+
+// Returns the number of varints in [p, end), i.e. the number of bytes without
+// a continuation bit.
+inline size_t CountVarints(const uint8* p, const uint8* end) {
+  size_t num_varints = 0;
+  for (; end - p >= 16; p += 16) {
+    num_varints += 16 - absl::popcount(ContinuationMask16(p));
+  }
+  for (; p < end; ++p) {
+    num_varints += (*p & 0x80) == 0;
+  }
+  return num_varints;
+}
+
+// Decodes the packed varints in [p, end) into `out`. Runs of 16 single-byte
+// varints, which are common for ids and small counts, are widened without
+// per-byte branches. The caller must ensure that [p, end) ends with a byte
+// without a continuation bit.
+inline bool DecodePackedVarints(const uint8* p, const uint8* end,
+                                int64_t* out) {
+  while (p < end) {
+    if (end - p >= 16 && ContinuationMask16(p) == 0) {
+      for (int i = 0; i < 16; ++i) {
+        out[i] = p[i];
+      }
+      p += 16;
+      out += 16;
+      continue;
+    }
+    // Same semantics as CodedInputStream::ReadVarint64: at most 10 bytes, and
+    // bits beyond 64 are dropped.
+    uint64 value = 0;
+    int i = 0;
+    for (; i < 10; ++i) {
+      const uint8 byte = p[i];
+      value |= static_cast<uint64>(byte & 0x7F) << (7 * i);
+      if ((byte & 0x80) == 0) break;
+    }
+    if (i == 10) return false;
+    p += i + 1;
+    *out++ = static_cast<int64_t>(value);
+  }
+  return true;
+}
+
 namespace parsed {
 
 // ParseDataType has to be called first, then appropriate ParseZzzzList.
@@ -325,9 +405,51 @@ class Feature {
     return true;
   }
 
+  // Fast paths for fixed-length dense features, which write straight into the
+  // output tensor. They handle a list holding exactly `num_elements` values in
+  // a single packed field, which is how proto serializers write lists, and
+  // return false for anything else. In that case the contents of `out` are
+  // unspecified and the generic ParseFloatList/ParseInt64List must be used,
+  // which also reports errors.
+  bool ParseFixedLengthFloatList(float* out, size_t num_elements) const {
+    if (!port::kLittleEndian) return false;
+    StringPiece packed;
+    if (!GetSinglePackedField(&packed)) return false;
+    if (packed.size() != num_elements * sizeof(float)) return false;
+    std::memcpy(out, packed.data(), packed.size());
+    return true;
+  }
+
+  bool ParseFixedLengthInt64List(int64_t* out, size_t num_elements) const {
+    StringPiece packed;
+    if (!GetSinglePackedField(&packed)) return false;
+    const uint8* begin = reinterpret_cast<const uint8*>(packed.data());
+    const uint8* end = begin + packed.size();
+    if (begin == end || (end[-1] & 0x80) != 0) return false;
+    if (CountVarints(begin, end) != num_elements) return false;
+    return DecodePackedVarints(begin, end, out);
+  }
+
   StringPiece GetSerialized() const { return serialized_; }
 
  private:
+  // Sets `packed` to the payload of the list if the list consists of a single
+  // non-empty packed field.
+  bool GetSinglePackedField(StringPiece* packed) const {
+    const uint8* p = reinterpret_cast<const uint8*>(serialized_.data());
+    const uint8* end = p + serialized_.size();
+    uint32 length;
+    if (!ReadVarint32(&p, end, &length)) return false;
+    if (length == 0 || length > static_cast<size_t>(end - p)) return false;
+    end = p + length;
+    if (*p++ != kDelimitedTag(1)) return false;
+    uint32 packed_length;
+    if (!ReadVarint32(&p, end, &packed_length)) return false;
+    if (packed_length != static_cast<size_t>(end - p)) return false;
+    *packed = StringPiece(reinterpret_cast<const char*>(p), packed_length);
+    return true;
+  }
+
   // TODO(lew): Pair of uint8* would be more natural.
   StringPiece serialized_;
 };
@@ -519,24 +641,37 @@ namespace {
 
 using Config = FastParseExampleConfig;
 
+// Runs f(i) for every i in [0, n) on the calling thread and up to
+// thread_pool->NumThreads() pool threads. Workers repeatedly claim the next
+// unprocessed index, so workers that finish early take over the remaining
+// work of slow ones instead of idling.
 void ParallelFor(const std::function<void(size_t)>& f, size_t n,
                  thread::ThreadPool* thread_pool) {
   if (n == 0) return;
-  if (thread_pool == nullptr) {
+  if (thread_pool == nullptr || n == 1) {
     for (size_t i = 0; i < n; ++i) {
       f(i);
     }
-  } else {
-    BlockingCounter counter(n - 1);
-    for (size_t i = 1; i < n; ++i) {
-      thread_pool->Schedule([i, &f, &counter] {
-        f(i);
-        counter.DecrementCount();
-      });
-    }
-    f(0);
-    counter.Wait();
+    return;
   }
+  std::atomic<size_t> next_index(0);
+  auto work = [&f, &next_index, n] {
+    for (size_t i = next_index.fetch_add(1, std::memory_order_relaxed); i < n;
+         i = next_index.fetch_add(1, std::memory_order_relaxed)) {
+      f(i);
+    }
+  };
+  const size_t num_helpers =
+      std::min<size_t>(n - 1, thread_pool->NumThreads());
+  BlockingCounter counter(num_helpers);
+  for (size_t i = 0; i < num_helpers; ++i) {
+    thread_pool->Schedule([&work, &counter] {
+      work();
+      counter.DecrementCount();
+    });
+  }
+  work();
+  counter.Wait();
 }
 
 // Enumeration for distinguishing feature types.
@@ -565,6 +700,148 @@ struct SeededHasher {
   uint64 seed{0xDECAFCAFFE};
 };
 
+// Perfect hash index from feature name to the feature's position in a config,
+// compiled from the config once per parse call.
+//
+// It uses hash and displace: names are split into small buckets by a seeded
+// hash, and each bucket is assigned a displacement that maps all of its names
+// to free slots of a table with at least twice as many slots as names. A
+// lookup hashes the name once, probes a single slot, and compares the name to
+// reject features that are not in the config.
+class ConfigIndex {
+ public:
+  struct Entry {
+    // Null for empty slots.
+    const tstring* feature_name = nullptr;
+    size_t index = 0;
+    Type type = Type::Dense;
+  };
+
+  Status Init(const Config& config) {
+    std::vector<Entry> entries;
+    entries.reserve(config.dense.size() + config.sparse.size() +
+                    config.ragged.size());
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      entries.push_back({&config.dense[d].feature_name, d, Type::Dense});
+    }
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      entries.push_back({&config.sparse[d].feature_name, d, Type::Sparse});
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      entries.push_back({&config.ragged[d].feature_name, d, Type::Ragged});
+    }
+    absl::flat_hash_set<StringPiece> feature_names;
+    for (const Entry& entry : entries) {
+      if (!feature_names.insert(*entry.feature_name).second) {
+        return errors::Internal("Duplicate feature name in config: ",
+                                *entry.feature_name);
+      }
+    }
+
+    for (size_t i = 0; i < 1000; ++i) {
+      if (TryBuild(entries)) return absl::OkStatus();
+      LOG(WARNING) << "Collision found. This should happen only if you have "
+                      "around 2^32 entries in your config.";
+      hasher_.seed++;
+    }
+    return errors::Internal(
+        "Could not avoid collision. This should not happen.");
+  }
+
+  // Returns the entry for `feature_name`, or nullptr if it is not in the
+  // config.
+  const Entry* Find(StringPiece feature_name) const {
+    const uint64 h = hasher_(feature_name);
+    const Entry& entry =
+        slots_[SlotOf(h, displacements_[h & bucket_mask_], slot_mask_)];
+    if (entry.feature_name == nullptr || *entry.feature_name != feature_name) {
+      return nullptr;
+    }
+    return &entry;
+  }
+
+ private:
+  // Gives up on a bucket after this many displacements and picks a new seed.
+  static constexpr uint32 kMaxDisplacement = 1 << 16;
+
+  static size_t NextPowerOfTwo(size_t n) {
+    size_t result = 1;
+    while (result < n) result <<= 1;
+    return result;
+  }
+
+  // Derives a slot from the name hash and the displacement of its bucket with
+  // the MurmurHash3 finalizer, so the bucket bits of `h` do not bias it.
+  static size_t SlotOf(uint64 h, uint32 displacement, uint64 slot_mask) {
+    uint64 x = h ^ (displacement * 0x9E3779B97F4A7C15ULL);
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x & slot_mask;
+  }
+
+  bool TryBuild(const std::vector<Entry>& entries) {
+    const size_t num_buckets = NextPowerOfTwo((entries.size() + 3) / 4);
+    const size_t num_slots = NextPowerOfTwo(2 * entries.size());
+    bucket_mask_ = num_buckets - 1;
+    slot_mask_ = num_slots - 1;
+    displacements_.assign(num_buckets, 0);
+    slots_.assign(num_slots, Entry());
+
+    std::vector<uint64> hashes(entries.size());
+    std::vector<std::vector<size_t>> buckets(num_buckets);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      hashes[i] = hasher_(*entries[i].feature_name);
+      buckets[hashes[i] & bucket_mask_].push_back(i);
+    }
+    // Placing big buckets first, while the table is mostly empty, keeps the
+    // displacement search short.
+    std::vector<size_t> bucket_order(num_buckets);
+    for (size_t b = 0; b < num_buckets; ++b) bucket_order[b] = b;
+    std::stable_sort(bucket_order.begin(), bucket_order.end(),
+                     [&](size_t a, size_t b) {
+                       return buckets[a].size() > buckets[b].size();
+                     });
+
+    std::vector<size_t> bucket_slots;
+    for (size_t b : bucket_order) {
+      const std::vector<size_t>& bucket = buckets[b];
+      if (bucket.empty()) break;
+      bool placed = false;
+      for (uint32 displacement = 0; displacement < kMaxDisplacement;
+           ++displacement) {
+        bucket_slots.clear();
+        for (size_t i : bucket) {
+          size_t slot = SlotOf(hashes[i], displacement, slot_mask_);
+          if (slots_[slot].feature_name != nullptr ||
+              std::find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+                  bucket_slots.end()) {
+            break;
+          }
+          bucket_slots.push_back(slot);
+        }
+        if (bucket_slots.size() != bucket.size()) continue;
+        for (size_t j = 0; j < bucket.size(); ++j) {
+          slots_[bucket_slots[j]] = entries[bucket[j]];
+        }
+        displacements_[b] = displacement;
+        placed = true;
+        break;
+      }
+      if (!placed) return false;
+    }
+    return true;
+  }
+
+  SeededHasher hasher_;
+  uint64 bucket_mask_ = 0;
+  uint64 slot_mask_ = 0;
+  std::vector<uint32> displacements_;
+  std::vector<Entry> slots_;
+};
+
 void LogDenseFeatureDataLoss(StringPiece feature_name) {
   LOG(WARNING) << "Data loss! Feature '" << feature_name
                << "' is present in multiple concatenated "
@@ -590,8 +867,7 @@ void LogSparseFeatureDataLoss(StringPiece feature_name) {
 Status FastParseSerializedExample(
     const tstring& serialized_example, const tstring& example_name,
     const size_t example_index, const Config& config,
-    const PresizedCuckooMap<std::pair<size_t, Type>>& config_index,
-    SeededHasher hasher, std::vector<Tensor>* output_dense,
+    const ConfigIndex& config_index, std::vector<Tensor>* output_dense,
     std::vector<SparseBuffer>* output_varlen_dense,
     std::vector<SparseBuffer>* output_sparse,
     std::vector<SparseBuffer>* output_ragged,
@@ -627,23 +903,12 @@ Status FastParseSerializedExample(
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
+    const ConfigIndex::Entry* entry = config_index.Find(feature_name);
+    if (entry == nullptr) continue;
 
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-    bool is_ragged = d_and_type.second == Type::Ragged;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const tstring& config_feature_name =
-          is_dense ? config.dense[d].feature_name
-                   : (is_ragged ? config.ragged[d].feature_name
-                                : config.sparse[d].feature_name);
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d = entry->index;
+    bool is_dense = entry->type == Type::Dense;
+    bool is_ragged = entry->type == Type::Ragged;
 
     auto example_error = [&](StringPiece suffix) {
       return errors::InvalidArgument("Name: ", example_name,
@@ -700,6 +965,7 @@ Status FastParseSerializedExample(
         switch (config.dense[d].dtype) {
           case DT_INT64: {
             auto out_p = out.flat<int64_t>().data() + offset;
+            if (feature.ParseFixedLengthInt64List(out_p, num_elements)) break;
             LimitedArraySlice<int64_t> slice(out_p, num_elements);
             if (!feature.ParseInt64List(&slice)) return parse_error();
             if (slice.EndDistance() != 0) {
@@ -709,6 +975,7 @@ Status FastParseSerializedExample(
           }
           case DT_FLOAT: {
             auto out_p = out.flat<float>().data() + offset;
+            if (feature.ParseFixedLengthFloatList(out_p, num_elements)) break;
             LimitedArraySlice<float> slice(out_p, num_elements);
             if (!feature.ParseFloatList(&slice)) return parse_error();
             if (slice.EndDistance() != 0) {
@@ -1013,47 +1280,38 @@ void CopyOrMoveBlock(const tstring* b, const tstring* e, tstring* t) {
   std::move(b, e, t);
 }
 
+// Writes the examples of one minibatch `buffer` of a variable-length dense
+// feature to `data`, which points to the first of them in the output tensor,
+// padding each example to `num_elements_per_example` with the default value.
 template <typename T>
-void FillAndCopyVarLen(
-    const int d, const size_t num_elements,
-    const size_t num_elements_per_minibatch, const Config& config,
-    const std::vector<std::vector<SparseBuffer>>& varlen_dense_buffers,
-    Tensor* values) {
+void FillAndCopyVarLen(const int d, const size_t num_elements_per_example,
+                       const Config& config, const SparseBuffer& buffer,
+                       T* data) {
   const Tensor& default_value = config.dense[d].default_value;
+  // Number of examples being stored in this buffer
+  const auto& end_indices = buffer.example_end_indices;
+  const size_t examples_in_buffer = end_indices.size();
 
   // Copy-fill the tensors (creating the zero/fill-padding)
-  std::fill(values->flat<T>().data(), values->flat<T>().data() + num_elements,
+  std::fill(data, data + examples_in_buffer * num_elements_per_example,
             default_value.flat<T>()(0));
 
-  // Data is [batch_size, max_num_elements, data_stride_size]
-  //   and num_elements_per_minibatch = max_num_elements * data_stride_size
-  auto data = values->flat<T>().data();
-
-  // Iterate over minibatch elements
-  for (size_t i = 0; i < varlen_dense_buffers.size(); ++i) {
-    const SparseBuffer& buffer = varlen_dense_buffers[i][d];
-    // Number of examples being stored in this buffer
-    const auto& end_indices = buffer.example_end_indices;
-    const size_t examples_in_buffer = end_indices.size();
-    // const size_t stride_size = config.dense[d].elements_per_stride;
-
-    const auto& list = GetListFromBuffer<T>(buffer);
-    auto list_ptr = list.begin();
-
-    size_t elements_tally = 0;
-    // Iterate through all the examples stored in this buffer.
-    for (size_t j = 0; j < examples_in_buffer; ++j) {
-      // Number of elements stored for this example.
-      const size_t num_elems = end_indices[j] - elements_tally;
-      CopyOrMoveBlock(list_ptr, list_ptr + num_elems, data);
-      // Move forward this many elements in the varlen buffer.
-      list_ptr += num_elems;
-      // Move forward to the next minibatch entry in the values output.
-      data += num_elements_per_minibatch;
-      elements_tally = end_indices[j];
-    }
-    DCHECK(elements_tally == list.size());
-  }
+  const auto& list = GetListFromBuffer<T>(buffer);
+  auto list_ptr = list.begin();
+
+  size_t elements_tally = 0;
+  // Iterate through all the examples stored in this buffer.
+  for (size_t j = 0; j < examples_in_buffer; ++j) {
+    // Number of elements stored for this example.
+    const size_t num_elems = end_indices[j] - elements_tally;
+    CopyOrMoveBlock(list_ptr, list_ptr + num_elems, data);
+    // Move forward this many elements in the varlen buffer.
+    list_ptr += num_elems;
+    // Move forward to the next example in the values output.
+    data += num_elements_per_example;
+    elements_tally = end_indices[j];
+  }
+  DCHECK(elements_tally == list.size());
 }
 
 // Thin vector like interface wrapper around a Tensor. This enable us to
@@ -1091,19 +1349,33 @@ class TensorVector {
   T* data_ = nullptr;
 };
 
-void CountSparseFeatures(
-    const std::vector<std::vector<SparseBuffer>>& sparse_buffers, size_t d,
-    size_t* total_num_features, size_t* max_num_features) {
-  for (auto& sparse_values_tmp : sparse_buffers) {
+// Layout of a sparse, ragged or variable-length dense feature after merging
+// the SparseBuffers of all minibatches.
+struct MergedLayout {
+  // Offset of each minibatch's values in the merged values, followed by the
+  // total number of values.
+  std::vector<size_t> value_offsets;
+  // Maximum number of values of a single example.
+  size_t max_num_values = 0;
+};
+
+MergedLayout GetMergedLayout(
+    const std::vector<std::vector<SparseBuffer>>& buffers, size_t d) {
+  MergedLayout layout;
+  layout.value_offsets.reserve(buffers.size() + 1);
+  layout.value_offsets.push_back(0);
+  for (const std::vector<SparseBuffer>& minibatch_buffers : buffers) {
     const std::vector<size_t>& end_indices =
-        sparse_values_tmp[d].example_end_indices;
-    *total_num_features += end_indices.back();
-    *max_num_features = std::max(*max_num_features, end_indices[0]);
+        minibatch_buffers[d].example_end_indices;
+    layout.value_offsets.push_back(layout.value_offsets.back() +
+                                   end_indices.back());
+    layout.max_num_values = std::max(layout.max_num_values, end_indices[0]);
     for (size_t i = 1; i < end_indices.size(); ++i) {
-      size_t example_size = end_indices[i] - end_indices[i - 1];
-      *max_num_features = std::max(*max_num_features, example_size);
+      layout.max_num_values =
+          std::max(layout.max_num_values, end_indices[i] - end_indices[i - 1]);
     }
   }
+  return layout;
 }
 
 void CopySparseBufferToTensor(DataType dtype, size_t offset, SparseBuffer* src,
@@ -1143,36 +1415,8 @@ Status FastParseExample(const Config& config,
     result->feature_stats.resize(serialized.size());
   }
 
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  ConfigIndex config_index;
+  TF_RETURN_IF_ERROR(config_index.Init(config));
 
   // Allocate dense output for fixed length dense values
   // (variable-length dense and sparse and ragged have to be buffered).
@@ -1193,6 +1437,7 @@ Status FastParseExample(const Config& config,
   // Calculate number of minibatches.
   // In main regime make each minibatch around kMiniBatchSizeBytes bytes.
   // Apply 'special logic' below for small and big regimes.
+  size_t total_serialized_bytes = 0;
   const size_t num_minibatches = [&] {
     size_t result = 0;
     size_t minibatch_bytes = 0;
@@ -1201,13 +1446,23 @@ Status FastParseExample(const Config& config,
         result++;
       }
       minibatch_bytes += serialized[i].size() + 1;
+      total_serialized_bytes += serialized[i].size() + 1;
       if (minibatch_bytes > kMiniBatchSizeBytes) {
         minibatch_bytes = 0;
       }
     }
     // 'special logic'
-    const size_t min_minibatches = std::min<size_t>(8, serialized.size());
-    const size_t max_minibatches = 64;
+    // With a thread pool, give every worker several minibatches so that
+    // workers which finish early can take over minibatches of expensive
+    // examples (see ParallelFor).
+    const size_t num_workers =
+        thread_pool != nullptr ? thread_pool->NumThreads() + 1 : 1;
+    const size_t kMiniBatchesPerWorker = 4;
+    const size_t min_minibatches = std::min<size_t>(
+        std::max<size_t>(8, kMiniBatchesPerWorker * num_workers),
+        serialized.size());
+    const size_t max_minibatches =
+        std::max<size_t>(64, kMiniBatchesPerWorker * num_workers);
     return std::max<size_t>(min_minibatches,
                             std::min<size_t>(max_minibatches, result));
   }();
@@ -1243,9 +1498,8 @@ Status FastParseExample(const Config& config,
       status_of_minibatch[minibatch] = FastParseSerializedExample(
           serialized[e],
           (!example_names.empty() ? example_names[e] : "<unknown>"), e, config,
-          config_index, hasher, &fixed_dense_values,
-          &varlen_dense_buffers[minibatch], &sparse_buffers[minibatch],
-          &ragged_buffers[minibatch], stats);
+          config_index, &fixed_dense_values, &varlen_dense_buffers[minibatch],
+          &sparse_buffers[minibatch], &ragged_buffers[minibatch], stats);
       if (!status_of_minibatch[minibatch].ok()) break;
     }
   };
@@ -1267,67 +1521,69 @@ Status FastParseExample(const Config& config,
     result->dense_values.push_back(std::move(fixed_dense_values[d]));
   }
 
-  // Merge SparseBuffers from all minibatches for every config.sparse.
-  auto MergeSparseMinibatches = [&](size_t d) {
-    // Loop over minibatches
-    size_t total_num_features = 0;
-    size_t max_num_features = 0;
-    CountSparseFeatures(sparse_buffers, d, &total_num_features,
-                        &max_num_features);
+  // The SparseBuffers of all minibatches are merged in two passes. The first
+  // one computes where the values of every minibatch go in the merged
+  // outputs, which are then allocated, and the second one copies every
+  // (feature, minibatch) pair independently. Small batches are merged on the
+  // calling thread, where scheduling would cost more than the copies.
+  thread::ThreadPool* merge_thread_pool =
+      total_serialized_bytes > kMiniBatchSizeBytes ? thread_pool : nullptr;
+  const size_t num_sparse = config.sparse.size();
+  const size_t num_dense = config.dense.size();
+  const size_t num_ragged = config.ragged.size();
+  const size_t num_merged_features = num_sparse + num_dense + num_ragged;
+
+  std::vector<MergedLayout> sparse_layouts(num_sparse);
+  std::vector<MergedLayout> varlen_dense_layouts(num_dense);
+  std::vector<MergedLayout> ragged_layouts(num_ragged);
+  auto ComputeMergedLayout = [&](size_t f) {
+    if (f < num_sparse) {
+      sparse_layouts[f] = GetMergedLayout(sparse_buffers, f);
+    } else if (f < num_sparse + num_dense) {
+      const size_t d = f - num_sparse;
+      if (!config.dense[d].variable_length) return;
+      varlen_dense_layouts[d] = GetMergedLayout(varlen_dense_buffers, d);
+    } else {
+      const size_t d = f - num_sparse - num_dense;
+      ragged_layouts[d] = GetMergedLayout(ragged_buffers, d);
+    }
+  };
+  ParallelFor(ComputeMergedLayout, num_merged_features, merge_thread_pool);
+
+  for (size_t d = 0; d < num_sparse; ++d) {
+    const size_t total_num_features = sparse_layouts[d].value_offsets.back();
 
     TensorShape indices_shape;
     indices_shape.AddDim(total_num_features);
     indices_shape.AddDim(2);
     result->sparse_indices.emplace_back(DT_INT64, indices_shape);
-    Tensor* indices = &result->sparse_indices.back();
 
     TensorShape values_shape;
     values_shape.AddDim(total_num_features);
     result->sparse_values.emplace_back(config.sparse[d].dtype, values_shape);
-    Tensor* values = &result->sparse_values.back();
 
     result->sparse_shapes.emplace_back(DT_INT64, TensorShape({2}));
     auto shapes_shape_t = result->sparse_shapes.back().vec<int64_t>();
     shapes_shape_t(0) = serialized.size();
-    shapes_shape_t(1) = max_num_features;
-
-    size_t offset = 0;
-    for (size_t i = 0; i < sparse_buffers.size(); ++i) {
-      SparseBuffer& buffer = sparse_buffers[i][d];
-
-      // Update indices.
-      size_t delta = 0;
-
-      if (indices->NumElements() > 0) {
-        int64* ix_p = &indices->matrix<int64_t>()(offset, 0);
-        size_t example_index = first_example_of_minibatch(i);
-        for (size_t example_end_index : buffer.example_end_indices) {
-          size_t feature_index = 0;
-          for (; delta < example_end_index; ++delta) {
-            // Column 0: example index
-            *ix_p = example_index;
-            // Column 1: the feature index buffer example
-            *(ix_p + 1) = feature_index;
-            ix_p += 2;
-            ++feature_index;
-          }
-          ++example_index;
-        }
-      }
+    shapes_shape_t(1) = sparse_layouts[d].max_num_values;
+  }
 
-      CopySparseBufferToTensor(config.sparse[d].dtype, offset, &buffer, values);
-      offset += delta;
+  for (size_t d = 0; d < num_dense; ++d) {
+    if (!config.dense[d].variable_length) continue;
+    const size_t max_num_features = varlen_dense_layouts[d].max_num_values;
+    const size_t stride_size = config.dense[d].elements_per_stride;
+    const size_t max_num_elements = max_num_features / stride_size;
+    TensorShape values_shape;
+    DCHECK_EQ(max_num_features % config.dense[d].elements_per_stride, 0);
+    values_shape.AddDim(serialized.size());
+    values_shape.AddDim(max_num_elements);
+    for (int i = 1; i < config.dense[d].shape.dims(); ++i) {
+      values_shape.AddDim(config.dense[d].shape.dim_size(i));
     }
-  };
-
-  // Merge SparseBuffers from all minibatches for every config.ragged.
-  auto MergeRaggedMinibatches = [&](size_t d) {
-    // Loop over minibatches
-    size_t total_num_features = 0;
-    size_t max_num_features = 0;
-    CountSparseFeatures(ragged_buffers, d, &total_num_features,
-                        &max_num_features);
+    result->dense_values[d] = Tensor(config.dense[d].dtype, values_shape);
+  }
 
+  for (size_t d = 0; d < num_ragged; ++d) {
     TensorShape row_splits_shape;
     row_splits_shape.AddDim(serialized.size() + 1);
     result->ragged_splits.emplace_back(config.ragged[d].splits_dtype,
@@ -1340,89 +1596,96 @@ Status FastParseExample(const Config& config,
     }
 
     TensorShape values_shape;
-    values_shape.AddDim(total_num_features);
+    values_shape.AddDim(ragged_layouts[d].value_offsets.back());
     result->ragged_values.emplace_back(config.ragged[d].dtype, values_shape);
-    Tensor* values = &result->ragged_values.back();
-
-    size_t values_offset = 0;
-    size_t splits_offset = 0;
-    for (size_t i = 0; i < ragged_buffers.size(); ++i) {
-      SparseBuffer& buffer = ragged_buffers[i][d];
-      if (buffer.example_end_indices.empty()) continue;
-
-      // Update row_splits.  row_splits are formed by concatenating the example
-      // end_indices (adjusting each to start after the previous one ends).
-      if (config.ragged[d].splits_dtype == DT_INT64) {
-        int64* row_splits_out = &row_splits->flat<int64_t>()(splits_offset);
-        int64_t start = *row_splits_out;
-        for (size_t example_end_index : buffer.example_end_indices) {
-          *++row_splits_out = start + example_end_index;
-        }
-      } else {
-        int32* row_splits_out = &row_splits->flat<int32>()(splits_offset);
-        int32_t start = *row_splits_out;
-        for (size_t example_end_index : buffer.example_end_indices) {
-          *++row_splits_out = start + example_end_index;
-        }
-      }
+  }
 
-      CopySparseBufferToTensor(config.ragged[d].dtype, values_offset, &buffer,
-                               values);
-      values_offset += buffer.example_end_indices.back();
-      splits_offset += buffer.example_end_indices.size();
-    }
+  // Copies the SparseBuffer of minibatch i for config.sparse[d].
+  auto MergeSparseMinibatch = [&](size_t d, size_t i) {
+    SparseBuffer& buffer = sparse_buffers[i][d];
+    const size_t offset = sparse_layouts[d].value_offsets[i];
+    if (sparse_layouts[d].value_offsets[i + 1] == offset) return;
+
+    // Update indices.
+    int64_t* ix_p =
+        result->sparse_indices[d].flat<int64_t>().data() + 2 * offset;
+    size_t example_index = first_example_of_minibatch(i);
+    size_t delta = 0;
+    for (size_t example_end_index : buffer.example_end_indices) {
+      size_t feature_index = 0;
+      for (; delta < example_end_index; ++delta) {
+        // Column 0: example index
+        *ix_p = example_index;
+        // Column 1: the feature index buffer example
+        *(ix_p + 1) = feature_index;
+        ix_p += 2;
+        ++feature_index;
+      }
+      ++example_index;
+    }
+
+    CopySparseBufferToTensor(config.sparse[d].dtype, offset, &buffer,
+                             &result->sparse_values[d]);
   };
 
-  // Merge SparseBuffers from all minibatches for every config.dense having
-  // variable_length.
-  auto MergeDenseVarLenMinibatches = [&](size_t d) {
-    if (!config.dense[d].variable_length) return;
+  // Copies the SparseBuffer of minibatch i for config.ragged[d].
+  auto MergeRaggedMinibatch = [&](size_t d, size_t i) {
+    SparseBuffer& buffer = ragged_buffers[i][d];
+    const size_t values_offset = ragged_layouts[d].value_offsets[i];
 
-    // Loop over minibatches
-    size_t max_num_features = 0;
-    for (auto& dense_values_tmp : varlen_dense_buffers) {
-      std::vector<size_t>& end_indices =
-          dense_values_tmp[d].example_end_indices;
-      max_num_features = std::max(max_num_features, end_indices[0]);
-      for (size_t i = 1; i < end_indices.size(); ++i) {
-        size_t example_size = end_indices[i] - end_indices[i - 1];
-        max_num_features = std::max(max_num_features, example_size);
+    // Update row_splits. row_splits are formed by concatenating the example
+    // end_indices, each shifted by the number of values of the preceding
+    // minibatches.
+    const size_t splits_offset = first_example_of_minibatch(i) + 1;
+    Tensor& row_splits = result->ragged_splits[d];
+    if (config.ragged[d].splits_dtype == DT_INT64) {
+      int64_t* row_splits_out =
+          row_splits.flat<int64_t>().data() + splits_offset;
+      for (size_t example_end_index : buffer.example_end_indices) {
+        *row_splits_out++ = values_offset + example_end_index;
+      }
+    } else {
+      int32* row_splits_out = row_splits.flat<int32>().data() + splits_offset;
+      for (size_t example_end_index : buffer.example_end_indices) {
+        *row_splits_out++ = values_offset + example_end_index;
       }
     }
 
-    const size_t stride_size = config.dense[d].elements_per_stride;
-    const size_t max_num_elements = max_num_features / stride_size;
-    TensorShape values_shape;
-    DCHECK_EQ(max_num_features % config.dense[d].elements_per_stride, 0);
-    const size_t batch_size = serialized.size();
-    values_shape.AddDim(batch_size);
-    values_shape.AddDim(max_num_elements);
-    for (int i = 1; i < config.dense[d].shape.dims(); ++i) {
-      values_shape.AddDim(config.dense[d].shape.dim_size(i));
-    }
-    Tensor values(config.dense[d].dtype, values_shape);
-    result->dense_values[d] = values;
+    CopySparseBufferToTensor(config.ragged[d].dtype, values_offset, &buffer,
+                             &result->ragged_values[d]);
+  };
+
+  // Copies the SparseBuffer of minibatch i for config.dense[d] having
+  // variable_length.
+  auto MergeDenseVarLenMinibatch = [&](size_t d, size_t i) {
+    if (!config.dense[d].variable_length) return;
+    Tensor& values = result->dense_values[d];
     const size_t num_elements = values.NumElements();
 
     // Nothing to write, exit early.
     if (num_elements == 0) return;
 
-    const size_t num_elements_per_minibatch = num_elements / batch_size;
+    // Data is [batch_size, max_num_elements, data_stride_size]
+    //   and num_elements_per_example = max_num_elements * data_stride_size
+    const size_t num_elements_per_example = num_elements / serialized.size();
+    const size_t offset =
+        first_example_of_minibatch(i) * num_elements_per_example;
+    const SparseBuffer& buffer = varlen_dense_buffers[i][d];
 
     switch (config.dense[d].dtype) {
       case DT_INT64: {
-        FillAndCopyVarLen<int64_t>(d, num_elements, num_elements_per_minibatch,
-                                   config, varlen_dense_buffers, &values);
+        FillAndCopyVarLen<int64_t>(d, num_elements_per_example, config, buffer,
+                                   values.flat<int64_t>().data() + offset);
         break;
       }
       case DT_FLOAT: {
-        FillAndCopyVarLen<float>(d, num_elements, num_elements_per_minibatch,
-                                 config, varlen_dense_buffers, &values);
+        FillAndCopyVarLen<float>(d, num_elements_per_example, config, buffer,
+                                 values.flat<float>().data() + offset);
         break;
       }
       case DT_STRING: {
-        FillAndCopyVarLen<tstring>(d, num_elements, num_elements_per_minibatch,
-                                   config, varlen_dense_buffers, &values);
+        FillAndCopyVarLen<tstring>(d, num_elements_per_example, config, buffer,
+                                   values.flat<tstring>().data() + offset);
         break;
       }
       default:
@@ -1430,17 +1693,19 @@ Status FastParseExample(const Config& config,
     }
   };
 
-  for (size_t d = 0; d < config.dense.size(); ++d) {
-    MergeDenseVarLenMinibatches(d);
-  }
-
-  for (size_t d = 0; d < config.sparse.size(); ++d) {
-    MergeSparseMinibatches(d);
-  }
-
-  for (size_t d = 0; d < config.ragged.size(); ++d) {
-    MergeRaggedMinibatches(d);
-  }
+  auto MergeMinibatch = [&](size_t work_item) {
+    const size_t f = work_item / num_minibatches;
+    const size_t i = work_item % num_minibatches;
+    if (f < num_sparse) {
+      MergeSparseMinibatch(f, i);
+    } else if (f < num_sparse + num_dense) {
+      MergeDenseVarLenMinibatch(f - num_sparse, i);
+    } else {
+      MergeRaggedMinibatch(f - num_sparse - num_dense, i);
+    }
+  };
+  ParallelFor(MergeMinibatch, num_merged_features * num_minibatches,
+              merge_thread_pool);
 
   return absl::OkStatus();
 }
@@ -1458,36 +1723,8 @@ Status FastParseSingleExample(const Config& config, StringPiece serialized,
   }
 
   // TODO(mrry): Cache the construction of this map at Op construction time.
-  size_t config_size =
-      config.dense.size() + config.sparse.size() + config.ragged.size();
-  SeededHasher hasher;
-  // Build config index.
-  PresizedCuckooMap<std::pair<size_t, Type>> config_index(config_size);
-  bool ok = true;
-  for (size_t i = 0; i < 1000; ++i) {
-    for (size_t d = 0; d < config.dense.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.dense[d].feature_name),
-                                      {d, Type::Dense});
-    }
-    for (size_t d = 0; d < config.sparse.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.sparse[d].feature_name),
-                                      {d, Type::Sparse});
-    }
-    for (size_t d = 0; d < config.ragged.size(); ++d) {
-      ok &= config_index.InsertUnique(hasher(config.ragged[d].feature_name),
-                                      {d, Type::Ragged});
-    }
-    if (ok) break;
-    LOG(WARNING) << "Collision found. This should happen only if you have "
-                    "around 2^32 entries in your config.";
-    hasher.seed++;
-    config_index.Clear(config_size);
-    ok = true;
-  }
-  if (!ok) {
-    return errors::Internal(
-        "Could not avoid collision. This should not happen.");
-  }
+  ConfigIndex config_index;
+  TF_RETURN_IF_ERROR(config_index.Init(config));
 
   result->sparse_indices.reserve(config.sparse.size());
   result->sparse_values.reserve(config.sparse.size());
@@ -1556,23 +1793,12 @@ Status FastParseSingleExample(const Config& config, StringPiece serialized,
     const StringPiece feature_name = name_and_feature.first;
     parsed::Feature& feature = name_and_feature.second;
 
-    std::pair<size_t, Type> d_and_type;
-    uint64 h = hasher(feature_name);
-    if (!config_index.Find(h, &d_and_type)) continue;
+    const ConfigIndex::Entry* entry = config_index.Find(feature_name);
+    if (entry == nullptr) continue;
 
-    size_t d = d_and_type.first;
-    bool is_dense = d_and_type.second == Type::Dense;
-    bool is_sparse = d_and_type.second == Type::Sparse;
-
-    {
-      // Testing for PresizedCuckooMap collision.
-      // TODO(lew): Use dense_hash_map and avoid this and hasher creation.
-      const tstring& config_feature_name =
-          is_dense ? config.dense[d].feature_name
-                   : (is_sparse ? config.sparse[d].feature_name
-                                : config.ragged[d].feature_name);
-      if (feature_name != config_feature_name) continue;
-    }
+    size_t d = entry->index;
+    bool is_dense = entry->type == Type::Dense;
+    bool is_sparse = entry->type == Type::Sparse;
 
     auto example_error = [feature_name](StringPiece suffix) {
       return errors::InvalidArgument("Key: ", feature_name, ".  ", suffix);
@@ -1614,6 +1840,7 @@ Status FastParseSingleExample(const Config& config, StringPiece serialized,
       switch (example_dtype) {
         case DT_INT64: {
           auto out_p = out->flat<int64_t>().data();
+          if (feature.ParseFixedLengthInt64List(out_p, num_elements)) break;
           LimitedArraySlice<int64_t> slice(out_p, num_elements);
           if (!feature.ParseInt64List(&slice)) return parse_error();
           if (slice.EndDistance() != 0) {
@@ -1623,6 +1850,7 @@ Status FastParseSingleExample(const Config& config, StringPiece serialized,
         }
         case DT_FLOAT: {
           auto out_p = out->flat<float>().data();
+          if (feature.ParseFixedLengthFloatList(out_p, num_elements)) break;
           LimitedArraySlice<float> slice(out_p, num_elements);
           if (!feature.ParseFloatList(&slice)) return parse_error();
           if (slice.EndDistance() != 0) {
@@ -15,17 +15,23 @@ limitations under the License.
 
 #include "tensorflow/core/util/example_proto_fast_parsing.h"
 
+#include <memory>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
 #include "tensorflow/core/lib/random/philox_random.h"
 #include "tensorflow/core/lib/random/simple_philox.h"
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/test_benchmark.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/example_proto_fast_parsing_test.pb.h"
 
 namespace tensorflow {
@@ -429,6 +435,334 @@ TEST(TestFastParseExample, Empty) {
   EXPECT_TRUE(status.ok()) << status;
 }
 
+// Example with `num_features` dense features named "f<i>", each holding
+// `num_values` values derived from `seed`. The first 16 int64 values of a
+// feature are one-byte varints, and later ones range from one to ten bytes.
+string ExampleWithDenseFeatures(DataType dtype, int num_features,
+                                int num_values, int64_t seed) {
+  Example example;
+  auto& feature_map = *example.mutable_features()->mutable_feature();
+  for (int f = 0; f < num_features; ++f) {
+    Feature& feature = feature_map[strings::StrCat("f", f)];
+    for (int v = 0; v < num_values; ++v) {
+      const int64_t value = seed + f * num_values + v;
+      if (dtype == DT_FLOAT) {
+        feature.mutable_float_list()->add_value(value * 0.5f);
+      } else {
+        switch (v < 16 ? 0 : v % 4) {
+          case 0:
+            feature.mutable_int64_list()->add_value(value % 128);
+            break;
+          case 1:
+            feature.mutable_int64_list()->add_value(value * 1000);
+            break;
+          case 2:
+            feature.mutable_int64_list()->add_value(-value);
+            break;
+          default:
+            feature.mutable_int64_list()->add_value(value << 40);
+        }
+      }
+    }
+  }
+  feature_map["unused"].mutable_int64_list()->add_value(1);
+  return Serialize(example);
+}
+
+FastParseExampleConfig DenseFeaturesConfig(DataType dtype, int num_features,
+                                           int num_values) {
+  FastParseExampleConfig config;
+  for (int f = 0; f < num_features; ++f) {
+    config.dense.emplace_back();
+    auto& feature = config.dense.back();
+    feature.feature_name = strings::StrCat("f", f);
+    feature.dtype = dtype;
+    feature.shape = PartialTensorShape({num_values});
+    feature.default_value = Tensor(dtype, {});
+    feature.variable_length = false;
+    feature.elements_per_stride = num_values;
+  }
+  return config;
+}
+
+TEST(FastParseExample, FixedLengthDenseFeatures) {
+  constexpr int kNumFeatures = 300;
+  constexpr int kNumExamples = 3;
+  for (DataType dtype : {DT_FLOAT, DT_INT64}) {
+    // Value counts around the 16-byte blocks of the packed varint decoder.
+    for (int num_values : {1, 15, 17, 40}) {
+      std::vector<tstring> serialized;
+      for (int e = 0; e < kNumExamples; ++e) {
+        serialized.push_back(
+            ExampleWithDenseFeatures(dtype, kNumFeatures, num_values, e));
+      }
+      FastParseExampleConfig config =
+          DenseFeaturesConfig(dtype, kNumFeatures, num_values);
+      Result result;
+      TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+      ASSERT_EQ(result.dense_values.size(), kNumFeatures);
+
+      for (int e = 0; e < kNumExamples; ++e) {
+        Example expected;
+        ASSERT_TRUE(expected.ParseFromString(serialized[e]));
+        const auto& feature_map = expected.features().feature();
+        for (int f = 0; f < kNumFeatures; ++f) {
+          const Feature& feature = feature_map.at(strings::StrCat("f", f));
+          const Tensor& values = result.dense_values[f];
+          for (int v = 0; v < num_values; ++v) {
+            if (dtype == DT_FLOAT) {
+              EXPECT_EQ(values.matrix<float>()(e, v),
+                        feature.float_list().value(v));
+            } else {
+              EXPECT_EQ(values.matrix<int64_t>()(e, v),
+                        feature.int64_list().value(v));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(FastParseExample, FixedLengthDenseFeatureWrongSize) {
+  for (DataType dtype : {DT_FLOAT, DT_INT64}) {
+    std::vector<tstring> serialized = {
+        ExampleWithDenseFeatures(dtype, /*num_features=*/1, /*num_values=*/2,
+                                 /*seed=*/0)};
+    FastParseExampleConfig config =
+        DenseFeaturesConfig(dtype, /*num_features=*/1, /*num_values=*/3);
+    Result result;
+    Status status = FastParseExample(config, serialized, {}, nullptr, &result);
+    EXPECT_TRUE(errors::IsInvalidArgument(status)) << status;
+    EXPECT_TRUE(absl::StrContains(status.message(), "Values size: 2"))
+        << status;
+  }
+}
+
+TEST(FastParseExample, FixedLengthDenseInt64NonPacked) {
+  // Int64List with two non-packed values, 1 and 300.
+  const char kInt64List[] = "\x1a\x05\x08\x01\x08\xac\x02";
+  Example example;
+  ASSERT_TRUE((*example.mutable_features()->mutable_feature())["f0"]
+                  .ParseFromString(string(kInt64List, sizeof(kInt64List) - 1)));
+  std::vector<tstring> serialized = {Serialize(example)};
+  FastParseExampleConfig config = DenseFeaturesConfig(DT_INT64, 1, 2);
+  Result result;
+  TF_ASSERT_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  EXPECT_EQ(result.dense_values[0].matrix<int64_t>()(0, 0), 1);
+  EXPECT_EQ(result.dense_values[0].matrix<int64_t>()(0, 1), 300);
+}
+
+TEST(FastParseExample, DuplicateFeatureNames) {
+  FastParseExampleConfig config = DenseFeaturesConfig(DT_INT64, 1, 1);
+  AddSparseFeature("f0", DT_INT64, &config);
+  std::vector<tstring> serialized = {
+      ExampleWithDenseFeatures(DT_INT64, 1, 1, 0)};
+  Result result;
+  EXPECT_TRUE(errors::IsInternal(
+      FastParseExample(config, serialized, {}, nullptr, &result)));
+}
+
+// Example with sparse ("s_"), ragged ("r_") and variable-length dense ("v_")
+// features of every dtype. Every 16th example holds `num_large_values` values
+// per feature and the others at most three, so that minibatches differ widely
+// in parsing and merging cost.
+string ExampleWithSkewedFeatures(int64_t index, int num_large_values) {
+  const int num_values = index % 16 == 0 ? num_large_values : index % 4;
+  Example example;
+  auto& feature_map = *example.mutable_features()->mutable_feature();
+  for (const char* prefix : {"s_", "r_", "v_"}) {
+    Feature& bytes_feature = feature_map[strings::StrCat(prefix, "bytes")];
+    Feature& float_feature = feature_map[strings::StrCat(prefix, "float")];
+    Feature& int64_feature = feature_map[strings::StrCat(prefix, "int64")];
+    for (int v = 0; v < num_values; ++v) {
+      bytes_feature.mutable_bytes_list()->add_value(
+          strings::StrCat(index, ":", v));
+      float_feature.mutable_float_list()->add_value(index + v * 0.25f);
+      int64_feature.mutable_int64_list()->add_value(index * 1000 + v);
+    }
+  }
+  return Serialize(example);
+}
+
+FastParseExampleConfig SkewedFeaturesConfig() {
+  FastParseExampleConfig config;
+  for (const auto& [name, dtype] :
+       std::vector<std::pair<string, DataType>>{
+           {"bytes", DT_STRING}, {"float", DT_FLOAT}, {"int64", DT_INT64}}) {
+    config.sparse.emplace_back(strings::StrCat("s_", name), dtype);
+    config.ragged.emplace_back(strings::StrCat("r_", name), dtype,
+                               dtype == DT_INT64 ? DT_INT32 : DT_INT64);
+    config.dense.emplace_back();
+    auto& dense = config.dense.back();
+    dense.feature_name = strings::StrCat("v_", name);
+    dense.dtype = dtype;
+    dense.shape = PartialTensorShape({-1});
+    dense.default_value = Tensor(dtype, {});
+    if (dtype == DT_FLOAT) {
+      dense.default_value.scalar<float>()() = -1.0f;
+    } else if (dtype == DT_INT64) {
+      dense.default_value.scalar<int64_t>()() = -1;
+    }
+    dense.variable_length = true;
+    dense.elements_per_stride = 1;
+  }
+  return config;
+}
+
+TEST(FastParseExample, ThreadPoolMatchesSingleThreaded) {
+  thread::ThreadPool thread_pool(Env::Default(), "fast_parse_example", 7);
+  const FastParseExampleConfig config = SkewedFeaturesConfig();
+  // Batches below and above the size from which the merge runs in parallel.
+  for (int num_examples : {0, 1, 5, 37, 300}) {
+    std::vector<tstring> serialized;
+    for (int e = 0; e < num_examples; ++e) {
+      serialized.push_back(
+          ExampleWithSkewedFeatures(e, /*num_large_values=*/300));
+    }
+    Result expected;
+    TF_ASSERT_OK(
+        FastParseExample(config, serialized, {}, nullptr, &expected));
+    Result result;
+    TF_ASSERT_OK(
+        FastParseExample(config, serialized, {}, &thread_pool, &result));
+
+    ASSERT_EQ(result.sparse_indices.size(), config.sparse.size());
+    ASSERT_EQ(result.dense_values.size(), config.dense.size());
+    ASSERT_EQ(result.ragged_values.size(), config.ragged.size());
+    for (size_t d = 0; d < config.sparse.size(); ++d) {
+      test::ExpectTensorEqual<int64_t>(result.sparse_indices[d],
+                                       expected.sparse_indices[d]);
+      test::ExpectEqual(result.sparse_values[d], expected.sparse_values[d]);
+      test::ExpectTensorEqual<int64_t>(result.sparse_shapes[d],
+                                       expected.sparse_shapes[d]);
+    }
+    for (size_t d = 0; d < config.dense.size(); ++d) {
+      test::ExpectEqual(result.dense_values[d], expected.dense_values[d]);
+    }
+    for (size_t d = 0; d < config.ragged.size(); ++d) {
+      test::ExpectEqual(result.ragged_values[d], expected.ragged_values[d]);
+      test::ExpectEqual(result.ragged_splits[d], expected.ragged_splits[d]);
+    }
+  }
+}
+
+TEST(FastParseExample, SkewedFeaturesMergeInExampleOrder) {
+  constexpr int kNumExamples = 40;
+  std::vector<tstring> serialized;
+  for (int e = 0; e < kNumExamples; ++e) {
+    serialized.push_back(ExampleWithSkewedFeatures(e, /*num_large_values=*/5));
+  }
+  const FastParseExampleConfig config = SkewedFeaturesConfig();
+  thread::ThreadPool thread_pool(Env::Default(), "fast_parse_example", 3);
+  Result result;
+  TF_ASSERT_OK(
+      FastParseExample(config, serialized, {}, &thread_pool, &result));
+
+  // config.*[2] are the int64 features.
+  const auto indices = result.sparse_indices[2].matrix<int64_t>();
+  const auto sparse_values = result.sparse_values[2].vec<int64_t>();
+  const auto dense_values = result.dense_values[2].matrix<int64_t>();
+  const auto ragged_values = result.ragged_values[2].vec<int64_t>();
+  const auto row_splits = result.ragged_splits[2].vec<int32>();
+  EXPECT_EQ(result.sparse_shapes[2].vec<int64_t>()(1), 5);
+  ASSERT_EQ(dense_values.dimension(1), 5);
+  ASSERT_EQ(row_splits(0), 0);
+  int64_t offset = 0;
+  for (int e = 0; e < kNumExamples; ++e) {
+    const int num_values = e % 16 == 0 ? 5 : e % 4;
+    ASSERT_EQ(row_splits(e + 1), offset + num_values);
+    for (int v = 0; v < 5; ++v) {
+      const int64_t expected_value = v < num_values ? e * 1000 + v : -1;
+      EXPECT_EQ(dense_values(e, v), expected_value);
+      if (v >= num_values) continue;
+      EXPECT_EQ(indices(offset + v, 0), e);
+      EXPECT_EQ(indices(offset + v, 1), v);
+      EXPECT_EQ(sparse_values(offset + v), expected_value);
+      EXPECT_EQ(ragged_values(offset + v), expected_value);
+    }
+    offset += num_values;
+  }
+  EXPECT_EQ(sparse_values.size(), offset);
+}
+
+// Parses a batch of 128 examples, each with `num_features` fixed-length dense
+// features of `num_values` values, and reports features parsed per second.
+template <DataType dtype>
+void BM_FastParseFixedLengthDense(::testing::benchmark::State& state) {
+  const int num_features = state.range(0);
+  const int num_values = state.range(1);
+  constexpr int kBatchSize = 128;
+  std::vector<tstring> serialized;
+  size_t num_bytes = 0;
+  for (int e = 0; e < kBatchSize; ++e) {
+    serialized.push_back(
+        ExampleWithDenseFeatures(dtype, num_features, num_values, e));
+    num_bytes += serialized.back().size();
+  }
+  FastParseExampleConfig config =
+      DenseFeaturesConfig(dtype, num_features, num_values);
+
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, nullptr, &result));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          kBatchSize * num_features);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK_TEMPLATE(BM_FastParseFixedLengthDense, DT_FLOAT)
+    ->ArgPair(100, 1)
+    ->ArgPair(100, 16)
+    ->ArgPair(500, 1)
+    ->ArgPair(500, 16);
+BENCHMARK_TEMPLATE(BM_FastParseFixedLengthDense, DT_INT64)
+    ->ArgPair(100, 1)
+    ->ArgPair(100, 16)
+    ->ArgPair(500, 1)
+    ->ArgPair(500, 16);
+
+// Parses a batch of `batch_size` examples of skewed sizes (see
+// ExampleWithSkewedFeatures) with a pool of `num_threads` threads, or on the
+// calling thread if `num_threads` is 0.
+void BM_FastParseSkewedBatch(::testing::benchmark::State& state) {
+  const int batch_size = state.range(0);
+  const int num_threads = state.range(1);
+  std::vector<tstring> serialized;
+  size_t num_bytes = 0;
+  for (int e = 0; e < batch_size; ++e) {
+    serialized.push_back(
+        ExampleWithSkewedFeatures(e, /*num_large_values=*/1000));
+    num_bytes += serialized.back().size();
+  }
+  const FastParseExampleConfig config = SkewedFeaturesConfig();
+  std::unique_ptr<thread::ThreadPool> thread_pool;
+  if (num_threads > 0) {
+    thread_pool = std::make_unique<thread::ThreadPool>(
+        Env::Default(), "fast_parse_example", num_threads);
+  }
+
+  for (auto s : state) {
+    Result result;
+    TF_CHECK_OK(FastParseExample(config, serialized, {}, thread_pool.get(),
+                                 &result));
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                          batch_size);
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          num_bytes);
+}
+
+BENCHMARK(BM_FastParseSkewedBatch)
+    ->ArgPair(1024, 0)
+    ->ArgPair(1024, 4)
+    ->ArgPair(1024, 16)
+    ->ArgPair(1024, 64)
+    ->ArgPair(8192, 16)
+    ->ArgPair(8192, 64);
+
 }  // namespace
 }  // namespace example
 }  // namespace tensorflow
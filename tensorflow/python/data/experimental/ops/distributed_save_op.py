@@ -31,6 +31,7 @@ def distributed_save(
     path: str,
     data_service_address: str,
     compression: str = "AUTO",
+    incremental: bool = False,
 ) -> Optional[ops.OperationType]:
   """Initiates the process of saving a dataset to disk using tf.data service.
 
@@ -78,8 +79,15 @@ def distributed_save(
     data_service_address: tf.data service dispatcher address.
     compression: (Optional.) Whether and how to compress the `dataset` snapshot.
       If `"AUTO"`, the tf.data runtime decides which algorithm to use. If
-      `"GZIP"` or `"SNAPPY"`, that specific algorithm is used.  If `None`, the
-      `dataset` snapshot is not compressed.
+      `"GZIP"`, `"SNAPPY"` or `"ZSTD"`, that specific algorithm is used.  If
+      `None`, the `dataset` snapshot is not compressed.
+    incremental: (Optional.) If `True` and a finished snapshot already exists
+      at `path`, appends a new version to it instead of failing. The new
+      version only processes splits that the existing snapshot has not
+      materialized, e.g. the new files of a dataset whose input files are a
+      superset of the existing snapshot's. Readers see the snapshot as of its
+      latest committed version. `dataset` must have the same element spec and
+      `compression` as the existing snapshot.
 
   Returns:
     An operation which when executed performs the distributed save.
@@ -87,7 +95,7 @@ def distributed_save(
   Raises:
     ValueError: If `dispatcher_address` is invalid.
     tf.errors.AlreadyExistsError: If the snapshot has already started or has
-      finished.
+      finished, and `incremental` is `False`.
     tf.errors.FailedPreconditionError: If the file system does not support
       atomic move (rename).
     tf.errors.InvalidArgumentError: If tf.data service is not running in the
@@ -102,7 +110,8 @@ def distributed_save(
   metadata = snapshot_pb2.DistributedSnapshotMetadata(
       element_spec=nested_structure_coder.encode_structure(
           dataset.element_spec).SerializeToString(),
-      compression=compression)
+      compression=compression,
+      incremental=incremental)
 
   return gen_experimental_dataset_ops.distributed_save(
       dataset._variant_tensor,  # pylint: disable=protected-access
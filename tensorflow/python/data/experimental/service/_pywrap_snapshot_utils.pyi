@@ -16,4 +16,5 @@
 def TF_DATA_CommittedChunksDirectory(arg0: str) -> str: ...
 def TF_DATA_SnapshotDoneFilePath(arg0: str) -> str: ...
 def TF_DATA_SnapshotErrorFilePath(arg0: str) -> str: ...
+def TF_DATA_SnapshotManifestFilePath(arg0: str) -> str: ...
 def TF_DATA_SnapshotMetadataFilePath(arg0: str) -> str: ...
@@ -32,6 +32,10 @@ PYBIND11_MODULE(_pywrap_snapshot_utils, m) {
         [](const std::string& snapshot_path) -> std::string {
           return tensorflow::data::SnapshotMetadataFilePath(snapshot_path);
         });
+  m.def("TF_DATA_SnapshotManifestFilePath",
+        [](const std::string& snapshot_path) -> std::string {
+          return tensorflow::data::SnapshotManifestFilePath(snapshot_path);
+        });
   m.def("TF_DATA_CommittedChunksDirectory",
         [](const std::string& snapshot_path) -> std::string {
           return tensorflow::data::CommittedChunksDirectory(snapshot_path);
@@ -28,6 +28,7 @@ from tensorflow.python.data.ops import options as options_lib
 from tensorflow.python.data.ops import readers
 from tensorflow.python.framework import combinations
 from tensorflow.python.framework import constant_op
+from tensorflow.python.lib.io import python_io
 from tensorflow.python.platform import test
 
 
@@ -179,6 +180,28 @@ class TFRecordDatasetTest(tf_record_test_base.TFRecordTestBase,
     self.assertDatasetProduces(
         ds, expected_output=expected_output, assert_items_equal=True)
 
+  @combinations.generate(test_base.eager_only_combinations())
+  def testMemmapBatchesOutliveIterator(self):
+    # Records are too long to be stored inline in a `tstring`, so a record
+    # that aliased the mapping would dangle once the file is unmapped.
+    records = [(b"%d" % i) * 100 for i in range(10)]
+    filename = os.path.join(self.get_temp_dir(), "memmap.tfrecord")
+    writer = python_io.TFRecordWriter(filename)
+    for record in records:
+      writer.write(record)
+    writer.close()
+
+    with test.mock.patch.dict(
+        os.environ, {"TF_DATA_EXPERIMENT_OPT_IN": "tf_record_memmap"}):
+      dataset = readers.TFRecordDataset(filename).batch(4)
+      # Keeps the batches as tensors, which are only read once the iterator
+      # and its mapping of the file are gone.
+      batches = list(dataset)
+    os.remove(filename)
+
+    self.assertLen(batches, 3)
+    self.assertEqual([r for batch in batches for r in batch.numpy()], records)
+
   @combinations.generate(test_base.default_test_combinations())
   def testName(self):
     files = [self._filenames[0]]
@@ -1486,7 +1486,9 @@ class DatasetV2(
       buffer_size: An int or `tf.int64` scalar `tf.Tensor`, representing the
         number of elements from this dataset from which the new dataset will
         sample. To uniformly shuffle the entire dataset, use
-        `buffer_size=dataset.cardinality()`.
+        `buffer_size=dataset.cardinality()`. If `tf.data.AUTOTUNE` is used,
+        the buffer size starts at 1024 and grows with the RAM left over when
+        the `RAM_CONSTRAINED` autotuning algorithm is selected.
       seed: (Optional.) An int or `tf.int64` scalar `tf.Tensor`, representing
         the random seed that will be used to create the distribution. See
         `tf.random.set_seed` for behavior.
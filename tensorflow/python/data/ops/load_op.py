@@ -122,6 +122,30 @@ def _load_distributed_snapshot_metadata(
     return None
 
 
+def _has_committed_version(path: str) -> bool:
+  """Returns true if the incremental snapshot at `path` has a committed version.
+
+  Readers of an incremental snapshot only see committed versions, so a failure
+  of a later version does not affect them.
+
+  Args:
+    path: Base path of the snapshot.
+  """
+  manifest_file = _pywrap_snapshot_utils.TF_DATA_SnapshotManifestFilePath(path)
+  if not gfile.Exists(manifest_file):
+    return False
+  try:
+    with gfile.GFile(manifest_file, "r") as f:
+      manifest = text_format.ParseLines(
+          f, snapshot_pb2.DistributedSnapshotManifest())
+  except (
+      errors.NotFoundError,
+      text_format.ParseError,
+      UnicodeDecodeError):
+    return False
+  return any(version.committed for version in manifest.versions)
+
+
 def _load_distributed_snapshot(
     path: str,
     metadata: snapshot_pb2.DistributedSnapshotMetadata,
@@ -259,7 +283,7 @@ def _validate_snapshot(
   """
 
   error_file = _pywrap_snapshot_utils.TF_DATA_SnapshotErrorFilePath(path)
-  if gfile.Exists(error_file):
+  if gfile.Exists(error_file) and not _has_committed_version(path):
     with gfile.GFile(error_file, "r") as f:
       raise ValueError(
           f"Failed to load tf.data snapshot at {path}. The save job failed to "
@@ -45,12 +45,18 @@ class AutotuneAlgorithm(enum.Enum):
 
   STAGE_BASED: In each optimization step, this algorithm chooses the worst
   bottleneck parameter and increases its value by 1.
+
+  RAM_CONSTRAINED: Jointly tunes parallelism and buffer sizes, maximizing
+  throughput while keeping the total buffered memory within the RAM budget.
+  The RAM left over grows the buffers of `shuffle(buffer_size=AUTOTUNE)`
+  beyond their initial size.
   """
   DEFAULT = 0
   HILL_CLIMB = 1
   GRADIENT_DESCENT = 2
   MAX_PARALLELISM = 3
   STAGE_BASED = 4
+  RAM_CONSTRAINED = 5
 
   @classmethod
   def _to_proto(cls, obj):
@@ -64,9 +70,12 @@ class AutotuneAlgorithm(enum.Enum):
       return model_pb2.AutotuneAlgorithm.MAX_PARALLELISM
     if obj == cls.STAGE_BASED:
       return model_pb2.AutotuneAlgorithm.STAGE_BASED
+    if obj == cls.RAM_CONSTRAINED:
+      return model_pb2.AutotuneAlgorithm.RAM_CONSTRAINED
     raise ValueError(
         f"Invalid `obj.` Supported values include `DEFAULT`, `HILL_CLIMB` "
-        f"`GRADIENT_DESCENT`, and `STAGE_BASED`. Got {obj.name}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `RAM_CONSTRAINED`. "
+        f"Got {obj.name}.")
 
   @classmethod
   def _from_proto(cls, pb):
@@ -80,9 +89,11 @@ class AutotuneAlgorithm(enum.Enum):
       return cls.MAX_PARALLELISM
     if pb == model_pb2.AutotuneAlgorithm.STAGE_BASED:
       return cls.STAGE_BASED
+    if pb == model_pb2.AutotuneAlgorithm.RAM_CONSTRAINED:
+      return cls.RAM_CONSTRAINED
     raise ValueError(
         f"Invalid `pb.` Supported values include `DEFAULT`, `HILL_CLIMB`, "
-        f"`GRADIENT_DESCENT` and `STAGE_BASED`. Got {pb}.")
+        f"`GRADIENT_DESCENT`, `STAGE_BASED` and `RAM_CONSTRAINED`. Got {pb}.")
 
 
 @tf_export("data.experimental.AutoShardPolicy")
@@ -505,12 +516,24 @@ class ThreadingOptions(options_lib.OptionsBase):
       "The value 0 can be used to indicate that the threadpool size should be "
       "determined at runtime based on the number of available CPU cores.")
 
+  numa_aware = options_lib.create_option(
+      name="numa_aware",
+      ty=bool,
+      docstring=
+      "If true, the threads of the dataset are pinned to NUMA nodes. If the "
+      "process also uses per-node CPU allocators, the elements they produce "
+      "are allocated on the NUMA node of the producing thread. This reduces "
+      "cross-socket memory traffic on multi-socket hosts and has no effect on "
+      "hosts with a single NUMA node. If None, defaults to False.")
+
   def _to_proto(self):
     pb = dataset_options_pb2.ThreadingOptions()
     if self.max_intra_op_parallelism is not None:
       pb.max_intra_op_parallelism = self.max_intra_op_parallelism
     if self.private_threadpool_size is not None:
       pb.private_threadpool_size = self.private_threadpool_size
+    if self.numa_aware is not None:
+      pb.numa_aware = self.numa_aware
     return pb
 
   def _from_proto(self, pb):
@@ -518,6 +541,8 @@ class ThreadingOptions(options_lib.OptionsBase):
       self.max_intra_op_parallelism = pb.max_intra_op_parallelism
     if pb.WhichOneof("optional_private_threadpool_size") is not None:
       self.private_threadpool_size = pb.private_threadpool_size
+    if pb.WhichOneof("optional_numa_aware") is not None:
+      self.numa_aware = pb.numa_aware
 
 
 @tf_export("data.Options")
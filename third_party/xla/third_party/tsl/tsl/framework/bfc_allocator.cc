@@ -16,10 +16,14 @@ limitations under the License.
 #include "tsl/framework/bfc_allocator.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "tsl/framework/allocator_retry.h"
 #include "tsl/lib/core/bits.h"
@@ -39,6 +43,51 @@ namespace tsl {
 
 constexpr BFCAllocator::ChunkHandle BFCAllocator::kInvalidChunkHandle;
 
+namespace {
+// Source of `BFCAllocator::thread_cache_id_`.
+std::atomic<int64_t> next_thread_cache_id{0};
+}  // namespace
+
+// Small chunks freed by one thread, by size class. Class `c` holds chunks of
+// exactly `(c + 1) * kMinAllocationSize` bytes. `mu` is only contended by
+// `GetStats`, memory dumps, and a thread adopting the cache of an exited
+// thread.
+struct BFCAllocator::ThreadCache {
+  mutex mu;
+  std::array<std::vector<void*>, kNumThreadCacheSizeClasses> free_chunks
+      TF_GUARDED_BY(mu);
+  // Total size of the chunks in `free_chunks`.
+  size_t cached_bytes TF_GUARDED_BY(mu) = 0;
+  // Number of allocations served from `free_chunks` and not yet added to
+  // `stats_`.
+  int64_t num_allocs TF_GUARDED_BY(mu) = 0;
+  // True if the thread that owned this cache has exited. The next thread to
+  // create a cache adopts it, along with its chunks.
+  bool orphaned TF_GUARDED_BY(mu) = false;
+};
+
+// The calling thread's caches, keyed by `BFCAllocator::thread_cache_id_`. On
+// thread exit, the caches are orphaned rather than returned to the
+// allocators, which may already be destroyed.
+struct BFCAllocator::ThreadLocalCaches {
+  ~ThreadLocalCaches() {
+    for (auto& [id, cache] : caches) {
+      mutex_lock l(cache->mu);
+      cache->orphaned = true;
+    }
+  }
+
+  absl::flat_hash_map<int64_t, std::shared_ptr<ThreadCache>> caches;
+  // The most recently used cache, to skip the map lookup.
+  int64_t last_id = -1;
+  ThreadCache* last_cache = nullptr;
+};
+
+struct BFCAllocator::CachableChunkShard {
+  mutex mu;
+  absl::flat_hash_map<const void*, size_t> chunk_sizes TF_GUARDED_BY(mu);
+};
+
 BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
                            size_t total_memory, const string& name,
                            const Options& opts)
@@ -47,7 +96,12 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
       sub_allocator_(std::move(sub_allocator)),
       name_(name),
       free_chunks_list_(kInvalidChunkHandle),
-      next_allocation_id_(1) {
+      next_allocation_id_(1),
+      thread_cache_id_(next_thread_cache_id.fetch_add(1)) {
+  if (opts.thread_cache_max_bytes > 0) {
+    cachable_chunk_shards_ =
+        std::make_unique<CachableChunkShard[]>(kNumCachableChunkShards);
+  }
   if (opts.allow_growth) {
     // 2MiB smallest initial allocation, unless total memory available
     // is less.
@@ -87,6 +141,10 @@ BFCAllocator::BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator,
 }
 
 BFCAllocator::~BFCAllocator() {
+  {
+    mutex_lock l(lock_);
+    DrainThreadCaches();
+  }
   // Return memory back.
   VLOG(2) << "Number of regions allocated: "
           << region_manager_.regions().size();
@@ -259,6 +317,15 @@ void* BFCAllocator::AllocateRawInternalWithRetry(
 void* BFCAllocator::AllocateRaw(size_t unused_alignment, size_t num_bytes,
                                 const AllocationAttributes& allocation_attr) {
   VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes;
+  if (opts_.thread_cache_max_bytes > 0 &&
+      allocation_attr.freed_by_func == nullptr) {
+    void* result = AllocateFromThreadCache(num_bytes);
+    if (result != nullptr) {
+      VLOG(3) << "AllocateRaw " << Name() << "  " << num_bytes << " "
+              << result << " (thread cache)";
+      return result;
+    }
+  }
   void* result = [&] {
     if (!opts_.allow_retry_on_failure || !allocation_attr.retry_on_failure) {
       // If we have globally disabled retry-on-failure and fail to allocate an
@@ -461,6 +528,15 @@ void* BFCAllocator::AllocateRawInternal(size_t unused_alignment,
     }
   }
 
+  // Chunks held in thread caches may be merged into a large enough chunk.
+  if (DrainThreadCaches()) {
+    ptr = FindChunkPtr(bin_num, rounded_bytes, num_bytes, freed_before);
+    if (ptr != nullptr) {
+      AddTraceMe("MemoryAllocation", ptr);
+      return ptr;
+    }
+  }
+
   // Reaching this point means that no chunks can satisfy the request. Also,
   // the unallocated bytes cannot satisfy the request. Before giving up, let's
   // try deallocating free regions so that suballocator can combine them with
@@ -628,6 +704,11 @@ void* BFCAllocator::FindChunkPtr(BinNum bin_num, size_t rounded_bytes,
         }
 #endif
 
+        if (opts_.thread_cache_max_bytes > 0 && timing_counter_ == nullptr &&
+            chunk->size <= kThreadCacheMaxChunkSize) {
+          RegisterCachableChunk(chunk->ptr, chunk->size);
+        }
+
         VLOG(4) << "Returning: " << chunk->ptr;
         if (VLOG_IS_ON(4)) {
           LOG(INFO) << "A: " << RenderOccupancy();
@@ -684,6 +765,10 @@ void BFCAllocator::DeallocateRaw(void* ptr) {
   VLOG(4) << "[mem-debug] DeallocateRaw," << Name() << ","
           << (ptr ? RequestedSize(ptr) : 0) << "," << ptr << ","
           << tsl::CurrentStackTrace();
+  if (opts_.thread_cache_max_bytes > 0 && ptr != nullptr &&
+      DeallocateToThreadCache(ptr)) {
+    return;
+  }
   DeallocateRawInternal(ptr);
   retry_helper_.NotifyDealloc();
 }
@@ -694,7 +779,10 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
     return;
   }
   mutex_lock l(lock_);
+  DeallocateRawLocked(ptr);
+}
 
+void BFCAllocator::DeallocateRawLocked(void* ptr) {
   // Find the chunk from the ptr.
   BFCAllocator::ChunkHandle h = region_manager_.get_handle(ptr);
   CHECK(h != kInvalidChunkHandle);
@@ -723,6 +811,172 @@ void BFCAllocator::DeallocateRawInternal(void* ptr) {
   }
 }
 
+BFCAllocator::ThreadCache* BFCAllocator::GetThreadCache() {
+  thread_local ThreadLocalCaches local_caches;
+  if (local_caches.last_id == thread_cache_id_) {
+    return local_caches.last_cache;
+  }
+  std::shared_ptr<ThreadCache>& cache = local_caches.caches[thread_cache_id_];
+  if (cache == nullptr) {
+    mutex_lock l(thread_caches_mu_);
+    for (const std::shared_ptr<ThreadCache>& other : thread_caches_) {
+      mutex_lock tl(other->mu);
+      if (other->orphaned) {
+        other->orphaned = false;
+        cache = other;
+        break;
+      }
+    }
+    if (cache == nullptr) {
+      cache = std::make_shared<ThreadCache>();
+      thread_caches_.push_back(cache);
+    }
+  }
+  local_caches.last_id = thread_cache_id_;
+  local_caches.last_cache = cache.get();
+  return cache.get();
+}
+
+void* BFCAllocator::AllocateFromThreadCache(size_t num_bytes) {
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  if (num_bytes == 0 || rounded_bytes > kThreadCacheMaxChunkSize) {
+    return nullptr;
+  }
+  ThreadCache* cache = GetThreadCache();
+  mutex_lock l(cache->mu);
+  std::vector<void*>& free_chunks =
+      cache->free_chunks[rounded_bytes / kMinAllocationSize - 1];
+  if (free_chunks.empty()) {
+    return nullptr;
+  }
+  void* ptr = free_chunks.back();
+  free_chunks.pop_back();
+  cache->cached_bytes -= rounded_bytes;
+  ++cache->num_allocs;
+  return ptr;
+}
+
+bool BFCAllocator::DeallocateToThreadCache(void* ptr) {
+  const size_t chunk_size = LookupCachableChunk(ptr);
+  if (chunk_size == 0) {
+    return false;
+  }
+  ThreadCache* cache = GetThreadCache();
+  std::vector<void*> evicted;
+  {
+    mutex_lock l(cache->mu);
+    cache->free_chunks[chunk_size / kMinAllocationSize - 1].push_back(ptr);
+    cache->cached_bytes += chunk_size;
+    if (cache->cached_bytes > opts_.thread_cache_max_bytes) {
+      // Evicts the oldest chunks, largest first, down to half of the limit, so
+      // that the following frees do not take the lock again.
+      const size_t target_bytes = opts_.thread_cache_max_bytes / 2;
+      for (size_t c = kNumThreadCacheSizeClasses;
+           c-- > 0 && cache->cached_bytes > target_bytes;) {
+        std::vector<void*>& free_chunks = cache->free_chunks[c];
+        const size_t class_chunk_size = (c + 1) * kMinAllocationSize;
+        size_t num_evicted = 0;
+        while (num_evicted < free_chunks.size() &&
+               cache->cached_bytes > target_bytes) {
+          evicted.push_back(free_chunks[num_evicted++]);
+          cache->cached_bytes -= class_chunk_size;
+        }
+        free_chunks.erase(free_chunks.begin(),
+                          free_chunks.begin() + num_evicted);
+      }
+    }
+  }
+  if (!evicted.empty()) {
+    ReturnThreadCachedChunks(evicted);
+  }
+  return true;
+}
+
+void BFCAllocator::ReturnThreadCachedChunks(const std::vector<void*>& ptrs) {
+  // Unregisters the chunks first: once in the bins, they may be allocated and
+  // registered again by another thread.
+  for (void* ptr : ptrs) {
+    UnregisterCachableChunk(ptr);
+  }
+  {
+    mutex_lock l(lock_);
+    for (void* ptr : ptrs) {
+      DeallocateRawLocked(ptr);
+    }
+  }
+  retry_helper_.NotifyDealloc();
+}
+
+bool BFCAllocator::DrainThreadCaches() {
+  if (opts_.thread_cache_max_bytes == 0) {
+    return false;
+  }
+  std::vector<void*> ptrs;
+  {
+    mutex_lock l(thread_caches_mu_);
+    for (const std::shared_ptr<ThreadCache>& cache : thread_caches_) {
+      mutex_lock tl(cache->mu);
+      for (std::vector<void*>& free_chunks : cache->free_chunks) {
+        ptrs.insert(ptrs.end(), free_chunks.begin(), free_chunks.end());
+        free_chunks.clear();
+      }
+      cache->cached_bytes = 0;
+      stats_.num_allocs += cache->num_allocs;
+      cache->num_allocs = 0;
+    }
+  }
+  for (void* ptr : ptrs) {
+    UnregisterCachableChunk(ptr);
+    DeallocateRawLocked(ptr);
+  }
+  if (ptrs.empty()) {
+    return false;
+  }
+  VLOG(2) << "Returned " << ptrs.size() << " thread-cached chunks to "
+          << Name();
+  return true;
+}
+
+void BFCAllocator::AddThreadCacheStats(AllocatorStats& stats) {
+  if (opts_.thread_cache_max_bytes == 0) {
+    return;
+  }
+  mutex_lock l(thread_caches_mu_);
+  for (const std::shared_ptr<ThreadCache>& cache : thread_caches_) {
+    mutex_lock tl(cache->mu);
+    stats.bytes_in_use -= cache->cached_bytes;
+    stats.num_allocs += cache->num_allocs;
+  }
+}
+
+BFCAllocator::CachableChunkShard& BFCAllocator::ShardForChunk(
+    const void* ptr) {
+  // Chunks are aligned to kMinAllocationSize, so adjacent chunks land in
+  // different shards.
+  const uintptr_t index =
+      reinterpret_cast<uintptr_t>(ptr) >> kMinAllocationBits;
+  return cachable_chunk_shards_[index % kNumCachableChunkShards];
+}
+
+void BFCAllocator::RegisterCachableChunk(const void* ptr, size_t size) {
+  CachableChunkShard& shard = ShardForChunk(ptr);
+  mutex_lock l(shard.mu);
+  shard.chunk_sizes[ptr] = size;
+}
+
+void BFCAllocator::UnregisterCachableChunk(const void* ptr) {
+  CachableChunkShard& shard = ShardForChunk(ptr);
+  mutex_lock l(shard.mu);
+  shard.chunk_sizes.erase(ptr);
+}
+
+size_t BFCAllocator::LookupCachableChunk(const void* ptr) {
+  CachableChunkShard& shard = ShardForChunk(ptr);
+  mutex_lock l(shard.mu);
+  auto it = shard.chunk_sizes.find(ptr);
+  return it == shard.chunk_sizes.end() ? 0 : it->second;
+}
+
 // Merges h1 and h2 when Chunk(h1)->next is h2 and Chunk(h2)->prev is c1.
 // We merge Chunk(h2) into Chunk(h1).
 void BFCAllocator::Merge(BFCAllocator::ChunkHandle h1,
@@ -1136,6 +1390,8 @@ void BFCAllocator::MaybeWriteMemoryMap() {
 
 MemoryDump BFCAllocator::RecordMemoryMap() {
   mutex_lock l(lock_);
+  // Cached chunks would otherwise show up as in use.
+  DrainThreadCaches();
   return RecordMemoryMapInternal();
 }
 
@@ -1207,11 +1463,20 @@ MemoryDump BFCAllocator::RecordMemoryMapInternal() {
 
 absl::optional<AllocatorStats> BFCAllocator::GetStats() {
   mutex_lock l(lock_);
-  return stats_;
+  AllocatorStats stats = stats_;
+  AddThreadCacheStats(stats);
+  return stats;
 }
 
 bool BFCAllocator::ClearStats() {
   mutex_lock l(lock_);
+  if (opts_.thread_cache_max_bytes > 0) {
+    mutex_lock cl(thread_caches_mu_);
+    for (const std::shared_ptr<ThreadCache>& cache : thread_caches_) {
+      mutex_lock tl(cache->mu);
+      cache->num_allocs = 0;
+    }
+  }
   stats_.num_allocs = 0;
   stats_.peak_bytes_in_use = stats_.bytes_in_use;
   stats_.largest_alloc_size = 0;
@@ -69,6 +69,21 @@ class BFCAllocator : public Allocator {
     // Controls when a chunk should be split, if its size exceeds the requested
     // allocation size.
     double fragmentation_fraction = 0;
+
+    // If greater than 0, each thread keeps up to this many bytes of recently
+    // freed small chunks, and serves allocations of the same rounded size from
+    // them without taking the allocator lock. When a thread exceeds the limit,
+    // it returns a batch of chunks to the bins under a single lock
+    // acquisition. This reduces lock contention when many threads allocate
+    // small temporaries, at the cost of up to this many bytes held per thread.
+    //
+    // Only suitable for host memory: caching is skipped for allocations with
+    // a `freed_by_func` and when a timing counter is set. Allocations served
+    // from a thread cache keep the requested size and allocation id of the
+    // chunk's previous allocation, and are not reported individually to the
+    // memory profiler. `GetStats` reports cached chunks as free, except in
+    // `peak_bytes_in_use`, which counts them as in use.
+    size_t thread_cache_max_bytes = 0;
   };
   BFCAllocator(std::unique_ptr<SubAllocator> sub_allocator, size_t total_memory,
                const string& name, const Options& opts);
@@ -121,6 +136,60 @@ class BFCAllocator : public Allocator {
 
   void DeallocateRawInternal(void* ptr);
 
+  // Returns the chunk at `ptr` to the free bins.
+  void DeallocateRawLocked(void* ptr) TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Thread caches (see `Options::thread_cache_max_bytes`). A chunk in a thread
+  // cache is still allocated as far as the bins and `stats_` are concerned.
+  // `GetStats` subtracts the cached bytes, and memory dumps return the cached
+  // chunks to the bins first.
+  //
+  // Lock order: `lock_`, then `thread_caches_mu_`, then `ThreadCache::mu`.
+  // `CachableChunkShard::mu` is never held while acquiring another lock.
+  struct ThreadCache;
+  struct ThreadLocalCaches;
+  struct CachableChunkShard;
+
+  // Chunks of at most this size are cached. Each rounded size up to this one
+  // is a size class.
+  static constexpr size_t kThreadCacheMaxChunkSize = 64 << 10;
+  static constexpr size_t kNumThreadCacheSizeClasses =
+      kThreadCacheMaxChunkSize >> 8;
+  static constexpr size_t kNumCachableChunkShards = 64;
+
+  // Returns the calling thread's cache for this allocator, creating it if
+  // needed.
+  ThreadCache* GetThreadCache() TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns a cached chunk of the same rounded size as `num_bytes` from the
+  // calling thread's cache, or nullptr if there is none.
+  void* AllocateFromThreadCache(size_t num_bytes) TF_LOCKS_EXCLUDED(lock_);
+
+  // Puts `ptr` in the calling thread's cache if it is cachable. Returns false
+  // if `ptr` must be freed to the bins instead.
+  bool DeallocateToThreadCache(void* ptr) TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns chunks evicted from a thread cache to the bins.
+  void ReturnThreadCachedChunks(const std::vector<void*>& ptrs)
+      TF_LOCKS_EXCLUDED(lock_);
+
+  // Returns the chunks in all thread caches to the bins. Returns true if any
+  // chunk was returned.
+  bool DrainThreadCaches() TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Removes the thread-cached bytes from `stats`, and adds the allocations
+  // served from thread caches.
+  void AddThreadCacheStats(AllocatorStats& stats)
+      TF_EXCLUSIVE_LOCKS_REQUIRED(lock_);
+
+  // Tracks the sizes of cachable chunks, so that `DeallocateRaw` can cache a
+  // chunk without looking it up under `lock_`. Lookup returns 0 if `ptr` is
+  // not cachable.
+  CachableChunkShard& ShardForChunk(const void* ptr);
+  void RegisterCachableChunk(const void* ptr, size_t size);
+  void UnregisterCachableChunk(const void* ptr);
+  size_t LookupCachableChunk(const void* ptr);
+
   // Chunks whose freed_at_count is later than the safe frontier value are kept
   // on a special list and not subject to merging immediately upon being freed.
   //
@@ -587,6 +656,14 @@ class BFCAllocator : public Allocator {
 
   // Stats.
   AllocatorStats stats_ TF_GUARDED_BY(lock_);
+
+  // Thread caches. `thread_cache_id_` identifies this allocator in the
+  // thread-local cache maps; unlike `this`, it is never reused.
+  const int64_t thread_cache_id_;
+  mutex thread_caches_mu_ TF_ACQUIRED_AFTER(lock_);
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_
+      TF_GUARDED_BY(thread_caches_mu_);
+  std::unique_ptr<CachableChunkShard[]> cachable_chunk_shards_;
 #ifdef TENSORFLOW_MEM_DEBUG
   int64 action_counter_ TF_GUARDED_BY(lock_) = 0;
 #define MEM_DEBUG_SIZE_HISTORY_SIZE 4096
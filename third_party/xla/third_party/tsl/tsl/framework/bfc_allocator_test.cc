@@ -0,0 +1,260 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/framework/bfc_allocator.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "tsl/framework/allocator.h"
+#include "tsl/platform/blocking_counter.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/mem.h"
+#include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
+#include "tsl/platform/threadpool.h"
+#include "tsl/protobuf/bfc_memory_map.pb.h"
+
+namespace tsl {
+namespace {
+
+using tensorflow::MemChunk;
+
+class HostSubAllocator : public SubAllocator {
+ public:
+  HostSubAllocator() : SubAllocator({}, {}) {}
+
+  void* Alloc(size_t alignment, size_t num_bytes,
+              size_t* bytes_received) override {
+    *bytes_received = num_bytes;
+    return port::AlignedMalloc(num_bytes, static_cast<int>(alignment));
+  }
+
+  void Free(void* ptr, size_t num_bytes) override { port::AlignedFree(ptr); }
+
+  bool SupportsCoalescing() const override { return false; }
+
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+};
+
+std::unique_ptr<BFCAllocator> CreateAllocator(size_t total_memory,
+                                              size_t thread_cache_max_bytes) {
+  BFCAllocator::Options opts;
+  opts.allow_growth = false;
+  opts.allow_retry_on_failure = false;
+  opts.thread_cache_max_bytes = thread_cache_max_bytes;
+  return std::make_unique<BFCAllocator>(std::make_unique<HostSubAllocator>(),
+                                        total_memory, "host_bfc", opts);
+}
+
+void CheckStats(Allocator* a, int64_t num_allocs, int64_t bytes_in_use,
+                int64_t peak_bytes_in_use) {
+  std::optional<AllocatorStats> stats = a->GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->num_allocs, num_allocs);
+  EXPECT_EQ(stats->bytes_in_use, bytes_in_use);
+  EXPECT_EQ(stats->peak_bytes_in_use, peak_bytes_in_use);
+}
+
+int64_t NumChunksInUse(const MemoryDump& dump) {
+  return std::count_if(dump.chunk().begin(), dump.chunk().end(),
+                       [](const MemChunk& chunk) { return chunk.in_use(); });
+}
+
+TEST(BFCAllocatorThreadCacheTest, ReusesFreedChunks) {
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(1 << 20, 64 << 10);
+  void* p1 = a->AllocateRaw(1, 1000);
+  CheckStats(a.get(), 1, 1024, 1024);
+  a->DeallocateRaw(p1);
+  CheckStats(a.get(), 1, 0, 1024);
+
+  // Same rounded size: served from the cache.
+  void* p2 = a->AllocateRaw(1, 1024);
+  EXPECT_EQ(p2, p1);
+  CheckStats(a.get(), 2, 1024, 1024);
+
+  // Different rounded size: served from the bins.
+  void* p3 = a->AllocateRaw(1, 2048);
+  EXPECT_NE(p3, p1);
+  CheckStats(a.get(), 3, 3072, 3072);
+
+  a->DeallocateRaw(p2);
+  a->DeallocateRaw(p3);
+  CheckStats(a.get(), 3, 0, 3072);
+}
+
+TEST(BFCAllocatorThreadCacheTest, LargeChunksAreNotCached) {
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(1 << 20, 1 << 20);
+  void* p = a->AllocateRaw(1, 128 << 10);
+  a->DeallocateRaw(p);
+  EXPECT_EQ(NumChunksInUse(a->RecordMemoryMap()), 0);
+  CheckStats(a.get(), 1, 0, 128 << 10);
+}
+
+TEST(BFCAllocatorThreadCacheTest, RecordMemoryMapReturnsCachedChunks) {
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(1 << 20, 64 << 10);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 16; ++i) {
+    ptrs.push_back(a->AllocateRaw(1, 256));
+  }
+  for (int i = 0; i < 8; ++i) {
+    a->DeallocateRaw(ptrs[i]);
+  }
+  EXPECT_EQ(NumChunksInUse(a->RecordMemoryMap()), 8);
+  CheckStats(a.get(), 16, 8 * 256, 16 * 256);
+
+  // The returned chunks are no longer cached, so this comes from the bins.
+  void* p = a->AllocateRaw(1, 256);
+  CheckStats(a.get(), 17, 9 * 256, 16 * 256);
+  a->DeallocateRaw(p);
+  for (int i = 8; i < 16; ++i) {
+    a->DeallocateRaw(ptrs[i]);
+  }
+  CheckStats(a.get(), 17, 0, 16 * 256);
+}
+
+TEST(BFCAllocatorThreadCacheTest, AllocationReturnsCachedChunksWhenFull) {
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(1 << 20, 64 << 10);
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 1024; ++i) {
+    void* p = a->AllocateRaw(1, 1024);
+    ASSERT_NE(p, nullptr);
+    ptrs.push_back(p);
+  }
+  EXPECT_EQ(a->AllocateRaw(1, 1024), nullptr);
+  for (void* p : ptrs) {
+    a->DeallocateRaw(p);
+  }
+
+  // Only fits once the cached chunks are merged back into one region.
+  void* p = a->AllocateRaw(1, 1 << 20);
+  ASSERT_NE(p, nullptr);
+  a->DeallocateRaw(p);
+  CheckStats(a.get(), 1025, 0, 1 << 20);
+}
+
+TEST(BFCAllocatorThreadCacheTest, CacheOfExitedThreadIsAdopted) {
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(1 << 20, 64 << 10);
+  void* freed = nullptr;
+  std::unique_ptr<Thread> thread(
+      Env::Default()->StartThread(ThreadOptions(), "first", [&] {
+        freed = a->AllocateRaw(1, 4096);
+        a->DeallocateRaw(freed);
+      }));
+  thread.reset();
+  CheckStats(a.get(), 1, 0, 4096);
+
+  void* allocated = nullptr;
+  thread.reset(Env::Default()->StartThread(ThreadOptions(), "second", [&] {
+    allocated = a->AllocateRaw(1, 4096);
+    a->DeallocateRaw(allocated);
+  }));
+  thread.reset();
+  EXPECT_EQ(allocated, freed);
+  CheckStats(a.get(), 2, 0, 4096);
+}
+
+TEST(BFCAllocatorThreadCacheTest, ConcurrentAllocationsDoNotOverlap) {
+  constexpr int kNumThreads = 8;
+  constexpr int kNumIterations = 2000;
+  // A small limit, so that chunks are evicted often.
+  std::unique_ptr<BFCAllocator> a = CreateAllocator(64 << 20, 4 << 10);
+  std::atomic<int> num_corrupted(0);
+  {
+    thread::ThreadPool pool(Env::Default(), "test", kNumThreads);
+    for (int t = 0; t < kNumThreads; ++t) {
+      pool.Schedule([&a, &num_corrupted, t] {
+        std::vector<std::pair<char*, size_t>> live;
+        for (int i = 0; i < kNumIterations; ++i) {
+          const size_t bytes = 256 * (1 + (i * 7 + t) % 32);
+          char* p = static_cast<char*>(a->AllocateRaw(1, bytes));
+          std::memset(p, t, bytes);
+          live.emplace_back(p, bytes);
+          if (live.size() > 16 || i % 5 == 0) {
+            auto [q, q_bytes] = live[i % live.size()];
+            if (std::count(q, q + q_bytes, static_cast<char>(t)) !=
+                static_cast<ptrdiff_t>(q_bytes)) {
+              ++num_corrupted;
+            }
+            a->DeallocateRaw(q);
+            live[i % live.size()] = live.back();
+            live.pop_back();
+          }
+        }
+        for (const auto& [p, bytes] : live) {
+          a->DeallocateRaw(p);
+        }
+      });
+    }
+  }
+  EXPECT_EQ(num_corrupted, 0);
+  std::optional<AllocatorStats> stats = a->GetStats();
+  ASSERT_TRUE(stats);
+  EXPECT_EQ(stats->bytes_in_use, 0);
+  EXPECT_EQ(stats->num_allocs, kNumThreads * kNumIterations);
+  EXPECT_EQ(NumChunksInUse(a->RecordMemoryMap()), 0);
+}
+
+// Allocates and frees a mix of small sizes from many threads. Arg 0 is the
+// number of threads, arg 1 the thread cache limit in KiB.
+static void BM_SmallAllocationThreaded(::testing::benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const size_t thread_cache_max_bytes = state.range(1) << 10;
+  constexpr int kSubIters = 10000;
+  std::unique_ptr<BFCAllocator> a =
+      CreateAllocator(1ull << 30, thread_cache_max_bytes);
+  thread::ThreadPool pool(Env::Default(), "test", num_threads);
+
+  for (auto s : state) {
+    BlockingCounter counter(num_threads);
+    for (int t = 0; t < num_threads; ++t) {
+      pool.Schedule([&a, &counter] {
+        const size_t sizes[] = {64, 256, 1024, 4096, 512, 16384, 128, 2048};
+        void* ptrs[4] = {};
+        for (int i = 0; i < kSubIters; ++i) {
+          void*& p = ptrs[i % 4];
+          if (p != nullptr) {
+            a->DeallocateRaw(p);
+          }
+          p = a->AllocateRaw(1, sizes[i % 8]);
+        }
+        for (void* p : ptrs) {
+          a->DeallocateRaw(p);
+        }
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+  state.SetItemsProcessed(state.iterations() * num_threads * kSubIters);
+}
+BENCHMARK(BM_SmallAllocationThreaded)
+    ->ArgPair(1, 0)
+    ->ArgPair(1, 256)
+    ->ArgPair(8, 0)
+    ->ArgPair(8, 256)
+    ->ArgPair(32, 0)
+    ->ArgPair(32, 256);
+
+}  // namespace
+}  // namespace tsl
@@ -0,0 +1,163 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/record_index.h"
+
+#include <memory>
+#include <string>
+
+#include "tsl/lib/hash/crc32c.h"
+#include "tsl/lib/io/record_reader.h"
+#include "tsl/platform/coding.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/logging.h"
+#include "tsl/platform/path.h"
+#include "tsl/platform/raw_coding.h"
+#include "tsl/platform/strcat.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+// Format of an index file:
+//  uint64    magic number
+//  uint64    size of the indexed file
+//  uint64    number of records
+//  {uint64 offset, uint64 length} for each record
+//  uint32    masked crc of everything above
+constexpr uint64 kRecordIndexMagic = 0x3130584449524654ULL;  // "TFRIDX01"
+constexpr size_t kRecordIndexHeaderSize = 3 * sizeof(uint64);
+constexpr size_t kRecordIndexEntrySize = 2 * sizeof(uint64);
+constexpr char kRecordIndexSuffix[] = ".index";
+
+}  // namespace
+
+std::string RecordIndexFilename(StringPiece filename) {
+  return JoinPath(Dirname(filename),
+                  strings::StrCat(".", Basename(filename), kRecordIndexSuffix));
+}
+
+Status WriteRecordIndex(Env* env, const std::string& index_filename,
+                        const RecordIndex& index) {
+  std::string contents;
+  contents.reserve(kRecordIndexHeaderSize +
+                   index.entries.size() * kRecordIndexEntrySize +
+                   sizeof(uint32));
+  core::PutFixed64(&contents, kRecordIndexMagic);
+  core::PutFixed64(&contents, index.file_size);
+  core::PutFixed64(&contents, index.entries.size());
+  for (const RecordIndexEntry& entry : index.entries) {
+    core::PutFixed64(&contents, entry.offset);
+    core::PutFixed64(&contents, entry.length);
+  }
+  core::PutFixed32(&contents,
+                   crc32c::Mask(crc32c::Value(contents.data(), contents.size())));
+
+  std::string tmp_filename = index_filename;
+  if (!env->CreateUniqueFileName(&tmp_filename, ".tmp")) {
+    return errors::Internal("Failed to create a temporary file name for ",
+                            index_filename);
+  }
+  TF_RETURN_IF_ERROR(WriteStringToFile(env, tmp_filename, contents));
+  Status s = env->RenameFile(tmp_filename, index_filename);
+  if (!s.ok()) {
+    env->DeleteFile(tmp_filename).IgnoreError();
+  }
+  return s;
+}
+
+Status ReadRecordIndex(Env* env, const std::string& index_filename,
+                       RecordIndex* index) {
+  std::string contents;
+  TF_RETURN_IF_ERROR(ReadFileToString(env, index_filename, &contents));
+  if (contents.size() < kRecordIndexHeaderSize + sizeof(uint32) ||
+      core::DecodeFixed64(contents.data()) != kRecordIndexMagic) {
+    return errors::DataLoss("Not a TFRecord index file: ", index_filename);
+  }
+  const size_t crc_offset = contents.size() - sizeof(uint32);
+  const uint32 masked_crc = core::DecodeFixed32(contents.data() + crc_offset);
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(contents.data(), crc_offset)) {
+    return errors::DataLoss("Corrupted TFRecord index file: ", index_filename);
+  }
+  const uint64 num_records =
+      core::DecodeFixed64(contents.data() + 2 * sizeof(uint64));
+  if ((crc_offset - kRecordIndexHeaderSize) / kRecordIndexEntrySize !=
+          num_records ||
+      (crc_offset - kRecordIndexHeaderSize) % kRecordIndexEntrySize != 0) {
+    return errors::DataLoss("Truncated TFRecord index file: ", index_filename);
+  }
+
+  index->file_size = core::DecodeFixed64(contents.data() + sizeof(uint64));
+  index->entries.resize(num_records);
+  const char* p = contents.data() + kRecordIndexHeaderSize;
+  for (RecordIndexEntry& entry : index->entries) {
+    entry.offset = core::DecodeFixed64(p);
+    entry.length = core::DecodeFixed64(p + sizeof(uint64));
+    p += kRecordIndexEntrySize;
+  }
+  return OkStatus();
+}
+
+Status BuildRecordIndex(RandomAccessFile* file, RecordIndex* index) {
+  RecordReaderOptions options;
+  options.buffer_size = 256 * 1024;
+  RecordReader reader(file, options);
+  index->entries.clear();
+  uint64 offset = 0;
+  while (true) {
+    const uint64 record_offset = offset;
+    int num_skipped;
+    Status s = reader.SkipRecords(&offset, 1, &num_skipped);
+    if (errors::IsOutOfRange(s)) {
+      break;
+    }
+    TF_RETURN_IF_ERROR(s);
+    index->entries.push_back(
+        {record_offset, offset - record_offset - RecordReader::kHeaderSize -
+                            RecordReader::kFooterSize});
+  }
+  index->file_size = offset;
+  return OkStatus();
+}
+
+Status LoadOrBuildRecordIndex(Env* env, const std::string& filename,
+                              RecordIndex* index) {
+  uint64 file_size;
+  TF_RETURN_IF_ERROR(env->GetFileSize(filename, &file_size));
+  const std::string index_filename = RecordIndexFilename(filename);
+  if (env->FileExists(index_filename).ok()) {
+    Status s = ReadRecordIndex(env, index_filename, index);
+    if (s.ok() && index->file_size == file_size) {
+      return OkStatus();
+    }
+    VLOG(1) << "Rebuilding stale or unreadable TFRecord index "
+            << index_filename << ": " << s;
+  }
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_RETURN_IF_ERROR(env->NewRandomAccessFile(filename, &file));
+  TF_RETURN_IF_ERROR(BuildRecordIndex(file.get(), index));
+  // The data directory may be read-only, in which case the index is rebuilt
+  // the next time it is needed.
+  Status s = WriteRecordIndex(env, index_filename, *index);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to cache TFRecord index for " << filename << ": "
+                 << s;
+  }
+  return OkStatus();
+}
+
+}  // namespace io
+}  // namespace tsl
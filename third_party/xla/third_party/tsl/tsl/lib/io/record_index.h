@@ -0,0 +1,76 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
+#define TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
+
+#include <string>
+#include <vector>
+
+#include "tsl/platform/env.h"
+#include "tsl/platform/status.h"
+#include "tsl/platform/stringpiece.h"
+#include "tsl/platform/types.h"
+
+namespace tsl {
+namespace io {
+
+// Location of a single record in an uncompressed TFRecord file. `offset`
+// points at the record header; `length` is the size of the record data.
+struct RecordIndexEntry {
+  uint64 offset = 0;
+  uint64 length = 0;
+};
+
+// Maps record numbers to their location in an uncompressed TFRecord file, so
+// that records can be read in any order without scanning the file.
+struct RecordIndex {
+  // Size of the indexed file in bytes. An index whose `file_size` does not
+  // match the current size of the file is considered stale.
+  uint64 file_size = 0;
+  std::vector<RecordIndexEntry> entries;
+};
+
+// Returns the name of the index sidecar for the TFRecord file `filename`.
+//
+// The sidecar lives in the same directory as the file, and its name starts
+// with a '.' so that glob patterns over the data files do not pick it up.
+std::string RecordIndexFilename(StringPiece filename);
+
+// Serializes `index` to `index_filename`. The file is written to a temporary
+// location and renamed into place, so concurrent readers never observe a
+// partially written index.
+Status WriteRecordIndex(Env* env, const std::string& index_filename,
+                        const RecordIndex& index);
+
+// Reads an index previously written by `WriteRecordIndex`. Returns
+// DATA_LOSS if the index is corrupted.
+Status ReadRecordIndex(Env* env, const std::string& index_filename,
+                       RecordIndex* index);
+
+// Builds the index of `file` by scanning its record headers. Record data is
+// skipped and not checksummed.
+Status BuildRecordIndex(RandomAccessFile* file, RecordIndex* index);
+
+// Reads the index of the TFRecord file `filename` from its sidecar. If the
+// sidecar does not exist or is stale, builds the index by scanning the file
+// and makes a best-effort attempt to cache it in the sidecar.
+Status LoadOrBuildRecordIndex(Env* env, const std::string& filename,
+                              RecordIndex* index);
+
+}  // namespace io
+}  // namespace tsl
+
+#endif  // TENSORFLOW_TSL_LIB_IO_RECORD_INDEX_H_
@@ -0,0 +1,192 @@
+/* Copyright 2024 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tsl/lib/io/record_index.h"
+
+#include <memory>
+#include <string>
+
+#include "tsl/lib/core/status_test_util.h"
+#include "tsl/lib/io/record_reader.h"
+#include "tsl/lib/io/record_writer.h"
+#include "tsl/platform/env.h"
+#include "tsl/platform/errors.h"
+#include "tsl/platform/path.h"
+#include "tsl/platform/test.h"
+
+namespace tsl {
+namespace io {
+namespace {
+
+void WriteRecords(const std::string& filename, RecordIndex* index) {
+  Env* env = Env::Default();
+  std::unique_ptr<WritableFile> file;
+  TF_ASSERT_OK(env->NewWritableFile(filename, &file));
+  RecordWriterOptions options;
+  options.build_index = true;
+  RecordWriter writer(file.get(), options);
+  TF_ASSERT_OK(writer.WriteRecord("abc"));
+  TF_ASSERT_OK(writer.WriteRecord(""));
+  TF_ASSERT_OK(writer.WriteRecord("defgh"));
+  TF_ASSERT_OK(writer.Close());
+  TF_ASSERT_OK(file->Close());
+  *index = writer.index();
+}
+
+TEST(RecordIndexTest, IndexFilename) {
+  EXPECT_EQ(RecordIndexFilename("/data/train-00001"),
+            "/data/.train-00001.index");
+  EXPECT_EQ(RecordIndexFilename("train"), ".train.index");
+}
+
+TEST(RecordIndexTest, WriterIndexMatchesScan) {
+  const std::string filename =
+      JoinPath(testing::TmpDir(), "record_index_writer_test");
+  RecordIndex writer_index;
+  WriteRecords(filename, &writer_index);
+  ASSERT_EQ(writer_index.entries.size(), 3);
+
+  Env* env = Env::Default();
+  uint64 file_size;
+  TF_ASSERT_OK(env->GetFileSize(filename, &file_size));
+  EXPECT_EQ(writer_index.file_size, file_size);
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(filename, &file));
+  RecordIndex scanned_index;
+  TF_ASSERT_OK(BuildRecordIndex(file.get(), &scanned_index));
+  EXPECT_EQ(scanned_index.file_size, file_size);
+  ASSERT_EQ(scanned_index.entries.size(), writer_index.entries.size());
+  for (int i = 0; i < scanned_index.entries.size(); ++i) {
+    EXPECT_EQ(scanned_index.entries[i].offset, writer_index.entries[i].offset);
+    EXPECT_EQ(scanned_index.entries[i].length, writer_index.entries[i].length);
+  }
+
+  // Records can be read directly at the indexed offsets.
+  RecordReader reader(file.get());
+  uint64 offset = writer_index.entries[2].offset;
+  tstring record;
+  TF_ASSERT_OK(reader.ReadRecord(&offset, &record));
+  EXPECT_EQ(record, "defgh");
+  EXPECT_EQ(record.size(), writer_index.entries[2].length);
+}
+
+TEST(RecordIndexTest, WriterPersistsIndexOnClose) {
+  const std::string filename =
+      JoinPath(testing::TmpDir(), "record_index_persist_test");
+  RecordIndex writer_index;
+  WriteRecords(filename, &writer_index);
+
+  Env* env = Env::Default();
+  const std::string index_filename = RecordIndexFilename(filename);
+  RecordIndex index;
+  TF_ASSERT_OK(ReadRecordIndex(env, index_filename, &index));
+  EXPECT_EQ(index.file_size, writer_index.file_size);
+  EXPECT_EQ(index.entries.size(), 3);
+
+  // A writer appending to the file indexes its records at their offsets in
+  // the file, and extends the persisted index.
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(env->NewAppendableFile(filename, &file));
+    RecordWriterOptions options;
+    options.build_index = true;
+    RecordWriter writer(file.get(), options);
+    TF_ASSERT_OK(writer.WriteRecord("ijk"));
+    TF_ASSERT_OK(writer.Close());
+    TF_ASSERT_OK(file->Close());
+    ASSERT_EQ(writer.index().entries.size(), 1);
+    EXPECT_EQ(writer.index().entries[0].offset, writer_index.file_size);
+  }
+  TF_ASSERT_OK(ReadRecordIndex(env, index_filename, &index));
+  std::unique_ptr<RandomAccessFile> file;
+  TF_ASSERT_OK(env->NewRandomAccessFile(filename, &file));
+  RecordIndex scanned_index;
+  TF_ASSERT_OK(BuildRecordIndex(file.get(), &scanned_index));
+  EXPECT_EQ(index.file_size, scanned_index.file_size);
+  ASSERT_EQ(index.entries.size(), 4);
+  for (int i = 0; i < index.entries.size(); ++i) {
+    EXPECT_EQ(index.entries[i].offset, scanned_index.entries[i].offset);
+    EXPECT_EQ(index.entries[i].length, scanned_index.entries[i].length);
+  }
+}
+
+TEST(RecordIndexTest, RoundTrip) {
+  const std::string filename =
+      JoinPath(testing::TmpDir(), "record_index_round_trip_test");
+  RecordIndex index;
+  WriteRecords(filename, &index);
+
+  Env* env = Env::Default();
+  const std::string index_filename = RecordIndexFilename(filename);
+  TF_ASSERT_OK(WriteRecordIndex(env, index_filename, index));
+  RecordIndex read_index;
+  TF_ASSERT_OK(ReadRecordIndex(env, index_filename, &read_index));
+  EXPECT_EQ(read_index.file_size, index.file_size);
+  ASSERT_EQ(read_index.entries.size(), index.entries.size());
+  for (int i = 0; i < index.entries.size(); ++i) {
+    EXPECT_EQ(read_index.entries[i].offset, index.entries[i].offset);
+    EXPECT_EQ(read_index.entries[i].length, index.entries[i].length);
+  }
+}
+
+TEST(RecordIndexTest, CorruptedIndex) {
+  const std::string index_filename =
+      JoinPath(testing::TmpDir(), ".record_index_corrupted_test.index");
+  Env* env = Env::Default();
+  RecordIndex index;
+  index.file_size = 16;
+  index.entries.push_back({0, 0});
+  TF_ASSERT_OK(WriteRecordIndex(env, index_filename, index));
+
+  std::string contents;
+  TF_ASSERT_OK(ReadFileToString(env, index_filename, &contents));
+  contents[sizeof(uint64)] ^= 1;
+  TF_ASSERT_OK(WriteStringToFile(env, index_filename, contents));
+  EXPECT_TRUE(
+      errors::IsDataLoss(ReadRecordIndex(env, index_filename, &index)));
+}
+
+TEST(RecordIndexTest, LoadOrBuildCachesIndex) {
+  const std::string filename =
+      JoinPath(testing::TmpDir(), "record_index_load_or_build_test");
+  RecordIndex writer_index;
+  WriteRecords(filename, &writer_index);
+
+  Env* env = Env::Default();
+  const std::string index_filename = RecordIndexFilename(filename);
+  env->DeleteFile(index_filename).IgnoreError();
+
+  RecordIndex index;
+  TF_ASSERT_OK(LoadOrBuildRecordIndex(env, filename, &index));
+  EXPECT_EQ(index.entries.size(), 3);
+  TF_EXPECT_OK(env->FileExists(index_filename));
+
+  // Appending to the file makes the cached index stale.
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_ASSERT_OK(env->NewAppendableFile(filename, &file));
+    RecordWriter writer(file.get());
+    TF_ASSERT_OK(writer.WriteRecord("ijk"));
+    TF_ASSERT_OK(writer.Close());
+    TF_ASSERT_OK(file->Close());
+  }
+  TF_ASSERT_OK(LoadOrBuildRecordIndex(env, filename, &index));
+  EXPECT_EQ(index.entries.size(), 4);
+}
+
+}  // namespace
+}  // namespace io
+}  // namespace tsl
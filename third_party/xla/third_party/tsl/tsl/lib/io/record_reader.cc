@@ -17,6 +17,9 @@ limitations under the License.
 
 #include <limits.h>
 
+#include <memory>
+#include <utility>
+
 #include "tsl/lib/hash/crc32c.h"
 #include "tsl/lib/io/buffered_inputstream.h"
 #include "tsl/lib/io/compression.h"
@@ -255,6 +258,65 @@ Status RecordReader::SkipRecords(uint64* offset, int num_to_skip,
   return OkStatus();
 }
 
+MemmappedRecordReader::MemmappedRecordReader(
+    std::shared_ptr<ReadOnlyMemoryRegion> region, bool verify_data_checksum)
+    : region_(std::move(region)),
+      data_(static_cast<const char*>(region_->data())),
+      size_(region_->length()),
+      verify_data_checksum_(verify_data_checksum) {}
+
+Status MemmappedRecordReader::ReadHeader(uint64 offset, uint64* length) const {
+  if (offset >= size_) {
+    return errors::OutOfRange("eof", GetChecksumErrorSuffix(offset));
+  }
+  if (size_ - offset < RecordReader::kHeaderSize) {
+    return errors::DataLoss("truncated record at ", offset,
+                            GetChecksumErrorSuffix(offset));
+  }
+  const char* header = data_ + offset;
+  const uint32 masked_crc = core::DecodeFixed32(header + sizeof(uint64));
+  if (crc32c::Unmask(masked_crc) != crc32c::Value(header, sizeof(uint64))) {
+    return errors::DataLoss("corrupted record at ", offset,
+                            GetChecksumErrorSuffix(offset));
+  }
+  *length = core::DecodeFixed64(header);
+  const uint64 remaining = size_ - offset - RecordReader::kHeaderSize;
+  if (remaining < RecordReader::kFooterSize ||
+      *length > remaining - RecordReader::kFooterSize) {
+    return errors::DataLoss("truncated record at ", offset,
+                            GetChecksumErrorSuffix(offset));
+  }
+  return OkStatus();
+}
+
+Status MemmappedRecordReader::ReadRecord(uint64* offset, StringPiece* record) {
+  uint64 length;
+  TF_RETURN_IF_ERROR(ReadHeader(*offset, &length));
+  const char* data = data_ + *offset + RecordReader::kHeaderSize;
+  if (verify_data_checksum_) {
+    const uint32 masked_crc = core::DecodeFixed32(data + length);
+    if (crc32c::Unmask(masked_crc) != crc32c::Value(data, length)) {
+      return errors::DataLoss("corrupted record at ", *offset,
+                              GetChecksumErrorSuffix(*offset));
+    }
+  }
+  *record = StringPiece(data, length);
+  *offset += RecordReader::kHeaderSize + length + RecordReader::kFooterSize;
+  return OkStatus();
+}
+
+Status MemmappedRecordReader::SkipRecords(uint64* offset, int num_to_skip,
+                                          int* num_skipped) {
+  *num_skipped = 0;
+  for (int i = 0; i < num_to_skip; ++i) {
+    uint64 length;
+    TF_RETURN_IF_ERROR(ReadHeader(*offset, &length));
+    *offset += RecordReader::kHeaderSize + length + RecordReader::kFooterSize;
+    (*num_skipped)++;
+  }
+  return OkStatus();
+}
+
 SequentialRecordReader::SequentialRecordReader(
     RandomAccessFile* file, const RecordReaderOptions& options)
     : underlying_(file, options), offset_(0) {}
@@ -16,6 +16,8 @@ limitations under the License.
 #ifndef TENSORFLOW_TSL_LIB_IO_RECORD_READER_H_
 #define TENSORFLOW_TSL_LIB_IO_RECORD_READER_H_
 
+#include <memory>
+
 #include "tsl/lib/io/inputstream_interface.h"
 #include "tsl/platform/errors.h"
 #include "tsl/platform/stringpiece.h"
@@ -30,6 +32,7 @@ limitations under the License.
 
 namespace tsl {
 class RandomAccessFile;
+class ReadOnlyMemoryRegion;
 
 namespace io {
 
@@ -174,6 +177,50 @@ class SequentialRecordReader {
   uint64 offset_ = 0;
 };
 
+// Interface to read uncompressed TFRecord files through a read-only memory
+// mapping of the whole file.
+//
+// Records are returned as views into the mapping, so no record bytes are
+// copied. Callers that hand a record out beyond the lifetime of the reader
+// must hold on to `region()`, which keeps the mapping alive.
+//
+// Note: this class is not thread safe; external synchronization required.
+class MemmappedRecordReader {
+ public:
+  // If `verify_data_checksum` is false, only the length header of each record
+  // is checksummed; the (much larger) data checksum is skipped.
+  explicit MemmappedRecordReader(
+      std::shared_ptr<ReadOnlyMemoryRegion> region,
+      bool verify_data_checksum = true);
+
+  // Reads the record at "*offset" into *record and updates *offset to point
+  // to the offset of the next record. *record points into `region()`.
+  // Returns OK on success, OUT_OF_RANGE for end of file, or something else
+  // for an error.
+  Status ReadRecord(uint64* offset, StringPiece* record);
+
+  // Skips num_to_skip records starting at "*offset" and updates *offset to
+  // point to the offset of the next record. "*num_skipped" records the number
+  // of records that are actually skipped.
+  Status SkipRecords(uint64* offset, int num_to_skip, int* num_skipped);
+
+  const std::shared_ptr<ReadOnlyMemoryRegion>& region() const {
+    return region_;
+  }
+
+ private:
+  // Validates the header at `offset` and stores the data length in *length.
+  Status ReadHeader(uint64 offset, uint64* length) const;
+
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const char* const data_;
+  const uint64 size_;
+  const bool verify_data_checksum_;
+
+  MemmappedRecordReader(const MemmappedRecordReader&) = delete;
+  void operator=(const MemmappedRecordReader&) = delete;
+};
+
 }  // namespace io
 }  // namespace tsl
 
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tsl/platform/status.h"
 #include "tsl/platform/strcat.h"
 #include "tsl/platform/test.h"
+#include "tsl/platform/test_benchmark.h"
 
 namespace tsl {
 
@@ -267,6 +268,80 @@ TEST(RecordReaderWriterTest, TestMalformedInput) {
   }
 }
 
+TEST(RecordReaderWriterTest, TestMemmappedReader) {
+  Env* env = Env::Default();
+  string fname = testing::TmpDir() + "/record_reader_writer_memmapped_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_EXPECT_OK(writer.WriteRecord("defg"));
+    TF_EXPECT_OK(writer.WriteRecord("hij"));
+    TF_CHECK_OK(writer.Close());
+    TF_CHECK_OK(file->Close());
+  }
+
+  for (bool verify_data_checksum : {true, false}) {
+    std::unique_ptr<ReadOnlyMemoryRegion> region;
+    TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+    io::MemmappedRecordReader reader(std::move(region), verify_data_checksum);
+    uint64 offset = 0;
+    StringPiece record;
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("abc", record);
+    int num_skipped;
+    TF_CHECK_OK(reader.SkipRecords(&offset, 1, &num_skipped));
+    EXPECT_EQ(1, num_skipped);
+    TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    EXPECT_EQ("hij", record);
+    EXPECT_EQ(offset, GetFileSize(fname));
+    EXPECT_EQ(error::OUT_OF_RANGE,
+              reader.ReadRecord(&offset, &record).code());
+  }
+}
+
+TEST(RecordReaderWriterTest, TestMemmappedReaderCorruptedData) {
+  Env* env = Env::Default();
+  string fname =
+      testing::TmpDir() + "/record_reader_writer_memmapped_corrupted_test";
+
+  {
+    std::unique_ptr<WritableFile> file;
+    TF_CHECK_OK(env->NewWritableFile(fname, &file));
+    io::RecordWriter writer(file.get());
+    TF_EXPECT_OK(writer.WriteRecord("abc"));
+    TF_CHECK_OK(writer.Close());
+    TF_CHECK_OK(file->Close());
+  }
+  {
+    // Flip the first data byte, leaving the header intact.
+    string contents;
+    TF_CHECK_OK(ReadFileToString(env, fname, &contents));
+    contents[io::RecordReader::kHeaderSize] = 'x';
+    TF_CHECK_OK(WriteStringToFile(env, fname, contents));
+  }
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  std::shared_ptr<ReadOnlyMemoryRegion> shared_region = std::move(region);
+
+  uint64 offset = 0;
+  StringPiece record;
+  io::MemmappedRecordReader verifying_reader(shared_region,
+                                             /*verify_data_checksum=*/true);
+  Status s = verifying_reader.ReadRecord(&offset, &record);
+  EXPECT_EQ(error::DATA_LOSS, s.code());
+  EXPECT_EQ("corrupted record at 0 (Is this even a TFRecord file?)",
+            s.message());
+
+  io::MemmappedRecordReader fast_reader(shared_region,
+                                        /*verify_data_checksum=*/false);
+  TF_CHECK_OK(fast_reader.ReadRecord(&offset, &record));
+  EXPECT_EQ("xbc", record);
+}
+
 TEST(RecordReaderWriterTest, TestSnappy) {
   Env* env = Env::Default();
   string fname = testing::TmpDir() + "/record_reader_writer_snappy_test";
@@ -366,4 +441,81 @@ TEST(RecordReaderWriterTest, TestUseAfterClose) {
   }
 }
 
+namespace {
+
+// Writes `num_records` records of `record_size` bytes to a temporary file and
+// returns its name.
+string WriteBenchmarkRecords(int num_records, int record_size) {
+  Env* env = Env::Default();
+  string fname;
+  CHECK(env->LocalTempFilename(&fname));
+  std::unique_ptr<WritableFile> file;
+  TF_CHECK_OK(env->NewWritableFile(fname, &file));
+  io::RecordWriter writer(file.get());
+  const string record(record_size, 'a');
+  for (int i = 0; i < num_records; ++i) {
+    TF_CHECK_OK(writer.WriteRecord(record));
+  }
+  TF_CHECK_OK(writer.Close());
+  TF_CHECK_OK(file->Close());
+  return fname;
+}
+
+void BM_SequentialRecordReader(::testing::benchmark::State& state) {
+  const int num_records = state.range(0);
+  const int record_size = state.range(1);
+  Env* env = Env::Default();
+  const string fname = WriteBenchmarkRecords(num_records, record_size);
+
+  std::unique_ptr<RandomAccessFile> file;
+  TF_CHECK_OK(env->NewRandomAccessFile(fname, &file));
+  io::RecordReaderOptions options;
+  options.buffer_size = 256 * 1024;
+  tstring record;
+  for (auto s : state) {
+    io::SequentialRecordReader reader(file.get(), options);
+    for (int i = 0; i < num_records; ++i) {
+      TF_CHECK_OK(reader.ReadRecord(&record));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * num_records * record_size);
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+
+void BM_MemmappedRecordReader(::testing::benchmark::State& state) {
+  const int num_records = state.range(0);
+  const int record_size = state.range(1);
+  const bool verify_data_checksum = state.range(2);
+  Env* env = Env::Default();
+  const string fname = WriteBenchmarkRecords(num_records, record_size);
+
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  TF_CHECK_OK(env->NewReadOnlyMemoryRegionFromFile(fname, &region));
+  std::shared_ptr<ReadOnlyMemoryRegion> shared_region = std::move(region);
+  StringPiece record;
+  for (auto s : state) {
+    io::MemmappedRecordReader reader(shared_region, verify_data_checksum);
+    uint64 offset = 0;
+    for (int i = 0; i < num_records; ++i) {
+      TF_CHECK_OK(reader.ReadRecord(&offset, &record));
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * num_records * record_size);
+  TF_CHECK_OK(env->DeleteFile(fname));
+}
+
+BENCHMARK(BM_SequentialRecordReader)
+    ->ArgPair(10000, 100)
+    ->ArgPair(1000, 10 * 1024)
+    ->ArgPair(100, 1024 * 1024);
+
+BENCHMARK(BM_MemmappedRecordReader)
+    ->Args({10000, 100, true})
+    ->Args({10000, 100, false})
+    ->Args({1000, 10 * 1024, true})
+    ->Args({1000, 10 * 1024, false})
+    ->Args({100, 1024 * 1024, true})
+    ->Args({100, 1024 * 1024, false});
+
+}  // namespace
 }  // namespace tsl
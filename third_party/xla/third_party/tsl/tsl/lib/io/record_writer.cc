@@ -60,6 +60,26 @@ RecordWriterOptions RecordWriterOptions::CreateRecordWriterOptions(
 RecordWriter::RecordWriter(WritableFile* dest,
                            const RecordWriterOptions& options)
     : dest_(dest), options_(options) {
+  if (options_.build_index &&
+      options_.compression_type != RecordWriterOptions::NONE) {
+    LOG(ERROR) << "Record indices are not supported with compression."
+               << " No index will be built.";
+    options_.build_index = false;
+  }
+  if (options_.build_index) {
+    // Records are indexed by their offset in the file, which does not start
+    // at 0 if the file is appended to.
+    int64_t position;
+    Status s = dest_->Tell(&position);
+    if (s.ok()) {
+      index_.file_size = position;
+      index_start_offset_ = position;
+    } else {
+      LOG(WARNING) << "Cannot determine the offset of the first record: " << s
+                   << ". No index will be built.";
+      options_.build_index = false;
+    }
+  }
 #if defined(IS_SLIM_BUILD)
   if (options.compression_type != RecordWriterOptions::NONE) {
     LOG(FATAL) << "Compression is unsupported on mobile platforms.";
@@ -87,6 +107,49 @@ RecordWriter::RecordWriter(WritableFile* dest,
 #endif
 }
 
+void RecordWriter::AddToIndex(uint64 length) {
+  if (!options_.build_index) return;
+  index_.entries.push_back({index_.file_size, length});
+  index_.file_size += kHeaderSize + length + kFooterSize;
+}
+
+void RecordWriter::PersistIndex() {
+  if (!options_.build_index || index_persisted_) return;
+  index_persisted_ = true;
+  StringPiece filename;
+  Status s = dest_->Name(&filename);
+  if (!s.ok()) {
+    LOG(WARNING) << "Cannot persist the record index: " << s;
+    return;
+  }
+  Env* env = Env::Default();
+  const std::string index_filename = RecordIndexFilename(filename);
+  RecordIndex index;
+  if (index_start_offset_ > 0) {
+    // The writer appended to an existing file. Its index only covers the
+    // whole file together with the index of the records already there. If
+    // that one is missing or stale, the index is left to be rebuilt by
+    // scanning the file when it is needed.
+    if (!ReadRecordIndex(env, index_filename, &index).ok() ||
+        index.file_size != index_start_offset_) {
+      VLOG(1) << "Not persisting the record index of " << filename
+              << ": the index of its first " << index_start_offset_
+              << " bytes is unavailable.";
+      return;
+    }
+    index.entries.insert(index.entries.end(), index_.entries.begin(),
+                         index_.entries.end());
+    index.file_size = index_.file_size;
+  } else {
+    index = index_;
+  }
+  s = WriteRecordIndex(env, index_filename, index);
+  if (!s.ok()) {
+    LOG(WARNING) << "Failed to persist the record index to " << index_filename
+                 << ": " << s;
+  }
+}
+
 RecordWriter::~RecordWriter() {
   if (dest_ != nullptr) {
     Status s = Close();
@@ -112,7 +175,9 @@ Status RecordWriter::WriteRecord(StringPiece data) {
   PopulateFooter(footer, data.data(), data.size());
   TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
   TF_RETURN_IF_ERROR(dest_->Append(data));
-  return dest_->Append(StringPiece(footer, sizeof(footer)));
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+  AddToIndex(data.size());
+  return OkStatus();
 }
 
 #if defined(TF_CORD_SUPPORT)
@@ -132,12 +197,15 @@ Status RecordWriter::WriteRecord(const absl::Cord& data) {
   PopulateFooter(footer, data);
   TF_RETURN_IF_ERROR(dest_->Append(StringPiece(header, sizeof(header))));
   TF_RETURN_IF_ERROR(dest_->Append(data));
-  return dest_->Append(StringPiece(footer, sizeof(footer)));
+  TF_RETURN_IF_ERROR(dest_->Append(StringPiece(footer, sizeof(footer))));
+  AddToIndex(data.size());
+  return OkStatus();
 }
 #endif
 
 Status RecordWriter::Close() {
   if (dest_ == nullptr) return OkStatus();
+  PersistIndex();
   if (IsZlibCompressed(options_) || IsSnappyCompressed(options_)) {
     Status s = dest_->Close();
     delete dest_;
@@ -17,6 +17,7 @@ limitations under the License.
 #define TENSORFLOW_TSL_LIB_IO_RECORD_WRITER_H_
 
 #include "tsl/lib/hash/crc32c.h"
+#include "tsl/lib/io/record_index.h"
 #include "tsl/platform/coding.h"
 #include "tsl/platform/status.h"
 #include "tsl/platform/stringpiece.h"
@@ -48,6 +49,13 @@ struct RecordWriterOptions {
   static RecordWriterOptions CreateRecordWriterOptions(
       const string& compression_type);
 
+  // If true, the writer records the offset and length of every record it
+  // writes, see RecordWriter::index(), and persists the index next to the
+  // file on Close(). Only supported without compression, since records in
+  // compressed files cannot be addressed by offset, and with files that
+  // support Tell() and Name().
+  bool build_index = false;
+
 #if !defined(IS_SLIM_BUILD)
   // Options specific to compression.
   io::ZlibCompressionOptions zlib_options;
@@ -90,10 +98,19 @@ class RecordWriter {
 
   // Writes all output to the file. Does *not* close the WritableFile.
   //
+  // If `options.build_index` is set, also writes the index of the file to
+  // RecordIndexFilename(<file name>). This is best effort: a missing index is
+  // rebuilt by scanning the file when it is needed.
+  //
   // After calling Close(), any further calls to `WriteRecord()` or `Flush()`
   // are invalid.
   Status Close();
 
+  // Returns the index of the records written so far. Empty unless
+  // `options.build_index` is set. Offsets are positions in the file, so they
+  // account for any records the file held before the writer appended to it.
+  const RecordIndex& index() const { return index_; }
+
   // Utility method to populate TFRecord headers.  Populates record-header in
   // "header[0,kHeaderSize-1]".  The record-header is based on data[0, n-1].
   inline static void PopulateHeader(char* header, const char* data, size_t n);
@@ -111,8 +128,18 @@ class RecordWriter {
 #endif
 
  private:
+  // Records the location of a record of `length` bytes that was just written.
+  void AddToIndex(uint64 length);
+
+  // Writes `index_` next to the file, see Close().
+  void PersistIndex();
+
   WritableFile* dest_;
   RecordWriterOptions options_;
+  RecordIndex index_;
+  // Offset at which the writer started writing records.
+  uint64 index_start_offset_ = 0;
+  bool index_persisted_ = false;
 
   inline static uint32 MaskedCrc(const char* data, size_t n) {
     return crc32c::Mask(crc32c::Value(data, n));